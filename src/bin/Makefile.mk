@@ -6,6 +6,7 @@ bin_PROGRAMS += src/bin/examine
 src_bin_examine_SOURCES = \
 src/bin/examine_depends.c \
 src/bin/examine_main.c \
+src/bin/examine_timeline.c \
 src/bin/examine_trace.c \
 src/bin/examine_view.c \
 src/bin/examine_private.h
@@ -16,13 +17,14 @@ endif
 
 # Memcheck tool
 
-if HAVE_WIN32
+if HAVE_MEMCHECK
 include src/bin/memcheck/Makefile.mk
 endif
 
 src_bin_examine_CPPFLAGS = \
 -I$(top_srcdir)/src/lib \
 -I$(top_srcdir)/src/bin \
+-DPACKAGE_BIN_DIR=\"$(bindir)\" \
 @EXM_CPPFLAGS@
 
 src_bin_examine_CFLAGS = @EXM_CFLAGS@
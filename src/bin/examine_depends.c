@@ -60,6 +60,7 @@ do { \
 
 static char _exm_depends_list_dllcharacteristics[4096];
 static unsigned int _exm_indent = 0;
+static unsigned char _exm_depends_verify_checksum = 0;
 
 static int
 _exm_depends_cmd_cmp_cb(const void *d1, const void *d2)
@@ -211,6 +212,23 @@ _exm_depends_cmd_list_dllcharacteristics_get(const Exm_Pe *pe)
     return _exm_depends_list_dllcharacteristics;
 }
 
+static const char *
+_exm_depends_cmd_list_checksum_get(const Exm_Pe *pe)
+{
+    DWORD checksum;
+
+    if (!_exm_depends_verify_checksum)
+        return "";
+
+    checksum = exm_pe_nt_header_get(pe)->OptionalHeader.CheckSum;
+    if (checksum == 0)
+        return " [checksum unset]";
+    else if (checksum == exm_pe_checksum_compute(pe))
+        return " [checksum ok]";
+    else
+        return " [checksum mismatch]";
+}
+
 static Exm_List *
 _exm_depends_cmd_list_fill(Exm_List *list, const Exm_Pe *pe)
 {
@@ -253,7 +271,8 @@ _exm_depends_cmd_list_fill(Exm_List *list, const Exm_Pe *pe)
                         fullname = exm_pe_filename_get(p);
                         if (fullname)
                             printf(" => %s", fullname);
-                        printf("%s\n", _exm_depends_cmd_list_dllcharacteristics_get(p));
+                        printf("%s", _exm_depends_cmd_list_dllcharacteristics_get(p));
+                        printf("%s\n", _exm_depends_cmd_list_checksum_get(p));
                         tmp = _exm_depends_cmd_list_fill(list, p);
                         exm_pe_free(p);
                         if (tmp)
@@ -304,7 +323,8 @@ _exm_depends_cmd_list_fill(Exm_List *list, const Exm_Pe *pe)
                         fullname = exm_pe_filename_get(p);
                         if (fullname)
                             printf(" => %s", fullname);
-                        printf("%s\n", _exm_depends_cmd_list_dllcharacteristics_get(p));
+                        printf("%s", _exm_depends_cmd_list_dllcharacteristics_get(p));
+                        printf("%s\n", _exm_depends_cmd_list_checksum_get(p));
                         tmp = _exm_depends_cmd_list_fill(list, p);
                         exm_pe_free(p);
                         if (tmp)
@@ -333,10 +353,11 @@ _exm_depends_cmd_list_run(const Exm_Pe *pe)
 
     exm_file_base_dir_name_get(exm_pe_filename_get(pe), NULL, &bn);
 
-    printf("   %s => %s%s\n",
+    printf("   %s => %s%s",
            bn,
            exm_pe_filename_get(pe),
            _exm_depends_cmd_list_dllcharacteristics_get(pe));
+    printf("%s\n", _exm_depends_cmd_list_checksum_get(pe));
     free(bn);
     list = exm_list_append(list, _strdup(exm_pe_filename_get(pe)));
     list = _exm_depends_cmd_list_fill(list, pe);
@@ -387,10 +408,12 @@ _exm_depends_gui_run(Exm_Pe *pe, Exm_Log_Level log_level)
 #endif
 
 void
-exm_depends_run(const char *module, unsigned char display_list, unsigned char gui, Exm_Log_Level log_level)
+exm_depends_run(const char *module, unsigned char display_list, unsigned char verify_checksum, unsigned char gui, Exm_Log_Level log_level)
 {
     Exm_Pe *pe;
 
+    _exm_depends_verify_checksum = verify_checksum;
+
     pe = exm_pe_new(module);
     if (!pe)
     {
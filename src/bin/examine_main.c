@@ -43,7 +43,8 @@ typedef enum
     EXM_TOOL_TRACE,
     EXM_TOOL_DEPENDS,
     EXM_TOOL_VIEW,
-    EXM_TOOL_SIGCHECK
+    EXM_TOOL_SIGCHECK,
+    EXM_TOOL_TIMELINE
 } Exm_Tool;
 
 static void
@@ -61,6 +62,7 @@ _exm_usage(void)
     printf("      depends:  dependencies of PE files\n");
     printf("      view:     view content of PE header file\n");
     printf("      sigcheck: view signature of an application\n");
+    printf("      timeline: graph of the live heap written by Memcheck\n");
     printf("\n");
     printf("  basic user options for all Examine tools, with defaults in [ ]:\n");
     printf("    -h, --help                show this message\n");
@@ -73,12 +75,40 @@ _exm_usage(void)
     printf("    -v, --verbose             synonym to --log-level=3\n");
     printf("    -q, --quiet               synonym to --log-level=0\n");
     printf("\n");
+    printf("  user options for Memcheck:\n");
+    printf("    --sample-interval=<bytes> record one block every <bytes> allocated bytes on average,\n");
+    printf("                              and report the estimated live heap per allocation site\n");
+    printf("                              instead of the leaks and of the free errors [0: all blocks]\n");
+    printf("    --timeline=<file>         write snapshots of the live heap and of its largest allocation\n");
+    printf("                              sites in <file>, displayed with the Timeline tool\n");
+    printf("    --redzone=<bytes>         surround the blocks with at least <bytes> of canaries, verified\n");
+    printf("                              when the blocks are freed and at exit, to find the writes out\n");
+    printf("                              of the blocks (Linux only) [0: no redzones]\n");
+    printf("    --quarantine=<bytes>      keep the freed blocks of each thread out of the allocator until\n");
+    printf("                              they hold <bytes>, filled with poison verified when they are\n");
+    printf("                              released, to find the writes in freed blocks (Linux only)\n");
+    printf("                              [0: no quarantine]\n");
+    printf("    --no-poison               with --quarantine, do not fill the blocks in quarantine\n");
+    printf("    --num-callers=<n>         record at most <n> frames of the stacks, the blocks allocated\n");
+    printf("                              at the same place being then in the same loss record\n");
+    printf("                              [0: all frames, at most 100]\n");
+    printf("    --leak-limit=<n>          display only the <n> largest loss records [0: all records]\n");
+    printf("    --suppressions=<file>     do not display the errors and the loss records matched by the\n");
+    printf("                              suppressions of <file>, in the format of valgrind (can be\n");
+    printf("                              given several times)\n");
+    printf("    --gen-suppressions=<file> write in <file> the suppressions of the displayed errors and\n");
+    printf("                              loss records\n");
+    printf("\n");
     printf("  user options for Depends:\n");
     printf("    --list                    run in text mode, display the list of dependencies\n");
     printf("                              default is the tree of dependencies\n");
+    printf("    --verify-checksum         with --list, verify the checksum of each module\n");
     printf("    --gui                     run in graphical mode\n");
     printf("\n");
     printf("  user options for View:\n");
+    printf("    --relocs                  display a one line summary of the base relocations\n");
+    printf("    --verify-checksum         display a one line check of the checksum\n");
+    printf("    --entropy                 display the entropy of the sections and of the overlay on one line\n");
     printf("    --gui                     run in graphical mode\n");
     printf("\n");
     printf("  Examine is Copyright (C) 2012-2016, and GNU LGPL3'd, by Vincent Torri.\n");
@@ -87,10 +117,135 @@ _exm_usage(void)
     printf("\n");
 }
 
+/*
+ * Parse the memcheck option arg into options, the suppression files
+ * being appended to suppressions. Returns 1 if arg is a memcheck
+ * option, 0 if it is not and -1 if its value is invalid.
+ */
+static int
+_exm_mc_option_parse(const char *arg, Exm_Mc_Options *options, char *suppressions, size_t suppressions_size)
+{
+    if (strncmp(arg, "--sample-interval=", sizeof("--sample-interval=") - 1) == 0)
+    {
+        const char *si;
+        char *end;
+
+        si = arg + sizeof("--sample-interval=") - 1;
+        options->sample_interval = (size_t)strtoul(si, &end, 10);
+        if ((*si < '0') || (*si > '9') || (*end != '\0'))
+        {
+            EXM_LOG_ERR("--sample-interval option must be followed by a number of bytes");
+            return -1;
+        }
+    }
+    else if (strncmp(arg, "--redzone=", sizeof("--redzone=") - 1) == 0)
+    {
+        const char *rz;
+        char *end;
+
+        rz = arg + sizeof("--redzone=") - 1;
+        options->redzone = (size_t)strtoul(rz, &end, 10);
+        if ((*rz < '0') || (*rz > '9') || (*end != '\0'))
+        {
+            EXM_LOG_ERR("--redzone option must be followed by a number of bytes");
+            return -1;
+        }
+    }
+    else if (strncmp(arg, "--quarantine=", sizeof("--quarantine=") - 1) == 0)
+    {
+        const char *q;
+        char *end;
+
+        q = arg + sizeof("--quarantine=") - 1;
+        options->quarantine = (size_t)strtoul(q, &end, 10);
+        if ((*q < '0') || (*q > '9') || (*end != '\0'))
+        {
+            EXM_LOG_ERR("--quarantine option must be followed by a number of bytes");
+            return -1;
+        }
+    }
+    else if (strcmp(arg, "--no-poison") == 0)
+        options->poison = 0;
+    else if (strncmp(arg, "--num-callers=", sizeof("--num-callers=") - 1) == 0)
+    {
+        const char *nc;
+        char *end;
+
+        nc = arg + sizeof("--num-callers=") - 1;
+        options->num_callers = (unsigned int)strtoul(nc, &end, 10);
+        if ((*nc < '0') || (*nc > '9') || (*end != '\0'))
+        {
+            EXM_LOG_ERR("--num-callers option must be followed by a number of frames");
+            return -1;
+        }
+    }
+    else if (strncmp(arg, "--leak-limit=", sizeof("--leak-limit=") - 1) == 0)
+    {
+        const char *ll;
+        char *end;
+
+        ll = arg + sizeof("--leak-limit=") - 1;
+        options->leak_limit = (size_t)strtoul(ll, &end, 10);
+        if ((*ll < '0') || (*ll > '9') || (*end != '\0'))
+        {
+            EXM_LOG_ERR("--leak-limit option must be followed by a number of loss records");
+            return -1;
+        }
+    }
+    else if (strncmp(arg, "--suppressions=", sizeof("--suppressions=") - 1) == 0)
+    {
+        const char *file;
+        size_t l1;
+        size_t l2;
+
+        /* the files are separated as in PATH */
+        file = arg + sizeof("--suppressions=") - 1;
+        l1 = strlen(suppressions);
+        l2 = strlen(file);
+        if ((l2 == 0) || (l1 + l2 + 2 > suppressions_size))
+        {
+            EXM_LOG_ERR("--suppressions option must be followed by a file name");
+            return -1;
+        }
+        if (l1 > 0)
+        {
+#ifdef _WIN32
+            suppressions[l1++] = ';';
+#else
+            suppressions[l1++] = ':';
+#endif
+        }
+        memcpy(suppressions + l1, file, l2 + 1);
+    }
+    else if (strncmp(arg, "--gen-suppressions=", sizeof("--gen-suppressions=") - 1) == 0)
+    {
+        options->gen_suppressions = arg + sizeof("--gen-suppressions=") - 1;
+        if (*options->gen_suppressions == '\0')
+        {
+            EXM_LOG_ERR("--gen-suppressions option must be followed by a file name");
+            return -1;
+        }
+    }
+    else if (strncmp(arg, "--timeline=", sizeof("--timeline=") - 1) == 0)
+    {
+        options->timeline = arg + sizeof("--timeline=") - 1;
+        if (*options->timeline == '\0')
+        {
+            EXM_LOG_ERR("--timeline option must be followed by a file name");
+            return -1;
+        }
+    }
+    else
+        return 0;
+
+    return 1;
+}
+
 static int main2(int argc, char *argv[])
 {
     char buf_command[32768];
     char buf_args[32768];
+    char mc_suppressions[32768];
     char *module;
     Exm_List *options = NULL;
     int i;
@@ -102,7 +257,14 @@ static int main2(int argc, char *argv[])
     unsigned char quiet = 0;
     unsigned char depends_list = 0;
     unsigned char depends_gui = 0;
+    unsigned char depends_checksum = 0;
     unsigned char view_gui = 0;
+    unsigned char view_relocs = 0;
+    unsigned char view_checksum = 0;
+    unsigned char view_entropy = 0;
+    Exm_Mc_Options mc_options;
+    const char *mc_option = NULL;
+    int ret = 0;
 
     if (argc < 2)
     {
@@ -111,6 +273,9 @@ static int main2(int argc, char *argv[])
     }
 
     buf_args[0] = '\0';
+    mc_suppressions[0] = '\0';
+    memset(&mc_options, 0, sizeof(mc_options));
+    mc_options.poison = 1;
     for (i = 1; i < argc; i++)
     {
         if ((strcmp(argv[i], "-h") == 0) || (strcmp(argv[i], "--help") == 0))
@@ -235,34 +400,38 @@ static int main2(int argc, char *argv[])
                 {
                     tool = 2;
                     options = exm_list_append(options, _strdup(argv[i]));
-                    if ((i + 1) < argc)
+                    while ((i + 1) < argc)
                     {
                         if (strcmp(argv[i + 1], "--gui") == 0)
-                        {
                             depends_gui = 1;
-                            i++;
-                            options = exm_list_append(options, _strdup(argv[i]));
-                        }
                         else if (strcmp(argv[i + 1], "--list") == 0)
-                        {
                             depends_list = 1;
-                            i++;
-                            options = exm_list_append(options, _strdup(argv[i]));
-                        }
+                        else if (strcmp(argv[i + 1], "--verify-checksum") == 0)
+                            depends_checksum = 1;
+                        else
+                            break;
+                        i++;
+                        options = exm_list_append(options, _strdup(argv[i]));
                     }
                 }
                 else if (strcmp(argv[i], "--tool=view") == 0)
                 {
                     tool = 3;
                     options = exm_list_append(options, _strdup(argv[i]));
-                    if ((i + 1) < argc)
+                    while ((i + 1) < argc)
                     {
                         if (strcmp(argv[i + 1], "--gui") == 0)
-                        {
                             view_gui = 1;
-                            i++;
-                            options = exm_list_append(options, _strdup(argv[i]));
-                        }
+                        else if (strcmp(argv[i + 1], "--relocs") == 0)
+                            view_relocs = 1;
+                        else if (strcmp(argv[i + 1], "--verify-checksum") == 0)
+                            view_checksum = 1;
+                        else if (strcmp(argv[i + 1], "--entropy") == 0)
+                            view_entropy = 1;
+                        else
+                            break;
+                        i++;
+                        options = exm_list_append(options, _strdup(argv[i]));
                     }
                 }
                 else if (strcmp(argv[i], "--tool=sigcheck") == 0)
@@ -270,6 +439,11 @@ static int main2(int argc, char *argv[])
                     tool = 4;
                     options = exm_list_append(options, _strdup(argv[i]));
                 }
+                else if (strcmp(argv[i], "--tool=timeline") == 0)
+                {
+                    tool = 5;
+                    options = exm_list_append(options, _strdup(argv[i]));
+                }
                 else
                 {
                     _exm_usage();
@@ -282,7 +456,25 @@ static int main2(int argc, char *argv[])
         else
         {
             if (argv_idx == 0)
-                argv_idx = i;
+            {
+                int res;
+
+                /* memcheck is the default tool, its options do not need --tool */
+                res = _exm_mc_option_parse(argv[i], &mc_options, mc_suppressions, sizeof(mc_suppressions));
+                if (res < 0)
+                {
+                    _exm_usage();
+                    exm_list_free(options, free);
+                    return -1;
+                }
+                else if (res > 0)
+                {
+                    mc_option = argv[i];
+                    options = exm_list_append(options, _strdup(argv[i]));
+                }
+                else
+                    argv_idx = i;
+            }
             else
                 exm_str_append(buf_args, argv[i]);
         }
@@ -296,6 +488,14 @@ static int main2(int argc, char *argv[])
         return -1;
     }
 
+    if (mc_option && (tool != EXM_TOOL_MEMCHECK))
+    {
+        EXM_LOG_ERR("%s option requires --tool=memcheck", mc_option);
+        _exm_usage();
+        exm_list_free(options, free);
+        return -1;
+    }
+
     if ((verbose && quiet) ||
         (verbose && lvl) ||
         (lvl && quiet))
@@ -358,10 +558,13 @@ static int main2(int argc, char *argv[])
     {
         case EXM_TOOL_MEMCHECK:
         {
-#ifdef _WIN32
-            exm_mc_run(module, buf_args);
+#ifdef HAVE_MEMCHECK
+            if (*mc_suppressions)
+                mc_options.suppressions = mc_suppressions;
+            ret = exm_mc_run(module, buf_args, &mc_options);
 #else
-            EXM_LOG_ERR("memcheck tool not available on UNIX");
+            EXM_LOG_ERR("memcheck tool not available on this system");
+            ret = -1;
 #endif
             break;
         }
@@ -369,10 +572,10 @@ static int main2(int argc, char *argv[])
             exm_trace_run(module, buf_args);
             break;
         case EXM_TOOL_DEPENDS:
-            exm_depends_run(module, depends_list, depends_gui, log_level);
+            exm_depends_run(module, depends_list, depends_checksum, depends_gui, log_level);
             break;
         case EXM_TOOL_VIEW:
-            exm_view_run(module, view_gui, log_level);
+            exm_view_run(module, view_relocs, view_checksum, view_entropy, view_gui, log_level);
             break;
         case EXM_TOOL_SIGCHECK:
 #ifdef _WIN32
@@ -381,6 +584,9 @@ static int main2(int argc, char *argv[])
             EXM_LOG_ERR("sigcheck tool not available on UNIX");
 #endif
             break;
+        case EXM_TOOL_TIMELINE:
+            exm_timeline_run(module);
+            break;
         default:
             EXM_LOG_ERR("unknown tool");
             break;
@@ -389,7 +595,7 @@ static int main2(int argc, char *argv[])
 
     exm_shutdown();
 
-    return 0;
+    return ret;
 }
 
 int main(int argc, char *argv[])
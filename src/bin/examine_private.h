@@ -23,10 +23,30 @@
 #define EXAMINE_BIN_PRIVATE_H
 
 
-void exm_mc_run(const char *filename, char *args);
+typedef struct _Exm_Mc_Options Exm_Mc_Options;
+
+/*
+ * Options of the memcheck tool, the sizes and numbers are 0 when not
+ * set, and the file names NULL.
+ */
+struct _Exm_Mc_Options
+{
+    size_t sample_interval; /* mean interval in bytes between the sampled blocks */
+    const char *timeline; /* timeline file name */
+    size_t redzone; /* size in bytes of the redzones */
+    size_t quarantine; /* size in bytes of the quarantine */
+    unsigned char poison; /* fill the blocks with a pattern */
+    unsigned int num_callers; /* maximum number of frames of the stacks */
+    size_t leak_limit; /* maximum number of loss records displayed */
+    const char *suppressions; /* suppression file names, separated as in PATH */
+    const char *gen_suppressions; /* generated suppression file name */
+};
+
+int exm_mc_run(const char *filename, char *args, const Exm_Mc_Options *options);
+void exm_timeline_run(const char *filename);
 void exm_trace_run(const char *filename, char *args);
-void exm_depends_run(const char *filename, unsigned char display_list, unsigned char gui, Exm_Log_Level log_level);
-void exm_view_run(const char *filename, unsigned char gui, Exm_Log_Level log_level);
+void exm_depends_run(const char *filename, unsigned char display_list, unsigned char verify_checksum, unsigned char gui, Exm_Log_Level log_level);
+void exm_view_run(const char *filename, unsigned char display_relocs, unsigned char verify_checksum, unsigned char display_entropy, unsigned char gui, Exm_Log_Level log_level);
 void exm_sigcheck_run(const char *module, unsigned char gui, Exm_Log_Level log_level);
 
 
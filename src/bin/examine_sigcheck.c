@@ -55,10 +55,6 @@ typedef LONG (WINAPI *exm_WinVerifyTrust_t)(HWND   hWnd,
 typedef BOOL (WINAPI *exm_CryptCATAdminAcquireContext_t)(HCATADMIN  *phCatAdmin,
                                                          const GUID *pgSubsystem,
                                                          DWORD       dwFlags);
-typedef BOOL (WINAPI *exm_CryptCATAdminCalcHashFromFileHandle_t)(HANDLE hFile,
-                                                                 DWORD *pcbHash,
-                                                                 BYTE  *pbHash,
-                                                                 DWORD  dwFlags);
 typedef HCATINFO (WINAPI *exm_CryptCATAdminEnumCatalogFromHash_t)(HCATADMIN hCatAdmin,
                                                                   BYTE     *pbHash,
                                                                   DWORD     cbHash,
@@ -117,7 +113,6 @@ typedef DWORD (WINAPI *exm_CertGetNameStringW_t)(PCCERT_CONTEXT pCertContext,
 
 static exm_WinVerifyTrust_t exm_WinVerifyTrust;
 static exm_CryptCATAdminAcquireContext_t exm_CryptCATAdminAcquireContext;
-static exm_CryptCATAdminCalcHashFromFileHandle_t exm_CryptCATAdminCalcHashFromFileHandle;
 static exm_CryptCATAdminEnumCatalogFromHash_t exm_CryptCATAdminEnumCatalogFromHash;
 static exm_CryptCATCatalogInfoFromContext_t exm_CryptCATCatalogInfoFromContext;
 static exm_CryptCATAdminReleaseCatalogContext_t exm_CryptCATAdminReleaseCatalogContext;
@@ -186,59 +181,32 @@ _exm_sigcheck_signature_disp(const Exm_Pe *pe)
     CATALOG_INFO catalog_info;
     PWCHAR ufilename;
     PWCHAR member_tag;
-    HANDLE file;
     HCATADMIN context;
     HCATINFO cat_info;
-    BYTE *hash;
+    BYTE hash[EXM_SHA1_SIZE];
     DWORD hash_size;
     LONG res;
     GUID action = WINTRUST_ACTION_GENERIC_VERIFY_V2;
 
-    ufilename = _exm_char_to_wchar(exm_pe_filename_get(pe));
-    if (!ufilename)
+    /* the catalogs are indexed by the SHA-1 Authenticode digest */
+    if (!exm_pe_authenticode_digest_get(pe, hash, NULL))
     {
-        EXM_LOG_ERR("Can not allocate memory for the application file name");
+        EXM_LOG_ERR("Can not compute the hash of the application file");
         return;
     }
+    hash_size = sizeof(hash);
 
-    file = CreateFileW(ufilename, GENERIC_READ,
-                       FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
-                       NULL, OPEN_EXISTING, 0, NULL);
-    if (file == INVALID_HANDLE_VALUE)
+    ufilename = _exm_char_to_wchar(exm_pe_filename_get(pe));
+    if (!ufilename)
     {
-        EXM_LOG_ERR("CreateFileW() failed (0x%lx)", GetLastError());
-        goto free_filename;
+        EXM_LOG_ERR("Can not allocate memory for the application file name");
+        return;
     }
 
     if (!exm_CryptCATAdminAcquireContext(&context, NULL, 0))
     {
         EXM_LOG_ERR("CryptCATAdminAcquireContext() failed (0x%lx)", GetLastError());
-        goto close_file;
-    }
-
-    if (!exm_CryptCATAdminCalcHashFromFileHandle(file, &hash_size, NULL, 0))
-    {
-        EXM_LOG_ERR("CryptCATAdminCalcHashFromFileHandle() failed (0x%lx)", GetLastError());
-        goto release_context;
-    }
-
-    if (hash_size == 0)
-    {
-        EXM_LOG_ERR("Hash size is insufficient");
-        goto release_context;
-    }
-
-    hash = (BYTE *)calloc(hash_size, 1);
-    if (!hash)
-    {
-        EXM_LOG_ERR("Can not allocate memory for the hash");
-        goto release_context;
-    }
-
-    if (!exm_CryptCATAdminCalcHashFromFileHandle(file, &hash_size, hash, 0))
-    {
-        EXM_LOG_ERR("CryptCATAdminCalcHashFromFileHandle() failed (0x%lx)", GetLastError());
-        goto free_hash;
+        goto free_filename;
     }
 
     memset(&catalog_info, 0, sizeof(CATALOG_INFO));
@@ -376,12 +344,8 @@ _exm_sigcheck_signature_disp(const Exm_Pe *pe)
   release_cat_info:
     if (cat_info)
         exm_CryptCATAdminReleaseCatalogContext(context, cat_info, 0);
-  free_hash:
-    free(hash);
   release_context:
     exm_CryptCATAdminReleaseContext(context, 0);
-  close_file:
-    CloseHandle(file);
   free_filename:
     free(ufilename);
 }
@@ -870,48 +834,20 @@ _exm_sigcheck_certificate_disp(const CERT_CONTEXT *cert_context)
 }
 
 static void
-_exm_sigcheck_cmd_version_info_tag_disp(const wchar_t *version_info,
-                                        DWORD size,
-                                        const wchar_t *tag)
+_exm_sigcheck_cmd_version_info_tag_disp(const Exm_Pe_Version_Info *info,
+                                        const char *key)
 {
-    const wchar_t *str;
-    size_t l;
-    size_t i;
-    char found = 0;
-
-    l = wcslen(tag);
-    i = 0;
-    str = version_info;
-    while (i < (size - l))
-    {
-        const wchar_t *substr;
-        size_t j;
-
-        substr = str;
-        found = 1;
-        for (j = 0; j < l; j++, substr++)
-        {
-            if (*substr != tag[j])
-            {
-                found = 0;
-                break;
-            }
-        }
-        if (found)
-        {
-            str += l;
-            break;
-        }
-        str++;
-        i++;
-    }
+    Exm_Pe_Version_String str;
+    char buf[1024];
 
-    if (found)
+    if (!info || !exm_pe_version_info_string_get(info, key, &str))
     {
-        /* possible multiple nul characters */
-        while (*str == L'\0') str++;
-        wprintf(L"%s", str);
+        printf("None");
+        return;
     }
+
+    exm_pe_string_utf8_get(str.value, str.value_length, buf, sizeof(buf));
+    printf("%s", buf);
 }
 
 static void
@@ -940,58 +876,30 @@ _exm_sigcheck_cmd_run(const Exm_Pe *pe)
     else if (exm_pe_is_64bits(pe) == 0)
         printf("        Machine type:       32-bit\n");
     {
-        const wchar_t *data;
-        DWORD size;
+        Exm_Pe_Version_Info info;
+        const Exm_Pe_Version_Info *data;
 
-        data = (wchar_t *)exm_pe_resource_data_get(pe, 16, &size);
+        data = exm_pe_version_info_get(pe, &info) ? &info : NULL;
         printf("        Company name:       ");
-        if (data)
-            _exm_sigcheck_cmd_version_info_tag_disp(data, size,
-                                                    L"CompanyName");
-        else
-            printf("None");
+        _exm_sigcheck_cmd_version_info_tag_disp(data, "CompanyName");
         printf("\n");
         printf("        File Description:   ");
-        if (data)
-            _exm_sigcheck_cmd_version_info_tag_disp(data, size,
-                                                    L"FileDescription");
-        else
-            printf("None");
+        _exm_sigcheck_cmd_version_info_tag_disp(data, "FileDescription");
         printf("\n");
         printf("        File Version:       ");
-        if (data)
-            _exm_sigcheck_cmd_version_info_tag_disp(data, size,
-                                                    L"FileVersion");
-        else
-            printf("None");
+        _exm_sigcheck_cmd_version_info_tag_disp(data, "FileVersion");
         printf("\n");
         printf("        Internal name:      ");
-        if (data)
-            _exm_sigcheck_cmd_version_info_tag_disp(data, size,
-                                                    L"InternalName");
-        else
-            printf("None");
+        _exm_sigcheck_cmd_version_info_tag_disp(data, "InternalName");
         printf("\n");
         printf("        Copyright:          ");
-        if (data)
-            _exm_sigcheck_cmd_version_info_tag_disp(data, size,
-                                                    L"LegalCopyright");
-        else
-            printf("None");
+        _exm_sigcheck_cmd_version_info_tag_disp(data, "LegalCopyright");
         printf("\n");
         printf("        Original file name: ");
-        if (data)
-            _exm_sigcheck_cmd_version_info_tag_disp(data, size,
-                                                    L"OriginalFilename");
-        else
-            printf("None");
+        _exm_sigcheck_cmd_version_info_tag_disp(data, "OriginalFilename");
         printf("\n");
         printf("        Product name:       ");
-        if (data)
-            _exm_sigcheck_cmd_version_info_tag_disp(data, size,
-                                                    L"ProductName");
-        else
-            printf("None");
+        _exm_sigcheck_cmd_version_info_tag_disp(data, "ProductName");
         printf("\n");
     }
 }
@@ -1023,7 +931,6 @@ exm_sigcheck_run(const char *module, unsigned char gui, Exm_Log_Level log_level)
 
     EXM_SIGCHECK_LOAD_SYM(mod_wintrust, WinVerifyTrust);
     EXM_SIGCHECK_LOAD_SYM(mod_wintrust ,CryptCATAdminAcquireContext);
-    EXM_SIGCHECK_LOAD_SYM(mod_wintrust, CryptCATAdminCalcHashFromFileHandle);
     EXM_SIGCHECK_LOAD_SYM(mod_wintrust ,CryptCATAdminEnumCatalogFromHash);
     EXM_SIGCHECK_LOAD_SYM(mod_wintrust ,CryptCATCatalogInfoFromContext);
     EXM_SIGCHECK_LOAD_SYM(mod_wintrust ,CryptCATAdminReleaseCatalogContext);
@@ -1031,7 +938,6 @@ exm_sigcheck_run(const char *module, unsigned char gui, Exm_Log_Level log_level)
 
     if (!exm_WinVerifyTrust ||
         !exm_CryptCATAdminAcquireContext ||
-        !exm_CryptCATAdminCalcHashFromFileHandle ||
         !exm_CryptCATAdminEnumCatalogFromHash ||
         !exm_CryptCATCatalogInfoFromContext ||
         !exm_CryptCATAdminReleaseCatalogContext ||
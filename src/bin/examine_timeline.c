@@ -0,0 +1,365 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2016 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <Examine.h>
+
+#include "examine_private.h"
+
+#ifdef _WIN32
+# define FMT_ULL "%I64u"
+#else
+# define FMT_ULL "%llu"
+#endif
+
+#define EXM_TIMELINE_GRAPH_WIDTH 72
+#define EXM_TIMELINE_GRAPH_HEIGHT 20
+
+
+/*============================================================================*
+ *                                  Local                                     *
+ *============================================================================*/
+
+
+/*
+ * The tree of the peak snapshot merges the stacks of its sites from
+ * the allocation function to the main function, like the one of
+ * ms_print.
+ */
+typedef struct _Exm_Timeline_Node Exm_Timeline_Node;
+
+struct _Exm_Timeline_Node
+{
+    const Exm_Timeline_Frame *frame; /* NULL for the root */
+    unsigned long long bytes;
+    Exm_Timeline_Node **children;
+    unsigned int children_nbr;
+};
+
+static const Exm_Timeline_Frame _exm_timeline_frame_unknown = { "???", "???", 0 };
+
+static const char *
+_exm_timeline_unit_get(unsigned long long max, double *div)
+{
+    if (max >= (1ULL << 30))
+    {
+        *div = (double)(1ULL << 30);
+        return "GB";
+    }
+    else if (max >= (1ULL << 20))
+    {
+        *div = (double)(1ULL << 20);
+        return "MB";
+    }
+    else if (max >= (1ULL << 10))
+    {
+        *div = (double)(1ULL << 10);
+        return "KB";
+    }
+
+    *div = 1.0;
+    return "B";
+}
+
+/*
+ * Each column shows the largest snapshot taken during its time, or
+ * the previous column when there is none. The column of the peak is
+ * drawn with '#'.
+ */
+static void
+_exm_timeline_graph_disp(const Exm_Timeline_Snapshot *snapshots, unsigned int nbr, const Exm_Timeline_Snapshot *peak)
+{
+    unsigned long long columns[EXM_TIMELINE_GRAPH_WIDTH];
+    unsigned char set[EXM_TIMELINE_GRAPH_WIDTH];
+    unsigned long long time_max;
+    const char *unit_y;
+    const char *unit_x;
+    double div_y;
+    double div_x;
+    unsigned int peak_column;
+    unsigned int i;
+    int row;
+
+    time_max = snapshots[nbr - 1].time;
+    if (time_max == 0)
+        time_max = 1;
+
+    memset(columns, 0, sizeof(columns));
+    memset(set, 0, sizeof(set));
+    peak_column = 0;
+    for (i = 0; i < nbr; i++)
+    {
+        unsigned int c;
+
+        c = (unsigned int)((double)snapshots[i].time * (EXM_TIMELINE_GRAPH_WIDTH - 1) / (double)time_max);
+        if (!set[c] || (snapshots[i].bytes > columns[c]))
+            columns[c] = snapshots[i].bytes;
+        set[c] = 1;
+        if (snapshots + i == peak)
+            peak_column = c;
+    }
+
+    for (i = 1; i < EXM_TIMELINE_GRAPH_WIDTH; i++)
+    {
+        if (!set[i])
+            columns[i] = columns[i - 1];
+    }
+
+    unit_y = _exm_timeline_unit_get(peak->bytes, &div_y);
+    unit_x = _exm_timeline_unit_get(time_max, &div_x);
+
+    printf("%8s\n", unit_y);
+    for (row = EXM_TIMELINE_GRAPH_HEIGHT; row > 0; row--)
+    {
+        if (row == EXM_TIMELINE_GRAPH_HEIGHT)
+            printf("%8.2f^", (double)peak->bytes / div_y);
+        else
+            printf("%8s|", "");
+
+        for (i = 0; i < EXM_TIMELINE_GRAPH_WIDTH; i++)
+        {
+            unsigned long long h;
+
+            /* a column with live bytes is at least one row high */
+            h = 0;
+            if (peak->bytes)
+                h = (columns[i] * EXM_TIMELINE_GRAPH_HEIGHT + peak->bytes - 1) / peak->bytes;
+            if (h >= (unsigned long long)row)
+                putchar((i == peak_column) ? '#' : ':');
+            else
+                putchar(' ');
+        }
+        printf("\n");
+    }
+
+    printf("%8s+", "0");
+    for (i = 0; i < EXM_TIMELINE_GRAPH_WIDTH; i++)
+        putchar('-');
+    printf(">%s\n", unit_x);
+    printf("%8s0%*.2f\n", "", EXM_TIMELINE_GRAPH_WIDTH, (double)time_max / div_x);
+    printf("%8s(time: bytes allocated)\n", "");
+}
+
+static unsigned char
+_exm_timeline_frame_eq(const Exm_Timeline_Frame *f1, const Exm_Timeline_Frame *f2)
+{
+    return ((f1->line == f2->line) &&
+            (strcmp(f1->function, f2->function) == 0) &&
+            (strcmp(f1->filename, f2->filename) == 0));
+}
+
+static Exm_Timeline_Node *
+_exm_timeline_node_child_get(Exm_Timeline_Node *node, const Exm_Timeline_Frame *frame)
+{
+    Exm_Timeline_Node **children;
+    Exm_Timeline_Node *child;
+    unsigned int i;
+
+    for (i = 0; i < node->children_nbr; i++)
+    {
+        if (_exm_timeline_frame_eq(node->children[i]->frame, frame))
+            return node->children[i];
+    }
+
+    child = (Exm_Timeline_Node *)calloc(1, sizeof(Exm_Timeline_Node));
+    if (!child)
+        return NULL;
+
+    children = (Exm_Timeline_Node **)realloc(node->children,
+                                             (node->children_nbr + 1) * sizeof(Exm_Timeline_Node *));
+    if (!children)
+    {
+        free(child);
+        return NULL;
+    }
+
+    child->frame = frame;
+    node->children = children;
+    node->children[node->children_nbr++] = child;
+
+    return child;
+}
+
+static void
+_exm_timeline_node_free(Exm_Timeline_Node *node)
+{
+    unsigned int i;
+
+    for (i = 0; i < node->children_nbr; i++)
+        _exm_timeline_node_free(node->children[i]);
+    free(node->children);
+    free(node);
+}
+
+static int
+_exm_timeline_node_cmp(const void *d1, const void *d2)
+{
+    const Exm_Timeline_Node *n1 = *(const Exm_Timeline_Node * const *)d1;
+    const Exm_Timeline_Node *n2 = *(const Exm_Timeline_Node * const *)d2;
+
+    /* largest first */
+    if (n1->bytes < n2->bytes)
+        return 1;
+    else if (n1->bytes > n2->bytes)
+        return -1;
+    else
+        return 0;
+}
+
+static void
+_exm_timeline_node_disp(Exm_Timeline_Node *node, char *prefix, size_t prefix_len, unsigned long long total)
+{
+    unsigned int i;
+
+    qsort(node->children, node->children_nbr, sizeof(Exm_Timeline_Node *),
+          _exm_timeline_node_cmp);
+
+    for (i = 0; i < node->children_nbr; i++)
+    {
+        const Exm_Timeline_Node *child = node->children[i];
+
+        printf("%s->%05.2f%% (" FMT_ULL "B) %s (%s:%u)\n",
+               prefix, 100.0 * (double)child->bytes / (double)total, child->bytes,
+               child->frame->function, child->frame->filename, child->frame->line);
+
+        /* the stacks are at most EXM_HOOK_STACK_FRAMES_MAX frames deep */
+        if (prefix_len + 3 < 512)
+        {
+            memcpy(prefix + prefix_len, (i + 1 < node->children_nbr) ? "| " : "  ", 3);
+            _exm_timeline_node_disp(node->children[i], prefix, prefix_len + 2, total);
+            prefix[prefix_len] = '\0';
+        }
+
+        if ((i + 1 < node->children_nbr) && (node->children[i]->children_nbr > 0))
+            printf("%s|\n", prefix);
+    }
+}
+
+static void
+_exm_timeline_peak_disp(const Exm_Timeline_File *file, const Exm_Timeline_Snapshot *peak)
+{
+    Exm_Timeline_Node *root;
+    unsigned long long bytes;
+    char prefix[512];
+    unsigned int i;
+
+    printf("Peak snapshot: " FMT_ULL " bytes in " FMT_ULL " blocks, after " FMT_ULL " bytes allocated\n",
+           peak->bytes, peak->blocks, peak->time);
+    printf("\n");
+
+    if (peak->bytes == 0)
+        return;
+
+    root = (Exm_Timeline_Node *)calloc(1, sizeof(Exm_Timeline_Node));
+    if (!root)
+        return;
+
+    bytes = 0;
+    for (i = 0; i < peak->sites_nbr; i++)
+    {
+        const Exm_Timeline_Site *site = peak->sites + i;
+        const Exm_Timeline_Frame *frames;
+        Exm_Timeline_Node *node;
+        unsigned int frames_nbr;
+        unsigned int j;
+
+        bytes += site->bytes;
+        frames = exm_timeline_file_frames_get(file, site->stack, &frames_nbr);
+        if (frames_nbr == 0)
+        {
+            frames = &_exm_timeline_frame_unknown;
+            frames_nbr = 1;
+        }
+
+        node = root;
+        for (j = 0; (j < frames_nbr) && node; j++)
+        {
+            node = _exm_timeline_node_child_get(node, frames + j);
+            if (node)
+                node->bytes += site->bytes;
+        }
+    }
+
+    printf("100.00%% (" FMT_ULL "B) live heap, in %u allocation site(s)\n",
+           peak->bytes, peak->sites_live);
+    prefix[0] = '\0';
+    _exm_timeline_node_disp(root, prefix, 0, peak->bytes);
+    if ((peak->sites_live > peak->sites_nbr) && (peak->bytes > bytes))
+        printf("->%05.2f%% (" FMT_ULL "B) in %u other site(s)\n",
+               100.0 * (double)(peak->bytes - bytes) / (double)peak->bytes,
+               peak->bytes - bytes, peak->sites_live - peak->sites_nbr);
+    printf("\n");
+
+    _exm_timeline_node_free(root);
+}
+
+
+/*============================================================================*
+ *                                 Global                                     *
+ *============================================================================*/
+
+
+void
+exm_timeline_run(const char *filename)
+{
+    Exm_Timeline_File *file;
+    const Exm_Timeline_Snapshot *snapshots;
+    const Exm_Timeline_Snapshot *peak;
+    unsigned int nbr;
+
+    file = exm_timeline_file_new(filename);
+    if (!file)
+        return;
+
+    snapshots = exm_timeline_file_snapshots_get(file, &nbr);
+    peak = exm_timeline_file_peak_get(file);
+    if (!peak)
+    {
+        EXM_LOG_ERR("No snapshot in %s", filename);
+        exm_timeline_file_free(file);
+        return;
+    }
+
+    printf("Live heap of the timeline %s\n", filename);
+    if (exm_timeline_file_sample_interval_get(file))
+        printf("estimated from 1 block sampled every %lu bytes on average\n",
+               (unsigned long)exm_timeline_file_sample_interval_get(file));
+    printf("\n");
+
+    _exm_timeline_graph_disp(snapshots, nbr, peak);
+
+    printf("\n");
+    printf("Number of snapshots: %u\n", nbr);
+    printf("\n");
+
+    _exm_timeline_peak_disp(file, peak);
+
+    exm_timeline_file_free(file);
+
+    EXM_LOG_DBG("resources freed");
+}
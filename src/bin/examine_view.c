@@ -26,7 +26,6 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <wchar.h>
 
 #ifdef _WIN32
 # ifndef WIN32_LEAN_AND_MEAN
@@ -389,6 +388,45 @@ _exm_view_cmd_sections_display(Exm_Pe *pe)
     }
 }
 
+static double
+_exm_view_entropy_get(const void *data, DWORD size)
+{
+    Exm_Pe_Histogram histogram;
+
+    memset(&histogram, 0, sizeof(histogram));
+    exm_pe_histogram_add(data, size, &histogram);
+
+    return exm_pe_histogram_entropy_get(&histogram);
+}
+
+static void
+_exm_view_cmd_entropy_display(Exm_Pe *pe)
+{
+    const IMAGE_NT_HEADERS *nt_header;
+    const IMAGE_SECTION_HEADER *iter;
+    const void *data;
+    DWORD size;
+    WORD i;
+
+    printf("Entropy (bits per byte)\n");
+    printf("  section   raw size    entropy\n");
+
+    nt_header = exm_pe_nt_header_get(pe);
+    iter = IMAGE_FIRST_SECTION(nt_header);
+    for (i = 0; i < nt_header->FileHeader.NumberOfSections; i++, iter++)
+    {
+        data = exm_pe_section_raw_data_get(pe, iter, &size);
+        printf("  %-8s  0x%08lx  %.3f\n",
+               exm_pe_section_name_get(pe, iter), (unsigned long)size,
+               _exm_view_entropy_get(data, size));
+    }
+
+    data = exm_pe_overlay_get(pe, &size);
+    if (data)
+        printf("  %-8s  0x%08lx  %.3f\n",
+               "overlay", (unsigned long)size, _exm_view_entropy_get(data, size));
+}
+
 static void
 _exm_view_cmd_directory_entry_export_display(Exm_Pe *pe)
 {
@@ -453,193 +491,382 @@ _exm_view_cmd_directory_entry_import_display(Exm_Pe *pe)
     printf("  FirstThunk            DWORD   0x" FMT_DWDX "\n", import_desc->FirstThunk);
 }
 
+static const char *
+_exm_view_cmd_directory_entry_resource_type_get(WORD type)
+{
+    switch (type)
+    {
+        case 1: /* RT_CURSOR */
+            return "cursor";
+        case 2: /* RT_BITMAP */
+            return "bitmap";
+        case 3: /* RT_ICON */
+            return "icon";
+        case 4: /* RT_MENU */
+            return "menu";
+        case 5: /* RT_DIALOG */
+            return "dialog";
+        case 6: /* RT_STRING */
+            return "string table";
+        case 7: /* RT_FONTDIR */
+            return "font directory";
+        case 8: /* RT_FONT */
+            return "font";
+        case 9: /* RT_ACCELERATOR */
+            return "accelerator";
+        case 10: /* RT_RCDATA */
+            return "rc data";
+        case 11: /* RT_MESSAGETABLE */
+            return "message table";
+        case 12: /* RT_GROUP_CURSOR */
+            return "group cursor";
+        case 14: /* RT_GROUP_ICON */
+            return "group icon";
+        case 16: /* RT_VERSION */
+            return "version";
+        case 17: /* RT_DLGINCLUDE */
+            return "dgl include";
+        case 19: /* RT_PLUGPLAY */
+            return "PnP";
+        case 20: /* RT_VXD */
+            return "VXD";
+        case 21: /* RT_ANICURSOR */
+            return "animated cursor";
+        case 22: /* RT_ANIICON */
+            return "animated icon";
+        case 23: /* RT_HTML */
+            return "HTML";
+        case 24: /* RT_MANIFEST */
+            return "Manifest";
+        default:
+            return NULL;
+    }
+}
+
 static void
-_exm_view_cmd_directory_entry_resource_dump(const Exm_Pe *pe,
-                                            const unsigned char *base,
-                                            const IMAGE_RESOURCE_DIRECTORY *resource_dir,
-                                            const IMAGE_RESOURCE_DIRECTORY_ENTRY *parent,
-                                            int spaces);
+_exm_view_cmd_directory_entry_resource_name_get(const IMAGE_RESOURCE_DIR_STRING_U *str,
+                                                WORD id,
+                                                char *buf,
+                                                size_t size)
+{
+    if (str)
+        exm_pe_string_utf8_get(str->NameString, str->Length, buf, size);
+    else
+        snprintf(buf, size, "%u", id);
+}
 
 static void
-_exm_view_cmd_directory_entry_resource_name_get(const unsigned char *base,
-                                                const IMAGE_RESOURCE_DIRECTORY_ENTRY *entry,
-                                                wchar_t *buf)
+_exm_view_cmd_version_info_display(Exm_Pe *pe)
 {
-    if (entry->NameIsString)
+    Exm_Pe_Version_Info info;
+    Exm_Pe_Version_String str;
+    char key[256];
+    char value[1024];
+    DWORD offset;
+    DWORD i;
+
+    if (!exm_pe_version_info_get(pe, &info))
+        return;
+
+    printf("\n");
+    printf("Directory entry Resource - Version Information\n");
+    if (info.fixed)
     {
-        IMAGE_RESOURCE_DIR_STRING_U *str;
+        printf("  FileVersion     %u.%u.%u.%u\n",
+               (unsigned int)(info.fixed->dwFileVersionMS >> 16),
+               (unsigned int)(info.fixed->dwFileVersionMS & 0xffff),
+               (unsigned int)(info.fixed->dwFileVersionLS >> 16),
+               (unsigned int)(info.fixed->dwFileVersionLS & 0xffff));
+        printf("  ProductVersion  %u.%u.%u.%u\n",
+               (unsigned int)(info.fixed->dwProductVersionMS >> 16),
+               (unsigned int)(info.fixed->dwProductVersionMS & 0xffff),
+               (unsigned int)(info.fixed->dwProductVersionLS >> 16),
+               (unsigned int)(info.fixed->dwProductVersionLS & 0xffff));
+        printf("  FileFlags       0x" FMT_DWDX "\n", info.fixed->dwFileFlags);
+        printf("  FileOS          0x" FMT_DWDX "\n", info.fixed->dwFileOS);
+        printf("  FileType        0x" FMT_DWDX "\n", info.fixed->dwFileType);
+    }
+    for (i = 0; i < info.translations_count; i++)
+        printf("  Translation     0x%04x 0x%04x\n",
+               (unsigned int)(info.translations[i] & 0xffff),
+               (unsigned int)(info.translations[i] >> 16));
 
-        str = (IMAGE_RESOURCE_DIR_STRING_U *)(base + entry->NameOffset);
-        wmemcpy(buf, str->NameString, str->Length);
-        buf[str->Length] = 0;
+    if (info.language)
+    {
+        exm_pe_string_utf8_get(info.language, info.language_length, key, sizeof(key));
+        printf("  StringTable     %s\n", key);
     }
-    else
+
+    offset = 0;
+    while (exm_pe_version_info_string_next(&info, &offset, &str))
     {
-        switch (entry->Id)
-        {
-            case 1: /* RT_CURSOR */
-                wcscpy(buf, L"cursor");
-                break;
-            case 2: /* RT_BITMAP */
-                wcscpy(buf, L"bitmap");
-                break;
-            case 3: /* RT_ICON */
-                wcscpy(buf, L"icon");
-                break;
-            case 4: /* RT_MENU */
-                wcscpy(buf, L"menu");
-                break;
-            case 5: /* RT_DIALOG */
-                wcscpy(buf, L"dialog");
-                break;
-            case 6: /* RT_STRING, string table */
-                wcscpy(buf, L"string table");
-                break;
-            case 7: /* RT_FONTDIR */
-                wcscpy(buf, L"font directory");
-                break;
-            case 8: /* RT_FONT */
-                wcscpy(buf, L"font");
-                break;
-            case 9: /* RT_ACCELERATOR */
-                wcscpy(buf, L"accelerator");
-                break;
-            case 10: /* RT_RCDATA */
-                wcscpy(buf, L"rc data");
-                break;
-            case 11: /* RT_MESSAGETABLE */
-                wcscpy(buf, L"message table");
-                break;
-            case 12: /* RT_GROUP_CURSOR */
-                wcscpy(buf, L"group cursor");
-                break;
-            case 14: /* RT_GROUP_ICON */
-                wcscpy(buf, L"group icon");
-                break;
-            case 16: /* RT_VERSION */
-                wcscpy(buf, L"version");
-                break;
-            case 17: /* RT_DLGINCLUDE */
-                wcscpy(buf, L"dgl include");
-                break;
-            case 19: /* RT_PLUGPLAY */
-                wcscpy(buf, L"PnP");
-                break;
-            case 20: /* RT_VXD */
-                wcscpy(buf, L"VXD");
-                break;
-            case 21: /* RT_ANICURSOR */
-                wcscpy(buf, L"animated cursor");
-                break;
-            case 22: /* RT_ANIICON */
-                wcscpy(buf, L"animated icon");
-                break;
-            case 23: /* RT_HTML */
-                wcscpy(buf, L"HTML");
-                break;
-            case 24: /* RT_MANIFEST */
-                wcscpy(buf, L"Manifest");
-                break;
-            default:
-                swprintf(buf, 256, L"Unknown (%u)", entry->Id);
-                break;
-        }
+        exm_pe_string_utf8_get(str.key, str.key_length, key, sizeof(key));
+        exm_pe_string_utf8_get(str.value, str.value_length, value, sizeof(value));
+        printf("  %-16s%s\n", key, value);
     }
 }
 
 static void
-_exm_view_cmd_directory_entry_resource_entry_dump(const Exm_Pe *pe,
-                                                  const unsigned char *base,
-                                                  const IMAGE_RESOURCE_DIRECTORY_ENTRY *entry,
-                                                  int level)
+_exm_view_cmd_directory_entry_resource_display(Exm_Pe *pe)
 {
-    char str_spaces[128];
-    const IMAGE_RESOURCE_DATA_ENTRY *data;
-    int i;
+    const IMAGE_RESOURCE_DIRECTORY *resource_dir;
+    const IMAGE_DATA_DIRECTORY *data_dir;
+    const Exm_Pe_Resource *resources;
+    DWORD count;
+    DWORD i;
 
-    if (entry->DataIsDirectory)
-    {
-        _exm_view_cmd_directory_entry_resource_dump(pe, base,
-                                                    (const IMAGE_RESOURCE_DIRECTORY *)(base + entry->OffsetToDirectory), entry, level);
+    data_dir = exm_pe_data_directory_get(pe, IMAGE_DIRECTORY_ENTRY_RESOURCE);
+
+    printf("Directory entry Resource - Image Data Directory\n");
+    printf("  field           type    value\n");
+    printf("  VirtualAddress  DWORD   0x" FMT_DWDX "\n", data_dir->VirtualAddress);
+    printf("  Size            DWORD   0x" FMT_DWDX "\n", data_dir->Size);
+
+    resource_dir = exm_pe_resource_directory_get(pe, NULL);
+    if (!resource_dir)
         return;
-    }
 
-    for (i = 0; i < (2 * level); i++)
-        str_spaces[i]=' ';
-    str_spaces[i] = '\0';
+    printf("\n");
+    printf("Directory entry Resource - Image Resource Directory\n");
+    printf("  field                 type    value\n");
+    printf("  Characteristics       DWORD   0x" FMT_DWDX "\n", resource_dir->Characteristics);
+    printf("  TimeDateStamp         DWORD   0x" FMT_DWDX "\n", resource_dir->TimeDateStamp);
+    printf("  MajorVersion          WORD    %u\n", resource_dir->MajorVersion);
+    printf("  MinorVersion          WORD    %u\n", resource_dir->MinorVersion);
+    printf("  NumberOfNamedEntries  WORD    %u\n", resource_dir->NumberOfNamedEntries);
+    printf("  NumberOfIdEntries     WORD    %u\n", resource_dir->NumberOfIdEntries);
+
+    resources = exm_pe_resources_get(pe, &count);
+    if (!resources)
+        return;
+
+    printf("\n");
+    printf("Directory entry Resource - Resources (%lu)\n", (unsigned long)count);
+    printf("  %-20s %-20s Language  OffsetToData  Size      CodePage\n", "Type", "Name");
+    for (i = 0; i < count; i++)
+    {
+        char type[256];
+        char name[256];
+        const char *type_name;
+
+        type_name = resources[i].type_str ? NULL : _exm_view_cmd_directory_entry_resource_type_get(resources[i].type);
+        if (type_name)
+            snprintf(type, sizeof(type), "%s", type_name);
+        else
+            _exm_view_cmd_directory_entry_resource_name_get(resources[i].type_str, resources[i].type, type, sizeof(type));
+        _exm_view_cmd_directory_entry_resource_name_get(resources[i].name_str, resources[i].id, name, sizeof(name));
+        printf("  %-20s %-20s %-8u  0x%-10lx  %-8lu  %lu\n",
+               type, name, resources[i].language,
+               (unsigned long)resources[i].rva,
+               (unsigned long)resources[i].size,
+               (unsigned long)resources[i].codepage);
+    }
 
-    data = (const IMAGE_RESOURCE_DATA_ENTRY *)(base + entry->OffsetToData);
-    printf("%s  OffsetToData        DWORD   0x" FMT_DWDX "\n", str_spaces, data->OffsetToData);
-    printf("%s  Size                DWORD   %lu\n", str_spaces, data->Size);
-    printf("%s  CodePage            DWORD   0x" FMT_DWDX "\n", str_spaces, data->CodePage);
+    _exm_view_cmd_version_info_display(pe);
 }
 
 static void
-_exm_view_cmd_directory_entry_resource_dump(const Exm_Pe *pe,
-                                            const unsigned char *base,
-                                            const IMAGE_RESOURCE_DIRECTORY *resource_dir,
-                                            const IMAGE_RESOURCE_DIRECTORY_ENTRY *parent,
-                                            int level)
+_exm_view_cmd_directory_entry_exception_display(Exm_Pe *pe)
 {
-    wchar_t buf[256];
-    char str_spaces[128];
-    const IMAGE_RESOURCE_DIRECTORY_ENTRY *entry;
+    const IMAGE_RUNTIME_FUNCTION_ENTRY *functions;
+    const IMAGE_DATA_DIRECTORY *data_dir;
+    DWORD count;
     DWORD i;
 
-    for (i = 0; i < (DWORD)(2 * level); i++)
-        str_spaces[i] = ' ';
-    str_spaces[i] = 0;
+    data_dir = exm_pe_data_directory_get(pe, IMAGE_DIRECTORY_ENTRY_EXCEPTION);
+
+    printf("Directory entry Exception - Image Data Directory\n");
+    printf("  field           type    value\n");
+    printf("  VirtualAddress  DWORD   0x" FMT_DWDX "\n", data_dir->VirtualAddress);
+    printf("  Size            DWORD   0x" FMT_DWDX "\n", data_dir->Size);
+
+    functions = exm_pe_runtime_functions_get(pe, &count);
+    if (!functions)
+        return;
 
     printf("\n");
-    printf("%sDirectory entry Resource - Image Resource Directory (level: %d)\n",
-           str_spaces, level);
-    printf("%s  field                 type    value\n", str_spaces);
-    printf("%s  Characteristics       DWORD   0x" FMT_DWDX "\n", str_spaces, resource_dir->Characteristics);
-    printf("%s  TimeDateStamp         DWORD   0x" FMT_DWDX "\n", str_spaces, resource_dir->TimeDateStamp);
-    printf("%s  MajorVersion          WORD    %u\n", str_spaces, resource_dir->MajorVersion);
-    printf("%s  MinorVersion          WORD    %u\n", str_spaces, resource_dir->MinorVersion);
-    printf("%s  NumberOfNamedEntries  WORD    %u\n", str_spaces, resource_dir->NumberOfNamedEntries);
-    printf("%s  NumberOfIdEntries     WORD    %u\n", str_spaces, resource_dir->NumberOfIdEntries);
-
-    if (parent)
+    printf("Directory entry Exception - Runtime Functions (%lu)\n", (unsigned long)count);
+    printf("  Begin     End       UnwindData  Prolog  Codes  Frame  Flags\n");
+    for (i = 0; i < count; i++)
     {
-        printf("%s  Id                    WORD    %u (0x%x)", str_spaces, parent->Id, parent->Id);
-        _exm_view_cmd_directory_entry_resource_name_get(base, parent, buf);
-        wprintf(L"       Name: %s\n", buf);
+        Exm_Pe_Unwind_Info info;
 
+        printf("  0x" FMT_DWDX "    0x" FMT_DWDX "    0x" FMT_DWDX,
+               functions[i].BeginAddress,
+               functions[i].EndAddress,
+               functions[i].UnwindData);
+        if (!exm_pe_unwind_info_get(pe, functions + i, &info))
+        {
+            printf("  (invalid unwind information)\n");
+            continue;
+        }
 
-        printf("%s  OffsetToData          DWORD   0x" FMT_DWDX " (is dir: %s)\n",
-               str_spaces, parent->OffsetToData, parent->DataIsDirectory ? "yes" : "no");
+        if (info.codes)
+            printf("  %6u  %5u  %5u",
+                   info.prolog_size, info.codes_count, info.frame_register);
+        else
+            printf("                       ");
+        if (info.flags & EXM_PE_UNW_FLAG_EHANDLER)
+            printf(" EHANDLER");
+        if (info.flags & EXM_PE_UNW_FLAG_UHANDLER)
+            printf(" UHANDLER");
+        if (info.flags & EXM_PE_UNW_FLAG_CHAININFO)
+            printf(" CHAININFO");
+        if (info.flags & (EXM_PE_UNW_FLAG_EHANDLER | EXM_PE_UNW_FLAG_UHANDLER))
+            printf(" handler 0x" FMT_DWDX, info.handler);
+        if (info.chained)
+            printf(" part of 0x" FMT_DWDX,
+                   exm_pe_runtime_function_primary_get(pe, functions + i)->BeginAddress);
+        printf("\n");
     }
+}
 
-    entry = (const IMAGE_RESOURCE_DIRECTORY_ENTRY *)(resource_dir + 1);
-    for (i = 0; i < (resource_dir->NumberOfNamedEntries + resource_dir->NumberOfIdEntries); i++, entry++)
+static const char *
+_exm_view_relocation_type_get(int type)
+{
+    switch (type)
     {
-        _exm_view_cmd_directory_entry_resource_entry_dump(pe, base, entry,
-                                                          level + 1);
+        case IMAGE_REL_BASED_ABSOLUTE:
+            return "ABSOLUTE";
+        case IMAGE_REL_BASED_HIGH:
+            return "HIGH";
+        case IMAGE_REL_BASED_LOW:
+            return "LOW";
+        case IMAGE_REL_BASED_HIGHLOW:
+            return "HIGHLOW";
+        case IMAGE_REL_BASED_HIGHADJ:
+            return "HIGHADJ";
+        case IMAGE_REL_BASED_DIR64:
+            return "DIR64";
+        default:
+            return NULL;
     }
 }
 
 static void
-_exm_view_cmd_directory_entry_resource_display(Exm_Pe *pe)
+_exm_view_cmd_directory_entry_basereloc_display(Exm_Pe *pe)
 {
-    const IMAGE_RESOURCE_DIRECTORY *resource_dir;
+    Exm_Pe_Relocation_Stats stats;
+    const IMAGE_NT_HEADERS *nt_header;
+    const IMAGE_SECTION_HEADER *iter;
     const IMAGE_DATA_DIRECTORY *data_dir;
-    const unsigned char *base;
+    DWORD *sections;
+    WORD i;
 
-    data_dir = exm_pe_data_directory_get(pe, IMAGE_DIRECTORY_ENTRY_RESOURCE);
+    data_dir = exm_pe_data_directory_get(pe, IMAGE_DIRECTORY_ENTRY_BASERELOC);
 
-    printf("Directory entry Resource - Image Data Directory\n");
+    printf("Directory entry Base Relocation - Image Data Directory\n");
     printf("  field           type    value\n");
     printf("  VirtualAddress  DWORD   0x" FMT_DWDX "\n", data_dir->VirtualAddress);
     printf("  Size            DWORD   0x" FMT_DWDX "\n", data_dir->Size);
 
-    resource_dir = exm_pe_resource_directory_get(pe, NULL);
-    if (!resource_dir)
+    nt_header = exm_pe_nt_header_get(pe);
+    sections = (DWORD *)calloc(nt_header->FileHeader.NumberOfSections + 1, sizeof(DWORD));
+    if (!sections)
         return;
 
-    base = (const unsigned char *)resource_dir;
-    _exm_view_cmd_directory_entry_resource_dump(pe, base, resource_dir, NULL, 0);
+    if (!exm_pe_relocation_stats_get(pe, &stats, sections))
+    {
+        free(sections);
+        return;
+    }
+
+    printf("\n");
+    printf("Directory entry Base Relocation - Summary\n");
+    printf("  Blocks       %lu\n", (unsigned long)stats.blocks);
+    printf("  Relocations  %lu\n", (unsigned long)stats.count);
+    printf("  Pages        %lu (written when rebased)\n", (unsigned long)stats.pages);
+    for (i = 0; i < 16; i++)
+    {
+        const char *type;
+
+        if ((i == IMAGE_REL_BASED_ABSOLUTE) || (stats.types[i] == 0))
+            continue;
+
+        type = _exm_view_relocation_type_get(i);
+        if (type)
+            printf("  %-12s %lu\n", type, (unsigned long)stats.types[i]);
+        else
+            printf("  type %-7u %lu\n", i, (unsigned long)stats.types[i]);
+    }
+
+    iter = IMAGE_FIRST_SECTION(nt_header);
+    for (i = 0; i < nt_header->FileHeader.NumberOfSections; i++, iter++)
+    {
+        if (sections[i] == 0)
+            continue;
+
+        printf("  %-12s %lu\n", exm_pe_section_name_get(pe, iter), (unsigned long)sections[i]);
+    }
+
+    free(sections);
+}
+
+static void
+_exm_view_cmd_relocs_run(Exm_Pe *pe)
+{
+    Exm_Pe_Relocation_Stats stats;
+
+    exm_pe_relocation_stats_get(pe, &stats, NULL);
+
+    /* one line per file, to be filtered when scanning many files */
+    printf("%s relocs=%lu blocks=%lu pages=%lu highlow=%lu dir64=%lu other=%lu\n",
+           exm_pe_filename_get(pe),
+           (unsigned long)stats.count,
+           (unsigned long)stats.blocks,
+           (unsigned long)stats.pages,
+           (unsigned long)stats.types[IMAGE_REL_BASED_HIGHLOW],
+           (unsigned long)stats.types[IMAGE_REL_BASED_DIR64],
+           (unsigned long)(stats.count - stats.types[IMAGE_REL_BASED_HIGHLOW] - stats.types[IMAGE_REL_BASED_DIR64]));
+}
+
+static void
+_exm_view_cmd_entropy_run(Exm_Pe *pe)
+{
+    const IMAGE_NT_HEADERS *nt_header;
+    const IMAGE_SECTION_HEADER *iter;
+    const void *data;
+    DWORD size;
+    WORD i;
+
+    /* one line per file, to be filtered when scanning many files */
+    printf("%s", exm_pe_filename_get(pe));
+    nt_header = exm_pe_nt_header_get(pe);
+    iter = IMAGE_FIRST_SECTION(nt_header);
+    for (i = 0; i < nt_header->FileHeader.NumberOfSections; i++, iter++)
+    {
+        data = exm_pe_section_raw_data_get(pe, iter, &size);
+        printf(" %s=%.2f", exm_pe_section_name_get(pe, iter), _exm_view_entropy_get(data, size));
+    }
+
+    data = exm_pe_overlay_get(pe, &size);
+    if (data)
+        printf(" overlay=%.2f", _exm_view_entropy_get(data, size));
+    printf("\n");
+}
+
+static void
+_exm_view_cmd_checksum_run(Exm_Pe *pe)
+{
+    DWORD checksum;
+    DWORD computed;
+    const char *status;
+
+    /* CheckSum is at the same offset in PE32 and PE32+ files */
+    checksum = exm_pe_nt_header_get(pe)->OptionalHeader.CheckSum;
+    computed = exm_pe_checksum_compute(pe);
+    if (checksum == 0)
+        status = "unset";
+    else if (checksum == computed)
+        status = "ok";
+    else
+        status = "mismatch";
+
+    printf("%s checksum=0x%08lx computed=0x%08lx %s\n",
+           exm_pe_filename_get(pe),
+           (unsigned long)checksum,
+           (unsigned long)computed,
+           status);
 }
 
 static void
@@ -868,12 +1095,18 @@ _exm_view_cmd_run(Exm_Pe *pe)
     printf("\n");
     _exm_view_cmd_sections_display(pe);
     printf("\n");
+    _exm_view_cmd_entropy_display(pe);
+    printf("\n");
     _exm_view_cmd_directory_entry_export_display(pe);
     printf("\n");
     _exm_view_cmd_directory_entry_import_display(pe);
     printf("\n");
     _exm_view_cmd_directory_entry_resource_display(pe);
     printf("\n");
+    _exm_view_cmd_directory_entry_exception_display(pe);
+    printf("\n");
+    _exm_view_cmd_directory_entry_basereloc_display(pe);
+    printf("\n");
     _exm_view_cmd_directory_entry_debug_display(pe);
     printf("\n");
     _exm_view_cmd_directory_entry_delayload_display(pe);
@@ -922,7 +1155,7 @@ _exm_view_gui_run(Exm_Pe *pe, Exm_Log_Level log_level)
 #endif
 
 void
-exm_view_run(const char *module, unsigned char gui, Exm_Log_Level log_level)
+exm_view_run(const char *module, unsigned char display_relocs, unsigned char verify_checksum, unsigned char display_entropy, unsigned char gui, Exm_Log_Level log_level)
 {
     Exm_Pe *pe;
 
@@ -938,7 +1171,19 @@ exm_view_run(const char *module, unsigned char gui, Exm_Log_Level log_level)
         _exm_view_gui_run(pe, log_level);
     else
 #endif
-        _exm_view_cmd_run(pe);
+    {
+        if (display_relocs || verify_checksum || display_entropy)
+        {
+            if (display_relocs)
+                _exm_view_cmd_relocs_run(pe);
+            if (verify_checksum)
+                _exm_view_cmd_checksum_run(pe);
+            if (display_entropy)
+                _exm_view_cmd_entropy_run(pe);
+        }
+        else
+            _exm_view_cmd_run(pe);
+    }
 
     exm_pe_free(pe);
 
@@ -1,10 +1,15 @@
 
 # Source code for the Memcheck module
 
+if HAVE_WIN32
 src_bin_examine_SOURCES += \
 src/bin/memcheck/examine_memcheck.c
+else
+src_bin_examine_SOURCES += \
+src/bin/memcheck/examine_memcheck_unix.c
+endif
 
-# DLL injected by Memcheck tool
+# DLL injected by Memcheck tool, library preloaded on UNIX
 
 pkg_LTLIBRARIES += src/bin/memcheck/libexamine_memcheck.la
 
@@ -17,12 +22,25 @@ src_bin_memcheck_libexamine_memcheck_la_CPPFLAGS = \
 -I$(top_srcdir)/src/lib \
 @EXM_CPPFLAGS@
 
+if HAVE_WIN32
 src_bin_memcheck_libexamine_memcheck_la_CFLAGS = @EXM_CFLAGS@
 
 src_bin_memcheck_libexamine_memcheck_la_LIBADD = \
 src/lib/libexamine.la \
 -limagehlp \
 @EXM_LIBS@
+else
+# the frame pointers are kept for the stacks to be walked, and the
+# interposers call the functions of the library directly
+src_bin_memcheck_libexamine_memcheck_la_CFLAGS = @EXM_CFLAGS@ -fno-omit-frame-pointer -fno-semantic-interposition
+
+src_bin_memcheck_libexamine_memcheck_la_LIBADD = \
+src/lib/libexamine.la \
+-ldl \
+-lpthread \
+-lm \
+@EXM_LIBS@
+endif
 
 src_bin_memcheck_libexamine_memcheck_la_LDFLAGS = -no-undefined -module -avoid-version
 
@@ -91,7 +91,7 @@ _exm_del(Exm *exm)
 }
 
 static int
-_exm_map(Exm *exm, Exm_Process *process)
+_exm_map(Exm *exm, Exm_Process *process, const Exm_Mc_Options *options)
 {
     /*
      * Signification of lens:
@@ -104,19 +104,31 @@ _exm_map(Exm *exm, Exm_Process *process)
      * 0: log level
      * 1: number of CRT files
      * 2: number of dependencies
-     * 3-*: CRT file name lengths (with null terminating char) length, or 0
+     * 3: mean interval in bytes between the sampled blocks, or 0
+     * 4: timeline file name length (with null terminating char), or 0
+     * 5: maximum number of frames of the stacks
+     * 6: maximum number of loss records displayed, or 0
+     * 7: suppression file names length (with null terminating char), or 0
+     * 8: generated suppression file name length (with null terminating char), or 0
+     * 9-*: CRT file name lengths (with null terminating char) length, or 0
      * *-*: dep file name lengths (with null terminating char) length, or 0
      */
     int *vals;
     /*
      * Signification of names:
      * concatenation of ASCIIZ strings based on vals
-     * first the CRT names
+     * first the timeline file name, if any
+     * then the suppression file names and the generated suppression
+     * file name, if any
+     * then the CRT names
      * then the dep names
      */
     char *names;
     const Exm_List *crt_names;
     const Exm_List *dep_names;
+    size_t timeline_len;
+    size_t suppressions_len;
+    size_t gen_suppressions_len;
     size_t total_len;
     size_t idx;
     int crt_count;
@@ -130,7 +142,7 @@ _exm_map(Exm *exm, Exm_Process *process)
     dep_names = exm_process_dep_names_get(process);
     dep_count = exm_list_count(dep_names);
 
-    lens[0] = (1 + 1 + 1 + crt_count + dep_count) * sizeof(int);
+    lens[0] = (1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + crt_count + dep_count) * sizeof(int);
     vals = (int *)malloc(lens[0]);
     if (!vals)
     {
@@ -141,11 +153,20 @@ _exm_map(Exm *exm, Exm_Process *process)
     vals[0] = exm_log_level_get();
     vals[1] = crt_count;
     vals[2] = dep_count;
+    vals[3] = (int)options->sample_interval;
+    timeline_len = options->timeline ? strlen(options->timeline) + 1 : 0;
+    vals[4] = (int)timeline_len;
+    vals[5] = (int)options->num_callers;
+    vals[6] = (int)options->leak_limit;
+    suppressions_len = options->suppressions ? strlen(options->suppressions) + 1 : 0;
+    vals[7] = (int)suppressions_len;
+    gen_suppressions_len = options->gen_suppressions ? strlen(options->gen_suppressions) + 1 : 0;
+    vals[8] = (int)gen_suppressions_len;
 
     /* second, the crt file lengths */
 
-    total_len = 0;
-    i = 3;
+    total_len = timeline_len + suppressions_len + gen_suppressions_len;
+    i = 9;
     while (crt_names)
     {
         size_t crt_len;
@@ -170,7 +191,7 @@ _exm_map(Exm *exm, Exm_Process *process)
         dep_names = dep_names->next;
     }
 
-    /* fourth, we store the CRT names */
+    /* fourth, we store the timeline, the suppressions and the CRT names */
 
     lens[1] = (int)(total_len * sizeof(char));
     names = (char *)malloc(lens[1]);
@@ -180,8 +201,17 @@ _exm_map(Exm *exm, Exm_Process *process)
         goto free_vals;
     }
 
-    idx = 0;
-    i = 3;
+    if (options->timeline)
+        memcpy(names, options->timeline, timeline_len);
+
+    idx = timeline_len;
+    if (options->suppressions)
+        memcpy(names + idx, options->suppressions, suppressions_len);
+    idx += suppressions_len;
+    if (options->gen_suppressions)
+        memcpy(names + idx, options->gen_suppressions, gen_suppressions_len);
+    idx += gen_suppressions_len;
+    i = 9;
     crt_names = exm_process_crt_names_get(process);
     while (crt_names)
     {
@@ -249,16 +279,23 @@ _exm_map(Exm *exm, Exm_Process *process)
  *============================================================================*/
 
 
-void
-exm_mc_run(const char *filename, char *args)
+int
+exm_mc_run(const char *filename, char *args, const Exm_Mc_Options *options)
 {
     Exm *exm;
     Exm_Process *process;
     Exm_Injection *inj;
+    int exit_code;
+
+    /* the hooks of Windows do not allocate the redzones, nor keep the freed blocks, yet */
+    if (options->redzone)
+        EXM_LOG_WARN("The redzones are not supported on Windows, --redzone is ignored");
+    if (options->quarantine)
+        EXM_LOG_WARN("The quarantine is not supported on Windows, --quarantine is ignored");
 
     exm = _exm_new(exm_file_find(filename));
     if (!exm)
-        return;
+        return -1;
 
     process = exm_process_new(exm->filename, args);
     if (!process)
@@ -281,7 +318,7 @@ exm_mc_run(const char *filename, char *args)
         goto unpatch_process;
     }
 
-    if (!_exm_map(exm, process))
+    if (!_exm_map(exm, process, options))
     {
         EXM_LOG_ERR("can not map shared memory to pass to injected DLL");
         goto unpatch_process;
@@ -307,7 +344,7 @@ exm_mc_run(const char *filename, char *args)
         goto dll_eject;
     }
 
-    exm_process_run(process);
+    exit_code = exm_process_run(process);
 
     EXM_LOG_DBG("end of process");
 
@@ -320,7 +357,7 @@ exm_mc_run(const char *filename, char *args)
 
     EXM_LOG_DBG("resources freed");
 
-    return;
+    return exit_code;
 
   dll_eject:
     exm_injection_dll_eject(inj, process);
@@ -333,4 +370,6 @@ exm_mc_run(const char *filename, char *args)
     exm_process_del(process);
   del_exm:
     _exm_del(exm);
+
+    return -1;
 }
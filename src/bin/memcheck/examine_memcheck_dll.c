@@ -24,27 +24,59 @@
 #endif
 
 #include <stdlib.h>
-
-#ifndef WIN32_LEAN_AND_MEAN
-# define WIN32_LEAN_AND_MEAN
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef _WIN32
+# ifndef WIN32_LEAN_AND_MEAN
+#  define WIN32_LEAN_AND_MEAN
+# endif
+# include <windows.h>
+# undef WIN32_LEAN_AND_MEAN
+# include <imagehlp.h>
+# include <tlhelp32.h>
+#else
+# include <link.h>
+# include <pthread.h>
 #endif
-#include <windows.h>
-#undef WIN32_LEAN_AND_MEAN
-
-#include <imagehlp.h>
 
 #include <Examine.h>
 
 #include "examine_memcheck_hook.h"
 
 
+#ifdef _WIN32
+
 typedef struct
 {
     Exm_List *crt_names;
     Exm_List *dep_names;
+    char *timeline;
+    char *suppressions;
+    char *gen_suppressions;
 } Exm_Memcheck;
 
-static Exm_Memcheck _exm_mc_instance = { NULL, NULL };
+static Exm_Memcheck _exm_mc_instance = { NULL, NULL, NULL, NULL, NULL };
+
+/* a copy of the string of the given length in names, NULL if empty */
+static unsigned char
+_exm_mc_dll_string_get(const char *names, size_t *idx, int len, char **str)
+{
+    *str = NULL;
+    if (len <= 0)
+        return 1;
+
+    *str = (char *)malloc(len);
+    if (!*str)
+        return 0;
+
+    memcpy(*str, names + *idx, len);
+    *idx += len;
+
+    return 1;
+}
 
 static int
 _exm_mc_dll_init(void)
@@ -53,6 +85,9 @@ _exm_mc_dll_init(void)
     int *vals;
     Exm_List *crt_names;
     Exm_List *dep_names;
+    char *timeline;
+    char *suppressions;
+    char *gen_suppressions;
     char *names;
     size_t idx;
     int i;
@@ -99,9 +134,26 @@ _exm_mc_dll_init(void)
     }
 
     exm_log_level_set(vals[0]);
+    exm_hook_sample_interval_set((size_t)(unsigned int)vals[3]);
+    exm_hook_num_callers_set((unsigned int)vals[5]);
+    exm_hook_leak_limit_set((size_t)(unsigned int)vals[6]);
 
     idx = 0;
-    i = 3;
+    suppressions = NULL;
+    gen_suppressions = NULL;
+    if (!_exm_mc_dll_string_get(names, &idx, vals[4], &timeline) ||
+        !_exm_mc_dll_string_get(names, &idx, vals[7], &suppressions) ||
+        !_exm_mc_dll_string_get(names, &idx, vals[8], &gen_suppressions))
+    {
+        EXM_LOG_ERR("Can not allocate memory for the file names");
+        free(suppressions);
+        free(timeline);
+        free(names);
+        free(vals);
+        return 0;
+    }
+
+    i = 9;
     crt_names = NULL;
     for (j = 0; j < vals[1]; j++)
     {
@@ -147,7 +199,13 @@ _exm_mc_dll_init(void)
 
     _exm_mc_instance.crt_names =  crt_names;
     _exm_mc_instance.dep_names =  dep_names;
+    _exm_mc_instance.timeline = timeline;
+    _exm_mc_instance.suppressions = suppressions;
+    _exm_mc_instance.gen_suppressions = gen_suppressions;
 
+    exm_hook_timeline_set(timeline);
+    exm_hook_suppressions_set(suppressions);
+    exm_hook_gen_suppressions_set(gen_suppressions);
     if (!exm_hook_init(crt_names, dep_names))
     {
         EXM_LOG_ERR("Can not initialize hook system");
@@ -160,6 +218,12 @@ _exm_mc_dll_init(void)
     exm_list_free(dep_names, free);
   free_crt_names:
     exm_list_free(crt_names, free);
+    free(gen_suppressions);
+    free(suppressions);
+    free(timeline);
+    _exm_mc_instance.gen_suppressions = NULL;
+    _exm_mc_instance.suppressions = NULL;
+    _exm_mc_instance.timeline = NULL;
 
     return 0;
 }
@@ -170,88 +234,585 @@ _exm_mc_dll_shutdown(void)
     exm_hook_shutdown(_exm_mc_instance.crt_names, _exm_mc_instance.dep_names);
     exm_list_free(_exm_mc_instance.dep_names, free);
     exm_list_free(_exm_mc_instance.crt_names, free);
+    free(_exm_mc_instance.gen_suppressions);
+    free(_exm_mc_instance.suppressions);
+    free(_exm_mc_instance.timeline);
+}
+
+#endif
+
+typedef struct
+{
+    Exm_Tracker_Block *blocks;
+    size_t nbr;
+    size_t max;
+} Exm_Mc_Leaks;
+
+static void
+_exm_mc_leaks_add(const Exm_Tracker_Block *block, void *data)
+{
+    Exm_Mc_Leaks *leaks = data;
+
+    if (block->frees > 0)
+        return;
+
+    if (leaks->nbr == leaks->max)
+    {
+        Exm_Tracker_Block *blocks;
+        size_t max;
+
+        max = leaks->max ? 2 * leaks->max : 256;
+        blocks = (Exm_Tracker_Block *)realloc(leaks->blocks,
+                                              max * sizeof(Exm_Tracker_Block));
+        if (!blocks)
+            return;
+
+        leaks->blocks = blocks;
+        leaks->max = max;
+    }
+
+    leaks->blocks[leaks->nbr++] = *block;
+}
+
+/*
+ * In sampling mode, the live blocks at exit are the recorded ones, and
+ * each of them stands for 1 / p blocks of its size, p being the
+ * probability that it is recorded, so that the estimates are not
+ * biased. They are aggregated by allocation stack.
+ */
+typedef struct
+{
+    unsigned int stack;
+    unsigned int samples;
+    double blocks;
+    double bytes;
+} Exm_Mc_Site;
+
+static double
+_exm_mc_sample_probability(size_t size, size_t interval)
+{
+    /* a block is recorded if one of its bytes is a sampling point */
+    if (size == 0)
+        return 1.0;
+
+    return -expm1(-(double)size / (double)interval);
 }
 
 static int
-_exm_mc_leaks_cmp(const void *d1, const void *d2)
+_exm_mc_leaks_stack_cmp(const void *d1, const void *d2)
 {
-    const Exm_Hook_Data_Alloc *da1 = d1;
-    const Exm_Hook_Data_Alloc *da2 = d2;
+    const Exm_Tracker_Block *b1 = d1;
+    const Exm_Tracker_Block *b2 = d2;
 
-    if (da1->size < da2->size)
+    if (b1->stack < b2->stack)
         return -1;
-    else if (da1->size > da2->size)
+    else if (b1->stack > b2->stack)
         return 1;
     else
         return 0;
 }
 
+static int
+_exm_mc_sites_cmp(const void *d1, const void *d2)
+{
+    const Exm_Mc_Site *s1 = d1;
+    const Exm_Mc_Site *s2 = d2;
+
+    /* largest estimates first */
+    if (s1->bytes < s2->bytes)
+        return 1;
+    else if (s1->bytes > s2->bytes)
+        return -1;
+    else
+        return 0;
+}
+
+/* the sites sorted by estimated bytes, NULL if there is no block */
+static Exm_Mc_Site *
+_exm_mc_sites_new(Exm_Mc_Leaks *leaks, size_t interval, size_t *nbr)
+{
+    Exm_Mc_Site *sites;
+    size_t i;
+
+    *nbr = 0;
+    if (leaks->nbr == 0)
+        return NULL;
+
+    sites = (Exm_Mc_Site *)malloc(leaks->nbr * sizeof(Exm_Mc_Site));
+    if (!sites)
+        return NULL;
+
+    qsort(leaks->blocks, leaks->nbr, sizeof(Exm_Tracker_Block), _exm_mc_leaks_stack_cmp);
+
+    for (i = 0; i < leaks->nbr; i++)
+    {
+        const Exm_Tracker_Block *block = leaks->blocks + i;
+        Exm_Mc_Site *site;
+        double p;
+
+        if ((*nbr == 0) || (sites[*nbr - 1].stack != block->stack))
+        {
+            site = sites + *nbr;
+            site->stack = block->stack;
+            site->samples = 0;
+            site->blocks = 0.0;
+            site->bytes = 0.0;
+            (*nbr)++;
+        }
+        else
+            site = sites + *nbr - 1;
+
+        p = _exm_mc_sample_probability(block->size, interval);
+        site->samples++;
+        site->blocks += 1.0 / p;
+        site->bytes += (double)block->size / p;
+    }
+
+    qsort(sites, *nbr, sizeof(Exm_Mc_Site), _exm_mc_sites_cmp);
+
+    return sites;
+}
+
+/*
+ * In full mode, the blocks that are not freed are classified by a scan
+ * of the roots: the writable sections and the TLS of the modules in
+ * the calling thread, but the ones of memcheck, which only hold its
+ * records, and the stacks of the other threads, with their TLS on
+ * UNIX. Only the threads created once memcheck is loaded are known.
+ * On UNIX, if the program called exit(), the stack of the calling
+ * thread is scanned too, from the frame of the call. Otherwise, main()
+ * has returned, and the frames left are the ones of the C library,
+ * with stale copies of the pointers returned by the allocators.
+ */
+
+static void
+_exm_mc_root_scan(const void *start, size_t size, void *data)
+{
+    exm_leak_root_scan((Exm_Leak *)data, start, size);
+}
+
+#ifdef _WIN32
+
+/* offset of the TLS blocks of the modules in the TEB */
+# ifdef _WIN64
+#  define EXM_MC_TEB_TLS 0x58
+# else
+#  define EXM_MC_TEB_TLS 0x2c
+# endif
+
+/* the TLS block of the given module in the calling thread */
+static void
+_exm_mc_roots_tls_scan(Exm_Leak *leak, const unsigned char *base, const IMAGE_NT_HEADERS *nt_header)
+{
+    const IMAGE_DATA_DIRECTORY *dir;
+    const IMAGE_TLS_DIRECTORY *tls;
+    void **blocks;
+    DWORD idx;
+
+    dir = nt_header->OptionalHeader.DataDirectory + IMAGE_DIRECTORY_ENTRY_TLS;
+    if ((dir->VirtualAddress == 0) || (dir->Size == 0))
+        return;
+
+    tls = (const IMAGE_TLS_DIRECTORY *)(base + dir->VirtualAddress);
+    blocks = *(void ***)((unsigned char *)NtCurrentTeb() + EXM_MC_TEB_TLS);
+    if (!blocks || !tls->AddressOfIndex)
+        return;
+
+    idx = *(const DWORD *)(uintptr_t)tls->AddressOfIndex;
+    exm_leak_root_scan(leak, blocks[idx],
+                       (size_t)(tls->EndAddressOfRawData - tls->StartAddressOfRawData) +
+                       tls->SizeOfZeroFill);
+}
+
+static void
+_exm_mc_roots_scan(Exm_Leak *leak)
+{
+    MODULEENTRY32 me;
+    HMODULE self;
+    HANDLE snapshot;
+
+    if (!GetModuleHandleEx(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS |
+                           GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                           (LPCTSTR)&_exm_mc_instance, &self))
+        self = NULL;
+
+    snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE, GetCurrentProcessId());
+    if (snapshot != INVALID_HANDLE_VALUE)
+    {
+        me.dwSize = sizeof(MODULEENTRY32);
+        if (Module32First(snapshot, &me))
+        {
+            do
+            {
+                const IMAGE_DOS_HEADER *dos_header;
+                const IMAGE_NT_HEADERS *nt_header;
+                const IMAGE_SECTION_HEADER *sh;
+                WORD i;
+
+                if (me.hModule == self)
+                    continue;
+
+                dos_header = (const IMAGE_DOS_HEADER *)me.modBaseAddr;
+                nt_header = (const IMAGE_NT_HEADERS *)(me.modBaseAddr + dos_header->e_lfanew);
+                sh = IMAGE_FIRST_SECTION(nt_header);
+                for (i = 0; i < nt_header->FileHeader.NumberOfSections; i++, sh++)
+                {
+                    if ((sh->Characteristics & IMAGE_SCN_MEM_WRITE) &&
+                        !(sh->Characteristics & IMAGE_SCN_MEM_DISCARDABLE))
+                        exm_leak_root_scan(leak, me.modBaseAddr + sh->VirtualAddress,
+                                           sh->Misc.VirtualSize);
+                }
+                _exm_mc_roots_tls_scan(leak, me.modBaseAddr, nt_header);
+            } while (Module32Next(snapshot, &me));
+        }
+        CloseHandle(snapshot);
+    }
+
+    exm_hook_thread_roots_foreach(_exm_mc_root_scan, leak);
+}
+
+#else
+
+typedef struct
+{
+    Exm_Leak *leak;
+    uintptr_t self; /* function of memcheck, whose module is not scanned */
+} Exm_Mc_Roots;
+
+static int
+_exm_mc_roots_module_scan(struct dl_phdr_info *info, size_t size EXM_UNUSED, void *data)
+{
+    Exm_Mc_Roots *roots = data;
+    int i;
+
+    for (i = 0; i < info->dlpi_phnum; i++)
+    {
+        const ElfW(Phdr) *phdr = info->dlpi_phdr + i;
+
+        if ((phdr->p_type == PT_LOAD) &&
+            (roots->self - (info->dlpi_addr + phdr->p_vaddr) < phdr->p_memsz))
+            return 0;
+    }
+
+    /*
+     * the data, with the relocated read only data, and the bss, then
+     * the TLS block of the calling thread, if it is allocated
+     */
+    for (i = 0; i < info->dlpi_phnum; i++)
+    {
+        const ElfW(Phdr) *phdr = info->dlpi_phdr + i;
+
+        if ((phdr->p_type == PT_LOAD) && (phdr->p_flags & PF_W))
+            exm_leak_root_scan(roots->leak,
+                               (const void *)(info->dlpi_addr + phdr->p_vaddr),
+                               phdr->p_memsz);
+        else if (phdr->p_type == PT_TLS)
+            exm_leak_root_scan(roots->leak, info->dlpi_tls_data, phdr->p_memsz);
+    }
+
+    return 0;
+}
+
+static void
+_exm_mc_roots_scan(Exm_Leak *leak)
+{
+    Exm_Mc_Roots roots;
+    pthread_attr_t attr;
+    const void *stack;
+    void *addr;
+    size_t size;
+
+    roots.leak = leak;
+    roots.self = (uintptr_t)_exm_mc_roots_scan;
+    dl_iterate_phdr(_exm_mc_roots_module_scan, &roots);
+    exm_hook_thread_roots_foreach(_exm_mc_root_scan, leak);
+
+    stack = exm_hook_exit_stack_get();
+    if (!stack || (pthread_getattr_np(pthread_self(), &attr) != 0))
+        return;
+
+    if ((pthread_attr_getstack(&attr, &addr, &size) == 0) &&
+        ((uintptr_t)stack - (uintptr_t)addr < size))
+        exm_leak_root_scan(leak, stack, (uintptr_t)addr + size - (uintptr_t)stack);
+    pthread_attr_destroy(&attr);
+}
+
+#endif
+
+/* the loss records, sorted by size, NULL if there is no lost block */
+static Exm_Leak_Record *
+_exm_mc_losses_new(Exm_Mc_Leaks *leaks, size_t *nbr, size_t bytes[4], size_t blocks[4], unsigned long long *scanned)
+{
+    Exm_Leak_Record *losses;
+    Exm_Leak *leak;
+    size_t i;
+
+    *nbr = 0;
+    memset(bytes, 0, 4 * sizeof(size_t));
+    memset(blocks, 0, 4 * sizeof(size_t));
+    *scanned = 0;
+
+    leak = exm_leak_new(leaks->blocks, leaks->nbr);
+    if (!leak)
+    {
+        EXM_LOG_ERR("Can not allocate memory for the leak scan");
+        return NULL;
+    }
+
+    _exm_mc_roots_scan(leak);
+    exm_leak_run(leak);
+    *scanned = exm_leak_scanned_get(leak);
+
+    for (i = 0; i < leaks->nbr; i++)
+    {
+        Exm_Leak_Kind kind;
+
+        kind = exm_leak_kind_get(leak, i);
+        bytes[kind] += leaks->blocks[i].size;
+        blocks[kind]++;
+    }
+
+    /* the indirectly lost and still reachable blocks are only counted */
+    losses = exm_leak_records_new(leak, leaks->blocks, nbr);
+
+    exm_leak_free(leak);
+
+    return losses;
+}
+
+/*
+ * Remove the loss records matched by the suppressions from the
+ * records and from the counts of their kind, and return the number of
+ * the remaining ones.
+ */
+static size_t
+_exm_mc_losses_suppress(Exm_Suppression *sup, const Exm_Stack_Symbolizer *symbolizer,
+                        Exm_Leak_Record *losses, size_t nbr,
+                        size_t bytes[4], size_t blocks[4],
+                        size_t *suppressed_bytes, size_t *suppressed_blocks)
+{
+    size_t kept = 0;
+    size_t i;
+
+    for (i = 0; i < nbr; i++)
+    {
+        /* the leak kinds are in the same order */
+        if (exm_suppression_match(sup, (Exm_Suppression_Kind)(EXM_SUPPRESSION_LEAK_DEFINITE + losses[i].kind),
+                                  losses[i].stack, exm_hook_stack_frames_get, (void *)symbolizer))
+        {
+            bytes[losses[i].kind] -= losses[i].bytes;
+            blocks[losses[i].kind] -= losses[i].blocks;
+            *suppressed_bytes += losses[i].bytes;
+            *suppressed_blocks += losses[i].blocks;
+        }
+        else
+            losses[kept++] = losses[i];
+    }
+
+    return kept;
+}
+
+static void
+_exm_mc_suppression_gen(FILE *f, Exm_Suppression_Kind kind, unsigned int stack, const Exm_Stack_Symbolizer *symbolizer)
+{
+    Exm_Suppression_Frame frames[EXM_HOOK_STACK_FRAMES_MAX];
+    unsigned int nbr;
+
+    nbr = exm_hook_stack_frames_get(stack, frames, EXM_HOOK_STACK_FRAMES_MAX, (void *)symbolizer);
+    exm_suppression_print(f, kind, frames, nbr);
+}
+
 static void
 _exm_mc_output(void)
 {
-    Exm_List *leaks = NULL;
+    Exm_Stack_Symbolizer *symbolizer;
+    Exm_Mc_Leaks leaks = { NULL, 0, 0 };
+    Exm_Mc_Site *sites = NULL;
+    Exm_Leak_Record *losses = NULL;
+    Exm_Suppression *sup;
+    FILE *gen = NULL;
+    Exm_Hook_Summary summary;
     Exm_List *iter;
     size_t bytes_at_exit = 0;
-    size_t blocks_at_exit = 0;
+    size_t blocks_at_exit;
+    size_t sites_nbr = 0;
+    size_t losses_nbr = 0;
+    size_t losses_first = 0; /* first displayed loss record */
+    size_t kind_bytes[4];
+    size_t kind_blocks[4];
+    size_t suppressed_bytes = 0;
+    size_t suppressed_blocks = 0;
+    unsigned long long scanned = 0;
+    size_t interval;
+    size_t i;
     int alloc_records;
+    int leak_records;
     int error_records;
+    int error_suppressed;
     int record;
 
-    iter = exm_hook_allocations;
+    /* the writes out of the blocks that are not freed, and in the freed ones */
+    exm_hook_blocks_check();
+
+    exm_tracker_foreach(exm_hook_tracker, _exm_mc_leaks_add, &leaks);
+    interval = exm_hook_sample_interval_get();
+    if (interval)
+        sites = _exm_mc_sites_new(&leaks, interval, &sites_nbr);
+    else if (leaks.nbr > 0)
+        losses = _exm_mc_losses_new(&leaks, &losses_nbr, kind_bytes, kind_blocks, &scanned);
+
+    sup = exm_hook_suppression_get();
+    if (!sup && exm_hook_leak_limit_get() && (losses_nbr > exm_hook_leak_limit_get()))
+        losses_first = losses_nbr - exm_hook_leak_limit_get();
+
+    blocks_at_exit = leaks.nbr;
+    for (i = 0; i < leaks.nbr; i++)
+        bytes_at_exit += leaks.blocks[i].size;
+
+    /*
+     * only the stacks that are displayed are symbolized, all at once,
+     * and the ones of all the loss records with suppressions
+     */
+    symbolizer = exm_stack_symbolizer_new();
+    if (interval)
+    {
+        for (i = 0; i < sites_nbr; i++)
+            exm_hook_stack_symbolizer_add(sites[i].stack, symbolizer);
+    }
+    else
+    {
+        for (i = losses_first; i < losses_nbr; i++)
+            exm_hook_stack_symbolizer_add(losses[i].stack, symbolizer);
+    }
+    iter = exm_hook_errors;
     while (iter)
     {
-        Exm_Hook_Data_Alloc *da;
+        exm_hook_error_symbolizer_add(iter->data, symbolizer);
+        iter = iter->next;
+    }
+    exm_stack_symbolizer_run(symbolizer);
 
-        da = (Exm_Hook_Data_Alloc *)iter->data;
-        if (da->nbr_frees > 0)
-        {
-        }
-        else
-        {
-            bytes_at_exit += da->size;
-            blocks_at_exit++;
-            leaks = exm_list_insert(leaks, da, _exm_mc_leaks_cmp);
-        }
+    /* the loss records that are suppressed are suppressed errors */
+    error_suppressed = (int)losses_nbr;
+    if (sup)
+    {
+        losses_nbr = _exm_mc_losses_suppress(sup, symbolizer, losses, losses_nbr,
+                                             kind_bytes, kind_blocks,
+                                             &suppressed_bytes, &suppressed_blocks);
+        if (exm_hook_leak_limit_get() && (losses_nbr > exm_hook_leak_limit_get()))
+            losses_first = losses_nbr - exm_hook_leak_limit_get();
+    }
+    error_suppressed -= (int)losses_nbr;
 
-        iter = iter->next;
+    if (exm_hook_gen_suppressions_get())
+    {
+        gen = fopen(exm_hook_gen_suppressions_get(), "wb");
+        if (!gen)
+            EXM_LOG_ERR("Can not open suppression file %s", exm_hook_gen_suppressions_get());
     }
 
+    exm_hook_summary_get(&summary);
+
+    /* the report is written at once, whatever the number of its lines */
+    exm_log_buffer_begin();
+
     EXM_LOG_INFO("");
     EXM_LOG_INFO("HEAP SUMMARY:");
-    EXM_LOG_INFO("    in use at exit: %Iu bytes in %Iu blocks",
-                 bytes_at_exit, blocks_at_exit);
-    EXM_LOG_INFO("  total heap usage: %u allocs, %u frees, %Iu bytes allocated",
-                 exm_hook_summary.total_count_allocs,
-                 exm_hook_summary.total_count_frees,
-                 exm_hook_summary.total_bytes_allocated);
+    if (interval)
+    {
+        double bytes = 0.0;
+        double blocks = 0.0;
+
+        for (i = 0; i < sites_nbr; i++)
+        {
+            bytes += sites[i].bytes;
+            blocks += sites[i].blocks;
+        }
+        EXM_LOG_INFO("    in use at exit: ~%.0f bytes in ~%.0f blocks, estimated from " EXM_HOOK_FMT_SIZE " sampled blocks",
+                     bytes, blocks, blocks_at_exit);
+    }
+    else
+        EXM_LOG_INFO("    in use at exit: " EXM_HOOK_FMT_SIZE " bytes in " EXM_HOOK_FMT_SIZE " blocks",
+                     bytes_at_exit, blocks_at_exit);
+    EXM_LOG_INFO("  total heap usage: %u allocs, %u frees, " EXM_HOOK_FMT_SIZE " bytes allocated",
+                 summary.total_count_allocs,
+                 summary.total_count_frees,
+                 summary.total_bytes_allocated);
+#ifdef _WIN32
     EXM_LOG_INFO("                    %u GDI handles created",
-                 exm_hook_summary.total_count_gdi_handles);
+                 summary.total_count_gdi_handles);
+#endif
     EXM_LOG_INFO("");
 
-    alloc_records = exm_list_count(leaks);
-    if (blocks_at_exit > 0)
+    exm_hook_timeline_close();
+
+    alloc_records = (int)losses_nbr;
+    if (interval)
     {
-        EXM_LOG_INFO("Searching for pointer to %Iu not-freed blocks", blocks_at_exit);
+        alloc_records = (int)sites_nbr;
+        EXM_LOG_INFO("Live heap by allocation site, 1 block sampled every " EXM_HOOK_FMT_SIZE " bytes on average", interval);
+        EXM_LOG_INFO("");
 
-        record = 1;
-        iter = leaks;
-        while (iter)
+        for (i = 0; i < sites_nbr; i++)
         {
-            Exm_Hook_Data_Alloc *da;
-
-            da = (Exm_Hook_Data_Alloc *)iter->data;
-            EXM_LOG_INFO("%Iu bytes in 1 block(s) are definitely lost [%d/%d]",
-                         da->size, record, alloc_records);
-            exm_stack_disp(da->stack);
+            EXM_LOG_INFO("~%.0f bytes in ~%.0f block(s) from %u sample(s) are live [%d/%d]",
+                         sites[i].bytes, sites[i].blocks, sites[i].samples,
+                         (int)i + 1, alloc_records);
+            exm_hook_stack_disp(sites[i].stack, symbolizer);
             EXM_LOG_INFO("");
-            record++;
-            iter = iter->next;
         }
 
+        if (sites_nbr == 0)
+            EXM_LOG_INFO("No sampled block is live");
+    }
+    else if (blocks_at_exit > 0)
+    {
+        EXM_LOG_INFO("Searching for pointer to " EXM_HOOK_FMT_SIZE " not-freed blocks", blocks_at_exit);
+        EXM_LOG_INFO("Checked " EXM_HOOK_FMT_ULL " bytes", scanned);
         EXM_LOG_INFO("");
+
+        if (losses_first > 0)
+        {
+            EXM_LOG_INFO(EXM_HOOK_FMT_SIZE " smaller loss records are not shown",
+                         losses_first);
+            EXM_LOG_INFO("");
+        }
+
+        for (i = losses_first; i < losses_nbr; i++)
+        {
+            const char *kind;
+
+            kind = (losses[i].kind == EXM_LEAK_POSSIBLY_LOST) ? "possibly" : "definitely";
+            if (losses[i].indirect > 0)
+                EXM_LOG_INFO(EXM_HOOK_FMT_SIZE " (" EXM_HOOK_FMT_SIZE " direct, " EXM_HOOK_FMT_SIZE " indirect) bytes in " EXM_HOOK_FMT_SIZE " block(s) are %s lost [%d/%d]",
+                             losses[i].bytes + losses[i].indirect,
+                             losses[i].bytes, losses[i].indirect,
+                             losses[i].blocks, kind, (int)i + 1, alloc_records);
+            else
+                EXM_LOG_INFO(EXM_HOOK_FMT_SIZE " bytes in " EXM_HOOK_FMT_SIZE " block(s) are %s lost [%d/%d]",
+                             losses[i].bytes, losses[i].blocks,
+                             kind, (int)i + 1, alloc_records);
+            exm_hook_stack_disp(losses[i].stack, symbolizer);
+            EXM_LOG_INFO("");
+            if (gen)
+                _exm_mc_suppression_gen(gen, (Exm_Suppression_Kind)(EXM_SUPPRESSION_LEAK_DEFINITE + losses[i].kind),
+                                        losses[i].stack, symbolizer);
+        }
+
         EXM_LOG_INFO("LEAK SUMMARY:");
-        EXM_LOG_INFO("   definitely lost: %Iu bytes in %d blocks",
-                     bytes_at_exit, blocks_at_exit);
+        EXM_LOG_INFO("   definitely lost: " EXM_HOOK_FMT_SIZE " bytes in " EXM_HOOK_FMT_SIZE " blocks",
+                     kind_bytes[EXM_LEAK_DEFINITELY_LOST], kind_blocks[EXM_LEAK_DEFINITELY_LOST]);
+        EXM_LOG_INFO("   indirectly lost: " EXM_HOOK_FMT_SIZE " bytes in " EXM_HOOK_FMT_SIZE " blocks",
+                     kind_bytes[EXM_LEAK_INDIRECTLY_LOST], kind_blocks[EXM_LEAK_INDIRECTLY_LOST]);
+        EXM_LOG_INFO("     possibly lost: " EXM_HOOK_FMT_SIZE " bytes in " EXM_HOOK_FMT_SIZE " blocks",
+                     kind_bytes[EXM_LEAK_POSSIBLY_LOST], kind_blocks[EXM_LEAK_POSSIBLY_LOST]);
+        EXM_LOG_INFO("   still reachable: " EXM_HOOK_FMT_SIZE " bytes in " EXM_HOOK_FMT_SIZE " blocks",
+                     kind_bytes[EXM_LEAK_STILL_REACHABLE], kind_blocks[EXM_LEAK_STILL_REACHABLE]);
+        if (sup)
+            EXM_LOG_INFO("        suppressed: " EXM_HOOK_FMT_SIZE " bytes in " EXM_HOOK_FMT_SIZE " blocks",
+                         suppressed_bytes, suppressed_blocks);
+        if (kind_blocks[EXM_LEAK_STILL_REACHABLE] + kind_blocks[EXM_LEAK_INDIRECTLY_LOST] > 0)
+            EXM_LOG_INFO("Reachable and indirectly lost blocks are not shown.");
     }
     else
     {
@@ -260,31 +821,75 @@ _exm_mc_output(void)
 
     EXM_LOG_INFO("");
 
-    error_records = exm_list_count(exm_hook_errors);
-    if (error_records > 0)
+    /*
+     * as with valgrind, each loss record is an error, in its own
+     * context, and they come first, but the allocation sites are not
+     */
+    leak_records = (int)losses_nbr;
+
+    /* the matches of the errors are cached, so they are only counted first */
+    error_records = 0;
+    for (iter = exm_hook_errors; iter; iter = iter->next)
     {
+        if (exm_hook_error_suppressed(iter->data, symbolizer))
+            error_suppressed++;
+        else
+            error_records++;
+    }
+
+    if (sup)
+        EXM_LOG_INFO("ERROR SUMMARY: %d errors from %d contexts (suppressed: %d from %d)",
+                     leak_records + error_records, leak_records + error_records,
+                     error_suppressed, error_suppressed);
+    else
         EXM_LOG_INFO("ERROR SUMMARY: %d errors from %d contexts",
-                     error_records, error_records + alloc_records);
+                     leak_records + error_records, leak_records + error_records);
+
+    if (error_records > 0)
+    {
         EXM_LOG_INFO("");
 
         iter = exm_hook_errors;
         record = 1;
         while (iter)
         {
-            EXM_LOG_INFO("1 error in context %d of %d",
-                         record, error_records + alloc_records);
-            exm_hook_error_disp(iter->data);
-            record++;
+            if (!exm_hook_error_suppressed(iter->data, symbolizer))
+            {
+                EXM_LOG_INFO("1 error in context %d of %d",
+                             leak_records + record, leak_records + error_records);
+                exm_hook_error_disp(iter->data, symbolizer);
+                record++;
+
+                if (gen)
+                {
+                    Exm_Suppression_Kind kind;
+                    unsigned int stack;
+
+                    stack = exm_hook_error_stack_get(iter->data, &kind);
+                    _exm_mc_suppression_gen(gen, kind, stack, symbolizer);
+                }
+            }
             iter = iter->next;
         }
     }
-    else
+
+    if (gen)
     {
-        EXM_LOG_INFO("ERROR SUMMARY: 0 errors from %d contexts",
-            error_records + alloc_records);
+        fclose(gen);
+        EXM_LOG_INFO("Suppressions of the displayed errors and loss records written in %s",
+                     exm_hook_gen_suppressions_get());
     }
+
+    exm_log_buffer_end();
+
+    exm_stack_symbolizer_free(symbolizer);
+    free(losses);
+    free(sites);
+    free(leaks.blocks);
 }
 
+#ifdef _WIN32
+
 BOOL APIENTRY DllMain(HMODULE hModule EXM_UNUSED, DWORD ulReason, LPVOID lpReserved EXM_UNUSED);
 
 BOOL APIENTRY DllMain(HMODULE hModule EXM_UNUSED, DWORD ulReason, LPVOID lpReserved)
@@ -303,9 +908,11 @@ BOOL APIENTRY DllMain(HMODULE hModule EXM_UNUSED, DWORD ulReason, LPVOID lpReser
          break;
      case DLL_THREAD_ATTACH:
          EXM_LOG_DBG("thread attach");
+         exm_hook_thread_init();
          break;
      case DLL_THREAD_DETACH:
          EXM_LOG_DBG("thread detach");
+         exm_hook_thread_shutdown();
          break;
      case DLL_PROCESS_DETACH:
      {
@@ -321,3 +928,46 @@ BOOL APIENTRY DllMain(HMODULE hModule EXM_UNUSED, DWORD ulReason, LPVOID lpReser
 
     return TRUE;
 }
+
+#else
+
+/*
+ * On UNIX, the library is preloaded by the Memcheck tool. The
+ * interposers can be called before the constructor, and the report is
+ * output once the destructors of the program are called.
+ */
+
+static void _exm_mc_init(void) __attribute__((constructor));
+static void _exm_mc_shutdown(void) __attribute__((destructor));
+
+static void
+_exm_mc_init(void)
+{
+    if (!exm_hook_init())
+    {
+        EXM_LOG_ERR("Can not initialize hook system");
+        return;
+    }
+
+    EXM_LOG_DBG("process attach");
+}
+
+static void
+_exm_mc_shutdown(void)
+{
+    if (!exm_hook_init())
+        return;
+
+    EXM_LOG_DBG("process detach");
+
+    /* the memory allocated for the report is not tracked */
+    if (exm_hook_guard_enter())
+    {
+        _exm_mc_output();
+        exm_hook_guard_leave();
+    }
+
+    exm_hook_shutdown();
+}
+
+#endif
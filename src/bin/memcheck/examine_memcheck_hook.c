@@ -24,18 +24,29 @@
 #endif
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
-#include <mbstring.h>
-
-#ifndef WIN32_LEAN_AND_MEAN
-# define WIN32_LEAN_AND_MEAN
+#include <math.h>
+
+#ifdef _WIN32
+# include <mbstring.h>
+# ifndef WIN32_LEAN_AND_MEAN
+#  define WIN32_LEAN_AND_MEAN
+# endif
+# include <windows.h>
+# undef WIN32_LEAN_AND_MEAN
+# include <imagehlp.h>
+#else
+# include <errno.h>
+# include <malloc.h>
+# include <unistd.h>
+# include <dlfcn.h>
+# include <setjmp.h>
+# include <sys/mman.h>
 #endif
-#include <windows.h>
-#undef WIN32_LEAN_AND_MEAN
-
-#include <imagehlp.h>
 
 #include <Examine.h>
+#include <examine_private_thread.h>
 
 #include "examine_memcheck_hook.h"
 
@@ -49,9 +60,13 @@ typedef enum
     EXM_HOOK_ERROR_FREE_WITHOUT_ALLOC,
     EXM_HOOK_ERROR_MULTIPLE_FREES,
     EXM_HOOK_ERROR_MISMATCHED_FREE,
-    EXM_HOOK_ERROR_MEMORY_OVERLAP
+    EXM_HOOK_ERROR_MEMORY_OVERLAP,
+    EXM_HOOK_ERROR_REDZONE,
+    EXM_HOOK_ERROR_FREED_WRITE
 } Exm_Hook_Error;
 
+#ifdef _WIN32
+
 typedef struct _Exm_Hook Exm_Hook;
 
 struct _Exm_Hook
@@ -63,6 +78,133 @@ struct _Exm_Hook
 
 static Exm_Hook _exm_hook_instance[EXM_HOOK_FCT_COUNT];
 
+#endif
+
+static Exm_Lock _exm_hook_errors_lock;
+
+/*
+ * The counters of the summary are kept by each thread, so that the
+ * allocations do not update shared counters. They are never freed,
+ * and those of a finished thread are reused by a new one.
+ */
+typedef struct _Exm_Hook_Counters Exm_Hook_Counters;
+
+struct _Exm_Hook_Counters
+{
+    Exm_Hook_Counters *next;
+    unsigned int owned;
+    Exm_Hook_Summary summary;
+};
+
+static Exm_Hook_Counters *_exm_hook_counters = NULL;
+static EXM_TLS Exm_Hook_Counters *_exm_hook_thread_counters = NULL;
+
+/*
+ * The stacks of the threads, which are still running, or terminated
+ * without being finished, when the report is output. They are roots of
+ * the leak scan. The records are never freed, and the one of a
+ * finished thread is reused by a new thread with the same stack, as
+ * the C library keeps the stacks of the finished threads.
+ */
+typedef struct _Exm_Hook_Thread Exm_Hook_Thread;
+
+struct _Exm_Hook_Thread
+{
+    Exm_Hook_Thread *next;
+    unsigned int live; /* 0 once the thread is finished */
+    const unsigned char *stack; /* lowest address of the stack */
+    const unsigned char *end; /* end of the stack */
+    const unsigned char *self; /* descriptor of the thread */
+};
+
+static Exm_Hook_Thread *_exm_hook_threads = NULL;
+static EXM_TLS Exm_Hook_Thread *_exm_hook_thread = NULL;
+
+/*
+ * In sampling mode, a block is recorded, with its stack, each time the
+ * bytes allocated by the thread since the previous recorded block
+ * reach an interval drawn from an exponential distribution, as the
+ * heap profiler of tcmalloc does. A block of size s is then recorded
+ * with the probability 1 - exp(-s / interval). The other blocks are
+ * only counted.
+ *
+ * The frees of the blocks that are not recorded are not searched in
+ * the tracker: a counting filter, indexed by the address, tells if a
+ * recorded block can be at an address.
+ */
+#define EXM_HOOK_SAMPLED_SIZE 4096 /* power of 2 */
+
+static size_t _exm_hook_sample_interval = 0; /* 0: all the blocks are recorded */
+static unsigned int _exm_hook_sampled[EXM_HOOK_SAMPLED_SIZE];
+static EXM_TLS size_t _exm_hook_sample_bytes = 0; /* 0 until the first draw */
+static EXM_TLS unsigned long long _exm_hook_sample_state = 0;
+
+/*
+ * Set while the calling thread runs the tracking code, so that the
+ * memory allocated by the library meanwhile is not tracked. It is
+ * used instead of the guard of the tracker, so that entering it makes
+ * no call into the library.
+ */
+static EXM_TLS unsigned char _exm_hook_thread_guard = 0;
+
+/*
+ * The live heap by allocation site over time, written in a file when
+ * its name is set. The GDI handles are not in it.
+ */
+static const char *_exm_hook_timeline_filename = NULL;
+static Exm_Timeline *_exm_hook_timeline = NULL;
+
+/*
+ * With redzones, the blocks of the C library are allocated with
+ * canaries before and after them, verified when they are freed and at
+ * exit, to find the writes out of the blocks. The size of the redzones
+ * before the blocks is recorded with them, 0 for the blocks allocated
+ * without redzones, like the ones of the tracking code.
+ */
+static size_t _exm_hook_redzone = 0; /* 0: no redzones */
+
+/*
+ * With a quarantine, the freed blocks of the C library are not
+ * returned to it at once, so that their addresses are not reused
+ * while the program can still write in them. Each thread keeps the
+ * blocks it frees in a FIFO of its own, without lock, until their
+ * size exceeds the budget. The oldest blocks are then returned by
+ * batches, once the poison they are filled with is verified.
+ */
+typedef struct
+{
+    Exm_Tracker_Block *blocks; /* ring of max records, a power of 2 */
+    size_t max;
+    size_t first;
+    size_t nbr;
+    size_t bytes;
+} Exm_Hook_Quarantine;
+
+static size_t _exm_hook_quarantine_budget = 0; /* 0: no quarantine */
+static unsigned char _exm_hook_quarantine_poison = 1;
+static EXM_TLS Exm_Hook_Quarantine _exm_hook_quarantine;
+
+/*
+ * The stacks are recorded with at most the given number of frames, so
+ * that the blocks allocated at the same place by different paths
+ * share their stack, hence their loss record. On Windows, the frames
+ * of Examine are counted. Only the largest loss records are displayed
+ * if their number is limited.
+ */
+static unsigned int _exm_hook_num_callers = EXM_HOOK_STACK_FRAMES_MAX;
+static size_t _exm_hook_leak_limit = 0; /* 0: all the loss records */
+
+/*
+ * The files of the suppressions hiding the errors and the loss
+ * records, separated by EXM_HOOK_SUPPRESSIONS_SEP, and the file in
+ * which the suppressions of the displayed ones are generated. The
+ * files are read at the first error, or at exit.
+ */
+static const char *_exm_hook_suppressions = NULL;
+static const char *_exm_hook_gen_suppressions = NULL;
+static Exm_Suppression *_exm_hook_suppression = NULL;
+static unsigned char _exm_hook_suppression_loaded = 0;
+
 struct _Exm_Hook_Error_Data
 {
     Exm_Hook_Error error_type;
@@ -70,20 +212,20 @@ struct _Exm_Hook_Error_Data
     {
         struct
         {
-            Exm_List *stack;
+            unsigned int stack;
         } free_without_alloc;
         struct
         {
-            Exm_List *stack_free;
-            Exm_List *stack_alloc;
-            Exm_List *stack_first_free;
+            unsigned int stack_free;
+            unsigned int stack_alloc;
+            unsigned int stack_first_free;
             void *address_alloc;
             size_t size_alloc;
         } multiple_frees;
         struct
         {
-            Exm_List *stack_free;
-            Exm_List *stack_alloc;
+            unsigned int stack_free;
+            unsigned int stack_alloc;
             void *address_alloc;
             size_t size_alloc;
         } mismatched_free;
@@ -93,13 +235,346 @@ struct _Exm_Hook_Error_Data
             const void *src;
             size_t dst_len;
             size_t src_len;
-            Exm_List *stack;
+            unsigned int stack;
             Exm_Hook_Fct fct;
         } memory_overlap;
+        struct
+        {
+            unsigned int stack_free; /* 0 if found at exit */
+            unsigned int stack_alloc;
+            void *address_alloc;
+            size_t size_alloc;
+            long long offset; /* of the first overwritten canary */
+            size_t count;
+        } redzone;
+        struct
+        {
+            unsigned int stack_free;
+            unsigned int stack_alloc;
+            void *address_alloc;
+            size_t size_alloc;
+            long long offset; /* of the first overwritten byte */
+            size_t count;
+        } freed_write;
 
     } error;
 };
 
+static unsigned int
+_exm_hook_stack_new(void)
+{
+    Exm_Stack_Pc pcs[EXM_HOOK_STACK_FRAMES_MAX];
+    unsigned int nbr;
+
+    nbr = exm_stack_capture(pcs, EXM_HOOK_STACK_FRAMES_MAX);
+
+#ifndef _WIN32
+    {
+        unsigned int first;
+        unsigned int i;
+        unsigned int j;
+
+        /*
+         * the first frames are the ones of this library, and the
+         * interposers of exit() and of the start of the threads are
+         * called by the program
+         */
+        for (first = 1; (first < nbr) && (pcs[first].module == pcs[0].module); first++)
+            ;
+
+        for (i = first, j = first; i < nbr; i++)
+        {
+            if (pcs[i].module != pcs[0].module)
+                pcs[j++] = pcs[i];
+        }
+        nbr = j;
+
+        if (nbr - first > _exm_hook_num_callers)
+            nbr = first + _exm_hook_num_callers;
+
+        return exm_stack_depot_put(exm_hook_stack_depot, pcs + first, nbr - first);
+    }
+#else
+    if (nbr > _exm_hook_num_callers)
+        nbr = _exm_hook_num_callers;
+
+    return exm_stack_depot_put(exm_hook_stack_depot, pcs, nbr);
+#endif
+}
+
+static inline unsigned char
+_exm_hook_guard_enter(void)
+{
+    if (_exm_hook_thread_guard)
+        return 0;
+
+    _exm_hook_thread_guard = 1;
+
+    return 1;
+}
+
+static inline void
+_exm_hook_guard_leave(void)
+{
+    _exm_hook_thread_guard = 0;
+}
+
+static inline unsigned int
+_exm_hook_sampled_slot(const void *data)
+{
+    unsigned long long h;
+
+    h = (unsigned long long)(uintptr_t)data * 0x9e3779b97f4a7c15ULL;
+
+    return (unsigned int)(h >> 52) & (EXM_HOOK_SAMPLED_SIZE - 1);
+}
+
+/* the number of bytes allocated before the next recorded block */
+static size_t
+_exm_hook_sample_next(void)
+{
+    unsigned long long x;
+    double u;
+
+    /* xorshift64*, seeded differently in each thread */
+    x = _exm_hook_sample_state;
+    if (x == 0)
+        x = (unsigned long long)(uintptr_t)&_exm_hook_sample_state ^ 0x2545f4914f6cdd1dULL;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    _exm_hook_sample_state = x;
+
+    /* uniform in ]0, 1] */
+    u = (double)((x * 0x2545f4914f6cdd1dULL) >> 11) + 1.0;
+    u /= 9007199254740992.0;
+
+    return (size_t)(-log(u) * (double)_exm_hook_sample_interval) + 1;
+}
+
+/* 1 if the allocated block of the given size must be recorded */
+static inline unsigned char
+_exm_hook_sample(size_t size)
+{
+    if (!_exm_hook_sample_interval)
+        return 1;
+
+    if (size < _exm_hook_sample_bytes)
+    {
+        _exm_hook_sample_bytes -= size;
+        return 0;
+    }
+
+    /* first allocation of the thread */
+    if (_exm_hook_sample_bytes == 0)
+    {
+        _exm_hook_sample_bytes = _exm_hook_sample_next();
+        if (size < _exm_hook_sample_bytes)
+        {
+            _exm_hook_sample_bytes -= size;
+            return 0;
+        }
+    }
+
+    _exm_hook_sample_bytes = _exm_hook_sample_next();
+
+    return 1;
+}
+
+/*
+ * In sampling mode, the blocks that are not recorded are counted
+ * without entering the guard, once the thread has its counters. Return
+ * 1 if the allocation is counted.
+ */
+static inline unsigned char
+_exm_hook_alloc_counted(size_t size)
+{
+    Exm_Hook_Counters *counters = _exm_hook_thread_counters;
+
+    if (!counters || (size >= _exm_hook_sample_bytes) || _exm_hook_thread_guard)
+        return 0;
+
+    _exm_hook_sample_bytes -= size;
+    counters->summary.total_count_allocs++;
+    counters->summary.total_bytes_allocated += size;
+
+    return 1;
+}
+
+/* return 1 if the free is counted, no block being recorded at the address */
+static inline unsigned char
+_exm_hook_free_counted(const void *data)
+{
+    Exm_Hook_Counters *counters = _exm_hook_thread_counters;
+
+    if (!counters || !_exm_hook_sample_interval || _exm_hook_thread_guard ||
+        EXM_ATOMIC_LOAD(_exm_hook_sampled + _exm_hook_sampled_slot(data)))
+        return 0;
+
+    counters->summary.total_count_frees++;
+
+    return 1;
+}
+
+/*
+ * The counters of the calling thread, NULL on memory error. The guard
+ * of the tracker must be entered, as they can be allocated.
+ */
+static Exm_Hook_Summary *
+_exm_hook_summary_thread_get(void)
+{
+    Exm_Hook_Counters *counters;
+
+    if (_exm_hook_thread_counters)
+        return &_exm_hook_thread_counters->summary;
+
+    for (counters = EXM_ATOMIC_LOAD(&_exm_hook_counters); counters; counters = counters->next)
+    {
+        unsigned int owned = 0;
+
+        if (EXM_ATOMIC_CAS(&counters->owned, &owned, 1))
+            break;
+    }
+
+    if (!counters)
+    {
+        counters = (Exm_Hook_Counters *)calloc(1, sizeof(Exm_Hook_Counters));
+        if (!counters)
+            return NULL;
+
+        counters->owned = 1;
+        counters->next = EXM_ATOMIC_LOAD(&_exm_hook_counters);
+        while (!EXM_ATOMIC_CAS(&_exm_hook_counters, &counters->next, counters))
+            ;
+    }
+
+    _exm_hook_thread_counters = counters;
+
+    return &counters->summary;
+}
+
+/*
+ * Record the stack of the calling thread. The guard of the tracker
+ * must be entered, as the record can be allocated.
+ */
+static void
+_exm_hook_thread_add(const void *stack, const void *end, const void *self)
+{
+    Exm_Hook_Thread *thread;
+
+    for (thread = EXM_ATOMIC_LOAD(&_exm_hook_threads); thread; thread = thread->next)
+    {
+        unsigned int live = 0;
+
+        if ((thread->end == end) && (thread->stack == stack) &&
+            EXM_ATOMIC_CAS(&thread->live, &live, 1))
+            break;
+    }
+
+    if (!thread)
+    {
+        thread = (Exm_Hook_Thread *)calloc(1, sizeof(Exm_Hook_Thread));
+        if (!thread)
+            return;
+
+        thread->live = 1;
+        thread->stack = (const unsigned char *)stack;
+        thread->end = (const unsigned char *)end;
+        thread->next = EXM_ATOMIC_LOAD(&_exm_hook_threads);
+        while (!EXM_ATOMIC_CAS(&_exm_hook_threads, &thread->next, thread))
+            ;
+    }
+
+    thread->self = (const unsigned char *)self;
+    _exm_hook_thread = thread;
+}
+
+/* read the suppression files, the lock of the errors being taken */
+static void
+_exm_hook_suppression_load(void)
+{
+    char *buf;
+    char *iter;
+    size_t l;
+
+    if (_exm_hook_suppression_loaded)
+        return;
+
+    _exm_hook_suppression_loaded = 1;
+    if (!_exm_hook_suppressions)
+        return;
+
+    l = strlen(_exm_hook_suppressions) + 1;
+    buf = (char *)malloc(l);
+    _exm_hook_suppression = exm_suppression_new();
+    if (!buf || !_exm_hook_suppression)
+    {
+        EXM_LOG_ERR("Can not allocate memory for the suppressions");
+        exm_suppression_free(_exm_hook_suppression);
+        _exm_hook_suppression = NULL;
+        free(buf);
+        return;
+    }
+
+    memcpy(buf, _exm_hook_suppressions, l);
+    iter = buf;
+    while (iter)
+    {
+        char *sep;
+
+        sep = strchr(iter, EXM_HOOK_SUPPRESSIONS_SEP);
+        if (sep)
+            *sep++ = '\0';
+        if (*iter)
+            exm_suppression_file_add(_exm_hook_suppression, iter);
+        iter = sep;
+    }
+    free(buf);
+
+    EXM_LOG_DBG("%u suppressions read", exm_suppression_count(_exm_hook_suppression));
+}
+
+/*
+ * Errors are displayed when they occur, unless they are suppressed, so
+ * only their own stacks are symbolized here.
+ */
+static void
+_exm_hook_error_report(const Exm_Hook_Error_Data *data)
+{
+    Exm_Stack_Symbolizer *symbolizer;
+
+    if (!data)
+        return;
+
+    _exm_hook_suppression_load();
+
+    symbolizer = exm_stack_symbolizer_new();
+    if (!symbolizer)
+        return;
+
+    exm_hook_error_symbolizer_add(data, symbolizer);
+    exm_stack_symbolizer_run(symbolizer);
+    if (!exm_hook_error_suppressed(data, symbolizer))
+        exm_hook_error_disp(data, symbolizer);
+    exm_stack_symbolizer_free(symbolizer);
+}
+
+/*
+ * Errors are reported and stored one at a time, whatever the thread
+ * that makes them.
+ */
+static void
+_exm_hook_error_add(Exm_Hook_Error_Data *data)
+{
+    if (!data)
+        return;
+
+    EXM_LOCK(&_exm_hook_errors_lock);
+    _exm_hook_error_report(data);
+    exm_hook_errors = exm_list_append(exm_hook_errors, data);
+    EXM_UNLOCK(&_exm_hook_errors_lock);
+}
+
 /*
  * Overlapping:
  *
@@ -129,7 +604,7 @@ _exm_hook_memory_overlap(void *dst, const void *src, size_t dst_len, size_t src_
 }
 
 static Exm_Hook_Error_Data*
-_exm_hook_error_data_free_without_alloc_new(Exm_List *stack)
+_exm_hook_error_data_free_without_alloc_new(unsigned int stack)
 {
     Exm_Hook_Error_Data *data;
 
@@ -144,7 +619,7 @@ _exm_hook_error_data_free_without_alloc_new(Exm_List *stack)
 }
 
 static Exm_Hook_Error_Data*
-_exm_hook_error_data_multiple_frees_new(Exm_List *stack_free, Exm_Hook_Data_Alloc *da)
+_exm_hook_error_data_multiple_frees_new(unsigned int stack_free, const Exm_Tracker_Block *block)
 {
     Exm_Hook_Error_Data *data;
 
@@ -154,16 +629,16 @@ _exm_hook_error_data_multiple_frees_new(Exm_List *stack_free, Exm_Hook_Data_Allo
 
     data->error_type = EXM_HOOK_ERROR_MULTIPLE_FREES;
     data->error.multiple_frees.stack_free = stack_free;
-    data->error.multiple_frees.stack_alloc = da->stack;
-    data->error.multiple_frees.stack_first_free = da->stack_first_free;
-    data->error.multiple_frees.address_alloc = da->data;
-    data->error.multiple_frees.size_alloc = da->size;
+    data->error.multiple_frees.stack_alloc = block->stack;
+    data->error.multiple_frees.stack_first_free = block->stack_first_free;
+    data->error.multiple_frees.address_alloc = (void *)block->address;
+    data->error.multiple_frees.size_alloc = block->size;
 
     return data;
 }
 
 static Exm_Hook_Error_Data*
-_exm_hook_error_data_mismatched_free_new(Exm_List *stack_free, Exm_Hook_Data_Alloc *da)
+_exm_hook_error_data_mismatched_free_new(unsigned int stack_free, const Exm_Tracker_Block *block)
 {
     Exm_Hook_Error_Data *data;
 
@@ -173,15 +648,15 @@ _exm_hook_error_data_mismatched_free_new(Exm_List *stack_free, Exm_Hook_Data_All
 
     data->error_type = EXM_HOOK_ERROR_MISMATCHED_FREE;
     data->error.mismatched_free.stack_free = stack_free;
-    data->error.mismatched_free.stack_alloc = da->stack;
-    data->error.mismatched_free.address_alloc = da->data;
-    data->error.mismatched_free.size_alloc = da->size;
+    data->error.mismatched_free.stack_alloc = block->stack;
+    data->error.mismatched_free.address_alloc = (void *)block->address;
+    data->error.mismatched_free.size_alloc = block->size;
 
     return data;
 }
 
 static Exm_Hook_Error_Data*
-_exm_hook_error_data_memory_overlap_new(Exm_List *stack, void *dst, const void *src, size_t dst_len, size_t src_len, Exm_Hook_Fct fct)
+_exm_hook_error_data_memory_overlap_new(unsigned int stack, void *dst, const void *src, size_t dst_len, size_t src_len, Exm_Hook_Fct fct)
 {
     Exm_Hook_Error_Data *data;
 
@@ -200,99 +675,66 @@ _exm_hook_error_data_memory_overlap_new(Exm_List *stack, void *dst, const void *
     return data;
 }
 
-static void
-_exm_hook_error_data_del(void *ptr)
+static Exm_Hook_Error_Data*
+_exm_hook_error_data_redzone_new(unsigned int stack_free, const Exm_Tracker_Block *block, long long offset, size_t count)
 {
     Exm_Hook_Error_Data *data;
 
-    if (!ptr)
-        return;
+    data = (Exm_Hook_Error_Data *)calloc(1, sizeof(Exm_Hook_Error_Data));
+    if (!data)
+        return NULL;
 
-    data = (Exm_Hook_Error_Data *)ptr;
-    switch(data->error_type)
-    {
-        case EXM_HOOK_ERROR_FREE_WITHOUT_ALLOC:
-            exm_list_free(data->error.free_without_alloc.stack, exm_stack_data_free);
-            break;
-        case EXM_HOOK_ERROR_MULTIPLE_FREES:
-            exm_list_free(data->error.multiple_frees.stack_free, exm_stack_data_free);
-            break;
-        case EXM_HOOK_ERROR_MISMATCHED_FREE:
-            exm_list_free(data->error.mismatched_free.stack_free, exm_stack_data_free);
-            break;
-        case EXM_HOOK_ERROR_MEMORY_OVERLAP:
-            exm_list_free(data->error.memory_overlap.stack, exm_stack_data_free);
-            break;
-        default:
-            break;
-    }
+    data->error_type = EXM_HOOK_ERROR_REDZONE;
+    data->error.redzone.stack_free = stack_free;
+    data->error.redzone.stack_alloc = block->stack;
+    data->error.redzone.address_alloc = (void *)block->address;
+    data->error.redzone.size_alloc = block->size;
+    data->error.redzone.offset = offset;
+    data->error.redzone.count = count;
+
+    return data;
 }
 
-static Exm_Hook_Data_Alloc *
-_exm_hook_data_alloc_new(Exm_Hook_Fct fct, size_t size, void *data, unsigned char is_gdi, Exm_List *stack)
+static Exm_Hook_Error_Data*
+_exm_hook_error_data_freed_write_new(const Exm_Tracker_Block *block, long long offset, size_t count)
 {
-    Exm_Hook_Data_Alloc *da;
+    Exm_Hook_Error_Data *data;
 
-    if (!stack)
+    data = (Exm_Hook_Error_Data *)calloc(1, sizeof(Exm_Hook_Error_Data));
+    if (!data)
         return NULL;
 
-    da = (Exm_Hook_Data_Alloc *)calloc(1, sizeof(Exm_Hook_Data_Alloc));
-    if (!da)
-      return NULL;
+    data->error_type = EXM_HOOK_ERROR_FREED_WRITE;
+    data->error.freed_write.stack_free = block->stack_first_free;
+    data->error.freed_write.stack_alloc = block->stack;
+    data->error.freed_write.address_alloc = (void *)block->address;
+    data->error.freed_write.size_alloc = block->size;
+    data->error.freed_write.offset = offset;
+    data->error.freed_write.count = count;
 
-    da->fct = fct;
-    da->size = size;
-    da->data = data;
-    da->nbr_frees = 0;
-    da->stack = stack;
-    da->stack_first_free = NULL;
-    da->gdi32 = !!is_gdi;
-
-    return da;
+    return data;
 }
 
+#ifdef _WIN32
+
 static void
-_exm_hook_data_alloc_del(void *ptr)
+_exm_hook_error_data_del(void *ptr)
 {
-    Exm_Hook_Data_Alloc *da = ptr;
+    Exm_Hook_Error_Data *data;
 
-    if (!da)
+    if (!ptr)
         return;
 
-    exm_list_free(da->stack_first_free, exm_stack_data_free);
-    exm_list_free(da->stack, exm_stack_data_free);
-    free(da);
+    data = (Exm_Hook_Error_Data *)ptr;
+    free(data);
 }
 
-static void
-_exm_hook_allocations_sanitize(void *data)
-{
-    Exm_List *iter;
-
-    iter = exm_hook_allocations;
-    while (iter)
-    {
-        Exm_Hook_Data_Alloc *d;
-
-        d = (Exm_Hook_Data_Alloc *)iter->data;
-        if (data == d->data)
-        {
-            if (d->nbr_frees == 0)
-            {
-                /* we should never go there */
-                EXM_LOG_ERR("CRITICAL ERROR: The OS allocated memory twice on the same address (0x%p)",
-                            data);
-            }
-
-            exm_hook_allocations = exm_list_remove(exm_hook_allocations, data, _exm_hook_data_alloc_del);
-        }
-
-        iter = iter->next;
-    }
-}
+#endif
 
 typedef unsigned char (*Exm_Hook_Alloc_Free_Mismatch)(Exm_Hook_Fct fct);
 
+#ifdef _WIN32
+
 static unsigned char
 _exm_hook_rtlallocateheap_rtlfreeheap_mismatch(Exm_Hook_Fct fct)
 {
@@ -324,16 +766,24 @@ _exm_hook_localalloc_localfree_mismatch(Exm_Hook_Fct fct)
             (fct != EXM_HOOK_FCT_LOCALREALLOC));
 }
 
+#endif
+
 static unsigned char
 _exm_hook_malloc_free_mismatch(Exm_Hook_Fct fct)
 {
 
     return ((fct != EXM_HOOK_FCT_MALLOC) &&
+#ifndef _WIN32
+            /* the aligned memory is freed with free() on UNIX */
+            (fct != EXM_HOOK_FCT__ALIGNED_MALLOC) &&
+#endif
             (fct != EXM_HOOK_FCT__STRDUP) &&
             (fct != EXM_HOOK_FCT_CALLOC) &&
             (fct != EXM_HOOK_FCT_REALLOC));
 }
 
+#ifdef _WIN32
+
 static unsigned char
 _exm_hook_gdi_objects_mismatch(Exm_Hook_Fct fct)
 {
@@ -361,138 +811,331 @@ _exm_hook_gdi_objects_mismatch(Exm_Hook_Fct fct)
             (fct != EXM_HOOK_FCT_CREATEPALETTE));
 }
 
+#endif
+
+/* the guard must be entered */
 static void
-_exm_hook_alloc_manage(void *data, size_t size, unsigned char gdi32, Exm_Hook_Fct fct)
+_exm_hook_alloc_record(void *data, size_t size, unsigned int redzone, unsigned char gdi32, Exm_Hook_Fct fct)
 {
-    Exm_Hook_Data_Alloc *da;
-
-    _exm_hook_allocations_sanitize(data);
+    Exm_Hook_Summary *summary;
+    Exm_Tracker_Block block;
+    Exm_Tracker_Block old;
 
-    da = _exm_hook_data_alloc_new(fct, size, data, gdi32, exm_stack_frames_get());
-    if (da)
+    summary = _exm_hook_summary_thread_get();
+    if (summary)
     {
-        exm_hook_allocations = exm_list_append(exm_hook_allocations, da);
-    }
-
-    if (gdi32)
+        if (gdi32)
+        {
+            summary->total_count_gdi_handles++;
+        }
+        else
+        {
+            summary->total_count_allocs++;
+            summary->total_bytes_allocated += size;
+        }
+    }
+
+    /* the GDI handles are always recorded */
+    if (!gdi32 && !_exm_hook_sample(size))
+        return;
+
+    block.address = data;
+    block.size = size;
+    block.stack = _exm_hook_stack_new();
+    block.stack_first_free = 0;
+    block.frees = 0;
+    block.fct = (unsigned char)fct;
+    block.flags = gdi32 ? EXM_TRACKER_BLOCK_GDI : 0;
+    block.redzone = redzone;
+
+    /* a freed block recorded at the same address is replaced */
+    if (exm_tracker_block_add(exm_hook_tracker, &block, &old) &&
+        old.address && (old.frees == 0))
     {
-        exm_hook_summary.total_count_gdi_handles++;
+        /* we should never go there */
+        EXM_LOG_ERR("CRITICAL ERROR: The OS allocated memory twice on the same address (" EXM_HOOK_FMT_PTR ")",
+                    data);
     }
-    else
+
+    if (_exm_hook_sample_interval)
+        EXM_ATOMIC_ADD(_exm_hook_sampled + _exm_hook_sampled_slot(data), 1);
+
+    if (_exm_hook_timeline && !gdi32)
+        exm_timeline_block_add(_exm_hook_timeline, block.stack, size);
+}
+
+static void
+_exm_hook_alloc_manage(void *data, size_t size, unsigned char gdi32, Exm_Hook_Fct fct)
+{
+    if (!gdi32 && _exm_hook_alloc_counted(size))
+        return;
+
+    /* the memory allocated by the tracking code is not tracked */
+    if (!_exm_hook_guard_enter())
+        return;
+
+    _exm_hook_alloc_record(data, size, 0, gdi32, fct);
+    _exm_hook_guard_leave();
+}
+
+/*
+ * In sampling mode, only the recorded blocks are checked, and their
+ * records are removed when they are freed, as their addresses can be
+ * returned later for blocks that are not recorded.
+ */
+static void
+_exm_hook_free_sampled_manage(void *memblock, Exm_Hook_Alloc_Free_Mismatch mismatch_cb)
+{
+    Exm_Tracker_Block block;
+    unsigned int slot;
+
+    slot = _exm_hook_sampled_slot(memblock);
+    if (!EXM_ATOMIC_LOAD(_exm_hook_sampled + slot) ||
+        !exm_tracker_block_get(exm_hook_tracker, memblock, &block) ||
+        !exm_tracker_block_del(exm_hook_tracker, memblock))
+        return;
+
+    EXM_ATOMIC_ADD(_exm_hook_sampled + slot, -1);
+
+    if (_exm_hook_timeline && !(block.flags & EXM_TRACKER_BLOCK_GDI))
+        exm_timeline_block_del(_exm_hook_timeline, block.stack, block.size);
+
+    /* mismatched alloc / free */
+    if (mismatch_cb((Exm_Hook_Fct)block.fct))
     {
-        exm_hook_summary.total_count_allocs++;
-        exm_hook_summary.total_bytes_allocated += size;
+        Exm_Hook_Error_Data *err_data;
+
+        err_data = _exm_hook_error_data_mismatched_free_new(_exm_hook_stack_new(),
+                                                            &block);
+        _exm_hook_error_add(err_data);
     }
 }
 
+/*
+ * Return 1 if the memory can be freed. If freed is not NULL, the
+ * record of the block is stored in it on its first free, otherwise its
+ * address is set to NULL and its redzone to 0.
+ */
 static unsigned char
-_exm_hook_free_errors_manage(void *memblock, Exm_Hook_Alloc_Free_Mismatch mismatch_cb)
+_exm_hook_free_block_manage(void *memblock, Exm_Hook_Alloc_Free_Mismatch mismatch_cb, Exm_Tracker_Block *freed)
 {
     Exm_Hook_Error_Data *err_data = NULL;
-    Exm_List *iter_alloc;
-    unsigned char alloc_not_found = 1;
+    Exm_Hook_Summary *summary;
+    Exm_Tracker_Block block;
+    unsigned int stack;
     unsigned char no_free_error = 1;
 
-    iter_alloc = exm_hook_allocations;
-    while (iter_alloc)
+    if (freed)
+    {
+        freed->address = NULL;
+        freed->redzone = 0;
+    }
+
+    if (_exm_hook_free_counted(memblock))
+        return 1;
+
+    if (!_exm_hook_guard_enter())
+        return 1;
+
+    summary = _exm_hook_summary_thread_get();
+    if (summary)
+        summary->total_count_frees++;
+
+    if (_exm_hook_sample_interval)
+    {
+        _exm_hook_free_sampled_manage(memblock, mismatch_cb);
+        _exm_hook_guard_leave();
+        return 1;
+    }
+
+    stack = _exm_hook_stack_new();
+    if (exm_tracker_block_release(exm_hook_tracker, memblock, stack, &block))
     {
-        Exm_Hook_Data_Alloc *da;
+        if (_exm_hook_timeline && (block.frees == 1) &&
+            !(block.flags & EXM_TRACKER_BLOCK_GDI))
+            exm_timeline_block_del(_exm_hook_timeline, block.stack, block.size);
 
-        da = (Exm_Hook_Data_Alloc *)iter_alloc->data;
-        if (da->data == memblock)
+        /* multiple frees */
+        if (block.frees > 1)
         {
-            alloc_not_found = 0;
-            da->nbr_frees++;
+            err_data = _exm_hook_error_data_multiple_frees_new(stack, &block);
+            _exm_hook_error_add(err_data);
+            no_free_error = 0;
+        }
 
-            /* multiple frees */
-            if (da->nbr_frees > 1)
-            {
-                err_data = _exm_hook_error_data_multiple_frees_new(exm_stack_frames_get(),
-                                                                   da);
-                exm_hook_error_disp(err_data);
-                exm_hook_errors = exm_list_append(exm_hook_errors, err_data);
-                no_free_error = 0;
-            }
-            else
-                da->stack_first_free = exm_stack_frames_get();
+        /* mismatched alloc / free */
+        if (mismatch_cb((Exm_Hook_Fct)block.fct))
+        {
+            err_data = _exm_hook_error_data_mismatched_free_new(stack, &block);
+            _exm_hook_error_add(err_data);
+        }
+
+        /* the block is freed even if its redzones are overwritten */
+        if ((block.frees == 1) && block.redzone)
+        {
+            long long offset;
+            size_t count;
 
-            /* mismatched alloc / free */
-            if (mismatch_cb(da->fct))
+            count = exm_tracker_redzone_check(&block, &offset);
+            if (count > 0)
             {
-                err_data = _exm_hook_error_data_mismatched_free_new(exm_stack_frames_get(),
-                                                                    da);
-                exm_hook_error_disp(err_data);
-                exm_hook_errors = exm_list_append(exm_hook_errors, err_data);
+                err_data = _exm_hook_error_data_redzone_new(stack, &block, offset, count);
+                _exm_hook_error_add(err_data);
             }
-
-            break;
         }
-        iter_alloc = iter_alloc->next;
-    }
 
-    if (alloc_not_found)
+        if ((block.frees == 1) && freed)
+            *freed = block;
+    }
+    else
     {
-        err_data = _exm_hook_error_data_free_without_alloc_new(exm_stack_frames_get());
-        exm_hook_error_disp(err_data);
-        exm_hook_errors = exm_list_append(exm_hook_errors, err_data);
+        err_data = _exm_hook_error_data_free_without_alloc_new(stack);
+        _exm_hook_error_add(err_data);
         no_free_error = 0;
     }
 
-    exm_hook_summary.total_count_frees++;
+    _exm_hook_guard_leave();
 
     return no_free_error;
 }
 
+static unsigned char
+_exm_hook_free_errors_manage(void *memblock, Exm_Hook_Alloc_Free_Mismatch mismatch_cb)
+{
+    return _exm_hook_free_block_manage(memblock, mismatch_cb, NULL);
+}
+
+/* the poison of a block in quarantine, the guard must be entered */
 static void
-_exm_hook_realloc_manage(void *old_data, void *new_data, size_t new_size, Exm_Hook_Alloc_Free_Mismatch mismatch_cb)
+_exm_hook_quarantine_verify(const Exm_Tracker_Block *block)
 {
-    Exm_List *iter_alloc;
-    Exm_Hook_Data_Alloc *old_da = NULL;
+    long long offset;
+    size_t count;
 
-    /* Search for previous allocated memory */
-    iter_alloc = exm_hook_allocations;
-    while (iter_alloc)
-    {
-        Exm_Hook_Data_Alloc *da;
-        da = (Exm_Hook_Data_Alloc *)iter_alloc->data;
-        if (da->data == old_data)
-        {
-            Exm_Hook_Error_Data *err_data = NULL;
+    count = exm_tracker_poison_check(block, &offset);
+    if (count > 0)
+        _exm_hook_error_add(_exm_hook_error_data_freed_write_new(block, offset, count));
+}
 
-            /* mismatched alloc / free */
-            if (mismatch_cb(da->fct))
-            {
-                err_data = _exm_hook_error_data_mismatched_free_new(exm_stack_frames_get(),
-                                                                    da);
-                exm_hook_error_disp(err_data);
-                exm_hook_errors = exm_list_append(exm_hook_errors, err_data);
-            }
+static void
+_exm_hook_realloc_manage(void *old_data, void *new_data, size_t new_size, Exm_Hook_Alloc_Free_Mismatch mismatch_cb, Exm_Hook_Fct fct)
+{
+    Exm_Hook_Summary *summary;
+    Exm_Tracker_Block block;
 
-            old_da = da;
-            break;
-        }
-        iter_alloc = iter_alloc->next;
+    /* in sampling mode, the new block is sampled like a new allocation of fct */
+    if (_exm_hook_sample_interval)
+    {
+        _exm_hook_free_errors_manage(old_data, mismatch_cb);
+        _exm_hook_alloc_manage(new_data, new_size, 0, fct);
+        return;
     }
 
-    if (!old_da)
+    if (!_exm_hook_guard_enter())
+        return;
+
+    /* the record of the previous allocated memory is moved to new_data */
+    if (!exm_tracker_block_move(exm_hook_tracker, old_data, new_data, new_size, &block))
     {
         /* FIXME: add error ? */
         EXM_LOG_WARN("Memory allocation not found when realloc() is called.");
+        _exm_hook_guard_leave();
         return;
     }
 
-    if (new_data != old_data)
+    /* the block keeps its allocation site */
+    if (_exm_hook_timeline && (block.frees == 0))
+    {
+        exm_timeline_block_del(_exm_hook_timeline, block.stack, block.size);
+        exm_timeline_block_add(_exm_hook_timeline, block.stack, new_size);
+    }
+
+    /* mismatched alloc / free */
+    if (mismatch_cb((Exm_Hook_Fct)block.fct))
+    {
+        Exm_Hook_Error_Data *err_data;
+
+        err_data = _exm_hook_error_data_mismatched_free_new(_exm_hook_stack_new(),
+                                                            &block);
+        _exm_hook_error_add(err_data);
+    }
+
+    summary = _exm_hook_summary_thread_get();
+    if (summary)
+    {
+        if (new_data != old_data)
+        {
+            /* there is a alloc + free */
+            summary->total_count_allocs++;
+            summary->total_count_frees++;
+        }
+
+        /* update memory */
+        summary->total_bytes_allocated += new_size - block.size;
+    }
+
+    _exm_hook_guard_leave();
+}
+
+/* the state is created before any allocation is tracked */
+static unsigned char
+_exm_hook_state_new(void)
+{
+    exm_stack_init();
+
+    exm_hook_stack_depot = exm_stack_depot_new();
+    if (!exm_hook_stack_depot)
+    {
+        EXM_LOG_ERR("Can not create the stack depot");
+        return 0;
+    }
+
+    exm_hook_tracker = exm_tracker_new();
+    if (!exm_hook_tracker)
+    {
+        EXM_LOG_ERR("Can not create the allocation tracker");
+        goto free_depot;
+    }
+
+    if (!EXM_LOCK_INIT(&_exm_hook_errors_lock))
+    {
+        EXM_LOG_ERR("Can not create the lock of the errors");
+        goto free_tracker;
+    }
+
+    exm_hook_errors = NULL;
+
+    if (_exm_hook_redzone && _exm_hook_sample_interval)
+    {
+        EXM_LOG_WARN("The redzones are not used in sampling mode");
+        _exm_hook_redzone = 0;
+    }
+
+    if (_exm_hook_quarantine_budget && _exm_hook_sample_interval)
     {
-        /* there is a alloc + free */
-        exm_hook_summary.total_count_allocs++;
-        exm_hook_summary.total_count_frees++;
+        EXM_LOG_WARN("The quarantine is not used in sampling mode");
+        _exm_hook_quarantine_budget = 0;
     }
 
-    /* update memory */
-    exm_hook_summary.total_bytes_allocated += (new_size - old_da->size);
-    old_da->size = new_size;
+    /* the program is run without the timeline if its file can not be created */
+    if (_exm_hook_timeline_filename)
+        _exm_hook_timeline = exm_timeline_new(_exm_hook_timeline_filename,
+                                              _exm_hook_sample_interval);
+
+    return 1;
+
+  free_tracker:
+    exm_tracker_free(exm_hook_tracker);
+    exm_hook_tracker = NULL;
+  free_depot:
+    exm_stack_depot_free(exm_hook_stack_depot);
+    exm_hook_stack_depot = NULL;
+
+    return 0;
 }
 
+#ifdef _WIN32
+
 /*
  * Hooking functions
  */
@@ -574,7 +1217,8 @@ _exm_hook_HeapReAlloc(HANDLE hHeap, DWORD dwFlags, LPVOID lpMem, SIZE_T dwBytes)
     /* if data is NULL, nothing is done */
     if (data)
         _exm_hook_realloc_manage(lpMem, data, dwBytes,
-                                 _exm_hook_heapalloc_heapfree_mismatch);
+                                 _exm_hook_heapalloc_heapfree_mismatch,
+                                 EXM_HOOK_FCT_HEAPREALLOC);
 
     return data;
 }
@@ -635,7 +1279,8 @@ _exm_hook_GlobalReAlloc(HGLOBAL hMem, SIZE_T dwBytes, UINT uFlags)
     /* if data is NULL, nothing is done */
     if (data)
         _exm_hook_realloc_manage(hMem, data, dwBytes,
-                                 _exm_hook_globalalloc_globalfree_mismatch);
+                                 _exm_hook_globalalloc_globalfree_mismatch,
+                                 EXM_HOOK_FCT_GLOBALREALLOC);
 
     return data;
 }
@@ -694,7 +1339,8 @@ _exm_hook_LocalReAlloc(HLOCAL hMem, SIZE_T uBytes, UINT uFlags)
     /* if data is NULL, nothing is done */
     if (data)
         _exm_hook_realloc_manage(hMem, data, uBytes,
-                                 _exm_hook_localalloc_localfree_mismatch);
+                                 _exm_hook_localalloc_localfree_mismatch,
+                                 EXM_HOOK_FCT_LOCALREALLOC);
 
     return data;
 }
@@ -1262,8 +1908,6 @@ _exm_hook_realloc(void *memblock, size_t size)
                 rea = (exm_realloc_t)_exm_hook_instance[EXM_HOOK_FCT_REALLOC].fct_proc_old;
                 data = rea(memblock, size);
             }
-
-            exm_hook_summary.total_count_frees++;
         }
         else
         {
@@ -1275,7 +1919,8 @@ _exm_hook_realloc(void *memblock, size_t size)
             /* if data is NULL, nothing is done */
             if (data)
                 _exm_hook_realloc_manage(memblock, data, size,
-                                         _exm_hook_malloc_free_mismatch);
+                                         _exm_hook_malloc_free_mismatch,
+                                         EXM_HOOK_FCT_REALLOC);
         }
     }
 
@@ -1299,7 +1944,8 @@ _exm_hook__expand(void *memblock, size_t size)
     /* if data is NULL, nothing is done */
     if (data)
         _exm_hook_realloc_manage(memblock, data, size,
-                                 _exm_hook_malloc_free_mismatch);
+                                 _exm_hook_malloc_free_mismatch,
+                                 EXM_HOOK_FCT_REALLOC);
 
     return data;
 }
@@ -1328,13 +1974,14 @@ _exm_hook_memcpy(void *dest, const void *src, size_t count)
 
     EXM_LOG_WARN("memcpy !!!");
 
-    if (_exm_hook_memory_overlap(dest, src, count, count))
+    if (_exm_hook_memory_overlap(dest, src, count, count) &&
+        _exm_hook_guard_enter())
     {
         Exm_Hook_Error_Data *err_data;
 
-        err_data = _exm_hook_error_data_memory_overlap_new(exm_stack_frames_get(), dest, src, count, count, EXM_HOOK_FCT_MEMCPY);
-        exm_hook_error_disp(err_data);
-        exm_hook_errors = exm_list_append(exm_hook_errors, err_data);
+        err_data = _exm_hook_error_data_memory_overlap_new(_exm_hook_stack_new(), dest, src, count, count, EXM_HOOK_FCT_MEMCPY);
+        _exm_hook_error_add(err_data);
+        _exm_hook_guard_leave();
     }
 
     mcpy = (exm_memcpy_t)_exm_hook_instance[EXM_HOOK_FCT_MEMCPY].fct_proc_old;
@@ -1353,13 +2000,14 @@ _exm_hook_strcat(char *strDestination, const char *strSource)
 
     dst_len = strlen(strDestination);
     src_len = strlen(strSource);
-    if (_exm_hook_memory_overlap(strDestination, strSource, dst_len, src_len))
+    if (_exm_hook_memory_overlap(strDestination, strSource, dst_len, src_len) &&
+        _exm_hook_guard_enter())
     {
         Exm_Hook_Error_Data *err_data;
 
-        err_data = _exm_hook_error_data_memory_overlap_new(exm_stack_frames_get(), strDestination, strSource, dst_len, src_len, EXM_HOOK_FCT_STRCAT);
-        exm_hook_error_disp(err_data);
-        exm_hook_errors = exm_list_append(exm_hook_errors, err_data);
+        err_data = _exm_hook_error_data_memory_overlap_new(_exm_hook_stack_new(), strDestination, strSource, dst_len, src_len, EXM_HOOK_FCT_STRCAT);
+        _exm_hook_error_add(err_data);
+        _exm_hook_guard_leave();
     }
 
     cat = (exm_strcat_t)_exm_hook_instance[EXM_HOOK_FCT_STRCAT].fct_proc_old;
@@ -1378,13 +2026,14 @@ _exm_hook__mbscat(unsigned char *strDestination, const unsigned char *strSource)
 
     dst_len = _mbslen(strDestination);
     src_len = _mbslen(strSource);
-    if (_exm_hook_memory_overlap(strDestination, strSource, dst_len, src_len))
+    if (_exm_hook_memory_overlap(strDestination, strSource, dst_len, src_len) &&
+        _exm_hook_guard_enter())
     {
         Exm_Hook_Error_Data *err_data;
 
-        err_data = _exm_hook_error_data_memory_overlap_new(exm_stack_frames_get(), strDestination, strSource, dst_len, src_len, EXM_HOOK_FCT__MBSCAT);
-        exm_hook_error_disp(err_data);
-        exm_hook_errors = exm_list_append(exm_hook_errors, err_data);
+        err_data = _exm_hook_error_data_memory_overlap_new(_exm_hook_stack_new(), strDestination, strSource, dst_len, src_len, EXM_HOOK_FCT__MBSCAT);
+        _exm_hook_error_add(err_data);
+        _exm_hook_guard_leave();
     }
 
     cat = (exm__mbscat_t)_exm_hook_instance[EXM_HOOK_FCT__MBSCAT].fct_proc_old;
@@ -1494,134 +2143,906 @@ _exm_unhook_set(const char *mod_name, const Exm_List *dep_names, int idx_begin,
     }
 }
 
+#else /* !_WIN32 */
 
-/*============================================================================*
- *                                 Global                                     *
- *============================================================================*/
+/*
+ * On UNIX, the library is preloaded in the process, so that the
+ * functions below are found before the ones of the C library, by the
+ * program and by all the libraries. The allocators of the C library
+ * are called with the names that it exports for that purpose, as
+ * dlsym() can allocate memory.
+ */
 
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t nmemb, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
 
-#define EXM_HOOK_FCT_SET(type, mod, sym) \
-do \
-{ \
-    _exm_hook_instance[type].fct = type; \
-    _exm_hook_instance[type].fct_proc_old = GetProcAddress(mod, #sym); \
-    if (!_exm_hook_instance[type].fct_proc_old) \
-    { \
-        EXM_LOG_WARN("REDIR: redirection of %s failed", #sym);   \
-        _exm_hook_instance[type].fct_proc_new = NULL; \
-    } \
-    else \
-    { \
-        char buf[MAX_PATH]; \
-        _exm_hook_instance[type].fct_proc_new = (FARPROC)_exm_hook_ ## sym; \
-        if (GetModuleFileName(mod, buf, sizeof(buf))) \
-            EXM_LOG_INFO("REDIR: 0x%p (%s:%s) redirected to 0x%p (%s%s)", \
-                         _exm_hook_instance[type].fct_proc_old, \
-                         strrchr(buf, '\\') + 1, #sym, \
-                         _exm_hook_instance[type].fct_proc_new, \
-                         "_exm_hook_", #sym); \
-        else \
-            EXM_LOG_INFO("REDIR: 0x%p (%s) redirected to 0x%p (%s)", \
-                         _exm_hook_instance[type].fct_proc_old, #sym, \
-                         _exm_hook_instance[type].fct_proc_new, \
-                         "_exm_hook_", #sym); \
-    } \
-} while (0)
+typedef void *(*Exm_Hook_Memcpy)(void *dest, const void *src, size_t n);
+typedef char *(*Exm_Hook_Strcat)(char *dest, const char *src);
+typedef void (*Exm_Hook_Exit)(int status) __attribute__((noreturn));
+typedef size_t (*Exm_Hook_Malloc_Usable_Size)(void *ptr);
+typedef int (*Exm_Hook_Pthread_Create)(pthread_t *thread, const pthread_attr_t *attr, void *(*start_routine)(void *), void *arg);
 
+typedef struct
+{
+    void *(*start_routine)(void *);
+    void *arg;
+} Exm_Hook_Thread_Start;
 
-Exm_List *exm_hook_allocations;
-Exm_List *exm_hook_errors;
-Exm_List *exm_hook_gdi_handles;
-Exm_Hook_Summary exm_hook_summary;
+typedef enum
+{
+    EXM_HOOK_STATUS_NONE,
+    EXM_HOOK_STATUS_READY,
+    EXM_HOOK_STATUS_DONE
+} Exm_Hook_Status;
 
-unsigned char
-exm_hook_init(const Exm_List *crt_names, const Exm_List *dep_names)
+static pthread_once_t _exm_hook_once = PTHREAD_ONCE_INIT;
+static int _exm_hook_status = EXM_HOOK_STATUS_NONE;
+static pthread_key_t _exm_hook_thread_key;
+static EXM_TLS unsigned char _exm_hook_thread_registered = 0;
+static Exm_Hook_Memcpy _exm_hook_memcpy_next = NULL;
+static Exm_Hook_Strcat _exm_hook_strcat_next = NULL;
+static Exm_Hook_Exit _exm_hook_exit_next = NULL;
+static Exm_Hook_Malloc_Usable_Size _exm_hook_malloc_usable_size_next = NULL;
+static Exm_Hook_Pthread_Create _exm_hook_pthread_create_next = NULL;
+static const void *_exm_hook_exit_stack = NULL;
+
+/* the memory held by a block in quarantine, with the overhead of the C library */
+static size_t
+_exm_hook_quarantine_bytes(const Exm_Tracker_Block *block)
 {
-    const Exm_List *iter_crt;
-    char *mod_name;
-    HMODULE mod;
+    return ((block->size + 15) & ~(size_t)15) + 2 * (size_t)block->redzone + 16;
+}
 
-    mod_name = "ntdll.dll";
+/*
+ * Return the oldest blocks in the quarantine of the thread to the C
+ * library, until the memory they hold is at most bytes.
+ */
+static void
+_exm_hook_quarantine_release(size_t bytes)
+{
+    Exm_Hook_Quarantine *quarantine;
+    unsigned char guard;
 
-    mod = LoadLibrary(mod_name);
-    if (mod)
+    quarantine = &_exm_hook_quarantine;
+    guard = _exm_hook_guard_enter();
+    while ((quarantine->nbr > 0) && (quarantine->bytes > bytes))
     {
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_RTLALLOCATEHEAP, mod, RtlAllocateHeap);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_RTLFREEHEAP, mod, RtlFreeHeap);
+        const Exm_Tracker_Block *block;
+
+        block = quarantine->blocks + quarantine->first;
+        if (_exm_hook_quarantine_poison && guard)
+            _exm_hook_quarantine_verify(block);
+        quarantine->bytes -= _exm_hook_quarantine_bytes(block);
+        __libc_free((unsigned char *)block->address - block->redzone);
+        quarantine->first = (quarantine->first + 1) & (quarantine->max - 1);
+        quarantine->nbr--;
+    }
+    if (guard)
+        _exm_hook_guard_leave();
+}
 
-        EXM_LOG_DBG("Hooking %s", mod_name);
-        _exm_hook_set(mod_name, dep_names,
-                      EXM_HOOK_FCT_NTDLL_BEGIN, EXM_HOOK_FCT_NTDLL_END);
+/* return 1 if the freed block is kept in the quarantine of the thread */
+static unsigned char
+_exm_hook_quarantine_add(const Exm_Tracker_Block *block)
+{
+    Exm_Hook_Quarantine *quarantine;
+    size_t bytes;
 
-        FreeLibrary(mod);
+    bytes = _exm_hook_quarantine_bytes(block);
+    if (bytes > _exm_hook_quarantine_budget)
+        return 0;
+
+    quarantine = &_exm_hook_quarantine;
+    if (quarantine->nbr == quarantine->max)
+    {
+        Exm_Tracker_Block *blocks;
+        size_t max;
+        size_t i;
+
+        max = quarantine->max ? 2 * quarantine->max : 256;
+        blocks = (Exm_Tracker_Block *)__libc_malloc(max * sizeof(Exm_Tracker_Block));
+        if (!blocks)
+            return 0;
+
+        for (i = 0; i < quarantine->nbr; i++)
+            blocks[i] = quarantine->blocks[(quarantine->first + i) & (quarantine->max - 1)];
+        __libc_free(quarantine->blocks);
+        quarantine->blocks = blocks;
+        quarantine->max = max;
+        quarantine->first = 0;
     }
 
-    mod_name = "kernel32.dll";
+    if (_exm_hook_quarantine_poison)
+        exm_tracker_poison_set(block);
 
-    mod = LoadLibrary(mod_name);
-    if (mod)
-    {
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_HEAPALLOC, mod, HeapAlloc);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_HEAPREALLOC, mod, HeapReAlloc);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_HEAPFREE, mod, HeapFree);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_GLOBALALLOC, mod, GlobalAlloc);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_GLOBALREALLOC, mod, GlobalReAlloc);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_GLOBALFREE, mod, GlobalFree);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_LOCALALLOC, mod, LocalAlloc);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_LOCALREALLOC, mod, LocalReAlloc);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_LOCALFREE, mod, LocalFree);
+    quarantine->blocks[(quarantine->first + quarantine->nbr) & (quarantine->max - 1)] = *block;
+    quarantine->nbr++;
+    quarantine->bytes += bytes;
 
-        EXM_LOG_DBG("Hooking %s", mod_name);
-        _exm_hook_set(mod_name, dep_names,
-                      EXM_HOOK_FCT_KERNEL32_BEGIN, EXM_HOOK_FCT_KERNEL32_END);
+    /* a quarter of the budget is released at once */
+    if (quarantine->bytes > _exm_hook_quarantine_budget)
+        _exm_hook_quarantine_release(_exm_hook_quarantine_budget - _exm_hook_quarantine_budget / 4);
 
-        FreeLibrary(mod);
-    }
+    return 1;
+}
 
-    mod_name = "gdi32.dll";
+static void
+_exm_hook_thread_exit(void *data EXM_UNUSED)
+{
+    _exm_hook_quarantine_release(0);
+    __libc_free(_exm_hook_quarantine.blocks);
+    memset(&_exm_hook_quarantine, 0, sizeof(Exm_Hook_Quarantine));
 
-    mod = LoadLibrary(mod_name);
-    if (mod)
-    {
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEBITMAP, mod, CreateBitmap);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEBITMAPINDIRECT, mod, CreateBitmapIndirect);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATECOMPATIBLEBITMAP, mod, CreateCompatibleBitmap);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEDIBITMAP, mod, CreateDIBitmap);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEDIBSECTION, mod, CreateDIBSection);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEBRUSHINDIRECT, mod, CreateBrushIndirect);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEDIBPATTERNBRUSH, mod, CreateDIBPatternBrush);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEDIBPATTERNBRUSHPT, mod, CreateDIBPatternBrushPt);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEHATCHBRUSH, mod, CreateHatchBrush);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEPATTERNBRUSH, mod, CreatePatternBrush);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATESOLIDBRUSH, mod, CreateSolidBrush);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEFONT, mod, CreateFont);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEFONTINDIRECT, mod, CreateFontIndirect);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEPEN, mod, CreatePen);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEPENINDIRECT, mod, CreatePenIndirect);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEELLIPTICRGN, mod, CreateEllipticRgn);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEELLIPTICRGNINDIRECT, mod, CreateEllipticRgnIndirect);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEPOLYGONRGN, mod, CreatePolygonRgn);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATERECTRGN, mod, CreateRectRgn);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATERECTRGNINDIRECT, mod, CreateRectRgnIndirect);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEPALETTE, mod, CreatePalette);
-        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_DELETEOBJECT, mod, DeleteObject);
+    exm_hook_thread_shutdown();
+}
 
-        EXM_LOG_DBG("Hooking %s", mod_name);
-        _exm_hook_set(mod_name, dep_names,
-                      EXM_HOOK_FCT_GDI32_BEGIN, EXM_HOOK_FCT_GDI32_END);
+/* in the child process, only the thread that called fork() is left */
+static void
+_exm_hook_thread_fork_child(void)
+{
+    Exm_Hook_Thread *thread;
 
-        FreeLibrary(mod);
+    for (thread = EXM_ATOMIC_LOAD(&_exm_hook_threads); thread; thread = thread->next)
+    {
+        if (thread != _exm_hook_thread)
+            EXM_ATOMIC_STORE(&thread->live, 0);
     }
+}
 
-    iter_crt = crt_names;
-    while (iter_crt)
-    {
-        mod_name = (char *)iter_crt->data;
+/*
+ * The stack of a new thread is recorded before its function is called.
+ * With the C library of GNU, its static TLS and its descriptor are at
+ * the end of its stack.
+ */
+static void *
+_exm_hook_thread_start(void *data)
+{
+    Exm_Hook_Thread_Start start;
+    pthread_attr_t attr;
+    void *stack;
+    size_t size;
+    size_t guard;
 
-        mod = LoadLibrary(mod_name);
-        if (mod)
+    start = *(Exm_Hook_Thread_Start *)data;
+    __libc_free(data);
+
+    /* pthread_getattr_np() allocates memory */
+    if (exm_hook_init() && _exm_hook_guard_enter())
+    {
+        if (pthread_getattr_np(pthread_self(), &attr) == 0)
         {
-            EXM_HOOK_FCT_SET(EXM_HOOK_FCT_MALLOC, mod, malloc);
+            /* the old versions of the C library count the guard in the stack */
+            if ((pthread_attr_getstack(&attr, &stack, &size) == 0) &&
+                (pthread_attr_getguardsize(&attr, &guard) == 0) &&
+                (guard < size))
+                _exm_hook_thread_add((unsigned char *)stack + guard,
+                                     (unsigned char *)stack + size,
+                                     (const void *)pthread_self());
+            pthread_attr_destroy(&attr);
+        }
+        _exm_hook_guard_leave();
+    }
+
+    return start.start_routine(start.arg);
+}
+
+/* Return 1 if the pages of the given memory are mapped. */
+static unsigned char
+_exm_hook_memory_mapped(const void *start, size_t size)
+{
+    unsigned char vec[16];
+    uintptr_t page;
+    uintptr_t s;
+
+    page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    s = (uintptr_t)start & ~(page - 1);
+    if ((uintptr_t)start + size - s > sizeof(vec) * page)
+        return 0;
+
+    return mincore((void *)s, (uintptr_t)start + size - s, vec) == 0;
+}
+
+static void
+_exm_hook_once_init(void)
+{
+    const char *level;
+    const char *interval;
+    const char *redzone;
+    const char *quarantine;
+    const char *poison;
+    const char *num_callers;
+    const char *leak_limit;
+    const char *suppressions;
+    const char *gen_suppressions;
+    const char *timeline;
+    int status = EXM_HOOK_STATUS_DONE;
+
+    /* set by the Memcheck tool */
+    level = getenv("EXM_MEMCHECK_LOG_LEVEL");
+    if (level)
+        exm_log_level_set((Exm_Log_Level)atoi(level));
+
+    interval = getenv("EXM_MEMCHECK_SAMPLE_INTERVAL");
+    if (interval)
+        exm_hook_sample_interval_set((size_t)strtoul(interval, NULL, 10));
+
+    redzone = getenv("EXM_MEMCHECK_REDZONE");
+    if (redzone)
+        exm_hook_redzone_set((size_t)strtoul(redzone, NULL, 10));
+
+    quarantine = getenv("EXM_MEMCHECK_QUARANTINE");
+    poison = getenv("EXM_MEMCHECK_POISON");
+    if (quarantine)
+        exm_hook_quarantine_set((size_t)strtoul(quarantine, NULL, 10),
+                                !poison || (atoi(poison) != 0));
+
+    num_callers = getenv("EXM_MEMCHECK_NUM_CALLERS");
+    if (num_callers)
+        exm_hook_num_callers_set((unsigned int)strtoul(num_callers, NULL, 10));
+
+    leak_limit = getenv("EXM_MEMCHECK_LEAK_LIMIT");
+    if (leak_limit)
+        exm_hook_leak_limit_set((size_t)strtoul(leak_limit, NULL, 10));
+
+    suppressions = getenv("EXM_MEMCHECK_SUPPRESSIONS");
+    if (suppressions && *suppressions)
+        exm_hook_suppressions_set(suppressions);
+
+    gen_suppressions = getenv("EXM_MEMCHECK_GEN_SUPPRESSIONS");
+    if (gen_suppressions && *gen_suppressions)
+        exm_hook_gen_suppressions_set(gen_suppressions);
+
+    timeline = getenv("EXM_MEMCHECK_TIMELINE");
+    if (timeline && *timeline)
+        exm_hook_timeline_set(timeline);
+
+    if (_exm_hook_state_new())
+    {
+        *(void **)&_exm_hook_memcpy_next = dlsym(RTLD_NEXT, "memcpy");
+        *(void **)&_exm_hook_strcat_next = dlsym(RTLD_NEXT, "strcat");
+        *(void **)&_exm_hook_malloc_usable_size_next = dlsym(RTLD_NEXT, "malloc_usable_size");
+        if (_exm_hook_memcpy_next && _exm_hook_strcat_next &&
+            _exm_hook_malloc_usable_size_next &&
+            (pthread_key_create(&_exm_hook_thread_key, _exm_hook_thread_exit) == 0) &&
+            (pthread_atfork(NULL, NULL, _exm_hook_thread_fork_child) == 0))
+            status = EXM_HOOK_STATUS_READY;
+        else
+            EXM_LOG_ERR("Can not find the functions of the C library");
+    }
+
+    __atomic_store_n(&_exm_hook_status, status, __ATOMIC_RELEASE);
+}
+
+/*
+ * Return 1 if a new block is allocated with redzones, the guard being
+ * then entered. The memory of the tracking code has no redzones.
+ */
+static unsigned char
+_exm_hook_redzone_enter(void)
+{
+    return exm_hook_init() && _exm_hook_redzone && _exm_hook_guard_enter();
+}
+
+/*
+ * Allocate a block with redzones, aligned on alignment if not 0, and
+ * zeroed if zero is not 0. The guard is left.
+ */
+static void *
+_exm_hook_redzone_alloc(size_t alignment, size_t size, unsigned char zero, Exm_Hook_Fct fct)
+{
+    unsigned char *base;
+    unsigned int front;
+    size_t total;
+    void *data = NULL;
+
+    total = exm_tracker_redzone_size_get(size, _exm_hook_redzone, alignment, &front);
+    if (total == 0)
+    {
+        _exm_hook_guard_leave();
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if (alignment)
+        base = (unsigned char *)__libc_memalign(alignment, total);
+    else if (zero)
+        base = (unsigned char *)__libc_calloc(1, total);
+    else
+        base = (unsigned char *)__libc_malloc(total);
+
+    if (base)
+    {
+        data = exm_tracker_redzone_set(base, size, front);
+        _exm_hook_alloc_record(data, size, front, 0, fct);
+    }
+
+    _exm_hook_guard_leave();
+
+    return data;
+}
+
+/*
+ * After the shutdown, the records are still read, as a block with
+ * redzones starts before its address and a freed block can be in
+ * quarantine. Return 0 if the memory of ptr must not be given to the
+ * C library, otherwise the record of the block is stored in block,
+ * its redzone being 0 if it has none, and is deleted if del is not 0,
+ * as the address can then be reused by a block which is not tracked.
+ */
+static unsigned char
+_exm_hook_done_block_get(const void *ptr, unsigned char del, Exm_Tracker_Block *block)
+{
+    unsigned char res = 1;
+
+    block->address = NULL;
+    block->redzone = 0;
+
+    if ((!_exm_hook_redzone && !_exm_hook_quarantine_budget) ||
+        !_exm_hook_guard_enter())
+        return 1;
+
+    if (exm_tracker_block_get(exm_hook_tracker, ptr, block))
+    {
+        if (block->frees > 0)
+            res = 0;
+        else if (del)
+            exm_tracker_block_del(exm_hook_tracker, ptr);
+    }
+    else
+    {
+        block->address = NULL;
+        block->redzone = 0;
+    }
+
+    _exm_hook_guard_leave();
+
+    return res;
+}
+
+/*
+ * The memory of a block with redzones starts before it, and a freed
+ * block can be kept in quarantine.
+ */
+static void
+_exm_hook_libc_free(void *ptr)
+{
+    Exm_Tracker_Block block;
+
+    block.address = NULL;
+    block.redzone = 0;
+
+    if (ptr && !exm_hook_init())
+    {
+        if (_exm_hook_done_block_get(ptr, 1, &block))
+            __libc_free((unsigned char *)ptr - block.redzone);
+        return;
+    }
+
+    /* the memory is not freed if the free is invalid */
+    if (ptr && !_exm_hook_free_counted(ptr) &&
+        !_exm_hook_free_block_manage(ptr, _exm_hook_malloc_free_mismatch, &block))
+        return;
+
+    if (block.address && _exm_hook_quarantine_budget &&
+        _exm_hook_quarantine_add(&block))
+        return;
+
+    __libc_free((unsigned char *)ptr - block.redzone);
+}
+
+static void *
+_exm_hook_aligned_alloc(size_t alignment, size_t size)
+{
+    void *data;
+
+    /* the alignment is a power of 2 for the redzones */
+    if (!(alignment & (alignment - 1)) && _exm_hook_redzone_enter())
+        return _exm_hook_redzone_alloc(alignment, size, 0, EXM_HOOK_FCT__ALIGNED_MALLOC);
+
+    data = __libc_memalign(alignment, size);
+    if (data && !_exm_hook_alloc_counted(size) && exm_hook_init())
+        _exm_hook_alloc_manage(data, size, 0, EXM_HOOK_FCT__ALIGNED_MALLOC);
+
+    return data;
+}
+
+void *
+malloc(size_t size)
+{
+    void *data;
+
+    if (_exm_hook_redzone_enter())
+        return _exm_hook_redzone_alloc(0, size, 0, EXM_HOOK_FCT_MALLOC);
+
+    data = __libc_malloc(size);
+    /* in sampling mode, most of the blocks are only counted */
+    if (data && !_exm_hook_alloc_counted(size) && exm_hook_init())
+        _exm_hook_alloc_manage(data, size, 0, EXM_HOOK_FCT_MALLOC);
+
+    return data;
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+    void *data;
+
+    if (!(size && (nmemb > (size_t)-1 / size)) && _exm_hook_redzone_enter())
+        return _exm_hook_redzone_alloc(0, nmemb * size, 1, EXM_HOOK_FCT_CALLOC);
+
+    data = __libc_calloc(nmemb, size);
+    if (data && !_exm_hook_alloc_counted(nmemb * size) && exm_hook_init())
+        _exm_hook_alloc_manage(data, nmemb * size, 0, EXM_HOOK_FCT_CALLOC);
+
+    return data;
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+    Exm_Tracker_Block block;
+    void *data;
+
+    if (!exm_hook_init())
+    {
+        if (!ptr)
+            return __libc_malloc(size);
+
+        if (size == 0)
+        {
+            _exm_hook_libc_free(ptr);
+            return NULL;
+        }
+
+        if (!_exm_hook_done_block_get(ptr, 0, &block))
+            return NULL;
+
+        if (!block.redzone)
+            return __libc_realloc(ptr, size);
+
+        data = __libc_malloc(size);
+        if (data)
+        {
+            memcpy(data, ptr, (size < block.size) ? size : block.size);
+            _exm_hook_libc_free(ptr);
+        }
+
+        return data;
+    }
+
+    if (!ptr)
+    {
+        /* malloc() is actually called */
+
+        if (_exm_hook_redzone_enter())
+            return _exm_hook_redzone_alloc(0, size, 0, EXM_HOOK_FCT_REALLOC);
+
+        data = __libc_realloc(ptr, size);
+        if (data)
+            _exm_hook_alloc_manage(data, size, 0, EXM_HOOK_FCT_REALLOC);
+
+        return data;
+    }
+
+    if (size == 0)
+    {
+        /* free() is actually called */
+
+        _exm_hook_libc_free(ptr);
+
+        return NULL;
+    }
+
+    /*
+     * a block with redzones is moved, its new size being between them,
+     * and an invalid realloc is only reported, its address being inside
+     * the memory of another block, not being the one of a block, or
+     * being the one of a block in quarantine
+     */
+    if ((_exm_hook_redzone || _exm_hook_quarantine_budget) &&
+        _exm_hook_guard_enter())
+    {
+        unsigned char found;
+
+        found = exm_tracker_block_get(exm_hook_tracker, ptr, &block);
+        if (found && (block.frees == 0) && block.redzone)
+        {
+            data = _exm_hook_redzone_alloc(0, size, 0, EXM_HOOK_FCT_REALLOC);
+            if (data)
+            {
+                memmove(data, ptr, (size < block.size) ? size : block.size);
+                _exm_hook_libc_free(ptr);
+            }
+
+            return data;
+        }
+
+        _exm_hook_guard_leave();
+
+        if (!found || (block.frees > 0))
+        {
+            _exm_hook_free_errors_manage(ptr, _exm_hook_malloc_free_mismatch);
+            return NULL;
+        }
+    }
+
+    /* we re-alloc memory */
+
+    data = __libc_realloc(ptr, size);
+
+    /* if data is NULL, nothing is done */
+    if (data)
+        _exm_hook_realloc_manage(ptr, data, size,
+                                 _exm_hook_malloc_free_mismatch,
+                                 EXM_HOOK_FCT_REALLOC);
+
+    return data;
+}
+
+void
+free(void *ptr)
+{
+    _exm_hook_libc_free(ptr);
+}
+
+/*
+ * The aligned allocators of the C library must all be interposed, as
+ * their memory is freed with free().
+ */
+
+void *
+aligned_alloc(size_t alignment, size_t size)
+{
+    return _exm_hook_aligned_alloc(alignment, size);
+}
+
+void *
+memalign(size_t alignment, size_t size)
+{
+    return _exm_hook_aligned_alloc(alignment, size);
+}
+
+int
+posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    void *data;
+
+    if ((alignment == 0) ||
+        (alignment % sizeof(void *)) ||
+        (alignment & (alignment - 1)))
+        return EINVAL;
+
+    data = _exm_hook_aligned_alloc(alignment, size);
+    if (!data)
+        return ENOMEM;
+
+    *memptr = data;
+
+    return 0;
+}
+
+void *
+valloc(size_t size)
+{
+    return _exm_hook_aligned_alloc(sysconf(_SC_PAGESIZE), size);
+}
+
+void *
+pvalloc(size_t size)
+{
+    size_t page;
+
+    /* the size is rounded up to a multiple of the page size */
+    page = sysconf(_SC_PAGESIZE);
+    if (size > (size_t)-1 - page)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    return _exm_hook_aligned_alloc(page, size ? (size + page - 1) & ~(page - 1) : page);
+}
+
+/*
+ * The C library does not know the size of a block with redzones, as
+ * its memory starts before it, so the size of the block is returned.
+ */
+size_t
+malloc_usable_size(void *ptr)
+{
+    Exm_Tracker_Block block;
+
+    if (!ptr)
+        return 0;
+
+    block.redzone = 0;
+    if (!exm_hook_init())
+    {
+        if (!_exm_hook_done_block_get(ptr, 0, &block))
+            return 0;
+    }
+    else if (_exm_hook_redzone && _exm_hook_guard_enter())
+    {
+        if (!exm_tracker_block_get(exm_hook_tracker, ptr, &block))
+            block.redzone = 0;
+        else if (block.frees > 0)
+            block.size = 0;
+        _exm_hook_guard_leave();
+    }
+
+    if (block.redzone)
+        return block.size;
+
+    return _exm_hook_malloc_usable_size_next ? _exm_hook_malloc_usable_size_next(ptr) : 0;
+}
+
+char *
+strdup(const char *s)
+{
+    char *data;
+    size_t l;
+
+    l = strlen(s) + 1;
+    if (_exm_hook_redzone_enter())
+    {
+        data = (char *)_exm_hook_redzone_alloc(0, l, 0, EXM_HOOK_FCT__STRDUP);
+        if (data)
+            memmove(data, s, l);
+
+        return data;
+    }
+
+    data = (char *)__libc_malloc(l);
+    if (!data)
+        return NULL;
+
+    /* the new block can not overlap the string, memcpy() is not checked */
+    memmove(data, s, l);
+
+    if (!_exm_hook_alloc_counted(l) && exm_hook_init())
+        _exm_hook_alloc_manage(data, l, 0, EXM_HOOK_FCT__STRDUP);
+
+    return data;
+}
+
+void *
+memcpy(void *dest, const void *src, size_t n)
+{
+    /* memcpy() is also called before the C library is searched */
+    if (!exm_hook_init())
+        return memmove(dest, src, n);
+
+    if (_exm_hook_memory_overlap(dest, src, n, n) &&
+        _exm_hook_guard_enter())
+    {
+        Exm_Hook_Error_Data *err_data;
+
+        err_data = _exm_hook_error_data_memory_overlap_new(_exm_hook_stack_new(), dest, src, n, n, EXM_HOOK_FCT_MEMCPY);
+        _exm_hook_error_add(err_data);
+        _exm_hook_guard_leave();
+    }
+
+    return _exm_hook_memcpy_next(dest, src, n);
+}
+
+char *
+strcat(char *dest, const char *src)
+{
+    size_t dst_len;
+    size_t src_len;
+
+    dst_len = strlen(dest);
+    if (!exm_hook_init())
+    {
+        strcpy(dest + dst_len, src);
+        return dest;
+    }
+
+    src_len = strlen(src);
+    if (_exm_hook_memory_overlap(dest, src, dst_len, src_len) &&
+        _exm_hook_guard_enter())
+    {
+        Exm_Hook_Error_Data *err_data;
+
+        err_data = _exm_hook_error_data_memory_overlap_new(_exm_hook_stack_new(), dest, src, dst_len, src_len, EXM_HOOK_FCT_STRCAT);
+        _exm_hook_error_add(err_data);
+        _exm_hook_guard_leave();
+    }
+
+    return _exm_hook_strcat_next(dest, src);
+}
+
+int
+pthread_create(pthread_t *thread, const pthread_attr_t *attr, void *(*start_routine)(void *), void *arg)
+{
+    Exm_Hook_Thread_Start *start;
+    int ret;
+
+    if (!_exm_hook_pthread_create_next)
+        *(void **)&_exm_hook_pthread_create_next = dlsym(RTLD_NEXT, "pthread_create");
+    if (!_exm_hook_pthread_create_next)
+        return EAGAIN;
+
+    start = (Exm_Hook_Thread_Start *)__libc_malloc(sizeof(Exm_Hook_Thread_Start));
+    if (!start)
+        return EAGAIN;
+
+    start->start_routine = start_routine;
+    start->arg = arg;
+    ret = _exm_hook_pthread_create_next(thread, attr, _exm_hook_thread_start, start);
+    if (ret != 0)
+        __libc_free(start);
+
+    return ret;
+}
+
+/*
+ * When the program calls exit(), the frames of its callers are live
+ * while the report is output, so the stack is scanned for pointers to
+ * the blocks from this frame, with the registers saved in it. When
+ * main() returns, only the frames of the C library remain.
+ */
+void
+exit(int status)
+{
+    jmp_buf regs;
+
+    /* not all of it is written, and the stack can hold stale pointers */
+    memset(&regs, 0, sizeof(regs));
+    setjmp(regs);
+    _exm_hook_exit_stack = &regs;
+
+    if (!_exm_hook_exit_next)
+        *(void **)&_exm_hook_exit_next = dlsym(RTLD_NEXT, "exit");
+    if (!_exm_hook_exit_next)
+        _exit(status);
+
+    _exm_hook_exit_next(status);
+}
+
+#endif
+
+
+/*============================================================================*
+ *                                 Global                                     *
+ *============================================================================*/
+
+
+#ifdef _WIN32
+
+#define EXM_HOOK_FCT_SET(type, mod, sym) \
+do \
+{ \
+    _exm_hook_instance[type].fct = type; \
+    _exm_hook_instance[type].fct_proc_old = GetProcAddress(mod, #sym); \
+    if (!_exm_hook_instance[type].fct_proc_old) \
+    { \
+        EXM_LOG_WARN("REDIR: redirection of %s failed", #sym);   \
+        _exm_hook_instance[type].fct_proc_new = NULL; \
+    } \
+    else \
+    { \
+        char buf[MAX_PATH]; \
+        _exm_hook_instance[type].fct_proc_new = (FARPROC)_exm_hook_ ## sym; \
+        if (GetModuleFileName(mod, buf, sizeof(buf))) \
+            EXM_LOG_INFO("REDIR: 0x%p (%s:%s) redirected to 0x%p (%s%s)", \
+                         _exm_hook_instance[type].fct_proc_old, \
+                         strrchr(buf, '\\') + 1, #sym, \
+                         _exm_hook_instance[type].fct_proc_new, \
+                         "_exm_hook_", #sym); \
+        else \
+            EXM_LOG_INFO("REDIR: 0x%p (%s) redirected to 0x%p (%s)", \
+                         _exm_hook_instance[type].fct_proc_old, #sym, \
+                         _exm_hook_instance[type].fct_proc_new, \
+                         "_exm_hook_", #sym); \
+    } \
+} while (0)
+
+#endif
+
+
+Exm_Stack_Depot *exm_hook_stack_depot;
+Exm_Tracker *exm_hook_tracker;
+Exm_List *exm_hook_errors;
+Exm_List *exm_hook_gdi_handles;
+
+#ifdef _WIN32
+
+unsigned char
+exm_hook_init(const Exm_List *crt_names, const Exm_List *dep_names)
+{
+    const Exm_List *iter_crt;
+    char *mod_name;
+    HMODULE mod;
+
+    /* the other threads can call the hooks as soon as they are set */
+    if (!_exm_hook_state_new())
+        return 0;
+
+    mod_name = "ntdll.dll";
+
+    mod = LoadLibrary(mod_name);
+    if (mod)
+    {
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_RTLALLOCATEHEAP, mod, RtlAllocateHeap);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_RTLFREEHEAP, mod, RtlFreeHeap);
+
+        EXM_LOG_DBG("Hooking %s", mod_name);
+        _exm_hook_set(mod_name, dep_names,
+                      EXM_HOOK_FCT_NTDLL_BEGIN, EXM_HOOK_FCT_NTDLL_END);
+
+        FreeLibrary(mod);
+    }
+
+    mod_name = "kernel32.dll";
+
+    mod = LoadLibrary(mod_name);
+    if (mod)
+    {
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_HEAPALLOC, mod, HeapAlloc);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_HEAPREALLOC, mod, HeapReAlloc);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_HEAPFREE, mod, HeapFree);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_GLOBALALLOC, mod, GlobalAlloc);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_GLOBALREALLOC, mod, GlobalReAlloc);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_GLOBALFREE, mod, GlobalFree);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_LOCALALLOC, mod, LocalAlloc);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_LOCALREALLOC, mod, LocalReAlloc);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_LOCALFREE, mod, LocalFree);
+
+        EXM_LOG_DBG("Hooking %s", mod_name);
+        _exm_hook_set(mod_name, dep_names,
+                      EXM_HOOK_FCT_KERNEL32_BEGIN, EXM_HOOK_FCT_KERNEL32_END);
+
+        FreeLibrary(mod);
+    }
+
+    mod_name = "gdi32.dll";
+
+    mod = LoadLibrary(mod_name);
+    if (mod)
+    {
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEBITMAP, mod, CreateBitmap);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEBITMAPINDIRECT, mod, CreateBitmapIndirect);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATECOMPATIBLEBITMAP, mod, CreateCompatibleBitmap);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEDIBITMAP, mod, CreateDIBitmap);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEDIBSECTION, mod, CreateDIBSection);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEBRUSHINDIRECT, mod, CreateBrushIndirect);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEDIBPATTERNBRUSH, mod, CreateDIBPatternBrush);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEDIBPATTERNBRUSHPT, mod, CreateDIBPatternBrushPt);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEHATCHBRUSH, mod, CreateHatchBrush);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEPATTERNBRUSH, mod, CreatePatternBrush);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATESOLIDBRUSH, mod, CreateSolidBrush);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEFONT, mod, CreateFont);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEFONTINDIRECT, mod, CreateFontIndirect);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEPEN, mod, CreatePen);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEPENINDIRECT, mod, CreatePenIndirect);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEELLIPTICRGN, mod, CreateEllipticRgn);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEELLIPTICRGNINDIRECT, mod, CreateEllipticRgnIndirect);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEPOLYGONRGN, mod, CreatePolygonRgn);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATERECTRGN, mod, CreateRectRgn);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATERECTRGNINDIRECT, mod, CreateRectRgnIndirect);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CREATEPALETTE, mod, CreatePalette);
+        EXM_HOOK_FCT_SET(EXM_HOOK_FCT_DELETEOBJECT, mod, DeleteObject);
+
+        EXM_LOG_DBG("Hooking %s", mod_name);
+        _exm_hook_set(mod_name, dep_names,
+                      EXM_HOOK_FCT_GDI32_BEGIN, EXM_HOOK_FCT_GDI32_END);
+
+        FreeLibrary(mod);
+    }
+
+    iter_crt = crt_names;
+    while (iter_crt)
+    {
+        mod_name = (char *)iter_crt->data;
+
+        mod = LoadLibrary(mod_name);
+        if (mod)
+        {
+            EXM_HOOK_FCT_SET(EXM_HOOK_FCT_MALLOC, mod, malloc);
             EXM_HOOK_FCT_SET(EXM_HOOK_FCT__ALIGNED_MALLOC, mod, _aligned_malloc);
             EXM_HOOK_FCT_SET(EXM_HOOK_FCT__STRDUP, mod, _strdup);
             EXM_HOOK_FCT_SET(EXM_HOOK_FCT_CALLOC, mod, calloc);
@@ -1629,74 +3050,627 @@ exm_hook_init(const Exm_List *crt_names, const Exm_List *dep_names)
             EXM_HOOK_FCT_SET(EXM_HOOK_FCT__EXPAND, mod, _expand);
             EXM_HOOK_FCT_SET(EXM_HOOK_FCT_FREE, mod, free);
 
-            EXM_HOOK_FCT_SET(EXM_HOOK_FCT_MEMCPY, mod, memcpy);
-            EXM_HOOK_FCT_SET(EXM_HOOK_FCT_STRCAT, mod, strcat);
-            EXM_HOOK_FCT_SET(EXM_HOOK_FCT__MBSCAT, mod, _mbscat);
+            EXM_HOOK_FCT_SET(EXM_HOOK_FCT_MEMCPY, mod, memcpy);
+            EXM_HOOK_FCT_SET(EXM_HOOK_FCT_STRCAT, mod, strcat);
+            EXM_HOOK_FCT_SET(EXM_HOOK_FCT__MBSCAT, mod, _mbscat);
+
+            EXM_LOG_DBG("Hooking %s", strrchr(mod_name, '\\') + 1);
+            mod_name = strrchr(mod_name, '\\') + 1;
+            _exm_hook_set(mod_name, dep_names,
+                          EXM_HOOK_FCT_LIBC_BEGIN, EXM_HOOK_FCT_LIBC_END);
+
+            FreeLibrary(mod);
+        }
+        iter_crt = iter_crt->next;
+    }
+
+    return 1;
+}
+
+void
+exm_hook_shutdown(const Exm_List *crt_names, const Exm_List *dep_names)
+{
+    const Exm_List *iter_crt;
+    char *mod_name;
+
+    mod_name = "ntdll.dll";
+
+    EXM_LOG_DBG("Unhooking %s", mod_name);
+    _exm_unhook_set(mod_name, dep_names,
+                    EXM_HOOK_FCT_NTDLL_BEGIN, EXM_HOOK_FCT_NTDLL_END);
+
+    mod_name = "kernel32.dll";
+
+    EXM_LOG_DBG("Unhooking %s", mod_name);
+    _exm_unhook_set(mod_name, dep_names,
+                    EXM_HOOK_FCT_KERNEL32_BEGIN, EXM_HOOK_FCT_KERNEL32_END);
+
+    mod_name = "gdi32.dll";
+
+    EXM_LOG_DBG("Unhooking %s", mod_name);
+    _exm_unhook_set(mod_name, dep_names,
+                    EXM_HOOK_FCT_GDI32_BEGIN, EXM_HOOK_FCT_GDI32_END);
+
+    iter_crt = crt_names;
+    while (iter_crt)
+    {
+        mod_name = (char *)iter_crt->data;
+
+        EXM_LOG_DBG("Unhooking %s", strrchr(mod_name, '\\') + 1);
+        mod_name = strrchr(mod_name, '\\') + 1;
+        _exm_unhook_set(mod_name, dep_names,
+                        EXM_HOOK_FCT_LIBC_BEGIN, EXM_HOOK_FCT_LIBC_END);
+
+        iter_crt = iter_crt->next;
+    }
+
+    /* the state is freed once no hook can be called anymore */
+    exm_list_free(exm_hook_errors, _exm_hook_error_data_del);
+    EXM_LOCK_SHUTDOWN(&_exm_hook_errors_lock);
+
+    exm_suppression_free(_exm_hook_suppression);
+    _exm_hook_suppression = NULL;
+
+    exm_timeline_free(_exm_hook_timeline);
+    _exm_hook_timeline = NULL;
+
+    if (exm_tracker_duplicates_get(exm_hook_tracker) > 0)
+        EXM_LOG_ERR("CRITICAL ERROR: The OS allocated memory twice on the same address " EXM_HOOK_FMT_SIZE " times",
+                    exm_tracker_duplicates_get(exm_hook_tracker));
+
+    EXM_LOG_DBG(EXM_HOOK_FMT_SIZE " allocation records in " EXM_HOOK_FMT_SIZE " bytes",
+                exm_tracker_count(exm_hook_tracker),
+                exm_tracker_memory_get(exm_hook_tracker));
+    exm_tracker_free(exm_hook_tracker);
+    exm_hook_tracker = NULL;
+
+    EXM_LOG_DBG("%u distinct stacks in " EXM_HOOK_FMT_SIZE " bytes",
+                exm_stack_depot_count(exm_hook_stack_depot),
+                exm_stack_depot_memory_get(exm_hook_stack_depot));
+    exm_stack_depot_free(exm_hook_stack_depot);
+    exm_hook_stack_depot = NULL;
+
+    exm_stack_shutdown();
+}
+
+#else
+
+/*
+ * The state is created by the first interposer that is called, which
+ * can be before the constructors are. Return 1 if the allocations are
+ * tracked.
+ */
+unsigned char
+exm_hook_init(void)
+{
+    int status;
+
+    status = __atomic_load_n(&_exm_hook_status, __ATOMIC_ACQUIRE);
+    if (status == EXM_HOOK_STATUS_NONE)
+    {
+        /* the memory allocated by the initialization is not tracked */
+        if (!_exm_hook_guard_enter())
+            return 0;
+
+        pthread_once(&_exm_hook_once, _exm_hook_once_init);
+        _exm_hook_guard_leave();
+        status = __atomic_load_n(&_exm_hook_status, __ATOMIC_ACQUIRE);
+    }
+
+    if (status != EXM_HOOK_STATUS_READY)
+        return 0;
+
+    /* the value is only set for the thread exit function to be called */
+    if (!_exm_hook_thread_registered)
+    {
+        _exm_hook_thread_registered = 1;
+        pthread_setspecific(_exm_hook_thread_key, &_exm_hook_thread_key);
+    }
+
+    return 1;
+}
+
+/*
+ * The state is not freed, as the other threads and the destructors
+ * called after this one can still call the interposers until the
+ * process exits. The allocations are not tracked anymore, but the
+ * records are kept readable to free the blocks with redzones.
+ */
+void
+exm_hook_shutdown(void)
+{
+    __atomic_store_n(&_exm_hook_status, EXM_HOOK_STATUS_DONE, __ATOMIC_RELEASE);
 
-            EXM_LOG_DBG("Hooking %s", strrchr(mod_name, '\\') + 1);
-            mod_name = strrchr(mod_name, '\\') + 1;
-            _exm_hook_set(mod_name, dep_names,
-                          EXM_HOOK_FCT_LIBC_BEGIN, EXM_HOOK_FCT_LIBC_END);
+    if (exm_tracker_duplicates_get(exm_hook_tracker) > 0)
+        EXM_LOG_ERR("CRITICAL ERROR: The OS allocated memory twice on the same address " EXM_HOOK_FMT_SIZE " times",
+                    exm_tracker_duplicates_get(exm_hook_tracker));
 
-            FreeLibrary(mod);
-        }
-        iter_crt = iter_crt->next;
+    EXM_LOG_DBG(EXM_HOOK_FMT_SIZE " allocation records in " EXM_HOOK_FMT_SIZE " bytes",
+                exm_tracker_count(exm_hook_tracker),
+                exm_tracker_memory_get(exm_hook_tracker));
+    EXM_LOG_DBG("%u distinct stacks in " EXM_HOOK_FMT_SIZE " bytes",
+                exm_stack_depot_count(exm_hook_stack_depot),
+                exm_stack_depot_memory_get(exm_hook_stack_depot));
+}
+
+#endif
+
+/*
+ * The records of the thread that exits are moved to the stripes of
+ * the tracker, and its counters can be reused by a new thread. Its
+ * stack is not a root anymore.
+ */
+void
+exm_hook_thread_shutdown(void)
+{
+    if (_exm_hook_guard_enter())
+    {
+        exm_tracker_thread_flush(exm_hook_tracker);
+        _exm_hook_guard_leave();
     }
 
-    exm_stack_init();
+    if (_exm_hook_thread_counters)
+    {
+        EXM_ATOMIC_STORE(&_exm_hook_thread_counters->owned, 0);
+        _exm_hook_thread_counters = NULL;
+    }
 
-    exm_hook_allocations = NULL;
-    exm_hook_errors = NULL;
-    memset(&exm_hook_summary, 0, sizeof(Exm_Hook_Summary));
+    if (_exm_hook_thread)
+    {
+        EXM_ATOMIC_STORE(&_exm_hook_thread->live, 0);
+        _exm_hook_thread = NULL;
+    }
+}
 
-    return 1;
+/* the counters of all the threads, exact once they are done */
+void
+exm_hook_summary_get(Exm_Hook_Summary *summary)
+{
+    const Exm_Hook_Counters *counters;
+
+    memset(summary, 0, sizeof(Exm_Hook_Summary));
+    for (counters = EXM_ATOMIC_LOAD(&_exm_hook_counters); counters; counters = counters->next)
+    {
+        summary->total_count_gdi_handles += counters->summary.total_count_gdi_handles;
+        summary->total_count_allocs += counters->summary.total_count_allocs;
+        summary->total_count_frees += counters->summary.total_count_frees;
+        summary->total_bytes_allocated += counters->summary.total_bytes_allocated;
+    }
+}
+
+/* the guard of the tracker, for the code of the tool out of the hooks */
+unsigned char
+exm_hook_guard_enter(void)
+{
+    return _exm_hook_guard_enter();
 }
 
 void
-exm_hook_shutdown(const Exm_List *crt_names, const Exm_List *dep_names)
+exm_hook_guard_leave(void)
 {
-    const Exm_List *iter_crt;
-    char *mod_name;
+    _exm_hook_guard_leave();
+}
 
-    exm_list_free(exm_hook_errors, _exm_hook_error_data_del);
-    exm_list_free(exm_hook_allocations, _exm_hook_data_alloc_del);
+/*
+ * Set the mean interval, in bytes, between the recorded blocks, 0 to
+ * record all of them. It must be set before the hooks are set.
+ */
+void
+exm_hook_sample_interval_set(size_t interval)
+{
+    _exm_hook_sample_interval = interval;
+}
 
-    exm_stack_shutdown();
+size_t
+exm_hook_sample_interval_get(void)
+{
+    return _exm_hook_sample_interval;
+}
 
-    mod_name = "ntdll.dll";
+/*
+ * Set the minimal size, in bytes, of the redzones around the blocks of
+ * the C library, 0 for no redzones. It must be set before the hooks
+ * are set.
+ */
+void
+exm_hook_redzone_set(size_t redzone)
+{
+    _exm_hook_redzone = redzone;
+}
 
-    EXM_LOG_DBG("Unhooking %s", mod_name);
-    _exm_unhook_set(mod_name, dep_names,
-                    EXM_HOOK_FCT_NTDLL_BEGIN, EXM_HOOK_FCT_NTDLL_END);
+size_t
+exm_hook_redzone_get(void)
+{
+    return _exm_hook_redzone;
+}
 
-    mod_name = "kernel32.dll";
+/*
+ * Set the budget, in bytes, of the quarantine of the freed blocks of
+ * each thread, 0 for no quarantine, and if the blocks in quarantine
+ * are filled with poison. It must be set before the hooks are set.
+ */
+void
+exm_hook_quarantine_set(size_t budget, unsigned char poison)
+{
+    _exm_hook_quarantine_budget = budget;
+    _exm_hook_quarantine_poison = poison;
+}
 
-    EXM_LOG_DBG("Unhooking %s", mod_name);
-    _exm_unhook_set(mod_name, dep_names,
-                    EXM_HOOK_FCT_KERNEL32_BEGIN, EXM_HOOK_FCT_KERNEL32_END);
+/*
+ * Set the maximum number of frames of the recorded stacks, 0 for all
+ * of them, at most EXM_HOOK_STACK_FRAMES_MAX. It must be set before
+ * the hooks are set.
+ */
+void
+exm_hook_num_callers_set(unsigned int num_callers)
+{
+    if ((num_callers == 0) || (num_callers > EXM_HOOK_STACK_FRAMES_MAX))
+        num_callers = EXM_HOOK_STACK_FRAMES_MAX;
+    _exm_hook_num_callers = num_callers;
+}
 
-    mod_name = "gdi32.dll";
+/*
+ * Set the maximum number of loss records displayed at exit, the
+ * largest ones, 0 to display all of them.
+ */
+void
+exm_hook_leak_limit_set(size_t limit)
+{
+    _exm_hook_leak_limit = limit;
+}
 
-    EXM_LOG_DBG("Unhooking %s", mod_name);
-    _exm_unhook_set(mod_name, dep_names,
-                    EXM_HOOK_FCT_GDI32_BEGIN, EXM_HOOK_FCT_GDI32_END);
+size_t
+exm_hook_leak_limit_get(void)
+{
+    return _exm_hook_leak_limit;
+}
 
-    iter_crt = crt_names;
-    while (iter_crt)
+/*
+ * Set the suppression files, separated by EXM_HOOK_SUPPRESSIONS_SEP,
+ * NULL for none. They are read when the report is written, and the
+ * string must be valid until then.
+ */
+void
+exm_hook_suppressions_set(const char *files)
+{
+    _exm_hook_suppressions = files;
+}
+
+const char *
+exm_hook_suppressions_get(void)
+{
+    return _exm_hook_suppressions;
+}
+
+/*
+ * Set the name of the file in which the suppressions of the displayed
+ * errors and loss records are written, NULL for none.
+ */
+void
+exm_hook_gen_suppressions_set(const char *filename)
+{
+    _exm_hook_gen_suppressions = filename;
+}
+
+const char *
+exm_hook_gen_suppressions_get(void)
+{
+    return _exm_hook_gen_suppressions;
+}
+
+/* the suppressions read from the files, NULL if there is none */
+Exm_Suppression *
+exm_hook_suppression_get(void)
+{
+    EXM_LOCK(&_exm_hook_errors_lock);
+    _exm_hook_suppression_load();
+    EXM_UNLOCK(&_exm_hook_errors_lock);
+
+    return _exm_hook_suppression;
+}
+
+static void
+_exm_hook_redzones_check_cb(const Exm_Tracker_Block *block, void *data)
+{
+    Exm_List **errors;
+    Exm_Hook_Error_Data *err_data;
+    long long offset;
+    size_t count;
+
+    if (block->frees > 0)
+        return;
+
+    count = exm_tracker_redzone_check(block, &offset);
+    if (count == 0)
+        return;
+
+    errors = (Exm_List **)data;
+    err_data = _exm_hook_error_data_redzone_new(0, block, offset, count);
+    if (err_data)
+        *errors = exm_list_append(*errors, err_data);
+}
+
+/*
+ * Verify the redzones of the blocks that are not freed, and the poison
+ * of the blocks in the quarantine of the calling thread, and add the
+ * errors. The guard must be entered, as the stripes of the tracker are
+ * locked.
+ */
+void
+exm_hook_blocks_check(void)
+{
+    Exm_List *errors = NULL;
+    Exm_List *iter;
+    size_t i;
+
+    if (_exm_hook_redzone)
     {
-        mod_name = (char *)iter_crt->data;
+        exm_tracker_foreach(exm_hook_tracker, _exm_hook_redzones_check_cb, &errors);
+        for (iter = errors; iter; iter = iter->next)
+            _exm_hook_error_add((Exm_Hook_Error_Data *)iter->data);
+        exm_list_free(errors, NULL);
+    }
 
-        EXM_LOG_DBG("Unhooking %s", strrchr(mod_name, '\\') + 1);
-        mod_name = strrchr(mod_name, '\\') + 1;
-        _exm_unhook_set(mod_name, dep_names,
-                        EXM_HOOK_FCT_LIBC_BEGIN, EXM_HOOK_FCT_LIBC_END);
+    if (_exm_hook_quarantine_budget && _exm_hook_quarantine_poison)
+    {
+        for (i = 0; i < _exm_hook_quarantine.nbr; i++)
+            _exm_hook_quarantine_verify(_exm_hook_quarantine.blocks +
+                                        ((_exm_hook_quarantine.first + i) & (_exm_hook_quarantine.max - 1)));
+    }
+}
 
-        iter_crt = iter_crt->next;
+/*
+ * Set the name of the file of the timeline of the live heap, NULL for
+ * no timeline. It must be set before the hooks are set, and be valid
+ * until they are removed.
+ */
+void
+exm_hook_timeline_set(const char *filename)
+{
+    _exm_hook_timeline_filename = filename;
+}
+
+#ifndef _WIN32
+
+/* the frame of the call of exit() by the program, NULL if not called */
+const void *
+exm_hook_exit_stack_get(void)
+{
+    return _exm_hook_exit_stack;
+}
+
+/*
+ * Call cb on the stacks of the threads that are running, but the
+ * calling one. A finished thread can keep pointers to blocks of the C
+ * library in its descriptor, like the one to its TLS, which is read
+ * while its stack is not unmapped.
+ */
+void
+exm_hook_thread_roots_foreach(Exm_Hook_Root_Cb cb, void *data)
+{
+    Exm_Hook_Thread *thread;
+
+    for (thread = EXM_ATOMIC_LOAD(&_exm_hook_threads); thread; thread = thread->next)
+    {
+        if (thread == _exm_hook_thread)
+            continue;
+
+        if (EXM_ATOMIC_LOAD(&thread->live))
+            cb(thread->stack, thread->end - thread->stack, data);
+        else if ((thread->self >= thread->stack) && (thread->self < thread->end) &&
+                 _exm_hook_memory_mapped(thread->self, thread->end - thread->self))
+            cb(thread->self, thread->end - thread->self, data);
+    }
+}
+
+#else
+
+/* the stack of a thread is known once it is attached */
+void
+exm_hook_thread_init(void)
+{
+    const NT_TIB *tib;
+
+    if (_exm_hook_guard_enter())
+    {
+        tib = (const NT_TIB *)NtCurrentTeb();
+        _exm_hook_thread_add(tib->StackLimit, tib->StackBase, tib);
+        _exm_hook_guard_leave();
+    }
+}
+
+/*
+ * Call cb on the stacks of the threads, but the calling one. The other
+ * threads are terminated when the process is detached, and their
+ * stacks are kept, but only the pages that are committed are read.
+ */
+void
+exm_hook_thread_roots_foreach(Exm_Hook_Root_Cb cb, void *data)
+{
+    Exm_Hook_Thread *thread;
+
+    for (thread = EXM_ATOMIC_LOAD(&_exm_hook_threads); thread; thread = thread->next)
+    {
+        MEMORY_BASIC_INFORMATION mbi;
+
+        if ((thread == _exm_hook_thread) || !EXM_ATOMIC_LOAD(&thread->live))
+            continue;
+
+        if (VirtualQuery(thread->end - 1, &mbi, sizeof(mbi)) &&
+            (mbi.State == MEM_COMMIT) &&
+            (mbi.Protect & (PAGE_READWRITE | PAGE_EXECUTE_READWRITE)) &&
+            !(mbi.Protect & PAGE_GUARD))
+            cb(mbi.BaseAddress, thread->end - (const unsigned char *)mbi.BaseAddress, data);
+    }
+}
+
+#endif
+
+/* write the end of the timeline, once the program has exited */
+void
+exm_hook_timeline_close(void)
+{
+    const Exm_Timeline_Snapshot *peak;
+
+    if (!_exm_hook_timeline ||
+        !exm_timeline_close(_exm_hook_timeline, exm_hook_stack_depot))
+        return;
+
+    peak = exm_timeline_peak_get(_exm_hook_timeline);
+    EXM_LOG_INFO("HEAP TIMELINE:");
+    EXM_LOG_INFO("    %u snapshots written in %s",
+                 exm_timeline_snapshots_count(_exm_hook_timeline),
+                 _exm_hook_timeline_filename);
+    EXM_LOG_INFO("    peak: " EXM_HOOK_FMT_ULL " bytes in " EXM_HOOK_FMT_ULL " blocks, after " EXM_HOOK_FMT_ULL " bytes allocated",
+                 peak->bytes, peak->blocks, peak->time);
+    EXM_LOG_INFO("");
+}
+
+void
+exm_hook_stack_symbolizer_add(unsigned int stack, Exm_Stack_Symbolizer *symbolizer)
+{
+    const Exm_Stack_Pc *pcs;
+    unsigned int nbr;
+
+    pcs = exm_stack_depot_get(exm_hook_stack_depot, stack, &nbr);
+    if (pcs)
+        exm_stack_symbolizer_add(symbolizer, pcs, nbr);
+}
+
+/*
+ * Fill the frames of a stack, the symbolizer being given as data, for
+ * the suppressions.
+ */
+unsigned int
+exm_hook_stack_frames_get(unsigned int stack, Exm_Suppression_Frame *frames, unsigned int max, void *data)
+{
+    const Exm_Stack_Pc *pcs;
+    unsigned int nbr;
+    unsigned int i;
+
+    pcs = exm_stack_depot_get(exm_hook_stack_depot, stack, &nbr);
+    if (!pcs)
+        return 0;
+
+    if (nbr > max)
+        nbr = max;
+    for (i = 0; i < nbr; i++)
+        exm_stack_symbolizer_frame_get((const Exm_Stack_Symbolizer *)data, pcs + i,
+                                       &frames[i].function, &frames[i].object);
+
+    return nbr;
+}
+
+void
+exm_hook_stack_disp(unsigned int stack, const Exm_Stack_Symbolizer *symbolizer)
+{
+    const Exm_Stack_Pc *pcs;
+    Exm_List *frames;
+    unsigned int nbr;
+
+    pcs = exm_stack_depot_get(exm_hook_stack_depot, stack, &nbr);
+    if (!pcs)
+        return;
+
+    frames = exm_stack_symbolizer_frames_get(symbolizer, pcs, nbr);
+    exm_stack_disp(frames);
+    exm_list_free(frames, exm_stack_data_free);
+}
+
+void
+exm_hook_error_symbolizer_add(const Exm_Hook_Error_Data *data, Exm_Stack_Symbolizer *symbolizer)
+{
+    if (!data)
+        return;
+
+    switch (data->error_type)
+    {
+        case EXM_HOOK_ERROR_FREE_WITHOUT_ALLOC:
+            exm_hook_stack_symbolizer_add(data->error.free_without_alloc.stack, symbolizer);
+            break;
+        case EXM_HOOK_ERROR_MULTIPLE_FREES:
+            exm_hook_stack_symbolizer_add(data->error.multiple_frees.stack_free, symbolizer);
+            exm_hook_stack_symbolizer_add(data->error.multiple_frees.stack_alloc, symbolizer);
+            exm_hook_stack_symbolizer_add(data->error.multiple_frees.stack_first_free, symbolizer);
+            break;
+        case EXM_HOOK_ERROR_MISMATCHED_FREE:
+            exm_hook_stack_symbolizer_add(data->error.mismatched_free.stack_free, symbolizer);
+            exm_hook_stack_symbolizer_add(data->error.mismatched_free.stack_alloc, symbolizer);
+            break;
+        case EXM_HOOK_ERROR_MEMORY_OVERLAP:
+            exm_hook_stack_symbolizer_add(data->error.memory_overlap.stack, symbolizer);
+            break;
+        case EXM_HOOK_ERROR_REDZONE:
+            if (data->error.redzone.stack_free)
+                exm_hook_stack_symbolizer_add(data->error.redzone.stack_free, symbolizer);
+            exm_hook_stack_symbolizer_add(data->error.redzone.stack_alloc, symbolizer);
+            break;
+        case EXM_HOOK_ERROR_FREED_WRITE:
+            exm_hook_stack_symbolizer_add(data->error.freed_write.stack_free, symbolizer);
+            exm_hook_stack_symbolizer_add(data->error.freed_write.stack_alloc, symbolizer);
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * Return the stack of an error matched by the suppressions, the one
+ * where it is found, and set its kind.
+ */
+unsigned int
+exm_hook_error_stack_get(const Exm_Hook_Error_Data *data, Exm_Suppression_Kind *kind)
+{
+    switch (data->error_type)
+    {
+        case EXM_HOOK_ERROR_FREE_WITHOUT_ALLOC:
+            *kind = EXM_SUPPRESSION_FREE;
+            return data->error.free_without_alloc.stack;
+        case EXM_HOOK_ERROR_MULTIPLE_FREES:
+            *kind = EXM_SUPPRESSION_FREE;
+            return data->error.multiple_frees.stack_free;
+        case EXM_HOOK_ERROR_MISMATCHED_FREE:
+            *kind = EXM_SUPPRESSION_MISMATCH;
+            return data->error.mismatched_free.stack_free;
+        case EXM_HOOK_ERROR_MEMORY_OVERLAP:
+            *kind = EXM_SUPPRESSION_OVERLAP;
+            return data->error.memory_overlap.stack;
+        case EXM_HOOK_ERROR_REDZONE:
+            *kind = EXM_SUPPRESSION_ADDR;
+            if (data->error.redzone.stack_free)
+                return data->error.redzone.stack_free;
+            return data->error.redzone.stack_alloc;
+        case EXM_HOOK_ERROR_FREED_WRITE:
+            *kind = EXM_SUPPRESSION_ADDR;
+            return data->error.freed_write.stack_free;
+        default:
+            *kind = EXM_SUPPRESSION_KIND_LAST;
+            return 0;
     }
 }
 
+/*
+ * Return the name of the suppression matching an error, NULL if it is
+ * not suppressed. The match of its stack is cached, so the frames are
+ * only read from the symbolizer the first time.
+ */
+const char *
+exm_hook_error_suppressed(const Exm_Hook_Error_Data *data, const Exm_Stack_Symbolizer *symbolizer)
+{
+    Exm_Suppression_Kind kind;
+    unsigned int stack;
+
+    if (!_exm_hook_suppression)
+        return NULL;
+
+    stack = exm_hook_error_stack_get(data, &kind);
+
+    return exm_suppression_match(_exm_hook_suppression, kind, stack,
+                                 exm_hook_stack_frames_get, (void *)symbolizer);
+}
+
 void
-exm_hook_error_disp(Exm_Hook_Error_Data *data)
+exm_hook_error_disp(const Exm_Hook_Error_Data *data, const Exm_Stack_Symbolizer *symbolizer)
 {
     if (!data)
         return;
@@ -1705,45 +3679,45 @@ exm_hook_error_disp(Exm_Hook_Error_Data *data)
     {
         case EXM_HOOK_ERROR_FREE_WITHOUT_ALLOC:
             EXM_LOG_INFO("Invalid memory free without allocation");
-            exm_stack_disp(data->error.free_without_alloc.stack);
+            exm_hook_stack_disp(data->error.free_without_alloc.stack, symbolizer);
             break;
         case EXM_HOOK_ERROR_MULTIPLE_FREES:
             EXM_LOG_INFO("Multiple frees");
-            exm_stack_disp(data->error.multiple_frees.stack_free);
-            EXM_LOG_INFO("Address 0x%p is 0 bytes inside a block of size %Iu free'd",
+            exm_hook_stack_disp(data->error.multiple_frees.stack_free, symbolizer);
+            EXM_LOG_INFO("Address " EXM_HOOK_FMT_PTR " is 0 bytes inside a block of size " EXM_HOOK_FMT_SIZE " free'd",
                          data->error.multiple_frees.address_alloc,
                          data->error.multiple_frees.size_alloc);
-            exm_stack_disp(data->error.multiple_frees.stack_alloc);
+            exm_hook_stack_disp(data->error.multiple_frees.stack_alloc, symbolizer);
             EXM_LOG_INFO("First free");
-            exm_stack_disp(data->error.multiple_frees.stack_first_free);
+            exm_hook_stack_disp(data->error.multiple_frees.stack_first_free, symbolizer);
             break;
         case EXM_HOOK_ERROR_MISMATCHED_FREE:
             EXM_LOG_INFO("Mismatched free / allocation");
-            exm_stack_disp(data->error.mismatched_free.stack_free);
-            EXM_LOG_INFO("Address 0x%p is 0 bytes inside a block of size %Iu free'd",
+            exm_hook_stack_disp(data->error.mismatched_free.stack_free, symbolizer);
+            EXM_LOG_INFO("Address " EXM_HOOK_FMT_PTR " is 0 bytes inside a block of size " EXM_HOOK_FMT_SIZE " free'd",
                          data->error.mismatched_free.address_alloc,
                          data->error.mismatched_free.size_alloc);
-            exm_stack_disp(data->error.mismatched_free.stack_alloc);
+            exm_hook_stack_disp(data->error.mismatched_free.stack_alloc, symbolizer);
             break;
         case EXM_HOOK_ERROR_MEMORY_OVERLAP:
         {
             switch (data->error.memory_overlap.fct)
             {
                 case EXM_HOOK_FCT_MEMCPY:
-                    EXM_LOG_INFO("Source and destination overlap in memcpy(0x%0p, 0x%p, %Iu)",
+                    EXM_LOG_INFO("Source and destination overlap in memcpy(" EXM_HOOK_FMT_PTR ", " EXM_HOOK_FMT_PTR ", " EXM_HOOK_FMT_SIZE ")",
                                  data->error.memory_overlap.dst,
                                  data->error.memory_overlap.src,
                                  data->error.memory_overlap.dst_len);
                     break;
                 case EXM_HOOK_FCT_STRCAT:
-                    EXM_LOG_INFO("Source and destination overlap in strcat(0x%0p [%s], 0x%p [%s])",
+                    EXM_LOG_INFO("Source and destination overlap in strcat(" EXM_HOOK_FMT_PTR " [%s], " EXM_HOOK_FMT_PTR " [%s])",
                                  data->error.memory_overlap.dst,
                                  (char *)data->error.memory_overlap.dst,
                                  data->error.memory_overlap.src,
                                  (char *)data->error.memory_overlap.src);
                     break;
                 case EXM_HOOK_FCT__MBSCAT:
-                    EXM_LOG_INFO("Source and destination overlap in _mbscat(0x%0p [%s], 0x%p [%s])",
+                    EXM_LOG_INFO("Source and destination overlap in _mbscat(" EXM_HOOK_FMT_PTR " [%s], " EXM_HOOK_FMT_PTR " [%s])",
                                  data->error.memory_overlap.dst,
                                  (char *)data->error.memory_overlap.dst,
                                  data->error.memory_overlap.src,
@@ -1753,9 +3727,42 @@ exm_hook_error_disp(Exm_Hook_Error_Data *data)
                     /* should never reach this */
                     break;
             }
-            exm_stack_disp(data->error.memory_overlap.stack);
+            exm_hook_stack_disp(data->error.memory_overlap.stack, symbolizer);
             break;
         }
+        case EXM_HOOK_ERROR_REDZONE:
+            if (data->error.redzone.stack_free)
+            {
+                EXM_LOG_INFO("Invalid write out of a block, found when it is freed");
+                exm_hook_stack_disp(data->error.redzone.stack_free, symbolizer);
+            }
+            else
+                EXM_LOG_INFO("Invalid write out of a block, found at exit");
+            if (data->error.redzone.offset < 0)
+                EXM_LOG_INFO("Address " EXM_HOOK_FMT_PTR " is " EXM_HOOK_FMT_ULL " bytes before a block of size " EXM_HOOK_FMT_SIZE " alloc'd, " EXM_HOOK_FMT_SIZE " bytes overwritten",
+                             (unsigned char *)data->error.redzone.address_alloc + data->error.redzone.offset,
+                             (unsigned long long)-data->error.redzone.offset,
+                             data->error.redzone.size_alloc,
+                             data->error.redzone.count);
+            else
+                EXM_LOG_INFO("Address " EXM_HOOK_FMT_PTR " is " EXM_HOOK_FMT_ULL " bytes after a block of size " EXM_HOOK_FMT_SIZE " alloc'd, " EXM_HOOK_FMT_SIZE " bytes overwritten",
+                             (unsigned char *)data->error.redzone.address_alloc + data->error.redzone.offset,
+                             (unsigned long long)data->error.redzone.offset - data->error.redzone.size_alloc,
+                             data->error.redzone.size_alloc,
+                             data->error.redzone.count);
+            exm_hook_stack_disp(data->error.redzone.stack_alloc, symbolizer);
+            break;
+        case EXM_HOOK_ERROR_FREED_WRITE:
+            EXM_LOG_INFO("Invalid write in a freed block");
+            EXM_LOG_INFO("Address " EXM_HOOK_FMT_PTR " is " EXM_HOOK_FMT_ULL " bytes inside a block of size " EXM_HOOK_FMT_SIZE " free'd, " EXM_HOOK_FMT_SIZE " bytes overwritten",
+                         (unsigned char *)data->error.freed_write.address_alloc + data->error.freed_write.offset,
+                         (unsigned long long)data->error.freed_write.offset,
+                         data->error.freed_write.size_alloc,
+                         data->error.freed_write.count);
+            exm_hook_stack_disp(data->error.freed_write.stack_free, symbolizer);
+            EXM_LOG_INFO("Block was alloc'd at");
+            exm_hook_stack_disp(data->error.freed_write.stack_alloc, symbolizer);
+            break;
         default:
             break;
     }
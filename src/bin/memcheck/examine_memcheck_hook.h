@@ -80,16 +80,23 @@ typedef enum
 
 typedef struct _Exm_Hook_Error_Data Exm_Hook_Error_Data;
 
-typedef struct
-{
-    Exm_Hook_Fct fct;
-    size_t size;
-    void *data;
-    unsigned int nbr_frees;
-    Exm_List *stack;
-    Exm_List *stack_first_free;
-    unsigned int gdi32 : 1;
-} Exm_Hook_Data_Alloc;
+#define EXM_HOOK_STACK_FRAMES_MAX 100
+
+#ifdef _WIN32
+# define EXM_HOOK_FMT_SIZE "%Iu"
+# define EXM_HOOK_FMT_PTR "0x%p"
+# define EXM_HOOK_FMT_ULL "%I64u"
+#else
+# define EXM_HOOK_FMT_SIZE "%zu"
+# define EXM_HOOK_FMT_PTR "%p"
+# define EXM_HOOK_FMT_ULL "%llu"
+#endif
+
+#ifdef _WIN32
+# define EXM_HOOK_SUPPRESSIONS_SEP ';'
+#else
+# define EXM_HOOK_SUPPRESSIONS_SEP ':'
+#endif
 
 typedef struct
 {
@@ -99,13 +106,82 @@ typedef struct
     size_t total_bytes_allocated;
 } Exm_Hook_Summary;
 
-extern Exm_List *exm_hook_allocations;
+extern Exm_Stack_Depot *exm_hook_stack_depot;
+extern Exm_Tracker *exm_hook_tracker; /* stacks are ids in exm_hook_stack_depot */
 extern Exm_List *exm_hook_errors;
-extern Exm_Hook_Summary exm_hook_summary;
 
+#ifdef _WIN32
 unsigned char exm_hook_init(const Exm_List *crt_names, const Exm_List *dep_names);
 void exm_hook_shutdown(const Exm_List *crt_names, const Exm_List *dep_names);
+#else
+unsigned char exm_hook_init(void);
+void exm_hook_shutdown(void);
+#endif
+
+#ifdef _WIN32
+void exm_hook_thread_init(void);
+#endif
+
+void exm_hook_thread_shutdown(void);
+
+unsigned char exm_hook_guard_enter(void);
+
+void exm_hook_guard_leave(void);
+
+void exm_hook_summary_get(Exm_Hook_Summary *summary);
+
+void exm_hook_sample_interval_set(size_t interval);
+
+size_t exm_hook_sample_interval_get(void);
+
+void exm_hook_redzone_set(size_t redzone);
+
+size_t exm_hook_redzone_get(void);
+
+void exm_hook_quarantine_set(size_t budget, unsigned char poison);
+
+void exm_hook_blocks_check(void);
+
+void exm_hook_num_callers_set(unsigned int num_callers);
+
+void exm_hook_leak_limit_set(size_t limit);
+
+size_t exm_hook_leak_limit_get(void);
+
+void exm_hook_suppressions_set(const char *files);
+
+const char *exm_hook_suppressions_get(void);
+
+void exm_hook_gen_suppressions_set(const char *filename);
+
+const char *exm_hook_gen_suppressions_get(void);
+
+Exm_Suppression *exm_hook_suppression_get(void);
+
+void exm_hook_timeline_set(const char *filename);
+
+void exm_hook_timeline_close(void);
+
+typedef void (*Exm_Hook_Root_Cb)(const void *start, size_t size, void *data);
+
+void exm_hook_thread_roots_foreach(Exm_Hook_Root_Cb cb, void *data);
+
+#ifndef _WIN32
+const void *exm_hook_exit_stack_get(void);
+#endif
+
+void exm_hook_stack_symbolizer_add(unsigned int stack, Exm_Stack_Symbolizer *symbolizer);
+
+unsigned int exm_hook_stack_frames_get(unsigned int stack, Exm_Suppression_Frame *frames, unsigned int max, void *data);
+
+void exm_hook_stack_disp(unsigned int stack, const Exm_Stack_Symbolizer *symbolizer);
+
+void exm_hook_error_symbolizer_add(const Exm_Hook_Error_Data *data, Exm_Stack_Symbolizer *symbolizer);
+
+unsigned int exm_hook_error_stack_get(const Exm_Hook_Error_Data *data, Exm_Suppression_Kind *kind);
+
+const char *exm_hook_error_suppressed(const Exm_Hook_Error_Data *data, const Exm_Stack_Symbolizer *symbolizer);
 
-void exm_hook_error_disp(Exm_Hook_Error_Data *data);
+void exm_hook_error_disp(const Exm_Hook_Error_Data *data, const Exm_Stack_Symbolizer *symbolizer);
 
 #endif /* EXAMINE_HOOK_H */
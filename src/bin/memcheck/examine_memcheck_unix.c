@@ -0,0 +1,223 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2014-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <Examine.h>
+
+#include "examine_private.h"
+
+
+/*============================================================================*
+ *                                  Local                                     *
+ *============================================================================*/
+
+
+#define EXM_MC_PRELOAD PACKAGE_BIN_DIR "/libexamine_memcheck.so"
+
+/*
+ * The arguments of the program are separated by spaces in the
+ * command line passed to the tool, they are split in place.
+ */
+static char **
+_exm_mc_argv_new(char *filename, char *args)
+{
+    char **argv;
+    char *iter;
+    size_t nbr;
+
+    nbr = 2;
+    for (iter = args; *iter; iter++)
+    {
+        if (*iter == ' ')
+            nbr++;
+    }
+
+    argv = (char **)malloc(nbr * sizeof(char *));
+    if (!argv)
+        return NULL;
+
+    nbr = 0;
+    argv[nbr++] = filename;
+    for (iter = strtok(args, " "); iter; iter = strtok(NULL, " "))
+        argv[nbr++] = iter;
+    argv[nbr] = NULL;
+
+    return argv;
+}
+
+/*
+ * The options are passed to the library in the environment, and the
+ * library is preloaded before the ones already set.
+ */
+static unsigned char
+_exm_mc_env_set(const Exm_Mc_Options *options)
+{
+    char level[16];
+    char interval[32];
+    char rz[32];
+    char q[32];
+    char callers[16];
+    char limit[32];
+    const char *preload;
+
+    snprintf(level, sizeof(level), "%d", (int)exm_log_level_get());
+    if (setenv("EXM_MEMCHECK_LOG_LEVEL", level, 1) != 0)
+        return 0;
+
+    snprintf(interval, sizeof(interval), "%zu", options->sample_interval);
+    if (setenv("EXM_MEMCHECK_SAMPLE_INTERVAL", interval, 1) != 0)
+        return 0;
+
+    if (options->timeline && (setenv("EXM_MEMCHECK_TIMELINE", options->timeline, 1) != 0))
+        return 0;
+
+    snprintf(rz, sizeof(rz), "%zu", options->redzone);
+    if (setenv("EXM_MEMCHECK_REDZONE", rz, 1) != 0)
+        return 0;
+
+    snprintf(q, sizeof(q), "%zu", options->quarantine);
+    if ((setenv("EXM_MEMCHECK_QUARANTINE", q, 1) != 0) ||
+        (setenv("EXM_MEMCHECK_POISON", options->poison ? "1" : "0", 1) != 0))
+        return 0;
+
+    snprintf(callers, sizeof(callers), "%u", options->num_callers);
+    if (setenv("EXM_MEMCHECK_NUM_CALLERS", callers, 1) != 0)
+        return 0;
+
+    snprintf(limit, sizeof(limit), "%zu", options->leak_limit);
+    if (setenv("EXM_MEMCHECK_LEAK_LIMIT", limit, 1) != 0)
+        return 0;
+
+    if (options->suppressions && (setenv("EXM_MEMCHECK_SUPPRESSIONS", options->suppressions, 1) != 0))
+        return 0;
+
+    if (options->gen_suppressions && (setenv("EXM_MEMCHECK_GEN_SUPPRESSIONS", options->gen_suppressions, 1) != 0))
+        return 0;
+
+    preload = getenv("LD_PRELOAD");
+    if (preload && *preload)
+    {
+        char *buf;
+        unsigned char res;
+        size_t l;
+
+        l = sizeof(EXM_MC_PRELOAD) + strlen(preload) + 1;
+        buf = (char *)malloc(l);
+        if (!buf)
+            return 0;
+
+        snprintf(buf, l, "%s:%s", EXM_MC_PRELOAD, preload);
+        res = (setenv("LD_PRELOAD", buf, 1) == 0);
+        free(buf);
+
+        return res;
+    }
+
+    return (setenv("LD_PRELOAD", EXM_MC_PRELOAD, 1) == 0);
+}
+
+
+/*============================================================================*
+ *                                 Global                                     *
+ *============================================================================*/
+
+
+int
+exm_mc_run(const char *filename, char *args, const Exm_Mc_Options *options)
+{
+    char **argv;
+    char *file;
+    pid_t pid;
+    int status;
+    int exit_code = -1;
+
+    file = exm_file_find(filename);
+    if (!file)
+    {
+        EXM_LOG_ERR("Can not find file %s", filename);
+        return -1;
+    }
+
+    argv = _exm_mc_argv_new(file, args);
+    if (!argv)
+    {
+        EXM_LOG_ERR("Can not allocate memory");
+        goto free_file;
+    }
+
+    pid = fork();
+    if (pid == -1)
+    {
+        EXM_LOG_ERR("Creation of process %s failed: %s", file, strerror(errno));
+        goto free_argv;
+    }
+
+    if (pid == 0)
+    {
+        if (!_exm_mc_env_set(options))
+        {
+            EXM_LOG_ERR("Can not set the environment of the process %s", file);
+            _exit(127);
+        }
+
+        execv(file, argv);
+        EXM_LOG_ERR("Can not execute %s: %s", file, strerror(errno));
+        _exit(127);
+    }
+
+    while (waitpid(pid, &status, 0) == -1)
+    {
+        if (errno != EINTR)
+        {
+            EXM_LOG_ERR("Can not wait for the process %s", file);
+            goto free_argv;
+        }
+    }
+
+    EXM_LOG_DBG("end of process");
+
+    /* as the shells, a process killed by a signal exits with 128 + signal */
+    if (WIFSIGNALED(status))
+    {
+        EXM_LOG_ERR("Process terminated with signal %d", WTERMSIG(status));
+        exit_code = 128 + WTERMSIG(status);
+    }
+    else if (WIFEXITED(status))
+        exit_code = WEXITSTATUS(status);
+
+  free_argv:
+    free(argv);
+  free_file:
+    free(file);
+
+    return exit_code;
+}
@@ -66,6 +66,12 @@ extern "C" {
 #include "examine_process.h"
 #include "examine_injection.h"
 #include "examine_stack.h"
+#include "examine_stack_depot.h"
+#include "examine_symbol.h"
+#include "examine_tracker.h"
+#include "examine_leak.h"
+#include "examine_suppression.h"
+#include "examine_timeline.h"
 #ifndef _WIN32
 # include "examine_pe_unix.h"
 #endif
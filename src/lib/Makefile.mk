@@ -2,35 +2,66 @@
 lib_LTLIBRARIES += src/lib/libexamine.la
 
 src_lib_libexamine_la_SOURCES = \
+src/lib/examine_checksum.c \
+src/lib/examine_coff.c \
+src/lib/examine_dwarf.c \
 src/lib/examine_file.c \
+src/lib/examine_histogram.c \
+src/lib/examine_leak.c \
 src/lib/examine_list.c \
 src/lib/examine_log.c \
 src/lib/examine_main.c \
 src/lib/examine_map.c \
+src/lib/examine_pdb.c \
 src/lib/examine_pe.c \
+src/lib/examine_sha.c \
+src/lib/examine_stack.c \
+src/lib/examine_stack_depot.c \
+src/lib/examine_stack_module.c \
 src/lib/examine_str.c \
+src/lib/examine_suppression.c \
+src/lib/examine_symbol.c \
+src/lib/examine_symbol_cache.c \
+src/lib/examine_timeline.c \
+src/lib/examine_tracker.c \
 src/lib/Examine.h \
+src/lib/examine_dwarf.h \
 src/lib/examine_file.h \
+src/lib/examine_leak.h \
 src/lib/examine_list.h \
 src/lib/examine_log.h \
 src/lib/examine_main.h \
 src/lib/examine_map.h \
 src/lib/examine_pe.h \
+src/lib/examine_stack.h \
+src/lib/examine_stack_depot.h \
 src/lib/examine_str.h \
+src/lib/examine_suppression.h \
+src/lib/examine_symbol.h \
+src/lib/examine_timeline.h \
+src/lib/examine_tracker.h \
+src/lib/examine_private_checksum.h \
+src/lib/examine_private_coff.h \
+src/lib/examine_private_dwarf.h \
 src/lib/examine_private_file.h \
+src/lib/examine_private_histogram.h \
+src/lib/examine_private_leak.h \
 src/lib/examine_private_log.h \
 src/lib/examine_private_map.h \
+src/lib/examine_private_pdb.h \
 src/lib/examine_private_process.h \
-src/lib/examine_private_str.h
+src/lib/examine_private_sha.h \
+src/lib/examine_private_stack.h \
+src/lib/examine_private_str.h \
+src/lib/examine_private_symbol_cache.h \
+src/lib/examine_private_thread.h
 
 if HAVE_WIN32
 src_lib_libexamine_la_SOURCES += \
 src/lib/examine_injection.c \
 src/lib/examine_process.c \
-src/lib/examine_stack.c \
 src/lib/examine_injection.h \
-src/lib/examine_process.h \
-src/lib/examine_stack.h
+src/lib/examine_process.h
 else
 src_lib_libexamine_la_SOURCES += src/lib/examine_pe_unix.h
 endif
@@ -41,7 +72,7 @@ src_lib_libexamine_la_CFLAGS = @EXM_CFLAGS@
 if HAVE_WIN32
 src_lib_libexamine_la_LIBADD = @EXM_LIBS@
 else
-src_lib_libexamine_la_LIBADD = -lrt
+src_lib_libexamine_la_LIBADD = @EXM_LIBS@ -lrt -lm -lpthread
 endif
 
 src_lib_libexamine_la_LDFLAGS = -no-undefined -version-info @version_info@
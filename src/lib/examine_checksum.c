@@ -0,0 +1,194 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define EXM_CHECKSUM_SIMD 1
+# include <immintrin.h>
+#endif
+
+#include "Examine.h"
+
+#include "examine_private_checksum.h"
+
+
+/*============================================================================*
+ *                                  Local                                     *
+ *============================================================================*/
+
+
+/*
+ * As 2^16 = 1 modulo 0xffff, the one's complement sum of the 16 bits
+ * words of the PE checksum can be folded from the sum of the 32 bits
+ * words, which are accumulated in 64 bits lanes without any carry to
+ * propagate.
+ */
+
+typedef unsigned long long (*Exm_Checksum_Sum)(const unsigned char *data, size_t size);
+
+static unsigned long long
+_exm_checksum_sum_c(const unsigned char *data, size_t size)
+{
+    unsigned long long sum0 = 0;
+    unsigned long long sum1 = 0;
+
+    for (; size >= 8; size -= 8, data += 8)
+    {
+        sum0 += (unsigned int)data[0] | ((unsigned int)data[1] << 8) |
+                ((unsigned int)data[2] << 16) | ((unsigned int)data[3] << 24);
+        sum1 += (unsigned int)data[4] | ((unsigned int)data[5] << 8) |
+                ((unsigned int)data[6] << 16) | ((unsigned int)data[7] << 24);
+    }
+
+    return sum0 + sum1;
+}
+
+#ifdef EXM_CHECKSUM_SIMD
+
+__attribute__((target("sse2")))
+static unsigned long long
+_exm_checksum_sum_sse2(const unsigned char *data, size_t size)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc0 = _mm_setzero_si128();
+    __m128i acc1 = _mm_setzero_si128();
+    __m128i acc2 = _mm_setzero_si128();
+    __m128i acc3 = _mm_setzero_si128();
+    unsigned long long sums[2];
+
+    for (; size >= 32; size -= 32, data += 32)
+    {
+        __m128i v0;
+        __m128i v1;
+
+        v0 = _mm_loadu_si128((const __m128i *)data);
+        v1 = _mm_loadu_si128((const __m128i *)(data + 16));
+        acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v0, zero));
+        acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v0, zero));
+        acc2 = _mm_add_epi64(acc2, _mm_unpacklo_epi32(v1, zero));
+        acc3 = _mm_add_epi64(acc3, _mm_unpackhi_epi32(v1, zero));
+    }
+
+    acc0 = _mm_add_epi64(_mm_add_epi64(acc0, acc1), _mm_add_epi64(acc2, acc3));
+    _mm_storeu_si128((__m128i *)sums, acc0);
+
+    return sums[0] + sums[1] + _exm_checksum_sum_c(data, size);
+}
+
+__attribute__((target("avx2")))
+static unsigned long long
+_exm_checksum_sum_avx2(const unsigned char *data, size_t size)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    __m256i acc2 = _mm256_setzero_si256();
+    __m256i acc3 = _mm256_setzero_si256();
+    unsigned long long sums[4];
+
+    for (; size >= 64; size -= 64, data += 64)
+    {
+        __m256i v0;
+        __m256i v1;
+
+        v0 = _mm256_loadu_si256((const __m256i *)data);
+        v1 = _mm256_loadu_si256((const __m256i *)(data + 32));
+        acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v0, zero));
+        acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v0, zero));
+        acc2 = _mm256_add_epi64(acc2, _mm256_unpacklo_epi32(v1, zero));
+        acc3 = _mm256_add_epi64(acc3, _mm256_unpackhi_epi32(v1, zero));
+    }
+
+    acc0 = _mm256_add_epi64(_mm256_add_epi64(acc0, acc1), _mm256_add_epi64(acc2, acc3));
+    _mm256_storeu_si256((__m256i *)sums, acc0);
+
+    return sums[0] + sums[1] + sums[2] + sums[3] + _exm_checksum_sum_c(data, size);
+}
+
+#endif
+
+static Exm_Checksum_Sum _exm_checksum_sum = NULL;
+
+
+/*============================================================================*
+ *                                 Global                                     *
+ *============================================================================*/
+
+
+unsigned long long
+exm_checksum_sum(const void *data, size_t size)
+{
+    const unsigned char *d;
+    unsigned long long sum;
+    size_t s;
+
+    /* concurrent initializations store the same value */
+    if (!_exm_checksum_sum)
+        exm_checksum_simd_set(1);
+
+    d = (const unsigned char *)data;
+    s = size & ~(size_t)7;
+    sum = _exm_checksum_sum(d, s);
+
+    /* the last bytes, the last word being padded with zeros */
+    for (; s < size; s++)
+        sum += (unsigned long long)d[s] << (8 * (s & 3));
+
+    return sum;
+}
+
+/*
+ * Use SSE2 or AVX2 if @p enabled is not 0 and if they are supported,
+ * the C implementation otherwise. Return 2 if AVX2 is used, 1 for
+ * SSE2 and 0 for the C implementation.
+ */
+unsigned char
+exm_checksum_simd_set(unsigned char enabled)
+{
+#ifdef EXM_CHECKSUM_SIMD
+    if (enabled)
+    {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            _exm_checksum_sum = _exm_checksum_sum_avx2;
+            return 2;
+        }
+        if (__builtin_cpu_supports("sse2"))
+        {
+            _exm_checksum_sum = _exm_checksum_sum_sse2;
+            return 1;
+        }
+    }
+#else
+    (void)enabled;
+#endif
+
+    _exm_checksum_sum = _exm_checksum_sum_c;
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "Examine.h"
+
+#include "examine_private_coff.h"
+
+
+/*============================================================================*
+ *                                  Local                                     *
+ *============================================================================*/
+
+
+/* size of the code of a function, in its function definition record */
+#define EXM_COFF_AUX_TOTAL_SIZE_OFFSET 4
+
+/*
+ * Return 1 if @p symbol is a function or a label in the code
+ * section @p sh, 0 for the other symbols, like the section
+ * definitions and the file names.
+ */
+static unsigned char
+_exm_coff_symbol_is_code(const IMAGE_SYMBOL *symbol,
+                         const IMAGE_SECTION_HEADER *sh)
+{
+    if ((symbol->StorageClass != IMAGE_SYM_CLASS_EXTERNAL) &&
+        (symbol->StorageClass != IMAGE_SYM_CLASS_STATIC))
+        return 0;
+
+    /* a section definition has the name of the section and a record */
+    if (!ISFCN(symbol->Type) && (symbol->NumberOfAuxSymbols > 0))
+        return 0;
+
+    if (!(sh->Characteristics & (IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE)))
+        return 0;
+
+    /* the linker defines some symbols out of their section */
+    return symbol->Value < sh->Misc.VirtualSize;
+}
+
+
+/*============================================================================*
+ *                                 Global                                     *
+ *============================================================================*/
+
+
+/*
+ * Add the functions of the COFF symbol table of @p pe to @p index.
+ * The symbols typed as functions are added first, so that they are
+ * kept over the other symbols of the code at the same address, like
+ * the ones defined by the linker. The end of a function is given by
+ * its function definition record if it has one, and is the start of
+ * the next function otherwise. Return 0 if @p pe has no symbol table.
+ */
+unsigned char
+exm_coff_index_add(const Exm_Pe *pe, Exm_Symbol_Index *index)
+{
+    const IMAGE_NT_HEADERS *nt_header;
+    const IMAGE_SECTION_HEADER *sections;
+    const IMAGE_SYMBOL *symbol;
+    unsigned int pass;
+
+    if (!exm_pe_coff_symbol_first_get(pe))
+        return 0;
+
+    nt_header = exm_pe_nt_header_get(pe);
+    sections = IMAGE_FIRST_SECTION(nt_header);
+
+    for (pass = 0; pass < 2; pass++)
+    {
+        for (symbol = exm_pe_coff_symbol_first_get(pe);
+             symbol;
+             symbol = exm_pe_coff_symbol_next_get(pe, symbol))
+        {
+            const IMAGE_SECTION_HEADER *sh;
+            char short_name[9];
+            unsigned int start;
+            unsigned int end = 0;
+
+            if ((symbol->SectionNumber <= IMAGE_SYM_UNDEFINED) ||
+                (symbol->SectionNumber > nt_header->FileHeader.NumberOfSections) ||
+                ((pass == 0) != (ISFCN(symbol->Type) != 0)))
+                continue;
+
+            sh = sections + symbol->SectionNumber - 1;
+            if (!_exm_coff_symbol_is_code(symbol, sh))
+                continue;
+
+            start = sh->VirtualAddress + symbol->Value;
+            if (ISFCN(symbol->Type) && (symbol->NumberOfAuxSymbols > 0))
+            {
+                DWORD size;
+
+                memcpy(&size, (const unsigned char *)(symbol + 1) + EXM_COFF_AUX_TOTAL_SIZE_OFFSET, 4);
+                if (size)
+                    end = start + size;
+            }
+
+            exm_symbol_index_function_add(index, start, end,
+                                          exm_pe_coff_symbol_name_get(pe, symbol, short_name));
+        }
+    }
+
+    return 1;
+}
@@ -0,0 +1,2148 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Examine.h"
+
+#include "examine_dwarf.h"
+#include "examine_private_dwarf.h"
+
+
+/*============================================================================*
+ *                                  Local                                     *
+ *============================================================================*/
+
+
+#define DW_LNS_copy 0x01
+#define DW_LNS_advance_pc 0x02
+#define DW_LNS_advance_line 0x03
+#define DW_LNS_set_file 0x04
+#define DW_LNS_set_column 0x05
+#define DW_LNS_negate_stmt 0x06
+#define DW_LNS_set_basic_block 0x07
+#define DW_LNS_const_add_pc 0x08
+#define DW_LNS_fixed_advance_pc 0x09
+#define DW_LNS_set_prologue_end 0x0a
+#define DW_LNS_set_epilogue_begin 0x0b
+#define DW_LNS_set_isa 0x0c
+
+#define DW_LNE_end_sequence 0x01
+#define DW_LNE_set_address 0x02
+#define DW_LNE_define_file 0x03
+#define DW_LNE_set_discriminator 0x04
+
+#define DW_LNCT_path 0x1
+#define DW_LNCT_directory_index 0x2
+
+#define DW_FORM_addr 0x01
+#define DW_FORM_block2 0x03
+#define DW_FORM_block4 0x04
+#define DW_FORM_data2 0x05
+#define DW_FORM_data4 0x06
+#define DW_FORM_data8 0x07
+#define DW_FORM_string 0x08
+#define DW_FORM_block 0x09
+#define DW_FORM_block1 0x0a
+#define DW_FORM_data1 0x0b
+#define DW_FORM_flag 0x0c
+#define DW_FORM_sdata 0x0d
+#define DW_FORM_strp 0x0e
+#define DW_FORM_udata 0x0f
+#define DW_FORM_ref_addr 0x10
+#define DW_FORM_ref1 0x11
+#define DW_FORM_ref2 0x12
+#define DW_FORM_ref4 0x13
+#define DW_FORM_ref8 0x14
+#define DW_FORM_ref_udata 0x15
+#define DW_FORM_indirect 0x16
+#define DW_FORM_sec_offset 0x17
+#define DW_FORM_exprloc 0x18
+#define DW_FORM_flag_present 0x19
+#define DW_FORM_strx 0x1a
+#define DW_FORM_addrx 0x1b
+#define DW_FORM_ref_sup4 0x1c
+#define DW_FORM_strp_sup 0x1d
+#define DW_FORM_data16 0x1e
+#define DW_FORM_line_strp 0x1f
+#define DW_FORM_ref_sig8 0x20
+#define DW_FORM_implicit_const 0x21
+#define DW_FORM_loclistx 0x22
+#define DW_FORM_rnglistx 0x23
+#define DW_FORM_ref_sup8 0x24
+#define DW_FORM_strx1 0x25
+#define DW_FORM_strx2 0x26
+#define DW_FORM_strx3 0x27
+#define DW_FORM_strx4 0x28
+#define DW_FORM_addrx1 0x29
+#define DW_FORM_addrx2 0x2a
+#define DW_FORM_addrx3 0x2b
+#define DW_FORM_addrx4 0x2c
+#define DW_FORM_GNU_addr_index 0x1f01
+#define DW_FORM_GNU_str_index 0x1f02
+#define DW_FORM_GNU_ref_alt 0x1f20
+#define DW_FORM_GNU_strp_alt 0x1f21
+
+#define DW_TAG_class_type 0x02
+#define DW_TAG_enumeration_type 0x04
+#define DW_TAG_structure_type 0x13
+#define DW_TAG_inlined_subroutine 0x1d
+#define DW_TAG_union_type 0x17
+#define DW_TAG_subprogram 0x2e
+
+#define DW_AT_sibling 0x01
+#define DW_AT_name 0x03
+#define DW_AT_stmt_list 0x10
+#define DW_AT_low_pc 0x11
+#define DW_AT_high_pc 0x12
+#define DW_AT_comp_dir 0x1b
+#define DW_AT_abstract_origin 0x31
+#define DW_AT_declaration 0x3c
+#define DW_AT_specification 0x47
+#define DW_AT_ranges 0x55
+#define DW_AT_linkage_name 0x6e
+#define DW_AT_str_offsets_base 0x72
+#define DW_AT_addr_base 0x73
+#define DW_AT_rnglists_base 0x74
+#define DW_AT_MIPS_linkage_name 0x2007
+#define DW_AT_GNU_addr_base 0x2133
+#define DW_AT_GNU_ranges_base 0x2132
+
+#define DW_UT_compile 0x01
+#define DW_UT_type 0x02
+#define DW_UT_partial 0x03
+#define DW_UT_skeleton 0x04
+#define DW_UT_split_compile 0x05
+#define DW_UT_split_type 0x06
+
+#define DW_RLE_end_of_list 0x00
+#define DW_RLE_base_addressx 0x01
+#define DW_RLE_startx_endx 0x02
+#define DW_RLE_startx_length 0x03
+#define DW_RLE_offset_pair 0x04
+#define DW_RLE_base_address 0x05
+#define DW_RLE_start_end 0x06
+#define DW_RLE_start_length 0x07
+
+/*
+ * Bounds checked reading of a section. Once an error is set, all the
+ * reads return 0 and do not move.
+ */
+typedef struct
+{
+    const unsigned char *cur;
+    const unsigned char *end;
+    unsigned char error;
+} Exm_Dwarf_Reader;
+
+/* the directories and files of the header of a line program */
+typedef struct
+{
+    const char *comp_dir; /* from the unit of .debug_info, or NULL */
+    const char **dirs;
+    unsigned int dirs_nbr;
+    unsigned int *files; /* ids of the file names in the symbol index */
+    unsigned int files_nbr;
+} Exm_Dwarf_Line_Files;
+
+static unsigned char
+_exm_dwarf_reader_has(Exm_Dwarf_Reader *r, unsigned long long n)
+{
+    if (r->error || ((unsigned long long)(r->end - r->cur) < n))
+    {
+        r->error = 1;
+        return 0;
+    }
+
+    return 1;
+}
+
+static void
+_exm_dwarf_reader_skip(Exm_Dwarf_Reader *r, unsigned long long n)
+{
+    if (_exm_dwarf_reader_has(r, n))
+        r->cur += n;
+}
+
+static unsigned char
+_exm_dwarf_reader_u8(Exm_Dwarf_Reader *r)
+{
+    unsigned char v;
+
+    if (!_exm_dwarf_reader_has(r, 1))
+        return 0;
+
+    v = exm_dwarf_read_uint8(r->cur);
+    r->cur++;
+
+    return v;
+}
+
+static unsigned short
+_exm_dwarf_reader_u16(Exm_Dwarf_Reader *r)
+{
+    unsigned short v;
+
+    if (!_exm_dwarf_reader_has(r, 2))
+        return 0;
+
+    v = exm_dwarf_read_uint16(r->cur);
+    r->cur += 2;
+
+    return v;
+}
+
+static unsigned int
+_exm_dwarf_reader_u32(Exm_Dwarf_Reader *r)
+{
+    unsigned int v;
+
+    if (!_exm_dwarf_reader_has(r, 4))
+        return 0;
+
+    v = exm_dwarf_read_uint32(r->cur);
+    r->cur += 4;
+
+    return v;
+}
+
+static unsigned long long
+_exm_dwarf_reader_u64(Exm_Dwarf_Reader *r)
+{
+    unsigned long long v;
+
+    if (!_exm_dwarf_reader_has(r, 8))
+        return 0;
+
+    v = exm_dwarf_read_uint64(r->cur);
+    r->cur += 8;
+
+    return v;
+}
+
+/* unsigned value of 1, 2, 4 or 8 bytes */
+static unsigned long long
+_exm_dwarf_reader_uint(Exm_Dwarf_Reader *r, unsigned int size)
+{
+    switch (size)
+    {
+        case 1:
+            return _exm_dwarf_reader_u8(r);
+        case 2:
+            return _exm_dwarf_reader_u16(r);
+        case 4:
+            return _exm_dwarf_reader_u32(r);
+        case 8:
+            return _exm_dwarf_reader_u64(r);
+        default:
+            r->error = 1;
+            return 0;
+    }
+}
+
+static unsigned long long
+_exm_dwarf_reader_uleb128(Exm_Dwarf_Reader *r)
+{
+    unsigned long long v = 0;
+    unsigned int shift = 0;
+    unsigned char b;
+
+    do
+    {
+        if (!_exm_dwarf_reader_has(r, 1))
+            return 0;
+        b = *r->cur++;
+        if (shift < 64)
+            v |= (unsigned long long)(b & 0x7f) << shift;
+        shift += 7;
+    } while (b & 0x80);
+
+    return v;
+}
+
+static long long
+_exm_dwarf_reader_sleb128(Exm_Dwarf_Reader *r)
+{
+    unsigned long long v = 0;
+    unsigned int shift = 0;
+    unsigned char b;
+
+    do
+    {
+        if (!_exm_dwarf_reader_has(r, 1))
+            return 0;
+        b = *r->cur++;
+        if (shift < 64)
+            v |= (unsigned long long)(b & 0x7f) << shift;
+        shift += 7;
+    } while (b & 0x80);
+
+    if ((shift < 64) && (b & 0x40))
+        v |= ~0ULL << shift;
+
+    return (long long)v;
+}
+
+static const char *
+_exm_dwarf_reader_str(Exm_Dwarf_Reader *r)
+{
+    const unsigned char *nul;
+    const char *str;
+
+    if (r->error)
+        return NULL;
+
+    nul = (const unsigned char *)memchr(r->cur, '\0', r->end - r->cur);
+    if (!nul)
+    {
+        r->error = 1;
+        return NULL;
+    }
+
+    str = (const char *)r->cur;
+    r->cur = nul + 1;
+
+    return str;
+}
+
+/* string at the given offset of .debug_str or .debug_line_str */
+static const char *
+_exm_dwarf_section_str_get(const Exm_Dwarf_Section *section, unsigned long long offset)
+{
+    if (!section->data || (offset >= section->size))
+        return NULL;
+
+    if (!memchr(section->data + offset, '\0', section->size - (size_t)offset))
+        return NULL;
+
+    return (const char *)section->data + offset;
+}
+
+/*
+ * Read a value of the entry formats of the DWARF 5 line headers. The
+ * string forms set @p str, the constant ones @p val, and the others
+ * are skipped.
+ */
+static void
+_exm_dwarf_form_read(Exm_Dwarf_Reader *r,
+                     const Exm_Dwarf_Sections *sections,
+                     unsigned long long form,
+                     unsigned int offset_size,
+                     const char **str,
+                     unsigned long long *val)
+{
+    *str = NULL;
+    *val = 0;
+
+    switch (form)
+    {
+        case DW_FORM_string:
+            *str = _exm_dwarf_reader_str(r);
+            break;
+        case DW_FORM_line_strp:
+            *str = _exm_dwarf_section_str_get(&sections->line_str,
+                                              _exm_dwarf_reader_uint(r, offset_size));
+            break;
+        case DW_FORM_strp:
+            *str = _exm_dwarf_section_str_get(&sections->str,
+                                              _exm_dwarf_reader_uint(r, offset_size));
+            break;
+        case DW_FORM_data1:
+            *val = _exm_dwarf_reader_u8(r);
+            break;
+        case DW_FORM_data2:
+            *val = _exm_dwarf_reader_u16(r);
+            break;
+        case DW_FORM_data4:
+            *val = _exm_dwarf_reader_u32(r);
+            break;
+        case DW_FORM_data8:
+            *val = _exm_dwarf_reader_u64(r);
+            break;
+        case DW_FORM_udata:
+            *val = _exm_dwarf_reader_uleb128(r);
+            break;
+        case DW_FORM_sdata:
+            *val = (unsigned long long)_exm_dwarf_reader_sleb128(r);
+            break;
+        case DW_FORM_data16:
+            _exm_dwarf_reader_skip(r, 16);
+            break;
+        case DW_FORM_block:
+            _exm_dwarf_reader_skip(r, _exm_dwarf_reader_uleb128(r));
+            break;
+        case DW_FORM_block1:
+            _exm_dwarf_reader_skip(r, _exm_dwarf_reader_u8(r));
+            break;
+        case DW_FORM_block2:
+            _exm_dwarf_reader_skip(r, _exm_dwarf_reader_u16(r));
+            break;
+        case DW_FORM_block4:
+            _exm_dwarf_reader_skip(r, _exm_dwarf_reader_u32(r));
+            break;
+        default:
+            /* the strx forms need the unit of .debug_info */
+            EXM_LOG_DBG("unsupported form 0x%llx in a line table header", form);
+            r->error = 1;
+            break;
+    }
+}
+
+static unsigned char
+_exm_dwarf_line_dir_add(Exm_Dwarf_Line_Files *lf, const char *dir)
+{
+    const char **dirs;
+
+    if ((lf->dirs_nbr & 15) == 0)
+    {
+        dirs = (const char **)realloc(lf->dirs, (lf->dirs_nbr + 16) * sizeof(const char *));
+        if (!dirs)
+            return 0;
+        lf->dirs = dirs;
+    }
+
+    lf->dirs[lf->dirs_nbr++] = dir;
+
+    return 1;
+}
+
+static unsigned char
+_exm_dwarf_path_is_absolute(const char *path)
+{
+    return (path[0] == '/') || (path[0] == '\\') || (path[0] && (path[1] == ':'));
+}
+
+static unsigned char
+_exm_dwarf_line_file_add(Exm_Dwarf_Line_Files *lf,
+                         Exm_Symbol_Index *index,
+                         const char *name,
+                         unsigned long long dir)
+{
+    char buf[1024];
+    unsigned int *files;
+    const char *d;
+    unsigned int id;
+
+    if ((lf->files_nbr & 15) == 0)
+    {
+        files = (unsigned int *)realloc(lf->files, (lf->files_nbr + 16) * sizeof(unsigned int));
+        if (!files)
+            return 0;
+        lf->files = files;
+    }
+
+    d = (dir < lf->dirs_nbr) ? lf->dirs[dir] : NULL;
+    if (!name)
+        id = 0;
+    else if (!d || !*d || _exm_dwarf_path_is_absolute(name))
+        id = exm_symbol_index_string_add(index, name);
+    else
+    {
+        int l;
+
+        /* a relative directory is relative to the compilation one */
+        if (!_exm_dwarf_path_is_absolute(d) && lf->comp_dir && (d != lf->comp_dir))
+            l = snprintf(buf, sizeof(buf), "%s/%s/%s", lf->comp_dir, d, name);
+        else
+            l = snprintf(buf, sizeof(buf), "%s/%s", d, name);
+        if ((l < 0) || ((size_t)l >= sizeof(buf)))
+            id = exm_symbol_index_string_add(index, name);
+        else
+            id = exm_symbol_index_string_add(index, buf);
+    }
+
+    lf->files[lf->files_nbr++] = id;
+
+    return 1;
+}
+
+/*
+ * Read the directories and files of a DWARF 5 line header, described
+ * by a list of (content type, form) pairs.
+ */
+static void
+_exm_dwarf_line_entries_read(Exm_Dwarf_Reader *r,
+                             const Exm_Dwarf_Sections *sections,
+                             unsigned int offset_size,
+                             Exm_Dwarf_Line_Files *lf,
+                             Exm_Symbol_Index *index,
+                             unsigned char is_file)
+{
+    unsigned long long formats[2 * 255];
+    unsigned long long count;
+    unsigned long long i;
+    unsigned int formats_nbr;
+    unsigned int j;
+
+    formats_nbr = _exm_dwarf_reader_u8(r);
+    for (j = 0; j < formats_nbr; j++)
+    {
+        formats[2 * j] = _exm_dwarf_reader_uleb128(r);
+        formats[2 * j + 1] = _exm_dwarf_reader_uleb128(r);
+    }
+
+    count = _exm_dwarf_reader_uleb128(r);
+    for (i = 0; (i < count) && !r->error; i++)
+    {
+        const char *path = NULL;
+        unsigned long long dir = 0;
+
+        for (j = 0; j < formats_nbr; j++)
+        {
+            const char *str;
+            unsigned long long val;
+
+            _exm_dwarf_form_read(r, sections, formats[2 * j + 1], offset_size,
+                                 &str, &val);
+            if (formats[2 * j] == DW_LNCT_path)
+                path = str;
+            else if (formats[2 * j] == DW_LNCT_directory_index)
+                dir = val;
+        }
+
+        if (r->error)
+            break;
+
+        if (is_file)
+        {
+            if (!_exm_dwarf_line_file_add(lf, index, path, dir))
+                r->error = 1;
+        }
+        else
+        {
+            if (!_exm_dwarf_line_dir_add(lf, path))
+                r->error = 1;
+        }
+    }
+}
+
+/*
+ * Read the directories and files of a DWARF 2 to 4 line header. The
+ * directory 0 is the compilation one, which is not in the line
+ * table but in its unit, and the file 0 does not exist.
+ */
+static void
+_exm_dwarf_line_entries_read_v4(Exm_Dwarf_Reader *r,
+                                Exm_Dwarf_Line_Files *lf,
+                                Exm_Symbol_Index *index)
+{
+    if (!_exm_dwarf_line_dir_add(lf, lf->comp_dir) ||
+        !_exm_dwarf_line_file_add(lf, index, NULL, 0))
+    {
+        r->error = 1;
+        return;
+    }
+
+    while (!r->error)
+    {
+        const char *dir;
+
+        dir = _exm_dwarf_reader_str(r);
+        if (!dir || !*dir)
+            break;
+        if (!_exm_dwarf_line_dir_add(lf, dir))
+            r->error = 1;
+    }
+
+    while (!r->error)
+    {
+        const char *name;
+        unsigned long long dir;
+
+        name = _exm_dwarf_reader_str(r);
+        if (!name || !*name)
+            break;
+        dir = _exm_dwarf_reader_uleb128(r);
+        _exm_dwarf_reader_uleb128(r); /* modification time */
+        _exm_dwarf_reader_uleb128(r); /* length */
+        if (!_exm_dwarf_line_file_add(lf, index, name, dir))
+            r->error = 1;
+    }
+}
+
+static void
+_exm_dwarf_line_row_add(Exm_Symbol_Index *index,
+                        const Exm_Dwarf_Line_Files *lf,
+                        unsigned long long base,
+                        unsigned long long address,
+                        unsigned long long file,
+                        unsigned int line)
+{
+    /* drop the rows of the code that is not in the module */
+    if ((address < base) || (address - base >= 0xffffffff))
+        return;
+
+    exm_symbol_index_line_add(index, (unsigned int)(address - base),
+                              (file < lf->files_nbr) ? lf->files[file] : 0,
+                              line);
+}
+
+/*
+ * Decode the line program of the unit at the current position of
+ * @p r, and move @p r to the next unit.
+ */
+static unsigned char
+_exm_dwarf_line_unit_decode(Exm_Dwarf_Reader *r,
+                            const Exm_Dwarf_Sections *sections,
+                            const char *comp_dir,
+                            unsigned long long base,
+                            Exm_Symbol_Index *index)
+{
+    Exm_Dwarf_Line_Files lf;
+    Exm_Dwarf_Reader u;
+    const unsigned char *standard_opcode_lengths;
+    const unsigned char *program;
+    unsigned long long length;
+    unsigned long long header_length;
+    unsigned long long address;
+    unsigned long long file;
+    unsigned int offset_size;
+    unsigned int op_index;
+    unsigned int line;
+    unsigned short version;
+    unsigned char min_inst_length;
+    unsigned char max_ops;
+    signed char line_base;
+    unsigned char line_range;
+    unsigned char opcode_base;
+
+    offset_size = 4;
+    length = _exm_dwarf_reader_u32(r);
+    if (length == 0xffffffff)
+    {
+        offset_size = 8;
+        length = _exm_dwarf_reader_u64(r);
+    }
+    else if (length >= 0xfffffff0)
+        r->error = 1;
+
+    if (!_exm_dwarf_reader_has(r, length))
+        return 0;
+
+    u.cur = r->cur;
+    u.end = r->cur + length;
+    u.error = 0;
+    r->cur = u.end;
+
+    version = _exm_dwarf_reader_u16(&u);
+    if ((version < 2) || (version > 5))
+    {
+        EXM_LOG_DBG("line table version %d not supported", version);
+        return 1;
+    }
+
+    if (version >= 5)
+    {
+        _exm_dwarf_reader_u8(&u); /* address size */
+        _exm_dwarf_reader_u8(&u); /* segment selector size */
+    }
+
+    header_length = _exm_dwarf_reader_uint(&u, offset_size);
+    if (!_exm_dwarf_reader_has(&u, header_length))
+        return 0;
+    program = u.cur + header_length;
+
+    min_inst_length = _exm_dwarf_reader_u8(&u);
+    max_ops = (version >= 4) ? _exm_dwarf_reader_u8(&u) : 1;
+    if (max_ops == 0)
+        max_ops = 1;
+    _exm_dwarf_reader_u8(&u); /* default is_stmt */
+    line_base = (signed char)_exm_dwarf_reader_u8(&u);
+    line_range = _exm_dwarf_reader_u8(&u);
+    opcode_base = _exm_dwarf_reader_u8(&u);
+    if ((line_range == 0) || (opcode_base == 0))
+        return 0;
+    standard_opcode_lengths = u.cur;
+    _exm_dwarf_reader_skip(&u, opcode_base - 1);
+
+    memset(&lf, 0, sizeof(Exm_Dwarf_Line_Files));
+    lf.comp_dir = comp_dir;
+    if (version >= 5)
+    {
+        _exm_dwarf_line_entries_read(&u, sections, offset_size, &lf, index, 0);
+        _exm_dwarf_line_entries_read(&u, sections, offset_size, &lf, index, 1);
+    }
+    else
+        _exm_dwarf_line_entries_read_v4(&u, &lf, index);
+
+    if (u.error || (program > u.end))
+        goto free_lf;
+
+    u.cur = program;
+
+    address = 0;
+    op_index = 0;
+    file = 1;
+    line = 1;
+    while ((u.cur < u.end) && !u.error)
+    {
+        unsigned long long advance = 0;
+        unsigned char opcode;
+        unsigned char row = 0;
+
+        opcode = _exm_dwarf_reader_u8(&u);
+        if (opcode >= opcode_base)
+        {
+            opcode -= opcode_base;
+            advance = opcode / line_range;
+            line += line_base + opcode % line_range;
+            row = 1;
+        }
+        else if (opcode == 0)
+        {
+            const unsigned char *next;
+            unsigned long long len;
+
+            len = _exm_dwarf_reader_uleb128(&u);
+            if ((len == 0) || !_exm_dwarf_reader_has(&u, len))
+                continue;
+            next = u.cur + len;
+
+            switch (_exm_dwarf_reader_u8(&u))
+            {
+                case DW_LNE_end_sequence:
+                    _exm_dwarf_line_row_add(index, &lf, base, address, file, 0);
+                    address = 0;
+                    op_index = 0;
+                    file = 1;
+                    line = 1;
+                    break;
+                case DW_LNE_set_address:
+                    address = _exm_dwarf_reader_uint(&u, (unsigned int)len - 1);
+                    op_index = 0;
+                    break;
+                case DW_LNE_define_file:
+                {
+                    const char *name;
+                    unsigned long long dir;
+
+                    name = _exm_dwarf_reader_str(&u);
+                    dir = _exm_dwarf_reader_uleb128(&u);
+                    if (!u.error && !_exm_dwarf_line_file_add(&lf, index, name, dir))
+                        u.error = 1;
+                    break;
+                }
+                default:
+                    break;
+            }
+
+            if (!u.error)
+                u.cur = next;
+            continue;
+        }
+        else
+        {
+            switch (opcode)
+            {
+                case DW_LNS_copy:
+                    row = 1;
+                    break;
+                case DW_LNS_advance_pc:
+                    advance = _exm_dwarf_reader_uleb128(&u);
+                    break;
+                case DW_LNS_advance_line:
+                    line += (unsigned int)_exm_dwarf_reader_sleb128(&u);
+                    continue;
+                case DW_LNS_set_file:
+                    file = _exm_dwarf_reader_uleb128(&u);
+                    continue;
+                case DW_LNS_const_add_pc:
+                    advance = (255 - opcode_base) / line_range;
+                    break;
+                case DW_LNS_fixed_advance_pc:
+                    address += _exm_dwarf_reader_u16(&u);
+                    op_index = 0;
+                    continue;
+                case DW_LNS_negate_stmt:
+                case DW_LNS_set_basic_block:
+                case DW_LNS_set_prologue_end:
+                case DW_LNS_set_epilogue_begin:
+                    continue;
+                default:
+                {
+                    unsigned int i;
+
+                    /* DW_LNS_set_column, DW_LNS_set_isa and unknown ones */
+                    for (i = 0; i < standard_opcode_lengths[opcode - 1]; i++)
+                        _exm_dwarf_reader_uleb128(&u);
+                    continue;
+                }
+            }
+        }
+
+        if (max_ops == 1)
+            address += min_inst_length * advance;
+        else
+        {
+            address += min_inst_length * ((op_index + advance) / max_ops);
+            op_index = (unsigned int)((op_index + advance) % max_ops);
+        }
+
+        /* special opcodes and DW_LNS_copy append a row */
+        if (row)
+            _exm_dwarf_line_row_add(index, &lf, base, address, file, line);
+    }
+
+  free_lf:
+    free(lf.files);
+    free(lf.dirs);
+
+    return !u.error;
+}
+
+
+/*
+ * An abbreviation table of .debug_abbrev. The tables are parsed once
+ * and cached by offset, as several units can share the same one. The
+ * declarations are in an array indexed by code when the codes are 1,
+ * 2, 3..., which is what the compilers emit, and sorted by code
+ * otherwise.
+ */
+typedef struct
+{
+    unsigned int name;
+    unsigned int form;
+    long long implicit_const;
+} Exm_Dwarf_Attr_Spec;
+
+typedef struct
+{
+    unsigned long long code;
+    unsigned int tag;
+    unsigned int specs; /* index of the first attribute in the table */
+    unsigned int specs_nbr;
+    int fixed_size; /* size of the attributes if it does not depend on the data, -1 otherwise */
+    unsigned char has_children;
+    unsigned char has_sibling;
+} Exm_Dwarf_Abbrev;
+
+typedef struct
+{
+    unsigned long long offset;
+    unsigned char addr_size;
+    unsigned char offset_size;
+    unsigned char dense;
+    Exm_Dwarf_Abbrev *abbrevs;
+    unsigned int abbrevs_nbr;
+    Exm_Dwarf_Attr_Spec *specs;
+    unsigned int specs_nbr;
+} Exm_Dwarf_Abbrev_Table;
+
+typedef struct
+{
+    Exm_Dwarf_Abbrev_Table **tables; /* sorted by offset */
+    unsigned int tables_nbr;
+} Exm_Dwarf_Abbrev_Cache;
+
+/* a unit of .debug_info */
+typedef struct
+{
+    const Exm_Dwarf_Sections *sections;
+    const unsigned char *start; /* the unit header */
+    const unsigned char *end;
+    const Exm_Dwarf_Abbrev_Table *abbrevs;
+    unsigned long long low_pc; /* base address of the ranges */
+    unsigned long long str_offsets_base;
+    unsigned long long addr_base;
+    unsigned long long rnglists_base;
+    unsigned short version;
+    unsigned char addr_size;
+    unsigned char offset_size;
+} Exm_Dwarf_Unit;
+
+/* an attribute value, the meaning of val depending on the form */
+typedef struct
+{
+    unsigned int form;
+    unsigned long long val;
+    const char *str; /* DW_FORM_string only */
+} Exm_Dwarf_Value;
+
+/* the attributes of a DIE that are used */
+typedef struct
+{
+    Exm_Dwarf_Value low_pc;
+    Exm_Dwarf_Value high_pc;
+    Exm_Dwarf_Value ranges;
+    Exm_Dwarf_Value name;
+    Exm_Dwarf_Value linkage_name;
+    Exm_Dwarf_Value origin; /* DW_AT_specification or DW_AT_abstract_origin */
+    Exm_Dwarf_Value stmt_list;
+    Exm_Dwarf_Value comp_dir;
+    Exm_Dwarf_Value sibling;
+    Exm_Dwarf_Value str_offsets_base;
+    Exm_Dwarf_Value addr_base;
+    Exm_Dwarf_Value rnglists_base;
+    unsigned char declaration;
+} Exm_Dwarf_Die;
+
+/* the line program of a unit, with its compilation directory */
+typedef struct
+{
+    unsigned long long offset;
+    const char *comp_dir;
+} Exm_Dwarf_Line_Program;
+
+/*
+ * Size of the value of a form, if it does not depend on the data,
+ * -1 otherwise.
+ */
+static int
+_exm_dwarf_form_size_get(unsigned int form, unsigned char addr_size, unsigned char offset_size, unsigned short version)
+{
+    switch (form)
+    {
+        case DW_FORM_flag_present:
+        case DW_FORM_implicit_const:
+            return 0;
+        case DW_FORM_data1:
+        case DW_FORM_ref1:
+        case DW_FORM_flag:
+        case DW_FORM_strx1:
+        case DW_FORM_addrx1:
+            return 1;
+        case DW_FORM_data2:
+        case DW_FORM_ref2:
+        case DW_FORM_strx2:
+        case DW_FORM_addrx2:
+            return 2;
+        case DW_FORM_strx3:
+        case DW_FORM_addrx3:
+            return 3;
+        case DW_FORM_data4:
+        case DW_FORM_ref4:
+        case DW_FORM_ref_sup4:
+        case DW_FORM_strx4:
+        case DW_FORM_addrx4:
+            return 4;
+        case DW_FORM_data8:
+        case DW_FORM_ref8:
+        case DW_FORM_ref_sig8:
+        case DW_FORM_ref_sup8:
+            return 8;
+        case DW_FORM_data16:
+            return 16;
+        case DW_FORM_addr:
+            return addr_size;
+        case DW_FORM_ref_addr:
+            return (version <= 2) ? addr_size : offset_size;
+        case DW_FORM_strp:
+        case DW_FORM_line_strp:
+        case DW_FORM_sec_offset:
+        case DW_FORM_strp_sup:
+        case DW_FORM_GNU_ref_alt:
+        case DW_FORM_GNU_strp_alt:
+            return offset_size;
+        default:
+            return -1;
+    }
+}
+
+/*
+ * Read the value of an attribute. The blocks are skipped, and the
+ * value of the other forms is stored as is, to be resolved with the
+ * unit.
+ */
+static void
+_exm_dwarf_value_read(Exm_Dwarf_Reader *r,
+                      const Exm_Dwarf_Unit *unit,
+                      unsigned int form,
+                      long long implicit_const,
+                      Exm_Dwarf_Value *value)
+{
+    int size;
+
+    if (form == DW_FORM_indirect)
+        form = (unsigned int)_exm_dwarf_reader_uleb128(r);
+
+    value->form = form;
+    value->val = 0;
+    value->str = NULL;
+
+    size = _exm_dwarf_form_size_get(form, unit->addr_size, unit->offset_size, unit->version);
+    if (size == 3)
+    {
+        if (_exm_dwarf_reader_has(r, 3))
+        {
+            value->val = exm_dwarf_read_uint24(r->cur);
+            r->cur += 3;
+        }
+        return;
+    }
+    if (size == 16)
+    {
+        _exm_dwarf_reader_skip(r, 16);
+        return;
+    }
+    if (size >= 0)
+    {
+        if (size > 0)
+            value->val = _exm_dwarf_reader_uint(r, (unsigned int)size);
+        else if (form == DW_FORM_implicit_const)
+            value->val = (unsigned long long)implicit_const;
+        else
+            value->val = 1;
+        return;
+    }
+
+    switch (form)
+    {
+        case DW_FORM_string:
+            value->str = _exm_dwarf_reader_str(r);
+            break;
+        case DW_FORM_sdata:
+            value->val = (unsigned long long)_exm_dwarf_reader_sleb128(r);
+            break;
+        case DW_FORM_udata:
+        case DW_FORM_ref_udata:
+        case DW_FORM_strx:
+        case DW_FORM_addrx:
+        case DW_FORM_loclistx:
+        case DW_FORM_rnglistx:
+        case DW_FORM_GNU_addr_index:
+        case DW_FORM_GNU_str_index:
+            value->val = _exm_dwarf_reader_uleb128(r);
+            break;
+        case DW_FORM_block:
+        case DW_FORM_exprloc:
+            _exm_dwarf_reader_skip(r, _exm_dwarf_reader_uleb128(r));
+            break;
+        case DW_FORM_block1:
+            _exm_dwarf_reader_skip(r, _exm_dwarf_reader_u8(r));
+            break;
+        case DW_FORM_block2:
+            _exm_dwarf_reader_skip(r, _exm_dwarf_reader_u16(r));
+            break;
+        case DW_FORM_block4:
+            _exm_dwarf_reader_skip(r, _exm_dwarf_reader_u32(r));
+            break;
+        default:
+            EXM_LOG_DBG("unsupported form 0x%x", form);
+            r->error = 1;
+            break;
+    }
+}
+
+static const char *
+_exm_dwarf_unit_str_get(const Exm_Dwarf_Unit *unit, const Exm_Dwarf_Value *value)
+{
+    const Exm_Dwarf_Section *str_offsets;
+    unsigned long long offset;
+
+    switch (value->form)
+    {
+        case DW_FORM_string:
+            return value->str;
+        case DW_FORM_strp:
+            return _exm_dwarf_section_str_get(&unit->sections->str, value->val);
+        case DW_FORM_line_strp:
+            return _exm_dwarf_section_str_get(&unit->sections->line_str, value->val);
+        case DW_FORM_strx:
+        case DW_FORM_strx1:
+        case DW_FORM_strx2:
+        case DW_FORM_strx3:
+        case DW_FORM_strx4:
+        case DW_FORM_GNU_str_index:
+            str_offsets = &unit->sections->str_offsets;
+            offset = unit->str_offsets_base + value->val * unit->offset_size;
+            if (!str_offsets->data || (offset + unit->offset_size > str_offsets->size))
+                return NULL;
+            if (unit->offset_size == 8)
+                offset = exm_dwarf_read_uint64(str_offsets->data + offset);
+            else
+                offset = exm_dwarf_read_uint32(str_offsets->data + offset);
+            return _exm_dwarf_section_str_get(&unit->sections->str, offset);
+        default:
+            return NULL;
+    }
+}
+
+static unsigned char
+_exm_dwarf_unit_addr_get(const Exm_Dwarf_Unit *unit, unsigned int form, unsigned long long val, unsigned long long *addr)
+{
+    const Exm_Dwarf_Section *debug_addr;
+    unsigned long long offset;
+
+    switch (form)
+    {
+        case DW_FORM_addr:
+            *addr = val;
+            return 1;
+        case DW_FORM_addrx:
+        case DW_FORM_addrx1:
+        case DW_FORM_addrx2:
+        case DW_FORM_addrx3:
+        case DW_FORM_addrx4:
+        case DW_FORM_GNU_addr_index:
+            debug_addr = &unit->sections->addr;
+            offset = unit->addr_base + val * unit->addr_size;
+            if (!debug_addr->data || (offset + unit->addr_size > debug_addr->size))
+                return 0;
+            if (unit->addr_size == 8)
+                *addr = exm_dwarf_read_uint64(debug_addr->data + offset);
+            else
+                *addr = exm_dwarf_read_uint32(debug_addr->data + offset);
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static int
+_exm_dwarf_abbrev_cmp(const void *p1, const void *p2)
+{
+    const Exm_Dwarf_Abbrev *a1;
+    const Exm_Dwarf_Abbrev *a2;
+
+    a1 = (const Exm_Dwarf_Abbrev *)p1;
+    a2 = (const Exm_Dwarf_Abbrev *)p2;
+
+    if (a1->code < a2->code)
+        return -1;
+    if (a1->code > a2->code)
+        return 1;
+    return 0;
+}
+
+static void
+_exm_dwarf_abbrev_table_free(Exm_Dwarf_Abbrev_Table *table)
+{
+    free(table->specs);
+    free(table->abbrevs);
+    free(table);
+}
+
+static Exm_Dwarf_Abbrev_Table *
+_exm_dwarf_abbrev_table_new(const Exm_Dwarf_Section *section,
+                            unsigned long long offset,
+                            unsigned char addr_size,
+                            unsigned char offset_size,
+                            unsigned short version)
+{
+    Exm_Dwarf_Abbrev_Table *table;
+    Exm_Dwarf_Reader r;
+    unsigned int abbrevs_max = 0;
+    unsigned int specs_max = 0;
+    unsigned int i;
+
+    if (!section->data || (offset >= section->size))
+        return NULL;
+
+    table = (Exm_Dwarf_Abbrev_Table *)calloc(1, sizeof(Exm_Dwarf_Abbrev_Table));
+    if (!table)
+        return NULL;
+
+    table->offset = offset;
+    table->addr_size = addr_size;
+    table->offset_size = offset_size;
+
+    r.cur = section->data + offset;
+    r.end = section->data + section->size;
+    r.error = 0;
+
+    for (;;)
+    {
+        Exm_Dwarf_Abbrev *abbrev;
+        unsigned long long code;
+
+        code = _exm_dwarf_reader_uleb128(&r);
+        if ((code == 0) || r.error)
+            break;
+
+        if (table->abbrevs_nbr == abbrevs_max)
+        {
+            abbrev = (Exm_Dwarf_Abbrev *)realloc(table->abbrevs,
+                                                 (abbrevs_max + 64) * sizeof(Exm_Dwarf_Abbrev));
+            if (!abbrev)
+                goto free_table;
+            table->abbrevs = abbrev;
+            abbrevs_max += 64;
+        }
+
+        abbrev = table->abbrevs + table->abbrevs_nbr++;
+        abbrev->code = code;
+        abbrev->tag = (unsigned int)_exm_dwarf_reader_uleb128(&r);
+        abbrev->has_children = _exm_dwarf_reader_u8(&r);
+        abbrev->has_sibling = 0;
+        abbrev->specs = table->specs_nbr;
+        abbrev->specs_nbr = 0;
+        abbrev->fixed_size = 0;
+
+        for (;;)
+        {
+            Exm_Dwarf_Attr_Spec *spec;
+            unsigned int name;
+            unsigned int form;
+            int size;
+
+            name = (unsigned int)_exm_dwarf_reader_uleb128(&r);
+            form = (unsigned int)_exm_dwarf_reader_uleb128(&r);
+            if (((name == 0) && (form == 0)) || r.error)
+                break;
+
+            if (table->specs_nbr == specs_max)
+            {
+                spec = (Exm_Dwarf_Attr_Spec *)realloc(table->specs,
+                                                      (specs_max + 256) * sizeof(Exm_Dwarf_Attr_Spec));
+                if (!spec)
+                    goto free_table;
+                table->specs = spec;
+                specs_max += 256;
+            }
+
+            spec = table->specs + table->specs_nbr++;
+            spec->name = name;
+            spec->form = form;
+            spec->implicit_const = 0;
+            if (form == DW_FORM_implicit_const)
+                spec->implicit_const = _exm_dwarf_reader_sleb128(&r);
+            abbrev->specs_nbr++;
+
+            if (name == DW_AT_sibling)
+                abbrev->has_sibling = 1;
+
+            size = _exm_dwarf_form_size_get(form, addr_size, offset_size, version);
+            if ((size < 0) || (abbrev->fixed_size < 0))
+                abbrev->fixed_size = -1;
+            else
+                abbrev->fixed_size += size;
+        }
+    }
+
+    if (r.error)
+        goto free_table;
+
+    table->dense = 1;
+    for (i = 0; i < table->abbrevs_nbr; i++)
+    {
+        if (table->abbrevs[i].code != i + 1)
+        {
+            table->dense = 0;
+            qsort(table->abbrevs, table->abbrevs_nbr, sizeof(Exm_Dwarf_Abbrev),
+                  _exm_dwarf_abbrev_cmp);
+            break;
+        }
+    }
+
+    return table;
+
+  free_table:
+    EXM_LOG_WARN("Malformed abbreviation table at offset %llu", offset);
+    _exm_dwarf_abbrev_table_free(table);
+
+    return NULL;
+}
+
+static const Exm_Dwarf_Abbrev *
+_exm_dwarf_abbrev_find(const Exm_Dwarf_Abbrev_Table *table, unsigned long long code)
+{
+    Exm_Dwarf_Abbrev key;
+
+    if (table->dense)
+        return ((code >= 1) && (code <= table->abbrevs_nbr)) ? table->abbrevs + code - 1 : NULL;
+
+    key.code = code;
+    return (const Exm_Dwarf_Abbrev *)bsearch(&key, table->abbrevs, table->abbrevs_nbr,
+                                             sizeof(Exm_Dwarf_Abbrev),
+                                             _exm_dwarf_abbrev_cmp);
+}
+
+/*
+ * Return the abbreviation table at the given offset, parsing it if it
+ * is not in the cache. The fixed sizes of the declarations depend on
+ * the sizes of the unit, so they are part of the key.
+ */
+static const Exm_Dwarf_Abbrev_Table *
+_exm_dwarf_abbrev_cache_get(Exm_Dwarf_Abbrev_Cache *cache,
+                            const Exm_Dwarf_Section *section,
+                            unsigned long long offset,
+                            const Exm_Dwarf_Unit *unit)
+{
+    Exm_Dwarf_Abbrev_Table **tables;
+    Exm_Dwarf_Abbrev_Table *table;
+    unsigned int lo;
+    unsigned int hi;
+
+    lo = 0;
+    hi = cache->tables_nbr;
+    while (lo < hi)
+    {
+        unsigned int mid;
+
+        mid = lo + (hi - lo) / 2;
+        if (cache->tables[mid]->offset < offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for (hi = lo; (hi < cache->tables_nbr) && (cache->tables[hi]->offset == offset); hi++)
+    {
+        if ((cache->tables[hi]->addr_size == unit->addr_size) &&
+            (cache->tables[hi]->offset_size == unit->offset_size))
+            return cache->tables[hi];
+    }
+
+    table = _exm_dwarf_abbrev_table_new(section, offset,
+                                        unit->addr_size, unit->offset_size,
+                                        unit->version);
+    if (!table)
+        return NULL;
+
+    if ((cache->tables_nbr & 63) == 0)
+    {
+        tables = (Exm_Dwarf_Abbrev_Table **)realloc(cache->tables,
+                                                    (cache->tables_nbr + 64) * sizeof(Exm_Dwarf_Abbrev_Table *));
+        if (!tables)
+        {
+            _exm_dwarf_abbrev_table_free(table);
+            return NULL;
+        }
+        cache->tables = tables;
+    }
+
+    memmove(cache->tables + lo + 1, cache->tables + lo,
+            (cache->tables_nbr - lo) * sizeof(Exm_Dwarf_Abbrev_Table *));
+    cache->tables[lo] = table;
+    cache->tables_nbr++;
+
+    return table;
+}
+
+static void
+_exm_dwarf_abbrev_cache_free(Exm_Dwarf_Abbrev_Cache *cache)
+{
+    unsigned int i;
+
+    for (i = 0; i < cache->tables_nbr; i++)
+        _exm_dwarf_abbrev_table_free(cache->tables[i]);
+    free(cache->tables);
+}
+
+/*
+ * Read the attributes of a DIE whose abbreviation is @p abbrev and
+ * keep the ones that are used to index the functions.
+ */
+static void
+_exm_dwarf_die_read(Exm_Dwarf_Reader *r,
+                    const Exm_Dwarf_Unit *unit,
+                    const Exm_Dwarf_Abbrev *abbrev,
+                    Exm_Dwarf_Die *die)
+{
+    const Exm_Dwarf_Attr_Spec *spec;
+    unsigned int i;
+
+    memset(die, 0, sizeof(Exm_Dwarf_Die));
+
+    spec = unit->abbrevs->specs + abbrev->specs;
+    for (i = 0; i < abbrev->specs_nbr; i++, spec++)
+    {
+        Exm_Dwarf_Value value;
+
+        _exm_dwarf_value_read(r, unit, spec->form, spec->implicit_const, &value);
+
+        switch (spec->name)
+        {
+            case DW_AT_low_pc:
+                die->low_pc = value;
+                break;
+            case DW_AT_high_pc:
+                die->high_pc = value;
+                break;
+            case DW_AT_ranges:
+                die->ranges = value;
+                break;
+            case DW_AT_name:
+                die->name = value;
+                break;
+            case DW_AT_linkage_name:
+            case DW_AT_MIPS_linkage_name:
+                die->linkage_name = value;
+                break;
+            case DW_AT_specification:
+            case DW_AT_abstract_origin:
+                die->origin = value;
+                break;
+            case DW_AT_stmt_list:
+                die->stmt_list = value;
+                break;
+            case DW_AT_comp_dir:
+                die->comp_dir = value;
+                break;
+            case DW_AT_sibling:
+                die->sibling = value;
+                break;
+            case DW_AT_str_offsets_base:
+                die->str_offsets_base = value;
+                break;
+            case DW_AT_addr_base:
+            case DW_AT_GNU_addr_base:
+                die->addr_base = value;
+                break;
+            case DW_AT_rnglists_base:
+            case DW_AT_GNU_ranges_base:
+                die->rnglists_base = value;
+                break;
+            case DW_AT_declaration:
+                die->declaration = 1;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+/* position in the unit of a reference, or NULL */
+static const unsigned char *
+_exm_dwarf_unit_ref_get(const Exm_Dwarf_Unit *unit, const Exm_Dwarf_Value *value)
+{
+    const unsigned char *p;
+
+    switch (value->form)
+    {
+        case DW_FORM_ref1:
+        case DW_FORM_ref2:
+        case DW_FORM_ref4:
+        case DW_FORM_ref8:
+        case DW_FORM_ref_udata:
+            if (value->val >= (unsigned long long)(unit->end - unit->start))
+                return NULL;
+            return unit->start + value->val;
+        case DW_FORM_ref_addr:
+            /* only the references to the same unit are followed */
+            p = unit->sections->info.data + value->val;
+            if ((value->val >= unit->sections->info.size) ||
+                (p < unit->start) || (p >= unit->end))
+                return NULL;
+            return p;
+        default:
+            return NULL;
+    }
+}
+
+/*
+ * Name of a function: its linkage name, like in the symbol table,
+ * otherwise its name, otherwise the one of its declaration or of its
+ * abstract instance.
+ */
+static const char *
+_exm_dwarf_die_name_get(const Exm_Dwarf_Unit *unit, const Exm_Dwarf_Die *die)
+{
+    const char *name = NULL;
+    Exm_Dwarf_Die origin;
+    const Exm_Dwarf_Die *iter;
+    unsigned int depth;
+
+    iter = die;
+    for (depth = 0; depth < 4; depth++)
+    {
+        const Exm_Dwarf_Abbrev *abbrev;
+        Exm_Dwarf_Reader r;
+
+        if (iter->linkage_name.form)
+            name = _exm_dwarf_unit_str_get(unit, &iter->linkage_name);
+        if (!name && iter->name.form)
+            name = _exm_dwarf_unit_str_get(unit, &iter->name);
+        if (name || !iter->origin.form)
+            break;
+
+        r.cur = _exm_dwarf_unit_ref_get(unit, &iter->origin);
+        if (!r.cur)
+            break;
+        r.end = unit->end;
+        r.error = 0;
+
+        abbrev = _exm_dwarf_abbrev_find(unit->abbrevs, _exm_dwarf_reader_uleb128(&r));
+        if (!abbrev)
+            break;
+        _exm_dwarf_die_read(&r, unit, abbrev, &origin);
+        if (r.error)
+            break;
+        iter = &origin;
+    }
+
+    return name;
+}
+
+static void
+_exm_dwarf_function_add(Exm_Symbol_Index *index,
+                        unsigned long long base,
+                        unsigned long long low,
+                        unsigned long long high,
+                        const char *name)
+{
+    /* drop the functions that are not in the module, like the discarded ones */
+    if ((low < base) || (high <= low) || (high - base > 0xffffffff))
+        return;
+
+    exm_symbol_index_function_add(index,
+                                  (unsigned int)(low - base),
+                                  (unsigned int)(high - base),
+                                  name);
+}
+
+/* the ranges of .debug_ranges, before DWARF 5 */
+static void
+_exm_dwarf_ranges_add(const Exm_Dwarf_Unit *unit,
+                      unsigned long long offset,
+                      unsigned long long base,
+                      const char *name,
+                      Exm_Symbol_Index *index)
+{
+    const Exm_Dwarf_Section *section;
+    Exm_Dwarf_Reader r;
+    unsigned long long largest;
+    unsigned long long range_base;
+
+    section = &unit->sections->ranges;
+    if (!section->data || (offset >= section->size))
+        return;
+
+    r.cur = section->data + offset;
+    r.end = section->data + section->size;
+    r.error = 0;
+
+    largest = (unit->addr_size == 8) ? ~0ULL : 0xffffffffULL;
+    range_base = unit->low_pc;
+    while (!r.error)
+    {
+        unsigned long long start;
+        unsigned long long end;
+
+        start = _exm_dwarf_reader_uint(&r, unit->addr_size);
+        end = _exm_dwarf_reader_uint(&r, unit->addr_size);
+        if (r.error || ((start == 0) && (end == 0)))
+            break;
+        if (start == largest)
+            range_base = end;
+        else
+            _exm_dwarf_function_add(index, base, range_base + start, range_base + end, name);
+    }
+}
+
+/* the ranges of .debug_rnglists, since DWARF 5 */
+static void
+_exm_dwarf_rnglists_add(const Exm_Dwarf_Unit *unit,
+                        const Exm_Dwarf_Value *value,
+                        unsigned long long base,
+                        const char *name,
+                        Exm_Symbol_Index *index)
+{
+    const Exm_Dwarf_Section *section;
+    Exm_Dwarf_Reader r;
+    unsigned long long offset;
+    unsigned long long range_base;
+
+    section = &unit->sections->rnglists;
+    if (!section->data)
+        return;
+
+    offset = value->val;
+    if (value->form == DW_FORM_rnglistx)
+    {
+        /* the offsets of the lists are relative to the table of offsets */
+        unsigned long long entry;
+
+        entry = unit->rnglists_base + value->val * unit->offset_size;
+        if (entry + unit->offset_size > section->size)
+            return;
+        if (unit->offset_size == 8)
+            offset = unit->rnglists_base + exm_dwarf_read_uint64(section->data + entry);
+        else
+            offset = unit->rnglists_base + exm_dwarf_read_uint32(section->data + entry);
+    }
+
+    if (offset >= section->size)
+        return;
+
+    r.cur = section->data + offset;
+    r.end = section->data + section->size;
+    r.error = 0;
+
+    range_base = unit->low_pc;
+    while (!r.error)
+    {
+        unsigned long long start = 0;
+        unsigned long long end = 0;
+        unsigned char kind;
+        unsigned char ok = 1;
+
+        kind = _exm_dwarf_reader_u8(&r);
+        if (r.error || (kind == DW_RLE_end_of_list))
+            break;
+
+        switch (kind)
+        {
+            case DW_RLE_base_addressx:
+                _exm_dwarf_unit_addr_get(unit, DW_FORM_addrx, _exm_dwarf_reader_uleb128(&r), &range_base);
+                continue;
+            case DW_RLE_startx_endx:
+                ok = _exm_dwarf_unit_addr_get(unit, DW_FORM_addrx, _exm_dwarf_reader_uleb128(&r), &start);
+                ok &= _exm_dwarf_unit_addr_get(unit, DW_FORM_addrx, _exm_dwarf_reader_uleb128(&r), &end);
+                break;
+            case DW_RLE_startx_length:
+                ok = _exm_dwarf_unit_addr_get(unit, DW_FORM_addrx, _exm_dwarf_reader_uleb128(&r), &start);
+                end = start + _exm_dwarf_reader_uleb128(&r);
+                break;
+            case DW_RLE_offset_pair:
+                start = range_base + _exm_dwarf_reader_uleb128(&r);
+                end = range_base + _exm_dwarf_reader_uleb128(&r);
+                break;
+            case DW_RLE_base_address:
+                range_base = _exm_dwarf_reader_uint(&r, unit->addr_size);
+                continue;
+            case DW_RLE_start_end:
+                start = _exm_dwarf_reader_uint(&r, unit->addr_size);
+                end = _exm_dwarf_reader_uint(&r, unit->addr_size);
+                break;
+            case DW_RLE_start_length:
+                start = _exm_dwarf_reader_uint(&r, unit->addr_size);
+                end = start + _exm_dwarf_reader_uleb128(&r);
+                break;
+            default:
+                r.error = 1;
+                continue;
+        }
+
+        if (ok && !r.error)
+            _exm_dwarf_function_add(index, base, start, end, name);
+    }
+}
+
+static void
+_exm_dwarf_subprogram_add(const Exm_Dwarf_Unit *unit,
+                          const Exm_Dwarf_Die *die,
+                          unsigned long long base,
+                          Exm_Symbol_Index *index)
+{
+    const char *name;
+    unsigned long long low;
+    unsigned long long high;
+
+    if (die->declaration)
+        return;
+
+    if (die->low_pc.form && die->high_pc.form)
+    {
+        if (!_exm_dwarf_unit_addr_get(unit, die->low_pc.form, die->low_pc.val, &low))
+            return;
+        /* since DWARF 4, the high address can be the size of the function */
+        if (!_exm_dwarf_unit_addr_get(unit, die->high_pc.form, die->high_pc.val, &high))
+            high = low + die->high_pc.val;
+
+        name = _exm_dwarf_die_name_get(unit, die);
+        _exm_dwarf_function_add(index, base, low, high, name);
+    }
+    else if (die->ranges.form)
+    {
+        name = _exm_dwarf_die_name_get(unit, die);
+        if (unit->version >= 5)
+            _exm_dwarf_rnglists_add(unit, &die->ranges, base, name, index);
+        else
+            _exm_dwarf_ranges_add(unit, die->ranges.val, base, name, index);
+    }
+}
+
+static int
+_exm_dwarf_offset_cmp(const void *p1, const void *p2)
+{
+    unsigned long long o1;
+    unsigned long long o2;
+
+    o1 = *(const unsigned long long *)p1;
+    o2 = *(const unsigned long long *)p2;
+
+    if (o1 < o2)
+        return -1;
+    if (o1 > o2)
+        return 1;
+    return 0;
+}
+
+/*
+ * Read .debug_aranges, and return the sorted offsets of the units of
+ * .debug_info that have code, or NULL if there is no such section.
+ */
+static unsigned long long *
+_exm_dwarf_aranges_units_get(const Exm_Dwarf_Section *section, unsigned int *nbr)
+{
+    Exm_Dwarf_Reader r;
+    unsigned long long *units = NULL;
+    unsigned int max = 0;
+
+    *nbr = 0;
+
+    if (!section->data)
+        return NULL;
+
+    r.cur = section->data;
+    r.end = section->data + section->size;
+    r.error = 0;
+
+    while ((r.cur < r.end) && !r.error)
+    {
+        Exm_Dwarf_Reader u;
+        const unsigned char *start;
+        unsigned long long length;
+        unsigned long long info_offset;
+        unsigned int offset_size = 4;
+        unsigned char addr_size;
+        unsigned char has_code = 0;
+
+        start = r.cur;
+        length = _exm_dwarf_reader_u32(&r);
+        if (length == 0xffffffff)
+        {
+            offset_size = 8;
+            length = _exm_dwarf_reader_u64(&r);
+        }
+        if (!_exm_dwarf_reader_has(&r, length))
+            break;
+
+        u.cur = r.cur;
+        u.end = r.cur + length;
+        u.error = 0;
+        r.cur = u.end;
+
+        _exm_dwarf_reader_u16(&u); /* version */
+        info_offset = _exm_dwarf_reader_uint(&u, offset_size);
+        addr_size = _exm_dwarf_reader_u8(&u);
+        _exm_dwarf_reader_u8(&u); /* segment selector size */
+        if ((addr_size != 4) && (addr_size != 8))
+            continue;
+
+        /* the tuples are aligned on their size */
+        _exm_dwarf_reader_skip(&u, (2 * addr_size - (u.cur - start) % (2 * addr_size)) % (2 * addr_size));
+
+        while (!u.error)
+        {
+            unsigned long long addr;
+            unsigned long long len;
+
+            addr = _exm_dwarf_reader_uint(&u, addr_size);
+            len = _exm_dwarf_reader_uint(&u, addr_size);
+            if (u.error || ((addr == 0) && (len == 0)))
+                break;
+            if (len)
+            {
+                has_code = 1;
+                break;
+            }
+        }
+
+        if (!has_code)
+            continue;
+
+        if (*nbr == max)
+        {
+            unsigned long long *tmp;
+
+            max = max ? 2 * max : 64;
+            tmp = (unsigned long long *)realloc(units, max * sizeof(unsigned long long));
+            if (!tmp)
+            {
+                free(units);
+                *nbr = 0;
+                return NULL;
+            }
+            units = tmp;
+        }
+        units[(*nbr)++] = info_offset;
+    }
+
+    if (r.error)
+    {
+        /* the units are then all read */
+        free(units);
+        *nbr = 0;
+        return NULL;
+    }
+
+    if (*nbr > 0)
+        qsort(units, *nbr, sizeof(unsigned long long), _exm_dwarf_offset_cmp);
+
+    return units;
+}
+
+static int
+_exm_dwarf_line_program_cmp(const void *p1, const void *p2)
+{
+    const Exm_Dwarf_Line_Program *l1;
+    const Exm_Dwarf_Line_Program *l2;
+
+    l1 = (const Exm_Dwarf_Line_Program *)p1;
+    l2 = (const Exm_Dwarf_Line_Program *)p2;
+
+    if (l1->offset < l2->offset)
+        return -1;
+    if (l1->offset > l2->offset)
+        return 1;
+    return 0;
+}
+
+/*
+ * Add the functions of the unit at the current position of @p r, and
+ * its line program to @p programs. The DIEs are read in sequence, the
+ * children of the types being skipped with their sibling.
+ */
+static unsigned char
+_exm_dwarf_info_unit_decode(Exm_Dwarf_Reader *r,
+                            const Exm_Dwarf_Sections *sections,
+                            Exm_Dwarf_Abbrev_Cache *cache,
+                            const unsigned long long *aranges_units,
+                            unsigned int aranges_units_nbr,
+                            unsigned long long base,
+                            Exm_Symbol_Index *index,
+                            Exm_Dwarf_Line_Program *program)
+{
+    Exm_Dwarf_Unit unit;
+    Exm_Dwarf_Reader u;
+    Exm_Dwarf_Die die;
+    const Exm_Dwarf_Abbrev *abbrev;
+    unsigned long long length;
+    unsigned long long abbrev_offset;
+    unsigned long long unit_offset;
+    unsigned char unit_type = DW_UT_compile;
+
+    program->offset = ~0ULL;
+    program->comp_dir = NULL;
+
+    memset(&unit, 0, sizeof(Exm_Dwarf_Unit));
+    unit.sections = sections;
+    unit.start = r->cur;
+    unit_offset = r->cur - sections->info.data;
+
+    unit.offset_size = 4;
+    length = _exm_dwarf_reader_u32(r);
+    if (length == 0xffffffff)
+    {
+        unit.offset_size = 8;
+        length = _exm_dwarf_reader_u64(r);
+    }
+    else if (length >= 0xfffffff0)
+        r->error = 1;
+
+    if (!_exm_dwarf_reader_has(r, length))
+        return 0;
+
+    u.cur = r->cur;
+    u.end = r->cur + length;
+    u.error = 0;
+    r->cur = u.end;
+    unit.end = u.end;
+
+    unit.version = _exm_dwarf_reader_u16(&u);
+    if ((unit.version < 2) || (unit.version > 5))
+    {
+        EXM_LOG_DBG("unit version %d not supported", unit.version);
+        return 1;
+    }
+
+    if (unit.version >= 5)
+    {
+        unit_type = _exm_dwarf_reader_u8(&u);
+        unit.addr_size = _exm_dwarf_reader_u8(&u);
+        abbrev_offset = _exm_dwarf_reader_uint(&u, unit.offset_size);
+        if ((unit_type == DW_UT_skeleton) || (unit_type == DW_UT_split_compile))
+            _exm_dwarf_reader_skip(&u, 8); /* dwo id */
+        else if ((unit_type == DW_UT_type) || (unit_type == DW_UT_split_type))
+            return 1;
+    }
+    else
+    {
+        abbrev_offset = _exm_dwarf_reader_uint(&u, unit.offset_size);
+        unit.addr_size = _exm_dwarf_reader_u8(&u);
+    }
+
+    if (u.error || ((unit.addr_size != 4) && (unit.addr_size != 8)))
+        return 0;
+
+    unit.abbrevs = _exm_dwarf_abbrev_cache_get(cache, &sections->abbrev, abbrev_offset, &unit);
+    if (!unit.abbrevs)
+        return 0;
+
+    /* the unit DIE */
+    abbrev = _exm_dwarf_abbrev_find(unit.abbrevs, _exm_dwarf_reader_uleb128(&u));
+    if (!abbrev)
+        return 0;
+    _exm_dwarf_die_read(&u, &unit, abbrev, &die);
+    if (u.error)
+        return 0;
+
+    if (unit.version >= 5)
+    {
+        /* default bases, after the header of the first contribution */
+        unit.str_offsets_base = (unit.offset_size == 8) ? 16 : 8;
+        unit.addr_base = 8;
+        unit.rnglists_base = (unit.offset_size == 8) ? 20 : 12;
+    }
+    if (die.str_offsets_base.form)
+        unit.str_offsets_base = die.str_offsets_base.val;
+    if (die.addr_base.form)
+        unit.addr_base = die.addr_base.val;
+    if (die.rnglists_base.form)
+        unit.rnglists_base = die.rnglists_base.val;
+    if (die.low_pc.form)
+        _exm_dwarf_unit_addr_get(&unit, die.low_pc.form, die.low_pc.val, &unit.low_pc);
+
+    if (die.stmt_list.form)
+    {
+        program->offset = die.stmt_list.val;
+        if (die.comp_dir.form)
+            program->comp_dir = _exm_dwarf_unit_str_get(&unit, &die.comp_dir);
+    }
+
+    /* .debug_aranges tells which units have no code */
+    if (aranges_units &&
+        !bsearch(&unit_offset, aranges_units, aranges_units_nbr,
+                 sizeof(unsigned long long), _exm_dwarf_offset_cmp))
+        return 1;
+
+    while ((u.cur < u.end) && !u.error)
+    {
+        unsigned long long code;
+
+        code = _exm_dwarf_reader_uleb128(&u);
+        if (code == 0)
+            continue;
+
+        abbrev = _exm_dwarf_abbrev_find(unit.abbrevs, code);
+        if (!abbrev)
+        {
+            u.error = 1;
+            break;
+        }
+
+        if ((abbrev->tag == DW_TAG_subprogram) ||
+            (abbrev->tag == DW_TAG_inlined_subroutine))
+        {
+            _exm_dwarf_die_read(&u, &unit, abbrev, &die);
+            if (!u.error)
+                _exm_dwarf_subprogram_add(&unit, &die, base, index);
+        }
+        else if (abbrev->has_children && abbrev->has_sibling &&
+                 ((abbrev->tag == DW_TAG_structure_type) ||
+                  (abbrev->tag == DW_TAG_class_type) ||
+                  (abbrev->tag == DW_TAG_union_type) ||
+                  (abbrev->tag == DW_TAG_enumeration_type)))
+        {
+            const unsigned char *sibling;
+
+            _exm_dwarf_die_read(&u, &unit, abbrev, &die);
+            sibling = _exm_dwarf_unit_ref_get(&unit, &die.sibling);
+            if (sibling && (sibling > u.cur))
+                u.cur = sibling;
+        }
+        else if (abbrev->fixed_size >= 0)
+            _exm_dwarf_reader_skip(&u, (unsigned long long)abbrev->fixed_size);
+        else
+        {
+            const Exm_Dwarf_Attr_Spec *spec;
+            unsigned int i;
+
+            spec = unit.abbrevs->specs + abbrev->specs;
+            for (i = 0; i < abbrev->specs_nbr; i++, spec++)
+            {
+                Exm_Dwarf_Value value;
+
+                _exm_dwarf_value_read(&u, &unit, spec->form, spec->implicit_const, &value);
+            }
+        }
+    }
+
+    return !u.error;
+}
+
+
+static void
+_exm_dwarf_pe_section_get(const Exm_Pe *pe, const char *name, Exm_Dwarf_Section *section)
+{
+    DWORD size;
+
+    section->data = (const unsigned char *)exm_pe_section_data_get(pe, name, &size);
+    section->size = section->data ? size : 0;
+}
+
+
+/*============================================================================*
+ *                                 Global                                     *
+ *============================================================================*/
+
+
+/*
+ * Add the rows of all the line programs of .debug_line to @p index,
+ * the addresses being made relative to @p base. The rows of a unit
+ * that can not be decoded are kept up to the error, and the units
+ * are decoded until the first one whose length is wrong.
+ */
+unsigned char
+exm_dwarf_lines_add(const Exm_Dwarf_Sections *sections,
+                    unsigned long long base,
+                    Exm_Symbol_Index *index)
+{
+    Exm_Dwarf_Reader r;
+    unsigned char res = 1;
+
+    if (!sections->line.data)
+        return 0;
+
+    r.cur = sections->line.data;
+    r.end = sections->line.data + sections->line.size;
+    r.error = 0;
+
+    while ((r.cur < r.end) && !r.error)
+    {
+        if (!_exm_dwarf_line_unit_decode(&r, sections, NULL, base, index))
+            res = 0;
+    }
+
+    if (r.error)
+        EXM_LOG_WARN("Malformed line table at offset %lu",
+                     (unsigned long)(r.cur - sections->line.data));
+
+    return res && !r.error;
+}
+
+
+/*
+ * Add the functions of .debug_info and the rows of their line
+ * programs to @p index, the addresses being made relative to
+ * @p base. The line programs are decoded with the compilation
+ * directory of their unit, each one once. Without .debug_info, all
+ * the line programs of .debug_line are decoded.
+ */
+unsigned char
+exm_dwarf_index_add(const Exm_Dwarf_Sections *sections,
+                    unsigned long long base,
+                    Exm_Symbol_Index *index)
+{
+    Exm_Dwarf_Abbrev_Cache cache;
+    Exm_Dwarf_Reader r;
+    Exm_Dwarf_Line_Program *programs = NULL;
+    unsigned long long *aranges_units;
+    unsigned int aranges_units_nbr;
+    unsigned int programs_nbr = 0;
+    unsigned int programs_max = 0;
+    unsigned int i;
+    unsigned char res = 1;
+
+    if (!sections->info.data || !sections->abbrev.data)
+        return exm_dwarf_lines_add(sections, base, index);
+
+    cache.tables = NULL;
+    cache.tables_nbr = 0;
+
+    aranges_units = _exm_dwarf_aranges_units_get(&sections->aranges, &aranges_units_nbr);
+
+    r.cur = sections->info.data;
+    r.end = sections->info.data + sections->info.size;
+    r.error = 0;
+
+    while ((r.cur < r.end) && !r.error)
+    {
+        Exm_Dwarf_Line_Program program;
+
+        if (!_exm_dwarf_info_unit_decode(&r, sections, &cache,
+                                         aranges_units, aranges_units_nbr,
+                                         base, index, &program))
+            res = 0;
+
+        if (program.offset == ~0ULL)
+            continue;
+
+        if (programs_nbr == programs_max)
+        {
+            Exm_Dwarf_Line_Program *tmp;
+
+            programs_max = programs_max ? 2 * programs_max : 64;
+            tmp = (Exm_Dwarf_Line_Program *)realloc(programs, programs_max * sizeof(Exm_Dwarf_Line_Program));
+            if (!tmp)
+            {
+                res = 0;
+                break;
+            }
+            programs = tmp;
+        }
+        programs[programs_nbr++] = program;
+    }
+
+    if (r.error)
+        EXM_LOG_WARN("Malformed debug info at offset %lu",
+                     (unsigned long)(r.cur - sections->info.data));
+
+    /* several units can share a line program, like with LTO */
+    if (programs_nbr > 0)
+        qsort(programs, programs_nbr, sizeof(Exm_Dwarf_Line_Program),
+              _exm_dwarf_line_program_cmp);
+
+    for (i = 0; i < programs_nbr; i++)
+    {
+        if ((i > 0) && (programs[i].offset == programs[i - 1].offset))
+            continue;
+        if (!sections->line.data || (programs[i].offset >= sections->line.size))
+            continue;
+
+        r.cur = sections->line.data + programs[i].offset;
+        r.end = sections->line.data + sections->line.size;
+        r.error = 0;
+        if (!_exm_dwarf_line_unit_decode(&r, sections, programs[i].comp_dir, base, index))
+            res = 0;
+    }
+
+    free(programs);
+    free(aranges_units);
+    _exm_dwarf_abbrev_cache_free(&cache);
+
+    return res && !r.error;
+}
+
+/*
+ * Fill @p sections with the DWARF sections of the PE file @p pe, as
+ * written by MinGW. Return 0 if there is no .debug_info and no
+ * .debug_line.
+ */
+unsigned char
+exm_dwarf_sections_get(const Exm_Pe *pe, Exm_Dwarf_Sections *sections)
+{
+    _exm_dwarf_pe_section_get(pe, ".debug_line", &sections->line);
+    _exm_dwarf_pe_section_get(pe, ".debug_line_str", &sections->line_str);
+    _exm_dwarf_pe_section_get(pe, ".debug_str", &sections->str);
+    _exm_dwarf_pe_section_get(pe, ".debug_info", &sections->info);
+    _exm_dwarf_pe_section_get(pe, ".debug_abbrev", &sections->abbrev);
+    _exm_dwarf_pe_section_get(pe, ".debug_aranges", &sections->aranges);
+    _exm_dwarf_pe_section_get(pe, ".debug_addr", &sections->addr);
+    _exm_dwarf_pe_section_get(pe, ".debug_str_offsets", &sections->str_offsets);
+    _exm_dwarf_pe_section_get(pe, ".debug_ranges", &sections->ranges);
+    _exm_dwarf_pe_section_get(pe, ".debug_rnglists", &sections->rnglists);
+
+    return (sections->info.data || sections->line.data);
+}
+
+
+/*============================================================================*
+ *                                   API                                      *
+ *============================================================================*/
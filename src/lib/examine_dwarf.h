@@ -27,11 +27,11 @@ typedef union
     signed char sint8;
     signed short sint16;
     signed int sint32;
-    signed __int64 sint64;
+    signed long long sint64;
     unsigned char uint8;
     unsigned short uint16;
     unsigned int uint32;
-    unsigned __int64 uint64;
+    unsigned long long uint64;
 } Exm_Dw_Val_Type;
 
 static __inline__ unsigned char
@@ -64,9 +64,19 @@ static __inline__ unsigned int
 exm_dwarf_read_uint32(const unsigned char *ptr)
 {
 #ifdef WORDS_BIGENDIAN
-    return (unsigned int)((ptr[0] << 24) | (ptr[1] << 16) | (ptr[2] << 8) | ptr[3]);
+    return ((unsigned int)ptr[0] << 24) | ((unsigned int)ptr[1] << 16) | ((unsigned int)ptr[2] << 8) | ptr[3];
 #else
-    return (unsigned int)((ptr[3] << 24) | (ptr[2] << 16) | (ptr[1] << 8) | ptr[0]);
+    return ((unsigned int)ptr[3] << 24) | ((unsigned int)ptr[2] << 16) | ((unsigned int)ptr[1] << 8) | ptr[0];
+#endif
+}
+
+static __inline__ unsigned long long
+exm_dwarf_read_uint64(const unsigned char *ptr)
+{
+#ifdef WORDS_BIGENDIAN
+    return ((unsigned long long)exm_dwarf_read_uint32(ptr) << 32) | exm_dwarf_read_uint32(ptr + 4);
+#else
+    return ((unsigned long long)exm_dwarf_read_uint32(ptr + 4) << 32) | exm_dwarf_read_uint32(ptr);
 #endif
 }
 
@@ -36,6 +36,7 @@
 # undef WIN32_LEAN_AND_MEAN
 #else
 # include <limits.h>
+# include <unistd.h>
 #endif
 
 #include "Examine.h"
@@ -248,7 +249,11 @@ exm_file_set(const char *filename)
     }
 
     memcpy(dir_name_new, dir_name, l);
+#ifdef _WIN32
     dir_name_new[l] = '\\';
+#else
+    dir_name_new[l] = '/';
+#endif
     dir_name_new[l + 1] = '\0';
     free(dir_name);
     tmp = exm_list_prepend_if_new(_exm_file_path,
@@ -281,6 +286,11 @@ exm_file_find(const char *filename)
     char *file = NULL;
     char *base_name = NULL;
 
+    /* a path is not searched */
+    if ((strchr(filename, '/') || strchr(filename, '\\')) &&
+        _exm_file_exists("", filename))
+        return _exm_file_concat("", filename);
+
     exm_file_base_dir_name_get(filename, NULL, &base_name);
 
     if (!base_name)
@@ -350,6 +360,7 @@ exm_file_base_dir_name_get(const char *filename, char **dir_name, char **base_na
     char full_name[PATH_MAX];
     char *res;
     char *file_part;
+    size_t length;
 #endif
 
     if (dir_name) *dir_name = NULL;
@@ -377,7 +388,22 @@ exm_file_base_dir_name_get(const char *filename, char **dir_name, char **base_na
 #else
     res = realpath(filename, full_name);
     if (!res)
-        return;
+    {
+        /* like GetFullPathName(), do not require the file to exist */
+        if (filename[0] == '/')
+            length = 0;
+        else
+        {
+            if (!getcwd(full_name, sizeof(full_name)))
+                return;
+            length = strlen(full_name);
+            full_name[length++] = '/';
+        }
+
+        if (length + strlen(filename) >= sizeof(full_name))
+            return;
+        memcpy(full_name + length, filename, strlen(filename) + 1);
+    }
 
     file_part = strrchr(full_name, '/');
     if (!file_part) // should never get there
@@ -0,0 +1,101 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "Examine.h"
+
+#include "examine_private_histogram.h"
+
+
+/*============================================================================*
+ *                                  Local                                     *
+ *============================================================================*/
+
+
+/*
+ * A counter of a sub-histogram is incremented at most twice per 8
+ * bytes, so 32 bits counters do not overflow in a chunk.
+ */
+#define EXM_HISTOGRAM_CHUNK (1U << 30)
+
+#define EXM_HISTOGRAM_COUNT(w) \
+    do { \
+        h[0][(w) & 0xff]++; \
+        h[1][((w) >> 8) & 0xff]++; \
+        h[2][((w) >> 16) & 0xff]++; \
+        h[3][((w) >> 24) & 0xff]++; \
+        h[0][((w) >> 32) & 0xff]++; \
+        h[1][((w) >> 40) & 0xff]++; \
+        h[2][((w) >> 48) & 0xff]++; \
+        h[3][(w) >> 56]++; \
+    } while (0)
+
+
+/*============================================================================*
+ *                                 Global                                     *
+ *============================================================================*/
+
+
+void
+exm_histogram_add(unsigned long long *counts, const void *data, size_t size)
+{
+    unsigned int h[4][256];
+    const unsigned char *d;
+
+    d = (const unsigned char *)data;
+    while (size)
+    {
+        size_t s;
+        size_t i;
+        int j;
+
+        s = (size > EXM_HISTOGRAM_CHUNK) ? EXM_HISTOGRAM_CHUNK : size;
+        size -= s;
+
+        memset(h, 0, sizeof(h));
+
+        /* 2 words per iteration, the loads are independent */
+        for (; s >= 16; s -= 16, d += 16)
+        {
+            unsigned long long w0;
+            unsigned long long w1;
+
+            memcpy(&w0, d, 8);
+            memcpy(&w1, d + 8, 8);
+            EXM_HISTOGRAM_COUNT(w0);
+            EXM_HISTOGRAM_COUNT(w1);
+        }
+        for (; s; s--, d++)
+            h[0][*d]++;
+
+        for (i = 0; i < 256; i++)
+        {
+            for (j = 0; j < 4; j++)
+                counts[i] += h[j][i];
+        }
+    }
+}
@@ -0,0 +1,848 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+# define EXM_LEAK_SIMD 1
+# include <immintrin.h>
+#endif
+
+#include "Examine.h"
+
+#include "examine_private_leak.h"
+
+
+/**
+ * @defgroup Leak functions
+ *
+ * A leak scan classifies the blocks that are not freed, as valgrind
+ * does. The memory that the program can reach without the heap, the
+ * roots, is scanned for pointers to the blocks, then the content of
+ * each block that is reached. A block is still reachable if a chain of
+ * pointers to its start is found from the roots, and possibly lost if
+ * the only chains to it contain a pointer inside a block. The blocks
+ * that are not reached are then scanned in address order: the blocks
+ * that they reach and that are not reached otherwise are indirectly
+ * lost, the other ones are definitely lost. The bytes indirectly lost
+ * are counted in the definitely lost block that reaches them first.
+ *
+ * The scan is conservative: any aligned word with the address of a
+ * byte of a block is a pointer. Most words are not, so they are first
+ * compared to the range of the addresses of the blocks, several at a
+ * time with SIMD instructions. The block of a word in the range is
+ * then found in the blocks sorted by address, from a table of buckets
+ * that splits the range in about as many parts as there are blocks.
+ * As the pointers are far apart, they are searched by batches, the
+ * buckets and the blocks of a batch being loaded ahead.
+ *
+ * The lost blocks are then grouped in loss records by allocation site
+ * and kind, with a hash table of the records, so that a leak in a loop
+ * gives one record whatever the number of its blocks.
+ *
+ * @{
+ */
+
+
+/*============================================================================*
+ *                                  Local                                     *
+ *============================================================================*/
+
+
+#define EXM_LEAK_NONE ((size_t)-1)
+#define EXM_LEAK_STACK_MIN 1024
+#define EXM_LEAK_BATCH 256
+
+#ifdef __GNUC__
+# define EXM_LEAK_PREFETCH(p) __builtin_prefetch(p)
+#else
+# define EXM_LEAK_PREFETCH(p) do { } while (0)
+#endif
+
+typedef enum
+{
+    EXM_LEAK_STATE_UNREACHED,
+    EXM_LEAK_STATE_DEFINITE, /* not reached, already scanned */
+    EXM_LEAK_STATE_INDIRECT,
+    EXM_LEAK_STATE_POSSIBLE,
+    EXM_LEAK_STATE_REACHABLE
+} Exm_Leak_State;
+
+typedef struct
+{
+    uintptr_t start;
+    uintptr_t end; /* one byte more for an empty block, for it to be found */
+    size_t size;
+    size_t idx; /* index of the block given by the caller */
+} Exm_Leak_Range;
+
+struct _Exm_Leak
+{
+    Exm_Leak_Range *ranges; /* sorted by address */
+    size_t ranges_nbr;
+    unsigned char *states; /* of the ranges */
+    size_t *indirect; /* bytes indirectly lost from the ranges */
+    size_t *buckets; /* first range ending after the start of each bucket */
+    unsigned int shift; /* from the offset of an address to its bucket */
+    uintptr_t min;
+    uintptr_t max; /* end of the last range */
+    size_t *ranges_of; /* range of each block, EXM_LEAK_NONE if not scanned */
+    size_t blocks_nbr;
+    size_t *stack; /* ranges to scan */
+    size_t stack_nbr;
+    size_t stack_max;
+    size_t leader; /* not reached range being scanned */
+    unsigned long long scanned;
+    uintptr_t batch[EXM_LEAK_BATCH]; /* pointers to mark */
+    size_t batch_ranges[EXM_LEAK_BATCH]; /* their buckets, then their ranges */
+    unsigned char batch_from[EXM_LEAK_BATCH]; /* state of their memory */
+    size_t batch_nbr;
+};
+
+typedef void (*Exm_Leak_Scan)(Exm_Leak *leak, const uintptr_t *words, size_t nbr, unsigned char from);
+
+static Exm_Leak_Scan _exm_leak_scan = NULL;
+
+static int
+_exm_leak_record_cmp(const void *d1, const void *d2)
+{
+    const Exm_Leak_Record *r1 = d1;
+    const Exm_Leak_Record *r2 = d2;
+
+    if (r1->bytes + r1->indirect != r2->bytes + r2->indirect)
+        return (r1->bytes + r1->indirect < r2->bytes + r2->indirect) ? -1 : 1;
+    if (r1->blocks != r2->blocks)
+        return (r1->blocks < r2->blocks) ? -1 : 1;
+    if (r1->stack != r2->stack)
+        return (r1->stack < r2->stack) ? -1 : 1;
+
+    return (int)r1->kind - (int)r2->kind;
+}
+
+static int
+_exm_leak_range_cmp(const void *d1, const void *d2)
+{
+    const Exm_Leak_Range *r1 = d1;
+    const Exm_Leak_Range *r2 = d2;
+
+    if (r1->start < r2->start)
+        return -1;
+    else if (r1->start > r2->start)
+        return 1;
+    else
+        return 0;
+}
+
+static unsigned char
+_exm_leak_buckets_new(Exm_Leak *leak)
+{
+    uintptr_t range;
+    size_t nbr;
+    size_t r;
+    size_t k;
+
+    range = leak->max - leak->min;
+    leak->shift = 0;
+    while ((range >> leak->shift) > 2 * leak->ranges_nbr)
+        leak->shift++;
+
+    nbr = (size_t)((range - 1) >> leak->shift) + 1;
+    leak->buckets = (size_t *)malloc((nbr + 1) * sizeof(size_t));
+    if (!leak->buckets)
+        return 0;
+
+    r = 0;
+    for (k = 0; k < nbr; k++)
+    {
+        uintptr_t start;
+
+        start = leak->min + ((uintptr_t)k << leak->shift);
+        while ((r < leak->ranges_nbr) && (leak->ranges[r].end <= start))
+            r++;
+        leak->buckets[k] = r;
+    }
+    leak->buckets[nbr] = leak->ranges_nbr;
+
+    return 1;
+}
+
+/* the range of the address p, in the bucket b */
+static size_t
+_exm_leak_range_find(const Exm_Leak *leak, size_t b, uintptr_t p)
+{
+    size_t lo;
+    size_t hi;
+
+    /*
+     * the range of p, if any, is the first one ending after p, which
+     * is between the first ones ending after the start of its bucket
+     * and after the start of the next one
+     */
+    lo = leak->buckets[b];
+    hi = leak->buckets[b + 1] + 1;
+    if (hi > leak->ranges_nbr)
+        hi = leak->ranges_nbr;
+
+    while (lo < hi)
+    {
+        size_t mid;
+
+        mid = lo + (hi - lo) / 2;
+        if (leak->ranges[mid].end <= p)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if ((lo < leak->ranges_nbr) && (leak->ranges[lo].start <= p))
+        return lo;
+
+    return EXM_LEAK_NONE;
+}
+
+static void
+_exm_leak_push(Exm_Leak *leak, size_t r)
+{
+    if (leak->stack_nbr == leak->stack_max)
+    {
+        size_t *stack;
+        size_t max;
+
+        max = leak->stack_max ? 2 * leak->stack_max : EXM_LEAK_STACK_MIN;
+        stack = (size_t *)realloc(leak->stack, max * sizeof(size_t));
+        if (!stack)
+        {
+            /* the blocks reached only from this one are reported lost */
+            EXM_LOG_ERR("Can not allocate memory for the blocks to scan");
+            return;
+        }
+
+        leak->stack = stack;
+        leak->stack_max = max;
+    }
+
+    leak->stack[leak->stack_nbr++] = r;
+}
+
+/*
+ * Mark the range r of the pointer p, found in memory of the state
+ * from: the roots and the reached blocks, or a block that is not
+ * reached.
+ */
+static void
+_exm_leak_mark(Exm_Leak *leak, size_t r, uintptr_t p, unsigned char from)
+{
+    unsigned char state;
+
+    if (from >= EXM_LEAK_STATE_POSSIBLE)
+    {
+        if ((from == EXM_LEAK_STATE_REACHABLE) && (p == leak->ranges[r].start))
+            state = EXM_LEAK_STATE_REACHABLE;
+        else
+            state = EXM_LEAK_STATE_POSSIBLE;
+
+        if (state <= leak->states[r])
+            return;
+    }
+    else
+    {
+        if (r == leak->leader)
+            return;
+
+        /* a lost block scanned before, with the blocks it reaches */
+        if (leak->states[r] == EXM_LEAK_STATE_DEFINITE)
+        {
+            leak->states[r] = EXM_LEAK_STATE_INDIRECT;
+            leak->indirect[leak->leader] += leak->ranges[r].size + leak->indirect[r];
+            leak->indirect[r] = 0;
+            return;
+        }
+
+        if (leak->states[r] != EXM_LEAK_STATE_UNREACHED)
+            return;
+
+        state = EXM_LEAK_STATE_INDIRECT;
+        leak->indirect[leak->leader] += leak->ranges[r].size;
+    }
+
+    leak->states[r] = state;
+    _exm_leak_push(leak, r);
+}
+
+static void
+_exm_leak_batch_mark(Exm_Leak *leak)
+{
+    size_t nbr;
+    size_t i;
+
+    nbr = leak->batch_nbr;
+    leak->batch_nbr = 0;
+
+    for (i = 0; i < nbr; i++)
+    {
+        leak->batch_ranges[i] = (size_t)((leak->batch[i] - leak->min) >> leak->shift);
+        EXM_LEAK_PREFETCH(leak->buckets + leak->batch_ranges[i]);
+    }
+
+    for (i = 0; i < nbr; i++)
+        EXM_LEAK_PREFETCH(leak->ranges + leak->buckets[leak->batch_ranges[i]]);
+
+    for (i = 0; i < nbr; i++)
+    {
+        leak->batch_ranges[i] = _exm_leak_range_find(leak, leak->batch_ranges[i], leak->batch[i]);
+        if (leak->batch_ranges[i] != EXM_LEAK_NONE)
+            EXM_LEAK_PREFETCH(leak->states + leak->batch_ranges[i]);
+    }
+
+    for (i = 0; i < nbr; i++)
+    {
+        if (leak->batch_ranges[i] != EXM_LEAK_NONE)
+            _exm_leak_mark(leak, leak->batch_ranges[i], leak->batch[i], leak->batch_from[i]);
+    }
+}
+
+/* a word in the range of the blocks, p - min < max - min */
+static void
+_exm_leak_candidate_add(Exm_Leak *leak, uintptr_t p, unsigned char from)
+{
+    leak->batch[leak->batch_nbr] = p;
+    leak->batch_from[leak->batch_nbr] = from;
+    leak->batch_nbr++;
+    if (leak->batch_nbr == EXM_LEAK_BATCH)
+        _exm_leak_batch_mark(leak);
+}
+
+static void
+_exm_leak_scan_c(Exm_Leak *leak, const uintptr_t *words, size_t nbr, unsigned char from)
+{
+    uintptr_t min;
+    uintptr_t range;
+    size_t i;
+
+    min = leak->min;
+    range = leak->max - leak->min;
+    for (i = 0; i < nbr; i++)
+    {
+        /* one comparison, the words below min wrap around */
+        if (words[i] - min < range)
+            _exm_leak_candidate_add(leak, words[i], from);
+    }
+}
+
+#ifdef EXM_LEAK_SIMD
+
+/*
+ * There is no unsigned comparison of 64 bits integers, so the offsets
+ * from min and the range have their sign bit flipped before a signed
+ * one.
+ */
+
+__attribute__((target("sse4.2")))
+static void
+_exm_leak_scan_sse42(Exm_Leak *leak, const uintptr_t *words, size_t nbr, unsigned char from)
+{
+    const __m128i sign = _mm_set1_epi64x(-0x7fffffffffffffffLL - 1);
+    const __m128i min = _mm_set1_epi64x((long long)leak->min);
+    const __m128i range = _mm_xor_si128(_mm_set1_epi64x((long long)(leak->max - leak->min)), sign);
+
+    for (; nbr >= 8; nbr -= 8, words += 8)
+    {
+        __m128i v0;
+        __m128i v1;
+        __m128i v2;
+        __m128i v3;
+        unsigned int mask;
+
+        v0 = _mm_loadu_si128((const __m128i *)words);
+        v1 = _mm_loadu_si128((const __m128i *)(words + 2));
+        v2 = _mm_loadu_si128((const __m128i *)(words + 4));
+        v3 = _mm_loadu_si128((const __m128i *)(words + 6));
+        v0 = _mm_cmpgt_epi64(range, _mm_xor_si128(_mm_sub_epi64(v0, min), sign));
+        v1 = _mm_cmpgt_epi64(range, _mm_xor_si128(_mm_sub_epi64(v1, min), sign));
+        v2 = _mm_cmpgt_epi64(range, _mm_xor_si128(_mm_sub_epi64(v2, min), sign));
+        v3 = _mm_cmpgt_epi64(range, _mm_xor_si128(_mm_sub_epi64(v3, min), sign));
+        mask = (unsigned int)_mm_movemask_pd(_mm_castsi128_pd(v0)) |
+               ((unsigned int)_mm_movemask_pd(_mm_castsi128_pd(v1)) << 2) |
+               ((unsigned int)_mm_movemask_pd(_mm_castsi128_pd(v2)) << 4) |
+               ((unsigned int)_mm_movemask_pd(_mm_castsi128_pd(v3)) << 6);
+        while (mask)
+        {
+            _exm_leak_candidate_add(leak, words[__builtin_ctz(mask)], from);
+            mask &= mask - 1;
+        }
+    }
+
+    _exm_leak_scan_c(leak, words, nbr, from);
+}
+
+__attribute__((target("avx2")))
+static void
+_exm_leak_scan_avx2(Exm_Leak *leak, const uintptr_t *words, size_t nbr, unsigned char from)
+{
+    const __m256i sign = _mm256_set1_epi64x(-0x7fffffffffffffffLL - 1);
+    const __m256i min = _mm256_set1_epi64x((long long)leak->min);
+    const __m256i range = _mm256_xor_si256(_mm256_set1_epi64x((long long)(leak->max - leak->min)), sign);
+
+    for (; nbr >= 16; nbr -= 16, words += 16)
+    {
+        __m256i v0;
+        __m256i v1;
+        __m256i v2;
+        __m256i v3;
+        unsigned int mask;
+
+        v0 = _mm256_loadu_si256((const __m256i *)words);
+        v1 = _mm256_loadu_si256((const __m256i *)(words + 4));
+        v2 = _mm256_loadu_si256((const __m256i *)(words + 8));
+        v3 = _mm256_loadu_si256((const __m256i *)(words + 12));
+        v0 = _mm256_cmpgt_epi64(range, _mm256_xor_si256(_mm256_sub_epi64(v0, min), sign));
+        v1 = _mm256_cmpgt_epi64(range, _mm256_xor_si256(_mm256_sub_epi64(v1, min), sign));
+        v2 = _mm256_cmpgt_epi64(range, _mm256_xor_si256(_mm256_sub_epi64(v2, min), sign));
+        v3 = _mm256_cmpgt_epi64(range, _mm256_xor_si256(_mm256_sub_epi64(v3, min), sign));
+        mask = (unsigned int)_mm256_movemask_pd(_mm256_castsi256_pd(v0)) |
+               ((unsigned int)_mm256_movemask_pd(_mm256_castsi256_pd(v1)) << 4) |
+               ((unsigned int)_mm256_movemask_pd(_mm256_castsi256_pd(v2)) << 8) |
+               ((unsigned int)_mm256_movemask_pd(_mm256_castsi256_pd(v3)) << 12);
+        while (mask)
+        {
+            _exm_leak_candidate_add(leak, words[__builtin_ctz(mask)], from);
+            mask &= mask - 1;
+        }
+    }
+
+    _exm_leak_scan_c(leak, words, nbr, from);
+}
+
+#endif
+
+static void
+_exm_leak_memory_scan(Exm_Leak *leak, const void *start, size_t size, unsigned char from)
+{
+    uintptr_t s;
+    uintptr_t e;
+
+    /* only the aligned words are pointers */
+    s = ((uintptr_t)start + sizeof(uintptr_t) - 1) & ~(uintptr_t)(sizeof(uintptr_t) - 1);
+    e = ((uintptr_t)start + size) & ~(uintptr_t)(sizeof(uintptr_t) - 1);
+    if (e <= s)
+        return;
+
+    leak->scanned += e - s;
+    _exm_leak_scan(leak, (const uintptr_t *)s, (e - s) / sizeof(uintptr_t), from);
+}
+
+static void
+_exm_leak_stack_scan(Exm_Leak *leak)
+{
+    /* the ranges are pushed when the candidates are marked */
+    _exm_leak_batch_mark(leak);
+    while (leak->stack_nbr > 0)
+    {
+        const Exm_Leak_Range *range;
+        size_t r;
+
+        r = leak->stack[--leak->stack_nbr];
+        range = leak->ranges + r;
+        _exm_leak_memory_scan(leak, (const void *)range->start,
+                              (range->size < range->end - range->start) ? range->size : range->end - range->start,
+                              leak->states[r]);
+        if (leak->stack_nbr == 0)
+            _exm_leak_batch_mark(leak);
+    }
+}
+
+
+/*============================================================================*
+ *                                 Global                                     *
+ *============================================================================*/
+
+
+/*
+ * Use SSE4.2 or AVX2 if @p enabled is not 0 and if they are supported,
+ * the C implementation otherwise. Return 2 if AVX2 is used, 1 for
+ * SSE4.2 and 0 for the C implementation.
+ */
+unsigned char
+exm_leak_simd_set(unsigned char enabled)
+{
+#ifdef EXM_LEAK_SIMD
+    if (enabled)
+    {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            _exm_leak_scan = _exm_leak_scan_avx2;
+            return 2;
+        }
+        if (__builtin_cpu_supports("sse4.2"))
+        {
+            _exm_leak_scan = _exm_leak_scan_sse42;
+            return 1;
+        }
+    }
+#else
+    (void)enabled;
+#endif
+
+    _exm_leak_scan = _exm_leak_scan_c;
+
+    return 0;
+}
+
+
+/*============================================================================*
+ *                                   API                                      *
+ *============================================================================*/
+
+
+/**
+ * @brief Return a new leak scan of the given blocks.
+ *
+ * @param[in] blocks The blocks that are not freed.
+ * @param[in] nbr The number of blocks.
+ * @return The new leak scan, or @c NULL on error.
+ *
+ * This function prepares the scan of the @p nbr blocks @p blocks,
+ * which are not used afterwards. The GDI objects and the freed blocks
+ * are not scanned and are definitely lost. The memory of the other
+ * blocks must stay readable until the scan is done. The roots are
+ * then scanned with exm_leak_root_scan() and the blocks with
+ * exm_leak_run(). The leak scan must be freed with exm_leak_free().
+ */
+EXM_API Exm_Leak *
+exm_leak_new(const Exm_Tracker_Block *blocks, size_t nbr)
+{
+    Exm_Leak *leak;
+    size_t i;
+
+    /* concurrent initializations store the same value */
+    if (!_exm_leak_scan)
+        exm_leak_simd_set(1);
+
+    leak = (Exm_Leak *)calloc(1, sizeof(Exm_Leak));
+    if (!leak)
+        return NULL;
+
+    leak->leader = EXM_LEAK_NONE;
+    leak->blocks_nbr = nbr;
+    leak->ranges_of = (size_t *)malloc((nbr ? nbr : 1) * sizeof(size_t));
+    leak->ranges = (Exm_Leak_Range *)malloc((nbr ? nbr : 1) * sizeof(Exm_Leak_Range));
+    if (!leak->ranges_of || !leak->ranges)
+        goto free_leak;
+
+    for (i = 0; i < nbr; i++)
+    {
+        Exm_Leak_Range *range;
+
+        leak->ranges_of[i] = EXM_LEAK_NONE;
+        if ((blocks[i].flags & EXM_TRACKER_BLOCK_GDI) || (blocks[i].frees > 0))
+            continue;
+
+        range = leak->ranges + leak->ranges_nbr++;
+        range->start = (uintptr_t)blocks[i].address;
+        range->end = range->start + (blocks[i].size ? blocks[i].size : 1);
+        range->size = blocks[i].size;
+        range->idx = i;
+    }
+
+    if (leak->ranges_nbr > 0)
+    {
+        qsort(leak->ranges, leak->ranges_nbr, sizeof(Exm_Leak_Range), _exm_leak_range_cmp);
+
+        for (i = 0; i < leak->ranges_nbr; i++)
+        {
+            /*
+             * a stale record overlapping the next block, its free
+             * being missed, must not hide it
+             */
+            if ((i + 1 < leak->ranges_nbr) && (leak->ranges[i].end > leak->ranges[i + 1].start))
+                leak->ranges[i].end = leak->ranges[i + 1].start;
+            leak->ranges_of[leak->ranges[i].idx] = i;
+        }
+
+        leak->min = leak->ranges[0].start;
+        leak->max = leak->ranges[leak->ranges_nbr - 1].end;
+    }
+
+    leak->states = (unsigned char *)calloc(leak->ranges_nbr ? leak->ranges_nbr : 1, 1);
+    leak->indirect = (size_t *)calloc(leak->ranges_nbr ? leak->ranges_nbr : 1, sizeof(size_t));
+    if (!leak->states || !leak->indirect)
+        goto free_leak;
+
+    if ((leak->ranges_nbr > 0) && !_exm_leak_buckets_new(leak))
+        goto free_leak;
+
+    return leak;
+
+  free_leak:
+    exm_leak_free(leak);
+
+    return NULL;
+}
+
+/**
+ * @brief Free the given leak scan.
+ *
+ * @param[inout] leak The leak scan.
+ *
+ * If @p leak is @c NULL, this function does nothing.
+ */
+EXM_API void
+exm_leak_free(Exm_Leak *leak)
+{
+    if (!leak)
+        return;
+
+    free(leak->stack);
+    free(leak->buckets);
+    free(leak->indirect);
+    free(leak->states);
+    free(leak->ranges);
+    free(leak->ranges_of);
+    free(leak);
+}
+
+/**
+ * @brief Scan a root of the given leak scan.
+ *
+ * @param[inout] leak The leak scan.
+ * @param[in] start The start of the root.
+ * @param[in] size The size of the root in bytes.
+ *
+ * This function marks the blocks pointed to by the aligned words of
+ * the @p size readable bytes at @p start, like the data sections of
+ * the modules or the stacks of the threads. The roots must be scanned
+ * before exm_leak_run() is called.
+ */
+EXM_API void
+exm_leak_root_scan(Exm_Leak *leak, const void *start, size_t size)
+{
+    if (!leak || !start)
+        return;
+
+    _exm_leak_memory_scan(leak, start, size, EXM_LEAK_STATE_REACHABLE);
+}
+
+/**
+ * @brief Classify the blocks of the given leak scan.
+ *
+ * @param[inout] leak The leak scan.
+ *
+ * This function scans the blocks reached from the roots, then the
+ * blocks that are not reached, and classifies them. The kind of each
+ * block is then returned by exm_leak_kind_get().
+ */
+EXM_API void
+exm_leak_run(Exm_Leak *leak)
+{
+    size_t r;
+
+    if (!leak)
+        return;
+
+    _exm_leak_stack_scan(leak);
+
+    for (r = 0; r < leak->ranges_nbr; r++)
+    {
+        if (leak->states[r] != EXM_LEAK_STATE_UNREACHED)
+            continue;
+
+        leak->leader = r;
+        leak->states[r] = EXM_LEAK_STATE_DEFINITE;
+        _exm_leak_push(leak, r);
+        _exm_leak_stack_scan(leak);
+    }
+    leak->leader = EXM_LEAK_NONE;
+}
+
+/**
+ * @brief Return the kind of a block of the given leak scan.
+ *
+ * @param[in] leak The leak scan.
+ * @param[in] idx The index of the block given to exm_leak_new().
+ * @return The kind of the block.
+ */
+EXM_API Exm_Leak_Kind
+exm_leak_kind_get(const Exm_Leak *leak, size_t idx)
+{
+    size_t r;
+
+    if (!leak || (idx >= leak->blocks_nbr))
+        return EXM_LEAK_DEFINITELY_LOST;
+
+    r = leak->ranges_of[idx];
+    if (r == EXM_LEAK_NONE)
+        return EXM_LEAK_DEFINITELY_LOST;
+
+    switch (leak->states[r])
+    {
+        case EXM_LEAK_STATE_INDIRECT:
+            return EXM_LEAK_INDIRECTLY_LOST;
+        case EXM_LEAK_STATE_POSSIBLE:
+            return EXM_LEAK_POSSIBLY_LOST;
+        case EXM_LEAK_STATE_REACHABLE:
+            return EXM_LEAK_STILL_REACHABLE;
+        default:
+            return EXM_LEAK_DEFINITELY_LOST;
+    }
+}
+
+/**
+ * @brief Return the bytes indirectly lost from a block of the given leak scan.
+ *
+ * @param[in] leak The leak scan.
+ * @param[in] idx The index of the block given to exm_leak_new().
+ * @return The size of the blocks indirectly lost from the block.
+ *
+ * This function returns the size of the indirectly lost blocks that
+ * are counted in the definitely lost block @p idx, 0 for the other
+ * kinds of blocks.
+ */
+EXM_API size_t
+exm_leak_indirect_get(const Exm_Leak *leak, size_t idx)
+{
+    size_t r;
+
+    if (!leak || (idx >= leak->blocks_nbr))
+        return 0;
+
+    r = leak->ranges_of[idx];
+    if ((r == EXM_LEAK_NONE) || (leak->states[r] != EXM_LEAK_STATE_DEFINITE))
+        return 0;
+
+    return leak->indirect[r];
+}
+
+/**
+ * @brief Return the number of bytes scanned by the given leak scan.
+ *
+ * @param[in] leak The leak scan.
+ * @return The number of bytes of the roots and of the blocks scanned.
+ */
+EXM_API unsigned long long
+exm_leak_scanned_get(const Exm_Leak *leak)
+{
+    if (!leak)
+        return 0;
+
+    return leak->scanned;
+}
+
+/**
+ * @brief Return the loss records of the given leak scan.
+ *
+ * @param[in] leak The leak scan.
+ * @param[in] blocks The blocks given to exm_leak_new().
+ * @param[out] nbr The number of records.
+ * @return The loss records, or @c NULL on error or if no block is lost.
+ *
+ * This function groups the definitely and possibly lost blocks by
+ * their stack and their kind, once exm_leak_run() is called. The
+ * records are sorted by increasing number of bytes, direct and
+ * indirect, so that the largest ones are displayed last. They must be
+ * freed with free().
+ */
+EXM_API Exm_Leak_Record *
+exm_leak_records_new(const Exm_Leak *leak, const Exm_Tracker_Block *blocks, size_t *nbr)
+{
+    Exm_Leak_Record *records;
+    size_t *table; /* index + 1 of the records, 0 for an empty slot */
+    size_t mask;
+    size_t i;
+
+    if (nbr)
+        *nbr = 0;
+
+    if (!leak || !blocks || !nbr || (leak->blocks_nbr == 0))
+        return NULL;
+
+    /* at most one record per block, the table being at most half full */
+    for (mask = 1; mask < 2 * leak->blocks_nbr; mask <<= 1)
+        ;
+    table = (size_t *)calloc(mask, sizeof(size_t));
+    if (!table)
+        return NULL;
+
+    records = (Exm_Leak_Record *)malloc(leak->blocks_nbr * sizeof(Exm_Leak_Record));
+    if (!records)
+    {
+        free(table);
+        return NULL;
+    }
+
+    mask--;
+    for (i = 0; i < leak->blocks_nbr; i++)
+    {
+        Exm_Leak_Record *record;
+        Exm_Leak_Kind kind;
+        size_t h;
+
+        kind = exm_leak_kind_get(leak, i);
+        if ((kind != EXM_LEAK_DEFINITELY_LOST) && (kind != EXM_LEAK_POSSIBLY_LOST))
+            continue;
+
+        /* the consecutive ids of the stacks are spread by an odd factor */
+        h = ((((size_t)blocks[i].stack << 2) | kind) * (size_t)2654435761u) & mask;
+        while (table[h] &&
+               ((records[table[h] - 1].stack != blocks[i].stack) ||
+                (records[table[h] - 1].kind != kind)))
+            h = (h + 1) & mask;
+
+        if (!table[h])
+        {
+            record = records + *nbr;
+            record->stack = blocks[i].stack;
+            record->kind = kind;
+            record->bytes = 0;
+            record->indirect = 0;
+            record->blocks = 0;
+            table[h] = ++(*nbr);
+        }
+        else
+            record = records + table[h] - 1;
+
+        record->bytes += blocks[i].size;
+        record->indirect += exm_leak_indirect_get(leak, i);
+        record->blocks++;
+    }
+
+    free(table);
+
+    if (*nbr == 0)
+    {
+        free(records);
+        return NULL;
+    }
+
+    qsort(records, *nbr, sizeof(Exm_Leak_Record), _exm_leak_record_cmp);
+
+    return records;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,64 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXAMINE_LEAK_H
+#define EXAMINE_LEAK_H
+
+#include <stddef.h>
+
+
+typedef struct _Exm_Leak Exm_Leak;
+
+typedef enum
+{
+    EXM_LEAK_DEFINITELY_LOST, /* no pointer to the block is found */
+    EXM_LEAK_INDIRECTLY_LOST, /* only pointed to by lost blocks */
+    EXM_LEAK_POSSIBLY_LOST, /* reached through an interior pointer */
+    EXM_LEAK_STILL_REACHABLE /* reached from the roots through start pointers */
+} Exm_Leak_Kind;
+
+typedef struct
+{
+    unsigned int stack; /* allocation site of the blocks */
+    Exm_Leak_Kind kind; /* definitely or possibly lost */
+    size_t bytes; /* size of the blocks */
+    size_t indirect; /* bytes indirectly lost from the blocks */
+    size_t blocks;
+} Exm_Leak_Record;
+
+EXM_API Exm_Leak *exm_leak_new(const Exm_Tracker_Block *blocks, size_t nbr);
+
+EXM_API void exm_leak_free(Exm_Leak *leak);
+
+EXM_API void exm_leak_root_scan(Exm_Leak *leak, const void *start, size_t size);
+
+EXM_API void exm_leak_run(Exm_Leak *leak);
+
+EXM_API Exm_Leak_Kind exm_leak_kind_get(const Exm_Leak *leak, size_t idx);
+
+EXM_API size_t exm_leak_indirect_get(const Exm_Leak *leak, size_t idx);
+
+EXM_API unsigned long long exm_leak_scanned_get(const Exm_Leak *leak);
+
+EXM_API Exm_Leak_Record *exm_leak_records_new(const Exm_Leak *leak, const Exm_Tracker_Block *blocks, size_t *nbr);
+
+
+#endif /* EXAMINE_LEAK_H */
@@ -75,6 +75,83 @@ void *alloca (size_t);
 
 static Exm_Log_Level _exm_log_level = EXM_LOG_LEVEL_INFO;
 
+/*
+ * Between exm_log_buffer_begin() and exm_log_buffer_end(), the
+ * messages are appended to this buffer, then written at once.
+ */
+typedef struct
+{
+    char *data;
+    size_t size;
+    size_t max;
+    unsigned char on;
+} Exm_Log_Buffer;
+
+static Exm_Log_Buffer _exm_log_buffer = { NULL, 0, 0, 0 };
+
+static void
+_exm_log_buffer_flush(void)
+{
+    if (_exm_log_buffer.size > 0)
+    {
+        fwrite(_exm_log_buffer.data, 1, _exm_log_buffer.size, stderr);
+        fflush(stderr);
+    }
+    _exm_log_buffer.size = 0;
+}
+
+/* return 0 if the message can not be appended, args being then unused */
+static unsigned char
+_exm_log_buffer_vappend(const char *fmt, va_list args)
+{
+    va_list args_copy;
+    int s;
+
+    va_copy(args_copy, args);
+    s = vsnprintf(_exm_log_buffer.data ? _exm_log_buffer.data + _exm_log_buffer.size : NULL,
+                  _exm_log_buffer.max - _exm_log_buffer.size,
+                  fmt, args_copy);
+    va_end(args_copy);
+    if (s < 0)
+        return 0;
+
+    if ((size_t)s >= _exm_log_buffer.max - _exm_log_buffer.size)
+    {
+        char *data;
+        size_t max;
+
+        max = _exm_log_buffer.max ? _exm_log_buffer.max : 65536;
+        while (max - _exm_log_buffer.size <= (size_t)s)
+            max *= 2;
+
+        data = (char *)realloc(_exm_log_buffer.data, max);
+        if (!data)
+            return 0;
+
+        _exm_log_buffer.data = data;
+        _exm_log_buffer.max = max;
+        vsnprintf(_exm_log_buffer.data + _exm_log_buffer.size,
+                  _exm_log_buffer.max - _exm_log_buffer.size,
+                  fmt, args);
+    }
+    _exm_log_buffer.size += s;
+
+    return 1;
+}
+
+static unsigned char
+_exm_log_buffer_append(const char *fmt, ...)
+{
+    va_list args;
+    unsigned char res;
+
+    va_start(args, fmt);
+    res = _exm_log_buffer_vappend(fmt, args);
+    va_end(args);
+
+    return res;
+}
+
 #ifdef _WIN32
 
 static HANDLE _exm_log_handle_stdout = NULL;
@@ -214,6 +291,36 @@ _exm_log_fprint_cb(FILE *st,
 
 #endif
 
+/*
+ * Append a message to the buffer, with the prefix of the messages
+ * without the colors of the console on Windows. If it can not be
+ * appended, the buffer is written, args being unused, and 0 is
+ * returned.
+ */
+static unsigned char
+_exm_log_buffer_print(Exm_Log_Level level, const char *fmt, va_list args)
+{
+    size_t size;
+
+    size = _exm_log_buffer.size;
+#ifdef _WIN32
+    (void)level;
+    if (_exm_log_buffer_append("==%lu== ", GetCurrentProcessId()) &&
+#else
+    if (_exm_log_buffer_append("%s==%u==\033[0m ",
+                               _exm_log_print_level_color_get(level),
+                               (unsigned int)getpid()) &&
+#endif
+        _exm_log_buffer_vappend(fmt, args) &&
+        _exm_log_buffer_append("\n"))
+        return 1;
+
+    _exm_log_buffer.size = size;
+    _exm_log_buffer_flush();
+
+    return 0;
+}
+
 
 /*============================================================================*
  *                                 Global                                     *
@@ -272,11 +379,38 @@ exm_log_print(Exm_Log_Level level, const char *fmt, ...)
     if (level <= _exm_log_level)
     {
         va_start(args, fmt);
-        exm_log_print_cb_stderr(level, fmt, NULL, args);
+        if (!_exm_log_buffer.on || !_exm_log_buffer_print(level, fmt, args))
+            exm_log_print_cb_stderr(level, fmt, NULL, args);
         va_end(args);
     }
 }
 
+/**
+ * @brief Buffer the messages until exm_log_buffer_end() is called.
+ *
+ * The messages printed by exm_log_print() are kept in memory, to write
+ * a long report, like the one of memcheck, in one call instead of one
+ * per line. This function is not thread safe.
+ */
+EXM_API void
+exm_log_buffer_begin(void)
+{
+    _exm_log_buffer.on = 1;
+}
+
+/**
+ * @brief Write the buffered messages and stop buffering.
+ */
+EXM_API void
+exm_log_buffer_end(void)
+{
+    _exm_log_buffer_flush();
+    _exm_log_buffer.on = 0;
+    free(_exm_log_buffer.data);
+    _exm_log_buffer.data = NULL;
+    _exm_log_buffer.max = 0;
+}
+
 EXM_API void exm_log_level_set(Exm_Log_Level level)
 {
     if ((level < EXM_LOG_LEVEL_ERR) || (level >= EXM_LOG_LEVEL_LAST))
@@ -60,6 +60,10 @@ EXM_API void exm_log_print_cb_stdout(Exm_Log_Level level,
 
 EXM_API void exm_log_print(Exm_Log_Level level, const char *fmt, ...);
 
+EXM_API void exm_log_buffer_begin(void);
+
+EXM_API void exm_log_buffer_end(void);
+
 EXM_API void exm_log_level_set(Exm_Log_Level level);
 
 EXM_API Exm_Log_Level exm_log_level_get(void);
@@ -0,0 +1,1007 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "Examine.h"
+
+#include "examine_dwarf.h"
+#include "examine_private_map.h"
+#include "examine_private_pdb.h"
+
+
+/*============================================================================*
+ *                                  Local                                     *
+ *============================================================================*/
+
+
+/*
+ * A PDB file is a MSF 7.0 file: a set of streams stored in blocks of
+ * the file. The superblock gives the block size and the block that
+ * lists the blocks of the stream directory, which gives the size and
+ * the blocks of each stream.
+ *
+ * The file is mapped, and a stream whose blocks follow each other,
+ * like most of them, is read in place. The other ones are copied.
+ */
+
+#define EXM_PDB_MAGIC "Microsoft C/C++ MSF 7.00\r\n\032DS\0\0\0"
+#define EXM_PDB_MAGIC_SIZE 32
+
+#define EXM_PDB_STREAM_NIL 0xffffffff
+
+/* fixed streams */
+#define EXM_PDB_STREAM_PDB 1
+#define EXM_PDB_STREAM_DBI 3
+
+/* size of the header of the DBI stream */
+#define EXM_PDB_DBI_HEADER_SIZE 64
+/* size of the fixed part of a module description of the DBI stream */
+#define EXM_PDB_DBI_MODULE_SIZE 64
+/* index of the section headers in the optional debug header */
+#define EXM_PDB_DBG_SECTION_HEADERS 5
+
+/* CodeView symbol records */
+#define S_PUB32 0x110e
+#define S_LPROC32 0x110f
+#define S_GPROC32 0x1110
+#define S_LPROC32_ID 0x1146
+#define S_GPROC32_ID 0x1147
+#define S_LPROC32_DPC 0x1155
+#define S_LPROC32_DPC_ID 0x1156
+
+#define CVPSF_FUNCTION 0x2
+
+/* C13 debug subsections */
+#define DEBUG_S_IGNORE 0x80000000
+#define DEBUG_S_LINES 0xf2
+#define DEBUG_S_FILECHKSMS 0xf4
+
+#define CV_LINES_HAVE_COLUMNS 0x1
+
+/* line numbers of the code that has no source line */
+#define EXM_PDB_LINE_HIDDEN_1 0xfeefee
+#define EXM_PDB_LINE_HIDDEN_2 0xf00f00
+
+typedef struct
+{
+    const unsigned char *data;
+    unsigned int size;
+    unsigned char *copy; /* data, if the stream is not contiguous in the file */
+} Exm_Pdb_Stream;
+
+struct _Exm_Pdb
+{
+    char *filename;
+    Exm_Map *map;
+    const unsigned char *base;
+    unsigned long long size;
+    unsigned int block_size;
+    unsigned int blocks_nbr;
+    unsigned char *directory;
+    unsigned int streams_nbr;
+    const unsigned char *stream_sizes; /* in directory */
+    const unsigned char **stream_blocks; /* in directory */
+    unsigned int names_stream; /* the /names stream, or EXM_PDB_STREAM_NIL */
+    GUID guid;
+    DWORD age;
+};
+
+/* the relative virtual addresses of the sections, indexed from 0 */
+typedef struct
+{
+    DWORD *rvas;
+    unsigned int nbr;
+} Exm_Pdb_Sections;
+
+static unsigned int
+_exm_pdb_align4(unsigned int offset)
+{
+    return (offset + 3) & ~3U;
+}
+
+/* length of the string at @p str, or -1 if it is not terminated before @p end */
+static int
+_exm_pdb_str_len(const unsigned char *str, const unsigned char *end)
+{
+    const unsigned char *p;
+
+    if (str >= end)
+        return -1;
+
+    p = (const unsigned char *)memchr(str, 0, end - str);
+    if (!p)
+        return -1;
+
+    return (int)(p - str);
+}
+
+/*
+ * Gather the blocks listed in @p blocks, @p size bytes in total. If
+ * the blocks are contiguous, @p stream points in the mapping,
+ * otherwise the blocks are copied.
+ */
+static unsigned char
+_exm_pdb_blocks_read(const Exm_Pdb *pdb,
+                     const unsigned char *blocks,
+                     unsigned int size,
+                     Exm_Pdb_Stream *stream)
+{
+    unsigned int blocks_nbr;
+    unsigned int first;
+    unsigned int i;
+    unsigned char contiguous = 1;
+
+    stream->data = NULL;
+    stream->size = 0;
+    stream->copy = NULL;
+
+    if (size == 0)
+        return 1;
+
+    blocks_nbr = (size + pdb->block_size - 1) / pdb->block_size;
+    first = exm_dwarf_read_uint32(blocks);
+    for (i = 0; i < blocks_nbr; i++)
+    {
+        unsigned int block;
+
+        block = exm_dwarf_read_uint32(blocks + 4 * i);
+        if (block >= pdb->blocks_nbr)
+        {
+            EXM_LOG_WARN("block %u of PDB file %s out of the file",
+                         block, pdb->filename);
+            return 0;
+        }
+        if (block != first + i)
+            contiguous = 0;
+    }
+
+    if (contiguous)
+    {
+        stream->data = pdb->base + (unsigned long long)first * pdb->block_size;
+        stream->size = size;
+        return 1;
+    }
+
+    stream->copy = (unsigned char *)malloc(size);
+    if (!stream->copy)
+        return 0;
+
+    for (i = 0; i < blocks_nbr; i++)
+    {
+        unsigned int block;
+        unsigned int s;
+
+        block = exm_dwarf_read_uint32(blocks + 4 * i);
+        s = (i + 1 < blocks_nbr) ? pdb->block_size : size - i * pdb->block_size;
+        memcpy(stream->copy + i * pdb->block_size,
+               pdb->base + (unsigned long long)block * pdb->block_size, s);
+    }
+
+    stream->data = stream->copy;
+    stream->size = size;
+
+    return 1;
+}
+
+static unsigned char
+_exm_pdb_stream_get(const Exm_Pdb *pdb, unsigned int idx, Exm_Pdb_Stream *stream)
+{
+    unsigned int size;
+
+    stream->data = NULL;
+    stream->size = 0;
+    stream->copy = NULL;
+
+    if (idx >= pdb->streams_nbr)
+        return 0;
+
+    size = exm_dwarf_read_uint32(pdb->stream_sizes + 4 * idx);
+    if (size == EXM_PDB_STREAM_NIL)
+        return 0;
+
+    return _exm_pdb_blocks_read(pdb, pdb->stream_blocks[idx], size, stream);
+}
+
+static void
+_exm_pdb_stream_release(Exm_Pdb_Stream *stream)
+{
+    free(stream->copy);
+    stream->copy = NULL;
+    stream->data = NULL;
+    stream->size = 0;
+}
+
+/*
+ * Read the stream directory: the number of streams, their sizes, then
+ * the blocks of each stream.
+ */
+static unsigned char
+_exm_pdb_directory_read(Exm_Pdb *pdb, unsigned int size, unsigned int block_map)
+{
+    Exm_Pdb_Stream stream;
+    const unsigned char *blocks;
+    unsigned int blocks_nbr;
+    unsigned long long offset;
+    unsigned int i;
+
+    blocks_nbr = (size + pdb->block_size - 1) / pdb->block_size;
+    if ((block_map >= pdb->blocks_nbr) || (4ULL * blocks_nbr > pdb->block_size))
+        return 0;
+
+    blocks = pdb->base + (unsigned long long)block_map * pdb->block_size;
+    if (!_exm_pdb_blocks_read(pdb, blocks, size, &stream) || (size < 4))
+        return 0;
+
+    /* the directory is kept, as the block lists point in it */
+    pdb->directory = (unsigned char *)malloc(size);
+    if (!pdb->directory)
+    {
+        _exm_pdb_stream_release(&stream);
+        return 0;
+    }
+    memcpy(pdb->directory, stream.data, size);
+    _exm_pdb_stream_release(&stream);
+
+    pdb->streams_nbr = exm_dwarf_read_uint32(pdb->directory);
+    if (4ULL + 4ULL * pdb->streams_nbr > size)
+        return 0;
+    pdb->stream_sizes = pdb->directory + 4;
+
+    pdb->stream_blocks = (const unsigned char **)malloc(pdb->streams_nbr * sizeof(const unsigned char *) + 1);
+    if (!pdb->stream_blocks)
+        return 0;
+
+    offset = 4ULL + 4ULL * pdb->streams_nbr;
+    for (i = 0; i < pdb->streams_nbr; i++)
+    {
+        unsigned int stream_size;
+
+        pdb->stream_blocks[i] = pdb->directory + offset;
+        stream_size = exm_dwarf_read_uint32(pdb->stream_sizes + 4 * i);
+        if (stream_size == EXM_PDB_STREAM_NIL)
+            continue;
+        offset += 4ULL * ((stream_size + pdb->block_size - 1) / pdb->block_size);
+        if (offset > size)
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Read the PDB stream: the version, the signature, the age and the
+ * GUID, then the map of the named streams, a hash table from the
+ * offset of the names in a buffer of strings to the stream index.
+ */
+static unsigned char
+_exm_pdb_info_read(Exm_Pdb *pdb)
+{
+    Exm_Pdb_Stream stream;
+    const unsigned char *p;
+    const unsigned char *end;
+    const unsigned char *strings;
+    const unsigned char *present;
+    unsigned int strings_size;
+    unsigned int buckets;
+    unsigned int words;
+    unsigned int i;
+
+    if (!_exm_pdb_stream_get(pdb, EXM_PDB_STREAM_PDB, &stream))
+        return 0;
+
+    if (stream.size < 28)
+        goto release_stream;
+
+    p = stream.data;
+    end = stream.data + stream.size;
+    pdb->age = exm_dwarf_read_uint32(p + 8);
+    memcpy(&pdb->guid, p + 12, sizeof(GUID));
+    p += 28;
+
+    if (end - p < 4)
+        goto release_stream;
+    strings_size = exm_dwarf_read_uint32(p);
+    p += 4;
+    if ((unsigned int)(end - p) < strings_size)
+        goto release_stream;
+    strings = p;
+    p += strings_size;
+
+    if (end - p < 12)
+        goto release_stream;
+    buckets = exm_dwarf_read_uint32(p + 4); /* capacity */
+    words = exm_dwarf_read_uint32(p + 8);
+    p += 12;
+    if ((unsigned int)(end - p) / 4 < words)
+        goto release_stream;
+    present = p;
+    p += 4 * words;
+
+    /* deleted buckets */
+    if (end - p < 4)
+        goto release_stream;
+    words = exm_dwarf_read_uint32(p);
+    p += 4;
+    if ((unsigned int)(end - p) / 4 < words)
+        goto release_stream;
+    p += 4 * words;
+
+    for (i = 0; i < buckets; i++)
+    {
+        unsigned int key;
+        unsigned int value;
+
+        if ((i / 32 >= (unsigned int)(strings - present) / 4) ||
+            !(exm_dwarf_read_uint32(present + 4 * (i / 32)) & (1U << (i % 32))))
+            continue;
+
+        if (end - p < 8)
+            break;
+        key = exm_dwarf_read_uint32(p);
+        value = exm_dwarf_read_uint32(p + 4);
+        p += 8;
+
+        if ((key < strings_size) &&
+            (_exm_pdb_str_len(strings + key, strings + strings_size) >= 0) &&
+            (strcmp((const char *)strings + key, "/names") == 0))
+            pdb->names_stream = value;
+    }
+
+    _exm_pdb_stream_release(&stream);
+
+    return 1;
+
+  release_stream:
+    _exm_pdb_stream_release(&stream);
+
+    return 0;
+}
+
+static const char *
+_exm_pdb_name_get(const Exm_Pdb_Stream *names, unsigned int offset)
+{
+    unsigned int size;
+
+    /* signature, version and size of the buffer of strings */
+    if (names->size < 12)
+        return NULL;
+
+    size = exm_dwarf_read_uint32(names->data + 8);
+    if ((size > names->size - 12) || (offset >= size))
+        return NULL;
+
+    if (_exm_pdb_str_len(names->data + 12 + offset, names->data + 12 + size) < 0)
+        return NULL;
+
+    return (const char *)names->data + 12 + offset;
+}
+
+static unsigned char
+_exm_pdb_rva_get(const Exm_Pdb_Sections *sections,
+                 unsigned int segment,
+                 unsigned int offset,
+                 unsigned int *rva)
+{
+    if ((segment == 0) || (segment > sections->nbr))
+        return 0;
+
+    *rva = sections->rvas[segment - 1] + offset;
+
+    return 1;
+}
+
+/*
+ * Set the addresses of the sections, from the section headers of the
+ * PDB file if it has them, like the ones written by link.exe, or from
+ * the ones of the PE file otherwise.
+ */
+static unsigned char
+_exm_pdb_sections_get(const Exm_Pdb *pdb,
+                      const Exm_Pdb_Stream *dbi,
+                      const Exm_Pe *pe,
+                      Exm_Pdb_Sections *sections)
+{
+    Exm_Pdb_Stream stream;
+    const unsigned char *p;
+    unsigned long long offset;
+    unsigned int stream_idx = EXM_PDB_STREAM_NIL;
+    unsigned int dbg_size;
+    unsigned int i;
+
+    sections->rvas = NULL;
+    sections->nbr = 0;
+
+    /* the optional debug header is the last substream */
+    p = dbi->data;
+    offset = EXM_PDB_DBI_HEADER_SIZE;
+    offset += exm_dwarf_read_uint32(p + 24); /* modules */
+    offset += exm_dwarf_read_uint32(p + 28); /* section contributions */
+    offset += exm_dwarf_read_uint32(p + 32); /* section map */
+    offset += exm_dwarf_read_uint32(p + 36); /* source files */
+    offset += exm_dwarf_read_uint32(p + 40); /* type server map */
+    offset += exm_dwarf_read_uint32(p + 52); /* EC */
+    dbg_size = exm_dwarf_read_uint32(p + 48);
+    if ((offset + dbg_size <= dbi->size) &&
+        (dbg_size >= 2 * (EXM_PDB_DBG_SECTION_HEADERS + 1)))
+        stream_idx = exm_dwarf_read_uint16(p + offset + 2 * EXM_PDB_DBG_SECTION_HEADERS);
+    if (stream_idx == 0xffff)
+        stream_idx = EXM_PDB_STREAM_NIL;
+
+    if ((stream_idx != EXM_PDB_STREAM_NIL) &&
+        _exm_pdb_stream_get(pdb, stream_idx, &stream))
+    {
+        sections->nbr = stream.size / sizeof(IMAGE_SECTION_HEADER);
+        sections->rvas = (DWORD *)malloc((sections->nbr + 1) * sizeof(DWORD));
+        if (sections->rvas)
+        {
+            for (i = 0; i < sections->nbr; i++)
+                sections->rvas[i] = exm_dwarf_read_uint32(stream.data + i * sizeof(IMAGE_SECTION_HEADER) +
+                                                          FIELD_OFFSET(IMAGE_SECTION_HEADER, VirtualAddress));
+        }
+        _exm_pdb_stream_release(&stream);
+        return sections->rvas != NULL;
+    }
+
+    if (pe)
+    {
+        const IMAGE_NT_HEADERS *nt_header;
+        const IMAGE_SECTION_HEADER *iter;
+
+        nt_header = exm_pe_nt_header_get(pe);
+        sections->nbr = nt_header->FileHeader.NumberOfSections;
+        sections->rvas = (DWORD *)malloc((sections->nbr + 1) * sizeof(DWORD));
+        if (!sections->rvas)
+            return 0;
+
+        iter = IMAGE_FIRST_SECTION(nt_header);
+        for (i = 0; i < sections->nbr; i++, iter++)
+            sections->rvas[i] = iter->VirtualAddress;
+
+        return 1;
+    }
+
+    EXM_LOG_WARN("no section header in PDB file %s", pdb->filename);
+
+    return 0;
+}
+
+/* add the functions of the symbols of a module */
+static void
+_exm_pdb_module_symbols_add(const Exm_Pdb_Stream *module,
+                            unsigned int symbols_size,
+                            const Exm_Pdb_Sections *sections,
+                            Exm_Symbol_Index *index)
+{
+    const unsigned char *p;
+    const unsigned char *end;
+
+    /* the stream starts with the signature of the symbols */
+    p = module->data + 4;
+    end = module->data + symbols_size;
+
+    while (end - p >= 4)
+    {
+        const unsigned char *next;
+        unsigned int kind;
+        unsigned int rva;
+
+        next = p + 2 + exm_dwarf_read_uint16(p);
+        if (next > end)
+            break;
+
+        kind = exm_dwarf_read_uint16(p + 2);
+        switch (kind)
+        {
+            case S_LPROC32:
+            case S_GPROC32:
+            case S_LPROC32_ID:
+            case S_GPROC32_ID:
+            case S_LPROC32_DPC:
+            case S_LPROC32_DPC_ID:
+                /*
+                 * parent, end and next records, code size, debug start
+                 * and end, type, offset, segment, flags, name
+                 */
+                if ((next - p > 39) &&
+                    (_exm_pdb_str_len(p + 39, next) >= 0) &&
+                    _exm_pdb_rva_get(sections,
+                                     exm_dwarf_read_uint16(p + 36),
+                                     exm_dwarf_read_uint32(p + 32),
+                                     &rva))
+                    exm_symbol_index_function_add(index, rva,
+                                                  rva + exm_dwarf_read_uint32(p + 16),
+                                                  (const char *)p + 39);
+                break;
+            default:
+                break;
+        }
+
+        p = next;
+    }
+}
+
+/*
+ * Add the rows of the line subsections of the C13 debug information
+ * of a module. The files of the rows are given as offsets in the file
+ * checksums subsection, whose entries give the offset of the name in
+ * the /names stream.
+ */
+static void
+_exm_pdb_module_lines_add(const Exm_Pdb_Stream *module,
+                          unsigned int offset,
+                          unsigned int size,
+                          const Exm_Pdb_Stream *names,
+                          const Exm_Pdb_Sections *sections,
+                          Exm_Symbol_Index *index)
+{
+    const unsigned char *start;
+    const unsigned char *end;
+    const unsigned char *p;
+    const unsigned char *checksums = NULL;
+    unsigned int checksums_size = 0;
+
+    if ((offset > module->size) || (size > module->size - offset))
+        return;
+
+    start = module->data + offset;
+    end = start + size;
+
+    for (p = start; end - p >= 8; p = start + _exm_pdb_align4((unsigned int)(p - start) + 8 + exm_dwarf_read_uint32(p + 4)))
+    {
+        if (exm_dwarf_read_uint32(p + 4) > (unsigned int)(end - p - 8))
+            break;
+        if (exm_dwarf_read_uint32(p) == DEBUG_S_FILECHKSMS)
+        {
+            checksums = p + 8;
+            checksums_size = exm_dwarf_read_uint32(p + 4);
+            break;
+        }
+    }
+
+    for (p = start; end - p >= 8; p = start + _exm_pdb_align4((unsigned int)(p - start) + 8 + exm_dwarf_read_uint32(p + 4)))
+    {
+        const unsigned char *s;
+        const unsigned char *s_end;
+        unsigned int kind;
+        unsigned int base;
+        unsigned int code_size;
+        unsigned int flags;
+
+        kind = exm_dwarf_read_uint32(p);
+        if (exm_dwarf_read_uint32(p + 4) > (unsigned int)(end - p - 8))
+            break;
+        if ((kind & DEBUG_S_IGNORE) || (kind != DEBUG_S_LINES))
+            continue;
+
+        s = p + 8;
+        s_end = s + exm_dwarf_read_uint32(p + 4);
+        if (s_end - s < 12)
+            continue;
+
+        /* offset, segment, flags and size of the contribution */
+        if (!_exm_pdb_rva_get(sections,
+                              exm_dwarf_read_uint16(s + 4),
+                              exm_dwarf_read_uint32(s),
+                              &base))
+            continue;
+        flags = exm_dwarf_read_uint16(s + 6);
+        code_size = exm_dwarf_read_uint32(s + 8);
+        s += 12;
+
+        /* blocks of lines of a file */
+        while (s_end - s >= 12)
+        {
+            const char *filename = NULL;
+            unsigned int file_id;
+            unsigned int file;
+            unsigned int lines_nbr;
+            unsigned int block_size;
+            unsigned int i;
+
+            file_id = exm_dwarf_read_uint32(s);
+            lines_nbr = exm_dwarf_read_uint32(s + 4);
+            block_size = exm_dwarf_read_uint32(s + 8);
+            if ((block_size < 12) || (block_size > (unsigned int)(s_end - s)) ||
+                (lines_nbr > (block_size - 12) / ((flags & CV_LINES_HAVE_COLUMNS) ? 12 : 8)))
+                break;
+
+            if (checksums && (file_id <= checksums_size) && (checksums_size - file_id >= 4))
+                filename = _exm_pdb_name_get(names, exm_dwarf_read_uint32(checksums + file_id));
+            file = exm_symbol_index_string_add(index, filename);
+
+            for (i = 0; i < lines_nbr; i++)
+            {
+                unsigned int line_offset;
+                unsigned int line;
+
+                line_offset = exm_dwarf_read_uint32(s + 12 + 8 * i);
+                line = exm_dwarf_read_uint32(s + 12 + 8 * i + 4) & 0xffffff;
+                if ((line == 0) ||
+                    (line == EXM_PDB_LINE_HIDDEN_1) ||
+                    (line == EXM_PDB_LINE_HIDDEN_2))
+                    continue;
+
+                exm_symbol_index_line_add(index, base + line_offset, file, line);
+            }
+
+            s += block_size;
+        }
+
+        /* end of the sequence */
+        exm_symbol_index_line_add(index, base + code_size, 0, 0);
+    }
+}
+
+/* add the functions of the public symbols, for the modules without symbols */
+static void
+_exm_pdb_publics_add(const Exm_Pdb *pdb,
+                     unsigned int stream_idx,
+                     const Exm_Pdb_Sections *sections,
+                     Exm_Symbol_Index *index)
+{
+    Exm_Pdb_Stream stream;
+    const unsigned char *p;
+    const unsigned char *end;
+
+    if (!_exm_pdb_stream_get(pdb, stream_idx, &stream))
+        return;
+
+    p = stream.data;
+    end = stream.data + stream.size;
+    while (end - p >= 4)
+    {
+        const unsigned char *next;
+        unsigned int rva;
+
+        next = p + 2 + exm_dwarf_read_uint16(p);
+        if (next > end)
+            break;
+
+        /* flags, offset, segment, name */
+        if ((exm_dwarf_read_uint16(p + 2) == S_PUB32) &&
+            (next - p > 14) &&
+            (exm_dwarf_read_uint32(p + 4) & CVPSF_FUNCTION) &&
+            (_exm_pdb_str_len(p + 14, next) >= 0) &&
+            _exm_pdb_rva_get(sections,
+                             exm_dwarf_read_uint16(p + 12),
+                             exm_dwarf_read_uint32(p + 8),
+                             &rva))
+            exm_symbol_index_function_add(index, rva, 0, (const char *)p + 14);
+
+        p = next;
+    }
+
+    _exm_pdb_stream_release(&stream);
+}
+
+static Exm_Pdb *
+_exm_pdb_candidate_open(const char *dir, size_t dir_len, const char *name, const GUID *guid, DWORD age)
+{
+    Exm_Pdb *pdb;
+    char *filename;
+    size_t name_len;
+
+    name_len = strlen(name);
+    filename = (char *)malloc(dir_len + name_len + 1);
+    if (!filename)
+        return NULL;
+
+    memcpy(filename, dir, dir_len);
+    memcpy(filename + dir_len, name, name_len + 1);
+
+    EXM_LOG_DBG("Searching PDB file %s", filename);
+    pdb = exm_pdb_new(filename);
+    free(filename);
+
+    if (pdb && !exm_pdb_match(pdb, guid, age))
+    {
+        EXM_LOG_DBG("PDB file %s does not match", exm_pdb_filename_get(pdb));
+        exm_pdb_free(pdb);
+        pdb = NULL;
+    }
+
+    return pdb;
+}
+
+static const char *
+_exm_pdb_base_name_get(const char *filename)
+{
+    const char *base_name;
+    const char *iter;
+
+    base_name = filename;
+    for (iter = filename; *iter; iter++)
+    {
+        if ((*iter == '/') || (*iter == '\\'))
+            base_name = iter + 1;
+    }
+
+    return base_name;
+}
+
+
+/*============================================================================*
+ *                                 Global                                     *
+ *============================================================================*/
+
+
+/*
+ * Open the PDB file @p filename: map it and read its stream directory
+ * and its PDB stream. Return NULL if it is not a MSF 7.0 file.
+ */
+Exm_Pdb *
+exm_pdb_new(const char *filename)
+{
+    Exm_Pdb *pdb;
+    size_t l;
+
+    pdb = (Exm_Pdb *)calloc(1, sizeof(Exm_Pdb));
+    if (!pdb)
+        return NULL;
+
+    pdb->names_stream = EXM_PDB_STREAM_NIL;
+
+    l = strlen(filename) + 1;
+    pdb->filename = (char *)malloc(l);
+    if (!pdb->filename)
+        goto free_pdb;
+    memcpy(pdb->filename, filename, l);
+
+    pdb->map = exm_map_new(filename);
+    if (!pdb->map)
+        goto free_pdb;
+
+    pdb->base = (const unsigned char *)exm_map_base_get(pdb->map);
+    pdb->size = exm_map_size_get(pdb->map);
+
+    /* magic, block size, free block map, number of blocks, directory size, unknown, block map */
+    if ((pdb->size < EXM_PDB_MAGIC_SIZE + 24) ||
+        (memcmp(pdb->base, EXM_PDB_MAGIC, EXM_PDB_MAGIC_SIZE) != 0))
+    {
+        EXM_LOG_ERR("%s is not a PDB 7.0 file", filename);
+        goto free_pdb;
+    }
+
+    pdb->block_size = exm_dwarf_read_uint32(pdb->base + EXM_PDB_MAGIC_SIZE);
+    pdb->blocks_nbr = exm_dwarf_read_uint32(pdb->base + EXM_PDB_MAGIC_SIZE + 8);
+    if ((pdb->block_size != 512) && (pdb->block_size != 1024) &&
+        (pdb->block_size != 2048) && (pdb->block_size != 4096))
+    {
+        EXM_LOG_ERR("invalid block size %u in PDB file %s", pdb->block_size, filename);
+        goto free_pdb;
+    }
+
+    /* the blocks must be in the file */
+    if ((unsigned long long)pdb->blocks_nbr * pdb->block_size > pdb->size)
+        pdb->blocks_nbr = (unsigned int)(pdb->size / pdb->block_size);
+
+    if (!_exm_pdb_directory_read(pdb,
+                                 exm_dwarf_read_uint32(pdb->base + EXM_PDB_MAGIC_SIZE + 12),
+                                 exm_dwarf_read_uint32(pdb->base + EXM_PDB_MAGIC_SIZE + 20)))
+    {
+        EXM_LOG_ERR("invalid stream directory in PDB file %s", filename);
+        goto free_pdb;
+    }
+
+    if (!_exm_pdb_info_read(pdb))
+    {
+        EXM_LOG_ERR("invalid PDB stream in PDB file %s", filename);
+        goto free_pdb;
+    }
+
+    return pdb;
+
+  free_pdb:
+    exm_pdb_free(pdb);
+
+    return NULL;
+}
+
+void
+exm_pdb_free(Exm_Pdb *pdb)
+{
+    if (!pdb)
+        return;
+
+    free(pdb->stream_blocks);
+    free(pdb->directory);
+    if (pdb->map)
+        exm_map_del(pdb->map);
+    free(pdb->filename);
+    free(pdb);
+}
+
+const char *
+exm_pdb_filename_get(const Exm_Pdb *pdb)
+{
+    return pdb->filename;
+}
+
+/*
+ * Return 1 if @p pdb is the PDB file of the PE file whose CodeView
+ * record has @p guid and @p age, 0 otherwise.
+ */
+unsigned char
+exm_pdb_match(const Exm_Pdb *pdb, const GUID *guid, DWORD age)
+{
+    return (memcmp(&pdb->guid, guid, sizeof(GUID)) == 0) && (pdb->age == age);
+}
+
+/*
+ * Open the PDB file of the PE file @p pe, matched by the GUID and the
+ * age of its CodeView record. The file is searched with the name
+ * given to the linker, then with this base name, then with the base
+ * name of @p pe and the .pdb extension, both in the directory of @p pe.
+ */
+Exm_Pdb *
+exm_pdb_find(const Exm_Pe *pe)
+{
+    Exm_Pdb *pdb;
+    const char *pdb_filename;
+    const char *pe_filename;
+    const char *base_name;
+    const char *ext;
+    char *name;
+    GUID guid;
+    DWORD age;
+    size_t l;
+
+    pdb_filename = exm_pe_codeview_get(pe, &guid, &age);
+    if (!pdb_filename)
+        return NULL;
+
+    if (*pdb_filename)
+    {
+        pdb = _exm_pdb_candidate_open("", 0, pdb_filename, &guid, age);
+        if (pdb)
+            return pdb;
+    }
+
+    pe_filename = exm_pe_filename_get(pe);
+    base_name = _exm_pdb_base_name_get(pe_filename);
+
+    if (*pdb_filename)
+    {
+        pdb = _exm_pdb_candidate_open(pe_filename, base_name - pe_filename,
+                                      _exm_pdb_base_name_get(pdb_filename),
+                                      &guid, age);
+        if (pdb)
+            return pdb;
+    }
+
+    ext = strrchr(base_name, '.');
+    l = ext ? (size_t)(ext - base_name) : strlen(base_name);
+    name = (char *)malloc(l + 5);
+    if (!name)
+        return NULL;
+    memcpy(name, base_name, l);
+    memcpy(name + l, ".pdb", 5);
+
+    pdb = _exm_pdb_candidate_open(pe_filename, base_name - pe_filename, name, &guid, age);
+    free(name);
+
+    return pdb;
+}
+
+/*
+ * Add the functions of the procedures and of the public symbols of
+ * @p pdb, and the rows of the line tables of its modules, to
+ * @p index. The addresses are relative virtual addresses, computed
+ * with the section headers of the PDB file, or with the ones of
+ * @p pe, if not NULL, when the PDB file has none.
+ */
+unsigned char
+exm_pdb_index_add(const Exm_Pdb *pdb, const Exm_Pe *pe, Exm_Symbol_Index *index)
+{
+    Exm_Pdb_Stream dbi;
+    Exm_Pdb_Stream names;
+    Exm_Pdb_Sections sections;
+    const unsigned char *p;
+    const unsigned char *end;
+    unsigned int modules_size;
+    unsigned char res = 1;
+
+    if (!_exm_pdb_stream_get(pdb, EXM_PDB_STREAM_DBI, &dbi))
+        return 0;
+
+    if (dbi.size < EXM_PDB_DBI_HEADER_SIZE)
+    {
+        EXM_LOG_WARN("invalid DBI stream in PDB file %s", pdb->filename);
+        goto release_dbi;
+    }
+
+    if (!_exm_pdb_sections_get(pdb, &dbi, pe, &sections))
+        goto release_dbi;
+
+    if (pdb->names_stream != EXM_PDB_STREAM_NIL)
+        _exm_pdb_stream_get(pdb, pdb->names_stream, &names);
+    else
+        memset(&names, 0, sizeof(Exm_Pdb_Stream));
+
+    modules_size = exm_dwarf_read_uint32(dbi.data + 24);
+    if (modules_size > dbi.size - EXM_PDB_DBI_HEADER_SIZE)
+    {
+        EXM_LOG_WARN("invalid module list in PDB file %s", pdb->filename);
+        modules_size = 0;
+        res = 0;
+    }
+
+    p = dbi.data + EXM_PDB_DBI_HEADER_SIZE;
+    end = p + modules_size;
+    while (end - p >= EXM_PDB_DBI_MODULE_SIZE)
+    {
+        Exm_Pdb_Stream module;
+        const unsigned char *name;
+        unsigned int symbols_size;
+        unsigned int c11_size;
+        unsigned int c13_size;
+        int l1;
+        int l2;
+
+        /* module and object file names follow the fixed part */
+        name = p + EXM_PDB_DBI_MODULE_SIZE;
+        l1 = _exm_pdb_str_len(name, end);
+        l2 = (l1 < 0) ? -1 : _exm_pdb_str_len(name + l1 + 1, end);
+        if (l2 < 0)
+        {
+            res = 0;
+            break;
+        }
+
+        symbols_size = exm_dwarf_read_uint32(p + 36);
+        c11_size = exm_dwarf_read_uint32(p + 40);
+        c13_size = exm_dwarf_read_uint32(p + 44);
+
+        if (_exm_pdb_stream_get(pdb, exm_dwarf_read_uint16(p + 34), &module))
+        {
+            if ((symbols_size >= 4) && (symbols_size <= module.size))
+            {
+                _exm_pdb_module_symbols_add(&module, symbols_size, &sections, index);
+                if (c11_size <= module.size - symbols_size)
+                    _exm_pdb_module_lines_add(&module, symbols_size + c11_size, c13_size,
+                                              &names, &sections, index);
+            }
+            _exm_pdb_stream_release(&module);
+        }
+
+        p = dbi.data + EXM_PDB_DBI_HEADER_SIZE +
+            _exm_pdb_align4((unsigned int)(name + l1 + 1 + l2 + 1 - dbi.data) - EXM_PDB_DBI_HEADER_SIZE);
+    }
+
+    _exm_pdb_publics_add(pdb, exm_dwarf_read_uint16(dbi.data + 20), &sections, index);
+
+    _exm_pdb_stream_release(&names);
+    free(sections.rvas);
+    _exm_pdb_stream_release(&dbi);
+
+    return res;
+
+  release_dbi:
+    _exm_pdb_stream_release(&dbi);
+
+    return 0;
+}
@@ -24,6 +24,8 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 
 #ifdef _WIN32
 # ifndef WIN32_LEAN_AND_MEAN
@@ -40,7 +42,10 @@
 # include "examine_pe_unix.h"
 #endif
 
+#include "examine_private_checksum.h"
+#include "examine_private_histogram.h"
 #include "examine_private_map.h"
+#include "examine_private_sha.h"
 
 
 /**
@@ -66,6 +71,14 @@ struct _Exm_Pe
     char *filename;
     Exm_Map *map;
     IMAGE_NT_HEADERS *nt_header; /**< The NT header address */
+    struct
+    {
+        Exm_Pe_Resource *entries; /**< The flattened resource tree */
+        DWORD nbr;
+        DWORD *hash; /**< Index + 1 of the entries, 0 for a free slot */
+        DWORD hash_size;
+        unsigned char built;
+    } resources;
 };
 
 static char _exm_pe_section_name[9];
@@ -109,6 +122,534 @@ _exm_pe_rva_to_ptr_get2(const Exm_Pe *pe, DWORD rva)
     return (void *)((unsigned char *)exm_map_base_get(pe->map) + rva - delta);
 }
 
+/*
+ * Return the COFF symbol table of @p pe and store the number of its
+ * records in @p nbr, or return NULL if it has none or if it is not
+ * in the file, as well as the size of the string table following it.
+ */
+static const IMAGE_SYMBOL *
+_exm_pe_coff_symbols_get(const Exm_Pe *pe, DWORD *nbr, DWORD *strings_size)
+{
+    const unsigned char *base;
+    unsigned long long size;
+    unsigned long long offset;
+
+    *nbr = pe->nt_header->FileHeader.NumberOfSymbols;
+    offset = pe->nt_header->FileHeader.PointerToSymbolTable;
+    if ((offset == 0) || (*nbr == 0))
+        return NULL;
+
+    base = (const unsigned char *)exm_map_base_get(pe->map);
+    size = exm_map_size_get(pe->map);
+    if ((offset + (unsigned long long)*nbr * IMAGE_SIZEOF_SYMBOL + 4) > size)
+        return NULL;
+
+    /* the size of the string table includes its own size */
+    memcpy(strings_size, base + offset + (unsigned long long)*nbr * IMAGE_SIZEOF_SYMBOL, 4);
+    if ((*strings_size < 4) ||
+        (offset + (unsigned long long)*nbr * IMAGE_SIZEOF_SYMBOL + *strings_size > size))
+        *strings_size = 4;
+
+    return (const IMAGE_SYMBOL *)(base + offset);
+}
+
+/*
+ * Return the hash of the key (@p type, @p id) of a resource, or of
+ * (@p type, @p str) if @p str is not NULL. Resource names are
+ * compared without case, like the loader does.
+ */
+static DWORD
+_exm_pe_resource_hash(DWORD type, DWORD id, const IMAGE_RESOURCE_DIR_STRING_U *str, const char *name)
+{
+    DWORD h;
+
+    h = 2166136261U ^ type;
+    h *= 16777619U;
+    if (str)
+    {
+        WORD i;
+
+        for (i = 0; i < str->Length; i++)
+        {
+            WCHAR c;
+
+            c = str->NameString[i];
+            if ((c >= 'a') && (c <= 'z'))
+                c -= 'a' - 'A';
+            h = (h ^ c) * 16777619U;
+        }
+        h ^= 0x80000000;
+    }
+    else if (name)
+    {
+        for (; *name; name++)
+        {
+            WCHAR c;
+
+            c = (unsigned char)*name;
+            if ((c >= 'a') && (c <= 'z'))
+                c -= 'a' - 'A';
+            h = (h ^ c) * 16777619U;
+        }
+        h ^= 0x80000000;
+    }
+    else
+        h = (h ^ id) * 16777619U;
+
+    return h ^ (h >> 15);
+}
+
+/*
+ * Return 1 if the name @p str of a resource is @p name, without case,
+ * 0 otherwise.
+ */
+static unsigned char
+_exm_pe_resource_name_is(const IMAGE_RESOURCE_DIR_STRING_U *str, const char *name)
+{
+    WORD i;
+
+    for (i = 0; i < str->Length; i++, name++)
+    {
+        WCHAR c1;
+        WCHAR c2;
+
+        c1 = str->NameString[i];
+        c2 = (unsigned char)*name;
+        if ((c1 >= 'a') && (c1 <= 'z'))
+            c1 -= 'a' - 'A';
+        if ((c2 >= 'a') && (c2 <= 'z'))
+            c2 -= 'a' - 'A';
+        if (!c2 || (c1 != c2))
+            return 0;
+    }
+
+    return *name == '\0';
+}
+
+/*
+ * Return the string of the name of the entry @p entry of the resource
+ * directory at @p base of size @p size, or NULL if the entry has an
+ * id or if its name is not in the directory.
+ */
+static const IMAGE_RESOURCE_DIR_STRING_U *
+_exm_pe_resource_string_get(const unsigned char *base, DWORD size, const IMAGE_RESOURCE_DIRECTORY_ENTRY *entry)
+{
+    const IMAGE_RESOURCE_DIR_STRING_U *str;
+
+    if (!entry->NameIsString)
+        return NULL;
+
+    if ((entry->NameOffset + 2ULL) > size)
+        return NULL;
+
+    str = (const IMAGE_RESOURCE_DIR_STRING_U *)(base + entry->NameOffset);
+    if ((entry->NameOffset + 2ULL + 2ULL * str->Length) > size)
+        return NULL;
+
+    return str;
+}
+
+/*
+ * Return the entries of the resource directory at @p offset of the
+ * resource section at @p base of size @p size, and store their
+ * number in @p nbr, or return NULL if the directory is not in the
+ * section.
+ */
+static const IMAGE_RESOURCE_DIRECTORY_ENTRY *
+_exm_pe_resource_entries_get(const unsigned char *base, DWORD size, DWORD offset, DWORD *nbr)
+{
+    const IMAGE_RESOURCE_DIRECTORY *dir;
+
+    if ((offset + (unsigned long long)sizeof(IMAGE_RESOURCE_DIRECTORY)) > size)
+        return NULL;
+
+    dir = (const IMAGE_RESOURCE_DIRECTORY *)(base + offset);
+    *nbr = dir->NumberOfNamedEntries + dir->NumberOfIdEntries;
+    if ((offset + sizeof(IMAGE_RESOURCE_DIRECTORY) +
+         (unsigned long long)*nbr * sizeof(IMAGE_RESOURCE_DIRECTORY_ENTRY)) > size)
+        return NULL;
+
+    return (const IMAGE_RESOURCE_DIRECTORY_ENTRY *)(dir + 1);
+}
+
+/*
+ * Insert the entry @p index of the resources of @p pe in the hash
+ * table with the hash @p h.
+ */
+static void
+_exm_pe_resource_hash_insert(Exm_Pe *pe, DWORD h, DWORD index)
+{
+    DWORD mask;
+
+    mask = pe->resources.hash_size - 1;
+    for (h &= mask; pe->resources.hash[h]; h = (h + 1) & mask) { }
+    pe->resources.hash[h] = index + 1;
+}
+
+/*
+ * Append the resource @p res to the resources of @p pe, growing the
+ * array by doubling. Return 0 on memory error, 1 otherwise.
+ */
+static unsigned char
+_exm_pe_resource_append(Exm_Pe *pe, DWORD *allocated, const Exm_Pe_Resource *res)
+{
+    if (pe->resources.nbr == *allocated)
+    {
+        Exm_Pe_Resource *tmp;
+        DWORD s;
+
+        s = *allocated ? 2 * *allocated : 64;
+        tmp = (Exm_Pe_Resource *)realloc(pe->resources.entries, s * sizeof(Exm_Pe_Resource));
+        if (!tmp)
+            return 0;
+        pe->resources.entries = tmp;
+        *allocated = s;
+    }
+
+    pe->resources.entries[pe->resources.nbr] = *res;
+    pe->resources.nbr++;
+
+    return 1;
+}
+
+/*
+ * Flatten once the 3 levels (type, name, language) of the resource
+ * tree of @p pe in an array, sorted like the tree, and index the
+ * first entry of each type and of each (type, name) in a hash table
+ * with linear probing. As the entries are inserted in the order of
+ * the array, a probe meets the first entry of a key before the other
+ * entries of the same key.
+ */
+static void
+_exm_pe_resources_build(Exm_Pe *pe)
+{
+    const IMAGE_RESOURCE_DIRECTORY_ENTRY *types;
+    const unsigned char *base;
+    unsigned long long offset;
+    DWORD size;
+    DWORD allocated;
+    DWORD types_nbr;
+    DWORD i;
+
+    pe->resources.built = 1;
+
+    base = (const unsigned char *)exm_pe_resource_directory_get(pe, &size);
+    if (!base)
+        return;
+
+    offset = base - (const unsigned char *)exm_map_base_get(pe->map);
+    if (offset >= exm_map_size_get(pe->map))
+        return;
+
+    if (offset + size > exm_map_size_get(pe->map))
+        size = (DWORD)(exm_map_size_get(pe->map) - offset);
+
+    types = _exm_pe_resource_entries_get(base, size, 0, &types_nbr);
+    if (!types)
+        return;
+
+    allocated = 0;
+    for (i = 0; i < types_nbr; i++)
+    {
+        const IMAGE_RESOURCE_DIRECTORY_ENTRY *names;
+        DWORD names_nbr;
+        DWORD j;
+
+        if (!types[i].DataIsDirectory)
+            continue;
+
+        names = _exm_pe_resource_entries_get(base, size, types[i].OffsetToDirectory, &names_nbr);
+        if (!names)
+            continue;
+
+        for (j = 0; j < names_nbr; j++)
+        {
+            const IMAGE_RESOURCE_DIRECTORY_ENTRY *languages;
+            DWORD languages_nbr;
+            DWORD k;
+
+            if (!names[j].DataIsDirectory)
+                continue;
+
+            languages = _exm_pe_resource_entries_get(base, size, names[j].OffsetToDirectory, &languages_nbr);
+            if (!languages)
+                continue;
+
+            for (k = 0; k < languages_nbr; k++)
+            {
+                const IMAGE_RESOURCE_DATA_ENTRY *data;
+                Exm_Pe_Resource res;
+
+                if (languages[k].DataIsDirectory ||
+                    ((languages[k].OffsetToData + (unsigned long long)sizeof(IMAGE_RESOURCE_DATA_ENTRY)) > size))
+                    continue;
+
+                data = (const IMAGE_RESOURCE_DATA_ENTRY *)(base + languages[k].OffsetToData);
+                res.type_str = _exm_pe_resource_string_get(base, size, types + i);
+                res.type = res.type_str ? 0 : types[i].Id;
+                res.name_str = _exm_pe_resource_string_get(base, size, names + j);
+                res.id = res.name_str ? 0 : names[j].Id;
+                res.language = languages[k].Id;
+                res.rva = data->OffsetToData;
+                res.size = data->Size;
+                res.codepage = data->CodePage;
+                if (!_exm_pe_resource_append(pe, &allocated, &res))
+                {
+                    EXM_LOG_ERR("Can not allocate memory for the resources of %s", pe->filename);
+                    return;
+                }
+            }
+        }
+    }
+
+    if (pe->resources.nbr == 0)
+        return;
+
+    /* at most 2 keys per entry, and a load factor of at most 1/2 */
+    pe->resources.hash_size = 16;
+    while (pe->resources.hash_size < 4 * pe->resources.nbr)
+        pe->resources.hash_size <<= 1;
+
+    pe->resources.hash = (DWORD *)calloc(pe->resources.hash_size, sizeof(DWORD));
+    if (!pe->resources.hash)
+    {
+        EXM_LOG_ERR("Can not allocate memory for the resources of %s", pe->filename);
+        pe->resources.hash_size = 0;
+        return;
+    }
+
+    for (i = 0; i < pe->resources.nbr; i++)
+    {
+        const Exm_Pe_Resource *res;
+        const Exm_Pe_Resource *prev;
+
+        res = pe->resources.entries + i;
+        prev = (i > 0) ? res - 1 : NULL;
+
+        /* the types with a name are only reachable by iteration */
+        if (res->type_str)
+            continue;
+
+        if (!prev || prev->type_str || (prev->type != res->type))
+        {
+            _exm_pe_resource_hash_insert(pe, _exm_pe_resource_hash(res->type, EXM_PE_RESOURCE_ANY, NULL, NULL), i);
+            prev = NULL;
+        }
+
+        if (!prev ||
+            (!res->name_str && (prev->name_str || (prev->id != res->id))) ||
+            (res->name_str && (prev->name_str != res->name_str)))
+            _exm_pe_resource_hash_insert(pe, _exm_pe_resource_hash(res->type, res->id, res->name_str, NULL), i);
+    }
+}
+
+/*
+ * Return the first resource of type @p type, with the id @p id, or
+ * the name @p name if not NULL, and the language @p language. @p id
+ * and @p language can be EXM_PE_RESOURCE_ANY.
+ */
+static const Exm_Pe_Resource *
+_exm_pe_resource_find(const Exm_Pe *pe, DWORD type, DWORD id, const char *name, DWORD language)
+{
+    const Exm_Pe_Resource *res;
+    const Exm_Pe_Resource *end;
+    DWORD mask;
+    DWORD h;
+
+    if (!pe->resources.built)
+        _exm_pe_resources_build((Exm_Pe *)pe);
+
+    if (!pe->resources.hash)
+        return NULL;
+
+    res = NULL;
+    mask = pe->resources.hash_size - 1;
+    h = _exm_pe_resource_hash(type, id, NULL, name) & mask;
+    for (; pe->resources.hash[h]; h = (h + 1) & mask)
+    {
+        const Exm_Pe_Resource *iter;
+
+        iter = pe->resources.entries + pe->resources.hash[h] - 1;
+        if (iter->type_str || (iter->type != type))
+            continue;
+
+        if ((name && iter->name_str && _exm_pe_resource_name_is(iter->name_str, name)) ||
+            (!name && (id == EXM_PE_RESOURCE_ANY)) ||
+            (!name && !iter->name_str && (iter->id == id)))
+        {
+            res = iter;
+            break;
+        }
+    }
+
+    if (!res || (language == EXM_PE_RESOURCE_ANY))
+        return res;
+
+    /* the languages of a resource follow it */
+    end = pe->resources.entries + pe->resources.nbr;
+    for (; (res < end) && !res->type_str && (res->type == type); res++)
+    {
+        if (id != EXM_PE_RESOURCE_ANY)
+        {
+            if (name && (!res->name_str || !_exm_pe_resource_name_is(res->name_str, name)))
+                break;
+            if (!name && (res->name_str || (res->id != id)))
+                break;
+        }
+
+        if (res->language == language)
+            return res;
+    }
+
+    return NULL;
+}
+
+/*
+ * Return the first block of the base relocation directory of @p pe
+ * and store in @p end the end of the directory, or return NULL if it
+ * has none or if it is not in the file.
+ */
+static const unsigned char *
+_exm_pe_relocations_get(const Exm_Pe *pe, const unsigned char **end)
+{
+    const IMAGE_DATA_DIRECTORY *data_dir;
+    const unsigned char *relocs;
+    const unsigned char *map_end;
+
+    data_dir = exm_pe_data_directory_get(pe, IMAGE_DIRECTORY_ENTRY_BASERELOC);
+    if (!data_dir || (data_dir->VirtualAddress == 0) || (data_dir->Size == 0))
+        return NULL;
+
+    relocs = (const unsigned char *)_exm_pe_rva_to_ptr_get2(pe, data_dir->VirtualAddress);
+    if (!relocs)
+        return NULL;
+
+    map_end = (const unsigned char *)exm_map_base_get(pe->map) + exm_map_size_get(pe->map);
+    if (relocs >= map_end)
+        return NULL;
+
+    *end = ((unsigned long long)(map_end - relocs) < data_dir->Size) ? map_end : relocs + data_dir->Size;
+
+    return relocs;
+}
+
+/*
+ * Return @p block if it is a valid block of the base relocation
+ * directory ending at @p end, NULL otherwise.
+ */
+static const IMAGE_BASE_RELOCATION *
+_exm_pe_relocation_block_check(const unsigned char *block, const unsigned char *end)
+{
+    DWORD size;
+
+    if ((size_t)(end - block) < sizeof(IMAGE_BASE_RELOCATION))
+        return NULL;
+
+    size = ((const IMAGE_BASE_RELOCATION *)block)->SizeOfBlock;
+    if ((size < sizeof(IMAGE_BASE_RELOCATION)) || (size & 3) ||
+        ((unsigned long long)(end - block) < size))
+        return NULL;
+
+    return (const IMAGE_BASE_RELOCATION *)block;
+}
+
+
+/*
+ * A node of a VS_VERSIONINFO structure: VS_VERSIONINFO itself,
+ * StringFileInfo, StringTable, String, VarFileInfo or Var.
+ */
+typedef struct
+{
+    const WCHAR *key;
+    DWORD key_length;
+    const unsigned char *value;
+    DWORD value_size;
+    const unsigned char *children;
+    const unsigned char *end;
+} Exm_Pe_Version_Node;
+
+/*
+ * Fill @p node with the node at @p p, in the VS_VERSIONINFO structure
+ * starting at @p base and ending at @p end. Return 0 if the node is
+ * not valid, 1 otherwise. The key, the value and the children are
+ * aligned on 32 bits from @p base.
+ */
+static unsigned char
+_exm_pe_version_node_get(const unsigned char *base, const unsigned char *p, const unsigned char *end, Exm_Pe_Version_Node *node)
+{
+    const unsigned char *key_end;
+    WORD length;
+    WORD value_length;
+    WORD type;
+    size_t offset;
+
+    if ((end - p) < 6)
+        return 0;
+
+    memcpy(&length, p, 2);
+    memcpy(&value_length, p + 2, 2);
+    memcpy(&type, p + 4, 2);
+    if ((length < 6) || (length > (end - p)))
+        return 0;
+
+    node->end = p + length;
+    node->key = (const WCHAR *)(p + 6);
+    for (key_end = p + 6; (key_end + 2) <= node->end; key_end += 2)
+    {
+        if (!key_end[0] && !key_end[1])
+            break;
+    }
+    if ((key_end + 2) > node->end)
+        return 0;
+    node->key_length = (DWORD)(key_end - (p + 6)) / 2;
+
+    offset = ((key_end + 2 - base) + 3) & ~(size_t)3;
+    node->value = base + offset;
+    if (node->value > node->end)
+        node->value = node->end;
+
+    /* the length of a text value is in WCHAR, some tools use bytes */
+    node->value_size = (type == 1) ? 2U * value_length : value_length;
+    if (node->value_size > (DWORD)(node->end - node->value))
+        node->value_size = (DWORD)(node->end - node->value);
+
+    offset = ((node->value + node->value_size - base) + 3) & ~(size_t)3;
+    node->children = base + offset;
+    if (node->children > node->end)
+        node->children = node->end;
+
+    return 1;
+}
+
+/*
+ * Return the node following @p node, aligned on 32 bits from @p base.
+ */
+static const unsigned char *
+_exm_pe_version_node_next_get(const unsigned char *base, const Exm_Pe_Version_Node *node)
+{
+    return base + (((node->end - base) + 3) & ~(size_t)3);
+}
+
+/*
+ * Return 1 if the key @p key of length @p length is the ASCII string
+ * @p str, 0 otherwise.
+ */
+static unsigned char
+_exm_pe_version_key_is(const WCHAR *key, DWORD length, const char *str)
+{
+    DWORD i;
+
+    for (i = 0; i < length; i++, str++)
+    {
+        WORD c;
+
+        memcpy(&c, key + i, 2);
+        if (!*str || (c != (unsigned char)*str))
+            return 0;
+    }
+
+    return *str == '\0';
+}
 
 /*============================================================================*
  *                                 Global                                     *
@@ -140,7 +681,7 @@ exm_pe_new(const char *filename)
     if (!filename)
         return NULL;
 
-    pe = (Exm_Pe *)malloc(sizeof(Exm_Pe));
+    pe = (Exm_Pe *)calloc(1, sizeof(Exm_Pe));
     if (!pe)
         return NULL;
 
@@ -276,6 +817,8 @@ exm_pe_free(Exm_Pe *pe)
     if (!pe)
         return;
 
+    free(pe->resources.hash);
+    free(pe->resources.entries);
     exm_map_del(pe->map);
     free(pe->filename);
     free(pe);
@@ -552,51 +1095,28 @@ exm_pe_resource_directory_get(const Exm_Pe *pe, DWORD *count)
     return (IMAGE_RESOURCE_DIRECTORY *)_exm_pe_rva_to_ptr_get2(pe, rva);
 }
 
+/**
+ * @brief Return the data of the first resource of the given type.
+ *
+ * @param[in] pe The PE file.
+ * @param[in] id The type of the resource, like 16 for RT_VERSION.
+ * @param[out] size The size of the data.
+ * @return The data, or @c NULL.
+ *
+ * This function returns the data of the first resource of type @p id
+ * of @p pe, whatever its name and its language, and stores its size
+ * in @p size. If there is no such resource, @c NULL is returned.
+ */
 EXM_API const void *
 exm_pe_resource_data_get(const Exm_Pe *pe, DWORD id, DWORD *size)
 {
-    const IMAGE_RESOURCE_DIRECTORY *resource_dir;
-    const IMAGE_RESOURCE_DIRECTORY_ENTRY *entry;
-    const unsigned char *base;
-    DWORD i;
+    const Exm_Pe_Resource *res;
 
-    resource_dir = exm_pe_resource_directory_get(pe, NULL);
-    if (!resource_dir)
+    res = exm_pe_resource_find(pe, id, EXM_PE_RESOURCE_ANY, EXM_PE_RESOURCE_ANY);
+    if (!res)
         return NULL;
 
-    base = (const unsigned char *)resource_dir;
-    entry = (IMAGE_RESOURCE_DIRECTORY_ENTRY *)(resource_dir + 1);
-    for (i = 0; i < resource_dir->NumberOfNamedEntries; i++, entry++) { }
-    for (i = 0; i < resource_dir->NumberOfIdEntries; i++, entry++)
-    {
-        if ((entry->Id == id) && (entry->DataIsDirectory))
-        {
-            const IMAGE_RESOURCE_DATA_ENTRY *data;
-            void *res;
-
-            resource_dir = (const IMAGE_RESOURCE_DIRECTORY *)(base + entry->OffsetToDirectory);
-            if (!resource_dir)
-                return NULL;
-            entry = (const IMAGE_RESOURCE_DIRECTORY_ENTRY *)(resource_dir + 1);
-            if (!entry)
-                return NULL;
-            resource_dir = (const IMAGE_RESOURCE_DIRECTORY *)(base + entry->OffsetToDirectory);
-            if (!resource_dir)
-                return NULL;
-            entry = (const IMAGE_RESOURCE_DIRECTORY_ENTRY *)(resource_dir + 1);
-            if (!entry)
-                return NULL;
-            data = (const IMAGE_RESOURCE_DATA_ENTRY *)(base + entry->OffsetToData);
-            if (!data)
-                return NULL;
-
-            res = _exm_pe_rva_to_ptr_get2(pe, data->OffsetToData);
-            *size = data->Size;
-            return res;
-        }
-    }
-
-    return NULL;
+    return exm_pe_resource_entry_data_get(pe, res, size);
 }
 
 /**
@@ -675,7 +1195,7 @@ exm_pe_section_string_table_get(const Exm_Pe *pe)
 {
     if (!pe ||
         !pe->nt_header->FileHeader.PointerToSymbolTable  ||
-        !pe->nt_header->FileHeader.NumberOfSymbols * sizeof(IMAGE_SYMBOL))
+        !pe->nt_header->FileHeader.NumberOfSymbols)
         return NULL;
 
     return (const char *)((unsigned char *)exm_map_base_get(pe->map) + pe->nt_header->FileHeader.PointerToSymbolTable + pe->nt_header->FileHeader.NumberOfSymbols * sizeof(IMAGE_SYMBOL));
@@ -693,3 +1213,1266 @@ exm_pe_section_name_get(const Exm_Pe *pe, const IMAGE_SECTION_HEADER *sh)
         return _exm_pe_section_name;
     }
 }
+
+/**
+ * @brief Return the preferred load address of the given PE file.
+ *
+ * @param[in] pe The PE file.
+ * @return The image base.
+ *
+ * This function returns the address at which the PE file @p pe is
+ * linked, that is the value of ImageBase of its optional header,
+ * whether @p pe is a PE32 or PE32+ file.
+ */
+EXM_API unsigned long long
+exm_pe_image_base_get(const Exm_Pe *pe)
+{
+    if (exm_pe_is_64bits(pe))
+    {
+        const IMAGE_NT_HEADERS64 *nt_header;
+
+        nt_header = (const IMAGE_NT_HEADERS64 *)exm_pe_nt_header_get(pe);
+        return nt_header->OptionalHeader.ImageBase;
+    }
+    else
+    {
+        const IMAGE_NT_HEADERS32 *nt_header;
+
+        nt_header = (const IMAGE_NT_HEADERS32 *)exm_pe_nt_header_get(pe);
+        return nt_header->OptionalHeader.ImageBase;
+    }
+}
+
+/**
+ * @brief Return the content of a section of the given PE file.
+ *
+ * @param[in] pe The PE file.
+ * @param[in] name The name of the section.
+ * @param[out] size The size of the content.
+ * @return The content of the section, or @c NULL.
+ *
+ * This function returns the content in the file of the section named
+ * @p name of the PE file @p pe, and stores its size in @p size. The
+ * long names of the sections, like the ones of the DWARF sections of
+ * the mingw binaries, are supported. If there is no such section, or
+ * if it is not entirely in the file, @c NULL is returned and @p size
+ * is set to 0.
+ */
+EXM_API const void *
+exm_pe_section_data_get(const Exm_Pe *pe, const char *name, DWORD *size)
+{
+    const IMAGE_SECTION_HEADER *iter;
+    WORD i;
+
+    *size = 0;
+
+    iter = IMAGE_FIRST_SECTION(pe->nt_header);
+    for (i = 0; i < pe->nt_header->FileHeader.NumberOfSections; i++, iter++)
+    {
+        DWORD s;
+
+        if ((iter->Name[0] == '/') && !exm_pe_section_string_table_get(pe))
+            continue;
+
+        if (strcmp(exm_pe_section_name_get(pe, iter), name) != 0)
+            continue;
+
+        /* the raw size is rounded up to the file alignment */
+        s = iter->SizeOfRawData;
+        if ((iter->Misc.VirtualSize != 0) && (iter->Misc.VirtualSize < s))
+            s = iter->Misc.VirtualSize;
+
+        if ((unsigned long long)iter->PointerToRawData + s > exm_map_size_get(pe->map))
+        {
+            EXM_LOG_WARN("section %s of PE file %s is truncated", name, pe->filename);
+            return NULL;
+        }
+
+        *size = s;
+        return (const unsigned char *)exm_map_base_get(pe->map) + iter->PointerToRawData;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Return the PDB 7.0 information of the given PE file.
+ *
+ * @param[in] pe The PE file.
+ * @param[out] guid The GUID of the PDB file.
+ * @param[out] age The age of the PDB file.
+ * @return The name of the PDB file, or @c NULL.
+ *
+ * This function searches the CodeView (RSDS) record of the debug
+ * directory of the PE file @p pe, stores in @p guid and @p age the
+ * values that identify the matching PDB file, and returns the name
+ * of this file, as given to the linker. If @p pe has no such record,
+ * @c NULL is returned.
+ */
+EXM_API const char *
+exm_pe_codeview_get(const Exm_Pe *pe, GUID *guid, DWORD *age)
+{
+    const IMAGE_DATA_DIRECTORY *data_dir;
+    const IMAGE_DEBUG_DIRECTORY *debug_dir;
+    const unsigned char *base;
+    unsigned long long size;
+    DWORD nbr;
+    DWORD i;
+
+    data_dir = exm_pe_data_directory_get(pe, IMAGE_DIRECTORY_ENTRY_DEBUG);
+    if (data_dir->VirtualAddress == 0)
+        return NULL;
+
+    debug_dir = (const IMAGE_DEBUG_DIRECTORY *)_exm_pe_rva_to_ptr_get2(pe, data_dir->VirtualAddress);
+    if (!debug_dir)
+        return NULL;
+
+    base = (const unsigned char *)exm_map_base_get(pe->map);
+    size = exm_map_size_get(pe->map);
+    nbr = data_dir->Size / sizeof(IMAGE_DEBUG_DIRECTORY);
+    if ((const unsigned char *)(debug_dir + nbr) > base + size)
+        return NULL;
+
+    for (i = 0; i < nbr; i++, debug_dir++)
+    {
+        const unsigned char *raw_data;
+
+        /*
+         * PDB 7.0 information header is:
+         *
+         * DWORD  CvSignature
+         * GUID   Signature
+         * DWORD  Age
+         * BYTE * FileName
+         */
+        if ((debug_dir->Type != IMAGE_DEBUG_TYPE_CODEVIEW) ||
+            (debug_dir->SizeOfData <= 2 * sizeof(DWORD) + sizeof(GUID)) ||
+            ((unsigned long long)debug_dir->PointerToRawData + debug_dir->SizeOfData > size))
+            continue;
+
+        raw_data = base + debug_dir->PointerToRawData;
+        if (memcmp(raw_data, "RSDS", 4) != 0)
+            continue;
+
+        if (!memchr(raw_data + 2 * sizeof(DWORD) + sizeof(GUID), 0,
+                    debug_dir->SizeOfData - 2 * sizeof(DWORD) - sizeof(GUID)))
+            continue;
+
+        memcpy(guid, raw_data + sizeof(DWORD), sizeof(GUID));
+        memcpy(age, raw_data + sizeof(DWORD) + sizeof(GUID), sizeof(DWORD));
+
+        return (const char *)raw_data + 2 * sizeof(DWORD) + sizeof(GUID);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Return the first record of the COFF symbol table of the given PE file.
+ *
+ * @param[in] pe The PE file.
+ * @return The first symbol, or @c NULL.
+ *
+ * This function returns the first record of the COFF symbol table of
+ * the PE file @p pe, kept by the GNU linker unless the file is
+ * stripped. If @p pe has no symbol table, or if it is not in the
+ * file, @c NULL is returned. Use exm_pe_coff_symbol_next_get() to
+ * iterate over the symbols.
+ */
+EXM_API const IMAGE_SYMBOL *
+exm_pe_coff_symbol_first_get(const Exm_Pe *pe)
+{
+    DWORD nbr;
+    DWORD strings_size;
+
+    return _exm_pe_coff_symbols_get(pe, &nbr, &strings_size);
+}
+
+/**
+ * @brief Return the symbol following the given one.
+ *
+ * @param[in] pe The PE file.
+ * @param[in] symbol The current symbol.
+ * @return The next symbol, or @c NULL.
+ *
+ * This function returns the symbol following @p symbol in the COFF
+ * symbol table of the PE file @p pe, skipping the auxiliary records
+ * of @p symbol, which directly follow it. @c NULL is returned after
+ * the last symbol.
+ */
+EXM_API const IMAGE_SYMBOL *
+exm_pe_coff_symbol_next_get(const Exm_Pe *pe, const IMAGE_SYMBOL *symbol)
+{
+    const IMAGE_SYMBOL *symbols;
+    DWORD nbr;
+    DWORD strings_size;
+    DWORD i;
+
+    symbols = _exm_pe_coff_symbols_get(pe, &nbr, &strings_size);
+    if (!symbols)
+        return NULL;
+
+    i = (DWORD)(symbol - symbols) + 1 + symbol->NumberOfAuxSymbols;
+    if (i >= nbr)
+        return NULL;
+
+    return symbols + i;
+}
+
+/**
+ * @brief Return the name of the given COFF symbol.
+ *
+ * @param[in] pe The PE file.
+ * @param[in] symbol The symbol.
+ * @param[out] short_name A buffer of 9 bytes.
+ * @return The name of the symbol.
+ *
+ * This function returns the name of @p symbol, a symbol of the COFF
+ * symbol table of the PE file @p pe. A name of at most 8 bytes is
+ * stored in the symbol without terminating nul: it is copied in
+ * @p short_name, which is returned. A longer one is returned in
+ * place in the string table of the file. If the name is not in the
+ * string table, the empty string is returned.
+ */
+EXM_API const char *
+exm_pe_coff_symbol_name_get(const Exm_Pe *pe, const IMAGE_SYMBOL *symbol, char *short_name)
+{
+    const IMAGE_SYMBOL *symbols;
+    const char *strings;
+    DWORD nbr;
+    DWORD strings_size;
+
+    if (symbol->N.Name.Short != 0)
+    {
+        memcpy(short_name, symbol->N.ShortName, 8);
+        short_name[8] = '\0';
+        return short_name;
+    }
+
+    short_name[0] = '\0';
+    symbols = _exm_pe_coff_symbols_get(pe, &nbr, &strings_size);
+    if (!symbols || (symbol->N.Name.Long < 4) || (symbol->N.Name.Long >= strings_size))
+        return short_name;
+
+    strings = (const char *)(symbols + nbr);
+    if (!memchr(strings + symbol->N.Name.Long, 0, strings_size - symbol->N.Name.Long))
+        return short_name;
+
+    return strings + symbol->N.Name.Long;
+}
+
+/**
+ * @brief Return the function table of the exception directory of the given PE file.
+ *
+ * @param[in] pe The PE file.
+ * @param[out] count The number of entries.
+ * @return The first entry, or @c NULL.
+ *
+ * This function returns the function table of the exception
+ * directory (.pdata section) of the x64 PE file @p pe and stores the
+ * number of its entries in @p count, if not @c NULL. The entries are
+ * sorted by address and give the start and end addresses of each
+ * function, or part of a function, and the address of its unwind
+ * information. If @p pe is not an x64 file or has no exception
+ * directory, @c NULL is returned and @p count is set to 0.
+ */
+EXM_API const IMAGE_RUNTIME_FUNCTION_ENTRY *
+exm_pe_runtime_functions_get(const Exm_Pe *pe, DWORD *count)
+{
+    const IMAGE_DATA_DIRECTORY *data_dir;
+    const unsigned char *functions;
+    DWORD nbr;
+
+    if (count)
+        *count = 0;
+
+    if (pe->nt_header->FileHeader.Machine != IMAGE_FILE_MACHINE_AMD64)
+        return NULL;
+
+    data_dir = exm_pe_data_directory_get(pe, IMAGE_DIRECTORY_ENTRY_EXCEPTION);
+    if (!data_dir || (data_dir->VirtualAddress == 0))
+        return NULL;
+
+    functions = (const unsigned char *)_exm_pe_rva_to_ptr_get2(pe, data_dir->VirtualAddress);
+    if (!functions)
+        return NULL;
+
+    nbr = data_dir->Size / sizeof(IMAGE_RUNTIME_FUNCTION_ENTRY);
+    if (functions + (unsigned long long)nbr * sizeof(IMAGE_RUNTIME_FUNCTION_ENTRY) >
+        (const unsigned char *)exm_map_base_get(pe->map) + exm_map_size_get(pe->map))
+        return NULL;
+
+    if (count)
+        *count = nbr;
+
+    return (const IMAGE_RUNTIME_FUNCTION_ENTRY *)functions;
+}
+
+/**
+ * @brief Return the entry of the function table containing the given address.
+ *
+ * @param[in] pe The PE file.
+ * @param[in] rva The relative virtual address.
+ * @return The entry, or @c NULL.
+ *
+ * This function searches in O(log n) the entry of the function table
+ * of the exception directory of @p pe whose addresses contain
+ * @p rva. If the entry is the one of a part of a function, use
+ * exm_pe_runtime_function_primary_get() to retrieve the entry of the
+ * function. If no entry contains @p rva, like for a leaf function,
+ * which has no unwind information, @c NULL is returned.
+ */
+EXM_API const IMAGE_RUNTIME_FUNCTION_ENTRY *
+exm_pe_runtime_function_find(const Exm_Pe *pe, DWORD rva)
+{
+    const IMAGE_RUNTIME_FUNCTION_ENTRY *functions;
+    DWORD count;
+    DWORD lo;
+    DWORD hi;
+
+    functions = exm_pe_runtime_functions_get(pe, &count);
+    if (!functions)
+        return NULL;
+
+    /* first entry starting after rva */
+    lo = 0;
+    hi = count;
+    while (lo < hi)
+    {
+        DWORD mid;
+
+        mid = lo + (hi - lo) / 2;
+        if (functions[mid].BeginAddress <= rva)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if ((lo == 0) || (rva >= functions[lo - 1].EndAddress))
+        return NULL;
+
+    return functions + lo - 1;
+}
+
+/**
+ * @brief Decode the unwind information of the given function table entry.
+ *
+ * @param[in] pe The PE file.
+ * @param[in] rf The entry of the function table.
+ * @param[out] info The unwind information.
+ * @return 1 on success, 0 otherwise.
+ *
+ * This function decodes in @p info the UNWIND_INFO structure (in the
+ * .xdata section) of the entry @p rf of the function table of @p pe:
+ * the size of the prolog, the unwind codes, the frame register, and
+ * either the address of the exception handler or the entry of the
+ * function @p rf is a part of, when its unwind information is
+ * chained. An entry can also directly refer to the entry it is
+ * chained to. 0 is returned if the unwind information is not in the
+ * file.
+ */
+EXM_API unsigned char
+exm_pe_unwind_info_get(const Exm_Pe *pe, const IMAGE_RUNTIME_FUNCTION_ENTRY *rf, Exm_Pe_Unwind_Info *info)
+{
+    const unsigned char *end;
+    const unsigned char *p;
+    DWORD size;
+
+    memset(info, 0, sizeof(Exm_Pe_Unwind_Info));
+
+    end = (const unsigned char *)exm_map_base_get(pe->map) + exm_map_size_get(pe->map);
+
+    /* the low bit is set for an entry chained to another entry */
+    if (rf->UnwindData & 1)
+    {
+        p = (const unsigned char *)_exm_pe_rva_to_ptr_get2(pe, rf->UnwindData & ~1U);
+        if (!p || (p + sizeof(IMAGE_RUNTIME_FUNCTION_ENTRY) > end))
+            return 0;
+        info->flags = EXM_PE_UNW_FLAG_CHAININFO;
+        info->chained = (const IMAGE_RUNTIME_FUNCTION_ENTRY *)p;
+        return 1;
+    }
+
+    p = (const unsigned char *)_exm_pe_rva_to_ptr_get2(pe, rf->UnwindData);
+    if (!p || (p + 4 > end))
+        return 0;
+
+    info->version = p[0] & 0x7;
+    info->flags = p[0] >> 3;
+    info->prolog_size = p[1];
+    info->codes_count = p[2];
+    info->frame_register = p[3] & 0xf;
+    info->frame_offset = p[3] >> 4;
+    info->codes = p + 4;
+
+    /* the array of codes has an even number of entries */
+    size = 4 + 2 * ((info->codes_count + 1U) & ~1U);
+    if (p + size > end)
+        return 0;
+
+    if (info->flags & EXM_PE_UNW_FLAG_CHAININFO)
+    {
+        if (p + size + sizeof(IMAGE_RUNTIME_FUNCTION_ENTRY) > end)
+            return 0;
+        info->chained = (const IMAGE_RUNTIME_FUNCTION_ENTRY *)(p + size);
+    }
+    else if (info->flags & (EXM_PE_UNW_FLAG_EHANDLER | EXM_PE_UNW_FLAG_UHANDLER))
+    {
+        if (p + size + 4 > end)
+            return 0;
+        memcpy(&info->handler, p + size, 4);
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Return the entry of the function the given entry is a part of.
+ *
+ * @param[in] pe The PE file.
+ * @param[in] rf The entry of the function table.
+ * @return The entry of the function.
+ *
+ * This function follows the chained unwind information of the entry
+ * @p rf of the function table of @p pe, which describes a part of a
+ * function, like its cold code moved after the other functions, to
+ * the entry of the function itself, whose start is the address of
+ * the function. The entry of the function table is returned when
+ * it exists, the copy of the unwind information otherwise. If @p rf
+ * is not chained, it is returned.
+ */
+EXM_API const IMAGE_RUNTIME_FUNCTION_ENTRY *
+exm_pe_runtime_function_primary_get(const Exm_Pe *pe, const IMAGE_RUNTIME_FUNCTION_ENTRY *rf)
+{
+    Exm_Pe_Unwind_Info info;
+    int i;
+
+    /* the chains are short, a limit stops a corrupted loop */
+    for (i = 0; i < 32; i++)
+    {
+        if (!exm_pe_unwind_info_get(pe, rf, &info) || !info.chained)
+            break;
+        rf = info.chained;
+    }
+
+    /* the chained entry is a copy, return the one of the table */
+    if (i > 0)
+    {
+        const IMAGE_RUNTIME_FUNCTION_ENTRY *found;
+
+        found = exm_pe_runtime_function_find(pe, rf->BeginAddress);
+        if (found && (found->BeginAddress == rf->BeginAddress))
+            return found;
+    }
+
+    return rf;
+}
+
+/**
+ * @brief Return the first block of the base relocation directory of the given PE file.
+ *
+ * @param[in] pe The PE file.
+ * @return The first block, or @c NULL.
+ *
+ * This function returns the first block of the base relocation
+ * directory (.reloc section) of the PE file @p pe, in place in the
+ * file. Each block holds the relocations of a page of 4 KB, whose
+ * address is given by its @c VirtualAddress field. Use
+ * exm_pe_relocation_block_next_get() to iterate over the blocks and
+ * exm_pe_relocation_block_entries_get() to get their entries. If
+ * @p pe has no base relocation, @c NULL is returned.
+ */
+EXM_API const IMAGE_BASE_RELOCATION *
+exm_pe_relocation_block_first_get(const Exm_Pe *pe)
+{
+    const unsigned char *relocs;
+    const unsigned char *end;
+
+    relocs = _exm_pe_relocations_get(pe, &end);
+    if (!relocs)
+        return NULL;
+
+    return _exm_pe_relocation_block_check(relocs, end);
+}
+
+/**
+ * @brief Return the block of the base relocation directory following the given one.
+ *
+ * @param[in] pe The PE file.
+ * @param[in] block The current block.
+ * @return The next block, or @c NULL.
+ *
+ * This function returns the block of the base relocation directory
+ * of @p pe following @p block, or @c NULL if @p block is the last
+ * one or if the next block is corrupted.
+ */
+EXM_API const IMAGE_BASE_RELOCATION *
+exm_pe_relocation_block_next_get(const Exm_Pe *pe, const IMAGE_BASE_RELOCATION *block)
+{
+    const unsigned char *end;
+
+    if (!_exm_pe_relocations_get(pe, &end))
+        return NULL;
+
+    return _exm_pe_relocation_block_check((const unsigned char *)block + block->SizeOfBlock, end);
+}
+
+/**
+ * @brief Return the entries of the given block of the base relocation directory.
+ *
+ * @param[in] block The block.
+ * @param[out] count The number of entries.
+ * @return The entries.
+ *
+ * This function returns the entries of @p block, a block returned by
+ * exm_pe_relocation_block_first_get() or
+ * exm_pe_relocation_block_next_get(), and stores their number in
+ * @p count. The 4 high bits of an entry are its type, like
+ * IMAGE_REL_BASED_DIR64, the 12 low bits are its offset in the
+ * page. Entries of type IMAGE_REL_BASED_ABSOLUTE pad the block and
+ * are ignored by the loader.
+ */
+EXM_API const WORD *
+exm_pe_relocation_block_entries_get(const IMAGE_BASE_RELOCATION *block, DWORD *count)
+{
+    *count = (block->SizeOfBlock - sizeof(IMAGE_BASE_RELOCATION)) / sizeof(WORD);
+
+    return (const WORD *)(block + 1);
+}
+
+/**
+ * @brief Compute statistics on the base relocations of the given PE file.
+ *
+ * @param[in] pe The PE file.
+ * @param[out] stats The statistics.
+ * @param[out] sections The number of relocations per section, or @c NULL.
+ * @return 1 if @p pe has base relocations, 0 otherwise.
+ *
+ * This function walks once over the base relocation directory of
+ * @p pe and fills @p stats with the number of blocks, the number of
+ * relocations, without the padding entries, their number by type and
+ * the number of pages the loader writes to when the image is not
+ * loaded at its preferred base address. If @p sections is not
+ * @c NULL, it must have one element per section of @p pe, and it is
+ * filled with the number of relocations applied in each section.
+ */
+EXM_API unsigned char
+exm_pe_relocation_stats_get(const Exm_Pe *pe, Exm_Pe_Relocation_Stats *stats, DWORD *sections)
+{
+    const IMAGE_SECTION_HEADER *first;
+    const IMAGE_SECTION_HEADER *sh;
+    const IMAGE_BASE_RELOCATION *block;
+    const unsigned char *relocs;
+    const unsigned char *end;
+    DWORD last_page;
+    int sections_nbr;
+
+    memset(stats, 0, sizeof(Exm_Pe_Relocation_Stats));
+    sections_nbr = pe->nt_header->FileHeader.NumberOfSections;
+    if (sections)
+        memset(sections, 0, sections_nbr * sizeof(DWORD));
+
+    relocs = _exm_pe_relocations_get(pe, &end);
+    if (!relocs)
+        return 0;
+
+    first = IMAGE_FIRST_SECTION(pe->nt_header);
+    sh = NULL;
+    last_page = 0xffffffff;
+    for (block = _exm_pe_relocation_block_check(relocs, end);
+         block;
+         block = _exm_pe_relocation_block_check((const unsigned char *)block + block->SizeOfBlock, end))
+    {
+        const WORD *entries;
+        DWORD count;
+        DWORD i;
+
+        stats->blocks++;
+        entries = exm_pe_relocation_block_entries_get(block, &count);
+        for (i = 0; i < count; i++)
+        {
+            DWORD rva;
+            DWORD page;
+            DWORD size;
+            int type;
+
+            type = entries[i] >> 12;
+            if (type == IMAGE_REL_BASED_ABSOLUTE)
+                continue;
+
+            stats->count++;
+            stats->types[type]++;
+            rva = block->VirtualAddress + (entries[i] & 0xfff);
+
+            /* the parameter of HIGHADJ is stored in the next entry */
+            if (type == IMAGE_REL_BASED_HIGHADJ)
+                i++;
+
+            switch (type)
+            {
+                case IMAGE_REL_BASED_DIR64:
+                    size = 8;
+                    break;
+                case IMAGE_REL_BASED_HIGHLOW:
+                    size = 4;
+                    break;
+                default:
+                    size = 2;
+                    break;
+            }
+
+            /* the blocks are sorted, a relocation can overlap 2 pages */
+            for (page = rva >> 12; page <= (rva + size - 1) >> 12; page++)
+            {
+                if ((last_page == 0xffffffff) || (page > last_page))
+                {
+                    stats->pages++;
+                    last_page = page;
+                }
+            }
+
+            if (!sections)
+                continue;
+
+            if (!sh ||
+                (rva < sh->VirtualAddress) ||
+                (rva >= sh->VirtualAddress + sh->Misc.VirtualSize))
+            {
+                int j;
+
+                sh = NULL;
+                for (j = 0; j < sections_nbr; j++)
+                {
+                    if ((rva >= first[j].VirtualAddress) &&
+                        (rva < first[j].VirtualAddress + first[j].Misc.VirtualSize))
+                    {
+                        sh = first + j;
+                        break;
+                    }
+                }
+            }
+
+            if (sh)
+                sections[sh - first]++;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Return the resources of the given PE file.
+ *
+ * @param[in] pe The PE file.
+ * @param[out] count The number of resources.
+ * @return The resources, or @c NULL.
+ *
+ * This function returns the resources of @p pe, as an array of
+ * @p count elements, the 3 levels of the resource tree (type, name
+ * and language) being flattened in the order of the tree. The array
+ * is built once, at the first call of this function or of the
+ * resource lookups, and is freed with @p pe. If @p pe has no
+ * resource, @c NULL is returned.
+ */
+EXM_API const Exm_Pe_Resource *
+exm_pe_resources_get(const Exm_Pe *pe, DWORD *count)
+{
+    if (!pe->resources.built)
+        _exm_pe_resources_build((Exm_Pe *)pe);
+
+    *count = pe->resources.nbr;
+
+    return pe->resources.entries;
+}
+
+/**
+ * @brief Find a resource by its type, id and language.
+ *
+ * @param[in] pe The PE file.
+ * @param[in] type The type of the resource, like 16 for RT_VERSION.
+ * @param[in] id The id of the resource.
+ * @param[in] language The language of the resource.
+ * @return The resource, or @c NULL.
+ *
+ * This function returns the resource of @p pe of type @p type, with
+ * the id @p id and the language @p language, with a hashed
+ * lookup. @p id and @p language can be #EXM_PE_RESOURCE_ANY to
+ * return the first resource of the type, or the first language of
+ * the resource, in the order of the resource tree.
+ */
+EXM_API const Exm_Pe_Resource *
+exm_pe_resource_find(const Exm_Pe *pe, DWORD type, DWORD id, DWORD language)
+{
+    return _exm_pe_resource_find(pe, type, id, NULL, language);
+}
+
+/**
+ * @brief Find a resource by its type, name and language.
+ *
+ * @param[in] pe The PE file.
+ * @param[in] type The type of the resource, like 10 for RT_RCDATA.
+ * @param[in] name The name of the resource, in ASCII.
+ * @param[in] language The language of the resource.
+ * @return The resource, or @c NULL.
+ *
+ * This function returns the resource of @p pe of type @p type, named
+ * @p name, compared without case, and with the language @p language,
+ * which can be #EXM_PE_RESOURCE_ANY, with a hashed lookup. The
+ * resources whose type is a name are only returned by
+ * exm_pe_resources_get().
+ */
+EXM_API const Exm_Pe_Resource *
+exm_pe_resource_find_by_name(const Exm_Pe *pe, DWORD type, const char *name, DWORD language)
+{
+    if (!name)
+        return NULL;
+
+    return _exm_pe_resource_find(pe, type, 0, name, language);
+}
+
+/**
+ * @brief Return the data of the given resource.
+ *
+ * @param[in] pe The PE file.
+ * @param[in] res The resource.
+ * @param[out] size The size of the data.
+ * @return The data, or @c NULL.
+ *
+ * This function returns the data of the resource @p res of @p pe, in
+ * place in the file, and stores its size in @p size. If the data is
+ * not in the file, @c NULL is returned.
+ */
+EXM_API const void *
+exm_pe_resource_entry_data_get(const Exm_Pe *pe, const Exm_Pe_Resource *res, DWORD *size)
+{
+    const unsigned char *data;
+    const unsigned char *end;
+
+    data = (const unsigned char *)_exm_pe_rva_to_ptr_get2(pe, res->rva);
+    end = (const unsigned char *)exm_map_base_get(pe->map) + exm_map_size_get(pe->map);
+    if (!data || (data >= end) || ((unsigned long long)(end - data) < res->size))
+        return NULL;
+
+    if (size)
+        *size = res->size;
+
+    return data;
+}
+
+/**
+ * @brief Parse the version information of the given PE file.
+ *
+ * @param[in] pe The PE file.
+ * @param[out] info The version information.
+ * @return 1 on success, 0 otherwise.
+ *
+ * This function parses the VS_VERSIONINFO structure of the version
+ * resource of @p pe, in place in the file and without the Windows
+ * version API, and fills @p info with the fixed file information,
+ * the key of the first string table, like 040904b0 for US English and
+ * UTF-16, and the (language, codepage) pairs of the translations. The
+ * strings of the table are retrieved with
+ * exm_pe_version_info_string_get() or
+ * exm_pe_version_info_string_next(). If @p pe has no valid version
+ * resource, 0 is returned.
+ */
+EXM_API unsigned char
+exm_pe_version_info_get(const Exm_Pe *pe, Exm_Pe_Version_Info *info)
+{
+    Exm_Pe_Version_Node root;
+    const unsigned char *base;
+    const unsigned char *end;
+    const unsigned char *p;
+    DWORD size;
+
+    memset(info, 0, sizeof(Exm_Pe_Version_Info));
+
+    /* 16 is RT_VERSION */
+    base = (const unsigned char *)exm_pe_resource_data_get(pe, 16, &size);
+    if (!base)
+        return 0;
+
+    end = base + size;
+    if (!_exm_pe_version_node_get(base, base, end, &root) ||
+        !_exm_pe_version_key_is(root.key, root.key_length, "VS_VERSION_INFO"))
+        return 0;
+
+    info->base = base;
+    if (root.value_size >= sizeof(VS_FIXEDFILEINFO))
+    {
+        const VS_FIXEDFILEINFO *fixed;
+
+        fixed = (const VS_FIXEDFILEINFO *)root.value;
+        if (fixed->dwSignature == VS_FFI_SIGNATURE)
+            info->fixed = fixed;
+    }
+
+    for (p = root.children; p < root.end; )
+    {
+        Exm_Pe_Version_Node node;
+        Exm_Pe_Version_Node child;
+
+        if (!_exm_pe_version_node_get(base, p, root.end, &node))
+            break;
+
+        if (_exm_pe_version_key_is(node.key, node.key_length, "StringFileInfo") &&
+            !info->strings &&
+            _exm_pe_version_node_get(base, node.children, node.end, &child))
+        {
+            info->language = child.key;
+            info->language_length = child.key_length;
+            info->strings = child.children;
+            info->strings_end = child.end;
+        }
+        else if (_exm_pe_version_key_is(node.key, node.key_length, "VarFileInfo") &&
+                 _exm_pe_version_node_get(base, node.children, node.end, &child) &&
+                 _exm_pe_version_key_is(child.key, child.key_length, "Translation"))
+        {
+            info->translations = (const DWORD *)child.value;
+            info->translations_count = child.value_size / sizeof(DWORD);
+        }
+
+        p = _exm_pe_version_node_next_get(base, &node);
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Iterate over the strings of the given version information.
+ *
+ * @param[in] info The version information.
+ * @param[inout] offset The position of the iteration.
+ * @param[out] str The string.
+ * @return 1 if a string is returned, 0 at the end.
+ *
+ * This function stores in @p str the key, like CompanyName, and the
+ * value of the string at @p offset of the first string table of
+ * @p info, as UTF-16 strings in place in the file, and moves
+ * @p offset to the next string. @p offset must be 0 for the first
+ * string.
+ */
+EXM_API unsigned char
+exm_pe_version_info_string_next(const Exm_Pe_Version_Info *info, DWORD *offset, Exm_Pe_Version_String *str)
+{
+    Exm_Pe_Version_Node node;
+    const unsigned char *p;
+    DWORD i;
+
+    if (!info->strings)
+        return 0;
+
+    p = info->strings + *offset;
+    if ((p >= info->strings_end) ||
+        !_exm_pe_version_node_get(info->base, p, info->strings_end, &node))
+        return 0;
+
+    str->key = node.key;
+    str->key_length = node.key_length;
+
+    /* the value is nul terminated, possibly with several nul */
+    str->value = (const WCHAR *)node.value;
+    for (i = 0; (2 * i + 1) < (DWORD)(node.end - node.value); i++)
+    {
+        if (!node.value[2 * i] && !node.value[2 * i + 1])
+            break;
+    }
+    str->value_length = i;
+
+    *offset = (DWORD)(_exm_pe_version_node_next_get(info->base, &node) - info->strings);
+
+    return 1;
+}
+
+/**
+ * @brief Return a string of the given version information.
+ *
+ * @param[in] info The version information.
+ * @param[in] key The key of the string, in ASCII.
+ * @param[out] str The string.
+ * @return 1 if the string is found, 0 otherwise.
+ *
+ * This function stores in @p str the string of key @p key, like
+ * FileVersion or ProductName, of the first string table of @p info.
+ */
+EXM_API unsigned char
+exm_pe_version_info_string_get(const Exm_Pe_Version_Info *info, const char *key, Exm_Pe_Version_String *str)
+{
+    DWORD offset;
+
+    offset = 0;
+    while (exm_pe_version_info_string_next(info, &offset, str))
+    {
+        if (_exm_pe_version_key_is(str->key, str->key_length, key))
+            return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Convert an UTF-16 string of a PE file to UTF-8.
+ *
+ * @param[in] str The UTF-16 string.
+ * @param[in] length The length of @p str, in WCHAR.
+ * @param[out] buf The buffer.
+ * @param[in] size The size of @p buf.
+ * @return The number of bytes written, without the nul character.
+ *
+ * This function converts the UTF-16 string @p str of @p length
+ * characters, like a resource name or a version string, to UTF-8 in
+ * the buffer @p buf of size @p size, which is always nul terminated
+ * if @p size is not 0. The string is truncated on a character
+ * boundary if @p buf is too small, and invalid surrogates are
+ * replaced by U+FFFD.
+ */
+EXM_API DWORD
+exm_pe_string_utf8_get(const WCHAR *str, DWORD length, char *buf, DWORD size)
+{
+    DWORD l;
+    DWORD i;
+
+    if (size == 0)
+        return 0;
+
+    l = 0;
+    for (i = 0; i < length; i++)
+    {
+        unsigned char utf8[4];
+        unsigned long c;
+        WORD w;
+        DWORD n;
+
+        memcpy(&w, str + i, 2);
+        c = w;
+        if ((w >= 0xd800) && (w < 0xdc00) && ((i + 1) < length))
+        {
+            WORD w2;
+
+            memcpy(&w2, str + i + 1, 2);
+            if ((w2 >= 0xdc00) && (w2 < 0xe000))
+            {
+                c = 0x10000 + (((unsigned long)w - 0xd800) << 10) + (w2 - 0xdc00);
+                i++;
+            }
+        }
+        if ((c >= 0xd800) && (c < 0xe000))
+            c = 0xfffd;
+
+        if (c < 0x80)
+        {
+            utf8[0] = (unsigned char)c;
+            n = 1;
+        }
+        else if (c < 0x800)
+        {
+            utf8[0] = (unsigned char)(0xc0 | (c >> 6));
+            utf8[1] = (unsigned char)(0x80 | (c & 0x3f));
+            n = 2;
+        }
+        else if (c < 0x10000)
+        {
+            utf8[0] = (unsigned char)(0xe0 | (c >> 12));
+            utf8[1] = (unsigned char)(0x80 | ((c >> 6) & 0x3f));
+            utf8[2] = (unsigned char)(0x80 | (c & 0x3f));
+            n = 3;
+        }
+        else
+        {
+            utf8[0] = (unsigned char)(0xf0 | (c >> 18));
+            utf8[1] = (unsigned char)(0x80 | ((c >> 12) & 0x3f));
+            utf8[2] = (unsigned char)(0x80 | ((c >> 6) & 0x3f));
+            utf8[3] = (unsigned char)(0x80 | (c & 0x3f));
+            n = 4;
+        }
+
+        if ((l + n) >= size)
+            break;
+
+        memcpy(buf + l, utf8, n);
+        l += n;
+    }
+    buf[l] = '\0';
+
+    return l;
+}
+
+/**
+ * @brief Compute the Authenticode digest of the given PE file.
+ *
+ * @param[in] pe The PE file.
+ * @param[out] sha1 The SHA-1 digest, or @c NULL.
+ * @param[out] sha256 The SHA-256 digest, or @c NULL.
+ * @return 1 on success, 0 otherwise.
+ *
+ * This function computes the Authenticode digest of the PE file
+ * @p pe, that is the hash of the file without the CheckSum field of
+ * the optional header, without the certificate table entry of the
+ * data directory and without the certificate table itself, the one
+ * that the signature of @p pe, if any, must match. The SHA-1 digest
+ * (EXM_SHA1_SIZE bytes) is stored in @p sha1 and the SHA-256 digest
+ * (EXM_SHA256_SIZE bytes) in @p sha256 if they are not @c NULL. Both
+ * are computed in a single pass over the file.
+ *
+ * The file is hashed linearly, like signtool and osslsigncode do for
+ * the files written by the usual linkers, whose sections follow the
+ * headers in order.
+ */
+EXM_API unsigned char
+exm_pe_authenticode_digest_get(const Exm_Pe *pe, unsigned char *sha1, unsigned char *sha256)
+{
+    Exm_Sha1 ctx1;
+    Exm_Sha256 ctx256;
+    const IMAGE_DATA_DIRECTORY *data_dir;
+    const unsigned char *base;
+    unsigned long long ranges[3][2];
+    unsigned long long size;
+    unsigned long long end;
+    DWORD nbr;
+    int i;
+
+    switch (exm_pe_is_64bits(pe))
+    {
+        case 1:
+            nbr = ((const IMAGE_NT_HEADERS64 *)pe->nt_header)->OptionalHeader.NumberOfRvaAndSizes;
+            break;
+        case 0:
+            nbr = ((const IMAGE_NT_HEADERS32 *)pe->nt_header)->OptionalHeader.NumberOfRvaAndSizes;
+            break;
+        default:
+            return 0;
+    }
+
+    base = (const unsigned char *)exm_map_base_get(pe->map);
+    size = exm_map_size_get(pe->map);
+
+    data_dir = exm_pe_data_directory_get(pe, IMAGE_DIRECTORY_ENTRY_SECURITY);
+    if ((nbr <= IMAGE_DIRECTORY_ENTRY_SECURITY) ||
+        ((const unsigned char *)(data_dir + 1) > base + size))
+        return 0;
+
+    /*
+     * the certificate table is given by a file offset, not a RVA,
+     * and is at the end of the file
+     */
+    end = size;
+    if ((data_dir->VirtualAddress != 0) && (data_dir->Size != 0) &&
+        ((unsigned long long)data_dir->VirtualAddress + data_dir->Size <= size) &&
+        (base + data_dir->VirtualAddress >= (const unsigned char *)(data_dir + 1)))
+        end = data_dir->VirtualAddress;
+
+    /* CheckSum is at the same offset in PE32 and PE32+ files */
+    ranges[0][0] = 0;
+    ranges[0][1] = (const unsigned char *)&pe->nt_header->OptionalHeader.CheckSum - base;
+    ranges[1][0] = ranges[0][1] + sizeof(DWORD);
+    ranges[1][1] = (const unsigned char *)data_dir - base;
+    ranges[2][0] = ranges[1][1] + sizeof(IMAGE_DATA_DIRECTORY);
+    ranges[2][1] = end;
+
+    if (sha1)
+        exm_sha1_init(&ctx1);
+    if (sha256)
+        exm_sha256_init(&ctx256);
+
+    /*
+     * both hashes are updated on the same chunk while it is in the
+     * cache
+     */
+    for (i = 0; i < 3; i++)
+    {
+        unsigned long long offset;
+
+        for (offset = ranges[i][0]; offset < ranges[i][1]; offset += 1024 * 1024)
+        {
+            size_t s;
+
+            s = (size_t)(ranges[i][1] - offset);
+            if (s > 1024 * 1024)
+                s = 1024 * 1024;
+            if (sha1)
+                exm_sha1_update(&ctx1, base + offset, s);
+            if (sha256)
+                exm_sha256_update(&ctx256, base + offset, s);
+        }
+    }
+
+    if (sha1)
+        exm_sha1_final(&ctx1, sha1);
+    if (sha256)
+        exm_sha256_final(&ctx256, sha256);
+
+    return 1;
+}
+
+/**
+ * @brief Compute the checksum of the given PE file.
+ *
+ * @param[in] pe The PE file.
+ * @return The checksum.
+ *
+ * This function computes the checksum of the PE file @p pe like
+ * MapFileAndCheckSum() and the loader do, that is the one's
+ * complement sum of the 16 bits words of the file, without the
+ * CheckSum field of the optional header, added to the size of the
+ * file. It is the value that the CheckSum field of a correct file
+ * holds, when it is set. On error, 0 is returned.
+ */
+EXM_API DWORD
+exm_pe_checksum_compute(const Exm_Pe *pe)
+{
+    const unsigned char *base;
+    unsigned long long sum;
+    unsigned long long size;
+    size_t offset;
+    int i;
+
+    if (!pe)
+        return 0;
+
+    base = (const unsigned char *)exm_map_base_get(pe->map);
+    size = exm_map_size_get(pe->map);
+
+    sum = exm_checksum_sum(base, (size_t)size);
+
+    /* CheckSum is at the same offset in PE32 and PE32+ files */
+    offset = (const unsigned char *)&pe->nt_header->OptionalHeader.CheckSum - base;
+    for (i = 0; i < 4; i++, offset++)
+        sum -= (unsigned long long)base[offset] << (8 * (offset & 3));
+
+    while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+
+    return (DWORD)(sum + size);
+}
+
+/**
+ * @brief Return the raw data of a section of the given PE file.
+ *
+ * @param[in] pe The PE file.
+ * @param[in] sh The section header.
+ * @param[out] size The size of the raw data.
+ * @return The raw data of the section, or @c NULL.
+ *
+ * This function returns the raw data in the file of the section
+ * @p sh of the PE file @p pe and stores its size in @p size. Unlike
+ * exm_pe_section_data_get(), the size is the one of the raw data,
+ * rounded up to the file alignment, truncated to the end of the
+ * file. If the section has no raw data, @c NULL is returned and
+ * @p size is set to 0.
+ */
+EXM_API const void *
+exm_pe_section_raw_data_get(const Exm_Pe *pe, const IMAGE_SECTION_HEADER *sh, DWORD *size)
+{
+    unsigned long long map_size;
+
+    *size = 0;
+
+    map_size = exm_map_size_get(pe->map);
+    if ((sh->SizeOfRawData == 0) || (sh->PointerToRawData >= map_size))
+        return NULL;
+
+    *size = sh->SizeOfRawData;
+    if ((unsigned long long)sh->PointerToRawData + sh->SizeOfRawData > map_size)
+        *size = (DWORD)(map_size - sh->PointerToRawData);
+
+    return (const unsigned char *)exm_map_base_get(pe->map) + sh->PointerToRawData;
+}
+
+/**
+ * @brief Return the overlay of the given PE file.
+ *
+ * @param[in] pe The PE file.
+ * @param[out] size The size of the overlay.
+ * @return The overlay, or @c NULL.
+ *
+ * This function returns the data appended to the PE file @p pe after
+ * the raw data of its last section, like the certificate table, an
+ * installer payload or a packed program, and stores its size in
+ * @p size. If @p pe has no overlay, @c NULL is returned and @p size
+ * is set to 0.
+ */
+EXM_API const void *
+exm_pe_overlay_get(const Exm_Pe *pe, DWORD *size)
+{
+    const IMAGE_SECTION_HEADER *iter;
+    unsigned long long map_size;
+    unsigned long long end;
+    WORD i;
+
+    *size = 0;
+
+    /* the headers, if there is no section with raw data */
+    end = (const unsigned char *)(IMAGE_FIRST_SECTION(pe->nt_header) + pe->nt_header->FileHeader.NumberOfSections) -
+          (const unsigned char *)exm_map_base_get(pe->map);
+    iter = IMAGE_FIRST_SECTION(pe->nt_header);
+    for (i = 0; i < pe->nt_header->FileHeader.NumberOfSections; i++, iter++)
+    {
+        if ((iter->SizeOfRawData != 0) &&
+            ((unsigned long long)iter->PointerToRawData + iter->SizeOfRawData > end))
+            end = (unsigned long long)iter->PointerToRawData + iter->SizeOfRawData;
+    }
+
+    map_size = exm_map_size_get(pe->map);
+    if (end >= map_size)
+        return NULL;
+
+    *size = (DWORD)(map_size - end);
+
+    return (const unsigned char *)exm_map_base_get(pe->map) + end;
+}
+
+/**
+ * @brief Add the bytes of the given data to a byte histogram.
+ *
+ * @param[in] data The data.
+ * @param[in] size The size of the data.
+ * @param[in,out] histogram The histogram.
+ *
+ * This function counts the bytes of the data @p data of size @p size
+ * in @p histogram, which must be zeroed before its first use. Several
+ * buffers can be added to the same histogram.
+ */
+EXM_API void
+exm_pe_histogram_add(const void *data, DWORD size, Exm_Pe_Histogram *histogram)
+{
+    if (!data || (size == 0))
+        return;
+
+    exm_histogram_add(histogram->counts, data, size);
+    histogram->size += size;
+}
+
+/**
+ * @brief Return the Shannon entropy of a byte histogram.
+ *
+ * @param[in] histogram The histogram.
+ * @return The entropy, in bits per byte.
+ *
+ * This function returns the Shannon entropy of the bytes counted in
+ * @p histogram, between 0 and 8 bits per byte. Code is usually
+ * between 5 and 6.5, while compressed or encrypted data, like a
+ * packed program, is close to 8. An empty histogram has an entropy
+ * of 0.
+ */
+EXM_API double
+exm_pe_histogram_entropy_get(const Exm_Pe_Histogram *histogram)
+{
+    double sum;
+    double n;
+    int i;
+
+    if (histogram->size == 0)
+        return 0.0;
+
+    /* H = log2(n) - sum(c log2(c)) / n */
+    sum = 0.0;
+    for (i = 0; i < 256; i++)
+    {
+        if (histogram->counts[i] > 1)
+            sum += (double)histogram->counts[i] * log2((double)histogram->counts[i]);
+    }
+
+    n = (double)histogram->size;
+
+    return log2(n) - sum / n;
+}
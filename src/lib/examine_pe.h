@@ -28,6 +28,75 @@
 
 typedef struct _Exm_Pe Exm_Pe;
 
+#define EXM_SHA1_SIZE 20
+#define EXM_SHA256_SIZE 32
+
+#define EXM_PE_UNW_FLAG_EHANDLER  0x1
+#define EXM_PE_UNW_FLAG_UHANDLER  0x2
+#define EXM_PE_UNW_FLAG_CHAININFO 0x4
+
+typedef struct
+{
+    unsigned char version;
+    unsigned char flags;
+    unsigned char prolog_size;
+    unsigned char codes_count;
+    unsigned char frame_register;
+    unsigned char frame_offset; /* scaled by 16 */
+    const unsigned char *codes; /* codes_count slots of 2 bytes */
+    DWORD handler;
+    const IMAGE_RUNTIME_FUNCTION_ENTRY *chained;
+} Exm_Pe_Unwind_Info;
+
+#define EXM_PE_RESOURCE_ANY 0xffffffff
+
+typedef struct
+{
+    const IMAGE_RESOURCE_DIR_STRING_U *type_str; /* NULL if the type is an id */
+    const IMAGE_RESOURCE_DIR_STRING_U *name_str; /* NULL if the name is an id */
+    WORD type;
+    WORD id;
+    WORD language;
+    DWORD rva;
+    DWORD size;
+    DWORD codepage;
+} Exm_Pe_Resource;
+
+typedef struct
+{
+    const VS_FIXEDFILEINFO *fixed; /* NULL if not valid */
+    const WCHAR *language; /* key of the first string table, like 040904b0 */
+    DWORD language_length;
+    const DWORD *translations; /* LOWORD: language, HIWORD: codepage */
+    DWORD translations_count;
+    /* private */
+    const unsigned char *base;
+    const unsigned char *strings;
+    const unsigned char *strings_end;
+} Exm_Pe_Version_Info;
+
+typedef struct
+{
+    const WCHAR *key; /* not nul terminated */
+    DWORD key_length;
+    const WCHAR *value; /* not nul terminated */
+    DWORD value_length;
+} Exm_Pe_Version_String;
+
+typedef struct
+{
+    DWORD blocks;
+    DWORD count;     /* without the padding entries */
+    DWORD pages;     /* written by the loader when rebasing */
+    DWORD types[16]; /* indexed by IMAGE_REL_BASED_* */
+} Exm_Pe_Relocation_Stats;
+
+typedef struct
+{
+    unsigned long long counts[256];
+    unsigned long long size;
+} Exm_Pe_Histogram;
+
 EXM_API Exm_Pe *exm_pe_new(const char *filename);
 
 EXM_API Exm_Pe *exm_pe_new_from_base(const char *filename, const void *base, DWORD size);
@@ -70,6 +139,22 @@ EXM_API const IMAGE_RESOURCE_DIRECTORY *exm_pe_resource_directory_get(const Exm_
 
 EXM_API const void *exm_pe_resource_data_get(const Exm_Pe *pe, DWORD id, DWORD *size);
 
+EXM_API const Exm_Pe_Resource *exm_pe_resources_get(const Exm_Pe *pe, DWORD *count);
+
+EXM_API const Exm_Pe_Resource *exm_pe_resource_find(const Exm_Pe *pe, DWORD type, DWORD id, DWORD language);
+
+EXM_API const Exm_Pe_Resource *exm_pe_resource_find_by_name(const Exm_Pe *pe, DWORD type, const char *name, DWORD language);
+
+EXM_API const void *exm_pe_resource_entry_data_get(const Exm_Pe *pe, const Exm_Pe_Resource *res, DWORD *size);
+
+EXM_API unsigned char exm_pe_version_info_get(const Exm_Pe *pe, Exm_Pe_Version_Info *info);
+
+EXM_API unsigned char exm_pe_version_info_string_next(const Exm_Pe_Version_Info *info, DWORD *offset, Exm_Pe_Version_String *str);
+
+EXM_API unsigned char exm_pe_version_info_string_get(const Exm_Pe_Version_Info *info, const char *key, Exm_Pe_Version_String *str);
+
+EXM_API DWORD exm_pe_string_utf8_get(const WCHAR *str, DWORD length, char *buf, DWORD size);
+
 /* debug directory */
 
 EXM_API const IMAGE_DEBUG_DIRECTORY *exm_pe_debug_directory_get(const Exm_Pe *pe, DWORD *count);
@@ -84,4 +169,44 @@ EXM_API const char *exm_pe_section_string_table_get(const Exm_Pe *pe);
 
 EXM_API const char *exm_pe_section_name_get(const Exm_Pe *pe, const IMAGE_SECTION_HEADER *sh);
 
+EXM_API unsigned long long exm_pe_image_base_get(const Exm_Pe *pe);
+
+EXM_API const void *exm_pe_section_data_get(const Exm_Pe *pe, const char *name, DWORD *size);
+
+EXM_API const char *exm_pe_codeview_get(const Exm_Pe *pe, GUID *guid, DWORD *age);
+
+EXM_API const IMAGE_SYMBOL *exm_pe_coff_symbol_first_get(const Exm_Pe *pe);
+
+EXM_API const IMAGE_SYMBOL *exm_pe_coff_symbol_next_get(const Exm_Pe *pe, const IMAGE_SYMBOL *symbol);
+
+EXM_API const char *exm_pe_coff_symbol_name_get(const Exm_Pe *pe, const IMAGE_SYMBOL *symbol, char *short_name);
+
+EXM_API const IMAGE_RUNTIME_FUNCTION_ENTRY *exm_pe_runtime_functions_get(const Exm_Pe *pe, DWORD *count);
+
+EXM_API const IMAGE_RUNTIME_FUNCTION_ENTRY *exm_pe_runtime_function_find(const Exm_Pe *pe, DWORD rva);
+
+EXM_API unsigned char exm_pe_unwind_info_get(const Exm_Pe *pe, const IMAGE_RUNTIME_FUNCTION_ENTRY *rf, Exm_Pe_Unwind_Info *info);
+
+EXM_API const IMAGE_RUNTIME_FUNCTION_ENTRY *exm_pe_runtime_function_primary_get(const Exm_Pe *pe, const IMAGE_RUNTIME_FUNCTION_ENTRY *rf);
+
+EXM_API const IMAGE_BASE_RELOCATION *exm_pe_relocation_block_first_get(const Exm_Pe *pe);
+
+EXM_API const IMAGE_BASE_RELOCATION *exm_pe_relocation_block_next_get(const Exm_Pe *pe, const IMAGE_BASE_RELOCATION *block);
+
+EXM_API const WORD *exm_pe_relocation_block_entries_get(const IMAGE_BASE_RELOCATION *block, DWORD *count);
+
+EXM_API unsigned char exm_pe_relocation_stats_get(const Exm_Pe *pe, Exm_Pe_Relocation_Stats *stats, DWORD *sections);
+
+EXM_API unsigned char exm_pe_authenticode_digest_get(const Exm_Pe *pe, unsigned char *sha1, unsigned char *sha256);
+
+EXM_API DWORD exm_pe_checksum_compute(const Exm_Pe *pe);
+
+EXM_API const void *exm_pe_section_raw_data_get(const Exm_Pe *pe, const IMAGE_SECTION_HEADER *sh, DWORD *size);
+
+EXM_API const void *exm_pe_overlay_get(const Exm_Pe *pe, DWORD *size);
+
+EXM_API void exm_pe_histogram_add(const void *data, DWORD size, Exm_Pe_Histogram *histogram);
+
+EXM_API double exm_pe_histogram_entropy_get(const Exm_Pe_Histogram *histogram);
+
 #endif /* EXM_PE_H */
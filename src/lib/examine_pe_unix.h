@@ -30,16 +30,28 @@
 
 //#define _WIN64
 
+#ifdef __GNUC__
+# define EXM_ANONYMOUS __extension__
+#else
+# define EXM_ANONYMOUS
+#endif
+
 #define IMAGE_DOS_SIGNATURE 0x5A4D
 #define IMAGE_NT_SIGNATURE 0x00004550
 
 #define IMAGE_DIRECTORY_ENTRY_EXPORT 0
 #define IMAGE_DIRECTORY_ENTRY_IMPORT 1
+#define IMAGE_DIRECTORY_ENTRY_RESOURCE 2
+#define IMAGE_DIRECTORY_ENTRY_EXCEPTION 3
+#define IMAGE_DIRECTORY_ENTRY_SECURITY 4
+#define IMAGE_DIRECTORY_ENTRY_BASERELOC 5
 #define IMAGE_DIRECTORY_ENTRY_DEBUG 6
 #define IMAGE_DIRECTORY_ENTRY_DELAY_IMPORT 13
 
 #define IMAGE_FILE_DLL 0x2000
 
+#define IMAGE_FILE_MACHINE_AMD64 0x8664
+
 typedef unsigned char      BYTE;      /* 8 bits unsigned integer */
 typedef BYTE               BOOLEAN;   /* 8 bits boolean */
 typedef BOOLEAN           *PBOOLEAN;  /* pointer to a BOOLEAN */
@@ -47,6 +59,7 @@ typedef unsigned int       DWORD;     /* 32 bits unsigned integer */
 typedef int                LONG;      /* 32 bits signed integer */
 typedef unsigned long long ULONGLONG; /* 64 bits unsigned integer */
 typedef unsigned short     WORD;      /* 16 bits signed integer */
+typedef unsigned short     WCHAR;     /* 16 bits UTF-16 code unit */
 
 #ifdef _WIN64
 typedef long long LONG_PTR;
@@ -328,6 +341,113 @@ typedef struct
 #define IMAGE_SCN_MEM_READ               0x40000000 // Section is readable.
 #define IMAGE_SCN_MEM_WRITE              0x80000000 // Section is writeable.
 
+/***** COFF symbol format *****/
+
+#define IMAGE_SIZEOF_SYMBOL 18
+
+#define IMAGE_SYM_UNDEFINED 0
+
+#define IMAGE_SYM_CLASS_EXTERNAL 0x0002
+#define IMAGE_SYM_CLASS_STATIC   0x0003
+
+#define IMAGE_SYM_DTYPE_FUNCTION 2
+
+#define N_BTSHFT 4
+#define N_TMASK  0x0030
+
+#define ISFCN(x) (((x) & N_TMASK) == (IMAGE_SYM_DTYPE_FUNCTION << N_BTSHFT))
+
+#pragma pack(push, 2)
+typedef struct _IMAGE_SYMBOL
+{
+    union
+    {
+        BYTE ShortName[8];
+        struct
+        {
+            DWORD Short;
+            DWORD Long;
+        } Name;
+        DWORD LongName[2];
+    } N;
+    DWORD Value;
+    short SectionNumber;
+    WORD Type;
+    BYTE StorageClass;
+    BYTE NumberOfAuxSymbols;
+} IMAGE_SYMBOL, *PIMAGE_SYMBOL;
+#pragma pack(pop)
+
+/***** Resource format *****/
+
+typedef struct _IMAGE_RESOURCE_DIRECTORY
+{
+    DWORD Characteristics;
+    DWORD TimeDateStamp;
+    WORD MajorVersion;
+    WORD MinorVersion;
+    WORD NumberOfNamedEntries;
+    WORD NumberOfIdEntries;
+} IMAGE_RESOURCE_DIRECTORY, *PIMAGE_RESOURCE_DIRECTORY;
+
+EXM_ANONYMOUS typedef struct _IMAGE_RESOURCE_DIRECTORY_ENTRY
+{
+    EXM_ANONYMOUS union
+    {
+        EXM_ANONYMOUS struct
+        {
+            DWORD NameOffset : 31;
+            DWORD NameIsString : 1;
+        };
+        DWORD Name;
+        WORD Id;
+    };
+    EXM_ANONYMOUS union
+    {
+        DWORD OffsetToData;
+        EXM_ANONYMOUS struct
+        {
+            DWORD OffsetToDirectory : 31;
+            DWORD DataIsDirectory : 1;
+        };
+    };
+} IMAGE_RESOURCE_DIRECTORY_ENTRY, *PIMAGE_RESOURCE_DIRECTORY_ENTRY;
+
+typedef struct _IMAGE_RESOURCE_DIR_STRING_U
+{
+    WORD Length;
+    WCHAR NameString[1];
+} IMAGE_RESOURCE_DIR_STRING_U, *PIMAGE_RESOURCE_DIR_STRING_U;
+
+typedef struct _IMAGE_RESOURCE_DATA_ENTRY
+{
+    DWORD OffsetToData;
+    DWORD Size;
+    DWORD CodePage;
+    DWORD Reserved;
+} IMAGE_RESOURCE_DATA_ENTRY, *PIMAGE_RESOURCE_DATA_ENTRY;
+
+/***** Version format *****/
+
+#define VS_FFI_SIGNATURE 0xFEEF04BD
+
+typedef struct tagVS_FIXEDFILEINFO
+{
+    DWORD dwSignature;
+    DWORD dwStrucVersion;
+    DWORD dwFileVersionMS;
+    DWORD dwFileVersionLS;
+    DWORD dwProductVersionMS;
+    DWORD dwProductVersionLS;
+    DWORD dwFileFlagsMask;
+    DWORD dwFileFlags;
+    DWORD dwFileOS;
+    DWORD dwFileType;
+    DWORD dwFileSubtype;
+    DWORD dwFileDateMS;
+    DWORD dwFileDateLS;
+} VS_FIXEDFILEINFO;
+
 /***** Delayload format *****/
 
 typedef struct _IMAGE_DELAYLOAD_DESCRIPTOR
@@ -350,6 +470,34 @@ typedef struct _IMAGE_DELAYLOAD_DESCRIPTOR
     DWORD TimeDateStamp;
 } IMAGE_DELAYLOAD_DESCRIPTOR, *PIMAGE_DELAYLOAD_DESCRIPTOR;
 
+/***** Base relocation format *****/
+
+#define IMAGE_REL_BASED_ABSOLUTE 0
+#define IMAGE_REL_BASED_HIGH 1
+#define IMAGE_REL_BASED_LOW 2
+#define IMAGE_REL_BASED_HIGHLOW 3
+#define IMAGE_REL_BASED_HIGHADJ 4
+#define IMAGE_REL_BASED_DIR64 10
+
+typedef struct _IMAGE_BASE_RELOCATION
+{
+    DWORD VirtualAddress;
+    DWORD SizeOfBlock;
+} IMAGE_BASE_RELOCATION, *PIMAGE_BASE_RELOCATION;
+
+/***** Exception format *****/
+
+EXM_ANONYMOUS typedef struct _IMAGE_RUNTIME_FUNCTION_ENTRY
+{
+    DWORD BeginAddress;
+    DWORD EndAddress;
+    EXM_ANONYMOUS union
+    {
+        DWORD UnwindInfoAddress;
+        DWORD UnwindData;
+    };
+} IMAGE_RUNTIME_FUNCTION_ENTRY, *PIMAGE_RUNTIME_FUNCTION_ENTRY;
+
 /***** Debug format *****/
 
 typedef struct _IMAGE_DEBUG_DIRECTORY
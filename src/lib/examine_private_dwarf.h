@@ -0,0 +1,61 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXM_PRIVATE_DWARF_H
+#define EXM_PRIVATE_DWARF_H
+
+/*
+ * The DWARF sections of a module, as found in the file, without
+ * relocation. A missing section has a NULL data.
+ */
+
+typedef struct
+{
+    const unsigned char *data;
+    size_t size;
+} Exm_Dwarf_Section;
+
+typedef struct
+{
+    Exm_Dwarf_Section line;
+    Exm_Dwarf_Section line_str;
+    Exm_Dwarf_Section str;
+    Exm_Dwarf_Section info;
+    Exm_Dwarf_Section abbrev;
+    Exm_Dwarf_Section aranges;
+    Exm_Dwarf_Section addr;
+    Exm_Dwarf_Section str_offsets;
+    Exm_Dwarf_Section ranges;
+    Exm_Dwarf_Section rnglists;
+} Exm_Dwarf_Sections;
+
+unsigned char exm_dwarf_lines_add(const Exm_Dwarf_Sections *sections,
+                                  unsigned long long base,
+                                  Exm_Symbol_Index *index);
+
+unsigned char exm_dwarf_index_add(const Exm_Dwarf_Sections *sections,
+                                  unsigned long long base,
+                                  Exm_Symbol_Index *index);
+
+unsigned char exm_dwarf_sections_get(const Exm_Pe *pe,
+                                     Exm_Dwarf_Sections *sections);
+
+#endif /* EXM_PRIVATE_DWARF_H */
@@ -0,0 +1,47 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXM_PRIVATE_PDB_H
+#define EXM_PRIVATE_PDB_H
+
+/*
+ * A PDB file, the debug information written by the Microsoft linker,
+ * read natively so that the frames of the modules built with MSVC
+ * can be symbolized without dbghelp.
+ */
+
+typedef struct _Exm_Pdb Exm_Pdb;
+
+Exm_Pdb *exm_pdb_new(const char *filename);
+
+void exm_pdb_free(Exm_Pdb *pdb);
+
+const char *exm_pdb_filename_get(const Exm_Pdb *pdb);
+
+unsigned char exm_pdb_match(const Exm_Pdb *pdb, const GUID *guid, DWORD age);
+
+Exm_Pdb *exm_pdb_find(const Exm_Pe *pe);
+
+unsigned char exm_pdb_index_add(const Exm_Pdb *pdb,
+                                const Exm_Pe *pe,
+                                Exm_Symbol_Index *index);
+
+#endif /* EXM_PRIVATE_PDB_H */
@@ -0,0 +1,60 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXM_PRIVATE_SHA_H
+#define EXM_PRIVATE_SHA_H
+
+/*
+ * SHA-1 and SHA-256, streamed with the usual init, update and final
+ * functions. The blocks are compressed with the SHA extensions of x86
+ * CPUs when they are available. The digest sizes are in
+ * examine_pe.h.
+ */
+
+typedef struct
+{
+    unsigned int state[5];
+    unsigned long long length;
+    unsigned char buffer[64];
+} Exm_Sha1;
+
+typedef struct
+{
+    unsigned int state[8];
+    unsigned long long length;
+    unsigned char buffer[64];
+} Exm_Sha256;
+
+void exm_sha1_init(Exm_Sha1 *sha);
+
+void exm_sha1_update(Exm_Sha1 *sha, const void *data, size_t size);
+
+void exm_sha1_final(Exm_Sha1 *sha, unsigned char *digest);
+
+void exm_sha256_init(Exm_Sha256 *sha);
+
+void exm_sha256_update(Exm_Sha256 *sha, const void *data, size_t size);
+
+void exm_sha256_final(Exm_Sha256 *sha, unsigned char *digest);
+
+unsigned char exm_sha_hw_set(unsigned char enabled);
+
+#endif /* EXM_PRIVATE_SHA_H */
@@ -0,0 +1,82 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXM_PRIVATE_STACK_H
+#define EXM_PRIVATE_STACK_H
+
+/*
+ * A module is a file (executable or shared library) opened once, with
+ * its debug information read in a symbol index, natively for the
+ * DWARF or the PDB file of a PE file and with bfd otherwise. The cache
+ * keeps the modules for the process lifetime, so that symbolizing a
+ * frame does not open the file again. A cached module is also
+ * identified by the index at which it was added.
+ */
+
+typedef struct _Exm_Stack_Module Exm_Stack_Module;
+
+#ifdef HAVE_BFD
+/*
+ * binutils 2.34 removed the section accessors taking the bfd, bfd.h
+ * must be included before.
+ */
+# ifdef bfd_get_section_vma
+#  define EXM_BFD_SECTION_VMA(abfd, sec) bfd_get_section_vma(abfd, sec)
+#  define EXM_BFD_SECTION_FLAGS(abfd, sec) bfd_get_section_flags(abfd, sec)
+#  define EXM_BFD_SECTION_SIZE(abfd, sec) bfd_get_section_size(sec)
+# else
+#  define EXM_BFD_SECTION_VMA(abfd, sec) bfd_section_vma(sec)
+#  define EXM_BFD_SECTION_FLAGS(abfd, sec) bfd_section_flags(sec)
+#  define EXM_BFD_SECTION_SIZE(abfd, sec) bfd_section_size(sec)
+# endif
+#endif
+
+Exm_Stack_Module *exm_stack_module_new(const char *filename,
+                                       const void *base,
+                                       size_t size);
+
+void exm_stack_module_free(Exm_Stack_Module *module);
+
+const char *exm_stack_module_filename_get(const Exm_Stack_Module *module);
+
+const void *exm_stack_module_base_get(const Exm_Stack_Module *module);
+
+size_t exm_stack_module_size_get(const Exm_Stack_Module *module);
+
+unsigned int exm_stack_module_id_get(const Exm_Stack_Module *module);
+
+unsigned char exm_stack_module_frame_find(Exm_Stack_Module *module,
+                                          unsigned long long offset,
+                                          const char **filename,
+                                          const char **function,
+                                          unsigned int *line);
+
+Exm_Stack_Module *exm_stack_module_cache_find(const void *addr);
+
+Exm_Stack_Module *exm_stack_module_cache_add(const char *filename,
+                                             const void *base,
+                                             size_t size);
+
+Exm_Stack_Module *exm_stack_module_cache_get(unsigned int id);
+
+void exm_stack_module_cache_free(void);
+
+#endif /* EXM_PRIVATE_STACK_H */
@@ -0,0 +1,43 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXM_PRIVATE_SYMBOL_CACHE_H
+#define EXM_PRIVATE_SYMBOL_CACHE_H
+
+/*
+ * The symbol cache is a directory of symbol index files, one per
+ * module, named by the build id of the module, so that the debug
+ * information of a module that did not change is read only once.
+ */
+
+#define EXM_SYMBOL_CACHE_KEY_SIZE 48
+
+void exm_symbol_cache_key_get(const Exm_Pe *pe, char *key);
+
+Exm_Symbol_Index *exm_symbol_cache_get(const char *dir, const char *key);
+
+unsigned char exm_symbol_cache_set(const char *dir,
+                                   const char *key,
+                                   const Exm_Symbol_Index *index);
+
+const char *exm_symbol_cache_dir_get(void);
+
+#endif /* EXM_PRIVATE_SYMBOL_CACHE_H */
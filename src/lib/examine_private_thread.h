@@ -0,0 +1,163 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXM_PRIVATE_THREAD_H
+#define EXM_PRIVATE_THREAD_H
+
+/*
+ * Locks, thread local storage and atomic operations, for the code
+ * called from all the threads of a process, like the memcheck hooks.
+ * Windows.h must be included before on Windows.
+ */
+
+#ifdef _WIN32
+typedef CRITICAL_SECTION Exm_Lock;
+# define EXM_LOCK_INIT(l) (InitializeCriticalSection(l), 1)
+# define EXM_LOCK_SHUTDOWN(l) DeleteCriticalSection(l)
+# define EXM_LOCK(l) EnterCriticalSection(l)
+# define EXM_UNLOCK(l) LeaveCriticalSection(l)
+#else
+# include <pthread.h>
+typedef pthread_mutex_t Exm_Lock;
+# define EXM_LOCK_INIT(l) (pthread_mutex_init(l, NULL) == 0)
+# define EXM_LOCK_SHUTDOWN(l) pthread_mutex_destroy(l)
+# define EXM_LOCK(l) pthread_mutex_lock(l)
+# define EXM_UNLOCK(l) pthread_mutex_unlock(l)
+#endif
+
+/*
+ * Spin locks, for the data of a thread that the other threads seldom
+ * access: they are taken with a single atomic operation and released
+ * with a store.
+ */
+typedef unsigned int Exm_Spinlock;
+
+#ifdef _WIN32
+# define EXM_THREAD_YIELD() SwitchToThread()
+#else
+# include <sched.h>
+# define EXM_THREAD_YIELD() sched_yield()
+#endif
+
+#ifdef _MSC_VER
+# define EXM_SPINLOCK_INIT(l) (*(l) = 0)
+# define EXM_SPINLOCK(l) \
+do \
+{ \
+    while (InterlockedExchange((volatile LONG *)(l), 1)) \
+        EXM_THREAD_YIELD(); \
+} while (0)
+# define EXM_SPINUNLOCK(l) InterlockedExchange((volatile LONG *)(l), 0)
+#else
+# define EXM_SPINLOCK_INIT(l) (*(l) = 0)
+# define EXM_SPINLOCK(l) \
+do \
+{ \
+    while (__atomic_exchange_n((l), 1, __ATOMIC_ACQUIRE)) \
+        EXM_THREAD_YIELD(); \
+} while (0)
+# define EXM_SPINUNLOCK(l) __atomic_store_n((l), 0, __ATOMIC_RELEASE)
+#endif
+
+/*
+ * The library is loaded with the program, or with the preloaded
+ * memcheck library, so its variables are in the static TLS block and
+ * are accessed without calling __tls_get_addr().
+ */
+#if defined(_MSC_VER)
+# define EXM_TLS __declspec(thread)
+#elif defined(_WIN32)
+# define EXM_TLS __thread
+#else
+# define EXM_TLS __thread __attribute__((tls_model("initial-exec")))
+#endif
+
+#ifdef _MSC_VER
+
+# include <stdint.h>
+# include <intrin.h>
+
+/*
+ * The Interlocked functions are not generic, the one matching the size
+ * of the value is called. The values are 32 or 64 bits integers, or
+ * pointers.
+ */
+
+static __inline int
+_exm_atomic_cas32(volatile LONG *p, void *e, LONG v)
+{
+    LONG expected = *(LONG *)e;
+    LONG old;
+
+    old = InterlockedCompareExchange(p, v, expected);
+    if (old == expected)
+        return 1;
+
+    *(LONG *)e = old;
+    return 0;
+}
+
+static __inline int
+_exm_atomic_cas64(volatile LONGLONG *p, void *e, LONGLONG v)
+{
+    LONGLONG expected = *(LONGLONG *)e;
+    LONGLONG old;
+
+    old = InterlockedCompareExchange64(p, v, expected);
+    if (old == expected)
+        return 1;
+
+    *(LONGLONG *)e = old;
+    return 0;
+}
+
+/* counters that are only read once all the threads are done */
+# define EXM_ATOMIC_ADD(p, v) \
+    ((sizeof(*(p)) == 8) ? \
+     (unsigned long long)InterlockedExchangeAdd64((volatile LONGLONG *)(p), (LONGLONG)(v)) : \
+     (unsigned long long)(ULONG)InterlockedExchangeAdd((volatile LONG *)(p), (LONG)(v)))
+/* an aligned load is atomic, but for 64 bits values on 32 bits Windows */
+# define EXM_ATOMIC_LOAD(p) (_ReadWriteBarrier(), *(p))
+
+/* lists shared by the threads, whose elements are published or taken */
+# define EXM_ATOMIC_CAS(p, e, v) \
+    ((sizeof(*(p)) == 8) ? \
+     _exm_atomic_cas64((volatile LONGLONG *)(p), (e), (LONGLONG)(v)) : \
+     _exm_atomic_cas32((volatile LONG *)(p), (e), (LONG)(intptr_t)(v)))
+# define EXM_ATOMIC_STORE(p, v) \
+    ((sizeof(*(p)) == 8) ? \
+     (void)InterlockedExchange64((volatile LONGLONG *)(p), (LONGLONG)(v)) : \
+     (void)InterlockedExchange((volatile LONG *)(p), (LONG)(intptr_t)(v)))
+
+#else
+
+/* counters that are only read once all the threads are done */
+# define EXM_ATOMIC_ADD(p, v) __atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+# define EXM_ATOMIC_LOAD(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+
+/* lists shared by the threads, whose elements are published or taken */
+# define EXM_ATOMIC_CAS(p, e, v) \
+    __atomic_compare_exchange_n((p), (e), (v), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+# define EXM_ATOMIC_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+#endif
+
+#endif /* EXM_PRIVATE_THREAD_H */
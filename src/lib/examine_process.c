@@ -320,14 +320,21 @@ exm_process_crt_names_get(const Exm_Process *process)
     return process->crt_names;
 }
 
-EXM_API void
+EXM_API int
 exm_process_run(const Exm_Process *process)
 {
+    DWORD exit_code;
+
     EXM_LOG_DBG("resume child process thread 0x%p",
                 process->thread);
 
     ResumeThread(process->thread);
     WaitForSingleObject(process->process, INFINITE);
+
+    if (!GetExitCodeProcess(process->process, &exit_code))
+        return -1;
+
+    return (int)exit_code;
 }
 
 EXM_API void
@@ -32,7 +32,7 @@ EXM_API const Exm_List *exm_process_dep_names_get(const Exm_Process *process);
 
 EXM_API const Exm_List *exm_process_crt_names_get(const Exm_Process *process);
 
-EXM_API void exm_process_run(const Exm_Process *process);
+EXM_API int exm_process_run(const Exm_Process *process);
 
 EXM_API void exm_process_pause(const Exm_Process *process);
 
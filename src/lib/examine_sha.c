@@ -0,0 +1,534 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define EXM_SHA_NI 1
+# include <cpuid.h>
+# include <immintrin.h>
+#endif
+
+#include "Examine.h"
+
+#include "examine_private_sha.h"
+
+
+/*============================================================================*
+ *                                  Local                                     *
+ *============================================================================*/
+
+
+typedef void (*Exm_Sha_Blocks)(unsigned int *state, const unsigned char *data, size_t blocks);
+
+static const unsigned int _exm_sha256_k[64] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define EXM_SHA_ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define EXM_SHA_ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static unsigned int
+_exm_sha_be32_get(const unsigned char *p)
+{
+    return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) |
+           ((unsigned int)p[2] << 8) | (unsigned int)p[3];
+}
+
+static void
+_exm_sha_be32_set(unsigned char *p, unsigned int v)
+{
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+static void
+_exm_sha1_blocks_c(unsigned int *state, const unsigned char *data, size_t blocks)
+{
+    for (; blocks; blocks--, data += 64)
+    {
+        unsigned int w[80];
+        unsigned int a;
+        unsigned int b;
+        unsigned int c;
+        unsigned int d;
+        unsigned int e;
+        int i;
+
+        for (i = 0; i < 16; i++)
+            w[i] = _exm_sha_be32_get(data + 4 * i);
+        for (; i < 80; i++)
+            w[i] = EXM_SHA_ROL(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        a = state[0];
+        b = state[1];
+        c = state[2];
+        d = state[3];
+        e = state[4];
+        for (i = 0; i < 80; i++)
+        {
+            unsigned int f;
+            unsigned int t;
+
+            if (i < 20)
+                f = ((b & c) | (~b & d)) + 0x5a827999;
+            else if (i < 40)
+                f = (b ^ c ^ d) + 0x6ed9eba1;
+            else if (i < 60)
+                f = ((b & c) | (b & d) | (c & d)) + 0x8f1bbcdc;
+            else
+                f = (b ^ c ^ d) + 0xca62c1d6;
+            t = EXM_SHA_ROL(a, 5) + f + e + w[i];
+            e = d;
+            d = c;
+            c = EXM_SHA_ROL(b, 30);
+            b = a;
+            a = t;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+}
+
+static void
+_exm_sha256_blocks_c(unsigned int *state, const unsigned char *data, size_t blocks)
+{
+    for (; blocks; blocks--, data += 64)
+    {
+        unsigned int w[64];
+        unsigned int s[8];
+        int i;
+
+        for (i = 0; i < 16; i++)
+            w[i] = _exm_sha_be32_get(data + 4 * i);
+        for (; i < 64; i++)
+        {
+            unsigned int s0;
+            unsigned int s1;
+
+            s0 = EXM_SHA_ROR(w[i - 15], 7) ^ EXM_SHA_ROR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            s1 = EXM_SHA_ROR(w[i - 2], 17) ^ EXM_SHA_ROR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        memcpy(s, state, sizeof(s));
+        for (i = 0; i < 64; i++)
+        {
+            unsigned int t1;
+            unsigned int t2;
+
+            t1 = s[7] + (EXM_SHA_ROR(s[4], 6) ^ EXM_SHA_ROR(s[4], 11) ^ EXM_SHA_ROR(s[4], 25)) +
+                 ((s[4] & s[5]) ^ (~s[4] & s[6])) + _exm_sha256_k[i] + w[i];
+            t2 = (EXM_SHA_ROR(s[0], 2) ^ EXM_SHA_ROR(s[0], 13) ^ EXM_SHA_ROR(s[0], 22)) +
+                 ((s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]));
+            s[7] = s[6];
+            s[6] = s[5];
+            s[5] = s[4];
+            s[4] = s[3] + t1;
+            s[3] = s[2];
+            s[2] = s[1];
+            s[1] = s[0];
+            s[0] = t1 + t2;
+        }
+        for (i = 0; i < 8; i++)
+            state[i] += s[i];
+    }
+}
+
+#ifdef EXM_SHA_NI
+
+/*
+ * The SHA extensions compute 4 rounds of SHA-1 and 2 rounds of
+ * SHA-256 per instruction, and the next 4 words of the message
+ * schedule from the 4 previous groups (a to d) with 2 instructions.
+ * The rounds are unrolled so that the schedule stays in registers.
+ */
+
+#define EXM_SHA1_NI_SCHEDULE(a, b, c, d) \
+    a = _mm_sha1msg2_epu32(_mm_xor_si128(_mm_sha1msg1_epu32(a, b), c), d)
+
+#define EXM_SHA1_NI_ROUNDS(e0, e1, m, f) \
+    do { \
+        e0 = _mm_sha1nexte_epu32(e0, m); \
+        e1 = abcd; \
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, f); \
+    } while (0)
+
+#define EXM_SHA256_NI_SCHEDULE(a, b, c, d) \
+    a = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(a, b), \
+                                           _mm_alignr_epi8(d, c, 4)), d)
+
+#define EXM_SHA256_NI_ROUNDS(m, i) \
+    do { \
+        msg = _mm_add_epi32(m, _mm_loadu_si128((const __m128i *)(_exm_sha256_k + 4 * (i)))); \
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg); \
+        state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0e)); \
+    } while (0)
+
+__attribute__((target("sha,sse4.1,ssse3")))
+static void
+_exm_sha1_blocks_ni(unsigned int *state, const unsigned char *data, size_t blocks)
+{
+    const __m128i mask = _mm_set_epi64x(0x0001020304050607LL, 0x08090a0b0c0d0e0fLL);
+    __m128i abcd;
+    __m128i e0;
+    __m128i e1;
+
+    abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)state), 0x1b);
+    e0 = _mm_set_epi32((int)state[4], 0, 0, 0);
+
+    for (; blocks; blocks--, data += 64)
+    {
+        __m128i abcd_save;
+        __m128i e_save;
+        __m128i m0;
+        __m128i m1;
+        __m128i m2;
+        __m128i m3;
+
+        abcd_save = abcd;
+        e_save = e0;
+        m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data), mask);
+        m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16)), mask);
+        m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 32)), mask);
+        m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 48)), mask);
+
+        e0 = _mm_add_epi32(e0, m0);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        EXM_SHA1_NI_ROUNDS(e1, e0, m1, 0);
+        EXM_SHA1_NI_ROUNDS(e0, e1, m2, 0);
+        EXM_SHA1_NI_ROUNDS(e1, e0, m3, 0);
+        EXM_SHA1_NI_SCHEDULE(m0, m1, m2, m3);
+        EXM_SHA1_NI_ROUNDS(e0, e1, m0, 0);
+        EXM_SHA1_NI_SCHEDULE(m1, m2, m3, m0);
+        EXM_SHA1_NI_ROUNDS(e1, e0, m1, 1);
+        EXM_SHA1_NI_SCHEDULE(m2, m3, m0, m1);
+        EXM_SHA1_NI_ROUNDS(e0, e1, m2, 1);
+        EXM_SHA1_NI_SCHEDULE(m3, m0, m1, m2);
+        EXM_SHA1_NI_ROUNDS(e1, e0, m3, 1);
+        EXM_SHA1_NI_SCHEDULE(m0, m1, m2, m3);
+        EXM_SHA1_NI_ROUNDS(e0, e1, m0, 1);
+        EXM_SHA1_NI_SCHEDULE(m1, m2, m3, m0);
+        EXM_SHA1_NI_ROUNDS(e1, e0, m1, 1);
+        EXM_SHA1_NI_SCHEDULE(m2, m3, m0, m1);
+        EXM_SHA1_NI_ROUNDS(e0, e1, m2, 2);
+        EXM_SHA1_NI_SCHEDULE(m3, m0, m1, m2);
+        EXM_SHA1_NI_ROUNDS(e1, e0, m3, 2);
+        EXM_SHA1_NI_SCHEDULE(m0, m1, m2, m3);
+        EXM_SHA1_NI_ROUNDS(e0, e1, m0, 2);
+        EXM_SHA1_NI_SCHEDULE(m1, m2, m3, m0);
+        EXM_SHA1_NI_ROUNDS(e1, e0, m1, 2);
+        EXM_SHA1_NI_SCHEDULE(m2, m3, m0, m1);
+        EXM_SHA1_NI_ROUNDS(e0, e1, m2, 2);
+        EXM_SHA1_NI_SCHEDULE(m3, m0, m1, m2);
+        EXM_SHA1_NI_ROUNDS(e1, e0, m3, 3);
+        EXM_SHA1_NI_SCHEDULE(m0, m1, m2, m3);
+        EXM_SHA1_NI_ROUNDS(e0, e1, m0, 3);
+        EXM_SHA1_NI_SCHEDULE(m1, m2, m3, m0);
+        EXM_SHA1_NI_ROUNDS(e1, e0, m1, 3);
+        EXM_SHA1_NI_SCHEDULE(m2, m3, m0, m1);
+        EXM_SHA1_NI_ROUNDS(e0, e1, m2, 3);
+        EXM_SHA1_NI_SCHEDULE(m3, m0, m1, m2);
+        EXM_SHA1_NI_ROUNDS(e1, e0, m3, 3);
+
+        e0 = _mm_sha1nexte_epu32(e0, e_save);
+        abcd = _mm_add_epi32(abcd, abcd_save);
+    }
+
+    _mm_storeu_si128((__m128i *)state, _mm_shuffle_epi32(abcd, 0x1b));
+    state[4] = (unsigned int)_mm_extract_epi32(e0, 3);
+}
+
+__attribute__((target("sha,sse4.1,ssse3")))
+static void
+_exm_sha256_blocks_ni(unsigned int *state, const unsigned char *data, size_t blocks)
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bLL, 0x0405060700010203LL);
+    __m128i state0;
+    __m128i state1;
+    __m128i tmp;
+
+    tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)state), 0xb1);
+    state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(state + 4)), 0x1b);
+    state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+    for (; blocks; blocks--, data += 64)
+    {
+        __m128i abef_save;
+        __m128i cdgh_save;
+        __m128i msg;
+        __m128i m0;
+        __m128i m1;
+        __m128i m2;
+        __m128i m3;
+
+        abef_save = state0;
+        cdgh_save = state1;
+        m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data), mask);
+        m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16)), mask);
+        m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 32)), mask);
+        m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 48)), mask);
+
+        EXM_SHA256_NI_ROUNDS(m0, 0);
+        EXM_SHA256_NI_ROUNDS(m1, 1);
+        EXM_SHA256_NI_ROUNDS(m2, 2);
+        EXM_SHA256_NI_ROUNDS(m3, 3);
+        EXM_SHA256_NI_SCHEDULE(m0, m1, m2, m3);
+        EXM_SHA256_NI_ROUNDS(m0, 4);
+        EXM_SHA256_NI_SCHEDULE(m1, m2, m3, m0);
+        EXM_SHA256_NI_ROUNDS(m1, 5);
+        EXM_SHA256_NI_SCHEDULE(m2, m3, m0, m1);
+        EXM_SHA256_NI_ROUNDS(m2, 6);
+        EXM_SHA256_NI_SCHEDULE(m3, m0, m1, m2);
+        EXM_SHA256_NI_ROUNDS(m3, 7);
+        EXM_SHA256_NI_SCHEDULE(m0, m1, m2, m3);
+        EXM_SHA256_NI_ROUNDS(m0, 8);
+        EXM_SHA256_NI_SCHEDULE(m1, m2, m3, m0);
+        EXM_SHA256_NI_ROUNDS(m1, 9);
+        EXM_SHA256_NI_SCHEDULE(m2, m3, m0, m1);
+        EXM_SHA256_NI_ROUNDS(m2, 10);
+        EXM_SHA256_NI_SCHEDULE(m3, m0, m1, m2);
+        EXM_SHA256_NI_ROUNDS(m3, 11);
+        EXM_SHA256_NI_SCHEDULE(m0, m1, m2, m3);
+        EXM_SHA256_NI_ROUNDS(m0, 12);
+        EXM_SHA256_NI_SCHEDULE(m1, m2, m3, m0);
+        EXM_SHA256_NI_ROUNDS(m1, 13);
+        EXM_SHA256_NI_SCHEDULE(m2, m3, m0, m1);
+        EXM_SHA256_NI_ROUNDS(m2, 14);
+        EXM_SHA256_NI_SCHEDULE(m3, m0, m1, m2);
+        EXM_SHA256_NI_ROUNDS(m3, 15);
+
+        state0 = _mm_add_epi32(state0, abef_save);
+        state1 = _mm_add_epi32(state1, cdgh_save);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1b);
+    state1 = _mm_shuffle_epi32(state1, 0xb1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xf0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128((__m128i *)state, state0);
+    _mm_storeu_si128((__m128i *)(state + 4), state1);
+}
+
+static unsigned char
+_exm_sha_ni_supported(void)
+{
+    unsigned int eax;
+    unsigned int ebx;
+    unsigned int ecx;
+    unsigned int edx;
+
+    if (__get_cpuid_max(0, NULL) < 7)
+        return 0;
+
+    /* SSSE3 and SSE4.1 */
+    __cpuid(1, eax, ebx, ecx, edx);
+    if (!(ecx & (1 << 9)) || !(ecx & (1 << 19)))
+        return 0;
+
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+
+    return (ebx & (1 << 29)) != 0;
+}
+
+#endif
+
+static Exm_Sha_Blocks _exm_sha1_blocks = NULL;
+static Exm_Sha_Blocks _exm_sha256_blocks = NULL;
+
+static void
+_exm_sha_blocks_init(void)
+{
+    /* concurrent initializations store the same values */
+    if (_exm_sha1_blocks)
+        return;
+
+    exm_sha_hw_set(1);
+}
+
+static void
+_exm_sha_update(unsigned int *state, unsigned long long *length, unsigned char *buffer,
+                Exm_Sha_Blocks blocks, const unsigned char *data, size_t size)
+{
+    size_t used;
+
+    used = (size_t)(*length & 63);
+    *length += size;
+
+    if (used)
+    {
+        size_t s;
+
+        s = 64 - used;
+        if (size < s)
+        {
+            memcpy(buffer + used, data, size);
+            return;
+        }
+
+        memcpy(buffer + used, data, s);
+        blocks(state, buffer, 1);
+        data += s;
+        size -= s;
+    }
+
+    if (size >= 64)
+    {
+        blocks(state, data, size / 64);
+        data += size & ~(size_t)63;
+        size &= 63;
+    }
+
+    if (size)
+        memcpy(buffer, data, size);
+}
+
+static void
+_exm_sha_final(unsigned int *state, unsigned long long length, unsigned char *buffer,
+               Exm_Sha_Blocks blocks)
+{
+    size_t used;
+
+    used = (size_t)(length & 63);
+    buffer[used++] = 0x80;
+    if (used > 56)
+    {
+        memset(buffer + used, 0, 64 - used);
+        blocks(state, buffer, 1);
+        used = 0;
+    }
+    memset(buffer + used, 0, 56 - used);
+    _exm_sha_be32_set(buffer + 56, (unsigned int)(length >> 29));
+    _exm_sha_be32_set(buffer + 60, (unsigned int)(length << 3));
+    blocks(state, buffer, 1);
+}
+
+
+/*============================================================================*
+ *                                 Global                                     *
+ *============================================================================*/
+
+
+void
+exm_sha1_init(Exm_Sha1 *sha)
+{
+    _exm_sha_blocks_init();
+    sha->state[0] = 0x67452301;
+    sha->state[1] = 0xefcdab89;
+    sha->state[2] = 0x98badcfe;
+    sha->state[3] = 0x10325476;
+    sha->state[4] = 0xc3d2e1f0;
+    sha->length = 0;
+}
+
+void
+exm_sha1_update(Exm_Sha1 *sha, const void *data, size_t size)
+{
+    _exm_sha_update(sha->state, &sha->length, sha->buffer,
+                    _exm_sha1_blocks, (const unsigned char *)data, size);
+}
+
+void
+exm_sha1_final(Exm_Sha1 *sha, unsigned char *digest)
+{
+    int i;
+
+    _exm_sha_final(sha->state, sha->length, sha->buffer, _exm_sha1_blocks);
+    for (i = 0; i < 5; i++)
+        _exm_sha_be32_set(digest + 4 * i, sha->state[i]);
+}
+
+void
+exm_sha256_init(Exm_Sha256 *sha)
+{
+    _exm_sha_blocks_init();
+    sha->state[0] = 0x6a09e667;
+    sha->state[1] = 0xbb67ae85;
+    sha->state[2] = 0x3c6ef372;
+    sha->state[3] = 0xa54ff53a;
+    sha->state[4] = 0x510e527f;
+    sha->state[5] = 0x9b05688c;
+    sha->state[6] = 0x1f83d9ab;
+    sha->state[7] = 0x5be0cd19;
+    sha->length = 0;
+}
+
+void
+exm_sha256_update(Exm_Sha256 *sha, const void *data, size_t size)
+{
+    _exm_sha_update(sha->state, &sha->length, sha->buffer,
+                    _exm_sha256_blocks, (const unsigned char *)data, size);
+}
+
+void
+exm_sha256_final(Exm_Sha256 *sha, unsigned char *digest)
+{
+    int i;
+
+    _exm_sha_final(sha->state, sha->length, sha->buffer, _exm_sha256_blocks);
+    for (i = 0; i < 8; i++)
+        _exm_sha_be32_set(digest + 4 * i, sha->state[i]);
+}
+
+/*
+ * Use the SHA extensions of the CPU if @p enabled is not 0 and if
+ * they are supported, the C implementation otherwise, for the hashes
+ * initialized afterwards. Return 1 if the SHA extensions are used.
+ */
+unsigned char
+exm_sha_hw_set(unsigned char enabled)
+{
+#ifdef EXM_SHA_NI
+    if (enabled && _exm_sha_ni_supported())
+    {
+        _exm_sha256_blocks = _exm_sha256_blocks_ni;
+        _exm_sha1_blocks = _exm_sha1_blocks_ni;
+        return 1;
+    }
+#else
+    (void)enabled;
+#endif
+
+    _exm_sha256_blocks = _exm_sha256_blocks_c;
+    _exm_sha1_blocks = _exm_sha1_blocks_c;
+
+    return 0;
+}
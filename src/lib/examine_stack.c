@@ -24,33 +24,36 @@
 #endif
 
 #include <stdlib.h>
-
-#ifndef WIN32_LEAN_AND_MEAN
-# define WIN32_LEAN_AND_MEAN
+#include <stdint.h>
+#include <string.h>
+
+#ifdef _WIN32
+# ifndef WIN32_LEAN_AND_MEAN
+#  define WIN32_LEAN_AND_MEAN
+# endif
+# include <windows.h>
+# undef WIN32_LEAN_AND_MEAN
+#else
+# include <limits.h>
+# include <unistd.h>
+# include <link.h>
 #endif
-#include <windows.h>
-#undef WIN32_LEAN_AND_MEAN
 
-#include <bfd.h>
+#ifdef HAVE_BFD
+# include <bfd.h>
+#endif
 
 #include "Examine.h"
 
+#include "examine_private_stack.h"
+#include "examine_private_thread.h"
+
 
 /*============================================================================*
  *                                  Local                                     *
  *============================================================================*/
 
 
-typedef struct _Exm_Stack_Find_Data Exm_Stack_Find_Data;
-
-struct _Exm_Stack_Find_Data
-{
-    char     *function;
-    asymbol **symbol_table;
-    bfd_vma   counter;
-    Exm_List *list;
-};
-
 struct _Exm_Stack_Data
 {
     char *filename;
@@ -58,106 +61,315 @@ struct _Exm_Stack_Data
     unsigned int line;
 };
 
-static void
-_exm_stack_find_function_name_in_section(bfd *abfd, asection *sec, void *obj)
+struct _Exm_Stack_Symbolizer
+{
+    unsigned long long *pcs; /* module id << 32 | offset */
+    Exm_Stack_Data **frames; /* NULL when the frame is not resolved */
+    unsigned int pcs_nbr;
+    unsigned int pcs_max;
+    unsigned int frames_nbr; /* number of pcs sorted by the last run */
+};
+
+#define EXM_STACK_FRAMES_MAX 100
+
+/* protects the module cache, filled by the threads capturing a stack */
+static Exm_Lock _exm_stack_lock;
+
+#ifdef _WIN32
+
+static size_t
+_exm_stack_module_size_get(const void *base)
 {
-    Exm_Stack_Find_Data *data;
-    bfd_vma vma;
-    const char *fct;
-    const char *func = NULL;
-    const char *file = NULL;
-    unsigned int line = 0;
+    const IMAGE_DOS_HEADER *dos_header;
+    const IMAGE_NT_HEADERS *nt_header;
+
+    dos_header = (const IMAGE_DOS_HEADER *)base;
+    if (dos_header->e_magic != IMAGE_DOS_SIGNATURE)
+        return 0;
+
+    nt_header = (const IMAGE_NT_HEADERS *)((const unsigned char *)base + dos_header->e_lfanew);
+    if (nt_header->Signature != IMAGE_NT_SIGNATURE)
+        return 0;
+
+    return nt_header->OptionalHeader.SizeOfImage;
+}
 
-    /* printf(" $$$$ %s\n", bfd_get_filename(abfd)); */
+static Exm_Stack_Module *
+_exm_stack_module_get(const void *frame, unsigned int i)
+{
+    TCHAR tpath[MAX_PATH];
+    MEMORY_BASIC_INFORMATION mbi;
+    Exm_Stack_Module *module;
 
-    if (!sec)
+    module = exm_stack_module_cache_find(frame);
+    if (module)
+        return module;
+
+    /* Get the name and base address of the module */
+
+    if (!VirtualQuery(frame, &mbi, sizeof(mbi)))
     {
-        EXM_LOG_ERR("Can not find section");
-        return;
+        EXM_LOG_WARN("VirtualQuery failed on frame #%d (0x%p), skipping",
+                     i, frame);
+        return NULL;
     }
 
-    data = (Exm_Stack_Find_Data *)obj;
-    if (data->function)// && (*data->function != '\0'))
+    if (mbi.State != MEM_COMMIT)
     {
-        EXM_LOG_ERR("function already found : %s", data->function);
-        /* function already found */
-        return;
+        EXM_LOG_WARN("Address 0x%p of frame #%d is not available, skipping",
+                     frame, i);
+        return NULL;
     }
 
-    if (!(bfd_get_section_flags(abfd, sec) & SEC_ALLOC))
+    if (!mbi.AllocationBase)
     {
-        /* EXM_LOG_ERR("bad flags"); */
-        /* return; */
+        EXM_LOG_WARN("Address 0x%p of frame #%d is not available, skipping",
+                     frame, i);
+        return NULL;
     }
 
-    vma = bfd_get_section_vma(abfd, sec);
-    if (data->counter < vma)
-        return;
-    if ((vma + bfd_get_section_size(sec)) <= data->counter)
+    if (!GetModuleFileName(mbi.AllocationBase, (LPTSTR)&tpath, MAX_PATH))
     {
-        EXM_LOG_ERR("wrong size");
-        return;
+        EXM_LOG_WARN("Can not retrieve the file name of the module for frame #%d, skipping",
+                     i);
+        return NULL;
     }
 
-    if (bfd_find_nearest_line(abfd, sec,
-                              data->symbol_table,
-                              data->counter - vma,
-                              &file, &func, &line))
+    EXM_LOG_DBG("Frame #%d in module %s", i, tpath);
+
+    return exm_stack_module_cache_add(tpath, mbi.AllocationBase,
+                                      _exm_stack_module_size_get(mbi.AllocationBase));
+}
+
+#else
+
+typedef struct
+{
+    const void *frame;
+    const void *base;
+    size_t size;
+    char filename[PATH_MAX];
+} Exm_Stack_Module_Search;
+
+static int
+_exm_stack_module_search_cb(struct dl_phdr_info *info, size_t size EXM_UNUSED, void *data)
+{
+    Exm_Stack_Module_Search *search;
+    uintptr_t start;
+    uintptr_t end;
+    unsigned char found;
+    ElfW(Half) i;
+
+    search = (Exm_Stack_Module_Search *)data;
+
+    start = UINTPTR_MAX;
+    end = 0;
+    found = 0;
+    for (i = 0; i < info->dlpi_phnum; i++)
     {
-        Exm_Stack_Data *sw_data;
-        size_t l;
-        char *iter;
+        const ElfW(Phdr) *phdr;
+        uintptr_t segment;
 
-        if (!file)
-            file = bfd_get_filename(abfd);
+        phdr = info->dlpi_phdr + i;
+        if (phdr->p_type != PT_LOAD)
+            continue;
 
-        if (!file)
-            file = "???";
+        segment = info->dlpi_addr + phdr->p_vaddr;
+        if (segment < start)
+            start = segment;
+        if (segment + phdr->p_memsz > end)
+            end = segment + phdr->p_memsz;
+        if (((uintptr_t)search->frame - segment) < phdr->p_memsz)
+            found = 1;
+    }
 
-        iter = (char *)file;
-        while (*iter)
-        {
-            if (*iter == '/') *iter = '\\';
-            iter++;
-        }
+    if (!found)
+        return 0;
 
-        iter = strrchr(file, '\\');
-        if (iter)
-            iter++;
-        else
-            iter = (char *)file;
+    /* the base is the lowest segment, whatever the load bias */
+    search->base = (const void *)start;
+    search->size = end - start;
 
-        if (strcmp(iter, "examine_stack.c") == 0)
-            return;
+    /* the name of the program is empty */
+    if (info->dlpi_name && *info->dlpi_name)
+    {
+        strncpy(search->filename, info->dlpi_name, sizeof(search->filename) - 1);
+        search->filename[sizeof(search->filename) - 1] = '\0';
+    }
+    else
+    {
+        ssize_t l;
 
-        sw_data = (Exm_Stack_Data *)calloc(1, sizeof(Exm_Stack_Data));
-        if (!sw_data)
-            return;
+        l = readlink("/proc/self/exe", search->filename, sizeof(search->filename) - 1);
+        if (l <= 0)
+            return 0;
+        search->filename[l] = '\0';
+    }
 
-        l = strlen(iter) + 1;
-        sw_data->filename = (char *)malloc(l * sizeof(char));
-        if (!sw_data->filename)
-        {
-            free(sw_data);
-            return;
-        }
+    return 1;
+}
 
-        memcpy(sw_data->filename, iter, l);
+static Exm_Stack_Module *
+_exm_stack_module_get(const void *frame, unsigned int i)
+{
+    Exm_Stack_Module_Search search;
+    Exm_Stack_Module *module;
 
-        fct = func ? func : "???";
-        l = strlen(fct) + 1;
-        sw_data->function = (char *)malloc(l * sizeof(char));
-        if (!sw_data->function)
-        {
-            free(sw_data->filename);
-            free(sw_data);
-            return;
-        }
-        memcpy(sw_data->function, fct, l);
+    module = exm_stack_module_cache_find(frame);
+    if (module)
+        return module;
+
+    search.frame = frame;
+    if (!dl_iterate_phdr(_exm_stack_module_search_cb, &search))
+        return NULL;
 
-        sw_data->line = line;
-        data->list = exm_list_append(data->list, sw_data);
+    EXM_LOG_DBG("Frame #%d in module %s", i, search.filename);
+
+    return exm_stack_module_cache_add(search.filename, search.base, search.size);
+}
+
+/*
+ * Modules of the last frames found by the thread. The frames of a
+ * stack are in a few modules, so most of them are found here, without
+ * taking the lock of the cache. The hints are dropped when the cache
+ * is freed.
+ */
+#define EXM_STACK_HINTS_MAX 4
+
+typedef struct
+{
+    uintptr_t base;
+    size_t size;
+    unsigned int id;
+} Exm_Stack_Hint;
+
+static unsigned int _exm_stack_generation = 1;
+static EXM_TLS Exm_Stack_Hint _exm_stack_hints[EXM_STACK_HINTS_MAX];
+static EXM_TLS unsigned int _exm_stack_hints_generation = 0;
+static EXM_TLS unsigned int _exm_stack_hints_next = 0;
+
+static const Exm_Stack_Hint *
+_exm_stack_hint_get(const void *frame, unsigned int i)
+{
+    Exm_Stack_Hint *hint;
+    Exm_Stack_Module *module;
+    unsigned int j;
+
+    for (j = 0; j < EXM_STACK_HINTS_MAX; j++)
+    {
+        hint = _exm_stack_hints + j;
+        if (((uintptr_t)frame - hint->base) < hint->size)
+            return hint;
+    }
+
+    EXM_LOCK(&_exm_stack_lock);
+    module = _exm_stack_module_get(frame, i);
+    if (!module)
+    {
+        EXM_UNLOCK(&_exm_stack_lock);
+        return NULL;
+    }
+
+    hint = _exm_stack_hints + _exm_stack_hints_next;
+    _exm_stack_hints_next = (_exm_stack_hints_next + 1) % EXM_STACK_HINTS_MAX;
+    hint->base = (uintptr_t)exm_stack_module_base_get(module);
+    hint->size = exm_stack_module_size_get(module);
+    hint->id = exm_stack_module_id_get(module);
+    EXM_UNLOCK(&_exm_stack_lock);
+
+    return hint;
+}
+
+/* bounds of the stack of the thread, retrieved at its first capture */
+static EXM_TLS uintptr_t _exm_stack_low = 0;
+static EXM_TLS uintptr_t _exm_stack_high = 0;
+
+static void
+_exm_stack_bounds_get(void)
+{
+    pthread_attr_t attr;
+    void *addr;
+    size_t size;
+
+    if (pthread_getattr_np(pthread_self(), &attr) != 0)
+        return;
+
+    if (pthread_attr_getstack(&attr, &addr, &size) == 0)
+    {
+        _exm_stack_low = (uintptr_t)addr;
+        _exm_stack_high = (uintptr_t)addr + size;
+    }
+
+    pthread_attr_destroy(&attr);
+}
+
+#endif
+
+static unsigned long long
+_exm_stack_pc_key(const Exm_Stack_Pc *pc)
+{
+    return ((unsigned long long)pc->module << 32) | pc->offset;
+}
+
+static int
+_exm_stack_pc_key_cmp(const void *p1, const void *p2)
+{
+    unsigned long long k1;
+    unsigned long long k2;
+
+    k1 = *(const unsigned long long *)p1;
+    k2 = *(const unsigned long long *)p2;
+
+    if (k1 < k2)
+        return -1;
+    if (k1 > k2)
+        return 1;
+    return 0;
+}
+
+static Exm_Stack_Data *
+_exm_stack_data_new(const char *file, const char *func, unsigned int line)
+{
+    Exm_Stack_Data *sw_data;
+    const char *iter;
+    size_t l;
+
+    iter = file + strlen(file);
+    while ((iter != file) && (iter[-1] != '/') && (iter[-1] != '\\'))
+        iter--;
+
+    if (strcmp(iter, "examine_stack.c") == 0)
+        return NULL;
+
+    sw_data = (Exm_Stack_Data *)calloc(1, sizeof(Exm_Stack_Data));
+    if (!sw_data)
+        return NULL;
+
+    l = strlen(iter) + 1;
+    sw_data->filename = (char *)malloc(l * sizeof(char));
+    if (!sw_data->filename)
+    {
+        free(sw_data);
+        return NULL;
     }
+
+    memcpy(sw_data->filename, iter, l);
+
+    if (!func)
+        func = "???";
+    l = strlen(func) + 1;
+    sw_data->function = (char *)malloc(l * sizeof(char));
+    if (!sw_data->function)
+    {
+        free(sw_data->filename);
+        free(sw_data);
+        return NULL;
+    }
+    memcpy(sw_data->function, func, l);
+
+    sw_data->line = line;
+
+    return sw_data;
 }
 
 
@@ -174,139 +386,357 @@ _exm_stack_find_function_name_in_section(bfd *abfd, asection *sec, void *obj)
 EXM_API unsigned char
 exm_stack_init(void)
 {
+#ifdef HAVE_BFD
     bfd_init();
+#endif
 
-    return 1;
+    return EXM_LOCK_INIT(&_exm_stack_lock);
 }
 
 EXM_API void
 exm_stack_shutdown(void)
 {
+    exm_stack_module_cache_free();
+    EXM_LOCK_SHUTDOWN(&_exm_stack_lock);
+#ifndef _WIN32
+    EXM_ATOMIC_ADD(&_exm_stack_generation, 1);
+#endif
 }
 
 EXM_API Exm_List *
 exm_stack_frames_get(void)
 {
-#define MAX_ENTRIES 100
-    Exm_Stack_Find_Data data;
-    void            *frames[MAX_ENTRIES];
+    Exm_Stack_Symbolizer *symbolizer;
+    Exm_Stack_Pc pcs[EXM_STACK_FRAMES_MAX];
+    Exm_List *list;
+    unsigned int pcs_nbr;
+
+    pcs_nbr = exm_stack_capture(pcs, EXM_STACK_FRAMES_MAX);
+    if (pcs_nbr == 0)
+        return NULL;
+
+    symbolizer = exm_stack_symbolizer_new();
+    if (!symbolizer)
+        return NULL;
+
+    list = NULL;
+    if (exm_stack_symbolizer_add(symbolizer, pcs, pcs_nbr))
+    {
+        exm_stack_symbolizer_run(symbolizer);
+        list = exm_stack_symbolizer_frames_get(symbolizer, pcs, pcs_nbr);
+    }
+    exm_stack_symbolizer_free(symbolizer);
+
+    return list;
+}
+
+/*
+ * Fill @p pcs with at most @p max return addresses of the current
+ * stack, without resolving them. Frames outside of any module are
+ * skipped. Return the number of filled frames.
+ *
+ * On UNIX, the stack is walked with the frame pointers, from the
+ * caller of this function, and stops at the first frame outside of
+ * any module. The callers must keep their frame pointer for their
+ * callers to be found.
+ */
+EXM_API unsigned int
+exm_stack_capture(Exm_Stack_Pc *pcs, unsigned int max)
+{
+#ifdef _WIN32
+    void            *frames[EXM_STACK_FRAMES_MAX];
     unsigned short   frames_nbr;
+    unsigned int     pcs_nbr;
     unsigned int     i;
 
-#if 1
-    frames_nbr = CaptureStackBackTrace(0, MAX_ENTRIES, frames, NULL);
+    if (max > EXM_STACK_FRAMES_MAX)
+        max = EXM_STACK_FRAMES_MAX;
+
+    frames_nbr = CaptureStackBackTrace(0, max, frames, NULL);
     if (frames_nbr == 0)
     {
         EXM_LOG_ERR("CaptureStackBackTrace failed with error %ld", GetLastError());
+        return 0;
     }
+
+    pcs_nbr = 0;
+    EXM_LOCK(&_exm_stack_lock);
+    for (i = 0; i < frames_nbr; i++)
+    {
+        Exm_Stack_Module *module;
+
+        module = _exm_stack_module_get(frames[i], i);
+        if (!module)
+            continue;
+
+        /* we substract 1 because (From Kai Tietz) : */
+        /* the back-trace address collected is the return-address of the call. */
+        /* So this location might be pointing already to next line.*/
+        pcs[pcs_nbr].module = exm_stack_module_id_get(module);
+        pcs[pcs_nbr].offset = (unsigned int)((char *)frames[i] - 1 -
+                                             (char *)exm_stack_module_base_get(module));
+        pcs_nbr++;
+    }
+    EXM_UNLOCK(&_exm_stack_lock);
+
+    return pcs_nbr;
 #else
+    const uintptr_t *fp;
+    unsigned int pcs_nbr;
+
+    if (max > EXM_STACK_FRAMES_MAX)
+        max = EXM_STACK_FRAMES_MAX;
+
+    if (_exm_stack_high == 0)
+        _exm_stack_bounds_get();
+
+    if (_exm_stack_hints_generation != EXM_ATOMIC_LOAD(&_exm_stack_generation))
     {
-        void **frame = NULL;
+        memset(_exm_stack_hints, 0, sizeof(_exm_stack_hints));
+        _exm_stack_hints_generation = EXM_ATOMIC_LOAD(&_exm_stack_generation);
+    }
 
-        i = 0;
-        __asm__ __volatile__ ("movl %%ebp, %0" : : "m" (frame) : "memory");
-        while(frame && i < MAX_ENTRIES)
-        {
-            frames[i++] = frame[1];
-            frame = (void **)frame[0];
-        }
-        frames_nbr = i;
+    fp = (const uintptr_t *)__builtin_frame_address(0);
+
+    pcs_nbr = 0;
+    while ((pcs_nbr < max) &&
+           ((uintptr_t)fp >= _exm_stack_low) &&
+           ((uintptr_t)(fp + 2) <= _exm_stack_high) &&
+           (((uintptr_t)fp & (sizeof(uintptr_t) - 1)) == 0))
+    {
+        const Exm_Stack_Hint *hint;
+        uintptr_t frame;
+
+        /* the saved frame pointer is followed by the return address */
+        frame = fp[1];
+        hint = _exm_stack_hint_get((const void *)frame, pcs_nbr);
+        if (!hint)
+            break;
+
+        /* the return address is after the call, see above */
+        pcs[pcs_nbr].module = hint->id;
+        pcs[pcs_nbr].offset = (unsigned int)(frame - 1 - hint->base);
+        pcs_nbr++;
+
+        /* the frames of the callers are higher in the stack */
+        if (fp[0] <= (uintptr_t)fp)
+            break;
+        fp = (const uintptr_t *)fp[0];
     }
+
+    return pcs_nbr;
 #endif
+}
 
-    data.list = NULL;
-    for (i = 0; i < frames_nbr; i++)
+EXM_API Exm_Stack_Symbolizer *
+exm_stack_symbolizer_new(void)
+{
+    return (Exm_Stack_Symbolizer *)calloc(1, sizeof(Exm_Stack_Symbolizer));
+}
+
+EXM_API void
+exm_stack_symbolizer_free(Exm_Stack_Symbolizer *symbolizer)
+{
+    unsigned int i;
+
+    if (!symbolizer)
+        return;
+
+    if (symbolizer->frames)
     {
-        TCHAR tpath[PATH_MAX];
-        MEMORY_BASIC_INFORMATION mbi;
-        bfd *fd;
-        asymbol **symbol_table;
-        char **formats = NULL;
-        unsigned int dummy = 0;
+        for (i = 0; i < symbolizer->frames_nbr; i++)
+            exm_stack_data_free(symbolizer->frames[i]);
+        free(symbolizer->frames);
+        symbolizer->frames = NULL;
+        symbolizer->frames_nbr = 0;
+    }
+    free(symbolizer->pcs);
+    free(symbolizer);
+}
 
-        /* Get the name and base address of the module */
+/*
+ * Queue the frames of a stack to be resolved by the next call to
+ * exm_stack_symbolizer_run(). Frames can be retrieved only for the
+ * stacks added before that call.
+ */
+EXM_API unsigned char
+exm_stack_symbolizer_add(Exm_Stack_Symbolizer *symbolizer,
+                         const Exm_Stack_Pc *pcs,
+                         unsigned int pcs_nbr)
+{
+    unsigned int i;
 
-        if (!VirtualQuery(frames[i], &mbi, sizeof(mbi)))
-        {
-            EXM_LOG_WARN("VirtualQuery failed on frame #%d (0x%p), skipping",
-                        i, frames[i]);
-            continue;
-        }
+    if (!symbolizer)
+        return 0;
 
-        if (mbi.State != MEM_COMMIT)
+    if (symbolizer->pcs_nbr + pcs_nbr > symbolizer->pcs_max)
+    {
+        unsigned long long *keys;
+        unsigned int max;
+
+        max = symbolizer->pcs_max ? 2 * symbolizer->pcs_max : 256;
+        while (max < symbolizer->pcs_nbr + pcs_nbr)
+            max *= 2;
+        keys = (unsigned long long *)realloc(symbolizer->pcs,
+                                             max * sizeof(unsigned long long));
+        if (!keys)
         {
-            EXM_LOG_WARN("Address 0x%p of frame #%d is not available, skipping",
-                        frames[i], i);
-            continue;
+            EXM_LOG_ERR("Can not allocate memory for the frames to symbolize");
+            return 0;
         }
 
-        if (!mbi.AllocationBase)
-        {
-            EXM_LOG_WARN("Address 0x%p of frame #%d is not available, skipping",
-                        frames[i], i);
+        symbolizer->pcs = keys;
+        symbolizer->pcs_max = max;
+    }
+
+    for (i = 0; i < pcs_nbr; i++)
+        symbolizer->pcs[symbolizer->pcs_nbr++] = _exm_stack_pc_key(pcs + i);
+
+    return 1;
+}
+
+/*
+ * Sort and deduplicate the queued frames, then resolve each distinct
+ * one, module after module.
+ */
+EXM_API void
+exm_stack_symbolizer_run(Exm_Stack_Symbolizer *symbolizer)
+{
+    unsigned int nbr;
+    unsigned int i;
+
+    if (!symbolizer || (symbolizer->pcs_nbr == 0))
+        return;
+
+    if (symbolizer->frames)
+    {
+        for (i = 0; i < symbolizer->frames_nbr; i++)
+            exm_stack_data_free(symbolizer->frames[i]);
+        free(symbolizer->frames);
+        symbolizer->frames = NULL;
+        symbolizer->frames_nbr = 0;
+    }
+
+    qsort(symbolizer->pcs, symbolizer->pcs_nbr, sizeof(unsigned long long),
+          _exm_stack_pc_key_cmp);
+
+    nbr = 1;
+    for (i = 1; i < symbolizer->pcs_nbr; i++)
+    {
+        if (symbolizer->pcs[i] != symbolizer->pcs[nbr - 1])
+            symbolizer->pcs[nbr++] = symbolizer->pcs[i];
+    }
+    symbolizer->pcs_nbr = nbr;
+
+    symbolizer->frames = (Exm_Stack_Data **)calloc(nbr, sizeof(Exm_Stack_Data *));
+    if (!symbolizer->frames)
+    {
+        EXM_LOG_ERR("Can not allocate memory for the symbolized frames");
+        return;
+    }
+    symbolizer->frames_nbr = nbr;
+
+    EXM_LOCK(&_exm_stack_lock);
+    for (i = 0; i < nbr; i++)
+    {
+        Exm_Stack_Module *module;
+        const char *file;
+        const char *func;
+        unsigned int line;
+
+        module = exm_stack_module_cache_get((unsigned int)(symbolizer->pcs[i] >> 32));
+        if (!module)
             continue;
-        }
 
-        if (!GetModuleFileName(mbi.AllocationBase, (LPTSTR)&tpath, PATH_MAX))
-        {
-            EXM_LOG_WARN("Can not retrieve the file name of the module for frame #%d, skipping",
-                        i);
+        if (!exm_stack_module_frame_find(module,
+                                         symbolizer->pcs[i] & 0xffffffff,
+                                         &file, &func, &line))
             continue;
-        }
 
-        EXM_LOG_DBG("Frame #%d in module %s", i, tpath);
+        symbolizer->frames[i] = _exm_stack_data_new(file ? file : "???", func, line);
+    }
+    EXM_UNLOCK(&_exm_stack_lock);
 
-        /* set up bfd data for the module found above */
+    EXM_LOG_DBG("%u distinct frames symbolized", nbr);
+}
 
-        fd = bfd_openr(tpath, NULL);
-        if (!fd)
-        {
-            EXM_LOG_WARN("Can not open file descriptor for frame #%d, skipping",
-                        i);
-            continue;
-        }
+/*
+ * Return the list of the resolved frames of a stack previously added
+ * to @p symbolizer. The list must be freed with exm_list_free() and
+ * exm_stack_data_free().
+ */
+EXM_API Exm_List *
+exm_stack_symbolizer_frames_get(const Exm_Stack_Symbolizer *symbolizer,
+                                const Exm_Stack_Pc *pcs,
+                                unsigned int pcs_nbr)
+{
+    Exm_List *list;
+    unsigned int i;
 
-        if (!bfd_check_format(fd, bfd_object))
-        {
-            EXM_LOG_ERR("bfd_check_format failed: %s",
-                        bfd_errmsg(bfd_get_error()));
-            goto close_fd;
-        }
+    if (!symbolizer || !symbolizer->frames)
+        return NULL;
 
-        if (!bfd_check_format_matches(fd, bfd_object, &formats))
-            goto close_fd;
+    list = NULL;
+    for (i = 0; i < pcs_nbr; i++)
+    {
+        const Exm_Stack_Data *frame;
+        Exm_Stack_Data *sw_data;
+        unsigned long long *key;
+        unsigned long long k;
+
+        k = _exm_stack_pc_key(pcs + i);
+        key = (unsigned long long *)bsearch(&k, symbolizer->pcs, symbolizer->frames_nbr,
+                                            sizeof(unsigned long long),
+                                            _exm_stack_pc_key_cmp);
+        if (!key)
+            continue;
 
-        if (!(bfd_get_file_flags(fd) & HAS_SYMS))
-        {
-            free(formats);
-            goto close_fd;
-        }
+        frame = symbolizer->frames[key - symbolizer->pcs];
+        if (!frame)
+            continue;
 
-        free(formats);
+        sw_data = _exm_stack_data_new(frame->filename, frame->function, frame->line);
+        if (sw_data)
+            list = exm_list_append(list, sw_data);
+    }
 
-        if ((bfd_read_minisymbols(fd, FALSE, (void **)&symbol_table, &dummy) == 0) &&
-            (bfd_read_minisymbols(fd, TRUE, (void **)&symbol_table, &dummy) < 0))
-            goto free_symbol_table;
+    return list;
+}
+
+/*
+ * Return the function of a frame of a stack previously added to
+ * @p symbolizer, NULL if it is not resolved, and the file name of its
+ * module, NULL if it is not known. The strings belong to the
+ * symbolizer and to the module cache.
+ */
+EXM_API void
+exm_stack_symbolizer_frame_get(const Exm_Stack_Symbolizer *symbolizer,
+                               const Exm_Stack_Pc *pc,
+                               const char **function,
+                               const char **object)
+{
+    Exm_Stack_Module *module;
+    unsigned long long *key;
+    unsigned long long k;
 
-        EXM_LOG_DBG("bfd set up for frame #%d", i);
+    *function = NULL;
+    *object = NULL;
 
-        data.function = NULL;
-        data.symbol_table = symbol_table;
-        /* we substract 1 because (From Kai Tietz) : */
-        /* the back-trace address collected is the return-address of the call. */
-        /* So this location might be pointing already to next line.*/
-        data.counter = (bfd_vma)(uintptr_t)((char *)frames[i] - 1);
-        bfd_map_over_sections(fd,
-                              &_exm_stack_find_function_name_in_section,
-                              &data);
-
-      free_symbol_table:
-        free(symbol_table);
-      close_fd:
-        bfd_close(fd);
+    if (symbolizer && symbolizer->frames)
+    {
+        k = _exm_stack_pc_key(pc);
+        key = (unsigned long long *)bsearch(&k, symbolizer->pcs, symbolizer->frames_nbr,
+                                            sizeof(unsigned long long),
+                                            _exm_stack_pc_key_cmp);
+        if (key && symbolizer->frames[key - symbolizer->pcs])
+            *function = symbolizer->frames[key - symbolizer->pcs]->function;
     }
 
-    return data.list;
+    EXM_LOCK(&_exm_stack_lock);
+    module = exm_stack_module_cache_get(pc->module);
+    if (module)
+        *object = exm_stack_module_filename_get(module);
+    EXM_UNLOCK(&_exm_stack_lock);
 }
 
 EXM_API const char *
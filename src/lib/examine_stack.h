@@ -25,11 +25,33 @@
 
 typedef struct _Exm_Stack_Data Exm_Stack_Data;
 
+typedef struct _Exm_Stack_Symbolizer Exm_Stack_Symbolizer;
+
+/*
+ * Return address of a frame, relative to the module that contains it.
+ * Capturing a stack only fills an array of these, the function names,
+ * file names and lines are resolved later by a symbolizer.
+ */
+typedef struct
+{
+    unsigned int module; /* module id */
+    unsigned int offset; /* offset in the module */
+} Exm_Stack_Pc;
+
 EXM_API unsigned char exm_stack_init(void);
 EXM_API void exm_stack_shutdown(void);
 
 EXM_API Exm_List *exm_stack_frames_get(void);
 
+EXM_API unsigned int exm_stack_capture(Exm_Stack_Pc *pcs, unsigned int max);
+
+EXM_API Exm_Stack_Symbolizer *exm_stack_symbolizer_new(void);
+EXM_API void exm_stack_symbolizer_free(Exm_Stack_Symbolizer *symbolizer);
+EXM_API unsigned char exm_stack_symbolizer_add(Exm_Stack_Symbolizer *symbolizer, const Exm_Stack_Pc *pcs, unsigned int pcs_nbr);
+EXM_API void exm_stack_symbolizer_run(Exm_Stack_Symbolizer *symbolizer);
+EXM_API Exm_List *exm_stack_symbolizer_frames_get(const Exm_Stack_Symbolizer *symbolizer, const Exm_Stack_Pc *pcs, unsigned int pcs_nbr);
+EXM_API void exm_stack_symbolizer_frame_get(const Exm_Stack_Symbolizer *symbolizer, const Exm_Stack_Pc *pc, const char **function, const char **object);
+
 EXM_API const char *exm_stack_data_filename_get(const Exm_Stack_Data *data);
 EXM_API const char *exm_stack_data_function_get(const Exm_Stack_Data *data);
 EXM_API unsigned int exm_stack_data_line_get(const Exm_Stack_Data *data);
@@ -0,0 +1,469 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+# ifndef WIN32_LEAN_AND_MEAN
+#  define WIN32_LEAN_AND_MEAN
+# endif
+# include <windows.h>
+# undef WIN32_LEAN_AND_MEAN
+#endif
+
+#include "Examine.h"
+#include "examine_private_thread.h"
+
+
+/**
+ * @defgroup Stack depot functions
+ *
+ * A stack depot stores each distinct stack once and identifies it by
+ * a 32 bits id. The stacks are hashed and looked up in an open
+ * addressing table, and copied in an append-only arena, so that an
+ * id stays valid, and its frames at the same address, until the depot
+ * is freed. The depot is locked, so that all the threads of a
+ * process can store their stacks in the same depot.
+ *
+ * As the allocations are mostly made from a few call sites, each
+ * thread remembers the records of its last stacks, which are found
+ * again without taking the lock.
+ *
+ * @{
+ */
+
+
+/*============================================================================*
+ *                                  Local                                     *
+ *============================================================================*/
+
+
+#define EXM_STACK_DEPOT_CHUNK_SIZE (64 * 1024)
+#define EXM_STACK_DEPOT_MEMO_SIZE 64 /* power of 2 */
+
+typedef struct _Exm_Stack_Depot_Chunk Exm_Stack_Depot_Chunk;
+
+struct _Exm_Stack_Depot_Chunk
+{
+    Exm_Stack_Depot_Chunk *next;
+    size_t size;
+    size_t used;
+};
+
+typedef struct
+{
+    unsigned int hash;
+    unsigned int pcs_nbr;
+    Exm_Stack_Pc pcs[];
+} Exm_Stack_Depot_Record;
+
+struct _Exm_Stack_Depot
+{
+    Exm_Lock lock;
+    Exm_Stack_Depot_Chunk *chunks; /* the current chunk is the first one */
+    Exm_Stack_Depot_Record **records; /* record of id i at index i - 1 */
+    unsigned int records_nbr;
+    unsigned int records_max;
+    unsigned int *table; /* ids, 0 for an empty slot */
+    unsigned int table_size; /* power of 2 */
+    unsigned int id;
+    size_t chunks_size;
+};
+
+typedef struct
+{
+    const Exm_Stack_Depot_Record *record; /* never modified once stored */
+    unsigned int id;
+} Exm_Stack_Depot_Memo;
+
+static unsigned int _exm_stack_depot_ids = 0;
+
+/* the last stacks of the thread, valid if their id is the one of the depot */
+static EXM_TLS Exm_Stack_Depot_Memo _exm_stack_depot_memo[EXM_STACK_DEPOT_MEMO_SIZE];
+static EXM_TLS unsigned int _exm_stack_depot_memo_id = 0;
+
+static unsigned int
+_exm_stack_depot_hash(const Exm_Stack_Pc *pcs, unsigned int pcs_nbr)
+{
+    unsigned int h;
+    unsigned int i;
+
+    /* FNV-1a on the 32 bits words, with a final avalanche */
+    h = 2166136261u ^ pcs_nbr;
+    for (i = 0; i < pcs_nbr; i++)
+    {
+        h = (h ^ pcs[i].offset) * 16777619u;
+        h = (h ^ pcs[i].module) * 16777619u;
+    }
+
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+
+    return h;
+}
+
+static Exm_Stack_Depot_Record *
+_exm_stack_depot_record_new(Exm_Stack_Depot *depot, unsigned int pcs_nbr)
+{
+    Exm_Stack_Depot_Chunk *chunk;
+    Exm_Stack_Depot_Record *record;
+    size_t size;
+
+    size = sizeof(Exm_Stack_Depot_Record) + pcs_nbr * sizeof(Exm_Stack_Pc);
+
+    chunk = depot->chunks;
+    if (!chunk || (chunk->size - chunk->used < size))
+    {
+        size_t chunk_size;
+
+        chunk_size = EXM_STACK_DEPOT_CHUNK_SIZE;
+        if (chunk_size < sizeof(Exm_Stack_Depot_Chunk) + size)
+            chunk_size = sizeof(Exm_Stack_Depot_Chunk) + size;
+
+        chunk = (Exm_Stack_Depot_Chunk *)malloc(chunk_size);
+        if (!chunk)
+            return NULL;
+
+        chunk->next = depot->chunks;
+        chunk->size = chunk_size;
+        chunk->used = sizeof(Exm_Stack_Depot_Chunk);
+        depot->chunks = chunk;
+        depot->chunks_size += chunk_size;
+    }
+
+    record = (Exm_Stack_Depot_Record *)((unsigned char *)chunk + chunk->used);
+    chunk->used += size;
+
+    return record;
+}
+
+static unsigned char
+_exm_stack_depot_table_grow(Exm_Stack_Depot *depot)
+{
+    unsigned int *table;
+    unsigned int size;
+    unsigned int i;
+
+    size = depot->table_size ? 2 * depot->table_size : 1024;
+    table = (unsigned int *)calloc(size, sizeof(unsigned int));
+    if (!table)
+        return 0;
+
+    for (i = 0; i < depot->records_nbr; i++)
+    {
+        unsigned int idx;
+
+        idx = depot->records[i]->hash & (size - 1);
+        while (table[idx])
+            idx = (idx + 1) & (size - 1);
+        table[idx] = i + 1;
+    }
+
+    free(depot->table);
+    depot->table = table;
+    depot->table_size = size;
+
+    return 1;
+}
+
+
+/*============================================================================*
+ *                                 Global                                     *
+ *============================================================================*/
+
+
+/*============================================================================*
+ *                                   API                                      *
+ *============================================================================*/
+
+
+/**
+ * @brief Return a new empty stack depot.
+ *
+ * @return The new depot, or @c NULL on memory error.
+ *
+ * The depot must be freed with exm_stack_depot_free().
+ */
+EXM_API Exm_Stack_Depot *
+exm_stack_depot_new(void)
+{
+    Exm_Stack_Depot *depot;
+
+    depot = (Exm_Stack_Depot *)calloc(1, sizeof(Exm_Stack_Depot));
+    if (!depot)
+        return NULL;
+
+    if (!_exm_stack_depot_table_grow(depot))
+    {
+        free(depot);
+        return NULL;
+    }
+
+    if (!EXM_LOCK_INIT(&depot->lock))
+    {
+        free(depot->table);
+        free(depot);
+        return NULL;
+    }
+
+    /* 0 is the id of no depot in the threads */
+    do
+    {
+        depot->id = EXM_ATOMIC_ADD(&_exm_stack_depot_ids, 1) + 1;
+    } while (depot->id == 0);
+
+    return depot;
+}
+
+/**
+ * @brief Free the given stack depot.
+ *
+ * @param[inout] depot The depot.
+ *
+ * This function frees @p depot and all its stacks. The ids returned
+ * by exm_stack_depot_put() are not valid anymore. If @p depot is
+ * @c NULL, this function does nothing.
+ */
+EXM_API void
+exm_stack_depot_free(Exm_Stack_Depot *depot)
+{
+    Exm_Stack_Depot_Chunk *chunk;
+
+    if (!depot)
+        return;
+
+    chunk = depot->chunks;
+    while (chunk)
+    {
+        Exm_Stack_Depot_Chunk *next;
+
+        next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+
+    if (_exm_stack_depot_memo_id == depot->id)
+        _exm_stack_depot_memo_id = 0;
+
+    EXM_LOCK_SHUTDOWN(&depot->lock);
+    free(depot->records);
+    free(depot->table);
+    free(depot);
+}
+
+/**
+ * @brief Store a stack in the given depot.
+ *
+ * @param[inout] depot The depot.
+ * @param[in] pcs The frames of the stack.
+ * @param[in] pcs_nbr The number of frames.
+ * @return The id of the stack, or 0 on error.
+ *
+ * This function returns the id of the stack made of the @p pcs_nbr
+ * frames @p pcs. If the same stack has already been stored in
+ * @p depot, its id is returned, otherwise the frames are copied and
+ * a new id is returned. Ids start at 1. If @p pcs_nbr is 0, or on
+ * memory error, 0 is returned.
+ */
+EXM_API unsigned int
+exm_stack_depot_put(Exm_Stack_Depot *depot, const Exm_Stack_Pc *pcs, unsigned int pcs_nbr)
+{
+    Exm_Stack_Depot_Memo *memo;
+    Exm_Stack_Depot_Record *record;
+    unsigned int hash;
+    unsigned int idx;
+    unsigned int id = 0;
+
+    if (!depot || !pcs || (pcs_nbr == 0))
+        return 0;
+
+    hash = _exm_stack_depot_hash(pcs, pcs_nbr);
+
+    if (_exm_stack_depot_memo_id != depot->id)
+    {
+        memset(_exm_stack_depot_memo, 0, sizeof(_exm_stack_depot_memo));
+        _exm_stack_depot_memo_id = depot->id;
+    }
+
+    memo = _exm_stack_depot_memo + (hash & (EXM_STACK_DEPOT_MEMO_SIZE - 1));
+    if (memo->record &&
+        (memo->record->hash == hash) &&
+        (memo->record->pcs_nbr == pcs_nbr) &&
+        (memcmp(memo->record->pcs, pcs, pcs_nbr * sizeof(Exm_Stack_Pc)) == 0))
+        return memo->id;
+
+    EXM_LOCK(&depot->lock);
+    idx = hash & (depot->table_size - 1);
+    while (depot->table[idx])
+    {
+        record = depot->records[depot->table[idx] - 1];
+        if ((record->hash == hash) &&
+            (record->pcs_nbr == pcs_nbr) &&
+            (memcmp(record->pcs, pcs, pcs_nbr * sizeof(Exm_Stack_Pc)) == 0))
+        {
+            id = depot->table[idx];
+            goto memo;
+        }
+        idx = (idx + 1) & (depot->table_size - 1);
+    }
+
+    /* new stack, keep the load factor of the table below 1/2 */
+
+    if (depot->records_nbr == depot->records_max)
+    {
+        Exm_Stack_Depot_Record **records;
+        unsigned int max;
+
+        max = depot->records_max ? 2 * depot->records_max : 256;
+        records = (Exm_Stack_Depot_Record **)realloc(depot->records,
+                                                     max * sizeof(Exm_Stack_Depot_Record *));
+        if (!records)
+            goto unlock;
+
+        depot->records = records;
+        depot->records_max = max;
+    }
+
+    if (2 * (depot->records_nbr + 1) > depot->table_size)
+    {
+        if (!_exm_stack_depot_table_grow(depot))
+            goto unlock;
+
+        idx = hash & (depot->table_size - 1);
+        while (depot->table[idx])
+            idx = (idx + 1) & (depot->table_size - 1);
+    }
+
+    record = _exm_stack_depot_record_new(depot, pcs_nbr);
+    if (!record)
+        goto unlock;
+
+    record->hash = hash;
+    record->pcs_nbr = pcs_nbr;
+    memcpy(record->pcs, pcs, pcs_nbr * sizeof(Exm_Stack_Pc));
+
+    depot->records[depot->records_nbr++] = record;
+    depot->table[idx] = depot->records_nbr;
+    id = depot->records_nbr;
+
+  memo:
+    memo->record = record;
+    memo->id = id;
+  unlock:
+    EXM_UNLOCK(&depot->lock);
+
+    return id;
+}
+
+/**
+ * @brief Return the frames of a stack stored in the given depot.
+ *
+ * @param[in] depot The depot.
+ * @param[in] id The id of the stack.
+ * @param[out] pcs_nbr The number of frames.
+ * @return The frames of the stack.
+ *
+ * This function returns the frames of the stack of id @p id and
+ * stores their number in @p pcs_nbr. The frames belong to @p depot.
+ * If @p id is not a valid id, @c NULL is returned and @p pcs_nbr is
+ * set to 0.
+ */
+EXM_API const Exm_Stack_Pc *
+exm_stack_depot_get(const Exm_Stack_Depot *depot, unsigned int id, unsigned int *pcs_nbr)
+{
+    const Exm_Stack_Depot_Record *record = NULL;
+
+    if (depot && (id != 0))
+    {
+        /* the frames do not move, but the array of records can */
+        EXM_LOCK((Exm_Lock *)&depot->lock);
+        if (id <= depot->records_nbr)
+            record = depot->records[id - 1];
+        EXM_UNLOCK((Exm_Lock *)&depot->lock);
+    }
+
+    if (!record)
+    {
+        if (pcs_nbr) *pcs_nbr = 0;
+        return NULL;
+    }
+
+    if (pcs_nbr) *pcs_nbr = record->pcs_nbr;
+
+    return record->pcs;
+}
+
+/**
+ * @brief Return the number of stacks of the given depot.
+ *
+ * @param[in] depot The depot.
+ * @return The number of distinct stacks.
+ */
+EXM_API unsigned int
+exm_stack_depot_count(const Exm_Stack_Depot *depot)
+{
+    unsigned int count;
+
+    if (!depot)
+        return 0;
+
+    EXM_LOCK((Exm_Lock *)&depot->lock);
+    count = depot->records_nbr;
+    EXM_UNLOCK((Exm_Lock *)&depot->lock);
+
+    return count;
+}
+
+/**
+ * @brief Return the memory used by the given depot.
+ *
+ * @param[in] depot The depot.
+ * @return The size in bytes of the memory allocated by @p depot.
+ */
+EXM_API size_t
+exm_stack_depot_memory_get(const Exm_Stack_Depot *depot)
+{
+    size_t size;
+
+    if (!depot)
+        return 0;
+
+    EXM_LOCK((Exm_Lock *)&depot->lock);
+    size = sizeof(Exm_Stack_Depot) +
+        depot->chunks_size +
+        depot->records_max * sizeof(Exm_Stack_Depot_Record *) +
+        depot->table_size * sizeof(unsigned int);
+    EXM_UNLOCK((Exm_Lock *)&depot->lock);
+
+    return size;
+}
+
+/**
+ * @}
+ */
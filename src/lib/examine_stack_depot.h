@@ -0,0 +1,43 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXAMINE_STACK_DEPOT_H
+#define EXAMINE_STACK_DEPOT_H
+
+#include <stddef.h>
+
+
+typedef struct _Exm_Stack_Depot Exm_Stack_Depot;
+
+EXM_API Exm_Stack_Depot *exm_stack_depot_new(void);
+
+EXM_API void exm_stack_depot_free(Exm_Stack_Depot *depot);
+
+EXM_API unsigned int exm_stack_depot_put(Exm_Stack_Depot *depot, const Exm_Stack_Pc *pcs, unsigned int pcs_nbr);
+
+EXM_API const Exm_Stack_Pc *exm_stack_depot_get(const Exm_Stack_Depot *depot, unsigned int id, unsigned int *pcs_nbr);
+
+EXM_API unsigned int exm_stack_depot_count(const Exm_Stack_Depot *depot);
+
+EXM_API size_t exm_stack_depot_memory_get(const Exm_Stack_Depot *depot);
+
+
+#endif /* EXAMINE_STACK_DEPOT_H */
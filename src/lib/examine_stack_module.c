@@ -0,0 +1,926 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef _WIN32
+# include <sys/types.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <link.h>
+#endif
+
+#ifdef HAVE_BFD
+# include <bfd.h>
+#endif
+
+#include "Examine.h"
+
+#include "examine_private_coff.h"
+#include "examine_private_dwarf.h"
+#include "examine_private_pdb.h"
+#include "examine_private_symbol_cache.h"
+#include "examine_private_stack.h"
+
+
+/*============================================================================*
+ *                                  Local                                     *
+ *============================================================================*/
+
+
+#ifdef HAVE_BFD
+
+typedef struct
+{
+    bfd_vma vma;
+    bfd_size_type size;
+    asection *sec;
+} Exm_Stack_Section;
+
+#endif
+
+struct _Exm_Stack_Module
+{
+    char *filename;
+    const void *base;
+    size_t size;
+    unsigned int id;
+    unsigned int opened : 1;
+    Exm_Symbol_Index *index; /* addresses relative to the base */
+    unsigned long long image_base; /* preferred base address of a PE file, lowest segment address of an ELF file */
+#ifdef HAVE_BFD
+    bfd *abfd;
+    asymbol **symbol_table;
+    Exm_Stack_Section *sections;
+    unsigned int sections_nbr;
+#endif
+};
+
+/* modules sorted by base address */
+static Exm_Stack_Module **_exm_stack_modules = NULL;
+/* modules sorted by id, that is in the order they were added */
+static Exm_Stack_Module **_exm_stack_modules_by_id = NULL;
+static unsigned int _exm_stack_modules_nbr = 0;
+static unsigned int _exm_stack_modules_max = 0;
+
+#ifdef HAVE_BFD
+
+static void
+_exm_stack_module_section_add(bfd *abfd EXM_UNUSED, asection *sec, void *obj)
+{
+    Exm_Stack_Module *module;
+    Exm_Stack_Section *sections;
+
+    module = (Exm_Stack_Module *)obj;
+
+    if (!(EXM_BFD_SECTION_FLAGS(abfd, sec) & SEC_ALLOC))
+        return;
+
+    if (EXM_BFD_SECTION_FLAGS(abfd, sec) & SEC_THREAD_LOCAL)
+        return;
+
+    if (EXM_BFD_SECTION_SIZE(abfd, sec) == 0)
+        return;
+
+    sections = (Exm_Stack_Section *)realloc(module->sections,
+                                            (module->sections_nbr + 1) * sizeof(Exm_Stack_Section));
+    if (!sections)
+        return;
+
+    module->sections = sections;
+    module->sections[module->sections_nbr].vma = EXM_BFD_SECTION_VMA(abfd, sec);
+    module->sections[module->sections_nbr].size = EXM_BFD_SECTION_SIZE(abfd, sec);
+    module->sections[module->sections_nbr].sec = sec;
+    module->sections_nbr++;
+}
+
+static int
+_exm_stack_module_section_cmp(const void *p1, const void *p2)
+{
+    const Exm_Stack_Section *s1;
+    const Exm_Stack_Section *s2;
+
+    s1 = (const Exm_Stack_Section *)p1;
+    s2 = (const Exm_Stack_Section *)p2;
+
+    if (s1->vma < s2->vma)
+        return -1;
+    if (s1->vma > s2->vma)
+        return 1;
+    return 0;
+}
+
+static const Exm_Stack_Section *
+_exm_stack_module_section_find(const Exm_Stack_Module *module, bfd_vma vma)
+{
+    unsigned int lo;
+    unsigned int hi;
+
+    lo = 0;
+    hi = module->sections_nbr;
+    while (lo < hi)
+    {
+        unsigned int mid;
+
+        mid = lo + (hi - lo) / 2;
+        if (vma < module->sections[mid].vma)
+            hi = mid;
+        else if (vma >= module->sections[mid].vma + module->sections[mid].size)
+            lo = mid + 1;
+        else
+            return module->sections + mid;
+    }
+
+    return NULL;
+}
+
+#endif
+
+/* index of the first module whose base is greater than base */
+static unsigned int
+_exm_stack_module_cache_upper(const void *base)
+{
+    unsigned int lo;
+    unsigned int hi;
+
+    lo = 0;
+    hi = _exm_stack_modules_nbr;
+    while (lo < hi)
+    {
+        unsigned int mid;
+
+        mid = lo + (hi - lo) / 2;
+        if ((uintptr_t)base < (uintptr_t)_exm_stack_modules[mid]->base)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    return lo;
+}
+
+/*
+ * Build the symbol index of the module from the DWARF sections of
+ * the PE file, read in place in its mapping, from its PDB file if it
+ * has no DWARF, or from its COFF symbol table, which only gives the
+ * functions, if it has none of them. If the symbol cache is used, the index is mapped
+ * from it when the module is there, and saved in it otherwise.
+ * Return 0 if the file is not a PE file or has no debug information.
+ */
+static unsigned char
+_exm_stack_module_pe_open(Exm_Stack_Module *module)
+{
+    char key[EXM_SYMBOL_CACHE_KEY_SIZE];
+    Exm_Dwarf_Sections sections;
+    Exm_Pdb *pdb = NULL;
+    Exm_Pe *pe;
+    const char *cache_dir;
+    const char *kind;
+
+    pe = exm_pe_new(module->filename);
+    if (!pe)
+        return 0;
+
+    module->image_base = exm_pe_image_base_get(pe);
+
+    cache_dir = exm_symbol_cache_dir_get();
+    if (cache_dir)
+    {
+        exm_symbol_cache_key_get(pe, key);
+        module->index = exm_symbol_cache_get(cache_dir, key);
+        if (module->index)
+        {
+            exm_pe_free(pe);
+            return 1;
+        }
+    }
+
+    if (exm_dwarf_sections_get(pe, &sections))
+        kind = "DWARF";
+    else
+    {
+        pdb = exm_pdb_find(pe);
+        if (pdb)
+            kind = "PDB";
+        else if (exm_pe_coff_symbol_first_get(pe))
+            kind = "COFF";
+        else
+            goto free_pe;
+    }
+
+    module->index = exm_symbol_index_new();
+    if (!module->index)
+        goto free_pdb;
+
+    if (pdb)
+    {
+        exm_pdb_index_add(pdb, pe, module->index);
+        exm_pdb_free(pdb);
+    }
+    else if (sections.info.data || sections.line.data)
+        exm_dwarf_index_add(&sections, module->image_base, module->index);
+    else
+        exm_coff_index_add(pe, module->index);
+    exm_pe_free(pe);
+
+    if (!exm_symbol_index_build(module->index) ||
+        (exm_symbol_index_count(module->index) == 0))
+    {
+        exm_symbol_index_free(module->index);
+        module->index = NULL;
+        return 0;
+    }
+
+    EXM_LOG_DBG("%s symbol index of module %s: %u rows, %lu bytes",
+                kind, module->filename,
+                exm_symbol_index_count(module->index),
+                (unsigned long)exm_symbol_index_memory_get(module->index));
+
+    if (cache_dir)
+        exm_symbol_cache_set(cache_dir, key, module->index);
+
+    return 1;
+
+  free_pdb:
+    exm_pdb_free(pdb);
+  free_pe:
+    exm_pe_free(pe);
+
+    return 0;
+}
+
+#ifndef _WIN32
+
+typedef struct
+{
+    const char *name;
+    size_t offset; /* offset of the section in Exm_Dwarf_Sections */
+} Exm_Stack_Elf_Dwarf;
+
+static const Exm_Stack_Elf_Dwarf _exm_stack_elf_dwarf[] =
+{
+    { ".debug_line", offsetof(Exm_Dwarf_Sections, line) },
+    { ".debug_line_str", offsetof(Exm_Dwarf_Sections, line_str) },
+    { ".debug_str", offsetof(Exm_Dwarf_Sections, str) },
+    { ".debug_info", offsetof(Exm_Dwarf_Sections, info) },
+    { ".debug_abbrev", offsetof(Exm_Dwarf_Sections, abbrev) },
+    { ".debug_aranges", offsetof(Exm_Dwarf_Sections, aranges) },
+    { ".debug_addr", offsetof(Exm_Dwarf_Sections, addr) },
+    { ".debug_str_offsets", offsetof(Exm_Dwarf_Sections, str_offsets) },
+    { ".debug_ranges", offsetof(Exm_Dwarf_Sections, ranges) },
+    { ".debug_rnglists", offsetof(Exm_Dwarf_Sections, rnglists) }
+};
+
+/* return 1 if the section is inside the file, without overflow */
+static unsigned char
+_exm_stack_module_elf_section_valid(const ElfW(Shdr) *shdr, size_t size)
+{
+    return (shdr->sh_offset <= size) && (shdr->sh_size <= size - shdr->sh_offset);
+}
+
+/* return 1 if the section is a string table ending with a nul byte */
+static unsigned char
+_exm_stack_module_elf_strtab_valid(const unsigned char *data, size_t size, const ElfW(Shdr) *shdr)
+{
+    return _exm_stack_module_elf_section_valid(shdr, size) &&
+           (shdr->sh_size > 0) &&
+           (data[shdr->sh_offset + shdr->sh_size - 1] == '\0');
+}
+
+/* add the functions of a symbol table of an ELF file to the index */
+static void
+_exm_stack_module_elf_symbols_add(Exm_Stack_Module *module,
+                                  const unsigned char *data,
+                                  size_t size,
+                                  const ElfW(Shdr) *shdrs,
+                                  unsigned int shdrs_nbr,
+                                  const ElfW(Shdr) *symtab)
+{
+    const ElfW(Shdr) *strtab;
+    const ElfW(Sym) *syms;
+    size_t nbr;
+    size_t i;
+
+    if (symtab->sh_link >= shdrs_nbr)
+        return;
+
+    strtab = shdrs + symtab->sh_link;
+    if (!_exm_stack_module_elf_section_valid(symtab, size) ||
+        !_exm_stack_module_elf_strtab_valid(data, size, strtab))
+        return;
+
+    syms = (const ElfW(Sym) *)(data + symtab->sh_offset);
+    nbr = symtab->sh_size / sizeof(ElfW(Sym));
+    for (i = 0; i < nbr; i++)
+    {
+        unsigned long long start;
+        unsigned long long end;
+
+        if ((ELF64_ST_TYPE(syms[i].st_info) != STT_FUNC) ||
+            (syms[i].st_shndx == SHN_UNDEF) ||
+            (syms[i].st_size == 0) ||
+            (syms[i].st_name >= strtab->sh_size))
+            continue;
+
+        start = syms[i].st_value;
+        end = start + syms[i].st_size;
+        if ((start < module->image_base) ||
+            (end - module->image_base > 0xffffffff))
+            continue;
+
+        exm_symbol_index_function_add(module->index,
+                                      (unsigned int)(start - module->image_base),
+                                      (unsigned int)(end - module->image_base),
+                                      (const char *)data + strtab->sh_offset + syms[i].st_name);
+    }
+}
+
+/*
+ * Build the symbol index of the module from the DWARF sections of
+ * the ELF file, read in place in its mapping, or from its symbol
+ * table, or its dynamic one, which only give the functions, if it has
+ * no DWARF. Return 0 if the file is not an ELF file of the process
+ * class, so that the other formats are tried.
+ */
+static unsigned char
+_exm_stack_module_elf_open(Exm_Stack_Module *module)
+{
+    Exm_Dwarf_Sections sections;
+    struct stat st;
+    const ElfW(Ehdr) *ehdr;
+    const ElfW(Phdr) *phdrs;
+    const ElfW(Shdr) *shdrs;
+    const ElfW(Shdr) *symtab = NULL;
+    const ElfW(Shdr) *dynsym = NULL;
+    const char *shstrtab;
+    unsigned char *data;
+    const char *kind;
+    unsigned int i;
+    int fd;
+
+    fd = open(module->filename, O_RDONLY);
+    if (fd == -1)
+        return 0;
+
+    if ((fstat(fd, &st) == -1) || ((size_t)st.st_size < sizeof(ElfW(Ehdr))))
+    {
+        close(fd);
+        return 0;
+    }
+
+    data = (unsigned char *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return 0;
+
+    ehdr = (const ElfW(Ehdr) *)data;
+    if ((memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0) ||
+        (ehdr->e_ident[EI_CLASS] != ((sizeof(void *) == 8) ? ELFCLASS64 : ELFCLASS32)))
+    {
+        munmap(data, st.st_size);
+        return 0;
+    }
+
+    /* from here, the file is an ELF file and no other format is tried */
+
+    if ((ehdr->e_phoff > (size_t)st.st_size) ||
+        (ehdr->e_phnum > ((size_t)st.st_size - ehdr->e_phoff) / sizeof(ElfW(Phdr))) ||
+        (ehdr->e_shoff > (size_t)st.st_size) ||
+        (ehdr->e_shnum > ((size_t)st.st_size - ehdr->e_shoff) / sizeof(ElfW(Shdr))) ||
+        (ehdr->e_shstrndx >= ehdr->e_shnum))
+    {
+        EXM_LOG_WARN("Malformed ELF file %s", module->filename);
+        goto unmap;
+    }
+
+    phdrs = (const ElfW(Phdr) *)(data + ehdr->e_phoff);
+    module->image_base = (unsigned long long)-1;
+    for (i = 0; i < ehdr->e_phnum; i++)
+    {
+        if ((phdrs[i].p_type == PT_LOAD) && (phdrs[i].p_vaddr < module->image_base))
+            module->image_base = phdrs[i].p_vaddr;
+    }
+    if (module->image_base == (unsigned long long)-1)
+        goto unmap;
+
+    shdrs = (const ElfW(Shdr) *)(data + ehdr->e_shoff);
+    if (!_exm_stack_module_elf_strtab_valid(data, st.st_size, shdrs + ehdr->e_shstrndx))
+        goto unmap;
+    shstrtab = (const char *)data + shdrs[ehdr->e_shstrndx].sh_offset;
+
+    memset(&sections, 0, sizeof(Exm_Dwarf_Sections));
+    for (i = 0; i < ehdr->e_shnum; i++)
+    {
+        const char *name;
+        unsigned int j;
+
+        if (shdrs[i].sh_type == SHT_SYMTAB)
+            symtab = shdrs + i;
+        else if (shdrs[i].sh_type == SHT_DYNSYM)
+            dynsym = shdrs + i;
+
+        /* the compressed sections are not supported */
+        if ((shdrs[i].sh_type != SHT_PROGBITS) ||
+            (shdrs[i].sh_flags & SHF_COMPRESSED) ||
+            (shdrs[i].sh_name >= shdrs[ehdr->e_shstrndx].sh_size) ||
+            !_exm_stack_module_elf_section_valid(shdrs + i, st.st_size))
+            continue;
+
+        name = shstrtab + shdrs[i].sh_name;
+        for (j = 0; j < sizeof(_exm_stack_elf_dwarf) / sizeof(_exm_stack_elf_dwarf[0]); j++)
+        {
+            Exm_Dwarf_Section *section;
+
+            if (strcmp(name, _exm_stack_elf_dwarf[j].name) != 0)
+                continue;
+
+            section = (Exm_Dwarf_Section *)((unsigned char *)&sections +
+                                            _exm_stack_elf_dwarf[j].offset);
+            section->data = data + shdrs[i].sh_offset;
+            section->size = shdrs[i].sh_size;
+            break;
+        }
+    }
+
+    module->index = exm_symbol_index_new();
+    if (!module->index)
+        goto unmap;
+
+    if (sections.info.data || sections.line.data)
+    {
+        kind = "DWARF";
+        exm_dwarf_index_add(&sections, module->image_base, module->index);
+    }
+    else if (symtab || dynsym)
+    {
+        kind = "ELF";
+        _exm_stack_module_elf_symbols_add(module, data, st.st_size,
+                                          shdrs, ehdr->e_shnum,
+                                          symtab ? symtab : dynsym);
+    }
+    else
+        kind = NULL;
+
+    munmap(data, st.st_size);
+
+    if (!kind ||
+        !exm_symbol_index_build(module->index) ||
+        (exm_symbol_index_count(module->index) == 0))
+    {
+        exm_symbol_index_free(module->index);
+        module->index = NULL;
+        return 1;
+    }
+
+    EXM_LOG_DBG("%s symbol index of module %s: %u rows, %lu bytes",
+                kind, module->filename,
+                exm_symbol_index_count(module->index),
+                (unsigned long)exm_symbol_index_memory_get(module->index));
+
+    return 1;
+
+  unmap:
+    munmap(data, st.st_size);
+
+    return 1;
+}
+
+#endif
+
+#ifdef HAVE_BFD
+
+static void
+_exm_stack_module_dwarf_section_get(bfd *abfd,
+                                    const char *name,
+                                    Exm_Dwarf_Section *section)
+{
+    asection *sec;
+    bfd_byte *data = NULL;
+
+    section->data = NULL;
+    section->size = 0;
+
+    sec = bfd_get_section_by_name(abfd, name);
+    if (!sec)
+        return;
+
+    if (!bfd_malloc_and_get_section(abfd, sec, &data))
+        return;
+
+    section->data = data;
+    section->size = EXM_BFD_SECTION_SIZE(abfd, sec);
+}
+
+/*
+ * Build the symbol index of the module from the functions of its
+ * symbol table and the rows of its DWARF line table, so that a frame
+ * is found with a binary search instead of bfd_find_nearest_line(),
+ * which decodes the line programs again for each address.
+ */
+static void
+_exm_stack_module_index_build(Exm_Stack_Module *module, long symbols_nbr)
+{
+    Exm_Dwarf_Sections sections;
+    bfd_vma base;
+    long i;
+
+    module->index = exm_symbol_index_new();
+    if (!module->index)
+        return;
+
+    base = (bfd_vma)module->image_base;
+
+    for (i = 0; i < symbols_nbr; i++)
+    {
+        asymbol *sym;
+        bfd_vma start;
+        bfd_vma end;
+
+        sym = module->symbol_table[i];
+        if (!(sym->flags & BSF_FUNCTION) ||
+            !(EXM_BFD_SECTION_FLAGS(module->abfd, sym->section) & SEC_CODE))
+            continue;
+
+        start = bfd_asymbol_value(sym);
+        end = EXM_BFD_SECTION_VMA(module->abfd, sym->section) +
+              EXM_BFD_SECTION_SIZE(module->abfd, sym->section);
+        if ((start < base) || (end - base > 0xffffffff))
+            continue;
+
+        exm_symbol_index_function_add(module->index,
+                                      (unsigned int)(start - base),
+                                      (unsigned int)(end - base),
+                                      bfd_asymbol_name(sym));
+    }
+
+    memset(&sections, 0, sizeof(Exm_Dwarf_Sections));
+    _exm_stack_module_dwarf_section_get(module->abfd, ".debug_line", &sections.line);
+    if (sections.line.data)
+    {
+        _exm_stack_module_dwarf_section_get(module->abfd, ".debug_line_str", &sections.line_str);
+        _exm_stack_module_dwarf_section_get(module->abfd, ".debug_str", &sections.str);
+        exm_dwarf_lines_add(&sections, base, module->index);
+        free((void *)sections.str.data);
+        free((void *)sections.line_str.data);
+        free((void *)sections.line.data);
+    }
+
+    if (!exm_symbol_index_build(module->index) ||
+        (exm_symbol_index_count(module->index) == 0))
+    {
+        exm_symbol_index_free(module->index);
+        module->index = NULL;
+        return;
+    }
+
+    EXM_LOG_DBG("symbol index of module %s: %u rows, %lu bytes",
+                module->filename,
+                exm_symbol_index_count(module->index),
+                (unsigned long)exm_symbol_index_memory_get(module->index));
+}
+
+static void
+_exm_stack_module_bfd_open(Exm_Stack_Module *module)
+{
+    char **formats = NULL;
+    unsigned int dummy = 0;
+    long symbols_nbr;
+
+    module->abfd = bfd_openr(module->filename, NULL);
+    if (!module->abfd)
+    {
+        EXM_LOG_WARN("Can not open file descriptor for module %s",
+                     module->filename);
+        return;
+    }
+
+    if (!bfd_check_format_matches(module->abfd, bfd_object, &formats))
+    {
+        EXM_LOG_ERR("bfd_check_format failed: %s",
+                    bfd_errmsg(bfd_get_error()));
+        free(formats);
+        goto close_fd;
+    }
+
+    if (!(bfd_get_file_flags(module->abfd) & HAS_SYMS))
+        goto close_fd;
+
+    symbols_nbr = bfd_read_minisymbols(module->abfd, 0, (void **)&module->symbol_table, &dummy);
+    if (symbols_nbr == 0)
+        symbols_nbr = bfd_read_minisymbols(module->abfd, 1, (void **)&module->symbol_table, &dummy);
+    if (symbols_nbr < 0)
+        goto free_symbol_table;
+
+    bfd_map_over_sections(module->abfd,
+                          &_exm_stack_module_section_add,
+                          module);
+    qsort(module->sections, module->sections_nbr, sizeof(Exm_Stack_Section),
+          _exm_stack_module_section_cmp);
+
+    _exm_stack_module_index_build(module, symbols_nbr);
+
+    EXM_LOG_DBG("bfd set up for module %s", module->filename);
+
+    return;
+
+  free_symbol_table:
+    free(module->symbol_table);
+    module->symbol_table = NULL;
+  close_fd:
+    bfd_close(module->abfd);
+    module->abfd = NULL;
+}
+
+#endif
+
+/*
+ * The DWARF debug information, the PDB file and the COFF symbol table
+ * of a PE file, and on UNIX the DWARF debug information and the
+ * symbol tables of an ELF file, are read natively. bfd is only used,
+ * if available, for the other files and for the stripped PE files.
+ */
+static void
+_exm_stack_module_open(Exm_Stack_Module *module)
+{
+    module->opened = 1;
+
+#ifndef _WIN32
+    if (_exm_stack_module_elf_open(module))
+        return;
+#endif
+
+    if (_exm_stack_module_pe_open(module))
+        return;
+
+#ifdef HAVE_BFD
+    _exm_stack_module_bfd_open(module);
+#endif
+}
+
+
+/*============================================================================*
+ *                                 Global                                     *
+ *============================================================================*/
+
+
+/*
+ * Create a module for @p filename mapped at @p base. The file is
+ * opened, and its debug information read, only when the first frame
+ * is searched in it. A module whose file has no usable debug
+ * information resolves no frame, so that the failure is remembered
+ * by the cache.
+ */
+Exm_Stack_Module *
+exm_stack_module_new(const char *filename, const void *base, size_t size)
+{
+    Exm_Stack_Module *module;
+    size_t l;
+
+    module = (Exm_Stack_Module *)calloc(1, sizeof(Exm_Stack_Module));
+    if (!module)
+        return NULL;
+
+    l = strlen(filename) + 1;
+    module->filename = (char *)malloc(l * sizeof(char));
+    if (!module->filename)
+    {
+        free(module);
+        return NULL;
+    }
+    memcpy(module->filename, filename, l);
+    module->base = base;
+    module->size = size;
+
+    return module;
+}
+
+void
+exm_stack_module_free(Exm_Stack_Module *module)
+{
+    if (!module)
+        return;
+
+    exm_symbol_index_free(module->index);
+#ifdef HAVE_BFD
+    free(module->sections);
+    free(module->symbol_table);
+    if (module->abfd)
+        bfd_close(module->abfd);
+#endif
+    free(module->filename);
+    free(module);
+}
+
+const char *
+exm_stack_module_filename_get(const Exm_Stack_Module *module)
+{
+    return module->filename;
+}
+
+const void *
+exm_stack_module_base_get(const Exm_Stack_Module *module)
+{
+    return module->base;
+}
+
+size_t
+exm_stack_module_size_get(const Exm_Stack_Module *module)
+{
+    return module->size;
+}
+
+unsigned int
+exm_stack_module_id_get(const Exm_Stack_Module *module)
+{
+    return module->id;
+}
+
+/*
+ * Search the frame at @p offset from the base of the module in its
+ * symbol index, then with bfd if the index does not know it. The
+ * returned strings belong to the module and stay valid as long as it
+ * is not freed.
+ */
+unsigned char
+exm_stack_module_frame_find(Exm_Stack_Module *module,
+                            unsigned long long offset,
+                            const char **filename,
+                            const char **function,
+                            unsigned int *line)
+{
+#ifdef HAVE_BFD
+    const Exm_Stack_Section *section;
+    bfd_vma vma;
+#endif
+
+    *filename = NULL;
+    *function = NULL;
+    *line = 0;
+
+    if (!module->opened)
+        _exm_stack_module_open(module);
+
+    if (module->index &&
+        (offset < 0xffffffff) &&
+        exm_symbol_index_find(module->index, (unsigned int)offset,
+                              function, filename, line))
+    {
+        if (!*filename)
+            *filename = module->filename;
+        return 1;
+    }
+
+#ifdef HAVE_BFD
+    if (!module->abfd)
+        return 0;
+
+    vma = (bfd_vma)(module->image_base + offset);
+    section = _exm_stack_module_section_find(module, vma);
+    if (!section)
+        return 0;
+
+    if (!bfd_find_nearest_line(module->abfd, section->sec,
+                               module->symbol_table,
+                               vma - section->vma,
+                               filename, function, line))
+        return 0;
+
+    if (!*filename)
+        *filename = bfd_get_filename(module->abfd);
+
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * Return the cached module mapped at an address range containing
+ * @p addr, or NULL.
+ */
+Exm_Stack_Module *
+exm_stack_module_cache_find(const void *addr)
+{
+    Exm_Stack_Module *module;
+    unsigned int idx;
+
+    idx = _exm_stack_module_cache_upper(addr);
+    if (idx == 0)
+        return NULL;
+
+    module = _exm_stack_modules[idx - 1];
+    if (((uintptr_t)addr - (uintptr_t)module->base) < module->size)
+        return module;
+
+    if (addr == module->base)
+        return module;
+
+    return NULL;
+}
+
+Exm_Stack_Module *
+exm_stack_module_cache_add(const char *filename, const void *base, size_t size)
+{
+    Exm_Stack_Module *module;
+    unsigned int idx;
+
+    idx = _exm_stack_module_cache_upper(base);
+    if ((idx > 0) && (_exm_stack_modules[idx - 1]->base == base))
+        return _exm_stack_modules[idx - 1];
+
+    module = exm_stack_module_new(filename, base, size);
+    if (!module)
+        return NULL;
+
+    if (_exm_stack_modules_nbr == _exm_stack_modules_max)
+    {
+        Exm_Stack_Module **modules;
+        unsigned int max;
+
+        max = _exm_stack_modules_max ? 2 * _exm_stack_modules_max : 16;
+        modules = (Exm_Stack_Module **)realloc(_exm_stack_modules,
+                                               max * sizeof(Exm_Stack_Module *));
+        if (!modules)
+            goto free_module;
+        _exm_stack_modules = modules;
+
+        modules = (Exm_Stack_Module **)realloc(_exm_stack_modules_by_id,
+                                               max * sizeof(Exm_Stack_Module *));
+        if (!modules)
+            goto free_module;
+        _exm_stack_modules_by_id = modules;
+
+        _exm_stack_modules_max = max;
+    }
+
+    memmove(_exm_stack_modules + idx + 1, _exm_stack_modules + idx,
+            (_exm_stack_modules_nbr - idx) * sizeof(Exm_Stack_Module *));
+    _exm_stack_modules[idx] = module;
+    module->id = _exm_stack_modules_nbr;
+    _exm_stack_modules_by_id[module->id] = module;
+    _exm_stack_modules_nbr++;
+
+    return module;
+
+  free_module:
+    exm_stack_module_free(module);
+
+    return NULL;
+}
+
+Exm_Stack_Module *
+exm_stack_module_cache_get(unsigned int id)
+{
+    if (id >= _exm_stack_modules_nbr)
+        return NULL;
+
+    return _exm_stack_modules_by_id[id];
+}
+
+void
+exm_stack_module_cache_free(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < _exm_stack_modules_nbr; i++)
+        exm_stack_module_free(_exm_stack_modules[i]);
+
+    free(_exm_stack_modules);
+    free(_exm_stack_modules_by_id);
+    _exm_stack_modules = NULL;
+    _exm_stack_modules_by_id = NULL;
+    _exm_stack_modules_nbr = 0;
+    _exm_stack_modules_max = 0;
+}
+
+
+/*============================================================================*
+ *                                   API                                      *
+ *============================================================================*/
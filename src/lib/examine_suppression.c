@@ -0,0 +1,1213 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2016 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Examine.h"
+
+
+/**
+ * @defgroup Suppression functions
+ *
+ * A suppression hides the errors and the loss records of some kinds
+ * whose stack starts with some frames. The suppression files are the
+ * ones of valgrind:
+ *
+ * {
+ *    name
+ *    Memcheck:Leak
+ *    match-leak-kinds: definite,possible
+ *    fun:my_malloc
+ *    obj:/usr/lib/libfoo.so*
+ *    ...
+ *    fun:main
+ * }
+ *
+ * The kinds are Leak, Free (which includes the mismatched frees),
+ * Mismatch, Overlap and Addr. A frame matches fun: if the pattern
+ * matches its function, and obj: if it matches the file name of its
+ * module, the patterns having the wildcards '*' and '?'. The frame
+ * '...' matches any number of frames. The suppressions of the other
+ * tools and kinds are read but never match.
+ *
+ * The suppressions are compiled in a trie, each node standing for the
+ * frames already matched, and its edges for the patterns of the next
+ * frame. The patterns and the names of the frames are interned, so
+ * that the edges without wildcard are found in a hash table keyed by
+ * their node and their string, whatever the number of suppressions.
+ * A '...' is a node looping on itself. A stack is matched by following
+ * its frames in the trie with the set of the nodes reached, as an
+ * automaton, until a node where a suppression of its kind ends. The
+ * result is cached by stack and kind, the stacks being recorded once
+ * in the depot.
+ *
+ * @{
+ */
+
+
+/*============================================================================*
+ *                                  Local                                     *
+ *============================================================================*/
+
+
+#define EXM_SUPPRESSION_FRAMES_MAX 100
+
+#define EXM_SUPPRESSION_LEAK_KINDS \
+    ((1 << EXM_SUPPRESSION_LEAK_DEFINITE) | \
+     (1 << EXM_SUPPRESSION_LEAK_INDIRECT) | \
+     (1 << EXM_SUPPRESSION_LEAK_POSSIBLE) | \
+     (1 << EXM_SUPPRESSION_LEAK_REACHABLE))
+
+typedef enum
+{
+    EXM_SUPPRESSION_PATTERN_FUN,
+    EXM_SUPPRESSION_PATTERN_OBJ,
+    EXM_SUPPRESSION_PATTERN_ELLIPSIS
+} Exm_Suppression_Pattern_Type;
+
+typedef struct
+{
+    const char *start; /* not nul terminated */
+    size_t len;
+    Exm_Suppression_Pattern_Type type;
+} Exm_Suppression_Pattern;
+
+typedef struct
+{
+    char *name;
+    unsigned int kinds; /* mask of the kinds */
+    unsigned int next; /* next suppression ending at the same node + 1 */
+} Exm_Suppression_Entry;
+
+typedef struct
+{
+    unsigned int ellipsis; /* node after a '...' following this one, 0 if none */
+    unsigned int globs; /* first edge with wildcards + 1, 0 if none */
+    unsigned int ends; /* first suppression ending at this node + 1, 0 if none */
+    unsigned int kinds; /* of the suppressions ending at this node */
+    unsigned int mark; /* last step at which the node is reached */
+    unsigned char loop; /* 1 for the node after a '...' */
+} Exm_Suppression_Node;
+
+typedef struct
+{
+    unsigned int from;
+    unsigned int string;
+    unsigned int to;
+    unsigned int next; /* next edge with wildcards of the node + 1 */
+    Exm_Suppression_Pattern_Type type;
+    unsigned char glob; /* 1 if the string has wildcards */
+} Exm_Suppression_Edge;
+
+struct _Exm_Suppression
+{
+    char **strings; /* interned, the id 0 being unused */
+    unsigned int strings_nbr;
+    unsigned int strings_max;
+    unsigned int *strings_table; /* ids, 0 for an empty slot */
+    unsigned int strings_mask;
+
+    Exm_Suppression_Entry *entries;
+    unsigned int entries_nbr;
+    unsigned int entries_max;
+
+    Exm_Suppression_Node *nodes; /* the root first */
+    unsigned int nodes_nbr;
+    unsigned int nodes_max;
+
+    Exm_Suppression_Edge *edges;
+    unsigned int edges_nbr;
+    unsigned int edges_max;
+    unsigned int *edges_table; /* edges without wildcard + 1, 0 for an empty slot */
+    unsigned int edges_mask;
+
+    unsigned long long *cache_keys; /* (stack << 4 | kind) + 1, 0 for an empty slot */
+    unsigned int *cache_values; /* suppression + 1, 0 if none matches */
+    size_t cache_nbr;
+    size_t cache_mask;
+
+    unsigned int *reached[2]; /* nodes reached before and after a frame */
+    unsigned int reached_max;
+    unsigned int mark;
+};
+
+static unsigned char
+_exm_suppression_grow(void **array, unsigned int *max, unsigned int nbr, size_t size)
+{
+    void *tmp;
+    unsigned int m;
+
+    if (nbr < *max)
+        return 1;
+
+    m = *max ? 2 * *max : 64;
+    tmp = realloc(*array, m * size);
+    if (!tmp)
+        return 0;
+
+    *array = tmp;
+    *max = m;
+
+    return 1;
+}
+
+static unsigned int
+_exm_suppression_hash(const char *str, size_t len)
+{
+    unsigned int h = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        h ^= (unsigned char)str[i];
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+static unsigned int
+_exm_suppression_string_find(const Exm_Suppression *sup, const char *str, size_t len)
+{
+    unsigned int h;
+
+    if (!sup->strings_table)
+        return 0;
+
+    h = _exm_suppression_hash(str, len) & sup->strings_mask;
+    while (sup->strings_table[h])
+    {
+        const char *s = sup->strings[sup->strings_table[h]];
+
+        if ((strncmp(s, str, len) == 0) && (s[len] == '\0'))
+            return sup->strings_table[h];
+        h = (h + 1) & sup->strings_mask;
+    }
+
+    return 0;
+}
+
+/* the id of the interned string, 0 on error */
+static unsigned int
+_exm_suppression_string_add(Exm_Suppression *sup, const char *str, size_t len)
+{
+    unsigned int id;
+    unsigned int h;
+    char *s;
+
+    id = _exm_suppression_string_find(sup, str, len);
+    if (id)
+        return id;
+
+    /* the table is at most half full */
+    if (2 * (sup->strings_nbr + 1) > sup->strings_mask)
+    {
+        unsigned int *table;
+        unsigned int mask;
+        unsigned int i;
+
+        mask = sup->strings_mask ? 2 * sup->strings_mask + 1 : 255;
+        table = (unsigned int *)calloc(mask + 1, sizeof(unsigned int));
+        if (!table)
+            return 0;
+
+        for (i = 1; i < sup->strings_nbr; i++)
+        {
+            h = _exm_suppression_hash(sup->strings[i], strlen(sup->strings[i])) & mask;
+            while (table[h])
+                h = (h + 1) & mask;
+            table[h] = i;
+        }
+        free(sup->strings_table);
+        sup->strings_table = table;
+        sup->strings_mask = mask;
+    }
+
+    if (!_exm_suppression_grow((void **)&sup->strings, &sup->strings_max,
+                               sup->strings_nbr, sizeof(char *)))
+        return 0;
+
+    s = (char *)malloc(len + 1);
+    if (!s)
+        return 0;
+    memcpy(s, str, len);
+    s[len] = '\0';
+
+    id = sup->strings_nbr++;
+    sup->strings[id] = s;
+    h = _exm_suppression_hash(str, len) & sup->strings_mask;
+    while (sup->strings_table[h])
+        h = (h + 1) & sup->strings_mask;
+    sup->strings_table[h] = id;
+
+    return id;
+}
+
+static unsigned int
+_exm_suppression_edge_hash(unsigned int from, Exm_Suppression_Pattern_Type type, unsigned int string)
+{
+    unsigned int h;
+
+    h = (from * 2654435761u) ^ (string * 2246822519u) ^ (unsigned int)type;
+    h ^= h >> 15;
+    h *= 2246822519u;
+    h ^= h >> 13;
+
+    return h;
+}
+
+/* the node reached by an edge without wildcard, 0 if none */
+static unsigned int
+_exm_suppression_edge_find(const Exm_Suppression *sup, unsigned int from, Exm_Suppression_Pattern_Type type, unsigned int string)
+{
+    unsigned int h;
+
+    if (!sup->edges_table)
+        return 0;
+
+    h = _exm_suppression_edge_hash(from, type, string) & sup->edges_mask;
+    while (sup->edges_table[h])
+    {
+        const Exm_Suppression_Edge *edge = sup->edges + sup->edges_table[h] - 1;
+
+        if ((edge->from == from) && (edge->type == type) && (edge->string == string))
+            return edge->to;
+        h = (h + 1) & sup->edges_mask;
+    }
+
+    return 0;
+}
+
+static unsigned char
+_exm_suppression_edge_add(Exm_Suppression *sup, unsigned int from, Exm_Suppression_Pattern_Type type, unsigned int string, unsigned int to, unsigned char glob)
+{
+    Exm_Suppression_Edge *edge;
+    unsigned int h;
+
+    if (!glob && (2 * (sup->edges_nbr + 1) > sup->edges_mask))
+    {
+        unsigned int *table;
+        unsigned int mask;
+        unsigned int i;
+
+        mask = sup->edges_mask ? 2 * sup->edges_mask + 1 : 255;
+        table = (unsigned int *)calloc(mask + 1, sizeof(unsigned int));
+        if (!table)
+            return 0;
+
+        for (i = 0; i < sup->edges_nbr; i++)
+        {
+            edge = sup->edges + i;
+            if (edge->glob)
+                continue;
+            h = _exm_suppression_edge_hash(edge->from, edge->type, edge->string) & mask;
+            while (table[h])
+                h = (h + 1) & mask;
+            table[h] = i + 1;
+        }
+        free(sup->edges_table);
+        sup->edges_table = table;
+        sup->edges_mask = mask;
+    }
+
+    if (!_exm_suppression_grow((void **)&sup->edges, &sup->edges_max,
+                               sup->edges_nbr, sizeof(Exm_Suppression_Edge)))
+        return 0;
+
+    edge = sup->edges + sup->edges_nbr++;
+    edge->from = from;
+    edge->string = string;
+    edge->to = to;
+    edge->type = type;
+    edge->next = 0;
+    edge->glob = glob;
+
+    /* the edges with wildcards are not in the table */
+    if (glob)
+    {
+        edge->next = sup->nodes[from].globs;
+        sup->nodes[from].globs = sup->edges_nbr;
+    }
+    else
+    {
+        h = _exm_suppression_edge_hash(from, type, string) & sup->edges_mask;
+        while (sup->edges_table[h])
+            h = (h + 1) & sup->edges_mask;
+        sup->edges_table[h] = sup->edges_nbr;
+    }
+
+    return 1;
+}
+
+/* the new node, 0 on error, the root being never created again */
+static unsigned int
+_exm_suppression_node_new(Exm_Suppression *sup)
+{
+    if (!_exm_suppression_grow((void **)&sup->nodes, &sup->nodes_max,
+                               sup->nodes_nbr, sizeof(Exm_Suppression_Node)))
+        return 0;
+
+    memset(sup->nodes + sup->nodes_nbr, 0, sizeof(Exm_Suppression_Node));
+
+    return sup->nodes_nbr++;
+}
+
+static unsigned char
+_exm_suppression_compile(Exm_Suppression *sup, const Exm_Suppression_Pattern *patterns, unsigned int nbr, unsigned int entry)
+{
+    unsigned int node = 0;
+    unsigned int i;
+
+    for (i = 0; i < nbr; i++)
+    {
+        unsigned int string;
+        unsigned int to;
+        unsigned char glob;
+
+        if (patterns[i].type == EXM_SUPPRESSION_PATTERN_ELLIPSIS)
+        {
+            if (sup->nodes[node].loop)
+                continue;
+            if (!sup->nodes[node].ellipsis)
+            {
+                to = _exm_suppression_node_new(sup);
+                if (!to)
+                    return 0;
+                sup->nodes[to].loop = 1;
+                sup->nodes[node].ellipsis = to;
+            }
+            node = sup->nodes[node].ellipsis;
+            continue;
+        }
+
+        string = _exm_suppression_string_add(sup, patterns[i].start, patterns[i].len);
+        if (!string)
+            return 0;
+
+        glob = (memchr(patterns[i].start, '*', patterns[i].len) ||
+                memchr(patterns[i].start, '?', patterns[i].len));
+        if (glob)
+        {
+            unsigned int e;
+
+            to = 0;
+            for (e = sup->nodes[node].globs; e; e = sup->edges[e - 1].next)
+            {
+                if ((sup->edges[e - 1].type == patterns[i].type) &&
+                    (sup->edges[e - 1].string == string))
+                {
+                    to = sup->edges[e - 1].to;
+                    break;
+                }
+            }
+        }
+        else
+            to = _exm_suppression_edge_find(sup, node, patterns[i].type, string);
+
+        if (!to)
+        {
+            to = _exm_suppression_node_new(sup);
+            if (!to ||
+                !_exm_suppression_edge_add(sup, node, patterns[i].type, string, to, glob))
+                return 0;
+        }
+        node = to;
+    }
+
+    sup->entries[entry].next = sup->nodes[node].ends;
+    sup->nodes[node].ends = entry + 1;
+    sup->nodes[node].kinds |= sup->entries[entry].kinds;
+
+    return 1;
+}
+
+/* the kinds of the suppressions of Memcheck, 0 for the other tools */
+static unsigned int
+_exm_suppression_kinds_get(const char *line, size_t len, unsigned char *param)
+{
+    const char *colon;
+    const char *kind;
+    const char *tool;
+    size_t kind_len;
+    unsigned char memcheck = 0;
+
+    *param = 0;
+    colon = (const char *)memchr(line, ':', len);
+    if (!colon)
+        return 0;
+
+    /* a list of tools separated by commas */
+    tool = line;
+    while (tool < colon)
+    {
+        const char *end;
+
+        end = (const char *)memchr(tool, ',', colon - tool);
+        if (!end)
+            end = colon;
+        if ((end - tool == 8) && (strncmp(tool, "Memcheck", 8) == 0))
+            memcheck = 1;
+        tool = end + 1;
+    }
+
+    kind = colon + 1;
+    kind_len = line + len - kind;
+    if ((kind_len == 5) && (strncmp(kind, "Param", 5) == 0))
+        *param = 1;
+
+    if (!memcheck)
+        return 0;
+
+    if ((kind_len == 4) && (strncmp(kind, "Leak", 4) == 0))
+        return EXM_SUPPRESSION_LEAK_KINDS;
+    if ((kind_len == 4) && (strncmp(kind, "Free", 4) == 0))
+        return (1 << EXM_SUPPRESSION_FREE) | (1 << EXM_SUPPRESSION_MISMATCH);
+    if ((kind_len == 8) && (strncmp(kind, "Mismatch", 8) == 0))
+        return 1 << EXM_SUPPRESSION_MISMATCH;
+    if ((kind_len == 7) && (strncmp(kind, "Overlap", 7) == 0))
+        return 1 << EXM_SUPPRESSION_OVERLAP;
+    if ((kind_len >= 4) && (strncmp(kind, "Addr", 4) == 0))
+        return 1 << EXM_SUPPRESSION_ADDR;
+
+    return 0;
+}
+
+/* the leak kinds of a match-leak-kinds line, -1 on error */
+static int
+_exm_suppression_leak_kinds_get(const char *str, size_t len)
+{
+    static const char *names[] = { "definite", "indirect", "possible", "reachable" };
+    int kinds = 0;
+
+    while (len > 0)
+    {
+        const char *end;
+        size_t l;
+        int i;
+
+        while ((len > 0) && ((*str == ' ') || (*str == ',')))
+        {
+            str++;
+            len--;
+        }
+        if (len == 0)
+            break;
+
+        end = (const char *)memchr(str, ',', len);
+        l = end ? (size_t)(end - str) : len;
+        while ((l > 0) && (str[l - 1] == ' '))
+            l--;
+
+        if ((l == 3) && (strncmp(str, "all", 3) == 0))
+            kinds |= EXM_SUPPRESSION_LEAK_KINDS;
+        else if (!((l == 4) && (strncmp(str, "none", 4) == 0)))
+        {
+            for (i = 0; i < 4; i++)
+            {
+                if ((strlen(names[i]) == l) && (strncmp(str, names[i], l) == 0))
+                {
+                    kinds |= 1 << (EXM_SUPPRESSION_LEAK_DEFINITE + i);
+                    break;
+                }
+            }
+            if (i == 4)
+                return -1;
+        }
+
+        if (!end)
+            break;
+        len -= end + 1 - str;
+        str = end + 1;
+    }
+
+    return kinds;
+}
+
+static unsigned char
+_exm_suppression_glob_match(const char *pattern, const char *str)
+{
+    const char *pattern_star = NULL;
+    const char *str_star = NULL;
+
+    while (*str)
+    {
+        if (*pattern == '*')
+        {
+            pattern_star = pattern++;
+            str_star = str;
+        }
+        else if ((*pattern == '?') || (*pattern == *str))
+        {
+            pattern++;
+            str++;
+        }
+        else if (pattern_star)
+        {
+            /* the star takes one more character */
+            pattern = pattern_star + 1;
+            str = ++str_star;
+        }
+        else
+            return 0;
+    }
+
+    while (*pattern == '*')
+        pattern++;
+
+    return *pattern == '\0';
+}
+
+/*
+ * Add a node to the nodes reached at this step, and the node after
+ * its '...' if any. Return the suppression of the kind ending at it
+ * + 1, 0 if none.
+ */
+static unsigned int
+_exm_suppression_reach(Exm_Suppression *sup, unsigned int node, unsigned int kind, unsigned int *reached, unsigned int *nbr)
+{
+    while (node && (sup->nodes[node].mark != sup->mark))
+    {
+        sup->nodes[node].mark = sup->mark;
+        reached[(*nbr)++] = node;
+        if (sup->nodes[node].kinds & (1 << kind))
+        {
+            unsigned int e;
+
+            for (e = sup->nodes[node].ends; e; e = sup->entries[e - 1].next)
+            {
+                if (sup->entries[e - 1].kinds & (1 << kind))
+                    return e;
+            }
+        }
+        node = sup->nodes[node].ellipsis;
+    }
+
+    return 0;
+}
+
+static void
+_exm_suppression_mark_next(Exm_Suppression *sup)
+{
+    unsigned int i;
+
+    if (++sup->mark != 0)
+        return;
+
+    for (i = 0; i < sup->nodes_nbr; i++)
+        sup->nodes[i].mark = 0;
+    sup->mark = 1;
+}
+
+/* the matching suppression + 1, 0 if none */
+static unsigned int
+_exm_suppression_run(Exm_Suppression *sup, unsigned int kind, const Exm_Suppression_Frame *frames, unsigned int nbr)
+{
+    unsigned int *reached;
+    unsigned int *next;
+    unsigned int reached_nbr = 0;
+    unsigned int i;
+    unsigned int e;
+
+    if (sup->reached_max < sup->nodes_nbr)
+    {
+        unsigned int *tmp;
+
+        tmp = (unsigned int *)malloc(2 * sup->nodes_nbr * sizeof(unsigned int));
+        if (!tmp)
+            return 0;
+        free(sup->reached[0]);
+        sup->reached[0] = tmp;
+        sup->reached[1] = tmp + sup->nodes_nbr;
+        sup->reached_max = sup->nodes_nbr;
+    }
+    reached = sup->reached[0];
+    next = sup->reached[1];
+
+    /* the root is 0, so it is not added by _exm_suppression_reach() */
+    _exm_suppression_mark_next(sup);
+    reached[reached_nbr++] = 0;
+    sup->nodes[0].mark = sup->mark;
+    e = _exm_suppression_reach(sup, sup->nodes[0].ellipsis, kind, reached, &reached_nbr);
+
+    for (i = 0; (i < nbr) && !e && (reached_nbr > 0); i++)
+    {
+        const char *function;
+        const char *object;
+        unsigned int function_id;
+        unsigned int object_id;
+        unsigned int next_nbr = 0;
+        unsigned int *tmp;
+        unsigned int j;
+
+        function = frames[i].function ? frames[i].function : "???";
+        object = frames[i].object ? frames[i].object : "???";
+        function_id = _exm_suppression_string_find(sup, function, strlen(function));
+        object_id = _exm_suppression_string_find(sup, object, strlen(object));
+
+        _exm_suppression_mark_next(sup);
+        for (j = 0; (j < reached_nbr) && !e; j++)
+        {
+            const Exm_Suppression_Node *node = sup->nodes + reached[j];
+            unsigned int g;
+
+            if (node->loop)
+                e = _exm_suppression_reach(sup, reached[j], kind, next, &next_nbr);
+            if (!e && function_id)
+                e = _exm_suppression_reach(sup, _exm_suppression_edge_find(sup, reached[j], EXM_SUPPRESSION_PATTERN_FUN, function_id),
+                                           kind, next, &next_nbr);
+            if (!e && object_id)
+                e = _exm_suppression_reach(sup, _exm_suppression_edge_find(sup, reached[j], EXM_SUPPRESSION_PATTERN_OBJ, object_id),
+                                           kind, next, &next_nbr);
+            for (g = node->globs; g && !e; g = sup->edges[g - 1].next)
+            {
+                const Exm_Suppression_Edge *edge = sup->edges + g - 1;
+
+                if (_exm_suppression_glob_match(sup->strings[edge->string],
+                                                (edge->type == EXM_SUPPRESSION_PATTERN_FUN) ? function : object))
+                    e = _exm_suppression_reach(sup, edge->to, kind, next, &next_nbr);
+            }
+        }
+
+        tmp = reached;
+        reached = next;
+        next = tmp;
+        reached_nbr = next_nbr;
+    }
+
+    return e;
+}
+
+/* the cached result + 1, 0 if not cached */
+static unsigned int
+_exm_suppression_cache_get(const Exm_Suppression *sup, unsigned long long key)
+{
+    size_t h;
+
+    if (!sup->cache_keys)
+        return 0;
+
+    h = (size_t)(key * 11400714819323198485ull) & sup->cache_mask;
+    while (sup->cache_keys[h])
+    {
+        if (sup->cache_keys[h] == key)
+            return sup->cache_values[h] + 1;
+        h = (h + 1) & sup->cache_mask;
+    }
+
+    return 0;
+}
+
+static void
+_exm_suppression_cache_set(Exm_Suppression *sup, unsigned long long key, unsigned int value)
+{
+    size_t h;
+
+    if (2 * (sup->cache_nbr + 1) > sup->cache_mask)
+    {
+        unsigned long long *keys;
+        unsigned int *values;
+        size_t mask;
+        size_t i;
+
+        mask = sup->cache_mask ? 2 * sup->cache_mask + 1 : 1023;
+        keys = (unsigned long long *)calloc(mask + 1, sizeof(unsigned long long));
+        values = (unsigned int *)malloc((mask + 1) * sizeof(unsigned int));
+        if (!keys || !values)
+        {
+            free(values);
+            free(keys);
+            return;
+        }
+
+        for (i = 0; sup->cache_keys && (i <= sup->cache_mask); i++)
+        {
+            if (!sup->cache_keys[i])
+                continue;
+            h = (size_t)(sup->cache_keys[i] * 11400714819323198485ull) & mask;
+            while (keys[h])
+                h = (h + 1) & mask;
+            keys[h] = sup->cache_keys[i];
+            values[h] = sup->cache_values[i];
+        }
+        free(sup->cache_values);
+        free(sup->cache_keys);
+        sup->cache_keys = keys;
+        sup->cache_values = values;
+        sup->cache_mask = mask;
+    }
+
+    h = (size_t)(key * 11400714819323198485ull) & sup->cache_mask;
+    while (sup->cache_keys[h])
+        h = (h + 1) & sup->cache_mask;
+    sup->cache_keys[h] = key;
+    sup->cache_values[h] = value;
+    sup->cache_nbr++;
+}
+
+static void
+_exm_suppression_cache_clear(Exm_Suppression *sup)
+{
+    if (sup->cache_keys)
+        memset(sup->cache_keys, 0, (sup->cache_mask + 1) * sizeof(unsigned long long));
+    sup->cache_nbr = 0;
+}
+
+
+/*============================================================================*
+ *                                 Global                                     *
+ *============================================================================*/
+
+
+/*============================================================================*
+ *                                   API                                      *
+ *============================================================================*/
+
+
+/**
+ * @brief Return a new empty set of suppressions.
+ *
+ * @return The new set of suppressions, or @c NULL on error.
+ *
+ * The suppressions are added with exm_suppression_file_add() or
+ * exm_suppression_buffer_add(). The set must be freed with
+ * exm_suppression_free().
+ */
+EXM_API Exm_Suppression *
+exm_suppression_new(void)
+{
+    Exm_Suppression *sup;
+
+    sup = (Exm_Suppression *)calloc(1, sizeof(Exm_Suppression));
+    if (!sup)
+        return NULL;
+
+    /* the root, and the unused string id 0 */
+    _exm_suppression_node_new(sup);
+    if (sup->nodes_nbr != 1)
+        goto free_sup;
+
+    if (!_exm_suppression_grow((void **)&sup->strings, &sup->strings_max,
+                               0, sizeof(char *)))
+        goto free_sup;
+    sup->strings[0] = NULL;
+    sup->strings_nbr = 1;
+
+    return sup;
+
+  free_sup:
+    exm_suppression_free(sup);
+
+    return NULL;
+}
+
+/**
+ * @brief Free the given set of suppressions.
+ *
+ * @param[inout] sup The set of suppressions.
+ *
+ * If @p sup is @c NULL, this function does nothing.
+ */
+EXM_API void
+exm_suppression_free(Exm_Suppression *sup)
+{
+    unsigned int i;
+
+    if (!sup)
+        return;
+
+    free(sup->reached[0]);
+    free(sup->cache_values);
+    free(sup->cache_keys);
+    free(sup->edges_table);
+    free(sup->edges);
+    free(sup->nodes);
+    for (i = 0; i < sup->entries_nbr; i++)
+        free(sup->entries[i].name);
+    free(sup->entries);
+    for (i = 1; i < sup->strings_nbr; i++)
+        free(sup->strings[i]);
+    free(sup->strings);
+    free(sup->strings_table);
+    free(sup);
+}
+
+/**
+ * @brief Add the suppressions of a buffer to the given set.
+ *
+ * @param[inout] sup The set of suppressions.
+ * @param[in] buffer The content of a suppression file.
+ * @param[in] size The size of @p buffer in bytes.
+ * @param[in] filename The name of the file, for the error messages.
+ * @return 1 on success, 0 on error.
+ *
+ * This function parses the suppressions of @p buffer and compiles
+ * them in the trie of @p sup. On a syntax error, the line is logged
+ * and the suppressions before it are kept.
+ */
+EXM_API unsigned char
+exm_suppression_buffer_add(Exm_Suppression *sup, const char *buffer, size_t size, const char *filename)
+{
+    Exm_Suppression_Pattern patterns[EXM_SUPPRESSION_FRAMES_MAX];
+    const char *iter;
+    const char *end;
+    const char *name = NULL;
+    size_t name_len = 0;
+    unsigned int patterns_nbr = 0;
+    unsigned int kinds = 0;
+    unsigned int line_nbr = 0;
+    enum
+    {
+        EXM_SUPPRESSION_STATE_OUTSIDE,
+        EXM_SUPPRESSION_STATE_NAME,
+        EXM_SUPPRESSION_STATE_KIND,
+        EXM_SUPPRESSION_STATE_PARAM,
+        EXM_SUPPRESSION_STATE_LEAK_KINDS,
+        EXM_SUPPRESSION_STATE_FRAMES
+    } state = EXM_SUPPRESSION_STATE_OUTSIDE;
+
+    if (!sup || !buffer)
+        return 0;
+
+    if (!filename)
+        filename = "suppressions";
+
+    _exm_suppression_cache_clear(sup);
+
+    iter = buffer;
+    end = buffer + size;
+    while (iter < end)
+    {
+        const char *line;
+        size_t len;
+
+        line = iter;
+        while ((iter < end) && (*iter != '\n'))
+            iter++;
+        len = iter - line;
+        if (iter < end)
+            iter++;
+        line_nbr++;
+
+        while ((len > 0) && ((*line == ' ') || (*line == '\t')))
+        {
+            line++;
+            len--;
+        }
+        while ((len > 0) &&
+               ((line[len - 1] == ' ') || (line[len - 1] == '\t') || (line[len - 1] == '\r')))
+            len--;
+
+        if ((len == 0) || (*line == '#'))
+            continue;
+
+        switch (state)
+        {
+            case EXM_SUPPRESSION_STATE_OUTSIDE:
+                if ((len != 1) || (*line != '{'))
+                    goto error;
+                state = EXM_SUPPRESSION_STATE_NAME;
+                break;
+            case EXM_SUPPRESSION_STATE_NAME:
+                name = line;
+                name_len = len;
+                state = EXM_SUPPRESSION_STATE_KIND;
+                break;
+            case EXM_SUPPRESSION_STATE_KIND:
+            {
+                unsigned char param;
+
+                kinds = _exm_suppression_kinds_get(line, len, &param);
+                patterns_nbr = 0;
+                state = param ? EXM_SUPPRESSION_STATE_PARAM : EXM_SUPPRESSION_STATE_LEAK_KINDS;
+                break;
+            }
+            case EXM_SUPPRESSION_STATE_PARAM:
+                /* the name of the parameter, not used here */
+                state = EXM_SUPPRESSION_STATE_FRAMES;
+                break;
+            case EXM_SUPPRESSION_STATE_LEAK_KINDS:
+                state = EXM_SUPPRESSION_STATE_FRAMES;
+                if ((len > sizeof("match-leak-kinds:") - 1) &&
+                    (strncmp(line, "match-leak-kinds:", sizeof("match-leak-kinds:") - 1) == 0))
+                {
+                    int leak_kinds;
+
+                    leak_kinds = _exm_suppression_leak_kinds_get(line + sizeof("match-leak-kinds:") - 1,
+                                                                 len - (sizeof("match-leak-kinds:") - 1));
+                    if (leak_kinds < 0)
+                        goto error;
+                    kinds &= ~EXM_SUPPRESSION_LEAK_KINDS | (unsigned int)leak_kinds;
+                    break;
+                }
+                /* fall through */
+            case EXM_SUPPRESSION_STATE_FRAMES:
+                if ((len == 1) && (*line == '}'))
+                {
+                    Exm_Suppression_Entry *entry;
+
+                    if (patterns_nbr == 0)
+                        goto error;
+
+                    state = EXM_SUPPRESSION_STATE_OUTSIDE;
+                    if (!kinds)
+                        break;
+
+                    if (!_exm_suppression_grow((void **)&sup->entries, &sup->entries_max,
+                                               sup->entries_nbr, sizeof(Exm_Suppression_Entry)))
+                        goto error_memory;
+
+                    entry = sup->entries + sup->entries_nbr;
+                    entry->name = (char *)malloc(name_len + 1);
+                    if (!entry->name)
+                        goto error_memory;
+                    memcpy(entry->name, name, name_len);
+                    entry->name[name_len] = '\0';
+                    entry->kinds = kinds;
+                    entry->next = 0;
+                    sup->entries_nbr++;
+
+                    if (!_exm_suppression_compile(sup, patterns, patterns_nbr, sup->entries_nbr - 1))
+                    {
+                        /* not in the trie, so never matched */
+                        entry->kinds = 0;
+                        goto error_memory;
+                    }
+                    break;
+                }
+
+                if (patterns_nbr == EXM_SUPPRESSION_FRAMES_MAX)
+                    goto error;
+
+                if ((len == 3) && (strncmp(line, "...", 3) == 0))
+                    patterns[patterns_nbr].type = EXM_SUPPRESSION_PATTERN_ELLIPSIS;
+                else if ((len > 4) && (strncmp(line, "fun:", 4) == 0))
+                    patterns[patterns_nbr].type = EXM_SUPPRESSION_PATTERN_FUN;
+                else if ((len > 4) && (strncmp(line, "obj:", 4) == 0))
+                    patterns[patterns_nbr].type = EXM_SUPPRESSION_PATTERN_OBJ;
+                else if ((len > 4) && (strncmp(line, "src:", 4) == 0))
+                {
+                    /* the source lines are not matched */
+                    kinds = 0;
+                    patterns[patterns_nbr].type = EXM_SUPPRESSION_PATTERN_ELLIPSIS;
+                }
+                else
+                    goto error;
+
+                patterns[patterns_nbr].start = line + 4;
+                patterns[patterns_nbr].len = len - 4;
+                patterns_nbr++;
+                break;
+        }
+    }
+
+    if (state != EXM_SUPPRESSION_STATE_OUTSIDE)
+    {
+        EXM_LOG_ERR("%s:%u: unterminated suppression", filename, line_nbr);
+        return 0;
+    }
+
+    return 1;
+
+  error:
+    EXM_LOG_ERR("%s:%u: bad suppression line", filename, line_nbr);
+    return 0;
+
+  error_memory:
+    EXM_LOG_ERR("Can not allocate memory for the suppressions of %s", filename);
+    return 0;
+}
+
+/**
+ * @brief Add the suppressions of a file to the given set.
+ *
+ * @param[inout] sup The set of suppressions.
+ * @param[in] filename The name of the suppression file.
+ * @return 1 on success, 0 on error.
+ *
+ * This function reads @p filename and adds its suppressions with
+ * exm_suppression_buffer_add().
+ */
+EXM_API unsigned char
+exm_suppression_file_add(Exm_Suppression *sup, const char *filename)
+{
+    FILE *f;
+    char *buffer;
+    long size;
+    unsigned char res;
+
+    if (!sup || !filename)
+        return 0;
+
+    f = fopen(filename, "rb");
+    if (!f)
+    {
+        EXM_LOG_ERR("Can not open suppression file %s", filename);
+        return 0;
+    }
+
+    if ((fseek(f, 0, SEEK_END) != 0) || ((size = ftell(f)) < 0) ||
+        (fseek(f, 0, SEEK_SET) != 0))
+    {
+        EXM_LOG_ERR("Can not read suppression file %s", filename);
+        fclose(f);
+        return 0;
+    }
+
+    buffer = (char *)malloc(size ? size : 1);
+    if (!buffer)
+    {
+        EXM_LOG_ERR("Can not allocate memory for suppression file %s", filename);
+        fclose(f);
+        return 0;
+    }
+
+    if (fread(buffer, 1, size, f) != (size_t)size)
+    {
+        EXM_LOG_ERR("Can not read suppression file %s", filename);
+        free(buffer);
+        fclose(f);
+        return 0;
+    }
+    fclose(f);
+
+    res = exm_suppression_buffer_add(sup, buffer, size, filename);
+    free(buffer);
+
+    return res;
+}
+
+/**
+ * @brief Return the number of suppressions of the given set.
+ *
+ * @param[in] sup The set of suppressions.
+ * @return The number of suppressions of Memcheck.
+ */
+EXM_API unsigned int
+exm_suppression_count(const Exm_Suppression *sup)
+{
+    if (!sup)
+        return 0;
+
+    return sup->entries_nbr;
+}
+
+/**
+ * @brief Return the suppression matching a stack.
+ *
+ * @param[inout] sup The set of suppressions.
+ * @param[in] kind The kind of the error or of the loss record.
+ * @param[in] stack The id of the stack.
+ * @param[in] cb The function returning the frames of @p stack.
+ * @param[in] data The data passed to @p cb.
+ * @return The name of the first matching suppression, or @c NULL.
+ *
+ * This function matches the frames of @p stack, innermost first, with
+ * the suppressions of @p kind. The frames are only asked to @p cb the
+ * first time a stack is matched with a kind, the result being cached
+ * until suppressions are added.
+ */
+EXM_API const char *
+exm_suppression_match(Exm_Suppression *sup, Exm_Suppression_Kind kind, unsigned int stack, Exm_Suppression_Frames_Cb cb, void *data)
+{
+    Exm_Suppression_Frame frames[EXM_SUPPRESSION_FRAMES_MAX];
+    unsigned long long key;
+    unsigned int nbr;
+    unsigned int e;
+
+    if (!sup || !cb || (kind >= EXM_SUPPRESSION_KIND_LAST) || (sup->entries_nbr == 0))
+        return NULL;
+
+    key = (((unsigned long long)stack << 4) | kind) + 1;
+    e = _exm_suppression_cache_get(sup, key);
+    if (e)
+        return (e > 1) ? sup->entries[e - 2].name : NULL;
+
+    nbr = cb(stack, frames, EXM_SUPPRESSION_FRAMES_MAX, data);
+    if (nbr > EXM_SUPPRESSION_FRAMES_MAX)
+        nbr = EXM_SUPPRESSION_FRAMES_MAX;
+    e = _exm_suppression_run(sup, kind, frames, nbr);
+    _exm_suppression_cache_set(sup, key, e);
+
+    return e ? sup->entries[e - 1].name : NULL;
+}
+
+/**
+ * @brief Print the suppression of a stack.
+ *
+ * @param[in] stream The stream.
+ * @param[in] kind The kind of the error or of the loss record.
+ * @param[in] frames The frames of the stack, innermost first.
+ * @param[in] nbr The number of frames.
+ *
+ * This function prints in @p stream a suppression that matches
+ * @p frames for @p kind, to be pasted in a suppression file. A frame
+ * is matched by its function if it is resolved, by its module
+ * otherwise. The mismatched frees are printed with the kind Free, as
+ * valgrind does.
+ */
+EXM_API void
+exm_suppression_print(FILE *stream, Exm_Suppression_Kind kind, const Exm_Suppression_Frame *frames, unsigned int nbr)
+{
+    static const char *leak_kinds[] = { "definite", "indirect", "possible", "reachable" };
+    unsigned int i;
+
+    if (!stream || (kind >= EXM_SUPPRESSION_KIND_LAST))
+        return;
+
+    fprintf(stream, "{\n   <insert_a_suppression_name_here>\n");
+    switch (kind)
+    {
+        case EXM_SUPPRESSION_FREE:
+        case EXM_SUPPRESSION_MISMATCH:
+            fprintf(stream, "   Memcheck:Free\n");
+            break;
+        case EXM_SUPPRESSION_OVERLAP:
+            fprintf(stream, "   Memcheck:Overlap\n");
+            break;
+        case EXM_SUPPRESSION_ADDR:
+            fprintf(stream, "   Memcheck:Addr1\n");
+            break;
+        default:
+            fprintf(stream, "   Memcheck:Leak\n   match-leak-kinds: %s\n", leak_kinds[kind]);
+            break;
+    }
+
+    for (i = 0; i < nbr; i++)
+    {
+        if (frames[i].function)
+            fprintf(stream, "   fun:%s\n", frames[i].function);
+        else if (frames[i].object)
+            fprintf(stream, "   obj:%s\n", frames[i].object);
+        else
+            fprintf(stream, "   obj:*\n");
+    }
+    fprintf(stream, "}\n");
+}
+
+/**
+ * @}
+ */
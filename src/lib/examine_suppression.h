@@ -0,0 +1,70 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2016 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXAMINE_SUPPRESSION_H
+#define EXAMINE_SUPPRESSION_H
+
+#include <stdio.h>
+
+
+typedef struct _Exm_Suppression Exm_Suppression;
+
+typedef enum
+{
+    EXM_SUPPRESSION_LEAK_DEFINITE,
+    EXM_SUPPRESSION_LEAK_INDIRECT,
+    EXM_SUPPRESSION_LEAK_POSSIBLE,
+    EXM_SUPPRESSION_LEAK_REACHABLE,
+    EXM_SUPPRESSION_FREE, /* free without alloc, multiple frees */
+    EXM_SUPPRESSION_MISMATCH, /* mismatched free */
+    EXM_SUPPRESSION_OVERLAP,
+    EXM_SUPPRESSION_ADDR, /* writes out of the blocks or in freed ones */
+    EXM_SUPPRESSION_KIND_LAST
+} Exm_Suppression_Kind;
+
+typedef struct
+{
+    const char *function; /* NULL if not resolved */
+    const char *object; /* file name of the module, NULL if not found */
+} Exm_Suppression_Frame;
+
+/*
+ * Fill at most max frames of the given stack, innermost first, and
+ * return their number.
+ */
+typedef unsigned int (*Exm_Suppression_Frames_Cb)(unsigned int stack, Exm_Suppression_Frame *frames, unsigned int max, void *data);
+
+EXM_API Exm_Suppression *exm_suppression_new(void);
+
+EXM_API void exm_suppression_free(Exm_Suppression *sup);
+
+EXM_API unsigned char exm_suppression_buffer_add(Exm_Suppression *sup, const char *buffer, size_t size, const char *filename);
+
+EXM_API unsigned char exm_suppression_file_add(Exm_Suppression *sup, const char *filename);
+
+EXM_API unsigned int exm_suppression_count(const Exm_Suppression *sup);
+
+EXM_API const char *exm_suppression_match(Exm_Suppression *sup, Exm_Suppression_Kind kind, unsigned int stack, Exm_Suppression_Frames_Cb cb, void *data);
+
+EXM_API void exm_suppression_print(FILE *stream, Exm_Suppression_Kind kind, const Exm_Suppression_Frame *frames, unsigned int nbr);
+
+
+#endif /* EXAMINE_SUPPRESSION_H */
@@ -0,0 +1,1066 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Examine.h"
+
+#include "examine_private_map.h"
+
+
+/**
+ * @defgroup Symbol index functions
+ *
+ * A symbol index maps the addresses of a module, relative to its
+ * base, to a function, a file and a line. It is filled with the
+ * functions of the symbol table and the rows of the line table, then
+ * built once: both are merged in a single array of rows sorted by
+ * address, each row covering the addresses up to the next one. A row
+ * is only made of 32 bits values, the names being offsets in a
+ * single block of strings.
+ *
+ * The row addresses are also stored in the Eytzinger (breadth first)
+ * order of a complete binary tree, so that a lookup walks down an
+ * array whose first levels stay in cache, without unpredictable
+ * branch.
+ *
+ * As a built index has no pointer, it can be saved in a file and
+ * used again from its mapping, without reading the debug
+ * information of the module.
+ *
+ * @{
+ */
+
+
+/*============================================================================*
+ *                                  Local                                     *
+ *============================================================================*/
+
+
+#define EXM_SYMBOL_INDEX_END_OPEN 0xffffffff
+
+#define EXM_SYMBOL_FILE_MAGIC "EXMSYM01"
+#define EXM_SYMBOL_FILE_BOM 0x01020304
+#define EXM_SYMBOL_FILE_KEY_SIZE 48
+
+/*
+ * Header of a symbol index file. It is followed by the keys and the
+ * order of the rows (rows_nbr + 1 values each), the rows, then the
+ * strings, all of them aligned on 4 bytes.
+ */
+typedef struct
+{
+    char magic[8];
+    unsigned int bom; /* the file is only valid with the same byte order */
+    unsigned int rows_nbr;
+    unsigned int strings_size;
+    unsigned int reserved;
+    char key[EXM_SYMBOL_FILE_KEY_SIZE]; /* build id of the module */
+} Exm_Symbol_File_Header;
+
+typedef struct
+{
+    unsigned int rva;
+    unsigned int function; /* offset in the strings, 0 if none */
+    unsigned int file; /* offset in the strings, 0 if none */
+    unsigned int line;
+} Exm_Symbol_Row;
+
+typedef struct
+{
+    unsigned int start;
+    unsigned int end;
+    unsigned int name;
+} Exm_Symbol_Function;
+
+typedef struct
+{
+    unsigned int rva;
+    unsigned int file;
+    unsigned int line; /* 0 at the end of a sequence */
+    unsigned int order;
+} Exm_Symbol_Line;
+
+struct _Exm_Symbol_Index
+{
+    char *strings; /* the first string is the empty one */
+    unsigned int strings_size;
+    unsigned int strings_max;
+    unsigned int *strings_table; /* offsets, 0 for an empty slot */
+    unsigned int strings_table_size; /* power of 2 */
+    unsigned int strings_nbr;
+
+    Exm_Symbol_Function *functions;
+    unsigned int functions_nbr;
+    unsigned int functions_max;
+    Exm_Symbol_Line *lines;
+    unsigned int lines_nbr;
+    unsigned int lines_max;
+
+    Exm_Symbol_Row *rows;
+    unsigned int rows_nbr;
+    unsigned int *keys; /* Eytzinger layout of the row addresses, from 1 */
+    unsigned int *order; /* row index of each key */
+    Exm_Map *map; /* file of a loaded index, owning its arrays */
+    unsigned int built : 1;
+};
+
+static unsigned int
+_exm_symbol_index_string_hash(const char *str, size_t len)
+{
+    unsigned int h;
+    size_t i;
+
+    h = 2166136261u;
+    for (i = 0; i < len; i++)
+        h = (h ^ (unsigned char)str[i]) * 16777619u;
+
+    return h;
+}
+
+static unsigned char
+_exm_symbol_index_strings_table_grow(Exm_Symbol_Index *index)
+{
+    unsigned int *table;
+    unsigned int size;
+    unsigned int i;
+
+    size = index->strings_table_size ? 2 * index->strings_table_size : 1024;
+    table = (unsigned int *)calloc(size, sizeof(unsigned int));
+    if (!table)
+        return 0;
+
+    for (i = 0; i < index->strings_table_size; i++)
+    {
+        const char *str;
+        unsigned int offset;
+        unsigned int slot;
+
+        offset = index->strings_table[i];
+        if (!offset)
+            continue;
+
+        str = index->strings + offset;
+        slot = _exm_symbol_index_string_hash(str, strlen(str)) & (size - 1);
+        while (table[slot])
+            slot = (slot + 1) & (size - 1);
+        table[slot] = offset;
+    }
+
+    free(index->strings_table);
+    index->strings_table = table;
+    index->strings_table_size = size;
+
+    return 1;
+}
+
+static void *
+_exm_symbol_index_array_grow(void *array, unsigned int *max, size_t size)
+{
+    void *tmp;
+    unsigned int m;
+
+    m = *max ? 2 * *max : 256;
+    tmp = realloc(array, m * size);
+    if (tmp)
+        *max = m;
+
+    return tmp;
+}
+
+static int
+_exm_symbol_index_function_cmp(const void *p1, const void *p2)
+{
+    const Exm_Symbol_Function *f1;
+    const Exm_Symbol_Function *f2;
+
+    f1 = (const Exm_Symbol_Function *)p1;
+    f2 = (const Exm_Symbol_Function *)p2;
+
+    if (f1->start != f2->start)
+        return (f1->start < f2->start) ? -1 : 1;
+    /* the outer function first */
+    if (f1->end != f2->end)
+        return (f1->end > f2->end) ? -1 : 1;
+    /* aliases: keep the first added name */
+    if (f1->name != f2->name)
+        return (f1->name < f2->name) ? -1 : 1;
+    return 0;
+}
+
+static int
+_exm_symbol_index_line_cmp(const void *p1, const void *p2)
+{
+    const Exm_Symbol_Line *l1;
+    const Exm_Symbol_Line *l2;
+
+    l1 = (const Exm_Symbol_Line *)p1;
+    l2 = (const Exm_Symbol_Line *)p2;
+
+    if (l1->rva != l2->rva)
+        return (l1->rva < l2->rva) ? -1 : 1;
+    /*
+     * at the same address, the end of a sequence comes first, as the
+     * next sequence may start there, and the last row of a sequence
+     * is the one that is used
+     */
+    if ((l1->line != 0) != (l2->line != 0))
+        return (l1->line == 0) ? -1 : 1;
+    if (l1->order != l2->order)
+        return (l1->order < l2->order) ? -1 : 1;
+    return 0;
+}
+
+/* add the part of @p f from @p cur to @p end to @p functions */
+static void
+_exm_symbol_index_function_emit(Exm_Symbol_Function *functions,
+                                unsigned int *nbr,
+                                unsigned int *cur,
+                                const Exm_Symbol_Function *f,
+                                unsigned int end)
+{
+    if (*cur >= end)
+        return;
+
+    functions[*nbr].start = *cur;
+    functions[*nbr].end = end;
+    functions[*nbr].name = f->name;
+    (*nbr)++;
+    *cur = end;
+}
+
+/*
+ * Remove the aliases and make the functions disjoint. A function
+ * without end ends where the next one starts. A function in another
+ * one, like an inlined one, splits it, and a function overlapping
+ * the end of the previous one shortens it.
+ */
+static unsigned char
+_exm_symbol_index_functions_fix(Exm_Symbol_Index *index)
+{
+    Exm_Symbol_Function *functions;
+    Exm_Symbol_Function *f;
+    unsigned int *stack;
+    unsigned int stack_nbr = 0;
+    unsigned int cur = 0;
+    unsigned int i;
+    unsigned int n;
+
+    if (index->functions_nbr == 0)
+        return 1;
+
+    for (i = 0; i < index->functions_nbr; i++)
+    {
+        f = index->functions + i;
+        if (f->end <= f->start)
+            f->end = EXM_SYMBOL_INDEX_END_OPEN;
+    }
+
+    qsort(index->functions, index->functions_nbr, sizeof(Exm_Symbol_Function),
+          _exm_symbol_index_function_cmp);
+
+    n = 0;
+    for (i = 0; i < index->functions_nbr; i++)
+    {
+        f = index->functions + i;
+        if ((n > 0) &&
+            (index->functions[n - 1].start == f->start) &&
+            (index->functions[n - 1].end == f->end))
+            continue;
+        index->functions[n++] = *f;
+    }
+    index->functions_nbr = n;
+
+    for (i = 0; i < n; i++)
+    {
+        unsigned int j;
+
+        f = index->functions + i;
+        if (f->end != EXM_SYMBOL_INDEX_END_OPEN)
+            continue;
+        for (j = i + 1; (j < n) && (index->functions[j].start == f->start); j++)
+            ;
+        if (j < n)
+            f->end = index->functions[j].start;
+    }
+
+    /* each function can split the one it is in in two */
+    functions = (Exm_Symbol_Function *)malloc(2 * (size_t)n * sizeof(Exm_Symbol_Function));
+    stack = (unsigned int *)malloc(n * sizeof(unsigned int));
+    if (!functions || !stack)
+    {
+        free(functions);
+        free(stack);
+        return 0;
+    }
+
+    i = 0;
+    for (n = 0; n < index->functions_nbr; n++)
+    {
+        f = index->functions + n;
+
+        while (stack_nbr > 0)
+        {
+            const Exm_Symbol_Function *top;
+
+            top = index->functions + stack[stack_nbr - 1];
+            if ((top->end > f->start) && (top->end >= f->end))
+                break;
+            /* the top ends before f, or f overlaps its end */
+            _exm_symbol_index_function_emit(functions, &i, &cur, top,
+                                            (top->end < f->start) ? top->end : f->start);
+            stack_nbr--;
+        }
+        if (stack_nbr > 0)
+            _exm_symbol_index_function_emit(functions, &i, &cur,
+                                            index->functions + stack[stack_nbr - 1],
+                                            f->start);
+        cur = f->start;
+        stack[stack_nbr++] = n;
+    }
+    while (stack_nbr > 0)
+    {
+        f = index->functions + stack[stack_nbr - 1];
+        _exm_symbol_index_function_emit(functions, &i, &cur, f, f->end);
+        stack_nbr--;
+    }
+
+    free(stack);
+    free(index->functions);
+    index->functions = functions;
+    index->functions_nbr = i;
+    index->functions_max = 2 * n;
+
+    return 1;
+}
+
+/*
+ * Merge the functions and the line rows in rows, a row starting at
+ * each address where the function or the line changes.
+ */
+static unsigned char
+_exm_symbol_index_rows_merge(Exm_Symbol_Index *index)
+{
+    const Exm_Symbol_Function *active = NULL;
+    unsigned int file = 0;
+    unsigned int line = 0;
+    unsigned int li = 0;
+    unsigned int fi = 0;
+    unsigned int n = 0;
+    size_t max;
+
+    max = (size_t)index->lines_nbr + 2 * (size_t)index->functions_nbr;
+    if (max == 0)
+        return 1;
+
+    index->rows = (Exm_Symbol_Row *)malloc(max * sizeof(Exm_Symbol_Row));
+    if (!index->rows)
+        return 0;
+
+    for (;;)
+    {
+        Exm_Symbol_Row *row;
+        unsigned int rva = 0;
+        unsigned char found = 0;
+
+        if (li < index->lines_nbr)
+        {
+            rva = index->lines[li].rva;
+            found = 1;
+        }
+        if ((fi < index->functions_nbr) &&
+            (!found || (index->functions[fi].start < rva)))
+        {
+            rva = index->functions[fi].start;
+            found = 1;
+        }
+        if (active && (active->end != EXM_SYMBOL_INDEX_END_OPEN) &&
+            (!found || (active->end < rva)))
+        {
+            rva = active->end;
+            found = 1;
+        }
+        if (!found)
+            break;
+
+        if (active && (active->end == rva))
+            active = NULL;
+        if ((fi < index->functions_nbr) && (index->functions[fi].start == rva))
+            active = index->functions + fi++;
+        while ((li < index->lines_nbr) && (index->lines[li].rva == rva))
+        {
+            file = index->lines[li].line ? index->lines[li].file : 0;
+            line = index->lines[li].line;
+            li++;
+        }
+
+        /* skip the rows that do not change anything */
+        if (n == 0)
+        {
+            if (!active && !line)
+                continue;
+        }
+        else
+        {
+            row = index->rows + n - 1;
+            if ((row->function == (active ? active->name : 0)) &&
+                (row->file == file) &&
+                (row->line == line))
+                continue;
+        }
+
+        row = index->rows + n++;
+        row->rva = rva;
+        row->function = active ? active->name : 0;
+        row->file = file;
+        row->line = line;
+    }
+
+    index->rows_nbr = n;
+
+    if (n < max)
+    {
+        Exm_Symbol_Row *rows;
+
+        rows = (Exm_Symbol_Row *)realloc(index->rows, (n ? n : 1) * sizeof(Exm_Symbol_Row));
+        if (rows)
+            index->rows = rows;
+    }
+
+    return 1;
+}
+
+static unsigned int
+_exm_symbol_index_keys_fill(Exm_Symbol_Index *index, unsigned int i, unsigned int k)
+{
+    if (k <= index->rows_nbr)
+    {
+        i = _exm_symbol_index_keys_fill(index, i, 2 * k);
+        index->keys[k] = index->rows[i].rva;
+        index->order[k] = i;
+        i++;
+        i = _exm_symbol_index_keys_fill(index, i, 2 * k + 1);
+    }
+
+    return i;
+}
+
+
+/*============================================================================*
+ *                                 Global                                     *
+ *============================================================================*/
+
+
+/*============================================================================*
+ *                                   API                                      *
+ *============================================================================*/
+
+
+/**
+ * @brief Return a new empty symbol index.
+ *
+ * @return The new index, or @c NULL on memory error.
+ *
+ * This function returns a new symbol index. Fill it with
+ * exm_symbol_index_function_add() and exm_symbol_index_line_add(),
+ * then call exm_symbol_index_build() before any lookup. Free it with
+ * exm_symbol_index_free().
+ */
+EXM_API Exm_Symbol_Index *
+exm_symbol_index_new(void)
+{
+    Exm_Symbol_Index *index;
+
+    index = (Exm_Symbol_Index *)calloc(1, sizeof(Exm_Symbol_Index));
+    if (!index)
+        return NULL;
+
+    index->strings = (char *)malloc(4096);
+    if (!index->strings)
+        goto free_index;
+
+    index->strings[0] = '\0';
+    index->strings_size = 1;
+    index->strings_max = 4096;
+
+    if (!_exm_symbol_index_strings_table_grow(index))
+        goto free_strings;
+
+    return index;
+
+  free_strings:
+    free(index->strings);
+  free_index:
+    free(index);
+
+    return NULL;
+}
+
+/**
+ * @brief Free the given symbol index.
+ *
+ * @param[inout] index The index.
+ *
+ * This function frees @p index and the strings it stores. If
+ * @p index is @c NULL, this function does nothing.
+ */
+EXM_API void
+exm_symbol_index_free(Exm_Symbol_Index *index)
+{
+    if (!index)
+        return;
+
+    if (index->map)
+    {
+        exm_map_del(index->map);
+        free(index);
+        return;
+    }
+
+    free(index->order);
+    free(index->keys);
+    free(index->rows);
+    free(index->lines);
+    free(index->functions);
+    free(index->strings_table);
+    free(index->strings);
+    free(index);
+}
+
+/**
+ * @brief Store a string in the given symbol index.
+ *
+ * @param[inout] index The index.
+ * @param[in] str The string.
+ * @return The id of the string, or 0 on error.
+ *
+ * This function stores @p str in @p index, if it is not already
+ * stored, and returns its id, to be given to
+ * exm_symbol_index_line_add(). The id 0 is the one of the empty
+ * string, which is also returned if @p str is @c NULL, or on memory
+ * error. Strings can not be added once the index is built.
+ */
+EXM_API unsigned int
+exm_symbol_index_string_add(Exm_Symbol_Index *index, const char *str)
+{
+    size_t len;
+    unsigned int offset;
+    unsigned int slot;
+
+    if (!str || !*str || index->built)
+        return 0;
+
+    len = strlen(str);
+    slot = _exm_symbol_index_string_hash(str, len) & (index->strings_table_size - 1);
+    while (index->strings_table[slot])
+    {
+        if (strcmp(index->strings + index->strings_table[slot], str) == 0)
+            return index->strings_table[slot];
+        slot = (slot + 1) & (index->strings_table_size - 1);
+    }
+
+    if (len + 1 > 0xffffffff - index->strings_size)
+    {
+        EXM_LOG_ERR("Too many strings in the symbol index");
+        return 0;
+    }
+
+    if (index->strings_size + len + 1 > index->strings_max)
+    {
+        char *strings;
+        size_t max;
+
+        max = 2 * (size_t)index->strings_max;
+        if (max < index->strings_size + len + 1)
+            max = index->strings_size + len + 1;
+        if (max > 0xffffffff)
+            max = 0xffffffff;
+        strings = (char *)realloc(index->strings, max);
+        if (!strings)
+            return 0;
+        index->strings = strings;
+        index->strings_max = (unsigned int)max;
+    }
+
+    offset = index->strings_size;
+    memcpy(index->strings + offset, str, len + 1);
+    index->strings_table[slot] = offset;
+    index->strings_size += (unsigned int)len + 1;
+    index->strings_nbr++;
+
+    /* keep the load factor below 1/2, a failure only slows the search */
+    if (2 * index->strings_nbr > index->strings_table_size)
+        _exm_symbol_index_strings_table_grow(index);
+
+    return offset;
+}
+
+/**
+ * @brief Add a function to the given symbol index.
+ *
+ * @param[inout] index The index.
+ * @param[in] start The address of the function.
+ * @param[in] end The address following the function, or 0.
+ * @param[in] name The name of the function.
+ * @return 1 on success, 0 otherwise.
+ *
+ * This function adds the function @p name, covering the addresses
+ * from @p start to @p end excluded, to @p index. If @p end is 0, the
+ * function ends where the next one starts. A function can be in
+ * another one, like an inlined function in its caller: its addresses
+ * are then reported in the inner one. Of several functions with the
+ * same addresses, the first added one is kept.
+ */
+EXM_API unsigned char
+exm_symbol_index_function_add(Exm_Symbol_Index *index, unsigned int start, unsigned int end, const char *name)
+{
+    Exm_Symbol_Function *f;
+
+    if (index->built)
+        return 0;
+
+    if (index->functions_nbr == index->functions_max)
+    {
+        f = (Exm_Symbol_Function *)_exm_symbol_index_array_grow(index->functions,
+                                                                &index->functions_max,
+                                                                sizeof(Exm_Symbol_Function));
+        if (!f)
+            return 0;
+        index->functions = f;
+    }
+
+    f = index->functions + index->functions_nbr;
+    f->start = start;
+    f->end = end;
+    f->name = exm_symbol_index_string_add(index, name);
+    index->functions_nbr++;
+
+    return 1;
+}
+
+/**
+ * @brief Add a row of a line table to the given symbol index.
+ *
+ * @param[inout] index The index.
+ * @param[in] rva The address of the row.
+ * @param[in] file The id of the file name.
+ * @param[in] line The line, or 0 at the end of a sequence.
+ * @return 1 on success, 0 otherwise.
+ *
+ * This function adds a row of a line table to @p index: the
+ * addresses from @p rva to the next row are at line @p line of the
+ * file whose name was given to exm_symbol_index_string_add(), which
+ * returned @p file. The rows of a sequence must be added in order,
+ * the last one having the line 0. If several rows have the same
+ * address, the last added one is used.
+ */
+EXM_API unsigned char
+exm_symbol_index_line_add(Exm_Symbol_Index *index, unsigned int rva, unsigned int file, unsigned int line)
+{
+    Exm_Symbol_Line *l;
+
+    if (index->built)
+        return 0;
+
+    if (index->lines_nbr == index->lines_max)
+    {
+        l = (Exm_Symbol_Line *)_exm_symbol_index_array_grow(index->lines,
+                                                            &index->lines_max,
+                                                            sizeof(Exm_Symbol_Line));
+        if (!l)
+            return 0;
+        index->lines = l;
+    }
+
+    l = index->lines + index->lines_nbr;
+    l->rva = rva;
+    l->file = file;
+    l->line = line;
+    l->order = index->lines_nbr;
+    index->lines_nbr++;
+
+    return 1;
+}
+
+/**
+ * @brief Build the given symbol index.
+ *
+ * @param[inout] index The index.
+ * @return 1 on success, 0 otherwise.
+ *
+ * This function merges the functions and the line rows added to
+ * @p index in the sorted array used by exm_symbol_index_find(), and
+ * frees them. Nothing can be added to @p index afterwards.
+ */
+EXM_API unsigned char
+exm_symbol_index_build(Exm_Symbol_Index *index)
+{
+    unsigned char res = 0;
+
+    if (index->built)
+        return 0;
+
+    index->built = 1;
+
+    if (!_exm_symbol_index_functions_fix(index))
+        goto free_input;
+    if (index->lines_nbr > 0)
+        qsort(index->lines, index->lines_nbr, sizeof(Exm_Symbol_Line),
+              _exm_symbol_index_line_cmp);
+
+    if (!_exm_symbol_index_rows_merge(index))
+        goto free_input;
+
+    index->keys = (unsigned int *)malloc((index->rows_nbr + 1) * sizeof(unsigned int));
+    if (!index->keys)
+        goto free_input;
+
+    index->order = (unsigned int *)malloc((index->rows_nbr + 1) * sizeof(unsigned int));
+    if (!index->order)
+        goto free_input;
+
+    _exm_symbol_index_keys_fill(index, 0, 1);
+    res = 1;
+
+    EXM_LOG_DBG("symbol index built: %u rows, %u strings",
+                index->rows_nbr, index->strings_nbr);
+
+  free_input:
+    free(index->functions);
+    free(index->lines);
+    free(index->strings_table);
+    index->functions = NULL;
+    index->lines = NULL;
+    index->strings_table = NULL;
+    index->functions_nbr = 0;
+    index->functions_max = 0;
+    index->lines_nbr = 0;
+    index->lines_max = 0;
+    index->strings_table_size = 0;
+    if (index->strings_size < index->strings_max)
+    {
+        char *strings;
+
+        strings = (char *)realloc(index->strings, index->strings_size);
+        if (strings)
+        {
+            index->strings = strings;
+            index->strings_max = index->strings_size;
+        }
+    }
+    if (!res)
+        index->rows_nbr = 0;
+
+    return res;
+}
+
+/**
+ * @brief Find the function, file and line of an address.
+ *
+ * @param[in] index The index.
+ * @param[in] rva The address.
+ * @param[out] function The function name.
+ * @param[out] filename The file name.
+ * @param[out] line The line.
+ * @return 1 if @p rva is in a function or a line table, 0 otherwise.
+ *
+ * This function searches @p rva in the built index @p index. The
+ * function and file names are @c NULL if they are not known, and
+ * the line 0. The names are valid until @p index is freed.
+ */
+EXM_API unsigned char
+exm_symbol_index_find(const Exm_Symbol_Index *index, unsigned int rva, const char **function, const char **filename, unsigned int *line)
+{
+    const Exm_Symbol_Row *row;
+    unsigned int k;
+    unsigned int i;
+
+    *function = NULL;
+    *filename = NULL;
+    *line = 0;
+
+    if (!index->keys)
+        return 0;
+
+    /* go right while the key is lower or equal to rva */
+    k = 1;
+    while (k <= index->rows_nbr)
+    {
+#ifdef __GNUC__
+        __builtin_prefetch(index->keys + 16 * k);
+#endif
+        k = 2 * k + (index->keys[k] <= rva);
+    }
+
+    /*
+     * the first key greater than rva is the last one where the search
+     * went left: remove the right moves, then the left one
+     */
+    while (k & 1)
+        k >>= 1;
+    k >>= 1;
+
+    i = k ? index->order[k] : index->rows_nbr;
+    if (i == 0)
+        return 0;
+
+    row = index->rows + i - 1;
+    if (!row->function && !row->line)
+        return 0;
+
+    if (row->function)
+        *function = index->strings + row->function;
+    if (row->file)
+        *filename = index->strings + row->file;
+    *line = row->line;
+
+    return 1;
+}
+
+/**
+ * @brief Return the number of rows of the given symbol index.
+ *
+ * @param[in] index The index.
+ * @return The number of rows.
+ */
+EXM_API unsigned int
+exm_symbol_index_count(const Exm_Symbol_Index *index)
+{
+    return index->rows_nbr;
+}
+
+/**
+ * @brief Return the memory used by the given symbol index.
+ *
+ * @param[in] index The index.
+ * @return The size in bytes.
+ */
+EXM_API size_t
+exm_symbol_index_memory_get(const Exm_Symbol_Index *index)
+{
+    size_t size;
+
+    size = sizeof(Exm_Symbol_Index) + index->strings_max;
+    size += index->strings_table_size * sizeof(unsigned int);
+    size += index->functions_max * sizeof(Exm_Symbol_Function);
+    size += index->lines_max * sizeof(Exm_Symbol_Line);
+    if (index->rows)
+        size += index->rows_nbr * sizeof(Exm_Symbol_Row);
+    if (index->keys)
+        size += 2 * (index->rows_nbr + 1) * sizeof(unsigned int);
+
+    return size;
+}
+
+/**
+ * @brief Save the given symbol index in a file.
+ *
+ * @param[in] index The built index.
+ * @param[in] filename The file name.
+ * @param[in] key The build id of the module.
+ * @return 1 on success, 0 otherwise.
+ *
+ * This function writes the rows and the strings of the built index
+ * @p index in the file @p filename, with @p key, which identifies
+ * the module whose debug information was read, like the GUID and the
+ * age of its PDB file. The file is written under a temporary name,
+ * then renamed, so that a process never maps a partial file. Use
+ * exm_symbol_index_load() to read it.
+ */
+EXM_API unsigned char
+exm_symbol_index_save(const Exm_Symbol_Index *index, const char *filename, const char *key)
+{
+    Exm_Symbol_File_Header header;
+    FILE *f;
+    char *tmp;
+    size_t l;
+    unsigned int pad = 0;
+    unsigned char res = 0;
+
+    if (!index->built || !index->keys ||
+        (strlen(key) >= EXM_SYMBOL_FILE_KEY_SIZE))
+        return 0;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, EXM_SYMBOL_FILE_MAGIC, sizeof(header.magic));
+    header.bom = EXM_SYMBOL_FILE_BOM;
+    header.rows_nbr = index->rows_nbr;
+    header.strings_size = index->strings_size;
+    strcpy(header.key, key);
+
+    l = strlen(filename);
+    tmp = (char *)malloc(l + 5);
+    if (!tmp)
+        return 0;
+    memcpy(tmp, filename, l);
+    memcpy(tmp + l, ".tmp", 5);
+
+    f = fopen(tmp, "wb");
+    if (!f)
+    {
+        EXM_LOG_WARN("Can not create symbol file %s", tmp);
+        goto free_tmp;
+    }
+
+    if ((fwrite(&header, sizeof(header), 1, f) != 1) ||
+        (fwrite(index->keys, sizeof(unsigned int), index->rows_nbr + 1, f) != index->rows_nbr + 1) ||
+        (fwrite(index->order, sizeof(unsigned int), index->rows_nbr + 1, f) != index->rows_nbr + 1) ||
+        (index->rows_nbr &&
+         (fwrite(index->rows, sizeof(Exm_Symbol_Row), index->rows_nbr, f) != index->rows_nbr)) ||
+        (fwrite(index->strings, 1, index->strings_size, f) != index->strings_size) ||
+        (fwrite(&pad, 1, (4 - (index->strings_size & 3)) & 3, f) != ((4 - (index->strings_size & 3)) & 3)))
+    {
+        EXM_LOG_WARN("Can not write symbol file %s", tmp);
+        fclose(f);
+        remove(tmp);
+        goto free_tmp;
+    }
+
+    if (fclose(f) != 0)
+    {
+        remove(tmp);
+        goto free_tmp;
+    }
+
+#ifdef _WIN32
+    res = MoveFileEx(tmp, filename, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    res = rename(tmp, filename) == 0;
+#endif
+    if (!res)
+    {
+        EXM_LOG_WARN("Can not rename symbol file %s", tmp);
+        remove(tmp);
+    }
+
+  free_tmp:
+    free(tmp);
+
+    return res;
+}
+
+/**
+ * @brief Load a symbol index from a file.
+ *
+ * @param[in] filename The file name.
+ * @param[in] key The build id of the module.
+ * @return The built index, or @c NULL.
+ *
+ * This function maps the file @p filename, written by
+ * exm_symbol_index_save() with the key @p key, and returns an index
+ * whose rows and strings are the ones of the mapping: nothing is
+ * read or copied before a lookup. @c NULL is returned if the file
+ * can not be opened, if it is invalid or if its key is not @p key.
+ * Free the index with exm_symbol_index_free().
+ */
+EXM_API Exm_Symbol_Index *
+exm_symbol_index_load(const char *filename, const char *key)
+{
+    const Exm_Symbol_File_Header *header;
+    Exm_Symbol_Index *index;
+    const unsigned char *base;
+    unsigned long long size;
+    unsigned long long expected;
+    unsigned int i;
+
+    index = (Exm_Symbol_Index *)calloc(1, sizeof(Exm_Symbol_Index));
+    if (!index)
+        return NULL;
+
+    index->map = exm_map_new(filename);
+    if (!index->map)
+        goto free_index;
+
+    base = (const unsigned char *)exm_map_base_get(index->map);
+    size = exm_map_size_get(index->map);
+    header = (const Exm_Symbol_File_Header *)base;
+    if ((size < sizeof(Exm_Symbol_File_Header)) ||
+        (memcmp(header->magic, EXM_SYMBOL_FILE_MAGIC, sizeof(header->magic)) != 0) ||
+        (header->bom != EXM_SYMBOL_FILE_BOM))
+    {
+        EXM_LOG_WARN("%s is not a symbol file", filename);
+        goto del_map;
+    }
+
+    if ((memchr(header->key, 0, sizeof(header->key)) == NULL) ||
+        (strcmp(header->key, key) != 0))
+    {
+        EXM_LOG_DBG("symbol file %s is not the one of %s", filename, key);
+        goto del_map;
+    }
+
+    expected = sizeof(Exm_Symbol_File_Header);
+    expected += 2ULL * ((unsigned long long)header->rows_nbr + 1) * sizeof(unsigned int);
+    expected += (unsigned long long)header->rows_nbr * sizeof(Exm_Symbol_Row);
+    expected += ((unsigned long long)header->strings_size + 3) & ~3ULL;
+    if ((expected != size) || (header->strings_size == 0))
+    {
+        EXM_LOG_WARN("invalid size of symbol file %s", filename);
+        goto del_map;
+    }
+
+    index->rows_nbr = header->rows_nbr;
+    index->strings_size = header->strings_size;
+    index->strings_max = header->strings_size;
+    index->keys = (unsigned int *)(base + sizeof(Exm_Symbol_File_Header));
+    index->order = index->keys + index->rows_nbr + 1;
+    index->rows = (Exm_Symbol_Row *)(index->order + index->rows_nbr + 1);
+    index->strings = (char *)(index->rows + index->rows_nbr);
+    index->built = 1;
+
+    /* the lookups trust the offsets */
+    if (index->strings[0] || index->strings[index->strings_size - 1])
+        goto invalid;
+
+    for (i = 1; i <= index->rows_nbr; i++)
+    {
+        if (index->order[i] >= index->rows_nbr)
+            goto invalid;
+    }
+
+    for (i = 0; i < index->rows_nbr; i++)
+    {
+        if ((index->rows[i].function >= index->strings_size) ||
+            (index->rows[i].file >= index->strings_size))
+            goto invalid;
+    }
+
+    return index;
+
+  invalid:
+    EXM_LOG_WARN("invalid symbol file %s", filename);
+  del_map:
+    exm_map_del(index->map);
+  free_index:
+    free(index);
+
+    return NULL;
+}
+
+/**
+ * @}
+ */
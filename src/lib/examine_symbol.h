@@ -0,0 +1,53 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXAMINE_SYMBOL_H
+#define EXAMINE_SYMBOL_H
+
+#include <stddef.h>
+
+
+typedef struct _Exm_Symbol_Index Exm_Symbol_Index;
+
+EXM_API Exm_Symbol_Index *exm_symbol_index_new(void);
+
+EXM_API void exm_symbol_index_free(Exm_Symbol_Index *index);
+
+EXM_API unsigned int exm_symbol_index_string_add(Exm_Symbol_Index *index, const char *str);
+
+EXM_API unsigned char exm_symbol_index_function_add(Exm_Symbol_Index *index, unsigned int start, unsigned int end, const char *name);
+
+EXM_API unsigned char exm_symbol_index_line_add(Exm_Symbol_Index *index, unsigned int rva, unsigned int file, unsigned int line);
+
+EXM_API unsigned char exm_symbol_index_build(Exm_Symbol_Index *index);
+
+EXM_API unsigned char exm_symbol_index_find(const Exm_Symbol_Index *index, unsigned int rva, const char **function, const char **filename, unsigned int *line);
+
+EXM_API unsigned int exm_symbol_index_count(const Exm_Symbol_Index *index);
+
+EXM_API size_t exm_symbol_index_memory_get(const Exm_Symbol_Index *index);
+
+EXM_API unsigned char exm_symbol_index_save(const Exm_Symbol_Index *index, const char *filename, const char *key);
+
+EXM_API Exm_Symbol_Index *exm_symbol_index_load(const char *filename, const char *key);
+
+
+#endif /* EXAMINE_SYMBOL_H */
@@ -0,0 +1,159 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Examine.h"
+
+#include "examine_private_symbol_cache.h"
+
+
+/*============================================================================*
+ *                                  Local                                     *
+ *============================================================================*/
+
+
+#define EXM_SYMBOL_CACHE_EXT ".exmsym"
+
+static char *
+_exm_symbol_cache_filename_get(const char *dir, const char *key)
+{
+    char *filename;
+    size_t dir_len;
+    size_t key_len;
+
+    dir_len = strlen(dir);
+    key_len = strlen(key);
+    filename = (char *)malloc(dir_len + 1 + key_len + sizeof(EXM_SYMBOL_CACHE_EXT));
+    if (!filename)
+        return NULL;
+
+    memcpy(filename, dir, dir_len);
+    filename[dir_len] = '/';
+    memcpy(filename + dir_len + 1, key, key_len);
+    memcpy(filename + dir_len + 1 + key_len, EXM_SYMBOL_CACHE_EXT, sizeof(EXM_SYMBOL_CACHE_EXT));
+
+    return filename;
+}
+
+
+/*============================================================================*
+ *                                 Global                                     *
+ *============================================================================*/
+
+
+/*
+ * Store in @p key, of size EXM_SYMBOL_CACHE_KEY_SIZE, the build id of
+ * @p pe, written like the symbol stores do: the GUID and the age of
+ * its PDB file if it has a CodeView record, the time stamp and the
+ * size of the image otherwise.
+ */
+void
+exm_symbol_cache_key_get(const Exm_Pe *pe, char *key)
+{
+    const IMAGE_NT_HEADERS *nt_header;
+    GUID guid;
+    DWORD age;
+
+    if (exm_pe_codeview_get(pe, &guid, &age))
+    {
+        snprintf(key, EXM_SYMBOL_CACHE_KEY_SIZE,
+                 "%08X%04X%04X%02X%02X%02X%02X%02X%02X%02X%02X%X",
+                 (unsigned int)guid.Data1, guid.Data2, guid.Data3,
+                 guid.Data4[0], guid.Data4[1], guid.Data4[2], guid.Data4[3],
+                 guid.Data4[4], guid.Data4[5], guid.Data4[6], guid.Data4[7],
+                 (unsigned int)age);
+        return;
+    }
+
+    nt_header = exm_pe_nt_header_get(pe);
+    snprintf(key, EXM_SYMBOL_CACHE_KEY_SIZE, "%08X%X",
+             (unsigned int)nt_header->FileHeader.TimeDateStamp,
+             (unsigned int)nt_header->OptionalHeader.SizeOfImage);
+}
+
+/*
+ * Return the index of the module whose build id is @p key, mapped
+ * from the cache directory @p dir, or NULL if it is not cached.
+ */
+Exm_Symbol_Index *
+exm_symbol_cache_get(const char *dir, const char *key)
+{
+    Exm_Symbol_Index *index;
+    char *filename;
+
+    filename = _exm_symbol_cache_filename_get(dir, key);
+    if (!filename)
+        return NULL;
+
+    /* a missing file is not an error */
+    index = NULL;
+    if (exm_file_size_get(filename) != 0)
+        index = exm_symbol_index_load(filename, key);
+
+    EXM_LOG_DBG("symbol cache %s for %s", index ? "hit" : "miss", key);
+    free(filename);
+
+    return index;
+}
+
+/*
+ * Save the built index @p index of the module whose build id is
+ * @p key in the cache directory @p dir.
+ */
+unsigned char
+exm_symbol_cache_set(const char *dir, const char *key, const Exm_Symbol_Index *index)
+{
+    char *filename;
+    unsigned char res;
+
+    filename = _exm_symbol_cache_filename_get(dir, key);
+    if (!filename)
+        return 0;
+
+    res = exm_symbol_index_save(index, filename, key);
+    free(filename);
+
+    return res;
+}
+
+/*
+ * Return the cache directory, given by the EXM_SYMBOL_CACHE
+ * environment variable, so that it is also known by the process
+ * examine is injected in, or NULL if the cache is not used.
+ */
+const char *
+exm_symbol_cache_dir_get(void)
+{
+    const char *dir;
+
+    dir = getenv("EXM_SYMBOL_CACHE");
+    if (!dir || !*dir)
+        return NULL;
+
+    return dir;
+}
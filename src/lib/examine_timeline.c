@@ -0,0 +1,1149 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef _WIN32
+# ifndef WIN32_LEAN_AND_MEAN
+#  define WIN32_LEAN_AND_MEAN
+# endif
+# include <windows.h>
+# undef WIN32_LEAN_AND_MEAN
+#endif
+
+#include "Examine.h"
+#include "examine_private_map.h"
+#include "examine_private_thread.h"
+
+
+/**
+ * @defgroup Timeline functions
+ *
+ * A timeline records the live heap of a process over time, like the
+ * massif tool of valgrind does. The live bytes are summed by
+ * allocation stack in a table indexed by the stack id, which the
+ * threads update with an atomic operation when a block is added or
+ * removed. A snapshot walks this table only, never the records of the
+ * blocks, and does not stop the other threads.
+ *
+ * The time is the number of bytes allocated since the start. A
+ * snapshot, with the total of the live heap and its largest sites, is
+ * written in the timeline file each time a period elapses, the period
+ * doubling every EXM_TIMELINE_PERIOD_SNAPSHOTS snapshots, so that the
+ * file stays small for the long runs. A snapshot is also taken in
+ * memory each time the live heap grows 1% above the previous peak,
+ * and the last one is written when the timeline is closed, followed by
+ * the frames of the stacks of all the written sites.
+ *
+ * In sampling mode, the recorded blocks stand for 1 / p blocks of
+ * their size, p being the probability that they are recorded.
+ *
+ * The file starts with EXM_TIMELINE_MAGIC, followed by records
+ * starting with a tag. All the numbers are unsigned LEB128, and the
+ * strings are their length followed by their characters:
+ *
+ * header:   version, sample interval
+ * snapshot: 'S', flags, time, bytes, blocks, live sites, sites number,
+ *           then for each site: stack, bytes
+ * stack:    'K', stack, frames number,
+ *           then for each frame: function, file name, line
+ * end:      'E', snapshots number
+ *
+ * @{
+ */
+
+
+/*============================================================================*
+ *                                  Local                                     *
+ *============================================================================*/
+
+
+#define EXM_TIMELINE_MAGIC "EXMT"
+#define EXM_TIMELINE_VERSION 1
+
+#define EXM_TIMELINE_RECORD_SNAPSHOT 'S'
+#define EXM_TIMELINE_RECORD_STACK 'K'
+#define EXM_TIMELINE_RECORD_END 'E'
+
+#define EXM_TIMELINE_CHUNK_SIZE 1024 /* sites, power of 2 */
+#define EXM_TIMELINE_CHUNKS_MAX 4096
+#define EXM_TIMELINE_PERIOD_MIN (64 * 1024)
+#define EXM_TIMELINE_PERIOD_SNAPSHOTS 50
+#define EXM_TIMELINE_PEAK_MIN 4096
+#define EXM_TIMELINE_THREAD_BYTES 4096
+
+/*
+ * The live bytes and blocks and the time are counted by each thread,
+ * and added to the ones of the timeline every EXM_TIMELINE_THREAD_BYTES
+ * bytes, so that the threads do not update them at each block. A
+ * snapshot can then be taken up to that many bytes late for each
+ * thread, but the sites, that it sums, are always up to date.
+ */
+typedef struct
+{
+    unsigned int id; /* id of the timeline */
+    long long bytes;
+    long long blocks;
+    unsigned long long time;
+} Exm_Timeline_Thread;
+
+struct _Exm_Timeline
+{
+    unsigned int id;
+    FILE *file;
+    size_t sample_interval;
+    unsigned long long *chunks[EXM_TIMELINE_CHUNKS_MAX]; /* live bytes by site */
+    unsigned long long bytes;
+    unsigned long long blocks;
+    unsigned long long time;
+    unsigned long long time_next;
+    unsigned long long peak_next;
+    unsigned long long period;
+    unsigned int snapshots_nbr;
+    unsigned int busy; /* set while a snapshot is taken, and once closed */
+    Exm_Timeline_Snapshot snapshot;
+    Exm_Timeline_Snapshot peak;
+    Exm_Timeline_Site snapshot_sites[EXM_TIMELINE_SITES_MAX];
+    Exm_Timeline_Site peak_sites[EXM_TIMELINE_SITES_MAX];
+    unsigned int *stacks; /* stacks of the written sites */
+    size_t stacks_nbr;
+    size_t stacks_max;
+};
+
+typedef struct
+{
+    unsigned int stack;
+    unsigned int frames_nbr;
+    Exm_Timeline_Frame *frames;
+} Exm_Timeline_File_Stack;
+
+struct _Exm_Timeline_File
+{
+    size_t sample_interval;
+    Exm_Timeline_Snapshot *snapshots; /* sorted by time */
+    unsigned int snapshots_nbr;
+    unsigned int snapshots_max;
+    Exm_Timeline_File_Stack *stacks; /* sorted by stack */
+    unsigned int stacks_nbr;
+    unsigned int stacks_max;
+};
+
+/* the bytes and the blocks that a recorded block stands for */
+static void
+_exm_timeline_weight(const Exm_Timeline *timeline, size_t size, unsigned long long *bytes, unsigned long long *blocks)
+{
+    double p;
+
+    if (!timeline->sample_interval || (size == 0))
+    {
+        *bytes = size;
+        *blocks = 1;
+        return;
+    }
+
+    p = -expm1(-(double)size / (double)timeline->sample_interval);
+    *bytes = (unsigned long long)((double)size / p + 0.5);
+    *blocks = (unsigned long long)(1.0 / p + 0.5);
+}
+
+static unsigned int _exm_timeline_ids = 0;
+static EXM_TLS Exm_Timeline_Thread _exm_timeline_thread = { 0, 0, 0, 0 };
+
+static Exm_Timeline_Thread *
+_exm_timeline_thread_get(const Exm_Timeline *timeline)
+{
+    Exm_Timeline_Thread *thread = &_exm_timeline_thread;
+
+    /* the counts of a previous timeline are dropped */
+    if (thread->id != timeline->id)
+    {
+        thread->id = timeline->id;
+        thread->bytes = 0;
+        thread->blocks = 0;
+        thread->time = 0;
+    }
+
+    return thread;
+}
+
+static void
+_exm_timeline_thread_flush(Exm_Timeline *timeline, Exm_Timeline_Thread *thread)
+{
+    EXM_ATOMIC_ADD(&timeline->bytes, (unsigned long long)thread->bytes);
+    EXM_ATOMIC_ADD(&timeline->blocks, (unsigned long long)thread->blocks);
+    EXM_ATOMIC_ADD(&timeline->time, thread->time);
+    thread->bytes = 0;
+    thread->blocks = 0;
+    thread->time = 0;
+}
+
+static unsigned long long *
+_exm_timeline_site_get(Exm_Timeline *timeline, unsigned int stack, unsigned char create)
+{
+    unsigned long long *chunk;
+    unsigned int idx;
+
+    idx = stack / EXM_TIMELINE_CHUNK_SIZE;
+    if (idx >= EXM_TIMELINE_CHUNKS_MAX)
+        return NULL;
+
+    chunk = EXM_ATOMIC_LOAD(timeline->chunks + idx);
+    if (!chunk && create)
+    {
+        unsigned long long *expected = NULL;
+
+        chunk = (unsigned long long *)calloc(EXM_TIMELINE_CHUNK_SIZE,
+                                             sizeof(unsigned long long));
+        if (!chunk)
+            return NULL;
+
+        /* another thread can add the chunk first */
+        if (!EXM_ATOMIC_CAS(timeline->chunks + idx, &expected, chunk))
+        {
+            free(chunk);
+            chunk = expected;
+        }
+    }
+
+    if (!chunk)
+        return NULL;
+
+    return chunk + (stack & (EXM_TIMELINE_CHUNK_SIZE - 1));
+}
+
+/* walk the sites, keeping the largest ones in the snapshot */
+static void
+_exm_timeline_snapshot_take(Exm_Timeline *timeline, Exm_Timeline_Snapshot *snapshot, unsigned long long time)
+{
+    unsigned int i;
+
+    snapshot->time = time;
+    snapshot->bytes = 0;
+    snapshot->blocks = EXM_ATOMIC_LOAD(&timeline->blocks);
+    snapshot->flags = 0;
+    snapshot->sites_live = 0;
+    snapshot->sites_nbr = 0;
+
+    for (i = 0; i < EXM_TIMELINE_CHUNKS_MAX; i++)
+    {
+        const unsigned long long *chunk;
+        unsigned int j;
+
+        chunk = EXM_ATOMIC_LOAD(timeline->chunks + i);
+        if (!chunk)
+            continue;
+
+        for (j = 0; j < EXM_TIMELINE_CHUNK_SIZE; j++)
+        {
+            unsigned long long bytes;
+            unsigned int k;
+
+            bytes = EXM_ATOMIC_LOAD(chunk + j);
+            if (bytes == 0)
+                continue;
+
+            snapshot->bytes += bytes;
+            snapshot->sites_live++;
+
+            if ((snapshot->sites_nbr == EXM_TIMELINE_SITES_MAX) &&
+                (bytes <= snapshot->sites[EXM_TIMELINE_SITES_MAX - 1].bytes))
+                continue;
+
+            /* insertion in the largest sites */
+            k = snapshot->sites_nbr;
+            if (k < EXM_TIMELINE_SITES_MAX)
+                snapshot->sites_nbr++;
+            else
+                k--;
+            for (; (k > 0) && (snapshot->sites[k - 1].bytes < bytes); k--)
+                snapshot->sites[k] = snapshot->sites[k - 1];
+            snapshot->sites[k].stack = i * EXM_TIMELINE_CHUNK_SIZE + j;
+            snapshot->sites[k].bytes = bytes;
+        }
+    }
+}
+
+static void
+_exm_timeline_number_write(FILE *file, unsigned long long n)
+{
+    unsigned char buf[10];
+    int l = 0;
+
+    do
+    {
+        buf[l] = n & 0x7f;
+        n >>= 7;
+        if (n)
+            buf[l] |= 0x80;
+        l++;
+    } while (n);
+
+    fwrite(buf, 1, l, file);
+}
+
+static void
+_exm_timeline_string_write(FILE *file, const char *str)
+{
+    size_t l;
+
+    l = str ? strlen(str) : 0;
+    _exm_timeline_number_write(file, l);
+    if (l)
+        fwrite(str, 1, l, file);
+}
+
+static void
+_exm_timeline_snapshot_write(Exm_Timeline *timeline, const Exm_Timeline_Snapshot *snapshot)
+{
+    unsigned int i;
+
+    fputc(EXM_TIMELINE_RECORD_SNAPSHOT, timeline->file);
+    _exm_timeline_number_write(timeline->file, snapshot->flags);
+    _exm_timeline_number_write(timeline->file, snapshot->time);
+    _exm_timeline_number_write(timeline->file, snapshot->bytes);
+    _exm_timeline_number_write(timeline->file, snapshot->blocks);
+    _exm_timeline_number_write(timeline->file, snapshot->sites_live);
+    _exm_timeline_number_write(timeline->file, snapshot->sites_nbr);
+    for (i = 0; i < snapshot->sites_nbr; i++)
+    {
+        _exm_timeline_number_write(timeline->file, snapshot->sites[i].stack);
+        _exm_timeline_number_write(timeline->file, snapshot->sites[i].bytes);
+    }
+
+    /* the stacks are written when the timeline is closed */
+    if (timeline->stacks_nbr + snapshot->sites_nbr > timeline->stacks_max)
+    {
+        unsigned int *stacks;
+        size_t max;
+
+        max = timeline->stacks_max ? 2 * timeline->stacks_max : 256;
+        stacks = (unsigned int *)realloc(timeline->stacks, max * sizeof(unsigned int));
+        if (!stacks)
+            return;
+
+        timeline->stacks = stacks;
+        timeline->stacks_max = max;
+    }
+
+    for (i = 0; i < snapshot->sites_nbr; i++)
+        timeline->stacks[timeline->stacks_nbr++] = snapshot->sites[i].stack;
+}
+
+static void
+_exm_timeline_peak_set(Exm_Timeline *timeline, const Exm_Timeline_Snapshot *snapshot)
+{
+    unsigned long long next;
+
+    if (snapshot != &timeline->peak)
+    {
+        timeline->peak = *snapshot;
+        timeline->peak.sites = timeline->peak_sites;
+        memcpy(timeline->peak_sites, snapshot->sites,
+               snapshot->sites_nbr * sizeof(Exm_Timeline_Site));
+    }
+    timeline->peak.flags = EXM_TIMELINE_SNAPSHOT_PEAK;
+
+    next = snapshot->bytes + snapshot->bytes / 100 + EXM_TIMELINE_PEAK_MIN;
+    EXM_ATOMIC_STORE(&timeline->peak_next, next);
+}
+
+/*
+ * Only one thread takes a snapshot at a time, the others do not wait
+ * for it, and check again at their next allocation.
+ */
+static void
+_exm_timeline_snapshot(Exm_Timeline *timeline, unsigned long long time)
+{
+    unsigned int busy = 0;
+
+    if (!EXM_ATOMIC_CAS(&timeline->busy, &busy, 1))
+        return;
+
+    if (time >= timeline->time_next)
+    {
+        _exm_timeline_snapshot_take(timeline, &timeline->snapshot, time);
+        _exm_timeline_snapshot_write(timeline, &timeline->snapshot);
+        timeline->snapshots_nbr++;
+        if ((timeline->snapshots_nbr % EXM_TIMELINE_PERIOD_SNAPSHOTS) == 0)
+            timeline->period *= 2;
+        EXM_ATOMIC_STORE(&timeline->time_next, time + timeline->period);
+
+        if (timeline->snapshot.bytes > timeline->peak.bytes)
+            _exm_timeline_peak_set(timeline, &timeline->snapshot);
+    }
+    else if (EXM_ATOMIC_LOAD(&timeline->bytes) >= timeline->peak_next)
+    {
+        _exm_timeline_snapshot_take(timeline, &timeline->peak, time);
+        _exm_timeline_peak_set(timeline, &timeline->peak);
+    }
+
+    EXM_ATOMIC_STORE(&timeline->busy, 0);
+}
+
+static int
+_exm_timeline_stack_cmp(const void *d1, const void *d2)
+{
+    unsigned int s1 = *(const unsigned int *)d1;
+    unsigned int s2 = *(const unsigned int *)d2;
+
+    if (s1 < s2)
+        return -1;
+    else if (s1 > s2)
+        return 1;
+    else
+        return 0;
+}
+
+/* the frames of the stacks of the written sites, each stack once */
+static void
+_exm_timeline_stacks_write(Exm_Timeline *timeline, const Exm_Stack_Depot *depot)
+{
+    Exm_Stack_Symbolizer *symbolizer;
+    size_t nbr;
+    size_t i;
+
+    if (timeline->stacks_nbr == 0)
+        return;
+
+    qsort(timeline->stacks, timeline->stacks_nbr, sizeof(unsigned int),
+          _exm_timeline_stack_cmp);
+    nbr = 1;
+    for (i = 1; i < timeline->stacks_nbr; i++)
+    {
+        if (timeline->stacks[i] != timeline->stacks[nbr - 1])
+            timeline->stacks[nbr++] = timeline->stacks[i];
+    }
+    timeline->stacks_nbr = nbr;
+
+    symbolizer = exm_stack_symbolizer_new();
+    if (!symbolizer)
+        return;
+
+    for (i = 0; i < timeline->stacks_nbr; i++)
+    {
+        const Exm_Stack_Pc *pcs;
+        unsigned int pcs_nbr;
+
+        pcs = exm_stack_depot_get(depot, timeline->stacks[i], &pcs_nbr);
+        if (pcs)
+            exm_stack_symbolizer_add(symbolizer, pcs, pcs_nbr);
+    }
+    exm_stack_symbolizer_run(symbolizer);
+
+    for (i = 0; i < timeline->stacks_nbr; i++)
+    {
+        const Exm_Stack_Pc *pcs;
+        const Exm_List *iter;
+        Exm_List *frames;
+        unsigned int pcs_nbr;
+
+        pcs = exm_stack_depot_get(depot, timeline->stacks[i], &pcs_nbr);
+        if (!pcs)
+            continue;
+
+        frames = exm_stack_symbolizer_frames_get(symbolizer, pcs, pcs_nbr);
+        fputc(EXM_TIMELINE_RECORD_STACK, timeline->file);
+        _exm_timeline_number_write(timeline->file, timeline->stacks[i]);
+        _exm_timeline_number_write(timeline->file, exm_list_count(frames));
+        for (iter = frames; iter; iter = iter->next)
+        {
+            const Exm_Stack_Data *frame = iter->data;
+
+            _exm_timeline_string_write(timeline->file, exm_stack_data_function_get(frame));
+            _exm_timeline_string_write(timeline->file, exm_stack_data_filename_get(frame));
+            _exm_timeline_number_write(timeline->file, exm_stack_data_line_get(frame));
+        }
+        exm_list_free(frames, exm_stack_data_free);
+    }
+
+    exm_stack_symbolizer_free(symbolizer);
+}
+
+static unsigned char
+_exm_timeline_number_read(const unsigned char **iter, const unsigned char *end, unsigned long long *n)
+{
+    const unsigned char *p = *iter;
+    unsigned int shift = 0;
+
+    *n = 0;
+    while (p < end)
+    {
+        *n |= (unsigned long long)(*p & 0x7f) << shift;
+        if (!(*p++ & 0x80))
+        {
+            *iter = p;
+            return 1;
+        }
+
+        shift += 7;
+        if (shift >= 64)
+            return 0;
+    }
+
+    return 0;
+}
+
+static unsigned char
+_exm_timeline_uint_read(const unsigned char **iter, const unsigned char *end, unsigned int *n)
+{
+    unsigned long long v;
+
+    if (!_exm_timeline_number_read(iter, end, &v) || (v > 0xffffffffULL))
+        return 0;
+
+    *n = (unsigned int)v;
+
+    return 1;
+}
+
+static char *
+_exm_timeline_string_read(const unsigned char **iter, const unsigned char *end)
+{
+    unsigned long long l;
+    char *str;
+
+    if (!_exm_timeline_number_read(iter, end, &l) ||
+        (l > (unsigned long long)(end - *iter)))
+        return NULL;
+
+    str = (char *)malloc(l + 1);
+    if (!str)
+        return NULL;
+
+    memcpy(str, *iter, l);
+    str[l] = '\0';
+    *iter += l;
+
+    return str;
+}
+
+static unsigned char
+_exm_timeline_file_snapshot_read(Exm_Timeline_File *file, const unsigned char **iter, const unsigned char *end)
+{
+    Exm_Timeline_Snapshot *snapshot;
+    unsigned int i;
+
+    if (file->snapshots_nbr == file->snapshots_max)
+    {
+        Exm_Timeline_Snapshot *snapshots;
+        unsigned int max;
+
+        max = file->snapshots_max ? 2 * file->snapshots_max : 64;
+        snapshots = (Exm_Timeline_Snapshot *)realloc(file->snapshots,
+                                                     max * sizeof(Exm_Timeline_Snapshot));
+        if (!snapshots)
+            return 0;
+
+        file->snapshots = snapshots;
+        file->snapshots_max = max;
+    }
+
+    snapshot = file->snapshots + file->snapshots_nbr;
+    if (!_exm_timeline_uint_read(iter, end, &snapshot->flags) ||
+        !_exm_timeline_number_read(iter, end, &snapshot->time) ||
+        !_exm_timeline_number_read(iter, end, &snapshot->bytes) ||
+        !_exm_timeline_number_read(iter, end, &snapshot->blocks) ||
+        !_exm_timeline_uint_read(iter, end, &snapshot->sites_live) ||
+        !_exm_timeline_uint_read(iter, end, &snapshot->sites_nbr) ||
+        (snapshot->sites_nbr > EXM_TIMELINE_SITES_MAX))
+        return 0;
+
+    snapshot->sites = (Exm_Timeline_Site *)malloc(EXM_TIMELINE_SITES_MAX * sizeof(Exm_Timeline_Site));
+    if (!snapshot->sites)
+        return 0;
+
+    for (i = 0; i < snapshot->sites_nbr; i++)
+    {
+        if (!_exm_timeline_uint_read(iter, end, &snapshot->sites[i].stack) ||
+            !_exm_timeline_number_read(iter, end, &snapshot->sites[i].bytes))
+        {
+            free(snapshot->sites);
+            return 0;
+        }
+    }
+
+    file->snapshots_nbr++;
+
+    return 1;
+}
+
+static void
+_exm_timeline_file_stack_free(Exm_Timeline_File_Stack *stack)
+{
+    unsigned int i;
+
+    for (i = 0; i < stack->frames_nbr; i++)
+    {
+        free((char *)stack->frames[i].function);
+        free((char *)stack->frames[i].filename);
+    }
+    free(stack->frames);
+}
+
+static unsigned char
+_exm_timeline_file_stack_read(Exm_Timeline_File *file, const unsigned char **iter, const unsigned char *end)
+{
+    Exm_Timeline_File_Stack *stack;
+    unsigned int i;
+
+    if (file->stacks_nbr == file->stacks_max)
+    {
+        Exm_Timeline_File_Stack *stacks;
+        unsigned int max;
+
+        max = file->stacks_max ? 2 * file->stacks_max : 64;
+        stacks = (Exm_Timeline_File_Stack *)realloc(file->stacks,
+                                                    max * sizeof(Exm_Timeline_File_Stack));
+        if (!stacks)
+            return 0;
+
+        file->stacks = stacks;
+        file->stacks_max = max;
+    }
+
+    stack = file->stacks + file->stacks_nbr;
+    if (!_exm_timeline_uint_read(iter, end, &stack->stack) ||
+        !_exm_timeline_uint_read(iter, end, &stack->frames_nbr) ||
+        (stack->frames_nbr > (unsigned int)(end - *iter)))
+        return 0;
+
+    stack->frames = (Exm_Timeline_Frame *)calloc(stack->frames_nbr ? stack->frames_nbr : 1,
+                                                 sizeof(Exm_Timeline_Frame));
+    if (!stack->frames)
+        return 0;
+
+    for (i = 0; i < stack->frames_nbr; i++)
+    {
+        stack->frames[i].function = _exm_timeline_string_read(iter, end);
+        stack->frames[i].filename = _exm_timeline_string_read(iter, end);
+        if (!stack->frames[i].function || !stack->frames[i].filename ||
+            !_exm_timeline_uint_read(iter, end, &stack->frames[i].line))
+        {
+            /* the frames read so far are freed with the last one */
+            stack->frames_nbr = i + 1;
+            _exm_timeline_file_stack_free(stack);
+            return 0;
+        }
+    }
+
+    file->stacks_nbr++;
+
+    return 1;
+}
+
+static int
+_exm_timeline_file_snapshot_cmp(const void *d1, const void *d2)
+{
+    const Exm_Timeline_Snapshot *s1 = d1;
+    const Exm_Timeline_Snapshot *s2 = d2;
+
+    if (s1->time < s2->time)
+        return -1;
+    else if (s1->time > s2->time)
+        return 1;
+    else
+        return 0;
+}
+
+static int
+_exm_timeline_file_stack_cmp(const void *d1, const void *d2)
+{
+    const Exm_Timeline_File_Stack *s1 = d1;
+    const Exm_Timeline_File_Stack *s2 = d2;
+
+    if (s1->stack < s2->stack)
+        return -1;
+    else if (s1->stack > s2->stack)
+        return 1;
+    else
+        return 0;
+}
+
+
+/*============================================================================*
+ *                                 Global                                     *
+ *============================================================================*/
+
+
+/*============================================================================*
+ *                                   API                                      *
+ *============================================================================*/
+
+
+/**
+ * @brief Return a new timeline written in the given file.
+ *
+ * @param[in] filename The name of the timeline file.
+ * @param[in] sample_interval The mean interval between the sampled
+ * blocks, 0 if all the blocks are added.
+ * @return The new timeline, or @c NULL on error.
+ *
+ * This function creates the file @p filename, replacing an existing
+ * one, and writes its header. The timeline must be closed with
+ * exm_timeline_close(), and freed with exm_timeline_free().
+ */
+EXM_API Exm_Timeline *
+exm_timeline_new(const char *filename, size_t sample_interval)
+{
+    Exm_Timeline *timeline;
+
+    if (!filename)
+        return NULL;
+
+    timeline = (Exm_Timeline *)calloc(1, sizeof(Exm_Timeline));
+    if (!timeline)
+        return NULL;
+
+    timeline->file = fopen(filename, "wb");
+    if (!timeline->file)
+    {
+        EXM_LOG_ERR("Can not create the timeline file %s", filename);
+        free(timeline);
+        return NULL;
+    }
+
+    fwrite(EXM_TIMELINE_MAGIC, 1, sizeof(EXM_TIMELINE_MAGIC) - 1, timeline->file);
+    _exm_timeline_number_write(timeline->file, EXM_TIMELINE_VERSION);
+    _exm_timeline_number_write(timeline->file, sample_interval);
+
+    timeline->sample_interval = sample_interval;
+    timeline->period = EXM_TIMELINE_PERIOD_MIN;
+    timeline->time_next = EXM_TIMELINE_PERIOD_MIN;
+    timeline->peak_next = EXM_TIMELINE_PEAK_MIN;
+    timeline->snapshot.sites = timeline->snapshot_sites;
+    timeline->peak.sites = timeline->peak_sites;
+
+    /* 0 is the id of no timeline in the threads */
+    do
+    {
+        timeline->id = EXM_ATOMIC_ADD(&_exm_timeline_ids, 1) + 1;
+    } while (timeline->id == 0);
+
+    return timeline;
+}
+
+/**
+ * @brief Free the given timeline.
+ *
+ * @param[inout] timeline The timeline.
+ *
+ * This function closes the file of @p timeline if it was not closed
+ * with exm_timeline_close(), without the stacks, and frees
+ * @p timeline. No other thread must use @p timeline. If @p timeline is
+ * @c NULL, this function does nothing.
+ */
+EXM_API void
+exm_timeline_free(Exm_Timeline *timeline)
+{
+    unsigned int i;
+
+    if (!timeline)
+        return;
+
+    if (timeline->file)
+        fclose(timeline->file);
+
+    for (i = 0; i < EXM_TIMELINE_CHUNKS_MAX; i++)
+        free(timeline->chunks[i]);
+    free(timeline->stacks);
+    free(timeline);
+}
+
+/**
+ * @brief Add a block to the given timeline.
+ *
+ * @param[inout] timeline The timeline.
+ * @param[in] stack The id of the allocation stack of the block.
+ * @param[in] size The size of the block.
+ *
+ * This function adds @p size bytes to the live heap of @p timeline and
+ * to the site @p stack, and advances its time. A snapshot is taken by
+ * the calling thread when the period has elapsed, or when the live
+ * heap is above the peak, if no other thread is taking one. The stacks
+ * whose ids are 2^22 or above are not recorded. The time counted by a
+ * thread that exits, less than 4 KB, is lost.
+ */
+EXM_API void
+exm_timeline_block_add(Exm_Timeline *timeline, unsigned int stack, size_t size)
+{
+    Exm_Timeline_Thread *thread;
+    unsigned long long *site;
+    unsigned long long bytes;
+    unsigned long long blocks;
+    unsigned long long live;
+    unsigned long long time;
+
+    site = _exm_timeline_site_get(timeline, stack, 1);
+    if (!site)
+        return;
+
+    _exm_timeline_weight(timeline, size, &bytes, &blocks);
+    EXM_ATOMIC_ADD(site, bytes);
+
+    thread = _exm_timeline_thread_get(timeline);
+    thread->bytes += (long long)bytes;
+    thread->blocks += (long long)blocks;
+    thread->time += bytes;
+    if (thread->time < EXM_TIMELINE_THREAD_BYTES)
+        return;
+
+    _exm_timeline_thread_flush(timeline, thread);
+    live = EXM_ATOMIC_LOAD(&timeline->bytes);
+    time = EXM_ATOMIC_LOAD(&timeline->time);
+
+    if ((time >= EXM_ATOMIC_LOAD(&timeline->time_next)) ||
+        (live >= EXM_ATOMIC_LOAD(&timeline->peak_next)))
+        _exm_timeline_snapshot(timeline, time);
+}
+
+/**
+ * @brief Remove a block from the given timeline.
+ *
+ * @param[inout] timeline The timeline.
+ * @param[in] stack The id of the allocation stack of the block.
+ * @param[in] size The size of the block.
+ *
+ * This function removes from @p timeline a block added with
+ * exm_timeline_block_add(), with the same @p stack and @p size.
+ */
+EXM_API void
+exm_timeline_block_del(Exm_Timeline *timeline, unsigned int stack, size_t size)
+{
+    Exm_Timeline_Thread *thread;
+    unsigned long long *site;
+    unsigned long long bytes;
+    unsigned long long blocks;
+
+    site = _exm_timeline_site_get(timeline, stack, 0);
+    if (!site)
+        return;
+
+    _exm_timeline_weight(timeline, size, &bytes, &blocks);
+    EXM_ATOMIC_ADD(site, 0 - bytes);
+
+    thread = _exm_timeline_thread_get(timeline);
+    thread->bytes -= (long long)bytes;
+    thread->blocks -= (long long)blocks;
+    if (thread->bytes <= -EXM_TIMELINE_THREAD_BYTES)
+        _exm_timeline_thread_flush(timeline, thread);
+}
+
+/**
+ * @brief Write the end of the given timeline.
+ *
+ * @param[inout] timeline The timeline.
+ * @param[in] depot The depot of the stacks of the sites.
+ * @return 1 if the file is written, 0 otherwise.
+ *
+ * This function takes a last snapshot of @p timeline, writes it and
+ * the peak snapshot, then the frames of the stacks of the written
+ * sites, symbolized with their pcs in @p depot, and closes the file.
+ * No snapshot is taken afterwards, but the blocks can still be added
+ * and removed by the other threads.
+ */
+EXM_API unsigned char
+exm_timeline_close(Exm_Timeline *timeline, const Exm_Stack_Depot *depot)
+{
+    Exm_Timeline_Thread *thread;
+    unsigned int busy = 0;
+    unsigned char res;
+
+    if (!timeline)
+        return 0;
+
+    /* it is never released */
+    while (!EXM_ATOMIC_CAS(&timeline->busy, &busy, 1))
+    {
+        busy = 0;
+        EXM_THREAD_YIELD();
+    }
+
+    if (!timeline->file)
+        return 0;
+
+    thread = _exm_timeline_thread_get(timeline);
+    _exm_timeline_thread_flush(timeline, thread);
+
+    _exm_timeline_snapshot_take(timeline, &timeline->snapshot,
+                                EXM_ATOMIC_LOAD(&timeline->time));
+    _exm_timeline_snapshot_write(timeline, &timeline->snapshot);
+    timeline->snapshots_nbr++;
+    if (timeline->snapshot.bytes > timeline->peak.bytes)
+        _exm_timeline_peak_set(timeline, &timeline->snapshot);
+
+    _exm_timeline_snapshot_write(timeline, &timeline->peak);
+    timeline->snapshots_nbr++;
+
+    _exm_timeline_stacks_write(timeline, depot);
+
+    fputc(EXM_TIMELINE_RECORD_END, timeline->file);
+    _exm_timeline_number_write(timeline->file, timeline->snapshots_nbr);
+
+    res = !ferror(timeline->file);
+    if (fclose(timeline->file) != 0)
+        res = 0;
+    timeline->file = NULL;
+
+    if (!res)
+        EXM_LOG_ERR("Can not write the timeline file");
+
+    return res;
+}
+
+/**
+ * @brief Return the peak snapshot of the given timeline.
+ *
+ * @param[in] timeline The timeline.
+ * @return The peak snapshot.
+ *
+ * This function returns the snapshot of the largest live heap that
+ * @p timeline has taken. It must be called once @p timeline is closed.
+ */
+EXM_API const Exm_Timeline_Snapshot *
+exm_timeline_peak_get(const Exm_Timeline *timeline)
+{
+    return &timeline->peak;
+}
+
+/**
+ * @brief Return the number of snapshots written in the given timeline.
+ *
+ * @param[in] timeline The timeline.
+ * @return The number of snapshots.
+ */
+EXM_API unsigned int
+exm_timeline_snapshots_count(const Exm_Timeline *timeline)
+{
+    return EXM_ATOMIC_LOAD(&timeline->snapshots_nbr);
+}
+
+/**
+ * @brief Return the content of the given timeline file.
+ *
+ * @param[in] filename The name of the timeline file.
+ * @return The content of the file, or @c NULL on error.
+ *
+ * This function reads the snapshots and the stacks of the timeline
+ * file @p filename. The file of a process that has not exited is
+ * read up to its last complete snapshot. The content must be freed
+ * with exm_timeline_file_free().
+ */
+EXM_API Exm_Timeline_File *
+exm_timeline_file_new(const char *filename)
+{
+    Exm_Timeline_File *file;
+    Exm_Map *map;
+    const unsigned char *iter;
+    const unsigned char *end;
+    unsigned long long version;
+    unsigned long long interval;
+
+    if (exm_file_size_get(filename) < sizeof(EXM_TIMELINE_MAGIC))
+    {
+        EXM_LOG_ERR("%s is not a timeline file", filename);
+        return NULL;
+    }
+
+    map = exm_map_new(filename);
+    if (!map)
+        return NULL;
+
+    iter = (const unsigned char *)exm_map_base_get(map);
+    end = iter + exm_map_size_get(map);
+    if ((memcmp(iter, EXM_TIMELINE_MAGIC, sizeof(EXM_TIMELINE_MAGIC) - 1) != 0))
+    {
+        EXM_LOG_ERR("%s is not a timeline file", filename);
+        goto del_map;
+    }
+
+    iter += sizeof(EXM_TIMELINE_MAGIC) - 1;
+    if (!_exm_timeline_number_read(&iter, end, &version) ||
+        (version != EXM_TIMELINE_VERSION) ||
+        !_exm_timeline_number_read(&iter, end, &interval))
+    {
+        EXM_LOG_ERR("Version of the timeline file %s not supported", filename);
+        goto del_map;
+    }
+
+    file = (Exm_Timeline_File *)calloc(1, sizeof(Exm_Timeline_File));
+    if (!file)
+        goto del_map;
+
+    file->sample_interval = (size_t)interval;
+
+    while (iter < end)
+    {
+        if (*iter == EXM_TIMELINE_RECORD_SNAPSHOT)
+        {
+            iter++;
+            if (!_exm_timeline_file_snapshot_read(file, &iter, end))
+                break;
+        }
+        else if (*iter == EXM_TIMELINE_RECORD_STACK)
+        {
+            iter++;
+            if (!_exm_timeline_file_stack_read(file, &iter, end))
+                break;
+        }
+        else
+            break;
+    }
+
+    if ((iter >= end) || (*iter != EXM_TIMELINE_RECORD_END))
+        EXM_LOG_WARN("The timeline file %s is not complete", filename);
+
+    exm_map_del(map);
+
+    if (file->snapshots_nbr > 1)
+        qsort(file->snapshots, file->snapshots_nbr, sizeof(Exm_Timeline_Snapshot),
+              _exm_timeline_file_snapshot_cmp);
+    if (file->stacks_nbr > 1)
+        qsort(file->stacks, file->stacks_nbr, sizeof(Exm_Timeline_File_Stack),
+              _exm_timeline_file_stack_cmp);
+
+    return file;
+
+  del_map:
+    exm_map_del(map);
+
+    return NULL;
+}
+
+/**
+ * @brief Free the given timeline file content.
+ *
+ * @param[inout] file The content of the timeline file.
+ *
+ * If @p file is @c NULL, this function does nothing.
+ */
+EXM_API void
+exm_timeline_file_free(Exm_Timeline_File *file)
+{
+    unsigned int i;
+
+    if (!file)
+        return;
+
+    for (i = 0; i < file->stacks_nbr; i++)
+        _exm_timeline_file_stack_free(file->stacks + i);
+    free(file->stacks);
+
+    for (i = 0; i < file->snapshots_nbr; i++)
+        free(file->snapshots[i].sites);
+    free(file->snapshots);
+
+    free(file);
+}
+
+/**
+ * @brief Return the snapshots of the given timeline file.
+ *
+ * @param[in] file The content of the timeline file.
+ * @param[out] nbr The number of snapshots.
+ * @return The snapshots, sorted by time.
+ */
+EXM_API const Exm_Timeline_Snapshot *
+exm_timeline_file_snapshots_get(const Exm_Timeline_File *file, unsigned int *nbr)
+{
+    *nbr = file->snapshots_nbr;
+
+    return file->snapshots;
+}
+
+/**
+ * @brief Return the peak snapshot of the given timeline file.
+ *
+ * @param[in] file The content of the timeline file.
+ * @return The peak snapshot, or @c NULL if there is no snapshot.
+ *
+ * This function returns the largest snapshot of @p file, the peak one
+ * if the process has exited.
+ */
+EXM_API const Exm_Timeline_Snapshot *
+exm_timeline_file_peak_get(const Exm_Timeline_File *file)
+{
+    const Exm_Timeline_Snapshot *peak = NULL;
+    unsigned int i;
+
+    for (i = 0; i < file->snapshots_nbr; i++)
+    {
+        const Exm_Timeline_Snapshot *snapshot = file->snapshots + i;
+
+        if (!peak || (snapshot->bytes > peak->bytes) ||
+            ((snapshot->bytes == peak->bytes) &&
+             (snapshot->flags & EXM_TIMELINE_SNAPSHOT_PEAK)))
+            peak = snapshot;
+    }
+
+    return peak;
+}
+
+/**
+ * @brief Return the frames of a stack of the given timeline file.
+ *
+ * @param[in] file The content of the timeline file.
+ * @param[in] stack The id of the stack.
+ * @param[out] nbr The number of frames.
+ * @return The frames, the allocation function first, or @c NULL if
+ * the stack is not in @p file.
+ */
+EXM_API const Exm_Timeline_Frame *
+exm_timeline_file_frames_get(const Exm_Timeline_File *file, unsigned int stack, unsigned int *nbr)
+{
+    const Exm_Timeline_File_Stack *s;
+    Exm_Timeline_File_Stack key;
+
+    *nbr = 0;
+    key.stack = stack;
+    s = (const Exm_Timeline_File_Stack *)bsearch(&key, file->stacks, file->stacks_nbr,
+                                                 sizeof(Exm_Timeline_File_Stack),
+                                                 _exm_timeline_file_stack_cmp);
+    if (!s)
+        return NULL;
+
+    *nbr = s->frames_nbr;
+
+    return s->frames;
+}
+
+/**
+ * @brief Return the sample interval of the given timeline file.
+ *
+ * @param[in] file The content of the timeline file.
+ * @return The mean interval between the sampled blocks, 0 if all the
+ * blocks are recorded.
+ */
+EXM_API size_t
+exm_timeline_file_sample_interval_get(const Exm_Timeline_File *file)
+{
+    return file->sample_interval;
+}
+
+/**
+ * @}
+ */
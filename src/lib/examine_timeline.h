@@ -0,0 +1,86 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXAMINE_TIMELINE_H
+#define EXAMINE_TIMELINE_H
+
+#include <stddef.h>
+
+
+typedef struct _Exm_Timeline Exm_Timeline;
+typedef struct _Exm_Timeline_File Exm_Timeline_File;
+
+#define EXM_TIMELINE_SITES_MAX 10 /* largest sites in a snapshot */
+
+#define EXM_TIMELINE_SNAPSHOT_PEAK (1 << 0)
+
+typedef struct
+{
+    unsigned int stack; /* id of the allocation stack */
+    unsigned long long bytes;
+} Exm_Timeline_Site;
+
+typedef struct
+{
+    unsigned long long time; /* bytes allocated before the snapshot */
+    unsigned long long bytes; /* live bytes */
+    unsigned long long blocks; /* live blocks */
+    unsigned int flags;
+    unsigned int sites_live; /* sites with live blocks */
+    unsigned int sites_nbr;
+    Exm_Timeline_Site *sites; /* largest first */
+} Exm_Timeline_Snapshot;
+
+typedef struct
+{
+    const char *function;
+    const char *filename;
+    unsigned int line;
+} Exm_Timeline_Frame;
+
+EXM_API Exm_Timeline *exm_timeline_new(const char *filename, size_t sample_interval);
+
+EXM_API void exm_timeline_free(Exm_Timeline *timeline);
+
+EXM_API void exm_timeline_block_add(Exm_Timeline *timeline, unsigned int stack, size_t size);
+
+EXM_API void exm_timeline_block_del(Exm_Timeline *timeline, unsigned int stack, size_t size);
+
+EXM_API unsigned char exm_timeline_close(Exm_Timeline *timeline, const Exm_Stack_Depot *depot);
+
+EXM_API const Exm_Timeline_Snapshot *exm_timeline_peak_get(const Exm_Timeline *timeline);
+
+EXM_API unsigned int exm_timeline_snapshots_count(const Exm_Timeline *timeline);
+
+EXM_API Exm_Timeline_File *exm_timeline_file_new(const char *filename);
+
+EXM_API void exm_timeline_file_free(Exm_Timeline_File *file);
+
+EXM_API const Exm_Timeline_Snapshot *exm_timeline_file_snapshots_get(const Exm_Timeline_File *file, unsigned int *nbr);
+
+EXM_API const Exm_Timeline_Snapshot *exm_timeline_file_peak_get(const Exm_Timeline_File *file);
+
+EXM_API const Exm_Timeline_Frame *exm_timeline_file_frames_get(const Exm_Timeline_File *file, unsigned int stack, unsigned int *nbr);
+
+EXM_API size_t exm_timeline_file_sample_interval_get(const Exm_Timeline_File *file);
+
+
+#endif /* EXAMINE_TIMELINE_H */
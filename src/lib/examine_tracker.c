@@ -0,0 +1,1352 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef _WIN32
+# ifndef WIN32_LEAN_AND_MEAN
+#  define WIN32_LEAN_AND_MEAN
+# endif
+# include <windows.h>
+# undef WIN32_LEAN_AND_MEAN
+#endif
+
+#if defined(__GNUC__) && defined(__SSE2__)
+# define EXM_TRACKER_SSE2
+# include <emmintrin.h>
+#endif
+
+#include "Examine.h"
+#include "examine_private_thread.h"
+
+
+/**
+ * @defgroup Tracker functions
+ *
+ * A tracker records the memory blocks returned by the allocation
+ * functions, keyed by their address. The records have a fixed size
+ * and are stored in open addressing tables with linear probing. To
+ * let several threads allocate and free at the same time, the
+ * addresses are spread over a fixed number of stripes, each with its
+ * own table and its own lock.
+ *
+ * The new blocks are first recorded in a cache owned by the calling
+ * thread, and moved to the stripes in batches when the cache is full,
+ * so that most of the blocks with a short life never leave the
+ * thread. The blocks freed by the thread keep their record in its
+ * cache too, as the allocator often returns their address again soon.
+ * When a block is not found live in the cache of the thread, nor in
+ * the stripes, a newer record can be in the cache of another thread,
+ * so all the caches are flushed before searching again.
+ *
+ * The freed blocks are kept, so that a second free of the same
+ * address can be reported, until the address is returned again by an
+ * allocation function.
+ *
+ * The tracker also defines the layout of the blocks surrounded by
+ * redzones: canary bytes written before and after the block, in the
+ * same allocation, and verified when the block is freed. The redzone
+ * before the block keeps its alignment, and the one after it also
+ * covers the padding up to the next multiple of 16 bytes. Likewise, a
+ * freed block that is not returned to the allocator at once can be
+ * filled with poison bytes, verified when it is returned.
+ *
+ * @{
+ */
+
+
+/*============================================================================*
+ *                                  Local                                     *
+ *============================================================================*/
+
+
+#define EXM_TRACKER_STRIPES_BITS 6
+#define EXM_TRACKER_STRIPES (1 << EXM_TRACKER_STRIPES_BITS)
+#define EXM_TRACKER_TABLE_SIZE_MIN 64
+
+#define EXM_TRACKER_CACHE_SIZE 2048
+#define EXM_TRACKER_CACHE_SLOTS 4096 /* power of 2, at least twice the size */
+
+typedef struct
+{
+    Exm_Lock lock;
+    Exm_Tracker_Block *table; /* address NULL for an empty slot */
+    size_t size; /* power of 2 */
+    size_t count;
+} Exm_Tracker_Stripe;
+
+typedef struct _Exm_Tracker_Cache Exm_Tracker_Cache;
+
+/*
+ * The lock of a cache is taken by its thread, and by the threads that
+ * flush all the caches, so it is almost never contended and is a spin
+ * lock. The address of a freed record can be returned to another
+ * thread meanwhile, so the lookups ignore the freed records of the
+ * cache, and they never replace a live record of the stripes.
+ */
+struct _Exm_Tracker_Cache
+{
+    Exm_Spinlock lock;
+    Exm_Tracker_Cache *next;
+    unsigned int owned; /* protected by the lock of the caches */
+    unsigned int nbr;
+    unsigned short slots[EXM_TRACKER_CACHE_SLOTS]; /* index + 1 of the block, 0 for an empty slot */
+    Exm_Tracker_Block blocks[EXM_TRACKER_CACHE_SIZE];
+    /* used by the flush, too large for the stack of the hooks */
+    unsigned long long hashes[EXM_TRACKER_CACHE_SIZE];
+    unsigned short order[EXM_TRACKER_CACHE_SIZE];
+    unsigned char stripes[EXM_TRACKER_CACHE_SIZE];
+};
+
+/*
+ * The locks are taken in this order: caches, cache, stripe. The
+ * stripe lock is never held when another lock is taken.
+ */
+struct _Exm_Tracker
+{
+    Exm_Tracker_Stripe stripes[EXM_TRACKER_STRIPES];
+    Exm_Lock caches_lock;
+    Exm_Tracker_Cache *caches;
+    unsigned int id;
+    size_t duplicates;
+};
+
+static unsigned int _exm_tracker_ids = 0;
+
+/* the cache of the thread, valid if its id is the one of the tracker */
+static EXM_TLS Exm_Tracker_Cache *_exm_tracker_cache = NULL;
+static EXM_TLS unsigned int _exm_tracker_cache_id = 0;
+
+static EXM_TLS unsigned char _exm_tracker_guard = 0;
+
+/* the canaries are compared by 16 bytes, so the redzones are not shorter */
+#define EXM_TRACKER_REDZONE_MIN 16
+
+static unsigned long long
+_exm_tracker_hash(const void *address)
+{
+    unsigned long long h;
+
+    /*
+     * the blocks are aligned and often allocated at close addresses,
+     * so all the bits are mixed (MurmurHash3 finalizer)
+     */
+    h = (unsigned long long)(uintptr_t)address;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+
+    return h;
+}
+
+static Exm_Tracker_Stripe *
+_exm_tracker_stripe_get(Exm_Tracker *tracker, unsigned long long hash)
+{
+    /* the high bits select the stripe, the low ones the slot */
+    return tracker->stripes + (hash >> (64 - EXM_TRACKER_STRIPES_BITS));
+}
+
+/*
+ * return the slot of address, or the empty slot where it would be
+ * inserted
+ */
+static Exm_Tracker_Block *
+_exm_tracker_stripe_slot_get(const Exm_Tracker_Stripe *stripe, const void *address, unsigned long long hash)
+{
+    size_t idx;
+
+    idx = (size_t)hash & (stripe->size - 1);
+    while (stripe->table[idx].address && (stripe->table[idx].address != address))
+        idx = (idx + 1) & (stripe->size - 1);
+
+    return stripe->table + idx;
+}
+
+static unsigned char
+_exm_tracker_stripe_grow(Exm_Tracker_Stripe *stripe)
+{
+    Exm_Tracker_Block *table;
+    size_t size;
+    size_t i;
+
+    size = stripe->size ? 2 * stripe->size : EXM_TRACKER_TABLE_SIZE_MIN;
+    table = (Exm_Tracker_Block *)calloc(size, sizeof(Exm_Tracker_Block));
+    if (!table)
+        return 0;
+
+    for (i = 0; i < stripe->size; i++)
+    {
+        size_t idx;
+
+        if (!stripe->table[i].address)
+            continue;
+
+        idx = (size_t)_exm_tracker_hash(stripe->table[i].address) & (size - 1);
+        while (table[idx].address)
+            idx = (idx + 1) & (size - 1);
+        table[idx] = stripe->table[i];
+    }
+
+    free(stripe->table);
+    stripe->table = table;
+    stripe->size = size;
+
+    return 1;
+}
+
+static unsigned char
+_exm_tracker_stripe_add(Exm_Tracker_Stripe *stripe, const Exm_Tracker_Block *block, unsigned long long hash, Exm_Tracker_Block *old)
+{
+    Exm_Tracker_Block *slot;
+
+    slot = _exm_tracker_stripe_slot_get(stripe, block->address, hash);
+    if (slot->address)
+    {
+        /* the address of a freed record of a cache has been allocated again */
+        if (block->frees && !slot->frees)
+        {
+            if (old) old->address = NULL;
+            return 1;
+        }
+
+        if (old) *old = *slot;
+    }
+    else
+    {
+        if (old) old->address = NULL;
+
+        /* new address, keep the load factor of the table below 3/4 */
+        if (4 * (stripe->count + 1) > 3 * stripe->size)
+        {
+            if (!_exm_tracker_stripe_grow(stripe))
+                return 0;
+            slot = _exm_tracker_stripe_slot_get(stripe, block->address, hash);
+        }
+        stripe->count++;
+    }
+
+    *slot = *block;
+
+    return 1;
+}
+
+static void
+_exm_tracker_stripe_remove(Exm_Tracker_Stripe *stripe, Exm_Tracker_Block *slot)
+{
+    size_t mask;
+    size_t i;
+    size_t j;
+
+    /*
+     * backward shift deletion: the following records of the cluster
+     * that can not be reached anymore from their home slot are moved
+     * into the hole, so that no tombstone is needed
+     */
+    mask = stripe->size - 1;
+    i = slot - stripe->table;
+    j = i;
+    while (1)
+    {
+        size_t k;
+
+        j = (j + 1) & mask;
+        if (!stripe->table[j].address)
+            break;
+
+        k = (size_t)_exm_tracker_hash(stripe->table[j].address) & mask;
+        if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j)))
+            continue;
+
+        stripe->table[i] = stripe->table[j];
+        i = j;
+    }
+
+    stripe->table[i].address = NULL;
+    stripe->count--;
+}
+
+/* add a record in its stripe, and count the live records it replaces */
+static unsigned char
+_exm_tracker_put(Exm_Tracker *tracker, const Exm_Tracker_Block *block, unsigned long long hash, Exm_Tracker_Block *old)
+{
+    Exm_Tracker_Stripe *stripe;
+    Exm_Tracker_Block replaced;
+    unsigned char res;
+
+    stripe = _exm_tracker_stripe_get(tracker, hash);
+    EXM_LOCK(&stripe->lock);
+    res = _exm_tracker_stripe_add(stripe, block, hash, &replaced);
+    EXM_UNLOCK(&stripe->lock);
+
+    if (res && replaced.address && (replaced.frees == 0))
+        EXM_ATOMIC_ADD(&tracker->duplicates, 1);
+    if (old) *old = replaced;
+
+    return res;
+}
+
+/* the slot of address in the cache, or the empty slot where it would be inserted */
+static unsigned int
+_exm_tracker_cache_slot_get(const Exm_Tracker_Cache *cache, const void *address, unsigned long long hash)
+{
+    unsigned int idx;
+
+    idx = (unsigned int)hash & (EXM_TRACKER_CACHE_SLOTS - 1);
+    while (cache->slots[idx] && (cache->blocks[cache->slots[idx] - 1].address != address))
+        idx = (idx + 1) & (EXM_TRACKER_CACHE_SLOTS - 1);
+
+    return idx;
+}
+
+static void
+_exm_tracker_cache_remove(Exm_Tracker_Cache *cache, unsigned int slot)
+{
+    unsigned int idx;
+    unsigned int i;
+    unsigned int j;
+
+    idx = cache->slots[slot] - 1;
+
+    /* backward shift deletion, like in the stripes */
+    i = slot;
+    j = i;
+    while (1)
+    {
+        unsigned int k;
+
+        j = (j + 1) & (EXM_TRACKER_CACHE_SLOTS - 1);
+        if (!cache->slots[j])
+            break;
+
+        k = (unsigned int)_exm_tracker_hash(cache->blocks[cache->slots[j] - 1].address) & (EXM_TRACKER_CACHE_SLOTS - 1);
+        if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j)))
+            continue;
+
+        cache->slots[i] = cache->slots[j];
+        i = j;
+    }
+    cache->slots[i] = 0;
+
+    /* the last block fills the hole in the array */
+    cache->nbr--;
+    if (idx != cache->nbr)
+    {
+        const void *address;
+
+        address = cache->blocks[cache->nbr].address;
+        cache->blocks[idx] = cache->blocks[cache->nbr];
+        slot = _exm_tracker_cache_slot_get(cache, address, _exm_tracker_hash(address));
+        cache->slots[slot] = (unsigned short)(idx + 1);
+    }
+}
+
+static void
+_exm_tracker_cache_flush(Exm_Tracker *tracker, Exm_Tracker_Cache *cache)
+{
+    unsigned long long *hashes = cache->hashes;
+    unsigned short *order = cache->order;
+    unsigned char *stripes = cache->stripes;
+    unsigned int starts[EXM_TRACKER_STRIPES + 1];
+    unsigned int i;
+    unsigned int s;
+
+    if (cache->nbr == 0)
+        return;
+
+    /* the blocks are sorted by stripe, to lock each stripe once */
+    memset(starts, 0, sizeof(starts));
+    for (i = 0; i < cache->nbr; i++)
+    {
+        hashes[i] = _exm_tracker_hash(cache->blocks[i].address);
+        stripes[i] = (unsigned char)(hashes[i] >> (64 - EXM_TRACKER_STRIPES_BITS));
+        starts[stripes[i] + 1]++;
+    }
+    for (s = 0; s < EXM_TRACKER_STRIPES; s++)
+        starts[s + 1] += starts[s];
+    for (i = 0; i < cache->nbr; i++)
+        order[starts[stripes[i]]++] = (unsigned short)i;
+
+    /* starts[s] is now the end of the blocks of the stripe s */
+    i = 0;
+    for (s = 0; s < EXM_TRACKER_STRIPES; s++)
+    {
+        Exm_Tracker_Stripe *stripe;
+
+        if (i == starts[s])
+            continue;
+
+        stripe = tracker->stripes + s;
+        EXM_LOCK(&stripe->lock);
+        for (; i < starts[s]; i++)
+        {
+            const Exm_Tracker_Block *block;
+            Exm_Tracker_Block old;
+
+            block = cache->blocks + order[i];
+            if (!_exm_tracker_stripe_add(stripe, block, hashes[order[i]], &old))
+                EXM_LOG_ERR("Can not record the block 0x%p", block->address);
+            else if (old.address && (old.frees == 0))
+                EXM_ATOMIC_ADD(&tracker->duplicates, 1);
+        }
+        EXM_UNLOCK(&stripe->lock);
+    }
+
+    cache->nbr = 0;
+    memset(cache->slots, 0, sizeof(cache->slots));
+}
+
+static void
+_exm_tracker_caches_flush(Exm_Tracker *tracker)
+{
+    Exm_Tracker_Cache *cache;
+
+    EXM_LOCK(&tracker->caches_lock);
+    for (cache = tracker->caches; cache; cache = cache->next)
+    {
+        EXM_SPINLOCK(&cache->lock);
+        _exm_tracker_cache_flush(tracker, cache);
+        EXM_SPINUNLOCK(&cache->lock);
+    }
+    EXM_UNLOCK(&tracker->caches_lock);
+}
+
+/* the cache of the calling thread, NULL on memory error */
+static Exm_Tracker_Cache *
+_exm_tracker_cache_get(Exm_Tracker *tracker)
+{
+    Exm_Tracker_Cache *cache;
+
+    if (_exm_tracker_cache_id == tracker->id)
+        return _exm_tracker_cache;
+
+    /* the cache released by a finished thread is reused */
+    EXM_LOCK(&tracker->caches_lock);
+    for (cache = tracker->caches; cache; cache = cache->next)
+    {
+        if (!cache->owned)
+            break;
+    }
+
+    if (!cache)
+    {
+        cache = (Exm_Tracker_Cache *)calloc(1, sizeof(Exm_Tracker_Cache));
+        if (!cache)
+        {
+            EXM_UNLOCK(&tracker->caches_lock);
+            return NULL;
+        }
+
+        EXM_SPINLOCK_INIT(&cache->lock);
+        cache->next = tracker->caches;
+        tracker->caches = cache;
+    }
+    cache->owned = 1;
+    EXM_UNLOCK(&tracker->caches_lock);
+
+    _exm_tracker_cache = cache;
+    _exm_tracker_cache_id = tracker->id;
+
+    return cache;
+}
+
+/*
+ * Look for the live record of address in the cache of the thread. If
+ * it is found, the cache is returned locked, and the slot is stored in
+ * slot.
+ */
+static Exm_Tracker_Cache *
+_exm_tracker_cache_find(Exm_Tracker *tracker, const void *address, unsigned long long hash, unsigned int *slot)
+{
+    Exm_Tracker_Cache *cache;
+
+    cache = _exm_tracker_cache_get(tracker);
+    if (!cache)
+        return NULL;
+
+    EXM_SPINLOCK(&cache->lock);
+    *slot = _exm_tracker_cache_slot_get(cache, address, hash);
+    if (cache->slots[*slot] && (cache->blocks[cache->slots[*slot] - 1].frees == 0))
+        return cache;
+    EXM_SPINUNLOCK(&cache->lock);
+
+    return NULL;
+}
+
+/*
+ * Look for the record of address in its stripe, which is returned
+ * locked. When the record is not found, or found freed, a newer one
+ * can be in the cache of another thread, so all the caches are
+ * flushed before looking again.
+ */
+static Exm_Tracker_Block *
+_exm_tracker_stripe_find(Exm_Tracker *tracker, Exm_Tracker_Stripe *stripe, const void *address, unsigned long long hash)
+{
+    Exm_Tracker_Block *s;
+
+    EXM_LOCK(&stripe->lock);
+    s = _exm_tracker_stripe_slot_get(stripe, address, hash);
+    if (s->address && (s->frees == 0))
+        return s;
+    EXM_UNLOCK(&stripe->lock);
+
+    _exm_tracker_caches_flush(tracker);
+
+    EXM_LOCK(&stripe->lock);
+    s = _exm_tracker_stripe_slot_get(stripe, address, hash);
+
+    return s->address ? s : NULL;
+}
+
+/* 1 if the len bytes at p are all equal to byte, with as few loads as possible */
+static unsigned char
+_exm_tracker_bytes_intact(const unsigned char *p, size_t len, unsigned char byte)
+{
+#ifdef EXM_TRACKER_SSE2
+    __m128i bytes;
+    __m128i diff;
+#else
+    unsigned long long bytes;
+    unsigned long long diff;
+    unsigned long long w;
+#endif
+    size_t i;
+
+    if (len < 16)
+    {
+        for (i = 0; i < len; i++)
+        {
+            if (p[i] != byte)
+                return 0;
+        }
+        return 1;
+    }
+
+    /* the last load overlaps the previous one if len is not a multiple of the load */
+#ifdef EXM_TRACKER_SSE2
+    bytes = _mm_set1_epi8((char)byte);
+    diff = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(p + len - 16)), bytes);
+    for (i = 0; i + 16 < len; i += 16)
+        diff = _mm_or_si128(diff,
+                            _mm_xor_si128(_mm_loadu_si128((const __m128i *)(p + i)), bytes));
+
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) == 0xffff;
+#else
+    memset(&bytes, byte, sizeof(bytes));
+    memcpy(&w, p + len - sizeof(w), sizeof(w));
+    diff = w ^ bytes;
+    for (i = 0; i + sizeof(w) < len; i += sizeof(w))
+    {
+        memcpy(&w, p + i, sizeof(w));
+        diff |= w ^ bytes;
+    }
+
+    return diff == 0;
+#endif
+}
+
+/*
+ * The number of bytes different from byte in the len bytes at p, the
+ * first one being at *first, if any.
+ */
+static size_t
+_exm_tracker_bytes_count(const unsigned char *p, size_t len, unsigned char byte, size_t *first)
+{
+    size_t count = 0;
+    size_t i;
+
+    if (_exm_tracker_bytes_intact(p, len, byte))
+        return 0;
+
+    for (i = len; i > 0; i--)
+    {
+        if (p[i - 1] != byte)
+        {
+            *first = i - 1;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+
+/*============================================================================*
+ *                                 Global                                     *
+ *============================================================================*/
+
+
+/*============================================================================*
+ *                                   API                                      *
+ *============================================================================*/
+
+
+/**
+ * @brief Return a new empty tracker.
+ *
+ * @return The new tracker, or @c NULL on error.
+ *
+ * The tracker must be freed with exm_tracker_free().
+ */
+EXM_API Exm_Tracker *
+exm_tracker_new(void)
+{
+    Exm_Tracker *tracker;
+    int i;
+
+    tracker = (Exm_Tracker *)calloc(1, sizeof(Exm_Tracker));
+    if (!tracker)
+        return NULL;
+
+    if (!EXM_LOCK_INIT(&tracker->caches_lock))
+    {
+        free(tracker);
+        return NULL;
+    }
+
+    for (i = 0; i < EXM_TRACKER_STRIPES; i++)
+    {
+        if (!_exm_tracker_stripe_grow(tracker->stripes + i))
+            goto free_stripes;
+
+        if (!EXM_LOCK_INIT(&tracker->stripes[i].lock))
+        {
+            free(tracker->stripes[i].table);
+            goto free_stripes;
+        }
+    }
+
+    /* 0 is the id of no tracker in the threads */
+    do
+    {
+        tracker->id = EXM_ATOMIC_ADD(&_exm_tracker_ids, 1) + 1;
+    } while (tracker->id == 0);
+
+    return tracker;
+
+  free_stripes:
+    while (--i >= 0)
+    {
+        EXM_LOCK_SHUTDOWN(&tracker->stripes[i].lock);
+        free(tracker->stripes[i].table);
+    }
+    EXM_LOCK_SHUTDOWN(&tracker->caches_lock);
+    free(tracker);
+
+    return NULL;
+}
+
+/**
+ * @brief Free the given tracker.
+ *
+ * @param[inout] tracker The tracker.
+ *
+ * This function frees @p tracker, all its records and the caches of
+ * the threads. No other thread must use @p tracker. If @p tracker is
+ * @c NULL, this function does nothing.
+ */
+EXM_API void
+exm_tracker_free(Exm_Tracker *tracker)
+{
+    Exm_Tracker_Cache *cache;
+    int i;
+
+    if (!tracker)
+        return;
+
+    cache = tracker->caches;
+    while (cache)
+    {
+        Exm_Tracker_Cache *next;
+
+        next = cache->next;
+        free(cache);
+        cache = next;
+    }
+
+    if (_exm_tracker_cache_id == tracker->id)
+    {
+        _exm_tracker_cache = NULL;
+        _exm_tracker_cache_id = 0;
+    }
+
+    for (i = 0; i < EXM_TRACKER_STRIPES; i++)
+    {
+        EXM_LOCK_SHUTDOWN(&tracker->stripes[i].lock);
+        free(tracker->stripes[i].table);
+    }
+
+    EXM_LOCK_SHUTDOWN(&tracker->caches_lock);
+    free(tracker);
+}
+
+/**
+ * @brief Record an allocated block in the given tracker.
+ *
+ * @param[inout] tracker The tracker.
+ * @param[in] block The record of the block.
+ * @param[out] old The replaced record, can be @c NULL.
+ * @return 1 on success, 0 otherwise.
+ *
+ * This function copies the record @p block in the cache of the
+ * calling thread. If a record of the same address is in the cache,
+ * it is replaced, and copied in @p old if not @c NULL, otherwise the
+ * address of @p old is set to @c NULL. If such a record is live, the
+ * address has been returned twice by the allocator. The live records
+ * replaced when the cache is moved to the stripes are only counted,
+ * see exm_tracker_duplicates_get(). If the address of @p block is
+ * @c NULL, or on memory error, 0 is returned.
+ */
+EXM_API unsigned char
+exm_tracker_block_add(Exm_Tracker *tracker, const Exm_Tracker_Block *block, Exm_Tracker_Block *old)
+{
+    Exm_Tracker_Cache *cache;
+    unsigned long long hash;
+    unsigned int slot;
+
+    if (!tracker || !block || !block->address)
+        return 0;
+
+    hash = _exm_tracker_hash(block->address);
+    cache = _exm_tracker_cache_get(tracker);
+    if (!cache)
+        return _exm_tracker_put(tracker, block, hash, old);
+
+    EXM_SPINLOCK(&cache->lock);
+    slot = _exm_tracker_cache_slot_get(cache, block->address, hash);
+    if (cache->slots[slot])
+    {
+        Exm_Tracker_Block *cached;
+
+        cached = cache->blocks + cache->slots[slot] - 1;
+        if (old) *old = *cached;
+        if (cached->frees == 0)
+            EXM_ATOMIC_ADD(&tracker->duplicates, 1);
+        *cached = *block;
+    }
+    else
+    {
+        if (old) old->address = NULL;
+
+        if (cache->nbr == EXM_TRACKER_CACHE_SIZE)
+        {
+            _exm_tracker_cache_flush(tracker, cache);
+            slot = _exm_tracker_cache_slot_get(cache, block->address, hash);
+        }
+
+        cache->blocks[cache->nbr++] = *block;
+        cache->slots[slot] = (unsigned short)cache->nbr;
+    }
+    EXM_SPINUNLOCK(&cache->lock);
+
+    return 1;
+}
+
+/**
+ * @brief Record the free of a block in the given tracker.
+ *
+ * @param[inout] tracker The tracker.
+ * @param[in] address The address of the block.
+ * @param[in] stack The id of the stack of the free.
+ * @param[out] block The updated record, can be @c NULL.
+ * @return 1 if the block is found, 0 otherwise.
+ *
+ * This function increments the number of frees of the record of
+ * @p address and, if it is the first free, sets its stack to
+ * @p stack. The record is kept and copied in @p block if not
+ * @c NULL, so that the caller can report a multiple free, when the
+ * number of frees is greater than 1. If no block is recorded at
+ * @p address, 0 is returned.
+ */
+EXM_API unsigned char
+exm_tracker_block_release(Exm_Tracker *tracker, const void *address, unsigned int stack, Exm_Tracker_Block *block)
+{
+    Exm_Tracker_Stripe *stripe;
+    Exm_Tracker_Cache *cache;
+    Exm_Tracker_Block *s;
+    unsigned long long hash;
+    unsigned int slot;
+    unsigned char res = 0;
+
+    if (!tracker || !address)
+        return 0;
+
+    hash = _exm_tracker_hash(address);
+    cache = _exm_tracker_cache_find(tracker, address, hash, &slot);
+    if (cache)
+    {
+        Exm_Tracker_Block *freed;
+
+        /* the freed record is kept in the cache */
+        freed = cache->blocks + cache->slots[slot] - 1;
+        freed->stack_first_free = stack;
+        freed->frees = 1;
+        if (block) *block = *freed;
+        EXM_SPINUNLOCK(&cache->lock);
+
+        return 1;
+    }
+
+    stripe = _exm_tracker_stripe_get(tracker, hash);
+    s = _exm_tracker_stripe_find(tracker, stripe, address, hash);
+    if (s)
+    {
+        if (s->frees == 0)
+            s->stack_first_free = stack;
+        if (s->frees < 0xffff)
+            s->frees++;
+        if (block) *block = *s;
+        res = 1;
+    }
+    EXM_UNLOCK(&stripe->lock);
+
+    return res;
+}
+
+/**
+ * @brief Record the reallocation of a block in the given tracker.
+ *
+ * @param[inout] tracker The tracker.
+ * @param[in] old_address The address of the block.
+ * @param[in] new_address The new address of the block.
+ * @param[in] size The new size of the block.
+ * @param[out] block The record before the reallocation, can be @c NULL.
+ * @return 1 if the block is found, 0 otherwise.
+ *
+ * This function moves the record of @p old_address to
+ * @p new_address, replacing any record of @p new_address, and sets
+ * its size to @p size. The other fields are kept. The record before
+ * the move is copied in @p block if not @c NULL. If no block is
+ * recorded at @p old_address, or on memory error, 0 is returned and
+ * the tracker is not modified.
+ */
+EXM_API unsigned char
+exm_tracker_block_move(Exm_Tracker *tracker, const void *old_address, const void *new_address, size_t size, Exm_Tracker_Block *block)
+{
+    Exm_Tracker_Stripe *stripe;
+    Exm_Tracker_Cache *cache;
+    Exm_Tracker_Block *s;
+    Exm_Tracker_Block orig;
+    Exm_Tracker_Block moved;
+    unsigned long long hash;
+    unsigned int slot;
+
+    if (!tracker || !old_address || !new_address)
+        return 0;
+
+    hash = _exm_tracker_hash(old_address);
+    cache = _exm_tracker_cache_find(tracker, old_address, hash, &slot);
+    if (cache)
+    {
+        Exm_Tracker_Block *cached;
+
+        cached = cache->blocks + cache->slots[slot] - 1;
+        if (block) *block = *cached;
+
+        if (new_address == old_address)
+        {
+            cached->size = size;
+            EXM_SPINUNLOCK(&cache->lock);
+            return 1;
+        }
+
+        moved = *cached;
+        _exm_tracker_cache_remove(cache, slot);
+        EXM_SPINUNLOCK(&cache->lock);
+
+        moved.address = new_address;
+        moved.size = size;
+
+        return exm_tracker_block_add(tracker, &moved, NULL);
+    }
+
+    stripe = _exm_tracker_stripe_get(tracker, hash);
+    s = _exm_tracker_stripe_find(tracker, stripe, old_address, hash);
+    if (!s)
+    {
+        EXM_UNLOCK(&stripe->lock);
+        return 0;
+    }
+
+    orig = *s;
+    if (block) *block = orig;
+
+    if (new_address == old_address)
+    {
+        s->size = size;
+        EXM_UNLOCK(&stripe->lock);
+        return 1;
+    }
+
+    _exm_tracker_stripe_remove(stripe, s);
+    EXM_UNLOCK(&stripe->lock);
+
+    /*
+     * the old block belongs to the caller until the reallocation
+     * returns, so no other thread can use its address meanwhile
+     */
+    moved = orig;
+    moved.address = new_address;
+    moved.size = size;
+    if (exm_tracker_block_add(tracker, &moved, NULL))
+        return 1;
+
+    /* the table of the stripe is not shrunk, so it can not fail */
+    _exm_tracker_put(tracker, &orig, hash, NULL);
+
+    return 0;
+}
+
+/**
+ * @brief Retrieve the record of a block of the given tracker.
+ *
+ * @param[inout] tracker The tracker.
+ * @param[in] address The address of the block.
+ * @param[out] block The record.
+ * @return 1 if the block is found, 0 otherwise.
+ */
+EXM_API unsigned char
+exm_tracker_block_get(Exm_Tracker *tracker, const void *address, Exm_Tracker_Block *block)
+{
+    Exm_Tracker_Stripe *stripe;
+    Exm_Tracker_Cache *cache;
+    Exm_Tracker_Block *s;
+    unsigned long long hash;
+    unsigned int slot;
+    unsigned char res = 0;
+
+    if (!tracker || !address)
+        return 0;
+
+    hash = _exm_tracker_hash(address);
+    cache = _exm_tracker_cache_find(tracker, address, hash, &slot);
+    if (cache)
+    {
+        if (block) *block = cache->blocks[cache->slots[slot] - 1];
+        EXM_SPINUNLOCK(&cache->lock);
+        return 1;
+    }
+
+    stripe = _exm_tracker_stripe_get(tracker, hash);
+    s = _exm_tracker_stripe_find(tracker, stripe, address, hash);
+    if (s)
+    {
+        if (block) *block = *s;
+        res = 1;
+    }
+    EXM_UNLOCK(&stripe->lock);
+
+    return res;
+}
+
+/**
+ * @brief Remove the record of a block from the given tracker.
+ *
+ * @param[inout] tracker The tracker.
+ * @param[in] address The address of the block.
+ * @return 1 if the block is found, 0 otherwise.
+ */
+EXM_API unsigned char
+exm_tracker_block_del(Exm_Tracker *tracker, const void *address)
+{
+    Exm_Tracker_Stripe *stripe;
+    Exm_Tracker_Cache *cache;
+    Exm_Tracker_Block *s;
+    unsigned long long hash;
+    unsigned int slot;
+    unsigned char res = 0;
+
+    if (!tracker || !address)
+        return 0;
+
+    hash = _exm_tracker_hash(address);
+    cache = _exm_tracker_cache_find(tracker, address, hash, &slot);
+    if (cache)
+    {
+        _exm_tracker_cache_remove(cache, slot);
+        EXM_SPINUNLOCK(&cache->lock);
+        return 1;
+    }
+
+    stripe = _exm_tracker_stripe_get(tracker, hash);
+    s = _exm_tracker_stripe_find(tracker, stripe, address, hash);
+    if (s)
+    {
+        _exm_tracker_stripe_remove(stripe, s);
+        res = 1;
+    }
+    EXM_UNLOCK(&stripe->lock);
+
+    return res;
+}
+
+/**
+ * @brief Call a function on each record of the given tracker.
+ *
+ * @param[inout] tracker The tracker.
+ * @param[in] cb The function to call.
+ * @param[in] data The data passed to @p cb.
+ *
+ * This function moves the caches of all the threads to the stripes,
+ * then calls @p cb on each record of @p tracker, live or freed, in no
+ * particular order. The stripe of the record is locked during the
+ * call, so @p cb must not call the tracker functions.
+ */
+EXM_API void
+exm_tracker_foreach(Exm_Tracker *tracker, Exm_Tracker_Cb cb, void *data)
+{
+    int i;
+
+    if (!tracker || !cb)
+        return;
+
+    _exm_tracker_caches_flush(tracker);
+
+    for (i = 0; i < EXM_TRACKER_STRIPES; i++)
+    {
+        Exm_Tracker_Stripe *stripe;
+        size_t j;
+
+        stripe = tracker->stripes + i;
+        EXM_LOCK(&stripe->lock);
+        for (j = 0; j < stripe->size; j++)
+        {
+            if (stripe->table[j].address)
+                cb(stripe->table + j, data);
+        }
+        EXM_UNLOCK(&stripe->lock);
+    }
+}
+
+/**
+ * @brief Return the number of records of the given tracker.
+ *
+ * @param[inout] tracker The tracker.
+ * @return The number of records, live or freed.
+ *
+ * This function moves the caches of all the threads to the stripes.
+ */
+EXM_API size_t
+exm_tracker_count(Exm_Tracker *tracker)
+{
+    size_t count = 0;
+    int i;
+
+    if (!tracker)
+        return 0;
+
+    _exm_tracker_caches_flush(tracker);
+
+    for (i = 0; i < EXM_TRACKER_STRIPES; i++)
+    {
+        EXM_LOCK(&tracker->stripes[i].lock);
+        count += tracker->stripes[i].count;
+        EXM_UNLOCK(&tracker->stripes[i].lock);
+    }
+
+    return count;
+}
+
+/**
+ * @brief Return the number of addresses allocated twice.
+ *
+ * @param[inout] tracker The tracker.
+ * @return The number of live records replaced by a new one.
+ *
+ * This function moves the caches of all the threads to the stripes,
+ * and returns the number of times a block has been recorded at the
+ * address of a live block, which means that the allocator returned
+ * the same address twice, or that a free has been missed.
+ */
+EXM_API size_t
+exm_tracker_duplicates_get(Exm_Tracker *tracker)
+{
+    if (!tracker)
+        return 0;
+
+    _exm_tracker_caches_flush(tracker);
+
+    return EXM_ATOMIC_LOAD(&tracker->duplicates);
+}
+
+/**
+ * @brief Return the memory used by the given tracker.
+ *
+ * @param[inout] tracker The tracker.
+ * @return The size in bytes of the memory allocated by @p tracker.
+ */
+EXM_API size_t
+exm_tracker_memory_get(Exm_Tracker *tracker)
+{
+    Exm_Tracker_Cache *cache;
+    size_t size;
+    int i;
+
+    if (!tracker)
+        return 0;
+
+    size = sizeof(Exm_Tracker);
+    for (i = 0; i < EXM_TRACKER_STRIPES; i++)
+    {
+        EXM_LOCK(&tracker->stripes[i].lock);
+        size += tracker->stripes[i].size * sizeof(Exm_Tracker_Block);
+        EXM_UNLOCK(&tracker->stripes[i].lock);
+    }
+
+    EXM_LOCK(&tracker->caches_lock);
+    for (cache = tracker->caches; cache; cache = cache->next)
+        size += sizeof(Exm_Tracker_Cache);
+    EXM_UNLOCK(&tracker->caches_lock);
+
+    return size;
+}
+
+/**
+ * @brief Release the cache of the calling thread.
+ *
+ * @param[inout] tracker The tracker.
+ *
+ * This function moves the records of the cache of the calling thread
+ * to the stripes, and lets another thread reuse the cache. It should
+ * be called when a thread exits.
+ */
+EXM_API void
+exm_tracker_thread_flush(Exm_Tracker *tracker)
+{
+    Exm_Tracker_Cache *cache;
+
+    if (!tracker || (_exm_tracker_cache_id != tracker->id))
+        return;
+
+    cache = _exm_tracker_cache;
+    EXM_SPINLOCK(&cache->lock);
+    _exm_tracker_cache_flush(tracker, cache);
+    EXM_SPINUNLOCK(&cache->lock);
+
+    EXM_LOCK(&tracker->caches_lock);
+    cache->owned = 0;
+    EXM_UNLOCK(&tracker->caches_lock);
+
+    _exm_tracker_cache = NULL;
+    _exm_tracker_cache_id = 0;
+}
+
+/**
+ * @brief Return the size of a block surrounded by redzones.
+ *
+ * @param[in] size The size of the block.
+ * @param[in] redzone The minimal size of the redzones.
+ * @param[in] alignment The alignment of the block, or 0.
+ * @param[out] front The size of the redzone before the block.
+ * @return The size to allocate, or 0 if it overflows.
+ *
+ * This function returns the number of bytes to allocate for a block
+ * of @p size bytes with redzones of at least @p redzone bytes. The
+ * redzone before the block, stored in @p front, is a multiple of 16
+ * and of @p alignment, so that the block is as aligned as the
+ * allocated memory. The redzone after the block has the same size,
+ * plus the padding of the block to a multiple of 16 bytes.
+ */
+EXM_API size_t
+exm_tracker_redzone_size_get(size_t size, size_t redzone, size_t alignment, unsigned int *front)
+{
+    size_t f;
+    size_t padded;
+
+    if (alignment < EXM_TRACKER_REDZONE_MIN)
+        alignment = EXM_TRACKER_REDZONE_MIN;
+    if (redzone < EXM_TRACKER_REDZONE_MIN)
+        redzone = EXM_TRACKER_REDZONE_MIN;
+    /* the redzone before the block is stored in an unsigned int */
+    if ((redzone > 0x40000000) || (alignment > 0x40000000))
+        return 0;
+
+    /* alignment is a power of 2 */
+    f = (redzone + alignment - 1) & ~(alignment - 1);
+    padded = (size + 15) & ~(size_t)15;
+    if ((padded < size) || (padded > (size_t)-1 - 2 * f))
+        return 0;
+
+    *front = (unsigned int)f;
+
+    return f + padded + f;
+}
+
+/**
+ * @brief Write the redzones of a block.
+ *
+ * @param[out] base The memory allocated for the block and its redzones.
+ * @param[in] size The size of the block.
+ * @param[in] front The size of the redzone before the block.
+ * @return The address of the block.
+ *
+ * This function fills the redzones of the block of @p size bytes in
+ * @p base with canaries, with the layout returned by
+ * exm_tracker_redzone_size_get(). The block itself is not modified.
+ */
+EXM_API void *
+exm_tracker_redzone_set(void *base, size_t size, unsigned int front)
+{
+    unsigned char *data;
+
+    data = (unsigned char *)base + front;
+    memset(base, EXM_TRACKER_REDZONE_BYTE, front);
+    memset(data + size, EXM_TRACKER_REDZONE_BYTE,
+           front + (((size + 15) & ~(size_t)15) - size));
+
+    return data;
+}
+
+/**
+ * @brief Verify the redzones of a block.
+ *
+ * @param[in] block The record of the block.
+ * @param[out] offset The offset of the first overwritten canary.
+ * @return The number of overwritten canaries.
+ *
+ * This function compares the redzones of @p block to the canaries, and
+ * returns the number of bytes that have been overwritten. If it is not
+ * 0, the offset of the first one from the address of the block is
+ * stored in @p offset, negative before the block. If @p block has no
+ * redzone, 0 is returned.
+ */
+EXM_API size_t
+exm_tracker_redzone_check(const Exm_Tracker_Block *block, long long *offset)
+{
+    const unsigned char *data;
+    size_t before;
+    size_t after;
+    size_t first;
+
+    if (!block || !block->redzone)
+        return 0;
+
+    data = (const unsigned char *)block->address;
+
+    after = _exm_tracker_bytes_count(data + block->size,
+                                     block->redzone + (((block->size + 15) & ~(size_t)15) - block->size),
+                                     EXM_TRACKER_REDZONE_BYTE, &first);
+    if (after > 0)
+        *offset = (long long)(block->size + first);
+
+    /* an overwrite before the block is reported first */
+    before = _exm_tracker_bytes_count(data - block->redzone, block->redzone,
+                                      EXM_TRACKER_REDZONE_BYTE, &first);
+    if (before > 0)
+        *offset = (long long)first - (long long)block->redzone;
+
+    return before + after;
+}
+
+/**
+ * @brief Fill a freed block with poison bytes.
+ *
+ * @param[in] block The record of the block.
+ *
+ * This function fills the @c size bytes at the address of @p block
+ * with #EXM_TRACKER_FREED_BYTE, before the block is kept out of the
+ * allocator for some time. They are verified with
+ * exm_tracker_poison_check().
+ */
+EXM_API void
+exm_tracker_poison_set(const Exm_Tracker_Block *block)
+{
+    if (!block || !block->address)
+        return;
+
+    memset((void *)block->address, EXM_TRACKER_FREED_BYTE, block->size);
+}
+
+/**
+ * @brief Verify the poison bytes of a freed block.
+ *
+ * @param[in] block The record of the block.
+ * @param[out] offset The offset of the first overwritten byte.
+ * @return The number of overwritten bytes.
+ *
+ * This function compares the bytes of @p block, filled by
+ * exm_tracker_poison_set(), to the poison, and returns the number of
+ * bytes that have been written since. If it is not 0, the offset of
+ * the first one from the address of the block is stored in
+ * @p offset.
+ */
+EXM_API size_t
+exm_tracker_poison_check(const Exm_Tracker_Block *block, long long *offset)
+{
+    size_t count;
+    size_t first;
+
+    if (!block || !block->address)
+        return 0;
+
+    count = _exm_tracker_bytes_count((const unsigned char *)block->address,
+                                     block->size, EXM_TRACKER_FREED_BYTE, &first);
+    if (count > 0)
+        *offset = (long long)first;
+
+    return count;
+}
+
+/**
+ * @brief Enter the tracking code in the calling thread.
+ *
+ * @return 1 if the thread was not in the tracking code, 0 otherwise.
+ *
+ * This function marks the calling thread as running the tracking
+ * code, like the hooks of the allocation functions. If it returns 0,
+ * the caller is called from the tracking code itself, for example
+ * when the tracker or the stack capture allocate memory, and it must
+ * not track the call. Otherwise, exm_tracker_guard_leave() must be
+ * called at the end of the tracking code.
+ */
+EXM_API unsigned char
+exm_tracker_guard_enter(void)
+{
+    if (_exm_tracker_guard)
+        return 0;
+
+    _exm_tracker_guard = 1;
+
+    return 1;
+}
+
+/**
+ * @brief Leave the tracking code in the calling thread.
+ *
+ * This function must be called after a successful call to
+ * exm_tracker_guard_enter().
+ */
+EXM_API void
+exm_tracker_guard_leave(void)
+{
+    _exm_tracker_guard = 0;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,88 @@
+/*
+ * Examine - a set of tools for memory leak detection on Windows and
+ * PE file reader
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXAMINE_TRACKER_H
+#define EXAMINE_TRACKER_H
+
+#include <stddef.h>
+
+
+typedef struct _Exm_Tracker Exm_Tracker;
+
+#define EXM_TRACKER_BLOCK_GDI (1 << 0)
+
+#define EXM_TRACKER_REDZONE_BYTE 0xfd
+#define EXM_TRACKER_FREED_BYTE 0xdd
+
+typedef struct
+{
+    const void *address;
+    size_t size;
+    unsigned int stack; /* id of the allocation stack */
+    unsigned int stack_first_free; /* id of the stack of the first free */
+    unsigned short frees; /* 0 while the block is live */
+    unsigned char fct; /* allocation function, defined by the caller */
+    unsigned char flags;
+    unsigned int redzone; /* bytes of canaries before the block, 0 for none */
+} Exm_Tracker_Block;
+
+typedef void (*Exm_Tracker_Cb)(const Exm_Tracker_Block *block, void *data);
+
+EXM_API Exm_Tracker *exm_tracker_new(void);
+
+EXM_API void exm_tracker_free(Exm_Tracker *tracker);
+
+EXM_API unsigned char exm_tracker_block_add(Exm_Tracker *tracker, const Exm_Tracker_Block *block, Exm_Tracker_Block *old);
+
+EXM_API unsigned char exm_tracker_block_release(Exm_Tracker *tracker, const void *address, unsigned int stack, Exm_Tracker_Block *block);
+
+EXM_API unsigned char exm_tracker_block_move(Exm_Tracker *tracker, const void *old_address, const void *new_address, size_t size, Exm_Tracker_Block *block);
+
+EXM_API unsigned char exm_tracker_block_get(Exm_Tracker *tracker, const void *address, Exm_Tracker_Block *block);
+
+EXM_API unsigned char exm_tracker_block_del(Exm_Tracker *tracker, const void *address);
+
+EXM_API void exm_tracker_foreach(Exm_Tracker *tracker, Exm_Tracker_Cb cb, void *data);
+
+EXM_API size_t exm_tracker_count(Exm_Tracker *tracker);
+
+EXM_API size_t exm_tracker_duplicates_get(Exm_Tracker *tracker);
+
+EXM_API size_t exm_tracker_memory_get(Exm_Tracker *tracker);
+
+EXM_API void exm_tracker_thread_flush(Exm_Tracker *tracker);
+
+EXM_API size_t exm_tracker_redzone_size_get(size_t size, size_t redzone, size_t alignment, unsigned int *front);
+
+EXM_API void *exm_tracker_redzone_set(void *base, size_t size, unsigned int front);
+
+EXM_API size_t exm_tracker_redzone_check(const Exm_Tracker_Block *block, long long *offset);
+
+EXM_API void exm_tracker_poison_set(const Exm_Tracker_Block *block);
+
+EXM_API size_t exm_tracker_poison_check(const Exm_Tracker_Block *block, long long *offset);
+
+EXM_API unsigned char exm_tracker_guard_enter(void);
+
+EXM_API void exm_tracker_guard_leave(void);
+
+
+#endif /* EXAMINE_TRACKER_H */
@@ -26,3 +26,57 @@ src_tests_examine_test_LDADD = \
 src/tests/libexamine_test_dll.la
 
 endif
+
+check_PROGRAMS += \
+src/tests/examine_bench \
+src/tests/examine_test_unit
+
+TESTS += src/tests/examine_test_unit
+
+src_tests_examine_bench_SOURCES = src/tests/examine_bench.c
+src_tests_examine_bench_CPPFLAGS = \
+-I$(top_srcdir)/src/lib \
+@EXM_CPPFLAGS@
+
+src_tests_examine_bench_CFLAGS = @EXM_CFLAGS@
+
+src_tests_examine_bench_LDADD = \
+src/lib/libexamine.la \
+@EXM_LIBS@
+
+src_tests_examine_test_unit_SOURCES = src/tests/examine_test_unit.c
+src_tests_examine_test_unit_CPPFLAGS = \
+-I$(top_srcdir)/src/lib \
+-DEXM_TEST_DATA_DIR=\"$(top_srcdir)/src/tests/data\"
+
+if HAVE_MEMCHECK
+if !HAVE_WIN32
+src_tests_examine_test_unit_CPPFLAGS += \
+-DEXM_TEST_MEMCHECK_PRELOAD=\"$(abs_top_builddir)/src/bin/memcheck/.libs/libexamine_memcheck.so\"
+endif
+endif
+
+src_tests_examine_test_unit_CFLAGS = @EXM_CFLAGS@
+
+src_tests_examine_test_unit_LDADD = \
+src/lib/libexamine.la
+
+EXTRA_DIST += \
+src/tests/data/examine_test_coff.c \
+src/tests/data/examine_test_coff.exe \
+src/tests/data/examine_test_pdata.exe \
+src/tests/data/examine_test_pdata.s \
+src/tests/data/examine_test_reloc.exe \
+src/tests/data/examine_test_reloc.s \
+src/tests/data/examine_test_rsrc.exe \
+src/tests/data/examine_test_rsrc.rc \
+src/tests/data/examine_test_rsrc.s \
+src/tests/data/examine_test_dwarf.h \
+src/tests/data/examine_test_dwarf_a.c \
+src/tests/data/examine_test_dwarf_b.c \
+src/tests/data/examine_test_dwarf4.exe \
+src/tests/data/examine_test_dwarf5.exe \
+src/tests/data/examine_test_pdb.c \
+src/tests/data/examine_test_pdb.exe \
+src/tests/data/examine_test_pdb.pdb \
+src/tests/data/examine_test_pdb.yaml
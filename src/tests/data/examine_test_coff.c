@@ -0,0 +1,63 @@
+/* Examine - a tool for memory leak detection on Windows
+ *
+ * Copyright (C) 2012-2013 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Source of the COFF fixture examine_test_coff.exe, whose functions
+ * are only given by the COFF symbol table, as in a PE file built by
+ * MinGW without debug information. It is assembled for MinGW:
+ *
+ * gcc -O1 -mabi=ms -fno-inline -fno-ident -fno-asynchronous-unwind-tables -S examine_test_coff.c
+ * sed -e 's/^\t\.type\t\([a-z_]*\), @function/\t.def\t\1;\t.scl\t2;\t.type\t32;\t.endef/' \
+ *     -e '/^\t\.size\t/d' -e '/\.note\.GNU-stack/d' -e '/@object/d' examine_test_coff.s > examine_test_coff_mingw.s
+ * llvm-mc -triple x86_64-w64-windows-gnu -filetype=obj -o examine_test_coff.obj examine_test_coff_mingw.s
+ * ld -m i386pep --entry=main -o examine_test_coff.exe examine_test_coff.obj
+ *
+ * The expected functions are in examine_test_unit.c.
+ */
+
+int coff_square(int v);
+int coff_sum(int n);
+int main(void);
+
+volatile int coff_sink;
+
+int
+coff_square(int v)
+{
+    return v * v;
+}
+
+int
+coff_sum(int n)
+{
+    int s = 0;
+    int i;
+
+    for (i = 0; i < n; i++)
+        s += coff_square(i);
+
+    return s;
+}
+
+int
+main(void)
+{
+    coff_sink = coff_sum(4);
+    return 0;
+}
@@ -0,0 +1,35 @@
+/* Examine - a tool for memory leak detection on Windows
+ *
+ * Copyright (C) 2012-2013 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Header of the DWARF fixtures, see examine_test_dwarf_a.c.
+ */
+
+#ifndef EXAMINE_TEST_DWARF_H
+#define EXAMINE_TEST_DWARF_H
+
+int dwarf_b_compute(int v);
+
+static inline int
+dwarf_square(int v)
+{
+    return v * v + dwarf_b_compute(v);
+}
+
+#endif /* EXAMINE_TEST_DWARF_H */
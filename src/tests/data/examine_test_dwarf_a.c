@@ -0,0 +1,65 @@
+/* Examine - a tool for memory leak detection on Windows
+ *
+ * Copyright (C) 2012-2013 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Source of the DWARF fixtures examine_test_dwarf5.exe and
+ * examine_test_dwarf4.exe, linked with examine_test_dwarf_b.c:
+ *
+ * gcc -O2 -gdwarf-5 -fno-ident -fdebug-prefix-map=$PWD=/examine -c examine_test_dwarf_a.c
+ * gcc -O2 -gdwarf-5 -fno-ident -fdebug-prefix-map=$PWD=/examine -c examine_test_dwarf_b.c
+ * ld -m i386pep --entry=main -o examine_test_dwarf5.exe examine_test_dwarf_a.o examine_test_dwarf_b.o
+ *
+ * and the same with -gdwarf-4 for examine_test_dwarf4.exe. The
+ * expected frames are in examine_test_unit.c.
+ */
+
+#include "examine_test_dwarf.h"
+
+volatile int dwarf_sink;
+
+static int __attribute__((noinline))
+dwarf_a_static(int v)
+{
+    dwarf_sink = v;
+    return dwarf_square(v) + 1;
+}
+
+static void __attribute__((noinline, cold))
+dwarf_a_fail(int v)
+{
+    dwarf_sink = -v;
+}
+
+int __attribute__((noinline))
+dwarf_a_check(int v)
+{
+    if (__builtin_expect(v < 0, 0))
+    {
+        dwarf_a_fail(v);
+        dwarf_sink = v * 3;
+        return -1;
+    }
+    return dwarf_a_static(v);
+}
+
+int
+main(void)
+{
+    return dwarf_a_check(dwarf_sink);
+}
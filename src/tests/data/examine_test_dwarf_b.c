@@ -0,0 +1,38 @@
+/* Examine - a tool for memory leak detection on Windows
+ *
+ * Copyright (C) 2012-2013 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Second unit of the DWARF fixtures, see examine_test_dwarf_a.c.
+ */
+
+#include "examine_test_dwarf.h"
+
+extern volatile int dwarf_sink;
+
+int __attribute__((noinline))
+dwarf_b_compute(int v)
+{
+    int i;
+    int r = 0;
+
+    for (i = 0; i < v; i++)
+        r += dwarf_sink + i;
+
+    return r;
+}
@@ -0,0 +1,75 @@
+# Source of the exception directory fixture examine_test_pdata.exe,
+# whose .pdata and .xdata sections are written by hand:
+#
+# llvm-mc -triple x86_64-w64-windows-gnu -filetype=obj -o examine_test_pdata.obj examine_test_pdata.s
+# ld -m i386pep --entry=main -o examine_test_pdata.exe examine_test_pdata.obj
+#
+# pdata_leaf has a cold part, after main, described by a chained
+# unwind info. main has an exception handler. pdata_handler has no
+# unwind info, as a leaf function. The expected values are in
+# examine_test_unit.c.
+
+	.text
+	.globl	pdata_leaf
+	.def	pdata_leaf;	.scl	2;	.type	32;	.endef
+pdata_leaf:
+	pushq	%rbx
+	subq	$32, %rsp
+	movl	%ecx, %eax
+	testl	%eax, %eax
+	je	.Lleaf_cold
+	addq	$32, %rsp
+	popq	%rbx
+	ret
+.Lleaf_end:
+
+	.globl	main
+	.def	main;	.scl	2;	.type	32;	.endef
+main:
+	pushq	%rbp
+	movq	%rsp, %rbp
+	subq	$48, %rsp
+	movl	$1, %ecx
+	call	pdata_leaf
+	addq	$48, %rsp
+	popq	%rbp
+	ret
+.Lmain_end:
+
+.Lleaf_cold:
+	xorl	%eax, %eax
+	addq	$32, %rsp
+	popq	%rbx
+	ret
+.Lleaf_cold_end:
+
+	.globl	pdata_handler
+	.def	pdata_handler;	.scl	2;	.type	32;	.endef
+pdata_handler:
+	movl	$1, %eax
+	ret
+
+	.section	.xdata,"dr"
+	.p2align	2
+.Lleaf_unwind:
+	# version 1, prolog of 5 bytes, 2 codes, no frame register
+	.byte	0x01, 0x05, 0x02, 0x00
+	# sub $32, %rsp: UWOP_ALLOC_SMALL, push %rbx: UWOP_PUSH_NONVOL
+	.byte	0x05, 0x32, 0x01, 0x30
+.Lleaf_cold_unwind:
+	# version 1, UNW_FLAG_CHAININFO, no code
+	.byte	0x21, 0x00, 0x00, 0x00
+	.rva	pdata_leaf, .Lleaf_end, .Lleaf_unwind
+.Lmain_unwind:
+	# version 1, UNW_FLAG_EHANDLER, prolog of 8 bytes, 3 codes, frame register %rbp
+	.byte	0x09, 0x08, 0x03, 0x05
+	# UWOP_ALLOC_SMALL, UWOP_SET_FPREG, UWOP_PUSH_NONVOL, padding
+	.byte	0x08, 0x52, 0x04, 0x03, 0x01, 0x50, 0x00, 0x00
+	.rva	pdata_handler
+	.long	0
+
+	.section	.pdata,"dr"
+	.p2align	2
+	.rva	pdata_leaf, .Lleaf_end, .Lleaf_unwind
+	.rva	main, .Lmain_end, .Lmain_unwind
+	.rva	.Lleaf_cold, .Lleaf_cold_end, .Lleaf_cold_unwind
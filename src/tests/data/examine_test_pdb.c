@@ -0,0 +1,64 @@
+/* Examine - a tool for memory leak detection on Windows
+ *
+ * Copyright (C) 2012-2013 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Source of the PDB fixtures examine_test_pdb.exe and
+ * examine_test_pdb.pdb. The PE file is linked without debug
+ * information, with a CodeView record:
+ *
+ * gcc -O1 -g -fno-inline -fno-ident -fno-asynchronous-unwind-tables -fdebug-prefix-map=$PWD=/examine -c examine_test_pdb.c
+ * objcopy -g -O pe-x86-64 examine_test_pdb.o examine_test_pdb.obj
+ * ld -m i386pep --entry=main --build-id -o examine_test_pdb.exe examine_test_pdb.obj
+ *
+ * and the PDB file is written from examine_test_pdb.yaml, which
+ * gives the procedures and the line table of the DWARF of
+ * examine_test_pdb.o and the GUID of the CodeView record:
+ *
+ * llvm-pdbutil yaml2pdb --pdb=examine_test_pdb.pdb examine_test_pdb.yaml
+ *
+ * The expected frames are in examine_test_unit.c.
+ */
+
+int pdb_square(int v);
+int pdb_sum(int n);
+int main(void);
+
+int
+pdb_square(int v)
+{
+    return v * v;
+}
+
+int
+pdb_sum(int n)
+{
+    int s = 0;
+    int i;
+
+    for (i = 0; i < n; i++)
+        s += pdb_square(i);
+
+    return s;
+}
+
+int
+main(void)
+{
+    return pdb_sum(4);
+}
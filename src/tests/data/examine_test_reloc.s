@@ -0,0 +1,29 @@
+# Source of the base relocation fixture examine_test_reloc.exe:
+#
+# llvm-mc -triple x86_64-w64-windows-gnu -filetype=obj -o examine_test_reloc.obj examine_test_reloc.s
+# ld -m i386pep --entry=main --dynamicbase --image-base=0x10000000 -o examine_test_reloc.exe examine_test_reloc.obj
+#
+# .data has 5 DIR64 and 1 HIGHLOW relocations on 3 pages, the last
+# two blocks being padded with an ABSOLUTE entry. The expected values
+# are in examine_test_unit.c.
+
+	.text
+	.globl	main
+	.def	main;	.scl	2;	.type	32;	.endef
+main:
+	movq	reloc_table(%rip), %rax
+	ret
+
+	.data
+	.globl	reloc_table
+reloc_table:
+	.quad	main
+	.quad	reloc_table
+	.quad	reloc_last
+	.long	main
+	.long	0
+	.p2align 12
+	.skip	4088
+reloc_last:
+	.quad	main
+	.quad	reloc_table
@@ -0,0 +1,9 @@
+# Code of the resource fixture examine_test_rsrc.exe, see
+# examine_test_rsrc.rc.
+
+	.text
+	.globl	main
+	.def	main;	.scl	2;	.type	32;	.endef
+main:
+	xorl	%eax, %eax
+	ret
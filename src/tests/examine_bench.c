@@ -0,0 +1,1706 @@
+/* Examine - a tool for memory leak detection on Windows
+ *
+ * Copyright (C) 2012-2015 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Benchmarks of the library internals.
+ *
+ * Usage: examine_bench stack <file> [frames]
+ *        examine_bench depot [allocations] [sites]
+ *        examine_bench symbol <PE file> [lookups]
+ *        examine_bench coff <PE file> [lookups]
+ *        examine_bench reloc <PE file> [runs]
+ *        examine_bench version <directory> [runs]
+ *        examine_bench digest <PE file> [runs]
+ *        examine_bench checksum <directory> [runs]
+ *        examine_bench entropy <directory> [runs]
+ *        examine_bench tracker [blocks]
+ *        examine_bench leak [megabytes]
+ *        examine_bench memcheck <preload library> [allocations] [sample interval]
+ *
+ * The stack benchmark symbolizes the addresses of the functions of an
+ * ELF or PE file, first opening the file for each frame (as the stack
+ * walker did before the module cache), then with the cache. It needs
+ * libbfd to list the functions.
+ *
+ * The depot benchmark stores the stacks of a number of allocations
+ * made from a smaller number of call sites in a stack depot, and
+ * compares the memory used with a copy of the stack per allocation.
+ *
+ * The symbol benchmark builds the symbol index of a PE file from its
+ * DWARF debug information, then looks up random addresses of its code
+ * in it. If libbfd is available, the same addresses are also looked
+ * up with bfd_find_nearest_line().
+ *
+ * The COFF benchmark builds the function index of a PE file from its
+ * COFF symbol table, like a MinGW DLL without debug information, then
+ * looks up random addresses of its code in it.
+ *
+ * The reloc benchmark computes the statistics of the base relocations
+ * of a PE file.
+ *
+ * The version benchmark opens the DLL and EXE files of a directory and
+ * reads their file version from the version resource, the most
+ * common inventory query.
+ *
+ * The digest benchmark computes the Authenticode SHA-1 and SHA-256
+ * digests of a PE file, separately then in a single pass, with the
+ * SHA extensions of the CPU if supported and with the C
+ * implementation, and reports the throughput in GB/s.
+ *
+ * The checksum benchmark computes the checksum of the DLL and EXE
+ * files of a directory, with the widest SIMD accumulators supported
+ * and with the C implementation, and reports the number of files per
+ * second and the throughput.
+ *
+ * The entropy benchmark computes the entropy of the sections and of
+ * the overlay of the DLL and EXE files of a directory, like a triage
+ * scan, and reports the number of files per second and the
+ * throughput.
+ *
+ * The tracker benchmark records a number of live blocks in an
+ * allocation tracker, at random addresses, frees them, allocates them
+ * again at the same addresses and reallocates them, like memcheck
+ * does, and reports the number of operations per second. The same is
+ * done on a smaller number of blocks with a list of records, as
+ * memcheck did before the tracker.
+ *
+ * The leak benchmark fills a heap of the given size with blocks of 16
+ * to 512 bytes, holding random words and, for one word out of 8,
+ * pointers to the blocks, then classifies the blocks from a root of
+ * pointers, as memcheck does at exit, with the widest SIMD comparisons
+ * supported and with the C implementation. It reports the time to
+ * prepare the scan and the throughput of the scan. Then 1M lost blocks
+ * from 1000 allocation sites are grouped in loss records, whose report
+ * is formatted in the buffer of the log and written on stderr, and the
+ * time of each step is reported.
+ *
+ * The memcheck benchmark (not on Windows) runs an allocation-heavy
+ * workload (malloc, calloc, realloc, strdup and free of small blocks,
+ * with a window of live blocks) in child processes, alternately
+ * natively and with the memcheck library preloaded, and reports the
+ * slowdown between the best runs. With a sample interval, memcheck records one block every
+ * interval bytes on average, as for profiling in production.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <dirent.h>
+
+#ifdef _WIN32
+# ifndef WIN32_LEAN_AND_MEAN
+#  define WIN32_LEAN_AND_MEAN
+# endif
+# include <windows.h>
+# undef WIN32_LEAN_AND_MEAN
+#else
+# include <time.h>
+# include <unistd.h>
+# include <sys/wait.h>
+#endif
+
+#ifdef HAVE_BFD
+# include <bfd.h>
+#endif
+
+#include "Examine.h"
+
+#include "examine_private_checksum.h"
+#include "examine_private_coff.h"
+#include "examine_private_dwarf.h"
+#include "examine_private_leak.h"
+#include "examine_private_pdb.h"
+#include "examine_private_sha.h"
+#ifdef HAVE_BFD
+# include "examine_private_stack.h"
+#endif
+
+static double
+_exm_bench_time_get(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+#endif
+}
+
+#ifdef HAVE_BFD
+
+static unsigned long long *
+_exm_bench_stack_pcs_get(const char *filename, unsigned int *nbr)
+{
+    bfd *abfd;
+    asymbol **symbols;
+    unsigned long long *pcs = NULL;
+    long size;
+    long count;
+    long i;
+    unsigned int n;
+
+    *nbr = 0;
+
+    abfd = bfd_openr(filename, NULL);
+    if (!abfd)
+        return NULL;
+
+    if (!bfd_check_format(abfd, bfd_object))
+        goto close_fd;
+
+    size = bfd_get_symtab_upper_bound(abfd);
+    if (size <= 0)
+        goto close_fd;
+
+    symbols = (asymbol **)malloc(size);
+    if (!symbols)
+        goto close_fd;
+
+    count = bfd_canonicalize_symtab(abfd, symbols);
+    if (count <= 0)
+        goto free_symbols;
+
+    pcs = (unsigned long long *)malloc(count * sizeof(unsigned long long));
+    if (!pcs)
+        goto free_symbols;
+
+    n = 0;
+    for (i = 0; i < count; i++)
+    {
+        if (!(symbols[i]->flags & (BSF_FUNCTION | BSF_GLOBAL)))
+            continue;
+        if (!(symbols[i]->section->flags & SEC_CODE))
+            continue;
+        /* a return address is inside the function, not at its start */
+        pcs[n++] = (unsigned long long)bfd_asymbol_value(symbols[i]) + 1;
+    }
+    *nbr = n;
+
+  free_symbols:
+    free(symbols);
+  close_fd:
+    bfd_close(abfd);
+
+    return pcs;
+}
+
+/* preferred base address of a PE file, the addresses of bfd being relative to it */
+static unsigned long long
+_exm_bench_image_base_get(const char *filename)
+{
+    Exm_Pe *pe;
+    char *module;
+    unsigned long long base = 0;
+
+    module = exm_file_set(filename);
+    pe = exm_pe_new(module);
+    free(module);
+    if (pe)
+    {
+        base = exm_pe_image_base_get(pe);
+        exm_pe_free(pe);
+    }
+
+    return base;
+}
+
+typedef struct
+{
+    asymbol **symbols;
+    bfd_vma vma;
+    unsigned char found;
+} Exm_Bench_Stack_Find;
+
+/* the frame is searched in the section containing it */
+static void
+_exm_bench_stack_section_find(bfd *abfd, asection *sec, void *data)
+{
+    Exm_Bench_Stack_Find *find = data;
+    const char *file;
+    const char *func;
+    unsigned int line;
+    bfd_vma vma;
+
+    if (find->found)
+        return;
+
+    vma = EXM_BFD_SECTION_VMA(abfd, sec);
+    if ((find->vma < vma) || (find->vma >= vma + EXM_BFD_SECTION_SIZE(abfd, sec)))
+        return;
+
+    if (bfd_find_nearest_line(abfd, sec, find->symbols, find->vma - vma,
+                              &file, &func, &line))
+        find->found = 1;
+}
+
+/*
+ * Symbolize a frame as the stack walker did before the module cache:
+ * the file is opened and its symbols are read for each frame.
+ */
+static unsigned char
+_exm_bench_stack_bfd_find(const char *filename, unsigned long long vma)
+{
+    Exm_Bench_Stack_Find find;
+    bfd *abfd;
+    void *symbols = NULL;
+    unsigned int dummy = 0;
+
+    find.found = 0;
+
+    abfd = bfd_openr(filename, NULL);
+    if (!abfd)
+        return 0;
+
+    if (!bfd_check_format(abfd, bfd_object) ||
+        !(bfd_get_file_flags(abfd) & HAS_SYMS))
+        goto close_fd;
+
+    if ((bfd_read_minisymbols(abfd, 0, &symbols, &dummy) == 0) &&
+        (bfd_read_minisymbols(abfd, 1, &symbols, &dummy) < 0))
+        goto close_fd;
+
+    find.symbols = (asymbol **)symbols;
+    find.vma = (bfd_vma)vma;
+    bfd_map_over_sections(abfd, _exm_bench_stack_section_find, &find);
+
+  close_fd:
+    free(symbols);
+    bfd_close(abfd);
+
+    return find.found;
+}
+
+static int
+_exm_bench_stack(const char *filename, unsigned int frames)
+{
+    unsigned long long *pcs;
+    unsigned long long base;
+    unsigned long long hi;
+    unsigned int pcs_nbr;
+    unsigned int found;
+    unsigned int i;
+    double t0;
+    double uncached;
+    double cached;
+
+    pcs = _exm_bench_stack_pcs_get(filename, &pcs_nbr);
+    if (!pcs || (pcs_nbr == 0))
+    {
+        printf("no function symbol in %s\n", filename);
+        free(pcs);
+        return -1;
+    }
+
+    /* the module is mapped at its preferred address */
+    base = _exm_bench_image_base_get(filename);
+    hi = pcs[0];
+    for (i = 1; i < pcs_nbr; i++)
+    {
+        if (pcs[i] > hi) hi = pcs[i];
+    }
+
+    /* before: one bfd_openr per frame */
+
+    found = 0;
+    t0 = _exm_bench_time_get();
+    for (i = 0; i < frames; i++)
+        found += _exm_bench_stack_bfd_find(filename, pcs[i % pcs_nbr]);
+    uncached = (double)frames / (_exm_bench_time_get() - t0);
+    printf("uncached : %u frames, %u resolved, %.0f frames/s\n",
+           frames, found, uncached);
+
+    /* after: the module is looked up in the cache */
+
+    found = 0;
+    t0 = _exm_bench_time_get();
+    for (i = 0; i < 100 * frames; i++)
+    {
+        Exm_Stack_Module *module;
+        const void *addr;
+        const char *file;
+        const char *func;
+        unsigned int line;
+
+        addr = (const void *)(uintptr_t)pcs[i % pcs_nbr];
+        module = exm_stack_module_cache_find(addr);
+        if (!module)
+            module = exm_stack_module_cache_add(filename,
+                                               (const void *)(uintptr_t)base,
+                                               (size_t)(hi - base + 1));
+        if (module)
+            found += exm_stack_module_frame_find(module,
+                                                 (uintptr_t)addr - (uintptr_t)exm_stack_module_base_get(module),
+                                                 &file, &func, &line);
+    }
+    cached = (double)(100 * frames) / (_exm_bench_time_get() - t0);
+    printf("cached   : %u frames, %u resolved, %.0f frames/s\n",
+           100 * frames, found, cached);
+    printf("speedup  : %.1fx\n", cached / uncached);
+
+    exm_stack_module_cache_free();
+    free(pcs);
+
+    return 0;
+}
+
+#endif
+
+/* small deterministic generator, so that runs can be compared */
+static unsigned int
+_exm_bench_rand(unsigned int *state)
+{
+    *state = *state * 1103515245u + 12345u;
+    return *state >> 8;
+}
+
+static int
+_exm_bench_depot(unsigned int allocs, unsigned int sites)
+{
+    Exm_Stack_Depot *depot;
+    Exm_Stack_Pc pcs[32];
+    unsigned int state = 1;
+    unsigned long long copies = 0;
+    unsigned int i;
+    unsigned int j;
+    double t0;
+    double t;
+
+    depot = exm_stack_depot_new();
+    if (!depot)
+        return -1;
+
+    t0 = _exm_bench_time_get();
+    for (i = 0; i < allocs; i++)
+    {
+        unsigned int site;
+        unsigned int depth;
+
+        /* each site has its own stack, of 8 to 31 frames */
+        site = _exm_bench_rand(&state) % sites;
+        depth = 8 + site % 24;
+        for (j = 0; j < depth; j++)
+        {
+            pcs[j].module = j / 8;
+            pcs[j].offset = site * 4096 + j * 16;
+        }
+
+        if (exm_stack_depot_put(depot, pcs, depth) == 0)
+        {
+            printf("exm_stack_depot_put() failed\n");
+            exm_stack_depot_free(depot);
+            return -1;
+        }
+        copies += sizeof(unsigned int) + depth * sizeof(Exm_Stack_Pc);
+    }
+    t = _exm_bench_time_get() - t0;
+
+    printf("depot    : %u allocations, %u stacks, %.0f puts/s\n",
+           allocs, exm_stack_depot_count(depot), (double)allocs / t);
+    printf("memory   : %llu bytes with a copy per allocation, %llu bytes in the depot\n",
+           copies, (unsigned long long)exm_stack_depot_memory_get(depot));
+
+    exm_stack_depot_free(depot);
+
+    return 0;
+}
+
+#ifdef HAVE_BFD
+
+static double
+_exm_bench_symbol_bfd(const char *filename, const unsigned int *rvas, unsigned int nbr, DWORD text_rva)
+{
+    bfd *abfd;
+    asection *sec;
+    asymbol **symbols = NULL;
+    unsigned int dummy;
+    unsigned int found = 0;
+    unsigned int i;
+    double t0;
+    double t;
+
+    abfd = bfd_openr(filename, NULL);
+    if (!abfd)
+        return 0.0;
+
+    if (!bfd_check_format(abfd, bfd_object) ||
+        (bfd_read_minisymbols(abfd, 0, (void **)&symbols, &dummy) < 0))
+        goto close_fd;
+
+    sec = bfd_get_section_by_name(abfd, ".text");
+    if (!sec)
+        goto close_fd;
+
+    t0 = _exm_bench_time_get();
+    for (i = 0; i < nbr; i++)
+    {
+        const char *file;
+        const char *func;
+        unsigned int line;
+
+        found += bfd_find_nearest_line(abfd, sec, symbols, rvas[i] - text_rva,
+                                       &file, &func, &line);
+    }
+    t = _exm_bench_time_get() - t0;
+    printf("bfd      : %u lookups, %u resolved, %.0f lookups/s\n",
+           nbr, found, (double)nbr / t);
+
+  close_fd:
+    free(symbols);
+    bfd_close(abfd);
+
+    return found ? (double)nbr / t : 0.0;
+}
+
+#endif
+
+static void
+_exm_bench_text_get(const Exm_Pe *pe, DWORD *rva, DWORD *size)
+{
+    const IMAGE_SECTION_HEADER *iter;
+    unsigned int i;
+
+    *rva = 0;
+    *size = 0;
+    iter = IMAGE_FIRST_SECTION(exm_pe_nt_header_get(pe));
+    for (i = 0; i < exm_pe_nt_header_get(pe)->FileHeader.NumberOfSections; i++, iter++)
+    {
+        if (strcmp(exm_pe_section_name_get(pe, iter), ".text") == 0)
+        {
+            *rva = iter->VirtualAddress;
+            *size = iter->Misc.VirtualSize;
+            break;
+        }
+    }
+}
+
+static int
+_exm_bench_symbol(const char *filename, unsigned int lookups)
+{
+    Exm_Dwarf_Sections sections;
+    Exm_Pdb *pdb = NULL;
+    Exm_Symbol_Index *index;
+    Exm_Pe *pe;
+    unsigned int *rvas;
+    unsigned int state = 1;
+    unsigned int found;
+    unsigned int i;
+    DWORD text_rva;
+    DWORD text_size;
+    char *module;
+    double t0;
+    double t;
+    double rate;
+
+    module = exm_file_set(filename);
+    pe = exm_pe_new(module);
+    free(module);
+    if (!pe)
+    {
+        printf("can not open PE file %s\n", filename);
+        return -1;
+    }
+
+    _exm_bench_text_get(pe, &text_rva, &text_size);
+
+    if (!exm_dwarf_sections_get(pe, &sections))
+        pdb = exm_pdb_find(pe);
+
+    if ((!sections.info.data && !sections.line.data && !pdb) || (text_size == 0))
+    {
+        printf("no .text, DWARF section or PDB file for %s\n", filename);
+        exm_pdb_free(pdb);
+        exm_pe_free(pe);
+        return -1;
+    }
+
+    t0 = _exm_bench_time_get();
+    index = exm_symbol_index_new();
+    if (!index)
+    {
+        exm_pdb_free(pdb);
+        exm_pe_free(pe);
+        return -1;
+    }
+    if (pdb)
+        exm_pdb_index_add(pdb, pe, index);
+    else
+        exm_dwarf_index_add(&sections, exm_pe_image_base_get(pe), index);
+    exm_symbol_index_build(index);
+    t = _exm_bench_time_get() - t0;
+    printf("build    : %lu bytes of debug info, %lu bytes of line table, %u rows, %lu bytes, %.2f ms\n",
+           (unsigned long)sections.info.size, (unsigned long)sections.line.size,
+           exm_symbol_index_count(index),
+           (unsigned long)exm_symbol_index_memory_get(index), t * 1000.0);
+
+    rvas = (unsigned int *)malloc(lookups * sizeof(unsigned int));
+    if (!rvas)
+    {
+        exm_symbol_index_free(index);
+        exm_pdb_free(pdb);
+        exm_pe_free(pe);
+        return -1;
+    }
+
+    for (i = 0; i < lookups; i++)
+        rvas[i] = text_rva + _exm_bench_rand(&state) % text_size;
+
+    found = 0;
+    t0 = _exm_bench_time_get();
+    for (i = 0; i < lookups; i++)
+    {
+        const char *file;
+        const char *func;
+        unsigned int line;
+
+        found += exm_symbol_index_find(index, rvas[i], &func, &file, &line);
+    }
+    t = _exm_bench_time_get() - t0;
+    rate = (double)lookups / t;
+    printf("index    : %u lookups, %u resolved, %.0f lookups/s\n",
+           lookups, found, rate);
+
+    /* warm run: the index is mapped from the symbol cache */
+    if (exm_symbol_index_save(index, "examine_bench.exmsym", "bench"))
+    {
+        Exm_Symbol_Index *cached;
+
+        t0 = _exm_bench_time_get();
+        cached = exm_symbol_index_load("examine_bench.exmsym", "bench");
+        t = _exm_bench_time_get() - t0;
+        if (cached)
+        {
+            printf("cache    : %lu bytes, loaded in %.3f ms\n",
+                   (unsigned long)exm_file_size_get("examine_bench.exmsym"), t * 1000.0);
+            exm_symbol_index_free(cached);
+        }
+        remove("examine_bench.exmsym");
+    }
+
+#ifdef HAVE_BFD
+    {
+        double bfd_rate;
+
+        bfd_rate = _exm_bench_symbol_bfd(filename, rvas,
+                                         (lookups / 100) ? lookups / 100 : 1,
+                                         text_rva);
+        if (bfd_rate > 0.0)
+            printf("speedup  : %.1fx\n", rate / bfd_rate);
+    }
+#endif
+
+    free(rvas);
+    exm_symbol_index_free(index);
+    exm_pdb_free(pdb);
+    exm_pe_free(pe);
+
+    return 0;
+}
+
+static int
+_exm_bench_coff(const char *filename, unsigned int lookups)
+{
+    Exm_Symbol_Index *index;
+    Exm_Pe *pe;
+    const IMAGE_SYMBOL *symbol;
+    unsigned int *rvas;
+    unsigned int state = 1;
+    unsigned int symbols;
+    unsigned int found;
+    unsigned int i;
+    DWORD text_rva;
+    DWORD text_size;
+    char *module;
+    double t0;
+    double t;
+
+    module = exm_file_set(filename);
+    pe = exm_pe_new(module);
+    free(module);
+    if (!pe)
+    {
+        printf("can not open PE file %s\n", filename);
+        return -1;
+    }
+
+    _exm_bench_text_get(pe, &text_rva, &text_size);
+    if (!exm_pe_coff_symbol_first_get(pe) || (text_size == 0))
+    {
+        printf("no .text section or COFF symbol table in %s\n", filename);
+        exm_pe_free(pe);
+        return -1;
+    }
+
+    symbols = 0;
+    t0 = _exm_bench_time_get();
+    for (symbol = exm_pe_coff_symbol_first_get(pe);
+         symbol;
+         symbol = exm_pe_coff_symbol_next_get(pe, symbol))
+        symbols++;
+    t = _exm_bench_time_get() - t0;
+    printf("iterate  : %u symbols, %.2f ms\n", symbols, t * 1000.0);
+
+    t0 = _exm_bench_time_get();
+    index = exm_symbol_index_new();
+    if (!index)
+    {
+        exm_pe_free(pe);
+        return -1;
+    }
+    exm_coff_index_add(pe, index);
+    exm_symbol_index_build(index);
+    t = _exm_bench_time_get() - t0;
+    printf("build    : %u rows, %lu bytes, %.2f ms\n",
+           exm_symbol_index_count(index),
+           (unsigned long)exm_symbol_index_memory_get(index), t * 1000.0);
+
+    rvas = (unsigned int *)malloc(lookups * sizeof(unsigned int));
+    if (!rvas)
+    {
+        exm_symbol_index_free(index);
+        exm_pe_free(pe);
+        return -1;
+    }
+
+    for (i = 0; i < lookups; i++)
+        rvas[i] = text_rva + _exm_bench_rand(&state) % text_size;
+
+    found = 0;
+    t0 = _exm_bench_time_get();
+    for (i = 0; i < lookups; i++)
+    {
+        const char *file;
+        const char *func;
+        unsigned int line;
+
+        found += exm_symbol_index_find(index, rvas[i], &func, &file, &line);
+    }
+    t = _exm_bench_time_get() - t0;
+    printf("index    : %u lookups, %u resolved, %.0f lookups/s\n",
+           lookups, found, (double)lookups / t);
+
+    free(rvas);
+    exm_symbol_index_free(index);
+    exm_pe_free(pe);
+
+    return 0;
+}
+
+static int
+_exm_bench_reloc(const char *filename, unsigned int runs)
+{
+    Exm_Pe_Relocation_Stats stats;
+    Exm_Pe *pe;
+    DWORD *sections;
+    unsigned int i;
+    char *module;
+    double t0;
+    double t;
+
+    module = exm_file_set(filename);
+    pe = exm_pe_new(module);
+    free(module);
+    if (!pe)
+    {
+        printf("can not open PE file %s\n", filename);
+        return -1;
+    }
+
+    sections = (DWORD *)calloc(exm_pe_nt_header_get(pe)->FileHeader.NumberOfSections + 1, sizeof(DWORD));
+    if (!sections)
+    {
+        exm_pe_free(pe);
+        return -1;
+    }
+
+    if (runs == 0)
+        runs = 1;
+
+    t0 = _exm_bench_time_get();
+    for (i = 0; i < runs; i++)
+        exm_pe_relocation_stats_get(pe, &stats, sections);
+    t = (_exm_bench_time_get() - t0) / runs;
+    printf("stats    : %lu relocations, %lu blocks, %lu pages, %.3f ms\n",
+           (unsigned long)stats.count, (unsigned long)stats.blocks,
+           (unsigned long)stats.pages, t * 1000.0);
+
+    free(sections);
+    exm_pe_free(pe);
+
+    return 0;
+}
+
+static int
+_exm_bench_version(const char *dirname, unsigned int runs)
+{
+    char filename[4096];
+    char version[256];
+    unsigned int files;
+    unsigned int versions;
+    unsigned int i;
+    double t0;
+    double t;
+
+    if (runs == 0)
+        runs = 1;
+
+    /* most files have no resource, do not time the warnings */
+    exm_log_level_set(EXM_LOG_LEVEL_ERR);
+
+    files = 0;
+    versions = 0;
+    t0 = _exm_bench_time_get();
+    for (i = 0; i < runs; i++)
+    {
+        struct dirent *entry;
+        DIR *dir;
+
+        dir = opendir(dirname);
+        if (!dir)
+        {
+            printf("can not open directory %s\n", dirname);
+            return -1;
+        }
+
+        while ((entry = readdir(dir)))
+        {
+            Exm_Pe_Version_Info info;
+            Exm_Pe_Version_String str;
+            Exm_Pe *pe;
+            size_t l;
+
+            l = strlen(entry->d_name);
+            if ((l < 4) ||
+                ((_stricmp(entry->d_name + l - 4, ".dll") != 0) &&
+                 (_stricmp(entry->d_name + l - 4, ".exe") != 0)))
+                continue;
+
+            snprintf(filename, sizeof(filename), "%s/%s", dirname, entry->d_name);
+            pe = exm_pe_new(filename);
+            if (!pe)
+                continue;
+
+            files++;
+            if (exm_pe_version_info_get(pe, &info) &&
+                exm_pe_version_info_string_get(&info, "FileVersion", &str))
+            {
+                exm_pe_string_utf8_get(str.value, str.value_length, version, sizeof(version));
+                if (i == 0)
+                    printf("%s %s\n", entry->d_name, version);
+                versions++;
+            }
+            exm_pe_free(pe);
+        }
+        closedir(dir);
+    }
+    t = (_exm_bench_time_get() - t0) / runs;
+    files /= runs;
+    versions /= runs;
+    printf("version  : %u files, %u with a version, %.2f ms, %.1f us/file\n",
+           files, versions, t * 1000.0, files ? t * 1000000.0 / files : 0.0);
+
+    return 0;
+}
+
+static int
+_exm_bench_digest(const char *filename, unsigned int runs)
+{
+    static const char *names[] = { "sha1    ", "sha256  ", "both    " };
+    unsigned char sha1[EXM_SHA1_SIZE];
+    unsigned char sha256[EXM_SHA256_SIZE];
+    unsigned long long size;
+    Exm_Pe *pe;
+    char *module;
+    int hw;
+
+    module = exm_file_set(filename);
+    pe = exm_pe_new(module);
+    free(module);
+    if (!pe)
+    {
+        printf("can not open PE file %s\n", filename);
+        return -1;
+    }
+
+    size = exm_file_size_get(exm_pe_filename_get(pe));
+    if (runs == 0)
+        runs = 1;
+
+    for (hw = 1; hw >= 0; hw--)
+    {
+        int m;
+
+        if (hw && !exm_sha_hw_set(1))
+        {
+            printf("no SHA extensions\n");
+            continue;
+        }
+        exm_sha_hw_set((unsigned char)hw);
+
+        for (m = 0; m < 3; m++)
+        {
+            unsigned int i;
+            double t0;
+            double t;
+
+            t0 = _exm_bench_time_get();
+            for (i = 0; i < runs; i++)
+                exm_pe_authenticode_digest_get(pe, (m != 1) ? sha1 : NULL, (m != 0) ? sha256 : NULL);
+            t = (_exm_bench_time_get() - t0) / runs;
+            printf("%s %s: %llu bytes, %.3f ms, %.2f GB/s\n",
+                   names[m], hw ? "(sha-ni)" : "(C)     ", size,
+                   t * 1000.0, (t > 0.0) ? (double)size / t / 1e9 : 0.0);
+        }
+    }
+
+    exm_sha_hw_set(1);
+    exm_pe_free(pe);
+
+    return 0;
+}
+
+static int
+_exm_bench_checksum(const char *dirname, unsigned int runs)
+{
+    static const char *names[] = { "C", "SSE2", "AVX2" };
+    char filename[4096];
+    Exm_List *pes = NULL;
+    Exm_List *iter;
+    struct dirent *entry;
+    unsigned long long size;
+    unsigned int files;
+    unsigned int mismatches;
+    DIR *dir;
+    int simd;
+
+    if (runs == 0)
+        runs = 1;
+
+    dir = opendir(dirname);
+    if (!dir)
+    {
+        printf("can not open directory %s\n", dirname);
+        return -1;
+    }
+
+    /* the files are opened once, only the checksums are timed */
+    files = 0;
+    mismatches = 0;
+    size = 0;
+    while ((entry = readdir(dir)))
+    {
+        Exm_Pe *pe;
+        size_t l;
+
+        l = strlen(entry->d_name);
+        if ((l < 4) ||
+            ((_stricmp(entry->d_name + l - 4, ".dll") != 0) &&
+             (_stricmp(entry->d_name + l - 4, ".exe") != 0)))
+            continue;
+
+        snprintf(filename, sizeof(filename), "%s/%s", dirname, entry->d_name);
+        pe = exm_pe_new(filename);
+        if (!pe)
+            continue;
+
+        files++;
+        size += exm_file_size_get(exm_pe_filename_get(pe));
+        if (exm_pe_nt_header_get(pe)->OptionalHeader.CheckSum &&
+            (exm_pe_nt_header_get(pe)->OptionalHeader.CheckSum != exm_pe_checksum_compute(pe)))
+        {
+            printf("%s: checksum mismatch\n", entry->d_name);
+            mismatches++;
+        }
+        pes = exm_list_append(pes, pe);
+    }
+    closedir(dir);
+
+    for (simd = exm_checksum_simd_set(1); simd >= 0; simd = (simd > 0) ? 0 : -1)
+    {
+        unsigned int i;
+        double t0;
+        double t;
+
+        exm_checksum_simd_set((unsigned char)simd);
+        t0 = _exm_bench_time_get();
+        for (i = 0; i < runs; i++)
+        {
+            for (iter = pes; iter; iter = iter->next)
+                exm_pe_checksum_compute((const Exm_Pe *)iter->data);
+        }
+        t = (_exm_bench_time_get() - t0) / runs;
+        printf("checksum (%-4s): %u files, %llu bytes, %u mismatches, %.3f ms, %.0f files/s, %.2f GB/s\n",
+               names[simd], files, size, mismatches, t * 1000.0,
+               (t > 0.0) ? files / t : 0.0, (t > 0.0) ? (double)size / t / 1e9 : 0.0);
+    }
+
+    exm_checksum_simd_set(1);
+    for (iter = pes; iter; iter = iter->next)
+        exm_pe_free((Exm_Pe *)iter->data);
+    exm_list_free(pes, NULL);
+
+    return 0;
+}
+
+static int
+_exm_bench_entropy(const char *dirname, unsigned int runs)
+{
+    char filename[4096];
+    Exm_List *pes = NULL;
+    Exm_List *iter;
+    struct dirent *entry;
+    unsigned long long size;
+    unsigned int files;
+    unsigned int packed;
+    unsigned int i;
+    DIR *dir;
+    double t0;
+    double t;
+
+    if (runs == 0)
+        runs = 1;
+
+    dir = opendir(dirname);
+    if (!dir)
+    {
+        printf("can not open directory %s\n", dirname);
+        return -1;
+    }
+
+    /* the files are opened once, only the histograms are timed */
+    files = 0;
+    while ((entry = readdir(dir)))
+    {
+        Exm_Pe *pe;
+        size_t l;
+
+        l = strlen(entry->d_name);
+        if ((l < 4) ||
+            ((_stricmp(entry->d_name + l - 4, ".dll") != 0) &&
+             (_stricmp(entry->d_name + l - 4, ".exe") != 0)))
+            continue;
+
+        snprintf(filename, sizeof(filename), "%s/%s", dirname, entry->d_name);
+        pe = exm_pe_new(filename);
+        if (!pe)
+            continue;
+
+        files++;
+        pes = exm_list_append(pes, pe);
+    }
+    closedir(dir);
+
+    size = 0;
+    packed = 0;
+    t0 = _exm_bench_time_get();
+    for (i = 0; i < runs; i++)
+    {
+        for (iter = pes; iter; iter = iter->next)
+        {
+            const Exm_Pe *pe;
+            const IMAGE_SECTION_HEADER *sh;
+            WORD j;
+
+            pe = (const Exm_Pe *)iter->data;
+            sh = IMAGE_FIRST_SECTION(exm_pe_nt_header_get(pe));
+            for (j = 0; j <= exm_pe_nt_header_get(pe)->FileHeader.NumberOfSections; j++, sh++)
+            {
+                Exm_Pe_Histogram histogram;
+                const void *data;
+                DWORD s;
+
+                /* the overlay after the sections */
+                if (j < exm_pe_nt_header_get(pe)->FileHeader.NumberOfSections)
+                    data = exm_pe_section_raw_data_get(pe, sh, &s);
+                else
+                    data = exm_pe_overlay_get(pe, &s);
+
+                memset(&histogram, 0, sizeof(histogram));
+                exm_pe_histogram_add(data, s, &histogram);
+                if ((i == 0) && (exm_pe_histogram_entropy_get(&histogram) > 7.2))
+                    packed++;
+                if (i == 0)
+                    size += s;
+            }
+        }
+    }
+    t = (_exm_bench_time_get() - t0) / runs;
+    printf("entropy  : %u files, %llu bytes, %u sections above 7.2, %.3f ms, %.0f files/s, %.2f GB/s\n",
+           files, size, packed, t * 1000.0,
+           (t > 0.0) ? files / t : 0.0, (t > 0.0) ? (double)size / t / 1e9 : 0.0);
+
+    for (iter = pes; iter; iter = iter->next)
+        exm_pe_free((Exm_Pe *)iter->data);
+    exm_list_free(pes, NULL);
+
+    return 0;
+}
+
+/* the memcheck records before the tracker, in a list */
+static int
+_exm_bench_tracker_list_cmp(const void *d1, const void *d2)
+{
+    return ((const Exm_Tracker_Block *)d1)->address != d2;
+}
+
+static double
+_exm_bench_tracker_list(const void **addresses, unsigned int blocks)
+{
+    Exm_Tracker_Block *records;
+    Exm_List *list = NULL;
+    Exm_List *iter;
+    unsigned int i;
+    double t0;
+
+    records = (Exm_Tracker_Block *)calloc(blocks, sizeof(Exm_Tracker_Block));
+    if (!records)
+        return -1.0;
+
+    t0 = _exm_bench_time_get();
+    for (i = 0; i < blocks; i++)
+    {
+        /* the list was searched for a freed record of the same address */
+        exm_list_data_is_found(list, addresses[i], _exm_bench_tracker_list_cmp);
+        records[i].address = addresses[i];
+        records[i].size = i;
+        list = exm_list_append(list, records + i);
+    }
+    for (i = 0; i < blocks; i++)
+    {
+        for (iter = list; iter; iter = iter->next)
+        {
+            Exm_Tracker_Block *record;
+
+            record = (Exm_Tracker_Block *)iter->data;
+            if (record->address == addresses[blocks - 1 - i])
+            {
+                record->frees++;
+                break;
+            }
+        }
+    }
+    t0 = _exm_bench_time_get() - t0;
+
+    exm_list_free(list, NULL);
+    free(records);
+
+    return (2.0 * blocks) / t0;
+}
+
+static int
+_exm_bench_tracker(unsigned int blocks)
+{
+    Exm_Tracker *tracker;
+    Exm_Tracker_Block block;
+    const void **addresses;
+    unsigned int state = 1;
+    unsigned int list_blocks;
+    unsigned int i;
+    double t0;
+    double t;
+    double rate;
+    int ret = -1;
+
+    if (blocks < 2)
+        blocks = 2;
+
+    addresses = (const void **)malloc(blocks * sizeof(const void *));
+    if (!addresses)
+        return -1;
+
+    /* addresses of blocks of 16 to 256 bytes, in a heap, shuffled */
+    addresses[0] = (const void *)(uintptr_t)0x10000000;
+    for (i = 1; i < blocks; i++)
+        addresses[i] = (const unsigned char *)addresses[i - 1] + 16 * (1 + _exm_bench_rand(&state) % 16);
+    for (i = blocks - 1; i > 0; i--)
+    {
+        const void *tmp;
+        unsigned int j;
+
+        j = _exm_bench_rand(&state) % (i + 1);
+        tmp = addresses[i];
+        addresses[i] = addresses[j];
+        addresses[j] = tmp;
+    }
+
+    tracker = exm_tracker_new();
+    if (!tracker)
+        goto free_addresses;
+
+    memset(&block, 0, sizeof(block));
+    t0 = _exm_bench_time_get();
+    for (i = 0; i < blocks; i++)
+    {
+        block.address = addresses[i];
+        block.size = i;
+        block.stack = i + 1;
+        if (!exm_tracker_block_add(tracker, &block, NULL))
+        {
+            printf("exm_tracker_block_add() failed\n");
+            goto free_tracker;
+        }
+    }
+    t = _exm_bench_time_get() - t0;
+    printf("tracker  : %u live blocks, %.0f allocs/s, %.1f bytes per block\n",
+           blocks, (double)blocks / t,
+           (double)exm_tracker_memory_get(tracker) / (double)blocks);
+
+    t0 = _exm_bench_time_get();
+    for (i = 0; i < blocks; i++)
+        exm_tracker_block_release(tracker, addresses[blocks - 1 - i], 1, NULL);
+    t = _exm_bench_time_get() - t0;
+    printf("           %.0f frees/s", (double)blocks / t);
+
+    /* the freed records are replaced */
+    t0 = _exm_bench_time_get();
+    for (i = 0; i < blocks; i++)
+    {
+        block.address = addresses[i];
+        exm_tracker_block_add(tracker, &block, NULL);
+    }
+    t = _exm_bench_time_get() - t0;
+    printf(", %.0f allocs/s at freed addresses", (double)blocks / t);
+
+    /* each block is moved to the address of the next one */
+    exm_tracker_block_del(tracker, addresses[0]);
+    t0 = _exm_bench_time_get();
+    for (i = 1; i < blocks; i++)
+        exm_tracker_block_move(tracker, addresses[i], addresses[i - 1], i, NULL);
+    t = _exm_bench_time_get() - t0;
+    printf(", %.0f reallocs/s\n", (double)(blocks - 1) / t);
+
+    if (exm_tracker_count(tracker) != blocks - 1)
+    {
+        printf("wrong number of records\n");
+        goto free_tracker;
+    }
+
+    list_blocks = (blocks < 20000) ? blocks : 20000;
+    rate = _exm_bench_tracker_list(addresses, list_blocks);
+    if (rate < 0.0)
+        goto free_tracker;
+    printf("list     : %u live blocks, %.0f allocs and frees/s\n", list_blocks, rate);
+
+    ret = 0;
+
+  free_tracker:
+    exm_tracker_free(tracker);
+  free_addresses:
+    free(addresses);
+
+    return ret;
+}
+
+/*
+ * A leak in a loop: blocks of 16 bytes at most from a smaller number
+ * of allocation sites, all lost but one, grouped in loss records then
+ * formatted in the buffer of the log, as memcheck does at exit.
+ */
+static int
+_exm_bench_leak_records(unsigned int blocks_nbr, unsigned int sites)
+{
+    Exm_Tracker_Block *blocks;
+    Exm_Leak_Record *records;
+    Exm_Leak *leak;
+    unsigned char *heap;
+    uintptr_t roots[1];
+    size_t nbr = 0;
+    size_t i;
+    double t0;
+    double t1;
+    double t2;
+    double t3;
+    int ret = -1;
+
+    heap = (unsigned char *)calloc(blocks_nbr, 16);
+    blocks = (Exm_Tracker_Block *)calloc(blocks_nbr, sizeof(Exm_Tracker_Block));
+    if (!heap || !blocks)
+    {
+        printf("can not allocate %u blocks\n", blocks_nbr);
+        goto free_heap;
+    }
+
+    for (i = 0; i < blocks_nbr; i++)
+    {
+        blocks[i].address = heap + 16 * i;
+        blocks[i].size = sizeof(uintptr_t) + (i % sites) % 8;
+        blocks[i].stack = (unsigned int)(i % sites) + 1;
+    }
+    roots[0] = (uintptr_t)heap;
+
+    t0 = _exm_bench_time_get();
+    leak = exm_leak_new(blocks, blocks_nbr);
+    if (!leak)
+    {
+        printf("exm_leak_new() failed\n");
+        goto free_heap;
+    }
+    exm_leak_root_scan(leak, roots, sizeof(roots));
+    exm_leak_run(leak);
+    t1 = _exm_bench_time_get();
+    records = exm_leak_records_new(leak, blocks, &nbr);
+    t2 = _exm_bench_time_get();
+    exm_leak_free(leak);
+    if (!records)
+    {
+        printf("exm_leak_records_new() failed\n");
+        goto free_heap;
+    }
+
+    /* the report is written on stderr */
+    exm_log_buffer_begin();
+    for (i = 0; i < nbr; i++)
+        EXM_LOG_INFO("%lu bytes in %lu block(s) are definitely lost [%d/%d]",
+                     (unsigned long)records[i].bytes, (unsigned long)records[i].blocks,
+                     (int)i + 1, (int)nbr);
+    exm_log_buffer_end();
+    t3 = _exm_bench_time_get();
+    free(records);
+
+    printf("records      : %u blocks, %lu loss records, classified in %.3f s, grouped in %.3f s, report formatted in %.3f s\n",
+           blocks_nbr, (unsigned long)nbr, t1 - t0, t2 - t1, t3 - t2);
+
+    ret = 0;
+
+  free_heap:
+    free(blocks);
+    free(heap);
+
+    return ret;
+}
+
+static int
+_exm_bench_leak(unsigned int megabytes)
+{
+    static const char *names[] = { "C", "SSE4.2", "AVX2" };
+    Exm_Tracker_Block *blocks;
+    Exm_Leak_Kind *kinds;
+    uintptr_t *heap;
+    uintptr_t roots[4096];
+    unsigned int state = 1;
+    size_t words;
+    size_t nbr;
+    size_t i;
+    int simd;
+    int ret = -1;
+
+    if (megabytes == 0)
+        megabytes = 1;
+
+    words = (size_t)megabytes * 1024 * 1024 / sizeof(uintptr_t);
+    heap = (uintptr_t *)malloc(words * sizeof(uintptr_t));
+    blocks = (Exm_Tracker_Block *)calloc(words / 2, sizeof(Exm_Tracker_Block));
+    kinds = (Exm_Leak_Kind *)malloc(words / 2 * sizeof(Exm_Leak_Kind));
+    if (!heap || !blocks || !kinds)
+    {
+        printf("can not allocate %u MB\n", megabytes);
+        goto free_heap;
+    }
+
+    /* blocks of 16 to 512 bytes, next to each other */
+    nbr = 0;
+    for (i = 0; i + 512 / sizeof(uintptr_t) <= words; )
+    {
+        size_t size;
+
+        size = 16 * (1 + _exm_bench_rand(&state) % 32);
+        blocks[nbr].address = heap + i;
+        blocks[nbr].size = size;
+        nbr++;
+        i += size / sizeof(uintptr_t);
+    }
+    words = i;
+
+    /* zeros, small integers, other values and pointers in a block */
+    for (i = 0; i < words; i++)
+    {
+        unsigned int r;
+
+        r = _exm_bench_rand(&state);
+        if (r % 8 == 0)
+            heap[i] = (uintptr_t)heap + (((uintptr_t)_exm_bench_rand(&state) << 8) % words) * sizeof(uintptr_t);
+        else if (r % 8 < 4)
+            heap[i] = 0;
+        else if (r % 8 < 6)
+            heap[i] = r % 1000;
+        else
+            heap[i] = ((uintptr_t)r << 40) ^ ((uintptr_t)_exm_bench_rand(&state) << 16) ^ r;
+    }
+    for (i = 0; i < sizeof(roots) / sizeof(roots[0]); i++)
+        roots[i] = (uintptr_t)blocks[_exm_bench_rand(&state) % nbr].address;
+
+    for (simd = exm_leak_simd_set(1); simd >= 0; simd = (simd > 0) ? 0 : -1)
+    {
+        Exm_Leak *leak;
+        size_t counts[4] = { 0, 0, 0, 0 };
+        size_t mismatches = 0;
+        double t0;
+        double t1;
+        double t;
+
+        exm_leak_simd_set((unsigned char)simd);
+        t0 = _exm_bench_time_get();
+        leak = exm_leak_new(blocks, nbr);
+        if (!leak)
+        {
+            printf("exm_leak_new() failed\n");
+            goto free_heap;
+        }
+        t1 = _exm_bench_time_get();
+        exm_leak_root_scan(leak, roots, sizeof(roots));
+        exm_leak_run(leak);
+        t = _exm_bench_time_get() - t1;
+
+        for (i = 0; i < nbr; i++)
+        {
+            Exm_Leak_Kind kind;
+
+            kind = exm_leak_kind_get(leak, i);
+            counts[kind]++;
+            if ((simd == 0) && (kind != kinds[i]))
+                mismatches++;
+            kinds[i] = kind;
+        }
+
+        printf("leak (%-6s): %u MB, %lu blocks, prepared in %.3f s, %llu bytes scanned in %.3f s, %.2f GB/s\n",
+               names[simd], megabytes, (unsigned long)nbr, t1 - t0,
+               exm_leak_scanned_get(leak), t,
+               (t > 0.0) ? (double)exm_leak_scanned_get(leak) / t / 1e9 : 0.0);
+        printf("               %lu definitely, %lu indirectly, %lu possibly lost, %lu still reachable",
+               (unsigned long)counts[EXM_LEAK_DEFINITELY_LOST],
+               (unsigned long)counts[EXM_LEAK_INDIRECTLY_LOST],
+               (unsigned long)counts[EXM_LEAK_POSSIBLY_LOST],
+               (unsigned long)counts[EXM_LEAK_STILL_REACHABLE]);
+        if (simd == 0)
+            printf(", %lu mismatches", (unsigned long)mismatches);
+        printf("\n");
+
+        exm_leak_free(leak);
+    }
+    exm_leak_simd_set(1);
+
+    ret = _exm_bench_leak_records(1000000, 1000);
+
+  free_heap:
+    free(kinds);
+    free(blocks);
+    free(heap);
+
+    return ret;
+}
+
+#ifndef _WIN32
+
+/* workload of the memcheck benchmark, run in the child process */
+static int
+_exm_bench_alloc(unsigned int allocations)
+{
+    void *window[1024];
+    unsigned int state = 1;
+    unsigned int i;
+    double t0;
+
+    memset(window, 0, sizeof(window));
+    t0 = _exm_bench_time_get();
+    for (i = 0; i < allocations; i++)
+    {
+        unsigned int slot;
+        unsigned int r;
+        size_t size;
+
+        r = _exm_bench_rand(&state);
+        slot = r % 1024;
+        size = 16 + (r >> 10) % 240;
+        free(window[slot]);
+        switch (i & 7)
+        {
+            case 0:
+                window[slot] = calloc(1, size);
+                break;
+            case 1:
+                window[slot] = strdup("examine memcheck benchmark");
+                break;
+            case 2:
+                window[slot] = malloc(size);
+                if (window[slot])
+                {
+                    void *p;
+
+                    memset(window[slot], 0, size);
+                    p = realloc(window[slot], 2 * size);
+                    if (p)
+                        window[slot] = p;
+                }
+                break;
+            default:
+                window[slot] = malloc(size);
+                if (window[slot])
+                    memset(window[slot], 0, size);
+                break;
+        }
+    }
+    for (i = 0; i < 1024; i++)
+        free(window[i]);
+    printf("%f\n", _exm_bench_time_get() - t0);
+
+    return 0;
+}
+
+/* time of the workload in a child process, negative on error */
+static double
+_exm_bench_alloc_run(const char *preload, unsigned int allocations, const char *interval)
+{
+    char self[4096];
+    char buf[64];
+    char nbr[16];
+    int fds[2];
+    pid_t pid;
+    ssize_t len;
+    int status;
+
+    len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (len <= 0)
+        return -1.0;
+    self[len] = '\0';
+    snprintf(nbr, sizeof(nbr), "%u", allocations);
+
+    if (pipe(fds) != 0)
+        return -1.0;
+
+    pid = fork();
+    if (pid < 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return -1.0;
+    }
+
+    if (pid == 0)
+    {
+        char *args[4];
+
+        args[0] = self;
+        args[1] = (char *)"alloc";
+        args[2] = nbr;
+        args[3] = NULL;
+        close(fds[0]);
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[1]);
+        if (preload)
+        {
+            setenv("LD_PRELOAD", preload, 1);
+            /* only the errors, not the report of each run */
+            setenv("EXM_MEMCHECK_LOG_LEVEL", "0", 1);
+            setenv("EXM_MEMCHECK_SAMPLE_INTERVAL", interval, 1);
+        }
+        execv(self, args);
+        _exit(127);
+    }
+
+    close(fds[1]);
+    len = read(fds[0], buf, sizeof(buf) - 1);
+    close(fds[0]);
+    while (waitpid(pid, &status, 0) < 0)
+        ;
+    if ((len <= 0) || !WIFEXITED(status) || (WEXITSTATUS(status) != 0))
+        return -1.0;
+    buf[len] = '\0';
+
+    return atof(buf);
+}
+
+static int
+_exm_bench_memcheck(const char *preload, unsigned int allocations, const char *interval)
+{
+    double native = -1.0;
+    double hooked = -1.0;
+    int i;
+
+    /*
+     * best time of a few runs, the machine being shared, each run with
+     * the library following a native one, so that both see the same
+     * load
+     */
+    for (i = 0; i < 5; i++)
+    {
+        double t;
+
+        t = _exm_bench_alloc_run(NULL, allocations, interval);
+        if (t <= 0.0)
+        {
+            printf("can not run the workload\n");
+            return -1;
+        }
+        if ((native < 0.0) || (t < native))
+            native = t;
+
+        t = _exm_bench_alloc_run(preload, allocations, interval);
+        if (t <= 0.0)
+        {
+            printf("can not run the workload with %s\n", preload);
+            return -1;
+        }
+        if ((hooked < 0.0) || (t < hooked))
+            hooked = t;
+    }
+
+    printf("native   : %u allocations, %.0f allocs/s\n",
+           allocations, (double)allocations / native);
+    printf("memcheck : %u allocations, %.0f allocs/s, %.2fx slowdown",
+           allocations, (double)allocations / hooked, hooked / native);
+    if (atoi(interval) > 0)
+        printf(", 1 block sampled every %s bytes", interval);
+    printf("\n");
+
+    return 0;
+}
+
+#endif
+
+int main(int argc, char *argv[])
+{
+    int ret = -1;
+
+    if (argc < 2)
+    {
+        printf("Usage: %s stack <file> [frames]\n", argv[0]);
+        printf("       %s depot [allocations] [sites]\n", argv[0]);
+        printf("       %s symbol <PE file> [lookups]\n", argv[0]);
+        printf("       %s coff <PE file> [lookups]\n", argv[0]);
+        printf("       %s reloc <PE file> [runs]\n", argv[0]);
+        printf("       %s version <directory> [runs]\n", argv[0]);
+        printf("       %s digest <PE file> [runs]\n", argv[0]);
+        printf("       %s checksum <directory> [runs]\n", argv[0]);
+        printf("       %s entropy <directory> [runs]\n", argv[0]);
+        printf("       %s tracker [blocks]\n", argv[0]);
+        printf("       %s leak [megabytes]\n", argv[0]);
+        printf("       %s memcheck <preload library> [allocations] [sample interval]\n", argv[0]);
+        return -1;
+    }
+
+#ifndef _WIN32
+    /* child of the memcheck benchmark, without the library initialized */
+    if (strcmp(argv[1], "alloc") == 0)
+        return _exm_bench_alloc((argc > 2) ? (unsigned int)atoi(argv[2]) : 10000000);
+#endif
+
+    exm_init();
+
+    if (strcmp(argv[1], "stack") == 0)
+    {
+#ifdef HAVE_BFD
+        bfd_init();
+        if (argc > 2)
+            ret = _exm_bench_stack(argv[2], (argc > 3) ? (unsigned int)atoi(argv[3]) : 200);
+        else
+            printf("missing file\n");
+#else
+        printf("libbfd is needed by the stack benchmark\n");
+#endif
+    }
+    else if (strcmp(argv[1], "depot") == 0)
+        ret = _exm_bench_depot((argc > 2) ? (unsigned int)atoi(argv[2]) : 1000000,
+                               (argc > 3) ? (unsigned int)atoi(argv[3]) : 2000);
+    else if (strcmp(argv[1], "symbol") == 0)
+    {
+#ifdef HAVE_BFD
+        bfd_init();
+#endif
+        if (argc > 2)
+            ret = _exm_bench_symbol(argv[2], (argc > 3) ? (unsigned int)atoi(argv[3]) : 1000000);
+        else
+            printf("missing file\n");
+    }
+    else if (strcmp(argv[1], "coff") == 0)
+    {
+        if (argc > 2)
+            ret = _exm_bench_coff(argv[2], (argc > 3) ? (unsigned int)atoi(argv[3]) : 1000000);
+        else
+            printf("missing file\n");
+    }
+    else if (strcmp(argv[1], "reloc") == 0)
+    {
+        if (argc > 2)
+            ret = _exm_bench_reloc(argv[2], (argc > 3) ? (unsigned int)atoi(argv[3]) : 10);
+        else
+            printf("missing file\n");
+    }
+    else if (strcmp(argv[1], "version") == 0)
+    {
+        if (argc > 2)
+            ret = _exm_bench_version(argv[2], (argc > 3) ? (unsigned int)atoi(argv[3]) : 1);
+        else
+            printf("missing directory\n");
+    }
+    else if (strcmp(argv[1], "digest") == 0)
+    {
+        if (argc > 2)
+            ret = _exm_bench_digest(argv[2], (argc > 3) ? (unsigned int)atoi(argv[3]) : 10);
+        else
+            printf("missing file\n");
+    }
+    else if (strcmp(argv[1], "checksum") == 0)
+    {
+        if (argc > 2)
+            ret = _exm_bench_checksum(argv[2], (argc > 3) ? (unsigned int)atoi(argv[3]) : 10);
+        else
+            printf("missing directory\n");
+    }
+    else if (strcmp(argv[1], "entropy") == 0)
+    {
+        if (argc > 2)
+            ret = _exm_bench_entropy(argv[2], (argc > 3) ? (unsigned int)atoi(argv[3]) : 10);
+        else
+            printf("missing directory\n");
+    }
+    else if (strcmp(argv[1], "tracker") == 0)
+        ret = _exm_bench_tracker((argc > 2) ? (unsigned int)atoi(argv[2]) : 1000000);
+    else if (strcmp(argv[1], "leak") == 0)
+        ret = _exm_bench_leak((argc > 2) ? (unsigned int)atoi(argv[2]) : 1024);
+    else if (strcmp(argv[1], "memcheck") == 0)
+    {
+#ifndef _WIN32
+        if (argc > 2)
+            ret = _exm_bench_memcheck(argv[2],
+                                      (argc > 3) ? (unsigned int)atoi(argv[3]) : 10000000,
+                                      (argc > 4) ? argv[4] : "0");
+        else
+            printf("missing preload library\n");
+#else
+        printf("the memcheck benchmark uses LD_PRELOAD\n");
+#endif
+    }
+    else
+        printf("unknown benchmark %s\n", argv[1]);
+
+    exm_shutdown();
+
+    return ret;
+}
@@ -0,0 +1,2970 @@
+/* Examine - a tool for memory leak detection on Windows
+ *
+ * Copyright (C) 2012-2013 Vincent Torri.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Unit tests of the library.
+ *
+ * Usage: examine_test_unit [test]
+ *
+ * Without argument, all the tests are run.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef _WIN32
+# include <pthread.h>
+#endif
+
+#ifdef EXM_TEST_MEMCHECK_PRELOAD
+# include <malloc.h>
+# include <unistd.h>
+# include <sys/wait.h>
+#endif
+
+#include "Examine.h"
+
+#include "examine_private_checksum.h"
+#include "examine_private_coff.h"
+#include "examine_private_dwarf.h"
+#include "examine_private_histogram.h"
+#include "examine_private_leak.h"
+#include "examine_private_pdb.h"
+#include "examine_private_sha.h"
+#include "examine_private_symbol_cache.h"
+
+static int _exm_test_failures = 0;
+
+#define EXM_TEST_CHECK(cond) \
+do \
+{ \
+    if (!(cond)) \
+    { \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        _exm_test_failures++; \
+    } \
+} while (0)
+
+static void
+_exm_test_stack_depot(void)
+{
+    Exm_Stack_Depot *depot;
+    Exm_Stack_Pc pcs[64];
+    const Exm_Stack_Pc *res;
+    unsigned int ids[1000];
+    unsigned int nbr;
+    unsigned int id;
+    unsigned int i;
+    unsigned int j;
+
+    depot = exm_stack_depot_new();
+    EXM_TEST_CHECK(depot != NULL);
+    if (!depot)
+        return;
+
+    EXM_TEST_CHECK(exm_stack_depot_count(depot) == 0);
+    EXM_TEST_CHECK(exm_stack_depot_put(depot, pcs, 0) == 0);
+    EXM_TEST_CHECK(exm_stack_depot_get(depot, 0, &nbr) == NULL);
+    EXM_TEST_CHECK(nbr == 0);
+    EXM_TEST_CHECK(exm_stack_depot_get(depot, 1, &nbr) == NULL);
+
+    /* 1000 distinct stacks of various depths, enough to grow the table */
+    for (i = 0; i < 1000; i++)
+    {
+        for (j = 0; j < 1 + i % 64; j++)
+        {
+            pcs[j].module = j % 3;
+            pcs[j].offset = i * 64 + j;
+        }
+        ids[i] = exm_stack_depot_put(depot, pcs, 1 + i % 64);
+        EXM_TEST_CHECK(ids[i] != 0);
+    }
+    EXM_TEST_CHECK(exm_stack_depot_count(depot) == 1000);
+
+    /* the same stacks again give the same ids */
+    for (i = 0; i < 1000; i++)
+    {
+        for (j = 0; j < 1 + i % 64; j++)
+        {
+            pcs[j].module = j % 3;
+            pcs[j].offset = i * 64 + j;
+        }
+        id = exm_stack_depot_put(depot, pcs, 1 + i % 64);
+        EXM_TEST_CHECK(id == ids[i]);
+    }
+    EXM_TEST_CHECK(exm_stack_depot_count(depot) == 1000);
+
+    /* a prefix of a stored stack is another stack */
+    for (j = 0; j < 10; j++)
+    {
+        pcs[j].module = j % 3;
+        pcs[j].offset = 999 * 64 + j;
+    }
+    id = exm_stack_depot_put(depot, pcs, 9);
+    EXM_TEST_CHECK((id != 0) && (id != ids[999]));
+    EXM_TEST_CHECK(exm_stack_depot_count(depot) == 1001);
+
+    /* the frames are returned unchanged */
+    for (i = 0; i < 1000; i++)
+    {
+        res = exm_stack_depot_get(depot, ids[i], &nbr);
+        EXM_TEST_CHECK(res != NULL);
+        EXM_TEST_CHECK(nbr == 1 + i % 64);
+        if (!res)
+            continue;
+        for (j = 0; j < nbr; j++)
+        {
+            EXM_TEST_CHECK(res[j].module == j % 3);
+            EXM_TEST_CHECK(res[j].offset == i * 64 + j);
+        }
+    }
+
+    EXM_TEST_CHECK(exm_stack_depot_memory_get(depot) > 0);
+
+    exm_stack_depot_free(depot);
+}
+
+static void
+_exm_test_symbol_index(void)
+{
+    Exm_Symbol_Index *index;
+    const char *func;
+    const char *file;
+    unsigned int line;
+    unsigned int a;
+    unsigned int b;
+    unsigned int n;
+
+    index = exm_symbol_index_new();
+    EXM_TEST_CHECK(index != NULL);
+    if (!index)
+        return;
+
+    a = exm_symbol_index_string_add(index, "a.c");
+    b = exm_symbol_index_string_add(index, "b.c");
+    EXM_TEST_CHECK(a != 0);
+    EXM_TEST_CHECK(b != 0);
+    EXM_TEST_CHECK(a != b);
+    EXM_TEST_CHECK(exm_symbol_index_string_add(index, "a.c") == a);
+    EXM_TEST_CHECK(exm_symbol_index_string_add(index, "") == 0);
+
+    exm_symbol_index_function_add(index, 0x100, 0x180, "alpha");
+    exm_symbol_index_function_add(index, 0x100, 0x180, "alpha_alias");
+    exm_symbol_index_function_add(index, 0x400, 0x420, "gamma");
+    exm_symbol_index_function_add(index, 0x180, 0, "beta");
+
+    exm_symbol_index_line_add(index, 0x100, a, 10);
+    exm_symbol_index_line_add(index, 0x110, a, 11);
+    exm_symbol_index_line_add(index, 0x110, a, 12);
+    exm_symbol_index_line_add(index, 0x140, a, 20);
+    exm_symbol_index_line_add(index, 0x180, a, 0);
+    exm_symbol_index_line_add(index, 0x200, b, 6);
+    exm_symbol_index_line_add(index, 0x210, b, 0);
+    exm_symbol_index_line_add(index, 0x180, b, 5);
+
+    EXM_TEST_CHECK(exm_symbol_index_build(index));
+    EXM_TEST_CHECK(!exm_symbol_index_line_add(index, 0x500, a, 1));
+
+    EXM_TEST_CHECK(!exm_symbol_index_find(index, 0xff, &func, &file, &line));
+    EXM_TEST_CHECK(func == NULL);
+
+    EXM_TEST_CHECK(exm_symbol_index_find(index, 0x100, &func, &file, &line));
+    EXM_TEST_CHECK(func && (strcmp(func, "alpha") == 0));
+    EXM_TEST_CHECK(file && (strcmp(file, "a.c") == 0));
+    EXM_TEST_CHECK(line == 10);
+
+    /* the last row at an address is the used one */
+    exm_symbol_index_find(index, 0x13f, &func, &file, &line);
+    EXM_TEST_CHECK(line == 12);
+    exm_symbol_index_find(index, 0x140, &func, &file, &line);
+    EXM_TEST_CHECK(line == 20);
+
+    /* a sequence starting where another one ends */
+    EXM_TEST_CHECK(exm_symbol_index_find(index, 0x180, &func, &file, &line));
+    EXM_TEST_CHECK(func && (strcmp(func, "beta") == 0));
+    EXM_TEST_CHECK(file && (strcmp(file, "b.c") == 0));
+    EXM_TEST_CHECK(line == 5);
+    exm_symbol_index_find(index, 0x20f, &func, &file, &line);
+    EXM_TEST_CHECK(line == 6);
+
+    /* a function without end goes up to the next one */
+    EXM_TEST_CHECK(exm_symbol_index_find(index, 0x3ff, &func, &file, &line));
+    EXM_TEST_CHECK(func && (strcmp(func, "beta") == 0));
+    EXM_TEST_CHECK(file == NULL);
+    EXM_TEST_CHECK(line == 0);
+
+    EXM_TEST_CHECK(exm_symbol_index_find(index, 0x41f, &func, &file, &line));
+    EXM_TEST_CHECK(func && (strcmp(func, "gamma") == 0));
+    EXM_TEST_CHECK(!exm_symbol_index_find(index, 0x420, &func, &file, &line));
+    EXM_TEST_CHECK(!exm_symbol_index_find(index, 0xffffffff, &func, &file, &line));
+
+    exm_symbol_index_free(index);
+
+    /* an inlined function splits its caller, an overlapping one shortens it */
+    index = exm_symbol_index_new();
+    if (!index)
+        return;
+
+    exm_symbol_index_function_add(index, 0x100, 0x200, "outer");
+    exm_symbol_index_function_add(index, 0x140, 0x160, "inlined");
+    exm_symbol_index_function_add(index, 0x148, 0x150, "nested");
+    exm_symbol_index_function_add(index, 0x1f0, 0x220, "overlap");
+    EXM_TEST_CHECK(exm_symbol_index_build(index));
+
+    exm_symbol_index_find(index, 0x13f, &func, &file, &line);
+    EXM_TEST_CHECK(func && (strcmp(func, "outer") == 0));
+    exm_symbol_index_find(index, 0x140, &func, &file, &line);
+    EXM_TEST_CHECK(func && (strcmp(func, "inlined") == 0));
+    exm_symbol_index_find(index, 0x14c, &func, &file, &line);
+    EXM_TEST_CHECK(func && (strcmp(func, "nested") == 0));
+    exm_symbol_index_find(index, 0x150, &func, &file, &line);
+    EXM_TEST_CHECK(func && (strcmp(func, "inlined") == 0));
+    exm_symbol_index_find(index, 0x1ef, &func, &file, &line);
+    EXM_TEST_CHECK(func && (strcmp(func, "outer") == 0));
+    exm_symbol_index_find(index, 0x1f0, &func, &file, &line);
+    EXM_TEST_CHECK(func && (strcmp(func, "overlap") == 0));
+    exm_symbol_index_find(index, 0x21f, &func, &file, &line);
+    EXM_TEST_CHECK(func && (strcmp(func, "overlap") == 0));
+    EXM_TEST_CHECK(!exm_symbol_index_find(index, 0x220, &func, &file, &line));
+
+    exm_symbol_index_free(index);
+
+    /* all the shapes of the Eytzinger tree, against a linear search */
+    for (n = 1; n <= 70; n++)
+    {
+        unsigned int rva;
+        unsigned int i;
+
+        index = exm_symbol_index_new();
+        if (!index)
+            return;
+
+        for (i = 0; i < n; i++)
+        {
+            char name[16];
+
+            snprintf(name, sizeof(name), "f%u", i);
+            exm_symbol_index_function_add(index, 16 * i + 8, 16 * i + 12, name);
+        }
+        exm_symbol_index_build(index);
+        EXM_TEST_CHECK(exm_symbol_index_count(index) == 2 * n);
+
+        for (rva = 0; rva < 16 * n + 16; rva++)
+        {
+            char name[16];
+            unsigned char expected;
+
+            expected = (rva / 16 < n) && (rva % 16 >= 8) && (rva % 16 < 12);
+            snprintf(name, sizeof(name), "f%u", rva / 16);
+            if (exm_symbol_index_find(index, rva, &func, &file, &line) != expected)
+            {
+                EXM_TEST_CHECK(!"lookup in the tree");
+                break;
+            }
+            if (expected && (strcmp(func, name) != 0))
+            {
+                EXM_TEST_CHECK(!"function of the lookup");
+                break;
+            }
+        }
+
+        exm_symbol_index_free(index);
+    }
+}
+
+/*
+ * A DWARF 4 line program, with a directory and an absolute file,
+ * followed by a DWARF 5 one, whose directories are in .debug_line_str
+ */
+static const unsigned char _exm_test_debug_line[] =
+{
+    0x4e, 0x00, 0x00, 0x00, 0x04, 0x00, 0x2c, 0x00, 0x00, 0x00, 0x01, 0x01,
+    0x01, 0xfb, 0x0e, 0x0d, 0x00, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x01, 0x2f, 0x73, 0x72, 0x63, 0x00, 0x00, 0x61, 0x2e,
+    0x63, 0x00, 0x01, 0x00, 0x00, 0x2f, 0x61, 0x62, 0x73, 0x2f, 0x62, 0x2e,
+    0x68, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x09, 0x02, 0x00, 0x10, 0x40,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x03, 0x09, 0x4b, 0x04, 0x02, 0x02,
+    0x08, 0x03, 0x7b, 0x01, 0x09, 0x10, 0x00, 0x00, 0x01, 0x01, 0x4e, 0x00,
+    0x00, 0x00, 0x05, 0x00, 0x08, 0x00, 0x2e, 0x00, 0x00, 0x00, 0x01, 0x01,
+    0x01, 0xfb, 0x0e, 0x0d, 0x00, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x01, 0x01, 0x01, 0x1f, 0x02, 0x00, 0x00, 0x00, 0x00,
+    0x06, 0x00, 0x00, 0x00, 0x02, 0x01, 0x08, 0x02, 0x0b, 0x02, 0x6d, 0x2e,
+    0x63, 0x00, 0x00, 0x78, 0x2e, 0x68, 0x00, 0x01, 0x00, 0x09, 0x02, 0x00,
+    0x20, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x03, 0x04, 0x01,
+    0x04, 0x01, 0x2e, 0x02, 0x06, 0x00, 0x01, 0x01
+};
+
+static const char _exm_test_debug_line_str[] = "/comp\0inc";
+
+static void
+_exm_test_dwarf_lines(void)
+{
+    Exm_Dwarf_Sections sections;
+    Exm_Symbol_Index *index;
+    const char *func;
+    const char *file;
+    unsigned int line;
+
+    index = exm_symbol_index_new();
+    EXM_TEST_CHECK(index != NULL);
+    if (!index)
+        return;
+
+    memset(&sections, 0, sizeof(Exm_Dwarf_Sections));
+    sections.line.data = _exm_test_debug_line;
+    sections.line.size = sizeof(_exm_test_debug_line);
+    sections.line_str.data = (const unsigned char *)_exm_test_debug_line_str;
+    sections.line_str.size = sizeof(_exm_test_debug_line_str);
+
+    EXM_TEST_CHECK(exm_dwarf_lines_add(&sections, 0x400000, index));
+    EXM_TEST_CHECK(exm_symbol_index_build(index));
+
+    EXM_TEST_CHECK(exm_symbol_index_find(index, 0x1000, &func, &file, &line));
+    EXM_TEST_CHECK(func == NULL);
+    EXM_TEST_CHECK(file && (strcmp(file, "/src/a.c") == 0));
+    EXM_TEST_CHECK(line == 1);
+    exm_symbol_index_find(index, 0x100b, &func, &file, &line);
+    EXM_TEST_CHECK(line == 11);
+    exm_symbol_index_find(index, 0x100c, &func, &file, &line);
+    EXM_TEST_CHECK(file && (strcmp(file, "/abs/b.h") == 0));
+    EXM_TEST_CHECK(line == 6);
+    EXM_TEST_CHECK(!exm_symbol_index_find(index, 0x101c, &func, &file, &line));
+
+    EXM_TEST_CHECK(exm_symbol_index_find(index, 0x2001, &func, &file, &line));
+    EXM_TEST_CHECK(file && (strcmp(file, "/comp/m.c") == 0));
+    EXM_TEST_CHECK(line == 5);
+    EXM_TEST_CHECK(exm_symbol_index_find(index, 0x2007, &func, &file, &line));
+    EXM_TEST_CHECK(file && (strcmp(file, "inc/x.h") == 0));
+    EXM_TEST_CHECK(line == 5);
+    EXM_TEST_CHECK(!exm_symbol_index_find(index, 0x2008, &func, &file, &line));
+
+    exm_symbol_index_free(index);
+
+    /* a truncated table is an error, but the rows before it are kept */
+    index = exm_symbol_index_new();
+    if (!index)
+        return;
+    sections.line.size = sizeof(_exm_test_debug_line) - 4;
+    EXM_TEST_CHECK(!exm_dwarf_lines_add(&sections, 0x400000, index));
+    exm_symbol_index_build(index);
+    EXM_TEST_CHECK(exm_symbol_index_find(index, 0x1000, &func, &file, &line));
+    exm_symbol_index_free(index);
+}
+
+/*
+ * Frames of the PE fixtures built by MinGW from the sources in
+ * src/tests/data, as given by addr2line. The same code is described
+ * by DWARF 5 and by DWARF 4.
+ */
+typedef struct
+{
+    unsigned int rva;
+    const char *function;
+    const char *filename;
+    unsigned int line;
+} Exm_Test_Frame;
+
+static const Exm_Test_Frame _exm_test_dwarf_frames[] =
+{
+    { 0x1000, "dwarf_a_static", "/examine/examine_test_dwarf_a.c", 38 },
+    /* inlined function */
+    { 0x1001, "dwarf_square", "/examine/examine_test_dwarf.h", 32 },
+    { 0x1006, "dwarf_a_static", "/examine/examine_test_dwarf_a.c", 39 },
+    { 0x1020, "dwarf_a_check", "/examine/examine_test_dwarf_a.c", 52 },
+    /* second unit */
+    { 0x1032, "dwarf_b_compute", "/examine/examine_test_dwarf_b.c", 34 },
+    { 0x1054, "dwarf_a_fail", "/examine/examine_test_dwarf_a.c", 46 },
+    /* cold part of a function, in its ranges */
+    { 0x105d, "dwarf_a_check", "/examine/examine_test_dwarf_a.c", 51 },
+    { 0x1080, "main", "/examine/examine_test_dwarf_a.c", 64 }
+};
+
+static void
+_exm_test_dwarf_index_check(const char *filename)
+{
+    Exm_Dwarf_Sections sections;
+    Exm_Symbol_Index *index;
+    Exm_Pe *pe;
+    const char *func;
+    const char *file;
+    unsigned int line;
+    unsigned int i;
+
+    pe = exm_pe_new(filename);
+    EXM_TEST_CHECK(pe != NULL);
+    if (!pe)
+        return;
+
+    EXM_TEST_CHECK(exm_dwarf_sections_get(pe, &sections));
+    EXM_TEST_CHECK(sections.info.data && sections.abbrev.data && sections.aranges.data);
+
+    index = exm_symbol_index_new();
+    if (!index)
+    {
+        exm_pe_free(pe);
+        return;
+    }
+
+    EXM_TEST_CHECK(exm_dwarf_index_add(&sections, exm_pe_image_base_get(pe), index));
+    EXM_TEST_CHECK(exm_symbol_index_build(index));
+
+    for (i = 0; i < sizeof(_exm_test_dwarf_frames) / sizeof(_exm_test_dwarf_frames[0]); i++)
+    {
+        const Exm_Test_Frame *frame;
+
+        frame = _exm_test_dwarf_frames + i;
+        EXM_TEST_CHECK(exm_symbol_index_find(index, frame->rva, &func, &file, &line));
+        EXM_TEST_CHECK(func && (strcmp(func, frame->function) == 0));
+        EXM_TEST_CHECK(file && (strcmp(file, frame->filename) == 0));
+        EXM_TEST_CHECK(line == frame->line);
+    }
+
+    EXM_TEST_CHECK(!exm_symbol_index_find(index, 0xfff, &func, &file, &line));
+
+    exm_symbol_index_free(index);
+    exm_pe_free(pe);
+}
+
+static void
+_exm_test_dwarf_index(void)
+{
+    _exm_test_dwarf_index_check(EXM_TEST_DATA_DIR "/examine_test_dwarf5.exe");
+    _exm_test_dwarf_index_check(EXM_TEST_DATA_DIR "/examine_test_dwarf4.exe");
+}
+
+/*
+ * Frames of the PE fixture examine_test_pdb.exe, whose debug
+ * information is in examine_test_pdb.pdb.
+ */
+static const Exm_Test_Frame _exm_test_pdb_frames[] =
+{
+    { 0x1000, "pdb_square", "/examine/examine_test_pdb.c", 45 },
+    { 0x1003, "pdb_square", "/examine/examine_test_pdb.c", 46 },
+    { 0x100a, "pdb_sum", "/examine/examine_test_pdb.c", 54 },
+    { 0x1016, "pdb_sum", "/examine/examine_test_pdb.c", 51 },
+    { 0x102c, "pdb_sum", "/examine/examine_test_pdb.c", 58 },
+    { 0x1044, "main", "/examine/examine_test_pdb.c", 64 }
+};
+
+static void
+_exm_test_pdb_index(void)
+{
+    Exm_Symbol_Index *index;
+    Exm_Pdb *pdb;
+    Exm_Pe *pe;
+    const char *func;
+    const char *file;
+    unsigned int line;
+    unsigned int i;
+    GUID guid;
+    DWORD age;
+
+    /* not a PDB file */
+    EXM_TEST_CHECK(exm_pdb_new(EXM_TEST_DATA_DIR "/examine_test_pdb.exe") == NULL);
+
+    pe = exm_pe_new(EXM_TEST_DATA_DIR "/examine_test_pdb.exe");
+    EXM_TEST_CHECK(pe != NULL);
+    if (!pe)
+        return;
+
+    EXM_TEST_CHECK(exm_pe_codeview_get(pe, &guid, &age) != NULL);
+    EXM_TEST_CHECK(age == 1);
+
+    /* found with the name of the PE file */
+    pdb = exm_pdb_find(pe);
+    EXM_TEST_CHECK(pdb != NULL);
+    if (!pdb)
+    {
+        exm_pe_free(pe);
+        return;
+    }
+
+    EXM_TEST_CHECK(exm_pdb_match(pdb, &guid, age));
+    EXM_TEST_CHECK(!exm_pdb_match(pdb, &guid, age + 1));
+
+    index = exm_symbol_index_new();
+    if (!index)
+    {
+        exm_pdb_free(pdb);
+        exm_pe_free(pe);
+        return;
+    }
+
+    /* no section headers in the PDB file, those of the PE file are used */
+    EXM_TEST_CHECK(!exm_pdb_index_add(pdb, NULL, index));
+    EXM_TEST_CHECK(exm_pdb_index_add(pdb, pe, index));
+    EXM_TEST_CHECK(exm_symbol_index_build(index));
+
+    for (i = 0; i < sizeof(_exm_test_pdb_frames) / sizeof(_exm_test_pdb_frames[0]); i++)
+    {
+        const Exm_Test_Frame *frame;
+
+        frame = _exm_test_pdb_frames + i;
+        EXM_TEST_CHECK(exm_symbol_index_find(index, frame->rva, &func, &file, &line));
+        EXM_TEST_CHECK(func && (strcmp(func, frame->function) == 0));
+        EXM_TEST_CHECK(file && (strcmp(file, frame->filename) == 0));
+        EXM_TEST_CHECK(line == frame->line);
+    }
+
+    /* past the end of main */
+    EXM_TEST_CHECK(!exm_symbol_index_find(index, 0x1045, &func, &file, &line));
+
+    exm_symbol_index_free(index);
+    exm_pdb_free(pdb);
+    exm_pe_free(pe);
+}
+
+static void
+_exm_test_symbol_cache(void)
+{
+    char key[EXM_SYMBOL_CACHE_KEY_SIZE];
+    char other_key[EXM_SYMBOL_CACHE_KEY_SIZE];
+    Exm_Symbol_Index *index;
+    Exm_Symbol_Index *cached;
+    Exm_Pdb *pdb;
+    Exm_Pe *pe;
+    FILE *f;
+    const char *func;
+    const char *file;
+    unsigned int line;
+    unsigned int i;
+
+    /* without CodeView record, the key is the time stamp and the size */
+    pe = exm_pe_new(EXM_TEST_DATA_DIR "/examine_test_dwarf5.exe");
+    EXM_TEST_CHECK(pe != NULL);
+    if (!pe)
+        return;
+    exm_symbol_cache_key_get(pe, other_key);
+    exm_pe_free(pe);
+
+    pe = exm_pe_new(EXM_TEST_DATA_DIR "/examine_test_pdb.exe");
+    EXM_TEST_CHECK(pe != NULL);
+    if (!pe)
+        return;
+    exm_symbol_cache_key_get(pe, key);
+    EXM_TEST_CHECK(strcmp(key, "D7955D1CAF1756CBE6350D9EED0828231") == 0);
+    EXM_TEST_CHECK(strcmp(key, other_key) != 0);
+
+    pdb = exm_pdb_find(pe);
+    index = exm_symbol_index_new();
+    if (!pdb || !index)
+    {
+        EXM_TEST_CHECK(0);
+        exm_symbol_index_free(index);
+        exm_pdb_free(pdb);
+        exm_pe_free(pe);
+        return;
+    }
+    exm_pdb_index_add(pdb, pe, index);
+    exm_pdb_free(pdb);
+    exm_pe_free(pe);
+
+    /* only a built index is saved */
+    EXM_TEST_CHECK(!exm_symbol_cache_set(".", key, index));
+    EXM_TEST_CHECK(exm_symbol_index_build(index));
+    EXM_TEST_CHECK(exm_symbol_cache_set(".", key, index));
+    exm_symbol_index_free(index);
+
+    EXM_TEST_CHECK(exm_symbol_cache_get(".", other_key) == NULL);
+
+    cached = exm_symbol_cache_get(".", key);
+    EXM_TEST_CHECK(cached != NULL);
+    if (cached)
+    {
+        for (i = 0; i < sizeof(_exm_test_pdb_frames) / sizeof(_exm_test_pdb_frames[0]); i++)
+        {
+            const Exm_Test_Frame *frame;
+
+            frame = _exm_test_pdb_frames + i;
+            EXM_TEST_CHECK(exm_symbol_index_find(cached, frame->rva, &func, &file, &line));
+            EXM_TEST_CHECK(func && (strcmp(func, frame->function) == 0));
+            EXM_TEST_CHECK(file && (strcmp(file, frame->filename) == 0));
+            EXM_TEST_CHECK(line == frame->line);
+        }
+        EXM_TEST_CHECK(!exm_symbol_index_find(cached, 0x1045, &func, &file, &line));
+        /* nothing can be added to a loaded index */
+        EXM_TEST_CHECK(!exm_symbol_index_line_add(cached, 0x2000, 0, 1));
+        exm_symbol_index_free(cached);
+    }
+
+    /* a file with another key, or a truncated one, is not used */
+    EXM_TEST_CHECK(exm_symbol_index_load("./D7955D1CAF1756CBE6350D9EED0828231.exmsym", other_key) == NULL);
+    f = fopen("./D7955D1CAF1756CBE6350D9EED0828231.exmsym", "r+b");
+    if (f)
+    {
+        char buf[80];
+
+        EXM_TEST_CHECK(fread(buf, 1, sizeof(buf), f) == sizeof(buf));
+        fclose(f);
+        f = fopen("./D7955D1CAF1756CBE6350D9EED0828231.exmsym", "wb");
+        if (f)
+        {
+            fwrite(buf, 1, sizeof(buf), f);
+            fclose(f);
+        }
+        EXM_TEST_CHECK(exm_symbol_cache_get(".", key) == NULL);
+    }
+
+    remove("./D7955D1CAF1756CBE6350D9EED0828231.exmsym");
+}
+
+/*
+ * Functions of the PE fixture examine_test_coff.exe, given by its
+ * COFF symbol table, without file and line.
+ */
+static const Exm_Test_Frame _exm_test_coff_frames[] =
+{
+    /* long names, in the string table */
+    { 0x1000, "coff_square", NULL, 0 },
+    { 0x1005, "coff_square", NULL, 0 },
+    /* short name of 8 bytes, without nul */
+    { 0x1006, "coff_sum", NULL, 0 },
+    { 0x103e, "main", NULL, 0 },
+    { 0x105f, "main", NULL, 0 }
+};
+
+static void
+_exm_test_coff_index(void)
+{
+    Exm_Symbol_Index *index;
+    Exm_Pe *pe;
+    const IMAGE_SYMBOL *symbol;
+    const char *func;
+    const char *file;
+    char short_name[9];
+    unsigned int line;
+    unsigned int nbr;
+    unsigned int i;
+
+    pe = exm_pe_new(EXM_TEST_DATA_DIR "/examine_test_coff.exe");
+    EXM_TEST_CHECK(pe != NULL);
+    if (!pe)
+        return;
+
+    /* the auxiliary records are skipped */
+    nbr = 0;
+    for (symbol = exm_pe_coff_symbol_first_get(pe);
+         symbol;
+         symbol = exm_pe_coff_symbol_next_get(pe, symbol))
+    {
+        if (strcmp(exm_pe_coff_symbol_name_get(pe, symbol, short_name), ".file") == 0)
+            EXM_TEST_CHECK(symbol->NumberOfAuxSymbols == 2);
+        nbr++;
+    }
+    EXM_TEST_CHECK(nbr + 4 == exm_pe_nt_header_get(pe)->FileHeader.NumberOfSymbols);
+
+    index = exm_symbol_index_new();
+    if (!index)
+    {
+        exm_pe_free(pe);
+        return;
+    }
+
+    EXM_TEST_CHECK(exm_coff_index_add(pe, index));
+    EXM_TEST_CHECK(exm_symbol_index_build(index));
+
+    for (i = 0; i < sizeof(_exm_test_coff_frames) / sizeof(_exm_test_coff_frames[0]); i++)
+    {
+        const Exm_Test_Frame *frame;
+
+        frame = _exm_test_coff_frames + i;
+        EXM_TEST_CHECK(exm_symbol_index_find(index, frame->rva, &func, &file, &line));
+        EXM_TEST_CHECK(func && (strcmp(func, frame->function) == 0));
+        EXM_TEST_CHECK(!file && (line == 0));
+    }
+
+    EXM_TEST_CHECK(!exm_symbol_index_find(index, 0xfff, &func, &file, &line));
+
+    exm_symbol_index_free(index);
+    exm_pe_free(pe);
+}
+
+/*
+ * Function table of the PE fixture examine_test_pdata.exe: pdata_leaf
+ * at 0x1000, main at 0x1011, the cold part of pdata_leaf at 0x1029
+ * and pdata_handler, without unwind info, at 0x1031.
+ */
+static void
+_exm_test_pdata_index(void)
+{
+    const IMAGE_RUNTIME_FUNCTION_ENTRY *functions;
+    const IMAGE_RUNTIME_FUNCTION_ENTRY *rf;
+    Exm_Pe_Unwind_Info info;
+    Exm_Pe *pe;
+    DWORD count;
+
+    pe = exm_pe_new(EXM_TEST_DATA_DIR "/examine_test_pdata.exe");
+    EXM_TEST_CHECK(pe != NULL);
+    if (!pe)
+        return;
+
+    functions = exm_pe_runtime_functions_get(pe, &count);
+    EXM_TEST_CHECK(functions && (count == 3));
+
+    rf = exm_pe_runtime_function_find(pe, 0x1005);
+    EXM_TEST_CHECK(rf == functions);
+    EXM_TEST_CHECK(exm_pe_runtime_function_primary_get(pe, rf) == rf);
+    EXM_TEST_CHECK(exm_pe_unwind_info_get(pe, rf, &info));
+    EXM_TEST_CHECK((info.version == 1) && (info.flags == 0));
+    EXM_TEST_CHECK((info.prolog_size == 5) && (info.codes_count == 2));
+    EXM_TEST_CHECK(info.frame_register == 0);
+    EXM_TEST_CHECK(info.codes && (info.codes[0] == 5) && (info.codes[2] == 1));
+
+    rf = exm_pe_runtime_function_find(pe, 0x1020);
+    EXM_TEST_CHECK(rf == functions + 1);
+    EXM_TEST_CHECK(exm_pe_unwind_info_get(pe, rf, &info));
+    EXM_TEST_CHECK(info.flags == EXM_PE_UNW_FLAG_EHANDLER);
+    EXM_TEST_CHECK((info.prolog_size == 8) && (info.codes_count == 3));
+    EXM_TEST_CHECK((info.frame_register == 5) && (info.frame_offset == 0));
+    EXM_TEST_CHECK((info.handler == 0x1031) && !info.chained);
+
+    /* the cold part belongs to pdata_leaf */
+    rf = exm_pe_runtime_function_find(pe, 0x102a);
+    EXM_TEST_CHECK(rf == functions + 2);
+    EXM_TEST_CHECK(exm_pe_unwind_info_get(pe, rf, &info));
+    EXM_TEST_CHECK(info.flags == EXM_PE_UNW_FLAG_CHAININFO);
+    EXM_TEST_CHECK(info.chained && (info.chained->BeginAddress == 0x1000));
+    EXM_TEST_CHECK(exm_pe_runtime_function_primary_get(pe, rf) == functions);
+
+    EXM_TEST_CHECK(exm_pe_runtime_function_find(pe, 0x1010) == functions);
+    EXM_TEST_CHECK(exm_pe_runtime_function_find(pe, 0x1011) == functions + 1);
+    EXM_TEST_CHECK(!exm_pe_runtime_function_find(pe, 0x1032));
+    EXM_TEST_CHECK(!exm_pe_runtime_function_find(pe, 0xfff));
+
+    exm_pe_free(pe);
+
+    /* no exception directory */
+    pe = exm_pe_new(EXM_TEST_DATA_DIR "/examine_test_pdb.exe");
+    EXM_TEST_CHECK(pe != NULL);
+    if (!pe)
+        return;
+
+    EXM_TEST_CHECK(!exm_pe_runtime_functions_get(pe, &count) && (count == 0));
+    EXM_TEST_CHECK(!exm_pe_runtime_function_find(pe, 0x1000));
+
+    exm_pe_free(pe);
+}
+
+/*
+ * Base relocations of the PE fixture examine_test_reloc.exe, all in
+ * .data: 0x2000, 0x2008, 0x2010 (DIR64), 0x2018 (HIGHLOW), 0x3ff8 and
+ * 0x4000 (DIR64).
+ */
+static void
+_exm_test_reloc_stats(void)
+{
+    static const DWORD rvas[] = { 0x2000, 0x2008, 0x2010, 0x2018, 0x3ff8, 0x4000 };
+    Exm_Pe_Relocation_Stats stats;
+    const IMAGE_BASE_RELOCATION *block;
+    DWORD sections[8];
+    Exm_Pe *pe;
+    unsigned int nbr;
+    unsigned int blocks;
+
+    pe = exm_pe_new(EXM_TEST_DATA_DIR "/examine_test_reloc.exe");
+    EXM_TEST_CHECK(pe != NULL);
+    if (!pe)
+        return;
+
+    nbr = 0;
+    blocks = 0;
+    for (block = exm_pe_relocation_block_first_get(pe);
+         block;
+         block = exm_pe_relocation_block_next_get(pe, block))
+    {
+        const WORD *entries;
+        DWORD count;
+        DWORD i;
+
+        blocks++;
+        entries = exm_pe_relocation_block_entries_get(block, &count);
+        for (i = 0; i < count; i++)
+        {
+            if ((entries[i] >> 12) == IMAGE_REL_BASED_ABSOLUTE)
+                continue;
+            EXM_TEST_CHECK(nbr < sizeof(rvas) / sizeof(rvas[0]));
+            if (nbr < sizeof(rvas) / sizeof(rvas[0]))
+                EXM_TEST_CHECK(block->VirtualAddress + (entries[i] & 0xfff) == rvas[nbr]);
+            nbr++;
+        }
+    }
+    EXM_TEST_CHECK((blocks == 3) && (nbr == 6));
+
+    EXM_TEST_CHECK(exm_pe_nt_header_get(pe)->FileHeader.NumberOfSections <= 8);
+    EXM_TEST_CHECK(exm_pe_relocation_stats_get(pe, &stats, sections));
+    EXM_TEST_CHECK((stats.blocks == 3) && (stats.count == 6) && (stats.pages == 3));
+    EXM_TEST_CHECK(stats.types[IMAGE_REL_BASED_DIR64] == 5);
+    EXM_TEST_CHECK(stats.types[IMAGE_REL_BASED_HIGHLOW] == 1);
+    EXM_TEST_CHECK(stats.types[IMAGE_REL_BASED_ABSOLUTE] == 0);
+    EXM_TEST_CHECK((sections[0] == 0) && (sections[1] == 6));
+
+    exm_pe_free(pe);
+
+    /* no base relocation */
+    pe = exm_pe_new(EXM_TEST_DATA_DIR "/examine_test_pdata.exe");
+    EXM_TEST_CHECK(pe != NULL);
+    if (!pe)
+        return;
+
+    EXM_TEST_CHECK(!exm_pe_relocation_block_first_get(pe));
+    EXM_TEST_CHECK(!exm_pe_relocation_stats_get(pe, &stats, NULL) && (stats.count == 0));
+
+    exm_pe_free(pe);
+}
+
+/*
+ * Resources of the PE fixture examine_test_rsrc.exe, in the order of
+ * the resource tree, see examine_test_rsrc.rc.
+ */
+static void
+_exm_test_resource_index(void)
+{
+    const Exm_Pe_Resource *resources;
+    const Exm_Pe_Resource *res;
+    const char *data;
+    Exm_Pe *pe;
+    DWORD count;
+    DWORD size;
+
+    pe = exm_pe_new(EXM_TEST_DATA_DIR "/examine_test_rsrc.exe");
+    EXM_TEST_CHECK(pe != NULL);
+    if (!pe)
+        return;
+
+    resources = exm_pe_resources_get(pe, &count);
+    EXM_TEST_CHECK(resources && (count == 6));
+    if (!resources || (count != 6))
+    {
+        exm_pe_free(pe);
+        return;
+    }
+
+    /* type PNG, name LOGO */
+    EXM_TEST_CHECK(resources[0].type_str && (resources[0].type_str->Length == 3));
+    EXM_TEST_CHECK(resources[0].name_str && (resources[0].name_str->Length == 4));
+    EXM_TEST_CHECK((resources[0].language == 1033) && (resources[0].size == 5));
+    EXM_TEST_CHECK(!resources[1].type_str && (resources[1].type == 6) && (resources[1].id == 1));
+    EXM_TEST_CHECK((resources[3].type == 10) && (resources[3].id == 1) && (resources[3].language == 1033));
+    EXM_TEST_CHECK((resources[4].type == 10) && (resources[4].id == 1) && (resources[4].language == 1036));
+    EXM_TEST_CHECK((resources[5].type == 16) && (resources[5].rva == 0x31b0) && (resources[5].size == 500));
+
+    res = exm_pe_resource_find(pe, 10, 1, EXM_PE_RESOURCE_ANY);
+    EXM_TEST_CHECK(res == resources + 3);
+    res = exm_pe_resource_find(pe, 10, 1, 1036);
+    EXM_TEST_CHECK(res == resources + 4);
+    data = res ? (const char *)exm_pe_resource_entry_data_get(pe, res, &size) : NULL;
+    EXM_TEST_CHECK(data && (size == 7) && (memcmp(data, "french", 7) == 0));
+    EXM_TEST_CHECK(!exm_pe_resource_find(pe, 10, 1, 1031));
+    EXM_TEST_CHECK(!exm_pe_resource_find(pe, 10, 2, EXM_PE_RESOURCE_ANY));
+
+    /* the first resource of the type is named */
+    EXM_TEST_CHECK(exm_pe_resource_find(pe, 10, EXM_PE_RESOURCE_ANY, EXM_PE_RESOURCE_ANY) == resources + 2);
+    EXM_TEST_CHECK(exm_pe_resource_find_by_name(pe, 10, "config", 1033) == resources + 2);
+    EXM_TEST_CHECK(!exm_pe_resource_find_by_name(pe, 10, "conf", EXM_PE_RESOURCE_ANY));
+    EXM_TEST_CHECK(!exm_pe_resource_find_by_name(pe, 6, "config", EXM_PE_RESOURCE_ANY));
+
+    data = (const char *)exm_pe_resource_data_get(pe, 16, &size);
+    EXM_TEST_CHECK(data && (size == 500));
+    EXM_TEST_CHECK(!exm_pe_resource_data_get(pe, 3, &size));
+
+    exm_pe_free(pe);
+}
+
+/*
+ * Version information of the PE fixture examine_test_rsrc.exe, see
+ * examine_test_rsrc.rc.
+ */
+static void
+_exm_test_version_info(void)
+{
+    static const char *keys[] = { "CompanyName", "FileDescription", "FileVersion", "ProductName", "ProductVersion" };
+    Exm_Pe_Version_Info info;
+    Exm_Pe_Version_String str;
+    Exm_Pe *pe;
+    char buf[64];
+    DWORD offset;
+    unsigned int nbr;
+
+    pe = exm_pe_new(EXM_TEST_DATA_DIR "/examine_test_rsrc.exe");
+    EXM_TEST_CHECK(pe != NULL);
+    if (!pe)
+        return;
+
+    EXM_TEST_CHECK(exm_pe_version_info_get(pe, &info));
+    EXM_TEST_CHECK(info.fixed != NULL);
+    if (info.fixed)
+    {
+        EXM_TEST_CHECK((info.fixed->dwFileVersionMS == 0x00010002) && (info.fixed->dwFileVersionLS == 0x00030004));
+        EXM_TEST_CHECK((info.fixed->dwProductVersionMS == 0x00050006) && (info.fixed->dwProductVersionLS == 0x00070008));
+        EXM_TEST_CHECK((info.fixed->dwFileOS == 0x40004) && (info.fixed->dwFileType == 1));
+    }
+    EXM_TEST_CHECK((info.translations_count == 1) && (info.translations[0] == 0x04b00409));
+    EXM_TEST_CHECK(info.language && (exm_pe_string_utf8_get(info.language, info.language_length, buf, sizeof(buf)) == 8));
+    EXM_TEST_CHECK(strcmp(buf, "040904b0") == 0);
+
+    nbr = 0;
+    offset = 0;
+    while (exm_pe_version_info_string_next(&info, &offset, &str))
+    {
+        if (nbr < sizeof(keys) / sizeof(keys[0]))
+        {
+            exm_pe_string_utf8_get(str.key, str.key_length, buf, sizeof(buf));
+            EXM_TEST_CHECK(strcmp(buf, keys[nbr]) == 0);
+        }
+        nbr++;
+    }
+    EXM_TEST_CHECK(nbr == 5);
+
+    EXM_TEST_CHECK(exm_pe_version_info_string_get(&info, "FileDescription", &str));
+    exm_pe_string_utf8_get(str.value, str.value_length, buf, sizeof(buf));
+    EXM_TEST_CHECK(strcmp(buf, "Examine test fixture") == 0);
+    EXM_TEST_CHECK(!exm_pe_version_info_string_get(&info, "File", &str));
+
+    /* truncated on a character boundary */
+    EXM_TEST_CHECK(exm_pe_version_info_string_get(&info, "CompanyName", &str));
+    EXM_TEST_CHECK(exm_pe_string_utf8_get(str.value, str.value_length, buf, 4) == 3);
+    EXM_TEST_CHECK(strcmp(buf, "Exa") == 0);
+
+    exm_pe_free(pe);
+
+    pe = exm_pe_new(EXM_TEST_DATA_DIR "/examine_test_pdata.exe");
+    EXM_TEST_CHECK(pe != NULL);
+    if (!pe)
+        return;
+
+    EXM_TEST_CHECK(!exm_pe_version_info_get(pe, &info));
+    EXM_TEST_CHECK(!exm_pe_version_info_string_get(&info, "FileVersion", &str));
+
+    exm_pe_free(pe);
+}
+
+static void
+_exm_test_sha_vectors(void)
+{
+    static const unsigned char abc1[EXM_SHA1_SIZE] =
+    {
+        0xa9, 0x99, 0x3e, 0x36, 0x47, 0x06, 0x81, 0x6a, 0xba, 0x3e,
+        0x25, 0x71, 0x78, 0x50, 0xc2, 0x6c, 0x9c, 0xd0, 0xd8, 0x9d
+    };
+    static const unsigned char abc256[EXM_SHA256_SIZE] =
+    {
+        0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+        0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad
+    };
+    static const unsigned char empty1[EXM_SHA1_SIZE] =
+    {
+        0xda, 0x39, 0xa3, 0xee, 0x5e, 0x6b, 0x4b, 0x0d, 0x32, 0x55,
+        0xbf, 0xef, 0x95, 0x60, 0x18, 0x90, 0xaf, 0xd8, 0x07, 0x09
+    };
+    static const unsigned char million1[EXM_SHA1_SIZE] =
+    {
+        0x34, 0xaa, 0x97, 0x3c, 0xd4, 0xc4, 0xda, 0xa4, 0xf6, 0x1e,
+        0xeb, 0x2b, 0xdb, 0xad, 0x27, 0x31, 0x65, 0x34, 0x01, 0x6f
+    };
+    static const unsigned char million256[EXM_SHA256_SIZE] =
+    {
+        0xcd, 0xc7, 0x6e, 0x5c, 0x99, 0x14, 0xfb, 0x92, 0x81, 0xa1, 0xc7, 0xe2, 0x84, 0xd7, 0x3e, 0x67,
+        0xf1, 0x80, 0x9a, 0x48, 0xa4, 0x97, 0x20, 0x0e, 0x04, 0x6d, 0x39, 0xcc, 0xc7, 0x11, 0x2c, 0xd0
+    };
+    unsigned char a[1000];
+    int hw;
+
+    memset(a, 'a', sizeof(a));
+
+    /* the C implementation, then the SHA extensions if supported */
+    for (hw = 0; hw < 2; hw++)
+    {
+        Exm_Sha1 sha1;
+        Exm_Sha256 sha256;
+        unsigned char digest[EXM_SHA256_SIZE];
+        size_t size;
+        int i;
+
+        exm_sha_hw_set((unsigned char)hw);
+
+        exm_sha1_init(&sha1);
+        exm_sha1_final(&sha1, digest);
+        EXM_TEST_CHECK(memcmp(digest, empty1, sizeof(empty1)) == 0);
+
+        exm_sha1_init(&sha1);
+        exm_sha1_update(&sha1, "abc", 3);
+        exm_sha1_final(&sha1, digest);
+        EXM_TEST_CHECK(memcmp(digest, abc1, sizeof(abc1)) == 0);
+
+        exm_sha256_init(&sha256);
+        exm_sha256_update(&sha256, "a", 1);
+        exm_sha256_update(&sha256, "bc", 2);
+        exm_sha256_final(&sha256, digest);
+        EXM_TEST_CHECK(memcmp(digest, abc256, sizeof(abc256)) == 0);
+
+        /* one million 'a', in chunks crossing the blocks */
+        exm_sha1_init(&sha1);
+        exm_sha256_init(&sha256);
+        for (i = 0, size = 1; i < 1000000; i += (int)size, size = (size * 7) % 997 + 1)
+        {
+            if (size > (size_t)(1000000 - i))
+                size = 1000000 - i;
+            exm_sha1_update(&sha1, a, size);
+            exm_sha256_update(&sha256, a, size);
+        }
+        exm_sha1_final(&sha1, digest);
+        EXM_TEST_CHECK(memcmp(digest, million1, sizeof(million1)) == 0);
+        exm_sha256_final(&sha256, digest);
+        EXM_TEST_CHECK(memcmp(digest, million256, sizeof(million256)) == 0);
+    }
+
+    exm_sha_hw_set(1);
+}
+
+static void
+_exm_test_authenticode_digest(void)
+{
+    /* computed with hashlib over the same ranges of the file */
+    static const unsigned char expected1[EXM_SHA1_SIZE] =
+    {
+        0x39, 0xeb, 0xa3, 0x9a, 0x7f, 0xb7, 0xd5, 0x4f, 0xf7, 0x2e,
+        0x8d, 0x3d, 0x8c, 0x99, 0x50, 0x0b, 0x06, 0x03, 0x3c, 0x61
+    };
+    static const unsigned char expected256[EXM_SHA256_SIZE] =
+    {
+        0x75, 0xcb, 0x23, 0xe1, 0x72, 0x83, 0x98, 0x84, 0x5b, 0x28, 0xca, 0x30, 0xc0, 0x0f, 0xe2, 0x65,
+        0xc7, 0x76, 0x4b, 0xa4, 0x1e, 0x09, 0xb6, 0x3d, 0x34, 0x37, 0xfe, 0xf1, 0x53, 0x92, 0x8a, 0x06
+    };
+    unsigned char sha1[EXM_SHA1_SIZE];
+    unsigned char sha256[EXM_SHA256_SIZE];
+    Exm_Pe *pe;
+
+    pe = exm_pe_new(EXM_TEST_DATA_DIR "/examine_test_rsrc.exe");
+    EXM_TEST_CHECK(pe != NULL);
+    if (!pe)
+        return;
+
+    EXM_TEST_CHECK(exm_pe_authenticode_digest_get(pe, sha1, sha256));
+    EXM_TEST_CHECK(memcmp(sha1, expected1, sizeof(sha1)) == 0);
+    EXM_TEST_CHECK(memcmp(sha256, expected256, sizeof(sha256)) == 0);
+
+    /* same digests with one of them only and with the C implementation */
+    exm_sha_hw_set(0);
+    memset(sha256, 0, sizeof(sha256));
+    EXM_TEST_CHECK(exm_pe_authenticode_digest_get(pe, NULL, sha256));
+    EXM_TEST_CHECK(memcmp(sha256, expected256, sizeof(sha256)) == 0);
+    exm_sha_hw_set(1);
+
+    EXM_TEST_CHECK(!exm_pe_authenticode_digest_get(NULL, sha1, sha256));
+
+    exm_pe_free(pe);
+}
+
+static void
+_exm_test_pe_checksum(void)
+{
+    static const char *files[] =
+    {
+        EXM_TEST_DATA_DIR "/examine_test_coff.exe",
+        EXM_TEST_DATA_DIR "/examine_test_dwarf5.exe",
+        EXM_TEST_DATA_DIR "/examine_test_pdata.exe",
+        EXM_TEST_DATA_DIR "/examine_test_reloc.exe",
+        EXM_TEST_DATA_DIR "/examine_test_rsrc.exe"
+    };
+    unsigned char buf[300];
+    unsigned int state;
+    size_t size;
+    size_t i;
+
+    /* the wide accumulators against a plain sum, for all the tails */
+    state = 1;
+    for (i = 0; i < sizeof(buf); i++)
+    {
+        state = state * 1103515245 + 12345;
+        buf[i] = (unsigned char)(state >> 16);
+    }
+    for (size = 0; size <= sizeof(buf); size++)
+    {
+        unsigned long long expected = 0;
+        unsigned long long simd;
+
+        for (i = 0; i < size; i++)
+            expected += (unsigned long long)buf[i] << (8 * (i & 3));
+
+        exm_checksum_simd_set(0);
+        EXM_TEST_CHECK(exm_checksum_sum(buf, size) == expected);
+        exm_checksum_simd_set(1);
+        simd = exm_checksum_sum(buf, size);
+        EXM_TEST_CHECK(simd == expected);
+    }
+
+    /* the linker sets the checksum of the fixtures */
+    for (i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+    {
+        Exm_Pe *pe;
+
+        pe = exm_pe_new(files[i]);
+        EXM_TEST_CHECK(pe != NULL);
+        if (!pe)
+            continue;
+
+        EXM_TEST_CHECK(exm_pe_nt_header_get(pe)->OptionalHeader.CheckSum != 0);
+        EXM_TEST_CHECK(exm_pe_checksum_compute(pe) == exm_pe_nt_header_get(pe)->OptionalHeader.CheckSum);
+        exm_checksum_simd_set(0);
+        EXM_TEST_CHECK(exm_pe_checksum_compute(pe) == exm_pe_nt_header_get(pe)->OptionalHeader.CheckSum);
+        exm_checksum_simd_set(1);
+
+        exm_pe_free(pe);
+    }
+
+    EXM_TEST_CHECK(exm_pe_checksum_compute(NULL) == 0);
+}
+
+static void
+_exm_test_entropy(void)
+{
+    /* computed with Python over the raw data of the sections */
+    static const double expected[] = { 0.322358, 0.0, 2.162420 };
+    Exm_Pe_Histogram histogram;
+    const IMAGE_SECTION_HEADER *iter;
+    const void *data;
+    unsigned char buf[1000];
+    Exm_Pe *pe;
+    DWORD size;
+    size_t i;
+
+    /* all the tails of the sub-histograms */
+    for (i = 0; i < sizeof(buf); i++)
+        buf[i] = (unsigned char)(i * 7);
+    for (size = 0; size < 40; size++)
+    {
+        unsigned long long counts[256];
+        unsigned long long total;
+
+        memset(counts, 0, sizeof(counts));
+        exm_histogram_add(counts, buf, size);
+        for (i = 0, total = 0; i < 256; i++)
+            total += counts[i];
+        EXM_TEST_CHECK(total == size);
+        EXM_TEST_CHECK((size == 0) || (counts[(unsigned char)((size - 1) * 7)] == 1));
+    }
+
+    memset(&histogram, 0, sizeof(histogram));
+    EXM_TEST_CHECK(exm_pe_histogram_entropy_get(&histogram) == 0.0);
+    exm_pe_histogram_add(buf, 512, &histogram);
+    exm_pe_histogram_add(buf + 512, 256, &histogram);
+    EXM_TEST_CHECK((histogram.size == 768) && (histogram.counts[0] == 3));
+    EXM_TEST_CHECK(fabs(exm_pe_histogram_entropy_get(&histogram) - 8.0) < 1e-9);
+
+    memset(buf, 'a', sizeof(buf));
+    memset(buf, 'b', sizeof(buf) / 2);
+    memset(&histogram, 0, sizeof(histogram));
+    exm_pe_histogram_add(buf, sizeof(buf), &histogram);
+    EXM_TEST_CHECK(fabs(exm_pe_histogram_entropy_get(&histogram) - 1.0) < 1e-9);
+
+    pe = exm_pe_new(EXM_TEST_DATA_DIR "/examine_test_rsrc.exe");
+    EXM_TEST_CHECK(pe != NULL);
+    if (!pe)
+        return;
+
+    EXM_TEST_CHECK(exm_pe_nt_header_get(pe)->FileHeader.NumberOfSections == 3);
+    iter = IMAGE_FIRST_SECTION(exm_pe_nt_header_get(pe));
+    for (i = 0; i < 3; i++, iter++)
+    {
+        data = exm_pe_section_raw_data_get(pe, iter, &size);
+        EXM_TEST_CHECK((data != NULL) && (size == iter->SizeOfRawData));
+        memset(&histogram, 0, sizeof(histogram));
+        exm_pe_histogram_add(data, size, &histogram);
+        EXM_TEST_CHECK(fabs(exm_pe_histogram_entropy_get(&histogram) - expected[i]) < 1e-5);
+    }
+
+    /* the COFF symbol table written by ld */
+    data = exm_pe_overlay_get(pe, &size);
+    EXM_TEST_CHECK((data != NULL) && (size == 1915));
+    memset(&histogram, 0, sizeof(histogram));
+    exm_pe_histogram_add(data, size, &histogram);
+    EXM_TEST_CHECK(fabs(exm_pe_histogram_entropy_get(&histogram) - 3.964216) < 1e-5);
+
+    exm_pe_free(pe);
+}
+
+static void
+_exm_test_tracker_count(const Exm_Tracker_Block *block, void *data)
+{
+    size_t *counts = data;
+
+    counts[block->frees ? 1 : 0]++;
+    counts[2] += block->size;
+}
+
+static void
+_exm_test_tracker_leaks_size(const Exm_Tracker_Block *block, void *data)
+{
+    size_t *size = data;
+
+    if (block->frees == 0)
+        *size += block->size;
+}
+
+#define EXM_TEST_TRACKER_ADDRESS(i) ((const void *)(uintptr_t)(0x10000 + (size_t)(i) * 16))
+
+static void
+_exm_test_tracker(void)
+{
+    Exm_Tracker *tracker;
+    Exm_Tracker_Block block;
+    Exm_Tracker_Block old;
+    size_t counts[3];
+    size_t i;
+
+    tracker = exm_tracker_new();
+    EXM_TEST_CHECK(tracker != NULL);
+    if (!tracker)
+        return;
+
+    EXM_TEST_CHECK(exm_tracker_count(tracker) == 0);
+    memset(&block, 0, sizeof(block));
+    EXM_TEST_CHECK(!exm_tracker_block_add(tracker, &block, &old));
+    EXM_TEST_CHECK(!exm_tracker_block_release(tracker, NULL, 1, &block));
+
+    /* close addresses, enough to grow the tables of all the stripes */
+    for (i = 0; i < 20000; i++)
+    {
+        block.address = EXM_TEST_TRACKER_ADDRESS(i);
+        block.size = i;
+        block.stack = (unsigned int)i + 1;
+        block.fct = (unsigned char)(i % 7);
+        block.flags = (i % 5) ? 0 : EXM_TRACKER_BLOCK_GDI;
+        EXM_TEST_CHECK(exm_tracker_block_add(tracker, &block, &old));
+        EXM_TEST_CHECK(old.address == NULL);
+    }
+    EXM_TEST_CHECK(exm_tracker_count(tracker) == 20000);
+    EXM_TEST_CHECK(exm_tracker_memory_get(tracker) >= 20000 * sizeof(Exm_Tracker_Block));
+
+    for (i = 0; i < 20000; i++)
+    {
+        EXM_TEST_CHECK(exm_tracker_block_get(tracker, EXM_TEST_TRACKER_ADDRESS(i), &block));
+        EXM_TEST_CHECK((block.size == i) && (block.stack == i + 1) && (block.frees == 0));
+        EXM_TEST_CHECK(block.fct == i % 7);
+        EXM_TEST_CHECK(block.flags == ((i % 5) ? 0 : EXM_TRACKER_BLOCK_GDI));
+    }
+    EXM_TEST_CHECK(!exm_tracker_block_get(tracker, EXM_TEST_TRACKER_ADDRESS(20000), &block));
+
+    /* the freed blocks are kept, the stack of the first free too */
+    for (i = 1; i < 20000; i += 2)
+    {
+        EXM_TEST_CHECK(exm_tracker_block_release(tracker, EXM_TEST_TRACKER_ADDRESS(i), 7, &block));
+        EXM_TEST_CHECK((block.frees == 1) && (block.stack_first_free == 7));
+    }
+    EXM_TEST_CHECK(exm_tracker_block_release(tracker, EXM_TEST_TRACKER_ADDRESS(1), 8, &block));
+    EXM_TEST_CHECK((block.frees == 2) && (block.stack_first_free == 7) && (block.stack == 2));
+    EXM_TEST_CHECK(!exm_tracker_block_release(tracker, EXM_TEST_TRACKER_ADDRESS(20000), 8, &block));
+    EXM_TEST_CHECK(exm_tracker_count(tracker) == 20000);
+
+    memset(counts, 0, sizeof(counts));
+    exm_tracker_foreach(tracker, _exm_test_tracker_count, counts);
+    EXM_TEST_CHECK((counts[0] == 10000) && (counts[1] == 10000));
+    EXM_TEST_CHECK(counts[2] == 20000 * 19999 / 2);
+
+    /* an address returned again replaces the freed record */
+    block.address = EXM_TEST_TRACKER_ADDRESS(3);
+    block.size = 100;
+    block.stack = 9;
+    block.stack_first_free = 0;
+    block.frees = 0;
+    EXM_TEST_CHECK(exm_tracker_block_add(tracker, &block, &old));
+    EXM_TEST_CHECK(old.address == NULL);
+    EXM_TEST_CHECK(exm_tracker_block_get(tracker, EXM_TEST_TRACKER_ADDRESS(3), &old));
+    EXM_TEST_CHECK((old.frees == 0) && (old.size == 100));
+    EXM_TEST_CHECK(exm_tracker_duplicates_get(tracker) == 0);
+    EXM_TEST_CHECK(exm_tracker_count(tracker) == 20000);
+
+    /* twice without free, in the cache of the thread then in the stripes */
+    EXM_TEST_CHECK(exm_tracker_block_add(tracker, &block, &old));
+    EXM_TEST_CHECK(exm_tracker_block_add(tracker, &block, &old));
+    EXM_TEST_CHECK((old.address == block.address) && (old.frees == 0) && (old.stack == 9));
+    EXM_TEST_CHECK(exm_tracker_duplicates_get(tracker) == 2);
+    EXM_TEST_CHECK(exm_tracker_count(tracker) == 20000);
+
+    /* reallocation, in place and moved */
+    EXM_TEST_CHECK(exm_tracker_block_move(tracker, EXM_TEST_TRACKER_ADDRESS(2), EXM_TEST_TRACKER_ADDRESS(2), 50, &old));
+    EXM_TEST_CHECK(old.size == 2);
+    EXM_TEST_CHECK(exm_tracker_block_get(tracker, EXM_TEST_TRACKER_ADDRESS(2), &block));
+    EXM_TEST_CHECK((block.size == 50) && (block.stack == 3));
+    EXM_TEST_CHECK(exm_tracker_block_move(tracker, EXM_TEST_TRACKER_ADDRESS(2), EXM_TEST_TRACKER_ADDRESS(30000), 60, &old));
+    EXM_TEST_CHECK((old.size == 50) && (old.address == EXM_TEST_TRACKER_ADDRESS(2)));
+    EXM_TEST_CHECK(!exm_tracker_block_get(tracker, EXM_TEST_TRACKER_ADDRESS(2), &block));
+    EXM_TEST_CHECK(exm_tracker_block_get(tracker, EXM_TEST_TRACKER_ADDRESS(30000), &block));
+    EXM_TEST_CHECK((block.size == 60) && (block.stack == 3) && (block.fct == 2));
+    EXM_TEST_CHECK(!exm_tracker_block_move(tracker, EXM_TEST_TRACKER_ADDRESS(2), EXM_TEST_TRACKER_ADDRESS(4), 1, &old));
+    EXM_TEST_CHECK(exm_tracker_count(tracker) == 20000);
+
+    /* removal keeps the other records reachable */
+    for (i = 4; i < 20000; i += 3)
+        EXM_TEST_CHECK(exm_tracker_block_del(tracker, EXM_TEST_TRACKER_ADDRESS(i)));
+    EXM_TEST_CHECK(!exm_tracker_block_del(tracker, EXM_TEST_TRACKER_ADDRESS(4)));
+    for (i = 0; i < 20000; i++)
+    {
+        unsigned char expected;
+
+        expected = (i == 2) ? 0 : ((i < 4) || ((i - 4) % 3 != 0));
+        EXM_TEST_CHECK(exm_tracker_block_get(tracker, EXM_TEST_TRACKER_ADDRESS(i), &block) == expected);
+    }
+    EXM_TEST_CHECK(exm_tracker_count(tracker) == 20000 - 6666);
+
+    exm_tracker_free(tracker);
+}
+
+#define EXM_TEST_TRACKER_THREADS 8
+#define EXM_TEST_TRACKER_BLOCKS 20000
+#define EXM_TEST_TRACKER_STACKS 100
+
+/* address j of the thread i, each thread has its own range */
+#define EXM_TEST_TRACKER_THREAD_ADDRESS(i, j) EXM_TEST_TRACKER_ADDRESS((size_t)(i) * 2 * EXM_TEST_TRACKER_BLOCKS + (j))
+
+typedef struct _Exm_Test_Tracker_Thread Exm_Test_Tracker_Thread;
+
+struct _Exm_Test_Tracker_Thread
+{
+    void (*run)(Exm_Test_Tracker_Thread *thread);
+    Exm_Tracker *tracker;
+    Exm_Stack_Depot *depot;
+    unsigned int id;
+    unsigned int errors;
+    unsigned int stacks[EXM_TEST_TRACKER_STACKS];
+};
+
+/*
+ * For each block j of the thread, depending on j % 4:
+ * 0: allocated, freed, allocated again, then freed by another thread
+ * 1: allocated, never freed
+ * 2: allocated, freed
+ * 3: allocated, reallocated, then freed by another thread
+ */
+static void
+_exm_test_tracker_thread_alloc(Exm_Test_Tracker_Thread *thread)
+{
+    Exm_Tracker_Block block;
+    Exm_Stack_Pc pcs[4];
+    unsigned int i;
+    unsigned int j;
+
+    memset(&block, 0, sizeof(block));
+    block.stack = thread->id + 1;
+    for (i = 0; i < EXM_TEST_TRACKER_BLOCKS; i++)
+    {
+        block.address = EXM_TEST_TRACKER_THREAD_ADDRESS(thread->id, i);
+        block.size = i;
+        if (!exm_tracker_block_add(thread->tracker, &block, NULL))
+            thread->errors++;
+
+        /* the same stacks in all the threads */
+        for (j = 0; j < 4; j++)
+        {
+            pcs[j].module = j;
+            pcs[j].offset = i % EXM_TEST_TRACKER_STACKS;
+        }
+        j = exm_stack_depot_put(thread->depot, pcs, 4);
+        if ((j == 0) ||
+            (thread->stacks[i % EXM_TEST_TRACKER_STACKS] && (thread->stacks[i % EXM_TEST_TRACKER_STACKS] != j)))
+            thread->errors++;
+        thread->stacks[i % EXM_TEST_TRACKER_STACKS] = j;
+    }
+
+    for (i = 0; i < EXM_TEST_TRACKER_BLOCKS; i += 2)
+    {
+        if (!exm_tracker_block_release(thread->tracker, EXM_TEST_TRACKER_THREAD_ADDRESS(thread->id, i), 1, &block) ||
+            (block.frees != 1) || (block.size != i))
+            thread->errors++;
+    }
+
+    for (i = 0; i < EXM_TEST_TRACKER_BLOCKS; i += 4)
+    {
+        block.address = EXM_TEST_TRACKER_THREAD_ADDRESS(thread->id, i);
+        block.size = i;
+        block.frees = 0;
+        if (!exm_tracker_block_add(thread->tracker, &block, NULL))
+            thread->errors++;
+    }
+
+    for (i = 3; i < EXM_TEST_TRACKER_BLOCKS; i += 4)
+    {
+        if (!exm_tracker_block_move(thread->tracker,
+                                    EXM_TEST_TRACKER_THREAD_ADDRESS(thread->id, i),
+                                    EXM_TEST_TRACKER_THREAD_ADDRESS(thread->id, EXM_TEST_TRACKER_BLOCKS + i),
+                                    2 * i, &block) ||
+            (block.size != i))
+            thread->errors++;
+    }
+
+    /* the tracking code of the thread is entered once */
+    if (!exm_tracker_guard_enter() || exm_tracker_guard_enter())
+        thread->errors++;
+    exm_tracker_guard_leave();
+
+    /* some threads release their cache, the others leave it full */
+    if (thread->id & 1)
+        exm_tracker_thread_flush(thread->tracker);
+}
+
+static void
+_exm_test_tracker_thread_free(Exm_Test_Tracker_Thread *thread)
+{
+    Exm_Tracker_Block block;
+    unsigned int owner;
+    unsigned int i;
+
+    /* the blocks of the previous thread, maybe still in its cache */
+    owner = (thread->id + EXM_TEST_TRACKER_THREADS - 1) % EXM_TEST_TRACKER_THREADS;
+    for (i = 0; i < EXM_TEST_TRACKER_BLOCKS; i += 4)
+    {
+        if (!exm_tracker_block_release(thread->tracker, EXM_TEST_TRACKER_THREAD_ADDRESS(owner, i), 2, &block) ||
+            (block.frees != 1) || (block.size != i) || (block.stack != owner + 1))
+            thread->errors++;
+        if (!exm_tracker_block_release(thread->tracker, EXM_TEST_TRACKER_THREAD_ADDRESS(owner, EXM_TEST_TRACKER_BLOCKS + i + 3), 2, &block) ||
+            (block.frees != 1) || (block.size != 2 * (i + 3)))
+            thread->errors++;
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI
+_exm_test_tracker_thread_run(LPVOID data)
+{
+    Exm_Test_Tracker_Thread *thread = data;
+
+    thread->run(thread);
+    return 0;
+}
+#else
+static void *
+_exm_test_tracker_thread_run(void *data)
+{
+    Exm_Test_Tracker_Thread *thread = data;
+
+    thread->run(thread);
+    return NULL;
+}
+#endif
+
+static void
+_exm_test_tracker_threads_run(Exm_Test_Tracker_Thread *threads)
+{
+#ifdef _WIN32
+    HANDLE handles[EXM_TEST_TRACKER_THREADS];
+#else
+    pthread_t handles[EXM_TEST_TRACKER_THREADS];
+#endif
+    unsigned int i;
+
+    for (i = 0; i < EXM_TEST_TRACKER_THREADS; i++)
+    {
+#ifdef _WIN32
+        handles[i] = CreateThread(NULL, 0, _exm_test_tracker_thread_run, threads + i, 0, NULL);
+        EXM_TEST_CHECK(handles[i] != NULL);
+#else
+        EXM_TEST_CHECK(pthread_create(handles + i, NULL, _exm_test_tracker_thread_run, threads + i) == 0);
+#endif
+    }
+
+    for (i = 0; i < EXM_TEST_TRACKER_THREADS; i++)
+    {
+#ifdef _WIN32
+        WaitForSingleObject(handles[i], INFINITE);
+        CloseHandle(handles[i]);
+#else
+        pthread_join(handles[i], NULL);
+#endif
+    }
+}
+
+static void
+_exm_test_tracker_threads(void)
+{
+    Exm_Test_Tracker_Thread threads[EXM_TEST_TRACKER_THREADS];
+    Exm_Tracker *tracker;
+    Exm_Stack_Depot *depot;
+    size_t counts[3];
+    size_t size;
+    unsigned int i;
+
+    tracker = exm_tracker_new();
+    depot = exm_stack_depot_new();
+    EXM_TEST_CHECK((tracker != NULL) && (depot != NULL));
+    if (!tracker || !depot)
+    {
+        exm_tracker_free(tracker);
+        exm_stack_depot_free(depot);
+        return;
+    }
+
+    memset(threads, 0, sizeof(threads));
+    for (i = 0; i < EXM_TEST_TRACKER_THREADS; i++)
+    {
+        threads[i].run = _exm_test_tracker_thread_alloc;
+        threads[i].tracker = tracker;
+        threads[i].depot = depot;
+        threads[i].id = i;
+    }
+    _exm_test_tracker_threads_run(threads);
+
+    for (i = 0; i < EXM_TEST_TRACKER_THREADS; i++)
+        threads[i].run = _exm_test_tracker_thread_free;
+    _exm_test_tracker_threads_run(threads);
+
+    for (i = 0; i < EXM_TEST_TRACKER_THREADS; i++)
+    {
+        EXM_TEST_CHECK(threads[i].errors == 0);
+        EXM_TEST_CHECK(memcmp(threads[i].stacks, threads[0].stacks, sizeof(threads[0].stacks)) == 0);
+    }
+    EXM_TEST_CHECK(exm_stack_depot_count(depot) == EXM_TEST_TRACKER_STACKS);
+
+    /* the blocks j % 4 == 1 are leaked, the others are freed */
+    EXM_TEST_CHECK(exm_tracker_count(tracker) == EXM_TEST_TRACKER_THREADS * EXM_TEST_TRACKER_BLOCKS);
+    EXM_TEST_CHECK(exm_tracker_duplicates_get(tracker) == 0);
+    memset(counts, 0, sizeof(counts));
+    exm_tracker_foreach(tracker, _exm_test_tracker_count, counts);
+    EXM_TEST_CHECK(counts[0] == EXM_TEST_TRACKER_THREADS * EXM_TEST_TRACKER_BLOCKS / 4);
+    for (i = 1, size = 0; i < EXM_TEST_TRACKER_BLOCKS; i += 4)
+        size += i;
+    memset(counts, 0, sizeof(counts));
+    exm_tracker_foreach(tracker, _exm_test_tracker_leaks_size, counts);
+    EXM_TEST_CHECK(counts[0] == EXM_TEST_TRACKER_THREADS * size);
+
+    exm_stack_depot_free(depot);
+    exm_tracker_free(tracker);
+}
+
+/* address of a block freed by the main thread, allocated again by the thread */
+static void
+_exm_test_tracker_thread_reuse(Exm_Test_Tracker_Thread *thread)
+{
+    Exm_Tracker_Block block;
+    Exm_Tracker_Block old;
+
+    memset(&block, 0, sizeof(block));
+    block.address = EXM_TEST_TRACKER_ADDRESS(thread->id);
+    block.size = 100 + thread->id;
+    block.stack = thread->id + 1;
+    if (!exm_tracker_block_add(thread->tracker, &block, &old) || old.address)
+        thread->errors++;
+
+    /* the other threads keep the record in their cache */
+    if (thread->id & 1)
+        exm_tracker_thread_flush(thread->tracker);
+}
+
+static void
+_exm_test_tracker_reused(void)
+{
+    Exm_Test_Tracker_Thread threads[EXM_TEST_TRACKER_THREADS];
+    Exm_Tracker *tracker;
+    Exm_Tracker_Block block;
+    unsigned int i;
+
+    tracker = exm_tracker_new();
+    EXM_TEST_CHECK(tracker != NULL);
+    if (!tracker)
+        return;
+
+    /* the freed records stay in the cache of this thread */
+    memset(&block, 0, sizeof(block));
+    for (i = 0; i < EXM_TEST_TRACKER_THREADS; i++)
+    {
+        block.address = EXM_TEST_TRACKER_ADDRESS(i);
+        block.size = i;
+        EXM_TEST_CHECK(exm_tracker_block_add(tracker, &block, NULL));
+        EXM_TEST_CHECK(exm_tracker_block_release(tracker, block.address, 7, NULL));
+    }
+
+    memset(threads, 0, sizeof(threads));
+    for (i = 0; i < EXM_TEST_TRACKER_THREADS; i++)
+    {
+        threads[i].run = _exm_test_tracker_thread_reuse;
+        threads[i].tracker = tracker;
+        threads[i].id = i;
+    }
+    _exm_test_tracker_threads_run(threads);
+
+    /* the records of the other threads are live, whatever the flush order */
+    for (i = 0; i < EXM_TEST_TRACKER_THREADS; i++)
+    {
+        EXM_TEST_CHECK(threads[i].errors == 0);
+        EXM_TEST_CHECK(exm_tracker_block_get(tracker, EXM_TEST_TRACKER_ADDRESS(i), &block));
+        EXM_TEST_CHECK((block.frees == 0) && (block.size == 100 + i));
+    }
+    EXM_TEST_CHECK(exm_tracker_count(tracker) == EXM_TEST_TRACKER_THREADS);
+    EXM_TEST_CHECK(exm_tracker_duplicates_get(tracker) == 0);
+
+    /* so their free by this thread is not a second one */
+    for (i = 0; i < EXM_TEST_TRACKER_THREADS; i++)
+    {
+        EXM_TEST_CHECK(exm_tracker_block_release(tracker, EXM_TEST_TRACKER_ADDRESS(i), 8, &block));
+        EXM_TEST_CHECK((block.frees == 1) && (block.stack_first_free == 8) && (block.stack == i + 1));
+    }
+    EXM_TEST_CHECK(exm_tracker_block_release(tracker, EXM_TEST_TRACKER_ADDRESS(0), 9, &block));
+    EXM_TEST_CHECK((block.frees == 2) && (block.stack_first_free == 8));
+
+    exm_tracker_free(tracker);
+}
+
+static void
+_exm_test_redzone(void)
+{
+    Exm_Tracker_Block block;
+    unsigned char *base;
+    unsigned char *data;
+    unsigned int front;
+    long long offset = 0;
+
+    /* the redzones keep the alignment, the one after covers the padding */
+    EXM_TEST_CHECK(exm_tracker_redzone_size_get(10, 16, 0, &front) == 48);
+    EXM_TEST_CHECK(front == 16);
+    EXM_TEST_CHECK(exm_tracker_redzone_size_get(10, 20, 0, &front) == 80);
+    EXM_TEST_CHECK(front == 32);
+    EXM_TEST_CHECK(exm_tracker_redzone_size_get(100, 16, 64, &front) == 240);
+    EXM_TEST_CHECK(front == 64);
+    EXM_TEST_CHECK(exm_tracker_redzone_size_get(0, 0, 0, &front) == 32);
+    EXM_TEST_CHECK(front == 16);
+    EXM_TEST_CHECK(exm_tracker_redzone_size_get((size_t)-8, 16, 0, &front) == 0);
+
+    base = (unsigned char *)malloc(512);
+    EXM_TEST_CHECK(base != NULL);
+    if (!base)
+        return;
+
+    memset(base, 0, 512);
+    exm_tracker_redzone_size_get(10, 16, 0, &front);
+    data = (unsigned char *)exm_tracker_redzone_set(base, 10, front);
+    EXM_TEST_CHECK(data == base + 16);
+    EXM_TEST_CHECK((data[0] == 0) && (data[9] == 0));
+    EXM_TEST_CHECK((base[15] == EXM_TRACKER_REDZONE_BYTE) && (data[10] == EXM_TRACKER_REDZONE_BYTE));
+    EXM_TEST_CHECK((base[47] == EXM_TRACKER_REDZONE_BYTE) && (base[48] == 0));
+
+    memset(&block, 0, sizeof(block));
+    block.address = data;
+    block.size = 10;
+    EXM_TEST_CHECK(exm_tracker_redzone_check(&block, &offset) == 0);
+    block.redzone = front;
+    EXM_TEST_CHECK(exm_tracker_redzone_check(&block, &offset) == 0);
+
+    /* the first overwritten canary, after then before the block */
+    memset(data, 0x42, 12);
+    EXM_TEST_CHECK(exm_tracker_redzone_check(&block, &offset) == 2);
+    EXM_TEST_CHECK(offset == 10);
+    data[31] = 0;
+    EXM_TEST_CHECK(exm_tracker_redzone_check(&block, &offset) == 3);
+    EXM_TEST_CHECK(offset == 10);
+    data[-3] = 0;
+    EXM_TEST_CHECK(exm_tracker_redzone_check(&block, &offset) == 4);
+    EXM_TEST_CHECK(offset == -3);
+
+    /* longer than the SIMD registers */
+    exm_tracker_redzone_size_get(100, 100, 0, &front);
+    data = (unsigned char *)exm_tracker_redzone_set(base, 100, front);
+    block.address = data;
+    block.size = 100;
+    block.redzone = front;
+    EXM_TEST_CHECK(exm_tracker_redzone_check(&block, &offset) == 0);
+    data[100 + 12 + 60] = 0;
+    EXM_TEST_CHECK(exm_tracker_redzone_check(&block, &offset) == 1);
+    EXM_TEST_CHECK(offset == 172);
+    data[-(long)front + 40] = 0;
+    EXM_TEST_CHECK(exm_tracker_redzone_check(&block, &offset) == 2);
+    EXM_TEST_CHECK(offset == 40 - (long long)front);
+
+    free(base);
+}
+
+static void
+_exm_test_poison(void)
+{
+    Exm_Tracker_Block block;
+    unsigned char data[100];
+    long long offset = 0;
+
+    memset(&block, 0, sizeof(block));
+    block.address = data;
+    block.size = sizeof(data);
+    exm_tracker_poison_set(&block);
+    EXM_TEST_CHECK((data[0] == EXM_TRACKER_FREED_BYTE) && (data[99] == EXM_TRACKER_FREED_BYTE));
+    EXM_TEST_CHECK(exm_tracker_poison_check(&block, &offset) == 0);
+
+    data[99] = 0;
+    EXM_TEST_CHECK(exm_tracker_poison_check(&block, &offset) == 1);
+    EXM_TEST_CHECK(offset == 99);
+    data[40] = 0;
+    data[41] = 0;
+    EXM_TEST_CHECK(exm_tracker_poison_check(&block, &offset) == 3);
+    EXM_TEST_CHECK(offset == 40);
+
+    /* shorter than the SIMD registers */
+    block.size = 7;
+    exm_tracker_poison_set(&block);
+    EXM_TEST_CHECK(exm_tracker_poison_check(&block, &offset) == 0);
+    data[6] = 0;
+    EXM_TEST_CHECK(exm_tracker_poison_check(&block, &offset) == 1);
+    EXM_TEST_CHECK(offset == 6);
+    block.size = 0;
+    EXM_TEST_CHECK(exm_tracker_poison_check(&block, &offset) == 0);
+}
+
+static void
+_exm_test_timeline(void)
+{
+    Exm_Stack_Depot *depot;
+    Exm_Stack_Pc pcs[64];
+    Exm_Timeline *timeline;
+    Exm_Timeline_File *file;
+    const Exm_Timeline_Snapshot *snapshots;
+    const Exm_Timeline_Snapshot *peak;
+    const Exm_Timeline_Frame *frames;
+    unsigned int stacks[2];
+    unsigned int nbr;
+    unsigned int i;
+
+    depot = exm_stack_depot_new();
+    EXM_TEST_CHECK(depot != NULL);
+    if (!depot)
+        return;
+
+    nbr = exm_stack_capture(pcs, 64);
+    stacks[0] = exm_stack_depot_put(depot, pcs, nbr);
+    pcs[0].offset++;
+    stacks[1] = exm_stack_depot_put(depot, pcs, nbr);
+
+    timeline = exm_timeline_new("examine_test.exmt", 0);
+    EXM_TEST_CHECK(timeline != NULL);
+    if (!timeline)
+    {
+        exm_stack_depot_free(depot);
+        return;
+    }
+
+    /* a hump of 100 KB from the first site, then 1000 bytes kept from the second one */
+    for (i = 0; i < 100; i++)
+        exm_timeline_block_add(timeline, stacks[0], 1000);
+    for (i = 0; i < 100; i++)
+        exm_timeline_block_del(timeline, stacks[0], 1000);
+    for (i = 0; i < 10; i++)
+        exm_timeline_block_add(timeline, stacks[1], 100);
+
+    EXM_TEST_CHECK(exm_timeline_close(timeline, depot));
+    peak = exm_timeline_peak_get(timeline);
+    EXM_TEST_CHECK((peak->bytes >= 90000) && (peak->bytes <= 100000));
+    nbr = exm_timeline_snapshots_count(timeline);
+    exm_timeline_free(timeline);
+    exm_stack_depot_free(depot);
+
+    file = exm_timeline_file_new("examine_test.exmt");
+    EXM_TEST_CHECK(file != NULL);
+    if (!file)
+        return;
+
+    EXM_TEST_CHECK(exm_timeline_file_sample_interval_get(file) == 0);
+    snapshots = exm_timeline_file_snapshots_get(file, &i);
+    EXM_TEST_CHECK(i == nbr);
+    EXM_TEST_CHECK(i > 1);
+    if (i > 1)
+    {
+        EXM_TEST_CHECK(snapshots[i - 1].bytes == 1000);
+        EXM_TEST_CHECK(snapshots[i - 1].blocks == 10);
+        EXM_TEST_CHECK(snapshots[i - 1].time == 101000);
+        EXM_TEST_CHECK(snapshots[i - 1].sites_nbr == 1);
+        EXM_TEST_CHECK(snapshots[0].time <= snapshots[i - 1].time);
+    }
+
+    peak = exm_timeline_file_peak_get(file);
+    EXM_TEST_CHECK(peak != NULL);
+    if (peak)
+    {
+        EXM_TEST_CHECK((peak->bytes >= 90000) && (peak->bytes <= 100000));
+        EXM_TEST_CHECK(peak->flags & EXM_TIMELINE_SNAPSHOT_PEAK);
+        EXM_TEST_CHECK((peak->sites_nbr == 1) && (peak->sites[0].stack == stacks[0]));
+    }
+
+    frames = exm_timeline_file_frames_get(file, stacks[1], &nbr);
+    EXM_TEST_CHECK(frames != NULL);
+    EXM_TEST_CHECK(exm_timeline_file_frames_get(file, 1000, &nbr) == NULL);
+
+    exm_timeline_file_free(file);
+    remove("examine_test.exmt");
+}
+
+#define EXM_TEST_LEAK_BLOCKS 12
+#define EXM_TEST_LEAK_BLOCK(i) ((uintptr_t)(_exm_test_leak_heap + 8 * (i)))
+
+/* blocks of 8 words */
+static uintptr_t _exm_test_leak_heap[8 * EXM_TEST_LEAK_BLOCKS];
+
+static void
+_exm_test_leak_random(unsigned char simd, Exm_Leak_Kind *kinds, size_t *indirect)
+{
+    Exm_Tracker_Block *blocks;
+    Exm_Leak *leak;
+    uintptr_t *heap;
+    uintptr_t roots[64];
+    unsigned int state = 1;
+    size_t i;
+
+    heap = (uintptr_t *)malloc(10000 * 4 * sizeof(uintptr_t));
+    blocks = (Exm_Tracker_Block *)calloc(10000, sizeof(Exm_Tracker_Block));
+    if (!heap || !blocks)
+    {
+        EXM_TEST_CHECK(0);
+        free(blocks);
+        free(heap);
+        return;
+    }
+
+    /* words of random values, a few pointing to the blocks of 4 words */
+    for (i = 0; i < 10000 * 4; i++)
+    {
+        state = state * 1103515245 + 12345;
+        if ((state >> 16) % 8 == 0)
+            heap[i] = (uintptr_t)(heap + (state >> 8) % (10000 * 4));
+        else
+            heap[i] = (uintptr_t)state * 2654435761U;
+    }
+    for (i = 0; i < 64; i++)
+        roots[i] = (uintptr_t)(heap + 4 * i * 151);
+    for (i = 0; i < 10000; i++)
+    {
+        blocks[i].address = heap + 4 * i;
+        blocks[i].size = 4 * sizeof(uintptr_t);
+    }
+
+    exm_leak_simd_set(simd);
+    leak = exm_leak_new(blocks, 10000);
+    EXM_TEST_CHECK(leak != NULL);
+    exm_leak_root_scan(leak, roots, sizeof(roots));
+    exm_leak_run(leak);
+    EXM_TEST_CHECK(exm_leak_scanned_get(leak) > sizeof(roots));
+    for (i = 0; i < 10000; i++)
+    {
+        kinds[i] = exm_leak_kind_get(leak, i);
+        indirect[i] = exm_leak_indirect_get(leak, i);
+    }
+    exm_leak_free(leak);
+    exm_leak_simd_set(1);
+
+    free(blocks);
+    free(heap);
+}
+
+static void
+_exm_test_leak(void)
+{
+    static const Exm_Leak_Kind expected[EXM_TEST_LEAK_BLOCKS] =
+    {
+        EXM_LEAK_STILL_REACHABLE,
+        EXM_LEAK_STILL_REACHABLE,
+        EXM_LEAK_POSSIBLY_LOST,
+        EXM_LEAK_POSSIBLY_LOST,
+        EXM_LEAK_DEFINITELY_LOST,
+        EXM_LEAK_INDIRECTLY_LOST,
+        EXM_LEAK_INDIRECTLY_LOST,
+        EXM_LEAK_DEFINITELY_LOST,
+        EXM_LEAK_INDIRECTLY_LOST,
+        EXM_LEAK_DEFINITELY_LOST,
+        EXM_LEAK_DEFINITELY_LOST,
+        EXM_LEAK_STILL_REACHABLE
+    };
+    Exm_Tracker_Block blocks[EXM_TEST_LEAK_BLOCKS];
+    Exm_Leak_Kind *kinds[2];
+    size_t *indirect[2];
+    Exm_Leak *leak;
+    uintptr_t roots[5];
+    size_t i;
+
+    memset(_exm_test_leak_heap, 0, sizeof(_exm_test_leak_heap));
+    memset(blocks, 0, sizeof(blocks));
+    /* given in reverse order, the last one empty */
+    for (i = 0; i < EXM_TEST_LEAK_BLOCKS; i++)
+    {
+        blocks[EXM_TEST_LEAK_BLOCKS - 1 - i].address = (const void *)EXM_TEST_LEAK_BLOCK(i);
+        blocks[EXM_TEST_LEAK_BLOCKS - 1 - i].size = (i == EXM_TEST_LEAK_BLOCKS - 1) ? 0 : 8 * sizeof(uintptr_t);
+    }
+    blocks[EXM_TEST_LEAK_BLOCKS - 1 - 10].flags = EXM_TRACKER_BLOCK_GDI;
+
+    /* start pointers from the roots, and from a reached block */
+    roots[0] = EXM_TEST_LEAK_BLOCK(0);
+    _exm_test_leak_heap[8 * 0 + 5] = EXM_TEST_LEAK_BLOCK(1);
+    /* interior pointer from the roots, then start pointer */
+    roots[1] = EXM_TEST_LEAK_BLOCK(2) + 3 * sizeof(uintptr_t);
+    _exm_test_leak_heap[8 * 2 + 7] = EXM_TEST_LEAK_BLOCK(3);
+    /* a lost cycle, with a block reached from it */
+    _exm_test_leak_heap[8 * 4] = EXM_TEST_LEAK_BLOCK(5);
+    _exm_test_leak_heap[8 * 5] = EXM_TEST_LEAK_BLOCK(4) + 1;
+    _exm_test_leak_heap[8 * 5 + 1] = EXM_TEST_LEAK_BLOCK(6);
+    /* a lost block scanned before the lost block that reaches it */
+    _exm_test_leak_heap[8 * 9 + 2] = EXM_TEST_LEAK_BLOCK(8);
+    /* a GDI object is not memory, and an empty block */
+    roots[2] = EXM_TEST_LEAK_BLOCK(10);
+    roots[3] = EXM_TEST_LEAK_BLOCK(11);
+    /* out of the blocks */
+    roots[4] = EXM_TEST_LEAK_BLOCK(11) + 1;
+
+    leak = exm_leak_new(blocks, EXM_TEST_LEAK_BLOCKS);
+    EXM_TEST_CHECK(leak != NULL);
+    if (!leak)
+        return;
+
+    exm_leak_root_scan(leak, roots, sizeof(roots));
+    EXM_TEST_CHECK(exm_leak_scanned_get(leak) == sizeof(roots));
+    exm_leak_run(leak);
+
+    for (i = 0; i < EXM_TEST_LEAK_BLOCKS; i++)
+        EXM_TEST_CHECK(exm_leak_kind_get(leak, EXM_TEST_LEAK_BLOCKS - 1 - i) == expected[i]);
+    EXM_TEST_CHECK(exm_leak_indirect_get(leak, EXM_TEST_LEAK_BLOCKS - 1 - 4) == 16 * sizeof(uintptr_t));
+    EXM_TEST_CHECK(exm_leak_indirect_get(leak, EXM_TEST_LEAK_BLOCKS - 1 - 9) == 8 * sizeof(uintptr_t));
+    EXM_TEST_CHECK(exm_leak_indirect_get(leak, EXM_TEST_LEAK_BLOCKS - 1 - 0) == 0);
+    exm_leak_free(leak);
+
+    leak = exm_leak_new(NULL, 0);
+    EXM_TEST_CHECK(leak != NULL);
+    exm_leak_root_scan(leak, roots, sizeof(roots));
+    exm_leak_run(leak);
+    exm_leak_free(leak);
+
+    /* same classification with and without SIMD */
+    kinds[0] = (Exm_Leak_Kind *)malloc(2 * 10000 * sizeof(Exm_Leak_Kind));
+    indirect[0] = (size_t *)malloc(2 * 10000 * sizeof(size_t));
+    if (!kinds[0] || !indirect[0])
+    {
+        EXM_TEST_CHECK(0);
+        free(indirect[0]);
+        free(kinds[0]);
+        return;
+    }
+    kinds[1] = kinds[0] + 10000;
+    indirect[1] = indirect[0] + 10000;
+    _exm_test_leak_random(0, kinds[0], indirect[0]);
+    _exm_test_leak_random(1, kinds[1], indirect[1]);
+    EXM_TEST_CHECK(memcmp(kinds[0], kinds[1], 10000 * sizeof(Exm_Leak_Kind)) == 0);
+    EXM_TEST_CHECK(memcmp(indirect[0], indirect[1], 10000 * sizeof(size_t)) == 0);
+    free(indirect[0]);
+    free(kinds[0]);
+}
+
+/*
+ * A leak in a loop: 1M blocks of 16 bytes at most, from 1000
+ * allocation sites, grouped in one loss record per site.
+ */
+#define EXM_TEST_LEAK_RECORDS_BLOCKS 1000000
+#define EXM_TEST_LEAK_RECORDS_SITES 1000
+#define EXM_TEST_LEAK_RECORDS_SIZE(i) (sizeof(uintptr_t) + ((i) % EXM_TEST_LEAK_RECORDS_SITES) % 8)
+
+static void
+_exm_test_leak_records_add(const Exm_Tracker_Block *block, void *data)
+{
+    Exm_Tracker_Block **iter = data;
+
+    *(*iter)++ = *block;
+}
+
+static void
+_exm_test_leak_records(void)
+{
+    Exm_Tracker_Block block;
+    Exm_Tracker_Block old;
+    Exm_Tracker_Block *blocks;
+    Exm_Tracker_Block *iter;
+    Exm_Leak_Record *records;
+    Exm_Tracker *tracker;
+    Exm_Leak *leak;
+    unsigned char *heap;
+    uintptr_t roots[1];
+    uintptr_t p;
+    size_t bytes = 0;
+    size_t blocks_nbr = 0;
+    size_t nbr = 0;
+    size_t i;
+
+    heap = (unsigned char *)calloc(EXM_TEST_LEAK_RECORDS_BLOCKS, 16);
+    blocks = (Exm_Tracker_Block *)malloc(EXM_TEST_LEAK_RECORDS_BLOCKS * sizeof(Exm_Tracker_Block));
+    tracker = exm_tracker_new();
+    EXM_TEST_CHECK(heap && blocks && tracker);
+    if (!heap || !blocks || !tracker)
+        goto free_tracker;
+
+    memset(&block, 0, sizeof(block));
+    for (i = 0; i < EXM_TEST_LEAK_RECORDS_BLOCKS; i++)
+    {
+        block.address = heap + 16 * i;
+        block.size = EXM_TEST_LEAK_RECORDS_SIZE(i);
+        block.stack = (unsigned int)(i % EXM_TEST_LEAK_RECORDS_SITES) + 1;
+        exm_tracker_block_add(tracker, &block, &old);
+    }
+    EXM_TEST_CHECK(exm_tracker_count(tracker) == EXM_TEST_LEAK_RECORDS_BLOCKS);
+
+    /* the first block is still reachable, the second one reaches the third one */
+    roots[0] = (uintptr_t)heap;
+    p = (uintptr_t)(heap + 32);
+    memcpy(heap + 16, &p, sizeof(p));
+
+    iter = blocks;
+    exm_tracker_foreach(tracker, _exm_test_leak_records_add, &iter);
+    leak = exm_leak_new(blocks, EXM_TEST_LEAK_RECORDS_BLOCKS);
+    EXM_TEST_CHECK(leak != NULL);
+    exm_leak_root_scan(leak, roots, sizeof(roots));
+    exm_leak_run(leak);
+    records = exm_leak_records_new(leak, blocks, &nbr);
+    exm_leak_free(leak);
+
+    EXM_TEST_CHECK((records != NULL) && (nbr == EXM_TEST_LEAK_RECORDS_SITES));
+    for (i = 0; i < nbr; i++)
+    {
+        EXM_TEST_CHECK(records[i].kind == EXM_LEAK_DEFINITELY_LOST);
+        EXM_TEST_CHECK(records[i].indirect == ((records[i].stack == 2) ? EXM_TEST_LEAK_RECORDS_SIZE(2) : 0));
+        if (i > 0)
+            EXM_TEST_CHECK(records[i - 1].bytes + records[i - 1].indirect <= records[i].bytes + records[i].indirect);
+        bytes += records[i].bytes + records[i].indirect;
+        blocks_nbr += records[i].blocks;
+    }
+    EXM_TEST_CHECK(blocks_nbr == EXM_TEST_LEAK_RECORDS_BLOCKS - 2);
+    for (i = 1; i < EXM_TEST_LEAK_RECORDS_BLOCKS; i++)
+        bytes -= EXM_TEST_LEAK_RECORDS_SIZE(i);
+    EXM_TEST_CHECK(bytes == 0);
+    free(records);
+
+  free_tracker:
+    exm_tracker_free(tracker);
+    free(blocks);
+    free(heap);
+}
+
+/* the stacks of the suppression test, innermost frame first, by id */
+static const Exm_Suppression_Frame _exm_test_suppression_stacks[][4] =
+{
+    {
+        { "my_malloc", "/usr/lib/libfoo.so.1" },
+        { "foo_new", "/usr/lib/libfoo.so.1" },
+        { "main", "/usr/bin/prog" },
+        { NULL, NULL }
+    },
+    {
+        { "malloc", "/lib/libc.so.6" },
+        { NULL, "/usr/lib/libbar.so.2" },
+        { "bar_init", "/usr/lib/libbar.so.2" },
+        { "main", "/usr/bin/prog" }
+    },
+    {
+        { "free", "/lib/libc.so.6" },
+        { "foo_del", "/usr/lib/libfoo.so.1" },
+        { "main", "/usr/bin/prog" },
+        { NULL, NULL }
+    },
+    {
+        { "my_malloc", "/usr/lib/libfoo.so.1" },
+        { "main", "/usr/bin/prog" },
+        { NULL, NULL },
+        { NULL, NULL }
+    }
+};
+
+static const char _exm_test_suppression_buffer[] =
+    "# suppressions of the test\n"
+    "{\n"
+    "   foo\n"
+    "   Memcheck:Leak\n"
+    "   fun:my_malloc\n"
+    "   fun:foo_new\n"
+    "}\n"
+    "\n"
+    "{\n"
+    "   bar\n"
+    "   Memcheck:Leak\n"
+    "   match-leak-kinds: possible\n"
+    "   fun:malloc\n"
+    "   obj:/usr/lib/libbar.so*\n"
+    "   ...\n"
+    "   fun:main\n"
+    "}\n"
+    "{\n"
+    "   free\r\n"
+    "   Memcheck:Free\r\n"
+    "   fun:free\r\n"
+    "   ...\r\n"
+    "}\r\n"
+    "{\n"
+    "   race\n"
+    "   Helgrind:Race\n"
+    "   fun:*\n"
+    "}\n";
+
+static unsigned int _exm_test_suppression_calls = 0;
+
+static unsigned int
+_exm_test_suppression_frames_get(unsigned int stack, Exm_Suppression_Frame *frames, unsigned int max, void *data)
+{
+    unsigned int nbr;
+
+    _exm_test_suppression_calls++;
+    if (data)
+    {
+        /* a stack of frames f0, f1, ... */
+        for (nbr = 0; (nbr < max) && (nbr < 20); nbr++)
+        {
+            frames[nbr].function = ((char (*)[16])data)[nbr];
+            frames[nbr].object = "/usr/bin/prog";
+        }
+        return nbr;
+    }
+
+    for (nbr = 0; (nbr < max) && (nbr < 4) && _exm_test_suppression_stacks[stack][nbr].object; nbr++)
+        frames[nbr] = _exm_test_suppression_stacks[stack][nbr];
+
+    return nbr;
+}
+
+static void
+_exm_test_suppression(void)
+{
+    static const char unterminated[] = "{\n   foo\n   Memcheck:Leak\n   fun:foo\n";
+    static const char bad[] = "{\n   foo\n   Memcheck:Leak\n   bogus\n}\n";
+    char functions[20][16];
+    Exm_Suppression *sup;
+    FILE *f;
+    char *buffer;
+    size_t len;
+    unsigned int calls;
+    unsigned int i;
+
+    sup = exm_suppression_new();
+    EXM_TEST_CHECK(sup != NULL);
+    if (!sup)
+        return;
+
+    EXM_TEST_CHECK(exm_suppression_buffer_add(sup, _exm_test_suppression_buffer,
+                                              sizeof(_exm_test_suppression_buffer) - 1,
+                                              "test.supp") == 1);
+    /* the suppressions of the other tools are ignored */
+    EXM_TEST_CHECK(exm_suppression_count(sup) == 3);
+
+#define EXM_TEST_SUPPRESSION_MATCH(kind, stack) \
+    exm_suppression_match(sup, EXM_SUPPRESSION_ ## kind, stack, _exm_test_suppression_frames_get, NULL)
+
+    /* the frames are a prefix of the stack, for all the leak kinds */
+    EXM_TEST_CHECK(EXM_TEST_SUPPRESSION_MATCH(LEAK_DEFINITE, 0) &&
+                   (strcmp(EXM_TEST_SUPPRESSION_MATCH(LEAK_DEFINITE, 0), "foo") == 0));
+    EXM_TEST_CHECK(EXM_TEST_SUPPRESSION_MATCH(LEAK_REACHABLE, 0) != NULL);
+    EXM_TEST_CHECK(EXM_TEST_SUPPRESSION_MATCH(FREE, 0) == NULL);
+    EXM_TEST_CHECK(EXM_TEST_SUPPRESSION_MATCH(LEAK_DEFINITE, 3) == NULL);
+
+    /* object with wildcards, '...' over a frame, match-leak-kinds */
+    EXM_TEST_CHECK(EXM_TEST_SUPPRESSION_MATCH(LEAK_POSSIBLE, 1) &&
+                   (strcmp(EXM_TEST_SUPPRESSION_MATCH(LEAK_POSSIBLE, 1), "bar") == 0));
+    EXM_TEST_CHECK(EXM_TEST_SUPPRESSION_MATCH(LEAK_DEFINITE, 1) == NULL);
+
+    /* Free also suppresses the mismatched frees, a final '...' any frames */
+    EXM_TEST_CHECK(EXM_TEST_SUPPRESSION_MATCH(FREE, 2) != NULL);
+    EXM_TEST_CHECK(EXM_TEST_SUPPRESSION_MATCH(MISMATCH, 2) != NULL);
+    EXM_TEST_CHECK(EXM_TEST_SUPPRESSION_MATCH(OVERLAP, 2) == NULL);
+
+    /* the frames of a stack are only asked once per kind */
+    calls = _exm_test_suppression_calls;
+    EXM_TEST_CHECK(EXM_TEST_SUPPRESSION_MATCH(LEAK_DEFINITE, 0) != NULL);
+    EXM_TEST_CHECK(EXM_TEST_SUPPRESSION_MATCH(LEAK_DEFINITE, 1) == NULL);
+    EXM_TEST_CHECK(_exm_test_suppression_calls == calls);
+
+#undef EXM_TEST_SUPPRESSION_MATCH
+
+    /* syntax errors */
+    EXM_TEST_CHECK(exm_suppression_buffer_add(sup, unterminated, sizeof(unterminated) - 1, "test.supp") == 0);
+    EXM_TEST_CHECK(exm_suppression_buffer_add(sup, bad, sizeof(bad) - 1, "test.supp") == 0);
+    exm_suppression_free(sup);
+
+    /* a generated suppression matches its stack */
+    f = fopen("examine_test.supp", "wb");
+    EXM_TEST_CHECK(f != NULL);
+    if (f)
+    {
+        exm_suppression_print(f, EXM_SUPPRESSION_LEAK_POSSIBLE, _exm_test_suppression_stacks[1], 4);
+        fclose(f);
+
+        sup = exm_suppression_new();
+        EXM_TEST_CHECK(sup && exm_suppression_file_add(sup, "examine_test.supp"));
+        EXM_TEST_CHECK(exm_suppression_count(sup) == 1);
+        EXM_TEST_CHECK(exm_suppression_match(sup, EXM_SUPPRESSION_LEAK_POSSIBLE, 1,
+                                             _exm_test_suppression_frames_get, NULL) != NULL);
+        EXM_TEST_CHECK(exm_suppression_match(sup, EXM_SUPPRESSION_LEAK_DEFINITE, 1,
+                                             _exm_test_suppression_frames_get, NULL) == NULL);
+        exm_suppression_free(sup);
+        remove("examine_test.supp");
+    }
+
+    /* many suppressions, sharing their first frames */
+    buffer = (char *)malloc(10000 * 96);
+    EXM_TEST_CHECK(buffer != NULL);
+    if (!buffer)
+        return;
+
+    len = 0;
+    for (i = 0; i < 10000; i++)
+        len += sprintf(buffer + len, "{\n s%u\n Memcheck:Leak\n fun:f0\n ...\n fun:g%u\n fun:f%u*\n}\n",
+                       i, i, i % 20);
+    sup = exm_suppression_new();
+    EXM_TEST_CHECK(sup && exm_suppression_buffer_add(sup, buffer, len, "test.supp"));
+    EXM_TEST_CHECK(exm_suppression_count(sup) == 10000);
+    free(buffer);
+
+    for (i = 0; i < 20; i++)
+        sprintf(functions[i], "f%u", i);
+    EXM_TEST_CHECK(exm_suppression_match(sup, EXM_SUPPRESSION_LEAK_DEFINITE, 0,
+                                         _exm_test_suppression_frames_get, functions) == NULL);
+    strcpy(functions[9], "g9999");
+    strcpy(functions[10], "f19x");
+    EXM_TEST_CHECK(exm_suppression_match(sup, EXM_SUPPRESSION_LEAK_DEFINITE, 1,
+                                         _exm_test_suppression_frames_get, functions) &&
+                   (strcmp(exm_suppression_match(sup, EXM_SUPPRESSION_LEAK_DEFINITE, 1,
+                                                 _exm_test_suppression_frames_get, functions), "s9999") == 0));
+    exm_suppression_free(sup);
+}
+
+#ifdef EXM_TEST_MEMCHECK_PRELOAD
+
+/*
+ * Errors made by this program when it is run by the memcheck test.
+ * The functions are called through pointers for the compiler to keep
+ * the calls.
+ */
+static int
+_exm_test_memcheck_target(void)
+{
+    void *(*volatile alloc)(size_t) = malloc;
+    void (*volatile release)(void *) = free;
+    void *(*volatile copy)(void *, const void *, size_t) = memcpy;
+    char buf[] = "memcheck";
+    void *p;
+
+    /* leaked */
+    p = alloc(24);
+    EXM_TEST_CHECK(p != NULL);
+
+    p = alloc(10);
+    release(p);
+    release(p);
+
+    copy(buf + 1, buf, 4);
+
+    release((void *)(uintptr_t)0x1000);
+
+    return 0;
+}
+
+/*
+ * Blocks left by this program when it is run by the memcheck sampling
+ * test: 4 MB from a first site, 1 MB from a second one, and many short
+ * lived blocks.
+ */
+static int
+_exm_test_memcheck_sampling_target(void)
+{
+    void *(*volatile alloc)(size_t) = malloc;
+    void *(*volatile zalloc)(size_t, size_t) = calloc;
+    void (*volatile release)(void *) = free;
+    int i;
+
+    for (i = 0; i < 4096; i++)
+        EXM_TEST_CHECK(alloc(1024) != NULL);
+
+    for (i = 0; i < 1024; i++)
+        EXM_TEST_CHECK(zalloc(1, 1024) != NULL);
+
+    for (i = 0; i < 100000; i++)
+        release(alloc(64));
+
+    return 0;
+}
+
+/*
+ * Blocks left by this program when it is run by the memcheck leak
+ * test: still reachable from globals and from the stack of the caller
+ * of exit(), possibly lost, and definitely lost with an indirectly
+ * lost block.
+ */
+static void *volatile _exm_test_memcheck_reachable = NULL;
+static char *volatile _exm_test_memcheck_interior = NULL;
+
+/* its frame is not live when exit() is called, nor its registers */
+static void
+_exm_test_memcheck_leak_lose(void)
+{
+    void *(*volatile alloc)(size_t) = malloc;
+    void **lost;
+
+    lost = (void **)alloc(sizeof(void *));
+    if (lost)
+        lost[0] = alloc(300);
+}
+
+static int
+_exm_test_memcheck_leak_target(void)
+{
+    void *(*volatile alloc)(size_t) = malloc;
+    void (*volatile lose)(void) = _exm_test_memcheck_leak_lose;
+    void *volatile local;
+
+    _exm_test_memcheck_reachable = alloc(2 * sizeof(void *));
+    ((void **)_exm_test_memcheck_reachable)[0] = alloc(100);
+
+    _exm_test_memcheck_interior = (char *)alloc(200) + 8;
+
+    lose();
+
+    local = alloc(400);
+    exit(local ? 0 : 1);
+}
+
+static __thread void *_exm_test_memcheck_tls;
+static pthread_mutex_t _exm_test_memcheck_threads_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _exm_test_memcheck_threads_cond = PTHREAD_COND_INITIALIZER;
+static int _exm_test_memcheck_threads_ready = 0;
+
+static void *
+_exm_test_memcheck_threads_run(void *data)
+{
+    void *(*volatile alloc)(size_t) = malloc;
+    void *volatile local;
+
+    (void)data;
+
+    local = alloc(77);
+
+    pthread_mutex_lock(&_exm_test_memcheck_threads_mutex);
+    _exm_test_memcheck_threads_ready = 1;
+    pthread_cond_broadcast(&_exm_test_memcheck_threads_cond);
+    /* never woken up: the thread is alive at exit */
+    while (local)
+        pthread_cond_wait(&_exm_test_memcheck_threads_cond, &_exm_test_memcheck_threads_mutex);
+    pthread_mutex_unlock(&_exm_test_memcheck_threads_mutex);
+
+    return NULL;
+}
+
+/*
+ * Blocks of this program when it is run by the memcheck threads test:
+ * 100 bytes pointed by a thread local variable, 77 bytes pointed by the
+ * stack of a thread still running at exit. None of them is lost.
+ */
+static int
+_exm_test_memcheck_threads_target(void)
+{
+    void *(*volatile alloc)(size_t) = malloc;
+    pthread_t thread;
+
+    _exm_test_memcheck_tls = alloc(100);
+
+    if (pthread_create(&thread, NULL, _exm_test_memcheck_threads_run, NULL) != 0)
+        return 1;
+
+    pthread_mutex_lock(&_exm_test_memcheck_threads_mutex);
+    while (!_exm_test_memcheck_threads_ready)
+        pthread_cond_wait(&_exm_test_memcheck_threads_cond, &_exm_test_memcheck_threads_mutex);
+    pthread_mutex_unlock(&_exm_test_memcheck_threads_mutex);
+
+    return _exm_test_memcheck_tls ? 0 : 1;
+}
+
+/*
+ * Blocks lost in loops by this program when it is run by the memcheck
+ * loss records test: 1000 blocks of 16 bytes at a site, 3 blocks of 8
+ * bytes at another one.
+ */
+static int
+_exm_test_memcheck_records_target(void)
+{
+    void *(*volatile alloc)(size_t) = malloc;
+    int i;
+
+    for (i = 0; i < 1000; i++)
+        alloc(16);
+    for (i = 0; i < 3; i++)
+        alloc(8);
+
+    return 0;
+}
+
+/*
+ * Live heap of this program when it is run by the memcheck timeline
+ * test: a transient hump of 4 MB, then 256 KB kept until the exit.
+ */
+static int
+_exm_test_memcheck_timeline_target(void)
+{
+    void *(*volatile alloc)(size_t) = malloc;
+    void (*volatile release)(void *) = free;
+    void *blocks[64];
+    int i;
+
+    for (i = 0; i < 64; i++)
+        blocks[i] = alloc(65536);
+    for (i = 0; i < 64; i++)
+        release(blocks[i]);
+
+    for (i = 0; i < 4; i++)
+        EXM_TEST_CHECK(alloc(65536) != NULL);
+
+    return 0;
+}
+
+/*
+ * Writes out of the blocks made by this program when it is run by the
+ * memcheck redzone test: after a block that is freed and before a
+ * block that is not, and none in the blocks of the other allocators.
+ */
+static char *volatile _exm_test_memcheck_underrun = NULL;
+
+static int
+_exm_test_memcheck_redzone_target(void)
+{
+    void *(*volatile alloc)(size_t) = malloc;
+    void *(*volatile resize)(void *, size_t) = realloc;
+    void (*volatile release)(void *) = free;
+    char *volatile p;
+    void *q = NULL;
+    int i;
+
+    p = (char *)alloc(10);
+    EXM_TEST_CHECK(malloc_usable_size(p) == 10);
+    for (i = 0; i < 12; i++)
+        p[i] = 1;
+    release(p);
+
+    _exm_test_memcheck_underrun = (char *)alloc(24);
+    _exm_test_memcheck_underrun[-1] = 1;
+
+    p = (char *)alloc(5);
+    strcpy(p, "abcd");
+    p = (char *)resize(p, 100);
+    EXM_TEST_CHECK((p != NULL) && (strcmp(p, "abcd") == 0));
+    p[99] = 1;
+    p = (char *)resize(p, 3);
+    EXM_TEST_CHECK((p != NULL) && (p[2] == 'c'));
+    p[2] = 1;
+    release(p);
+
+    EXM_TEST_CHECK(posix_memalign(&q, 64, 100) == 0);
+    EXM_TEST_CHECK(((uintptr_t)q & 63) == 0);
+    memset(q, 1, 100);
+    release(q);
+
+    q = calloc(3, 7);
+    EXM_TEST_CHECK((q != NULL) && (((char *)q)[20] == 0));
+    release(q);
+
+    /* a whole page */
+    q = pvalloc(100);
+    EXM_TEST_CHECK((q != NULL) && (((uintptr_t)q & (sysconf(_SC_PAGESIZE) - 1)) == 0));
+    memset(q, 1, sysconf(_SC_PAGESIZE));
+    release(q);
+
+    p = strdup("memcheck");
+    EXM_TEST_CHECK((p != NULL) && (strcmp(p, "memcheck") == 0));
+    release(p);
+
+    /* an invalid realloc is reported, the C library never gets it */
+    p = (char *)alloc(32);
+    release(p);
+    EXM_TEST_CHECK(resize(p, 64) == NULL);
+    EXM_TEST_CHECK(resize(_exm_test_memcheck_underrun + 8, 64) == NULL);
+
+    return 0;
+}
+
+/*
+ * Write in a freed block made by this program when it is run by the
+ * memcheck quarantine test, with a quarantine of 4 KB.
+ */
+static int
+_exm_test_memcheck_quarantine_target(void)
+{
+    void *(*volatile alloc)(size_t) = malloc;
+    void *(*volatile resize)(void *, size_t) = realloc;
+    void (*volatile release)(void *) = free;
+    char *volatile p;
+    char *q;
+    int i;
+
+    p = (char *)alloc(32);
+    release(p);
+    EXM_TEST_CHECK((unsigned char)p[0] == EXM_TRACKER_FREED_BYTE);
+    p[4] = 1;
+
+    /* the address is not reused while the block is in quarantine */
+    q = (char *)alloc(32);
+    EXM_TEST_CHECK(q != p);
+    release(q);
+
+    /* nor given to the C library by realloc() */
+    EXM_TEST_CHECK(resize(p, 64) == NULL);
+
+    /* then the block is released */
+    for (i = 0; i < 100; i++)
+        release(alloc(64));
+
+    return _exm_test_failures != 0;
+}
+
+/*
+ * The report of memcheck on the given target, NULL on error. The
+ * options are set in the environment of the target, from env, a NULL
+ * terminated list of "NAME=value" strings, or NULL.
+ */
+static char *
+_exm_test_memcheck_run(const char *target, char *const *env)
+{
+    char self[4096];
+    char *output = NULL;
+    size_t output_len = 0;
+    int fds[2];
+    pid_t pid;
+    ssize_t len;
+    int status = -1;
+
+    len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    EXM_TEST_CHECK(len > 0);
+    if (len <= 0)
+        return NULL;
+    self[len] = '\0';
+
+    if (pipe(fds) != 0)
+    {
+        EXM_TEST_CHECK(0);
+        return NULL;
+    }
+
+    pid = fork();
+    EXM_TEST_CHECK(pid >= 0);
+    if (pid == 0)
+    {
+        char *args[3];
+
+        args[0] = self;
+        args[1] = (char *)target;
+        args[2] = NULL;
+        close(fds[0]);
+        dup2(fds[1], STDERR_FILENO);
+        close(fds[1]);
+        setenv("LD_PRELOAD", EXM_TEST_MEMCHECK_PRELOAD, 1);
+        setenv("EXM_MEMCHECK_LOG_LEVEL", "2", 1);
+        while (env && *env)
+            putenv(*env++);
+        execv(self, args);
+        _exit(127);
+    }
+
+    /* the report is written on the error output of the target */
+    close(fds[1]);
+    while (1)
+    {
+        char *tmp;
+
+        tmp = (char *)realloc(output, output_len + 4097);
+        if (!tmp)
+            break;
+        output = tmp;
+        len = read(fds[0], output + output_len, 4096);
+        if (len <= 0)
+            break;
+        output_len += len;
+    }
+    close(fds[0]);
+    if (pid > 0)
+        waitpid(pid, &status, 0);
+
+    EXM_TEST_CHECK(output != NULL);
+    if (!output)
+        return NULL;
+    output[output_len] = '\0';
+
+    EXM_TEST_CHECK(WIFEXITED(status) && (WEXITSTATUS(status) == 0));
+
+    return output;
+}
+
+static void
+_exm_test_memcheck(void)
+{
+    char *output;
+
+    output = _exm_test_memcheck_run("memcheck_target", NULL);
+    if (!output)
+        return;
+
+    EXM_TEST_CHECK(strstr(output, "Multiple frees") != NULL);
+    EXM_TEST_CHECK(strstr(output, "Source and destination overlap in memcpy") != NULL);
+    EXM_TEST_CHECK(strstr(output, "Invalid memory free without allocation") != NULL);
+    EXM_TEST_CHECK(strstr(output, "definitely lost: 24 bytes in 1 blocks") != NULL);
+    /* the loss record is an error too */
+    EXM_TEST_CHECK(strstr(output, "ERROR SUMMARY: 4 errors from 4 contexts") != NULL);
+    EXM_TEST_CHECK(strstr(output, "1 error in context 4 of 4") != NULL);
+
+    free(output);
+}
+
+static void
+_exm_test_memcheck_leak(void)
+{
+    char *output;
+    char buf[128];
+    const char *iter;
+    size_t bytes = 0;
+
+    output = _exm_test_memcheck_run("memcheck_leak_target", NULL);
+    if (!output)
+        return;
+
+    snprintf(buf, sizeof(buf), "%u (%u direct, 300 indirect) bytes in 1 block(s) are definitely lost",
+             (unsigned int)sizeof(void *) + 300, (unsigned int)sizeof(void *));
+    EXM_TEST_CHECK(strstr(output, buf) != NULL);
+    snprintf(buf, sizeof(buf), "definitely lost: %u bytes in 1 blocks", (unsigned int)sizeof(void *));
+    EXM_TEST_CHECK(strstr(output, buf) != NULL);
+    EXM_TEST_CHECK(strstr(output, "indirectly lost: 300 bytes in 1 blocks") != NULL);
+    EXM_TEST_CHECK(strstr(output, "200 bytes in 1 block(s) are possibly lost") != NULL);
+    EXM_TEST_CHECK(strstr(output, "possibly lost: 200 bytes in 1 blocks") != NULL);
+
+    /* and the blocks of the C library */
+    iter = strstr(output, "still reachable: ");
+    EXM_TEST_CHECK(iter != NULL);
+    if (iter)
+        bytes = (size_t)strtoul(iter + sizeof("still reachable: ") - 1, NULL, 10);
+    EXM_TEST_CHECK(bytes >= 2 * sizeof(void *) + 100 + 400);
+
+    free(output);
+}
+
+static void
+_exm_test_memcheck_threads(void)
+{
+    char *output;
+    const char *iter;
+    size_t bytes = 0;
+
+    output = _exm_test_memcheck_run("memcheck_threads_target", NULL);
+    if (!output)
+        return;
+
+    EXM_TEST_CHECK(strstr(output, "100 bytes in 1 block(s) are definitely lost") == NULL);
+    EXM_TEST_CHECK(strstr(output, "77 bytes in 1 block(s) are definitely lost") == NULL);
+    EXM_TEST_CHECK(strstr(output, "definitely lost: 0 bytes in 0 blocks") != NULL);
+
+    iter = strstr(output, "still reachable: ");
+    EXM_TEST_CHECK(iter != NULL);
+    if (iter)
+        bytes = (size_t)strtoul(iter + sizeof("still reachable: ") - 1, NULL, 10);
+    EXM_TEST_CHECK(bytes >= 100 + 77);
+
+    free(output);
+}
+
+static void
+_exm_test_memcheck_redzone(void)
+{
+    char *output;
+    static char *env[] = { "EXM_MEMCHECK_REDZONE=16", NULL };
+
+    output = _exm_test_memcheck_run("memcheck_redzone_target", env);
+    if (!output)
+        return;
+
+    EXM_TEST_CHECK(strstr(output, "Invalid write out of a block, found when it is freed") != NULL);
+    EXM_TEST_CHECK(strstr(output, "is 0 bytes after a block of size 10 alloc'd, 2 bytes overwritten") != NULL);
+    EXM_TEST_CHECK(strstr(output, "Invalid write out of a block, found at exit") != NULL);
+    EXM_TEST_CHECK(strstr(output, "is 1 bytes before a block of size 24 alloc'd, 1 bytes overwritten") != NULL);
+    EXM_TEST_CHECK(strstr(output, "_exm_test_memcheck_redzone_target") != NULL);
+    EXM_TEST_CHECK(strstr(output, "Multiple frees") != NULL);
+    EXM_TEST_CHECK(strstr(output, "Invalid memory free without allocation") != NULL);
+    EXM_TEST_CHECK(strstr(output, "ERROR SUMMARY: 4 errors") != NULL);
+
+    free(output);
+}
+
+static void
+_exm_test_memcheck_records(void)
+{
+    char *output;
+    static char *env[] = { "EXM_MEMCHECK_NUM_CALLERS=1", "EXM_MEMCHECK_LEAK_LIMIT=1", NULL };
+
+    output = _exm_test_memcheck_run("memcheck_records_target", env);
+    if (!output)
+        return;
+
+    /* only the largest record, with only the frame of the allocation */
+    EXM_TEST_CHECK(strstr(output, "16000 bytes in 1000 block(s) are definitely lost [2/2]") != NULL);
+    EXM_TEST_CHECK(strstr(output, "[1/2]") == NULL);
+    EXM_TEST_CHECK(strstr(output, "1 smaller loss records are not shown") != NULL);
+    EXM_TEST_CHECK(strstr(output, "_exm_test_memcheck_records_target") != NULL);
+    EXM_TEST_CHECK(strstr(output, "   by ") == NULL);
+    EXM_TEST_CHECK(strstr(output, "definitely lost: 16024 bytes in 1003 blocks") != NULL);
+
+    free(output);
+}
+
+static void
+_exm_test_memcheck_suppression(void)
+{
+    FILE *f;
+    char *output;
+    char buf[4096];
+    size_t len;
+    static char *env[] =
+    {
+        "EXM_MEMCHECK_SUPPRESSIONS=examine_test.supp:examine_test_leak.supp",
+        "EXM_MEMCHECK_GEN_SUPPRESSIONS=examine_test_gen.supp",
+        NULL
+    };
+
+    /* the frees of memcheck_target, in the first file, and its leak */
+    f = fopen("examine_test.supp", "wb");
+    EXM_TEST_CHECK(f != NULL);
+    if (!f)
+        return;
+    fprintf(f, "{\n   frees\n   Memcheck:Free\n   fun:_exm_test_memcheck_*\n   ...\n}\n");
+    fclose(f);
+
+    f = fopen("examine_test_leak.supp", "wb");
+    EXM_TEST_CHECK(f != NULL);
+    if (!f)
+        goto remove_supp;
+    fprintf(f, "{\n   leak\n   Memcheck:Leak\n   match-leak-kinds: definite\n   fun:_exm_test_memcheck_target\n}\n");
+    fclose(f);
+
+    output = _exm_test_memcheck_run("memcheck_target", env);
+    if (!output)
+        goto remove_supp;
+
+    EXM_TEST_CHECK(strstr(output, "Multiple frees\n") == NULL);
+    EXM_TEST_CHECK(strstr(output, "Invalid memory free without allocation\n") == NULL);
+    EXM_TEST_CHECK(strstr(output, "Source and destination overlap in memcpy") != NULL);
+    EXM_TEST_CHECK(strstr(output, "definitely lost: 0 bytes in 0 blocks") != NULL);
+    EXM_TEST_CHECK(strstr(output, "suppressed: 24 bytes in 1 blocks") != NULL);
+    EXM_TEST_CHECK(strstr(output, "ERROR SUMMARY: 1 errors from 1 contexts (suppressed: 3 from 3)") != NULL);
+    free(output);
+
+    /* only the overlap is displayed, so generated */
+    f = fopen("examine_test_gen.supp", "rb");
+    EXM_TEST_CHECK(f != NULL);
+    if (!f)
+        goto remove_supp;
+    len = fread(buf, 1, sizeof(buf) - 1, f);
+    buf[len] = '\0';
+    fclose(f);
+
+    EXM_TEST_CHECK(strstr(buf, "   Memcheck:Overlap\n   fun:_exm_test_memcheck_target\n") != NULL);
+    EXM_TEST_CHECK(strstr(buf, "Memcheck:Free") == NULL);
+    EXM_TEST_CHECK(strstr(buf, "Memcheck:Leak") == NULL);
+    remove("examine_test_gen.supp");
+
+  remove_supp:
+    remove("examine_test_leak.supp");
+    remove("examine_test.supp");
+}
+
+static void
+_exm_test_memcheck_quarantine(void)
+{
+    char *output;
+    static char *env[] = { "EXM_MEMCHECK_QUARANTINE=4096", NULL };
+
+    output = _exm_test_memcheck_run("memcheck_quarantine_target", env);
+    if (!output)
+        return;
+
+    EXM_TEST_CHECK(strstr(output, "Invalid write in a freed block") != NULL);
+    EXM_TEST_CHECK(strstr(output, "is 4 bytes inside a block of size 32 free'd, 1 bytes overwritten") != NULL);
+    EXM_TEST_CHECK(strstr(output, "Block was alloc'd at") != NULL);
+    EXM_TEST_CHECK(strstr(output, "_exm_test_memcheck_quarantine_target") != NULL);
+    EXM_TEST_CHECK(strstr(output, "Multiple frees") != NULL);
+    EXM_TEST_CHECK(strstr(output, "ERROR SUMMARY: 2 errors") != NULL);
+
+    free(output);
+}
+
+static void
+_exm_test_memcheck_sampling(void)
+{
+    char *output;
+    const char *iter;
+    double bytes = 0.0;
+    static char *env[] = { "EXM_MEMCHECK_SAMPLE_INTERVAL=16384", NULL };
+
+    /* about 300 blocks of the 5 MB are sampled */
+    output = _exm_test_memcheck_run("memcheck_sampling_target", env);
+    if (!output)
+        return;
+
+    iter = strstr(output, "in use at exit: ~");
+    EXM_TEST_CHECK(iter != NULL);
+    if (iter)
+        bytes = atof(iter + sizeof("in use at exit: ~") - 1);
+    EXM_TEST_CHECK((bytes > 3.5 * 1024 * 1024) && (bytes < 6.5 * 1024 * 1024));
+    EXM_TEST_CHECK(strstr(output, "Live heap by allocation site") != NULL);
+    /* the frees of the blocks that are not sampled are not errors */
+    EXM_TEST_CHECK(strstr(output, "ERROR SUMMARY: 0 errors") != NULL);
+
+    free(output);
+}
+
+static void
+_exm_test_memcheck_timeline(void)
+{
+    Exm_Timeline_File *file;
+    const Exm_Timeline_Snapshot *snapshots;
+    const Exm_Timeline_Snapshot *peak;
+    char *output;
+    unsigned int nbr;
+    static char *env[] = { "EXM_MEMCHECK_TIMELINE=examine_test.exmt", NULL };
+
+    output = _exm_test_memcheck_run("memcheck_timeline_target", env);
+    if (!output)
+        return;
+
+    EXM_TEST_CHECK(strstr(output, "HEAP TIMELINE:") != NULL);
+    free(output);
+
+    file = exm_timeline_file_new("examine_test.exmt");
+    EXM_TEST_CHECK(file != NULL);
+    if (!file)
+        return;
+
+    /* the hump is found within 1% and 4 KB, the loader blocks aside */
+    peak = exm_timeline_file_peak_get(file);
+    EXM_TEST_CHECK(peak != NULL);
+    if (peak)
+    {
+        EXM_TEST_CHECK((peak->bytes > 4000000) && (peak->bytes < 4400000));
+        EXM_TEST_CHECK((peak->sites_nbr > 0) && (peak->sites[0].bytes >= 4000000));
+        EXM_TEST_CHECK(exm_timeline_file_frames_get(file, peak->sites[0].stack, &nbr) != NULL);
+    }
+
+    snapshots = exm_timeline_file_snapshots_get(file, &nbr);
+    EXM_TEST_CHECK(nbr > 2);
+    if (nbr > 0)
+        EXM_TEST_CHECK((snapshots[nbr - 1].bytes >= 262144) &&
+                       (snapshots[nbr - 1].bytes < 1000000));
+
+    exm_timeline_file_free(file);
+    remove("examine_test.exmt");
+}
+
+#endif
+
+typedef struct
+{
+    const char *name;
+    void (*test)(void);
+} Exm_Test;
+
+static const Exm_Test _exm_tests[] =
+{
+    { "stack_depot", _exm_test_stack_depot },
+    { "symbol_index", _exm_test_symbol_index },
+    { "dwarf_lines", _exm_test_dwarf_lines },
+    { "dwarf_index", _exm_test_dwarf_index },
+    { "pdb_index", _exm_test_pdb_index },
+    { "symbol_cache", _exm_test_symbol_cache },
+    { "coff_index", _exm_test_coff_index },
+    { "pdata_index", _exm_test_pdata_index },
+    { "reloc_stats", _exm_test_reloc_stats },
+    { "resource_index", _exm_test_resource_index },
+    { "version_info", _exm_test_version_info },
+    { "sha_vectors", _exm_test_sha_vectors },
+    { "authenticode_digest", _exm_test_authenticode_digest },
+    { "pe_checksum", _exm_test_pe_checksum },
+    { "entropy", _exm_test_entropy },
+    { "tracker", _exm_test_tracker },
+    { "tracker_threads", _exm_test_tracker_threads },
+    { "tracker_reused", _exm_test_tracker_reused },
+    { "redzone", _exm_test_redzone },
+    { "poison", _exm_test_poison },
+    { "timeline", _exm_test_timeline },
+    { "leak", _exm_test_leak },
+    { "leak_records", _exm_test_leak_records },
+    { "suppression", _exm_test_suppression },
+#ifdef EXM_TEST_MEMCHECK_PRELOAD
+    { "memcheck", _exm_test_memcheck },
+    { "memcheck_leak", _exm_test_memcheck_leak },
+    { "memcheck_threads", _exm_test_memcheck_threads },
+    { "memcheck_redzone", _exm_test_memcheck_redzone },
+    { "memcheck_records", _exm_test_memcheck_records },
+    { "memcheck_suppression", _exm_test_memcheck_suppression },
+    { "memcheck_quarantine", _exm_test_memcheck_quarantine },
+    { "memcheck_sampling", _exm_test_memcheck_sampling },
+    { "memcheck_timeline", _exm_test_memcheck_timeline },
+#endif
+    { NULL, NULL }
+};
+
+int main(int argc, char *argv[])
+{
+    const Exm_Test *iter;
+    int count = 0;
+
+#ifdef EXM_TEST_MEMCHECK_PRELOAD
+    /* run by the memcheck test, with the memcheck library preloaded */
+    if ((argc > 1) && (strcmp(argv[1], "memcheck_target") == 0))
+        return _exm_test_memcheck_target();
+    if ((argc > 1) && (strcmp(argv[1], "memcheck_leak_target") == 0))
+        return _exm_test_memcheck_leak_target();
+    if ((argc > 1) && (strcmp(argv[1], "memcheck_threads_target") == 0))
+        return _exm_test_memcheck_threads_target();
+    if ((argc > 1) && (strcmp(argv[1], "memcheck_redzone_target") == 0))
+        return _exm_test_memcheck_redzone_target();
+    if ((argc > 1) && (strcmp(argv[1], "memcheck_records_target") == 0))
+        return _exm_test_memcheck_records_target();
+    if ((argc > 1) && (strcmp(argv[1], "memcheck_quarantine_target") == 0))
+        return _exm_test_memcheck_quarantine_target();
+    if ((argc > 1) && (strcmp(argv[1], "memcheck_sampling_target") == 0))
+        return _exm_test_memcheck_sampling_target();
+    if ((argc > 1) && (strcmp(argv[1], "memcheck_timeline_target") == 0))
+        return _exm_test_memcheck_timeline_target();
+#endif
+
+    exm_init();
+
+    for (iter = _exm_tests; iter->name; iter++)
+    {
+        if ((argc > 1) && (strcmp(argv[1], iter->name) != 0))
+            continue;
+
+        printf("%s\n", iter->name);
+        iter->test();
+        count++;
+    }
+
+    exm_shutdown();
+
+    if (count == 0)
+    {
+        printf("no test %s\n", argv[1]);
+        return 1;
+    }
+
+    if (_exm_test_failures)
+    {
+        printf("%d check(s) failed\n", _exm_test_failures);
+        return 1;
+    }
+
+    return 0;
+}